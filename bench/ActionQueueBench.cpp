@@ -0,0 +1,458 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Connection.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageManager.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MpscQueue.hpp>
+
+namespace
+{
+    /**
+     * This is the number of chunks of traffic each producer delivers.
+     */
+    constexpr size_t CHUNKS_PER_PRODUCER = 20000;
+
+    /**
+     * This is the number of chat lines in each chunk, which with the
+     * length of each line is about what a busy connection reads at once.
+     */
+    constexpr size_t LINES_PER_CHUNK = 8;
+
+    /**
+     * This is the length of the text of each chat line.
+     */
+    constexpr size_t TEXT_LENGTH = 150;
+
+    /**
+     * This is the number of actions each producer posts when the queues
+     * are compared on their own.
+     */
+    constexpr size_t ACTIONS_PER_PRODUCER = 100000;
+
+    /**
+     * This is the length of the text carried by each action, about that of
+     * a chunk of chat traffic.
+     */
+    constexpr size_t PAYLOAD_LENGTH = 200;
+
+    /**
+     * These match the MessageManager's queue of actions, and the most
+     * actions its worker performs before checking for anything else.
+     */
+    constexpr size_t QUEUE_CAPACITY = 1024;
+    constexpr size_t BATCH_SIZE = 64;
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * This stands in for the MessageManager's actions.
+     */
+    struct BenchAction
+    {
+        int type = 0;
+        std::string message;
+    };
+
+    /**
+     * This measures how long the given number of threads take to post
+     * their actions to one worker through a deque guarded by a mutex, the
+     * way the MessageManager did before the ring.
+     *
+     * @param[out] nanosecondsPerAction This is where to store the time
+     * taken per action.
+     *
+     * @return an indication of whether or not the worker got every action
+     * is returned.
+     */
+    bool RunMutexDeque(size_t producers, double& nanosecondsPerAction)
+    {
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque< BenchAction > actions;
+        bool stop = false;
+        size_t received = 0;
+        std::thread worker(
+            [&]
+            {
+                std::unique_lock< decltype(mutex) > lock(mutex);
+                for (;;)
+                {
+                    while (!actions.empty())
+                    {
+                        const auto action = std::move(actions.front());
+                        actions.pop_front();
+                        lock.unlock();
+                        received += action.message.length();
+                        lock.lock();
+                    }
+                    if (stop)
+                    {
+                        break;
+                    }
+                    wake.wait(lock, [&]{ return stop || !actions.empty(); });
+                }
+            }
+        );
+        const std::string payload(PAYLOAD_LENGTH, 'x');
+        const auto start = Clock::now();
+        std::vector< std::thread > threads;
+        for (size_t i = 0; i < producers; ++i)
+        {
+            threads.emplace_back(
+                [&]
+                {
+                    for (size_t n = 0; n < ACTIONS_PER_PRODUCER; ++n)
+                    {
+                        BenchAction action;
+                        action.type = 2;
+                        action.message = payload;
+                        std::lock_guard< decltype(mutex) > lock(mutex);
+                        actions.push_back(std::move(action));
+                        wake.notify_one();
+                    }
+                }
+            );
+        }
+        for (auto& thread: threads)
+        {
+            thread.join();
+        }
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            stop = true;
+            wake.notify_one();
+        }
+        worker.join();
+        const std::chrono::duration< double, std::nano > elapsed = Clock::now() - start;
+        nanosecondsPerAction = elapsed.count() / (double)(producers * ACTIONS_PER_PRODUCER);
+        return (received == producers * ACTIONS_PER_PRODUCER * PAYLOAD_LENGTH);
+    }
+
+    /**
+     * This measures how long the given number of threads take to post
+     * their actions to one worker through the MpscQueue, waking the worker
+     * the way the MessageManager's WakeWorker and Worker do.
+     *
+     * @param[out] nanosecondsPerAction This is where to store the time
+     * taken per action.
+     *
+     * @return an indication of whether or not the worker got every action
+     * is returned.
+     */
+    bool RunRing(size_t producers, double& nanosecondsPerAction)
+    {
+        std::mutex mutex;
+        std::condition_variable wake;
+        TwitchBot::MpscQueue< BenchAction > actions(QUEUE_CAPACITY);
+        std::atomic< bool > stop{false};
+        std::atomic< bool > workerWaiting{false};
+        size_t received = 0;
+        const auto wakeWorker = [&]
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (workerWaiting.load(std::memory_order_relaxed))
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                workerWaiting = false;
+                wake.notify_one();
+            }
+        };
+        std::thread worker(
+            [&]
+            {
+                std::unique_lock< decltype(mutex) > lock(mutex, std::defer_lock);
+                for (;;)
+                {
+                    if (lock.owns_lock())
+                    {
+                        lock.unlock();
+                    }
+                    BenchAction action;
+                    size_t performed = 0;
+                    while (
+                        (performed < BATCH_SIZE)
+                        && actions.TryPop(action)
+                    )
+                    {
+                        ++performed;
+                        received += action.message.length();
+                    }
+                    if (performed == BATCH_SIZE)
+                    {
+                        continue;
+                    }
+                    lock.lock();
+                    workerWaiting = true;
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (!actions.Empty())
+                    {
+                        workerWaiting = false;
+                        continue;
+                    }
+                    if (stop)
+                    {
+                        break;
+                    }
+                    wake.wait(lock, [&]{ return stop || !workerWaiting; });
+                    workerWaiting = false;
+                }
+            }
+        );
+        const std::string payload(PAYLOAD_LENGTH, 'x');
+        const auto start = Clock::now();
+        std::vector< std::thread > threads;
+        for (size_t i = 0; i < producers; ++i)
+        {
+            threads.emplace_back(
+                [&]
+                {
+                    for (size_t n = 0; n < ACTIONS_PER_PRODUCER; ++n)
+                    {
+                        BenchAction action;
+                        action.type = 2;
+                        action.message = payload;
+                        while (!actions.TryPush(action))
+                        {
+                            wakeWorker();
+                            std::this_thread::yield();
+                        }
+                        wakeWorker();
+                    }
+                }
+            );
+        }
+        for (auto& thread: threads)
+        {
+            thread.join();
+        }
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            stop = true;
+            workerWaiting = false;
+            wake.notify_one();
+        }
+        worker.join();
+        const std::chrono::duration< double, std::nano > elapsed = Clock::now() - start;
+        nanosecondsPerAction = elapsed.count() / (double)(producers * ACTIONS_PER_PRODUCER);
+        return (received == producers * ACTIONS_PER_PRODUCER * PAYLOAD_LENGTH);
+    }
+
+    /**
+     * This compares the two queues with the given number of producers
+     * contending, and prints the timings.
+     *
+     * @return an indication of whether or not both workers got every
+     * action is returned.
+     */
+    bool CompareQueues(size_t producers)
+    {
+        double mutexDeque = 0.0;
+        double ring = 0.0;
+        bool passed = true;
+        if (!RunMutexDeque(producers, mutexDeque))
+        {
+            fprintf(stderr, "%zu producer(s): mutex/deque lost actions\n", producers);
+            passed = false;
+        }
+        if (!RunRing(producers, ring))
+        {
+            fprintf(stderr, "%zu producer(s): ring lost actions\n", producers);
+            passed = false;
+        }
+        printf(
+            "%zu producer(s): mutex/deque %.0f ns/action, ring %.0f ns/action\n",
+            producers,
+            mutexDeque,
+            ring
+        );
+        return passed;
+    }
+
+    /**
+     * This is a stand-in connection which answers the login, and lets the
+     * benchmark hand traffic to the MessageManager from as many threads as
+     * it likes. Like a real connection, it hands over one piece of text at
+     * a time, since the MessageManager scans each connection's traffic for
+     * PINGs with one scanner, which only one thread may use.
+     */
+    class BenchConnection
+        : public TwitchBot::Connection
+    {
+        public:
+            /**
+             * This hands the given text to the MessageManager, as if the
+             * server had sent it.
+             */
+            void Deliver(const std::string& text)
+            {
+                std::lock_guard< decltype(deliverMutex_) > deliverLock(deliverMutex_);
+                MessageReceivedDelegate messageReceivedDelegate;
+                {
+                    std::lock_guard< decltype(mutex_) > lock(mutex_);
+                    messageReceivedDelegate = messageReceivedDelegate_;
+                }
+                messageReceivedDelegate(text);
+            }
+
+        // TwitchBot::Connection
+        public:
+            virtual void SetMessageReceivedDelegate(MessageReceivedDelegate messageReceivedDelegate) override
+            {
+                std::lock_guard< decltype(mutex_) > lock(mutex_);
+                messageReceivedDelegate_ = messageReceivedDelegate;
+            }
+
+            virtual void SetDisconnectedDelegate(DisconnectedDelegate) override
+            {
+            }
+
+            virtual bool Connect() override
+            {
+                return true;
+            }
+
+            virtual bool Disconnect() override
+            {
+                return true;
+            }
+
+            virtual void Send(const std::string& message) override
+            {
+                if (message.find("NICK ") != std::string::npos)
+                {
+                    Deliver(":tmi.twitch.tv 376 bot :>\r\n");
+                }
+            }
+
+        private:
+            std::mutex deliverMutex_;
+            std::mutex mutex_;
+            MessageReceivedDelegate messageReceivedDelegate_;
+    };
+
+    /**
+     * This has the given number of threads deliver chat traffic to a
+     * MessageManager, taking turns the way the threads of a real connection
+     * would, through its MessageReceived path, and measures how long it takes until the message
+     * delegate has seen every line.
+     *
+     * @param[in] producers This is the number of threads delivering
+     * traffic.
+     *
+     * @return an indication of whether or not every line was handed over
+     * is returned.
+     */
+    bool Run(size_t producers)
+    {
+        const auto connection = std::make_shared< BenchConnection >();
+        TwitchBot::MessageManager manager;
+        manager.SetConnectionFactory([&connection]{ return connection; });
+        std::atomic< bool > loggedIn{false};
+        std::atomic< size_t > received{0};
+        manager.SetLoggedInDelegate([&]{ loggedIn = true; });
+        manager.SetMessageReceivedDelegate(
+            [&](const TwitchBot::Message& message)
+            {
+                if (message.knownCommand == TwitchBot::KnownCommand::Privmsg)
+                {
+                    received.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        );
+        manager.LogIn("bot", "token");
+        const auto logInDeadline = Clock::now() + std::chrono::seconds(5);
+        while (!loggedIn && (Clock::now() < logInDeadline))
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (!loggedIn)
+        {
+            fprintf(stderr, "unable to log in\n");
+            return false;
+        }
+        std::string chunk;
+        const std::string text(TEXT_LENGTH, 'x');
+        for (size_t i = 0; i < LINES_PER_CHUNK; ++i)
+        {
+            chunk += ":user" + std::to_string(i) + "!user@user.tmi.twitch.tv PRIVMSG #channel" + std::to_string(i) + " :" + text + "\r\n";
+        }
+        const auto expected = producers * CHUNKS_PER_PRODUCER * LINES_PER_CHUNK;
+        const auto start = Clock::now();
+        std::vector< std::thread > threads;
+        for (size_t i = 0; i < producers; ++i)
+        {
+            threads.emplace_back(
+                [&]
+                {
+                    for (size_t n = 0; n < CHUNKS_PER_PRODUCER; ++n)
+                    {
+                        connection->Deliver(chunk);
+                    }
+                }
+            );
+        }
+        for (auto& thread: threads)
+        {
+            thread.join();
+        }
+        const auto deadline = Clock::now() + std::chrono::seconds(30);
+        while (
+            (received.load(std::memory_order_relaxed) < expected)
+            && (Clock::now() < deadline)
+        )
+        {
+            std::this_thread::yield();
+        }
+        const std::chrono::duration< double, std::nano > elapsed = Clock::now() - start;
+        const auto stats = manager.GetStats();
+        manager.LogOut("");
+        printf(
+            "%zu producer(s): %.0f ns/line, %.0f lines/s, %zu/%zu lines handed over, %llu chunks dropped\n",
+            producers,
+            elapsed.count() / (double)expected,
+            (double)expected * 1e9 / elapsed.count(),
+            received.load(),
+            expected,
+            (unsigned long long)stats.chunksDropped
+        );
+        if (received != expected)
+        {
+            fprintf(stderr, "%zu producer(s): lost lines\n", producers);
+            return false;
+        }
+        return true;
+    }
+}
+
+/**
+ * This compares posting actions to a worker through a mutex and deque with
+ * posting them through the MpscQueue, with a few producers contending, and
+ * then measures how quickly chat traffic goes from the threads delivering
+ * it, through a real MessageManager's queue of actions, to the message
+ * delegate. The timings are only reported; it fails if any action or line
+ * is lost.
+ */
+int main()
+{
+    printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+    bool passed = true;
+    for (const size_t producers: {1, 2, 4})
+    {
+        passed &= CompareQueues(producers);
+    }
+    for (const size_t producers: {1, 2, 4})
+    {
+        passed &= Run(producers);
+    }
+    return passed ? 0 : 1;
+}
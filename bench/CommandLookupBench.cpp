@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/CommandController.hpp>
+
+namespace
+{
+    /**
+     * This is the number of commands registered.
+     */
+    constexpr size_t COMMANDS = 1000;
+
+    /**
+     * This is the number of times each set of chat lines is looked up.
+     */
+    constexpr size_t ROUNDS = 2000;
+
+    /**
+     * These count the memory allocated while counting is on.
+     */
+    bool countAllocations = false;
+    size_t allocations = 0;
+
+    /**
+     * This looks up each of the given chat lines, over and over, and
+     * prints how long each lookup took on average.
+     *
+     * @return an indication of whether or not the lookups didn't allocate
+     * memory, and found the expected number of commands, is returned.
+     */
+    bool Run(
+        const TwitchBot::CommandController& controller,
+        const char* name,
+        const std::vector< std::string >& lines,
+        size_t expectedHits
+    )
+    {
+        TwitchBot::CommandInvocation invocation;
+        size_t hits = 0;
+        allocations = 0;
+        countAllocations = true;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < ROUNDS; ++round)
+        {
+            for (const auto& line: lines)
+            {
+                hits += controller.Lookup(line, invocation) ? 1 : 0;
+            }
+        }
+        const std::chrono::duration< double, std::nano > elapsed = std::chrono::steady_clock::now() - start;
+        countAllocations = false;
+        const auto perLookup = elapsed.count() / (double)(ROUNDS * lines.size());
+        printf(
+            "%-24s %7.1f ns/lookup, %zu hits, %zu allocations\n",
+            name,
+            perLookup,
+            hits / ROUNDS,
+            allocations
+        );
+        bool passed = true;
+        if (allocations != 0)
+        {
+            fprintf(stderr, "%s: lookups allocate memory\n", name);
+            passed = false;
+        }
+        if (hits != expectedHits * ROUNDS)
+        {
+            fprintf(stderr, "%s: expected %zu hits\n", name, expectedHits);
+            passed = false;
+        }
+        return passed;
+    }
+}
+
+void* operator new(size_t size)
+{
+    if (countAllocations)
+    {
+        ++allocations;
+    }
+    const auto memory = malloc((size == 0) ? 1 : size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+/**
+ * This measures finding commands among 1000 registered ones, for chat
+ * lines which use one and lines which don't. The timings are only
+ * reported; it fails if lookups allocate memory or miss.
+ */
+int main()
+{
+    TwitchBot::CommandController controller;
+    for (size_t i = 0; i < COMMANDS; ++i)
+    {
+        (void)controller.Register(
+            "cmd" + std::to_string(i),
+            [](const TwitchBot::CommandInvocation&){}
+        );
+    }
+    controller.Compile();
+    std::vector< std::string > hits;
+    std::vector< std::string > hitsWithoutArguments;
+    std::vector< std::string > plainChat;
+    std::vector< std::string > unknownCommands;
+    for (size_t i = 0; i < COMMANDS; ++i)
+    {
+        const auto command = "!cmd" + std::to_string((i * 7) % COMMANDS);
+        hits.push_back(command + " some arguments here");
+        hitsWithoutArguments.push_back(command);
+        plainChat.push_back("just a regular chat line number " + std::to_string(i));
+        unknownCommands.push_back("!cmd" + std::to_string(COMMANDS + i) + " arguments");
+    }
+    bool passed = true;
+    passed &= Run(controller, "hit", hits, COMMANDS);
+    passed &= Run(controller, "hit, no arguments", hitsWithoutArguments, COMMANDS);
+    passed &= Run(controller, "miss, not a command", plainChat, 0);
+    passed &= Run(controller, "miss, unknown command", unknownCommands, 0);
+    return passed ? 0 : 1;
+}
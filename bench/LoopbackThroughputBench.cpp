@@ -0,0 +1,244 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LoopbackServer.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SocketConnection.hpp>
+
+namespace
+{
+    /**
+     * This is the number of PINGs sent one at a time, each waiting for its
+     * PONG, to measure the round trip.
+     */
+    constexpr size_t ROUND_TRIPS = 2000;
+
+    /**
+     * This is the number of lines sent to the server to measure how
+     * quickly the connection writes.
+     */
+    constexpr size_t LINES_SENT = 200000;
+
+    /**
+     * These are the number of chunks of chat traffic the server sends, and
+     * the number of lines in each, to measure how quickly the connection
+     * reads.
+     */
+    constexpr size_t CHUNKS_RECEIVED = 1000;
+    constexpr size_t LINES_PER_CHUNK = 1000;
+
+    /**
+     * This is the longest to wait for any part of the benchmark to finish.
+     */
+    constexpr auto TIMEOUT = std::chrono::seconds(30);
+
+    using Clock = std::chrono::steady_clock;
+
+    double Seconds(Clock::duration duration)
+    {
+        return std::chrono::duration< double >(duration).count();
+    }
+
+    /**
+     * This is what the connection has received so far.
+     */
+    struct Received
+    {
+        std::mutex mutex;
+        std::condition_variable condition;
+        size_t bytes = 0;
+        size_t pongs = 0;
+    };
+
+    /**
+     * This measures the PING to PONG round trip over the connection.
+     *
+     * @return an indication of whether or not every PING was answered is
+     * returned.
+     */
+    bool MeasureRoundTrips(
+        TwitchBot::SocketConnection& connection,
+        Received& received
+    )
+    {
+        std::vector< double > roundTrips;
+        roundTrips.reserve(ROUND_TRIPS);
+        for (size_t i = 0; i < ROUND_TRIPS; ++i)
+        {
+            const auto start = Clock::now();
+            connection.Send("PING :tmi.twitch.tv\r\n");
+            std::unique_lock< decltype(received.mutex) > lock(received.mutex);
+            if (
+                !received.condition.wait_for(
+                    lock,
+                    TIMEOUT,
+                    [&]{ return received.pongs > i; }
+                )
+            )
+            {
+                fprintf(stderr, "PING went unanswered\n");
+                return false;
+            }
+            roundTrips.push_back(Seconds(Clock::now() - start) * 1e6);
+        }
+        std::sort(roundTrips.begin(), roundTrips.end());
+        printf(
+            "PING->PONG round trip: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+            roundTrips[ROUND_TRIPS / 2],
+            roundTrips[ROUND_TRIPS * 99 / 100],
+            roundTrips.back()
+        );
+        return true;
+    }
+
+    /**
+     * This measures how quickly the connection writes lines to the server.
+     *
+     * @return an indication of whether or not the server received every
+     * line is returned.
+     */
+    bool MeasureSending(
+        TwitchBot::SocketConnection& connection,
+        TwitchBot::LoopbackServer& server
+    )
+    {
+        const std::string line = "PRIVMSG #channel :the quick brown fox jumps over the lazy dog\r\n";
+        const auto linesBefore = server.GetLinesReceived();
+        const auto statsBefore = connection.GetStats();
+        const auto start = Clock::now();
+        for (size_t i = 0; i < LINES_SENT; ++i)
+        {
+            connection.Send(line);
+        }
+        const auto deadline = start + TIMEOUT;
+        while (
+            (server.GetLinesReceived() - linesBefore < LINES_SENT)
+            && (Clock::now() < deadline)
+        )
+        {
+            std::this_thread::yield();
+        }
+        const auto elapsed = Seconds(Clock::now() - start);
+        const auto stats = connection.GetStats();
+        const auto writes = stats.writes - statsBefore.writes;
+        printf(
+            "send: %.0f lines/s, %.1f MB/s, %llu writes (%.1f lines/write)\n",
+            (double)LINES_SENT / elapsed,
+            (double)(LINES_SENT * line.length()) / elapsed / 1e6,
+            (unsigned long long)writes,
+            (double)LINES_SENT / (double)std::max< uint64_t >(writes, 1)
+        );
+        if (server.GetLinesReceived() - linesBefore != LINES_SENT)
+        {
+            fprintf(stderr, "lines sent were lost\n");
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * This measures how quickly the connection reads chat traffic sent by
+     * the server.
+     *
+     * @return an indication of whether or not all the traffic arrived is
+     * returned.
+     */
+    bool MeasureReceiving(
+        TwitchBot::SocketConnection& connection,
+        TwitchBot::LoopbackServer& server,
+        Received& received
+    )
+    {
+        std::string chunk;
+        for (size_t i = 0; i < LINES_PER_CHUNK; ++i)
+        {
+            chunk += ":user!user@user.tmi.twitch.tv PRIVMSG #channel :the quick brown fox jumps over the lazy dog\r\n";
+        }
+        const auto total = chunk.length() * CHUNKS_RECEIVED;
+        size_t bytesBefore;
+        {
+            std::lock_guard< decltype(received.mutex) > lock(received.mutex);
+            bytesBefore = received.bytes;
+        }
+        const auto readsBefore = connection.GetStats().reads;
+        const auto start = Clock::now();
+        for (size_t i = 0; i < CHUNKS_RECEIVED; ++i)
+        {
+            server.Broadcast(chunk);
+        }
+        bool arrived;
+        {
+            std::unique_lock< decltype(received.mutex) > lock(received.mutex);
+            arrived = received.condition.wait_for(
+                lock,
+                TIMEOUT,
+                [&]{ return received.bytes - bytesBefore >= total; }
+            );
+        }
+        const auto elapsed = Seconds(Clock::now() - start);
+        printf(
+            "receive: %.0f lines/s, %.1f MB/s, %llu reads\n",
+            (double)(CHUNKS_RECEIVED * LINES_PER_CHUNK) / elapsed,
+            (double)total / elapsed / 1e6,
+            (unsigned long long)(connection.GetStats().reads - readsBefore)
+        );
+        if (!arrived)
+        {
+            fprintf(stderr, "traffic received was lost\n");
+            return false;
+        }
+        return true;
+    }
+}
+
+/**
+ * This measures the round trip, and the rates of sending and receiving, of
+ * a SocketConnection talking to a server on the loopback interface. The
+ * timings are only reported; it fails if anything sent is lost.
+ */
+int main()
+{
+    TwitchBot::LoopbackServer server;
+    if (!server.Start())
+    {
+        fprintf(stderr, "unable to start the server\n");
+        return 1;
+    }
+    Received received;
+    TwitchBot::SocketConnection connection("127.0.0.1", server.GetPort());
+    connection.SetMessageReceivedDelegate(
+        [&](const std::string& text)
+        {
+            std::lock_guard< decltype(received.mutex) > lock(received.mutex);
+            received.bytes += text.length();
+            for (
+                auto pong = text.find("PONG ");
+                pong != std::string::npos;
+                pong = text.find("PONG ", pong + 1)
+            )
+            {
+                ++received.pongs;
+            }
+            received.condition.notify_all();
+        }
+    );
+    if (!connection.Connect())
+    {
+        fprintf(stderr, "unable to connect\n");
+        return 1;
+    }
+    bool passed = true;
+    passed &= MeasureRoundTrips(connection, received);
+    passed &= MeasureSending(connection, server);
+    passed &= MeasureReceiving(connection, server, received);
+    (void)connection.Disconnect();
+    server.Stop();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Executor.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LoopbackServer.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageManager.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SocketConnection.hpp>
+
+namespace
+{
+    /**
+     * These are the number of messages sent to the slow channel, and how
+     * long the handler takes with each, which together back up the handler
+     * for about a second.
+     */
+    constexpr size_t SLOW_MESSAGES = 100;
+    constexpr auto SLOW_HANDLER_TIME = std::chrono::milliseconds(10);
+
+    /**
+     * These are the number of PINGs sent while the handler is backed up,
+     * each followed by a message to another channel, and the time between
+     * them.
+     */
+    constexpr size_t PINGS = 50;
+    constexpr auto PING_SPACING = std::chrono::milliseconds(10);
+
+    using Clock = std::chrono::steady_clock;
+
+    double Milliseconds(Clock::duration duration)
+    {
+        return std::chrono::duration< double, std::milli >(duration).count();
+    }
+
+    /**
+     * This returns the given percentile of the given measurements, which
+     * must be sorted.
+     */
+    double Percentile(const std::vector< double >& sorted, size_t percent)
+    {
+        if (sorted.empty())
+        {
+            return 0.0;
+        }
+        return sorted[std::min(sorted.size() - 1, sorted.size() * percent / 100)];
+    }
+
+    /**
+     * This backs up the message handler of a MessageManager with slow
+     * messages, over a real connection to a server on the loopback
+     * interface, and then measures how long the server's PINGs wait for
+     * PONGs, and how long messages of another channel wait for the handler.
+     *
+     * @param[in] useExecutor This indicates whether or not to run the
+     * handlers on an executor, rather than on the manager's worker.
+     *
+     * @return an indication of whether or not every PING was answered is
+     * returned.
+     */
+    bool Run(bool useExecutor)
+    {
+        TwitchBot::LoopbackServer server;
+        if (!server.Start())
+        {
+            fprintf(stderr, "unable to start the server\n");
+            return false;
+        }
+        std::mutex mutex;
+        std::vector< Clock::time_point > pings;
+        std::vector< Clock::time_point > pongs;
+        std::vector< double > otherChannelWaits;
+        server.SetLineReceivedDelegate(
+            [&](const std::string& line)
+            {
+                if (line.compare(0, 5, "PONG ") == 0)
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    pongs.push_back(Clock::now());
+                }
+            }
+        );
+        {
+            const auto executor = std::make_shared< TwitchBot::Executor >(4);
+            TwitchBot::MessageManager manager;
+            if (useExecutor)
+            {
+                manager.SetExecutor(executor);
+            }
+            manager.SetConnectionFactory(
+                [&]
+                {
+                    return std::make_shared< TwitchBot::SocketConnection >("127.0.0.1", server.GetPort());
+                }
+            );
+            std::atomic< bool > loggedIn{false};
+            std::atomic< size_t > slowHandled{0};
+            manager.SetLoggedInDelegate([&]{ loggedIn = true; });
+            manager.SetMessageReceivedDelegate(
+                [&](const TwitchBot::Message& message)
+                {
+                    if (message.command != "PRIVMSG")
+                    {
+                        return;
+                    }
+                    if (message.parameters[0] == "#slow")
+                    {
+                        std::this_thread::sleep_for(SLOW_HANDLER_TIME);
+                        ++slowHandled;
+                        return;
+                    }
+                    const Clock::time_point sent(Clock::duration(std::stoll(message.parameters[1])));
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    otherChannelWaits.push_back(Milliseconds(Clock::now() - sent));
+                }
+            );
+            manager.LogIn("bot", "token");
+            const auto logInDeadline = Clock::now() + std::chrono::seconds(5);
+            while (!loggedIn && (Clock::now() < logInDeadline))
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            if (!loggedIn)
+            {
+                fprintf(stderr, "unable to log in\n");
+                return false;
+            }
+            for (size_t i = 0; i < SLOW_MESSAGES; ++i)
+            {
+                server.Broadcast(":u!u@u.tmi.twitch.tv PRIVMSG #slow :spam\r\n");
+            }
+            for (size_t i = 0; i < PINGS; ++i)
+            {
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    pings.push_back(Clock::now());
+                }
+                server.Broadcast("PING :tmi.twitch.tv\r\n");
+                server.Broadcast(
+                    ":u!u@u.tmi.twitch.tv PRIVMSG #other :"
+                    + std::to_string(Clock::now().time_since_epoch().count())
+                    + "\r\n"
+                );
+                std::this_thread::sleep_for(PING_SPACING);
+            }
+            const auto deadline = Clock::now() + std::chrono::seconds(10);
+            while (Clock::now() < deadline)
+            {
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    if (
+                        (pongs.size() >= PINGS)
+                        && (otherChannelWaits.size() >= PINGS)
+                        && (slowHandled == SLOW_MESSAGES)
+                    )
+                    {
+                        break;
+                    }
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            manager.LogOut("");
+        }
+        server.Stop();
+        std::vector< double > pongWaits;
+        for (size_t i = 0; i < std::min(pings.size(), pongs.size()); ++i)
+        {
+            pongWaits.push_back(Milliseconds(pongs[i] - pings[i]));
+        }
+        std::sort(pongWaits.begin(), pongWaits.end());
+        std::sort(otherChannelWaits.begin(), otherChannelWaits.end());
+        const auto mode = useExecutor ? "executor" : "worker";
+        printf(
+            "%-8s PONGs %zu/%zu, PING->PONG p50 %.2f ms p99 %.2f ms; other channel wait p50 %.1f ms max %.1f ms\n",
+            mode,
+            pongWaits.size(),
+            PINGS,
+            Percentile(pongWaits, 50),
+            Percentile(pongWaits, 99),
+            Percentile(otherChannelWaits, 50),
+            otherChannelWaits.empty() ? 0.0 : otherChannelWaits.back()
+        );
+        if (pongWaits.size() != PINGS)
+        {
+            fprintf(stderr, "%s: PINGs went unanswered\n", mode);
+            return false;
+        }
+        return true;
+    }
+}
+
+/**
+ * This measures how quickly PINGs are answered, and how long messages of
+ * one channel wait, while the handler of another channel is slow, with the
+ * handlers on the worker and on an executor. The timings are only
+ * reported; it fails if any PING goes unanswered.
+ */
+int main()
+{
+    bool passed = true;
+    passed &= Run(false);
+    passed &= Run(true);
+    return passed ? 0 : 1;
+}
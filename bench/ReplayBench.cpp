@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SpamDetector.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SyntheticCapture.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TrafficReplayer.hpp>
+
+namespace
+{
+    /**
+     * This is the number of times the capture is replayed, to show how
+     * much the measurements vary.
+     */
+    constexpr size_t ROUNDS = 3;
+
+    /**
+     * This replays the capture once, as fast as the manager takes it, and
+     * prints the measurements.
+     *
+     * @return an indication of whether or not every message in the capture
+     * was delivered, and the expected number of them, is returned.
+     */
+    bool Replay(
+        const std::string& path,
+        const char* name,
+        std::shared_ptr< TwitchBot::SpamDetector > spamDetector,
+        uint64_t expectedMessages,
+        TwitchBot::TrafficReplayer::Report& report
+    )
+    {
+        TwitchBot::TrafficReplayer replayer;
+        replayer.SetSpamDetector(spamDetector);
+        if (!replayer.Replay(path, TwitchBot::TrafficReplayer::Pace::FullSpeed, report))
+        {
+            fprintf(stderr, "unable to replay %s\n", path.c_str());
+            return false;
+        }
+        printf(
+            "%-14s %9.0f msg/s, %6.1f MB/s, chunk latency p50 %.1f us, p99 %.1f us, parse p50 %llu ns, p99 %llu ns",
+            name,
+            report.messagesPerSecond,
+            report.bytesPerSecond / 1e6,
+            report.latencyP50,
+            report.latencyP99,
+            (unsigned long long)report.manager.parse.p50,
+            (unsigned long long)report.manager.parse.p99
+        );
+        if (spamDetector != nullptr)
+        {
+            printf(
+                ", %llu spam, detected p50 %.1f us, p99 %.1f us",
+                (unsigned long long)report.spamMessages,
+                report.detectionLatencyP50,
+                report.detectionLatencyP99
+            );
+        }
+        printf("\n");
+        if (report.messagesDelivered != report.messages)
+        {
+            fprintf(
+                stderr,
+                "%llu of %llu messages were lost\n",
+                (unsigned long long)(report.messages - report.messagesDelivered),
+                (unsigned long long)report.messages
+            );
+            return false;
+        }
+        if (
+            (expectedMessages != 0)
+            && (report.messages != expectedMessages)
+        )
+        {
+            fprintf(
+                stderr,
+                "%llu messages were replayed, but %llu were written\n",
+                (unsigned long long)report.messages,
+                (unsigned long long)expectedMessages
+            );
+            return false;
+        }
+        return true;
+    }
+}
+
+/**
+ * This replays a capture of traffic from the Twitch server through a
+ * MessageManager, with and without a SpamDetector, and prints how fast it
+ * was handled, as the benchmark to compare from one parser or queue
+ * change to the next. The capture is the one given, if any, or otherwise
+ * a synthetic one written with the default settings (the same as
+ * "twitchbot synthesize"). The timings are only reported; it fails if
+ * any message is lost, or if no spam is found in the synthetic capture.
+ */
+int main(int argc, char* argv[])
+{
+    std::string path;
+    std::string directory;
+    uint64_t expectedMessages = 0;
+    if (argc > 1)
+    {
+        path = argv[1];
+    }
+    else
+    {
+        char name[] = "/tmp/ReplayBench.XXXXXX";
+        if (mkdtemp(name) == nullptr)
+        {
+            fprintf(stderr, "unable to make a directory for the capture\n");
+            return 1;
+        }
+        directory = name;
+        path = directory + "/synthetic.cap";
+        if (!TwitchBot::WriteSyntheticCapture(path, TwitchBot::SyntheticCaptureSettings(), expectedMessages))
+        {
+            fprintf(stderr, "unable to write %s\n", path.c_str());
+            (void)rmdir(directory.c_str());
+            return 1;
+        }
+    }
+    bool passed = true;
+    TwitchBot::TrafficReplayer::Report report;
+    for (size_t round = 0; passed && (round < ROUNDS); ++round)
+    {
+        passed = Replay(path, "manager", nullptr, expectedMessages, report);
+    }
+    if (passed)
+    {
+        printf(
+            "capture: %llu messages, %llu bytes, %llu chunks, %.1f s\n",
+            (unsigned long long)report.messages,
+            (unsigned long long)report.bytes,
+            (unsigned long long)report.chunks,
+            report.captureSeconds
+        );
+    }
+    for (size_t round = 0; passed && (round < ROUNDS); ++round)
+    {
+        passed = Replay(path, "+ spam check", std::make_shared< TwitchBot::SpamDetector >(), expectedMessages, report);
+        if (
+            passed
+            && (expectedMessages != 0)
+            && (report.spamMessages == 0)
+        )
+        {
+            fprintf(stderr, "no spam was found in the synthetic capture\n");
+            passed = false;
+        }
+    }
+    if (!directory.empty())
+    {
+        (void)unlink(path.c_str());
+        (void)rmdir(directory.c_str());
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SymbolTable.hpp>
+
+namespace
+{
+    /**
+     * This is the number of names interned.
+     */
+    constexpr size_t NAMES = 200000;
+
+    /**
+     * This is the number of times each set of names is looked up.
+     */
+    constexpr size_t ROUNDS = 20;
+
+    /**
+     * This makes names shaped like Twitch logins: short, mostly lower case
+     * letters, often ending in digits, and often differing from each other
+     * in only a character or two.
+     */
+    std::vector< std::string > MakeNames(size_t count, const char* prefix)
+    {
+        static const char* const stems[] = {
+            "a", "xx", "bot", "gamer", "streamer", "the_real_", "notacrab",
+            "xxprosniperxx", "averyveryverylongname_",
+        };
+        std::vector< std::string > names;
+        names.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            names.push_back(
+                prefix
+                + std::string(stems[i % (sizeof(stems) / sizeof(stems[0]))])
+                + std::to_string(i)
+            );
+        }
+        return names;
+    }
+
+    /**
+     * This calls the given function on each name, over and over, and
+     * prints how long each call took on average.
+     *
+     * @return the sum of the results is returned, so the calls can't be
+     * optimized away.
+     */
+    template< typename Function > uint64_t Run(
+        const char* name,
+        const std::vector< std::string >& names,
+        size_t rounds,
+        Function function
+    )
+    {
+        uint64_t sum = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < rounds; ++round)
+        {
+            for (const auto& text: names)
+            {
+                sum += (uint64_t)function(text);
+            }
+        }
+        const std::chrono::duration< double, std::nano > elapsed = std::chrono::steady_clock::now() - start;
+        printf("%-20s %7.1f ns/name\n", name, elapsed.count() / (double)(rounds * names.size()));
+        return sum;
+    }
+
+    /**
+     * This counts the names which share the low or the high 32 bits of
+     * their hash with an earlier name. The table compares the low bits
+     * before comparing names, and the cache picks its entry with the high
+     * bits, so collisions in either cost time.
+     */
+    void CountCollisions(const std::vector< std::string >& names)
+    {
+        std::unordered_set< uint32_t > low;
+        std::unordered_set< uint32_t > high;
+        size_t lowCollisions = 0;
+        size_t highCollisions = 0;
+        for (const auto& name: names)
+        {
+            const auto hash = TwitchBot::SymbolTable::Hash(name);
+            lowCollisions += low.insert((uint32_t)hash).second ? 0 : 1;
+            highCollisions += high.insert((uint32_t)(hash >> 32)).second ? 0 : 1;
+        }
+        printf(
+            "collisions           %zu in the low 32 bits, %zu in the high 32 bits (about %.1f expected)\n",
+            lowCollisions,
+            highCollisions,
+            (double)names.size() * (double)names.size() / 2.0 / 4294967296.0
+        );
+    }
+}
+
+int main()
+{
+    const auto names = MakeNames(NAMES, "");
+    const auto strangers = MakeNames(NAMES, "z");
+    const auto table = std::make_shared< TwitchBot::SymbolTable >();
+    uint64_t sum = 0;
+    sum += Run("Hash", names, ROUNDS, [](const std::string& name){ return TwitchBot::SymbolTable::Hash(name); });
+    sum += Run("Intern (new)", names, 1, [&](const std::string& name){ return table->Intern(name); });
+    sum += Run("Intern (existing)", names, ROUNDS, [&](const std::string& name){ return table->Intern(name); });
+    sum += Run("Find (hit)", names, ROUNDS, [&](const std::string& name){ return table->Find(name); });
+    sum += Run("Find (miss)", strangers, ROUNDS, [&](const std::string& name){ return table->Find(name); });
+
+    // A cache in front of the table is meant for the few names one
+    // connection sees over and over, such as the channels it's in.
+    TwitchBot::SymbolTable::Cache cache(table);
+    const std::vector< std::string > regulars(names.begin(), names.begin() + 32);
+    sum += Run("Cache (hit)", regulars, ROUNDS * NAMES / regulars.size(), [&](const std::string& name){ return cache.Intern(name); });
+    CountCollisions(names);
+    printf("(checksum %llu)\n", (unsigned long long)sum);
+
+    // Every name must have been interned, once, and be found again.
+    if (table->GetCount() != NAMES)
+    {
+        fprintf(stderr, "expected %zu names, got %zu\n", NAMES, table->GetCount());
+        return 1;
+    }
+    for (const auto& name: names)
+    {
+        const auto symbol = table->Find(name);
+        if (
+            (symbol == TwitchBot::SymbolTable::NO_SYMBOL)
+            || (table->GetName(symbol) != name)
+        )
+        {
+            fprintf(stderr, "\"%s\" wasn't found\n", name.c_str());
+            return 1;
+        }
+    }
+    for (const auto& name: strangers)
+    {
+        if (table->Find(name) != TwitchBot::SymbolTable::NO_SYMBOL)
+        {
+            fprintf(stderr, "\"%s\" was found but never interned\n", name.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,261 @@
+#ifndef TWITCH_BOT_CHAT_ANALYTICS_HPP
+#define TWITCH_BOT_CHAT_ANALYTICS_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This keeps live measurements of each channel's chat, for dashboards:
+     * how many messages are sent each second, how many different users are
+     * chatting, and which words and emotes are used most.
+     *
+     * Everything is estimated in fixed memory for each channel, however
+     * busy it gets:
+     * - Different users are counted with HyperLogLog sketches, one since
+     *   the channel was first seen and one for each window of time. Each
+     *   user-id is hashed, and each sketch register keeps the most leading
+     *   zeros seen among the hashes which pick it. The sketch keeps a
+     *   running sum over its registers as they change, so estimates are
+     *   read without going over the registers.
+     * - Words and emotes are counted in one Count-Min sketch (several rows
+     *   of counters, one counter picked in each row by a hash of the word,
+     *   the estimate being the smallest of them), updated conservatively
+     *   (only the smallest counters are raised). The words and emotes with
+     *   the highest estimates are kept in small heaps, one for each. At
+     *   the end of each window, the counts are all halved, so the ones
+     *   used lately stand out.
+     * - Messages are counted in one counter for each of the last 64
+     *   seconds.
+     *
+     * Any number of threads may feed messages in and take snapshots at
+     * once. Each channel has a lock of its own, which taking a snapshot
+     * only holds long enough to copy a kilobyte or so, so it never holds
+     * up feeding messages in for long.
+     */
+    class ChatAnalytics
+    {
+        // Types
+        public:
+            /**
+             * These are the settings of the analytics, which fix the memory
+             * used for each channel.
+             */
+            struct Settings
+            {
+                /**
+                 * This is the number of bits of each user-id hash which pick
+                 * a register of the HyperLogLog sketches, which have 2 to
+                 * this power registers of one byte. The relative error of
+                 * the counts of users is about 1.04 / sqrt(registers).
+                 */
+                size_t userPrecision = 12;
+
+                /**
+                 * These are the number of rows of the Count-Min sketch, and
+                 * the number of counters in each row, which is rounded up
+                 * to a power of two.
+                 */
+                size_t sketchDepth = 4;
+                size_t sketchWidth = 2048;
+
+                /**
+                 * This is the number of words, and of emotes, kept as the
+                 * most used in each channel.
+                 */
+                size_t topCount = 16;
+
+                /**
+                 * This is the length of each window of time, in seconds.
+                 */
+                double window = 60.0;
+            };
+
+            /**
+             * This is one of the most used words or emotes of a channel.
+             */
+            struct TopEntry
+            {
+                /**
+                 * This is the word or emote. Words are folded to lower case,
+                 * and only their first 31 bytes are kept.
+                 */
+                std::string text;
+
+                /**
+                 * This is about how many times it was used, halved at the
+                 * end of each window.
+                 */
+                uint64_t count = 0;
+            };
+
+            /**
+             * These are the measurements of one channel at one time.
+             */
+            struct ChannelSnapshot
+            {
+                /**
+                 * This is the name of the channel, without the leading hash
+                 * (#) character.
+                 */
+                std::string channel;
+
+                /**
+                 * This is the number of messages seen in the channel.
+                 */
+                uint64_t messages = 0;
+
+                /**
+                 * These are the messages per second seen in the channel,
+                 * over the last second, ten seconds and minute before the
+                 * current second.
+                 */
+                double messagesPerSecond = 0.0;
+                double messagesPerSecond10 = 0.0;
+                double messagesPerSecond60 = 0.0;
+
+                /**
+                 * These are about how many different users have chatted in
+                 * the channel since it was first seen, in the current
+                 * window so far, and in the last whole window.
+                 */
+                uint64_t users = 0;
+                uint64_t windowUsers = 0;
+                uint64_t lastWindowUsers = 0;
+
+                /**
+                 * These are the most used words and emotes, most used
+                 * first.
+                 */
+                std::vector< TopEntry > topWords;
+                std::vector< TopEntry > topEmotes;
+            };
+
+        // Lifecycle Management
+        public:
+            ~ChatAnalytics() noexcept;
+            ChatAnalytics(const ChatAnalytics& other) = delete;
+            ChatAnalytics(ChatAnalytics&&) noexcept = delete;
+            ChatAnalytics& operator=(const ChatAnalytics& other) = delete;
+            ChatAnalytics& operator=(ChatAnalytics&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs analytics which have seen no messages, using
+             * the default settings.
+             */
+            ChatAnalytics();
+
+            /**
+             * This constructs analytics which have seen no messages.
+             *
+             * @param[in] settings These are the settings of the analytics.
+             */
+            explicit ChatAnalytics(const Settings& settings);
+
+            /**
+             * This method counts a message received from the Twitch server,
+             * if it's a PRIVMSG. The user is identified by the user-id tag,
+             * or by nickname if there isn't one.
+             *
+             * @param[in] message This is the message received.
+             *
+             * @param[in] now This is the current time, in seconds. It
+             * shouldn't go backwards.
+             *
+             * @return an indication of whether or not the message was
+             * counted is returned.
+             */
+            bool Add(
+                const Message& message,
+                double now
+            );
+
+            /**
+             * This method counts a chat line, given its parts.
+             *
+             * @param[in] channel This is the channel of the line, without
+             * the leading hash (#) character.
+             *
+             * @param[in] user This identifies the user who sent the line.
+             *
+             * @param[in] text This is the text of the line.
+             *
+             * @param[in] emotes This is the emotes tag of the line, in the
+             * form "id:first-last,first-last/id:first-last", where first
+             * and last count characters (code points) of the text.
+             *
+             * @param[in] now This is the current time, in seconds. It
+             * shouldn't go backwards.
+             */
+            void Add(
+                std::string_view channel,
+                std::string_view user,
+                std::string_view text,
+                std::string_view emotes,
+                double now
+            );
+
+            /**
+             * This method takes a snapshot of the measurements of every
+             * channel seen.
+             *
+             * @param[in] now This is the current time, in seconds, from
+             * which message rates are measured.
+             *
+             * @return The measurements of each channel are returned.
+             */
+            std::vector< ChannelSnapshot > GetSnapshot(double now) const;
+
+            /**
+             * This method takes a snapshot of the measurements of one
+             * channel.
+             *
+             * @param[in] channel This is the name of the channel, without
+             * the leading hash (#) character.
+             *
+             * @param[in] now This is the current time, in seconds, from
+             * which message rates are measured.
+             *
+             * @param[out] snapshot This is where to store the measurements.
+             *
+             * @return an indication of whether or not the channel has been
+             * seen is returned.
+             */
+            bool GetSnapshot(
+                std::string_view channel,
+                double now,
+                ChannelSnapshot& snapshot
+            ) const;
+
+            /**
+             * This method returns how much memory the analytics use.
+             *
+             * @return The memory used, in bytes, is returned.
+             */
+            size_t GetMemoryUsage() const;
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_CHAT_ANALYTICS_HPP */
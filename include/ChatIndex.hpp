@@ -0,0 +1,319 @@
+#ifndef TWITCH_BOT_CHAT_INDEX_HPP
+#define TWITCH_BOT_CHAT_INDEX_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LatencyHistogram.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This is a full-text index of chat, kept in memory, for finding who
+     * said what, and when, without looking through every message.
+     *
+     * Messages are fed in from the worker thread of a MessageManager, which
+     * only copies each one onto a queue of fixed size. A thread of the
+     * index's own takes whatever has been queued as one batch, splits each
+     * message into words, and adds the batch to the index as a new segment,
+     * after which its messages can be found.
+     *
+     * Each segment holds the messages it indexes and, for each word, a
+     * posting list: the messages in which the word appears and where in
+     * each one, as differences from the one before, stored as
+     * variable-length integers (7 bits per byte, low bits first). Each list
+     * has a skip entry every so many messages, so that a search can jump
+     * over the parts of a long list that can't match. The user and channel
+     * of each message are indexed as words of their own, so that searches
+     * limited to them only look at their messages.
+     *
+     * Segments never change once made. Another thread of the index's own
+     * merges runs of segments of about the same size into one, so that
+     * there are only ever a few dozen, and searches see the segments as
+     * they were when the search started. The same thread drops whole
+     * segments once they're older than the retention period, or, oldest
+     * first, while the index uses more memory than its budget.
+     *
+     * Words are runs of ASCII letters and digits, and of any characters
+     * outside of ASCII, with ASCII letters folded to lower case. Only the
+     * first 64 bytes of longer words count.
+     */
+    class ChatIndex
+    {
+        // Types
+        public:
+            /**
+             * These are the settings of the index.
+             */
+            struct Settings
+            {
+                /**
+                 * This is the most messages which may wait to be indexed.
+                 * Messages fed in while it's full are dropped, rather than
+                 * holding up the thread feeding them in.
+                 */
+                size_t queueCapacity = 1 << 16;
+
+                /**
+                 * This is the most messages indexed as one batch.
+                 */
+                size_t batchSize = 4096;
+
+                /**
+                 * This is the number of segments of about the same size
+                 * which are merged into one.
+                 */
+                size_t mergeFactor = 8;
+
+                /**
+                 * If not zero, this is how long, in seconds, messages are
+                 * kept. A segment is dropped once all of its messages were
+                 * sent this long before the latest message indexed.
+                 */
+                double retention = 0.0;
+
+                /**
+                 * If not zero, this is the most bytes the index may use.
+                 * While it uses more, its oldest segment is dropped, so
+                 * that merged segments may take many messages with them,
+                 * but the newest segment is always kept.
+                 */
+                size_t memoryBudget = 0;
+            };
+
+            /**
+             * This is what to look for.
+             */
+            struct Query
+            {
+                /**
+                 * These are the words to look for. Messages match if they
+                 * have all of the words, or, if phrase is set, have them
+                 * all next to each other, in order.
+                 */
+                std::string text;
+                bool phrase = false;
+
+                /**
+                 * If not empty, this is the only channel, without the
+                 * leading hash (#) character, to look in.
+                 */
+                std::string channel;
+
+                /**
+                 * If not zero, this is the user-id of the only user whose
+                 * messages to look at.
+                 */
+                uint64_t userId = 0;
+
+                /**
+                 * These are the start and end of the stretch of time to
+                 * look in, in seconds since the UNIX epoch.
+                 */
+                double since = 0.0;
+                double until = std::numeric_limits< double >::infinity();
+            };
+
+            /**
+             * This is one message found. The views are only valid during
+             * the call to the HitVisitor.
+             */
+            struct Hit
+            {
+                /**
+                 * This is when the message was sent, in seconds since the
+                 * UNIX epoch.
+                 */
+                double time = 0.0;
+
+                /**
+                 * This is the user-id of the user who sent the message, or
+                 * zero if there isn't one.
+                 */
+                uint64_t userId = 0;
+
+                /**
+                 * These are the channel of the message, without the leading
+                 * hash (#) character, the nickname of the user who sent it,
+                 * and its text.
+                 */
+                std::string_view channel;
+                std::string_view user;
+                std::string_view text;
+            };
+
+            /**
+             * This is the type of function called with each message found.
+             *
+             * @param[in] hit This is the message found.
+             *
+             * @return an indication of whether or not to keep looking is
+             * returned.
+             */
+            using HitVisitor = std::function<
+                bool(const Hit& hit)
+            >;
+
+            /**
+             * These are the measurements of the index.
+             */
+            struct Stats
+            {
+                /**
+                 * These are the number of messages fed in, indexed, and
+                 * dropped because the queue was full.
+                 */
+                uint64_t messagesAdded = 0;
+                uint64_t messagesIndexed = 0;
+                uint64_t messagesDropped = 0;
+
+                /**
+                 * These are the number of batches indexed, and the number
+                 * of merges of segments done.
+                 */
+                uint64_t batches = 0;
+                uint64_t merges = 0;
+
+                /**
+                 * This is the number of messages dropped from the index
+                 * for being older than the retention period, or to stay
+                 * within the memory budget.
+                 */
+                uint64_t messagesExpired = 0;
+
+                /**
+                 * This is the number of segments in the index now.
+                 */
+                size_t segments = 0;
+
+                /**
+                 * These are the number of bytes of posting lists, and of
+                 * all of the index, including the messages themselves.
+                 */
+                size_t postingBytes = 0;
+                size_t memoryUsage = 0;
+
+                /**
+                 * This summarizes how long, in nanoseconds, messages took
+                 * from being fed in to being found by searches.
+                 */
+                LatencyHistogram::Summary ingestLag;
+            };
+
+        // Lifecycle Management
+        public:
+            ~ChatIndex() noexcept;
+            ChatIndex(const ChatIndex& other) = delete;
+            ChatIndex(ChatIndex&&) noexcept = delete;
+            ChatIndex& operator=(const ChatIndex& other) = delete;
+            ChatIndex& operator=(ChatIndex&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs an empty index, using the default settings,
+             * and starts its threads.
+             */
+            ChatIndex();
+
+            /**
+             * This constructs an empty index and starts its threads.
+             *
+             * @param[in] settings These are the settings of the index.
+             */
+            explicit ChatIndex(const Settings& settings);
+
+            /**
+             * This method feeds a message received from the Twitch server
+             * to the index, if it's a PRIVMSG. It only copies the message
+             * onto the queue, and never waits. Its time is taken from its
+             * tmi-sent-ts tag, or the system clock if it has none. It may be
+             * called from any thread.
+             *
+             * @param[in] message This is the message to add.
+             *
+             * @return an indication of whether or not the message was
+             * queued (false if it's not a PRIVMSG, or the queue is full)
+             * is returned.
+             */
+            bool Add(const Message& message);
+
+            /**
+             * This method feeds a chat line to the index, given its parts.
+             * It may be called from any thread.
+             *
+             * @param[in] time This is when the line was sent, in seconds
+             * since the UNIX epoch.
+             *
+             * @param[in] userId This is the user-id of the user who sent
+             * the line, or zero if there isn't one.
+             *
+             * @param[in] channel This is the channel of the line, without
+             * the leading hash (#) character.
+             *
+             * @param[in] user This is the nickname of the user who sent the
+             * line.
+             *
+             * @param[in] text This is the text of the line.
+             *
+             * @return an indication of whether or not the line was queued
+             * (false if the queue is full) is returned.
+             */
+            bool Add(
+                double time,
+                uint64_t userId,
+                std::string_view channel,
+                std::string_view user,
+                std::string_view text
+            );
+
+            /**
+             * This method waits until every message fed in so far can be
+             * found.
+             */
+            void Flush();
+
+            /**
+             * This method looks for messages, oldest first.
+             *
+             * @param[in] query This is what to look for.
+             *
+             * @param[in] visitor This is the function to call with each
+             * message found.
+             *
+             * @return The number of messages found is returned.
+             */
+            size_t Search(
+                const Query& query,
+                HitVisitor visitor
+            ) const;
+
+            /**
+             * This method returns the measurements of the index.
+             *
+             * @return The measurements are returned.
+             */
+            Stats GetStats() const;
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_CHAT_INDEX_HPP */
@@ -0,0 +1,306 @@
+#ifndef TWITCH_BOT_CHAT_LOG_HPP
+#define TWITCH_BOT_CHAT_LOG_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LatencyHistogram.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This keeps an archive of the messages received from the Twitch
+     * server, on disk, so that chat can be looked over later, such as for
+     * moderation review.
+     *
+     * The archive is a directory of segment files of fixed size, each
+     * created ahead of time, filled with zeros and mapped into memory, so
+     * that adding a message is only copying it into memory. Each segment
+     * starts with a 64 byte header, and each message follows as a record:
+     * the length and a checksum of its body, 4 bytes each, and then the
+     * body, which is the time, the user-id as a variable-length integer (7
+     * bits per byte, low bits first), and the command, channel, nickname,
+     * message id and text, each as its length followed by its bytes. A
+     * length of zero marks the end of the records in a segment.
+     *
+     * A thread of the log's own writes what's been added out to disk every
+     * so often, all at once (group commit), keeps the next segment ready
+     * for when the current one fills, and saves the index of each segment
+     * as it fills, next to it.
+     *
+     * The records are indexed in blocks of a few dozen: by the time of the
+     * first record of each block, and by which blocks have records from
+     * each user. Finding the messages of a user, or of a stretch of time,
+     * only looks through the blocks which might have them.
+     *
+     * When the archive is opened, records torn by a crash, which are those
+     * whose checksum doesn't match, are cut off along with everything after
+     * them in their segment.
+     */
+    class ChatLog
+    {
+        // Types
+        public:
+            /**
+             * These are the settings of the log.
+             */
+            struct Settings
+            {
+                /**
+                 * This is the size of each segment file, in bytes.
+                 */
+                size_t segmentSize = 64 << 20;
+
+                /**
+                 * These are how often, in seconds, and after how many bytes
+                 * added, what's been added is written out to disk.
+                 */
+                double commitInterval = 0.05;
+                size_t commitBytes = 1 << 20;
+
+                /**
+                 * This is the number of records in each block of the
+                 * indexes.
+                 */
+                size_t recordsPerBlock = 64;
+            };
+
+            /**
+             * This is one message from the log. The views stay valid while
+             * the log is open.
+             */
+            struct Entry
+            {
+                /**
+                 * This is when the message was sent, in seconds since the
+                 * UNIX epoch.
+                 */
+                double time = 0.0;
+
+                /**
+                 * This is the user-id of the user who sent the message, or
+                 * zero if there isn't one.
+                 */
+                uint64_t userId = 0;
+
+                /**
+                 * These are the command of the message, its channel without
+                 * the leading hash (#) character, the nickname of the user
+                 * who sent it, its message id, and its last parameter, each
+                 * empty if the message doesn't have one.
+                 */
+                std::string_view command;
+                std::string_view channel;
+                std::string_view user;
+                std::string_view id;
+                std::string_view text;
+            };
+
+            /**
+             * This is the type of function called with each message found
+             * in the log.
+             *
+             * @param[in] entry This is the message found.
+             *
+             * @return an indication of whether or not to keep looking is
+             * returned.
+             */
+            using EntryVisitor = std::function<
+                bool(const Entry& entry)
+            >;
+
+            /**
+             * These are the measurements of the log since it was opened.
+             */
+            struct Stats
+            {
+                /**
+                 * These are the number of records added, and their size in
+                 * bytes, including record headers.
+                 */
+                uint64_t records = 0;
+                uint64_t bytes = 0;
+
+                /**
+                 * This is the number of segments in the archive.
+                 */
+                uint64_t segments = 0;
+
+                /**
+                 * This is the number of times what's been added was written
+                 * out to disk.
+                 */
+                uint64_t commits = 0;
+
+                /**
+                 * This is the number of times a record had to wait for a
+                 * new segment to be made, because the next one wasn't
+                 * ready yet.
+                 */
+                uint64_t segmentStalls = 0;
+
+                /**
+                 * These are the number of records found, and the number of
+                 * bytes cut off as torn, when the archive was opened.
+                 */
+                uint64_t recordsRecovered = 0;
+                uint64_t bytesTruncated = 0;
+
+                /**
+                 * This summarizes how long, in nanoseconds, each commit
+                 * took.
+                 */
+                LatencyHistogram::Summary commit;
+            };
+
+        // Lifecycle Management
+        public:
+            ~ChatLog() noexcept;
+            ChatLog(const ChatLog& other) = delete;
+            ChatLog(ChatLog&&) noexcept = delete;
+            ChatLog& operator=(const ChatLog& other) = delete;
+            ChatLog& operator=(ChatLog&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a log which isn't open, using the default
+             * settings.
+             */
+            ChatLog();
+
+            /**
+             * This constructs a log which isn't open.
+             *
+             * @param[in] settings These are the settings of the log.
+             */
+            explicit ChatLog(const Settings& settings);
+
+            /**
+             * This method opens the archive in the given directory,
+             * creating it if need be, recovering from any crash, and
+             * loading its indexes.
+             *
+             * @param[in] directory This is the path of the directory.
+             *
+             * @return an indication of whether or not the archive was
+             * opened is returned.
+             */
+            bool Open(const std::string& directory);
+
+            /**
+             * This method writes out everything added and closes the
+             * archive.
+             */
+            void Close();
+
+            /**
+             * This method adds a message received from the Twitch server to
+             * the log. Its time is taken from its tmi-sent-ts tag, or the
+             * system clock if it has none, but never before the time of the
+             * message added before it, so that times in the log never go
+             * backwards. It may be called from any thread.
+             *
+             * @param[in] message This is the message to add.
+             *
+             * @return an indication of whether or not the message was
+             * added is returned.
+             */
+            bool Append(const Message& message);
+
+            /**
+             * This method adds a message to the log, given its parts. It
+             * may be called from any thread.
+             *
+             * @param[in] entry This is the message to add. Its time is
+             * moved up to that of the message added before it, if it's
+             * earlier.
+             *
+             * @return an indication of whether or not the message was
+             * added is returned.
+             */
+            bool Append(const Entry& entry);
+
+            /**
+             * This method waits until everything added so far has been
+             * written out to disk.
+             *
+             * @return an indication of whether or not everything was
+             * written out is returned.
+             */
+            bool Flush();
+
+            /**
+             * This method looks through the messages sent during the given
+             * stretch of time, oldest first. Messages may be added while
+             * it's looking, and those added after it starts aren't seen.
+             *
+             * @param[in] since This is the start of the stretch of time, in
+             * seconds since the UNIX epoch.
+             *
+             * @param[in] until This is the end of the stretch of time, in
+             * seconds since the UNIX epoch.
+             *
+             * @param[in] visitor This is the function to call with each
+             * message found.
+             *
+             * @return The number of messages found is returned.
+             */
+            size_t Find(
+                double since,
+                double until,
+                EntryVisitor visitor
+            ) const;
+
+            /**
+             * This method looks through the messages sent by the given user
+             * during the given stretch of time, oldest first.
+             *
+             * @param[in] userId This is the user-id of the user.
+             *
+             * @param[in] since This is the start of the stretch of time, in
+             * seconds since the UNIX epoch.
+             *
+             * @param[in] until This is the end of the stretch of time, in
+             * seconds since the UNIX epoch.
+             *
+             * @param[in] visitor This is the function to call with each
+             * message found.
+             *
+             * @return The number of messages found is returned.
+             */
+            size_t FindByUser(
+                uint64_t userId,
+                double since,
+                double until,
+                EntryVisitor visitor
+            ) const;
+
+            /**
+             * This method returns the measurements of the log.
+             *
+             * @return The measurements are returned.
+             */
+            Stats GetStats() const;
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_CHAT_LOG_HPP */
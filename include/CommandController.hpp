@@ -0,0 +1,268 @@
+#ifndef TWITCH_BOT_COMMAND_CONTROLLER_HPP
+#define TWITCH_BOT_COMMAND_CONTROLLER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This is the most arguments split out of a command line. Any further
+     * text is left in the last argument.
+     */
+    constexpr size_t MAX_COMMAND_ARGUMENTS = 16;
+
+    /**
+     * This describes one use of a command found in a chat line. All text is
+     * viewed in place, in the chat line and in the controller, so it's only
+     * valid while both are.
+     */
+    struct CommandInvocation
+    {
+        /**
+         * This is the index of the command, in the order commands were
+         * registered.
+         */
+        size_t command = 0;
+
+        /**
+         * This is the name under which the command was registered, even if
+         * it was invoked by an alias.
+         */
+        std::string_view name;
+
+        /**
+         * This is the channel in which the command was used, if known.
+         */
+        std::string_view channel;
+
+        /**
+         * This is the user who used the command, if known.
+         */
+        std::string_view user;
+
+        /**
+         * This is all the text after the command name, without white space
+         * at either end.
+         */
+        std::string_view argumentText;
+
+        /**
+         * These are the arguments, split on white space.
+         */
+        std::string_view arguments[MAX_COMMAND_ARGUMENTS];
+
+        /**
+         * This is the number of arguments.
+         */
+        size_t argumentCount = 0;
+    };
+
+    /**
+     * This finds chat commands, such as "!uptime", in chat lines and calls
+     * the function registered for each.
+     *
+     * Commands and their aliases are registered at startup and then compiled
+     * into a perfect hash table: every name has a slot of its own, so
+     * looking one up takes one hash and one comparison, and never allocates.
+     * Lines which don't start with the command prefix are rejected after
+     * looking at a single character, and lines whose first word can't be a
+     * command name, by its length or first letter, right after that.
+     * Command names are matched without regard to case.
+     *
+     * Each command may have a cooldown, which is the least time between any
+     * two uses of it in the same channel, and a per-user cooldown, which is
+     * the least time between two uses of it by the same user in the same
+     * channel. Using a command in one channel doesn't hold it up in any
+     * other.
+     *
+     * Registering and compiling must be done before dispatching. Lookups
+     * may then be made from any number of threads, but dispatching, which
+     * keeps track of cooldowns, must be done from one thread at a time.
+     */
+    class CommandController
+    {
+        // Types
+        public:
+            /**
+             * This is the type of function called when a command is used.
+             *
+             * @param[in] invocation This describes the use of the command.
+             */
+            typedef std::function< void(const CommandInvocation& invocation) > Handler;
+
+            /**
+             * These are the possible outcomes of dispatching a chat line.
+             */
+            enum class DispatchResult
+            {
+                /**
+                 * The line isn't a registered command.
+                 */
+                NotCommand,
+
+                /**
+                 * The line is a command, but it was used too recently, so
+                 * its function wasn't called.
+                 */
+                CoolingDown,
+
+                /**
+                 * The line is a command, and its function was called.
+                 */
+                Dispatched
+            };
+
+        // Lifecycle Management
+        public:
+            ~CommandController() noexcept;
+            CommandController(const CommandController& other) = delete;
+            CommandController(CommandController&&) noexcept;
+            CommandController& operator=(const CommandController& other) = delete;
+            CommandController& operator=(CommandController&&) noexcept;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a controller with no commands.
+             *
+             * @param[in] prefix This is the character which starts every
+             * command.
+             */
+            explicit CommandController(char prefix = '!');
+
+            /**
+             * This method registers a command. It may only be called before
+             * Compile.
+             *
+             * @param[in] name This is the name of the command, without the
+             * prefix.
+             *
+             * @param[in] handler This is the function to call when the
+             * command is used.
+             *
+             * @param[in] cooldown This is the least time, in seconds, between
+             * any two uses of the command in the same channel.
+             *
+             * @param[in] userCooldown This is the least time, in seconds,
+             * between two uses of the command by the same user in the same
+             * channel.
+             *
+             * @return an indication of whether or not the command was
+             * registered (false if the name is empty, contains white space,
+             * is already taken, or the controller is compiled) is returned.
+             */
+            bool Register(
+                const std::string& name,
+                Handler handler,
+                double cooldown = 0.0,
+                double userCooldown = 0.0
+            );
+
+            /**
+             * This method adds another name for a registered command. It may
+             * only be called before Compile.
+             *
+             * @param[in] alias This is the other name, without the prefix.
+             *
+             * @param[in] name This is the name of the command.
+             *
+             * @return an indication of whether or not the alias was added is
+             * returned.
+             */
+            bool AddAlias(
+                const std::string& alias,
+                const std::string& name
+            );
+
+            /**
+             * This method builds the lookup table from the registered
+             * commands and aliases. After this, no more may be registered.
+             */
+            void Compile();
+
+            /**
+             * This method finds the command used in a chat line, if any.
+             * It doesn't allocate memory.
+             *
+             * @param[in] text This is the text of the chat line.
+             *
+             * @param[out] invocation This is where to store the command found
+             * and its arguments. The channel and user are left alone.
+             *
+             * @return an indication of whether or not the line uses a
+             * registered command is returned.
+             */
+            bool Lookup(
+                std::string_view text,
+                CommandInvocation& invocation
+            ) const;
+
+            /**
+             * This method finds the command used in a chat line, if any, and
+             * unless the command is cooling down, calls its function.
+             *
+             * @param[in] channel This is the channel of the chat line, for
+             * cooldowns.
+             *
+             * @param[in] user This identifies the user who sent the chat
+             * line, for per-user cooldowns.
+             *
+             * @param[in] text This is the text of the chat line.
+             *
+             * @param[in] now This is the current time, in seconds.
+             *
+             * @return The outcome is returned.
+             */
+            DispatchResult Dispatch(
+                std::string_view channel,
+                std::string_view user,
+                std::string_view text,
+                double now
+            );
+
+            /**
+             * This method dispatches a message received from the Twitch
+             * server, if it's a PRIVMSG. Users are identified by their
+             * user-id tag if there is one, and by nickname otherwise.
+             *
+             * @param[in] message This is the message received.
+             *
+             * @param[in] now This is the current time, in seconds.
+             *
+             * @return The outcome is returned.
+             */
+            DispatchResult Dispatch(
+                const Message& message,
+                double now
+            );
+
+            /**
+             * This method returns the number of commands registered.
+             *
+             * @return The number of commands registered is returned.
+             */
+            size_t GetCommandCount() const;
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_COMMAND_CONTROLLER_HPP */
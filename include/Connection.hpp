@@ -1,3 +1,6 @@
+#ifndef TWITCH_BOT_CONNECTION_HPP
+#define TWITCH_BOT_CONNECTION_HPP
+
 #include <string>
 #include <vector>
 #include <memory>
@@ -12,7 +15,10 @@ namespace TwitchBot
      */
     class Connection
     {
-        
+        // Lifecycle Management
+        public:
+            virtual ~Connection() noexcept = default;
+
         public:
 
             //Types
@@ -74,7 +80,8 @@ namespace TwitchBot
             /**
              * This method queues the given message to be sent to the Twitch
              * server. This is an asynchronous call; the message may or may not
-             * be sent before the method returns
+             * be sent before the method returns. It may be called from any
+             * thread, including from within the message received delegate.
              *
              * @param[in] message This is the text to send to the Twitch server
              */
@@ -83,9 +90,14 @@ namespace TwitchBot
             /**
              * Trims the front and back white space in a string.
              *
-             *@param[in] exampleString the string to trim
+             * @param[in] exampleString the string to trim
+             *
+             * @return The string, without white space at either end, is
+             * returned.
              */
-            void TrimWhiteSpaceFrontBack(const std::string exampleString) = 0;
+            static std::string TrimWhiteSpaceFrontBack(const std::string& exampleString);
 
     };
-}
\ No newline at end of file
+}
+
+#endif /* TWITCH_BOT_CONNECTION_HPP */
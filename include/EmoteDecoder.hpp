@@ -0,0 +1,132 @@
+#ifndef TWITCH_BOT_EMOTE_DECODER_HPP
+#define TWITCH_BOT_EMOTE_DECODER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string_view>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This is one use of an emote in the text of a chat line.
+     */
+    struct EmoteSpan
+    {
+        /**
+         * This is the id of the emote, as a view into the emotes tag.
+         */
+        std::string_view id;
+
+        /**
+         * These are the byte offsets into the text of the line of the
+         * first character of the emote and of the character after its
+         * last.
+         */
+        uint32_t begin = 0;
+        uint32_t end = 0;
+    };
+
+    /**
+     * This turns the emotes tag of a chat line, in the form
+     * "id:first-last,first-last/id:first-last", into the spans of the
+     * line's text which each emote covers.
+     *
+     * The tag counts characters (code points) of the text, while the
+     * spans are in bytes, so they can be cut straight out of the text. If
+     * the text is all ASCII, which is checked 16 bytes at a time, the two
+     * are the same. Otherwise the offset of each character is found in one
+     * pass over the text, again 16 bytes at a time, and each range looked
+     * up from those.
+     *
+     * The spans are given in the order of the tag, so all the uses of each
+     * emote are next to each other. They refer to the tag and text given,
+     * and the decoder keeps its storage from one line to the next, so once
+     * it has seen a line with as many emotes and characters, decoding
+     * another doesn't allocate memory.
+     */
+    class EmoteDecoder
+    {
+        // Lifecycle Management
+        public:
+            ~EmoteDecoder() noexcept;
+            EmoteDecoder(const EmoteDecoder& other) = delete;
+            EmoteDecoder(EmoteDecoder&&) noexcept;
+            EmoteDecoder& operator=(const EmoteDecoder& other) = delete;
+            EmoteDecoder& operator=(EmoteDecoder&&) noexcept;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * Default constructor
+             */
+            EmoteDecoder();
+
+            /**
+             * This method decodes the emotes tag of a chat line.
+             *
+             * Ranges which go past the end of the text, or end before they
+             * start, are left out. If the tag is malformed, the spans
+             * decoded before the mistake are kept.
+             *
+             * @param[in] emotes This is the emotes tag of the line.
+             *
+             * @param[in] text This is the text of the line.
+             *
+             * @return an indication of whether or not the whole tag was
+             * well-formed is returned.
+             */
+            bool Decode(
+                std::string_view emotes,
+                std::string_view text
+            );
+
+            /**
+             * This method decodes the emotes tag of a message received from
+             * the Twitch server, taking the text from its last parameter.
+             * Messages without parameters have no spans.
+             *
+             * @param[in] message This is the message to decode.
+             *
+             * @return an indication of whether or not the whole tag was
+             * well-formed is returned.
+             */
+            bool Decode(const Message& message);
+
+            /**
+             * This method returns the spans of the last line decoded. They
+             * stay valid until the next call to Decode, and as long as the
+             * tag and text decoded do.
+             *
+             * @return The spans are returned.
+             */
+            const std::vector< EmoteSpan >& GetSpans() const;
+
+        private:
+            /**
+             * This method finds the byte offset of every character of the
+             * given text, unless it's all ASCII.
+             *
+             * @param[in] text This is the text to look through.
+             *
+             * @return an indication of whether or not the text is all ASCII
+             * (so characters are bytes) is returned.
+             */
+            bool FindCharacters(std::string_view text);
+
+            /**
+             * These are the spans of the last line decoded.
+             */
+            std::vector< EmoteSpan > spans_;
+
+            /**
+             * These are the byte offsets of the characters of the last
+             * line decoded which wasn't all ASCII, followed by its length.
+             */
+            std::vector< uint32_t > characters_;
+    };
+}
+
+#endif /* TWITCH_BOT_EMOTE_DECODER_HPP */
@@ -0,0 +1,171 @@
+#ifndef TWITCH_BOT_EXECUTOR_HPP
+#define TWITCH_BOT_EXECUTOR_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+
+namespace TwitchBot
+{
+    /**
+     * This is a pool of threads which run tasks handed to it, so that slow
+     * work, such as user handlers of chat messages, doesn't hold up the
+     * thread which posted it.
+     *
+     * Each thread has its own queue of tasks. Tasks posted from outside the
+     * pool are spread over the queues in turn, and tasks posted from one of
+     * the pool's threads go on that thread's own queue. A thread with
+     * nothing left to do takes tasks from the other end of another thread's
+     * queue, so no thread sits idle while another is backed up.
+     *
+     * Tasks posted directly to the pool may run in any order, and at the
+     * same time as each other. Tasks which must run one at a time, in the
+     * order posted, such as the handling of messages in one chat channel,
+     * are posted to a strand instead.
+     *
+     * When the pool is destroyed, it runs every task already posted before
+     * its threads stop. Tasks posted after that are dropped.
+     */
+    class Executor
+    {
+        // Types
+        public:
+            /**
+             * This is the type of work which the pool runs.
+             */
+            typedef std::function< void() > Task;
+
+            /**
+             * This runs tasks on the pool one at a time, in the order they
+             * were posted, though not always on the same thread. Strands are
+             * cheap, so there may be one for each chat channel. Copies of a
+             * strand are the same strand.
+             */
+            class Strand
+            {
+                // Beginning of Public Methods
+                public:
+                    /**
+                     * This method hands a task to the strand. It may be
+                     * called from any thread.
+                     *
+                     * @param[in] task This is the task to run.
+                     */
+                    void Post(Task task);
+
+                    /**
+                     * This method returns an indication of whether or not
+                     * the strand belongs to a pool.
+                     *
+                     * @return an indication of whether or not the strand
+                     * belongs to a pool is returned.
+                     */
+                    bool IsValid() const;
+
+                private:
+                    friend class Executor;
+
+                    /**
+                     * A struct that contains the state shared by copies of
+                     * the strand, and by the pool while the strand has
+                     * tasks waiting. This is defined within the
+                     * implementation.
+                     */
+                    struct State;
+
+                    /**
+                     * This contains the state of the strand.
+                     */
+                    std::shared_ptr< State > state_;
+            };
+
+            /**
+             * This contains measurements of the pool.
+             */
+            struct Stats
+            {
+                /**
+                 * This is the number of tasks run, counting each task run by
+                 * a strand.
+                 */
+                uint64_t tasksRun = 0;
+
+                /**
+                 * This is the number of tasks which a thread took from
+                 * another thread's queue.
+                 */
+                uint64_t steals = 0;
+
+                /**
+                 * This is the number of tasks waiting to run, not counting
+                 * those waiting in strands.
+                 */
+                size_t queued = 0;
+            };
+
+        // Lifecycle Management
+        public:
+            ~Executor() noexcept;
+            Executor(const Executor& other) = delete;
+            Executor(Executor&&) noexcept = delete;
+            Executor& operator=(const Executor& other) = delete;
+            Executor& operator=(Executor&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs the pool and starts its threads.
+             *
+             * @param[in] threadCount This is the number of threads. If it's
+             * zero, there is one for each processor.
+             */
+            explicit Executor(size_t threadCount = 0);
+
+            /**
+             * This method hands a task to the pool. It may be called from
+             * any thread.
+             *
+             * @param[in] task This is the task to run.
+             */
+            void Post(Task task);
+
+            /**
+             * This method makes a new strand which runs its tasks on the
+             * pool.
+             *
+             * @return The new strand is returned.
+             */
+            Strand MakeStrand();
+
+            /**
+             * This method returns the number of threads in the pool.
+             *
+             * @return The number of threads in the pool is returned.
+             */
+            size_t GetThreadCount() const;
+
+            /**
+             * This method returns measurements of the pool.
+             *
+             * @return The measurements of the pool are returned.
+             */
+            Stats GetStats() const;
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance. It's
+             * shared with the strands, which may outlive the pool.
+             */
+            std::shared_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_EXECUTOR_HPP */
@@ -0,0 +1,109 @@
+#ifndef TWITCH_BOT_HASHING_HPP
+#define TWITCH_BOT_HASHING_HPP
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+/**
+ * These are the hashing helpers shared by the library's modules. They are
+ * internal to the library, and their results are the same on every platform
+ * and in every run, unlike std::hash, but aren't promised to stay the same
+ * from one version of the library to the next, so they must not be stored.
+ */
+namespace TwitchBot
+{
+    /**
+     * This returns the given character in lower case, if it's an ASCII
+     * letter.
+     *
+     * @param[in] c This is the character to fold.
+     *
+     * @return The character in lower case is returned.
+     */
+    inline char FoldCase(char c)
+    {
+        return ((c >= 'A') && (c <= 'Z')) ? (char)(c + ('a' - 'A')) : c;
+    }
+
+    /**
+     * This returns a copy of the given text with its ASCII letters in lower
+     * case.
+     *
+     * @param[in] text This is the text to fold.
+     *
+     * @return The text in lower case is returned.
+     */
+    inline std::string FoldCase(std::string_view text)
+    {
+        std::string folded(text);
+        for (auto& c: folded)
+        {
+            c = FoldCase(c);
+        }
+        return folded;
+    }
+
+    /**
+     * This scrambles the bits of a number, so that numbers which differ in
+     * only a few bits give unrelated results.
+     *
+     * @param[in] x This is the number to scramble.
+     *
+     * @return The scrambled number is returned.
+     */
+    inline uint64_t Mix(uint64_t x)
+    {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EB;
+        x ^= x >> 31;
+        return x;
+    }
+
+    /**
+     * This computes a hash of some text, as is.
+     *
+     * @param[in] text This is the text to hash.
+     *
+     * @param[in] seed This is mixed into the hash, to give a different
+     * hash function for each seed.
+     *
+     * @return The hash of the text is returned.
+     */
+    inline uint64_t HashText(std::string_view text, uint64_t seed = 0)
+    {
+        uint64_t hash = seed ^ 0xCBF29CE484222325;
+        for (const auto c: text)
+        {
+            hash ^= (uint8_t)c;
+            hash *= 0x100000001B3;
+        }
+        return Mix(hash);
+    }
+
+    /**
+     * This computes a hash of some text, without regard to case, so that
+     * text differing only in the case of ASCII letters hashes the same.
+     *
+     * @param[in] text This is the text to hash.
+     *
+     * @param[in] seed This is mixed into the hash, to give a different
+     * hash function for each seed.
+     *
+     * @return The hash of the text is returned.
+     */
+    inline uint64_t HashTextFoldingCase(std::string_view text, uint64_t seed = 0)
+    {
+        uint64_t hash = seed ^ 0xCBF29CE484222325;
+        for (const auto c: text)
+        {
+            hash ^= (uint8_t)FoldCase(c);
+            hash *= 0x100000001B3;
+        }
+        return Mix(hash);
+    }
+}
+
+#endif /* TWITCH_BOT_HASHING_HPP */
@@ -0,0 +1,130 @@
+#ifndef TWITCH_BOT_KEEP_ALIVE_SCANNER_HPP
+#define TWITCH_BOT_KEEP_ALIVE_SCANNER_HPP
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+
+namespace TwitchBot
+{
+    /**
+     * This class picks out the keepalive messages (PING and PONG) from the
+     * raw text received from the Twitch server, as it arrives, so that they
+     * can be handled right away rather than waiting their turn behind
+     * everything else received before them.
+     *
+     * Only lines without tags are looked at closely, which is how the
+     * server sends keepalive messages; lines with tags are skipped after
+     * finding where they end. Lines split across chunks are put back
+     * together, but only the start of a line which might be a keepalive
+     * message is kept between chunks.
+     */
+    class KeepAliveScanner
+    {
+        // Types
+        public:
+            /**
+             * These are the kinds of keepalive message.
+             */
+            enum class Kind
+            {
+                /**
+                 * The server is checking that the agent is still there, and
+                 * expects a PONG with the same parameter.
+                 */
+                Ping,
+
+                /**
+                 * The server is answering a PING sent by the agent.
+                 */
+                Pong
+            };
+
+        // Lifecycle Management
+        public:
+            ~KeepAliveScanner() noexcept;
+            KeepAliveScanner(const KeepAliveScanner& other) = delete;
+            KeepAliveScanner(KeepAliveScanner&&) noexcept;
+            KeepAliveScanner& operator=(const KeepAliveScanner& other) = delete;
+            KeepAliveScanner& operator=(KeepAliveScanner&&) noexcept;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * Default constructor
+             */
+            KeepAliveScanner();
+
+            /**
+             * This method starts looking through the next chunk of text
+             * received from the Twitch server. The text must stay valid
+             * until NextKeepAlive returns false.
+             *
+             * @param[in] text This is the text received.
+             */
+            void Scan(std::string_view text);
+
+            /**
+             * This method finds the next keepalive message in the text
+             * being scanned.
+             *
+             * @param[out] kind This is where to store the kind of message.
+             *
+             * @param[out] parameter This is where to store the last
+             * parameter of the message, or an empty view if it has none.
+             * The view stays valid until the next call to Scan or
+             * NextKeepAlive.
+             *
+             * @return an indication of whether or not another keepalive
+             * message was found is returned.
+             */
+            bool NextKeepAlive(Kind& kind, std::string_view& parameter);
+
+        private:
+            /**
+             * This method checks whether the given complete line, without
+             * its line feed, is a keepalive message.
+             *
+             * @param[in] line This is the line to check.
+             *
+             * @param[out] kind This is where to store the kind of message.
+             *
+             * @param[out] parameter This is where to store the last
+             * parameter of the message.
+             *
+             * @return an indication of whether or not the line is a
+             * keepalive message is returned.
+             */
+            static bool Match(
+                std::string_view line,
+                Kind& kind,
+                std::string_view& parameter
+            );
+
+            /**
+             * This is the part of the chunk not yet scanned.
+             */
+            std::string_view text_;
+
+            /**
+             * This holds the start of a line, from an earlier chunk, which
+             * might be a keepalive message, and then the whole line once
+             * the rest of it arrives.
+             */
+            std::string partial_;
+
+            /**
+             * This indicates whether or not partial_ holds a whole line,
+             * which is thrown away by the next call to NextKeepAlive.
+             */
+            bool partialComplete_ = false;
+
+            /**
+             * This indicates whether or not the rest of the current line,
+             * up to its line feed, is known not to be a keepalive message.
+             */
+            bool skipping_ = false;
+    };
+}
+
+#endif /* TWITCH_BOT_KEEP_ALIVE_SCANNER_HPP */
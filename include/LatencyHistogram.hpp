@@ -0,0 +1,160 @@
+#ifndef TWITCH_BOT_LATENCY_HISTOGRAM_HPP
+#define TWITCH_BOT_LATENCY_HISTOGRAM_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace TwitchBot
+{
+    /**
+     * This counts how many times each duration was seen, to a precision of
+     * one part in sixteen, in fixed memory and without locking, so that it
+     * can be left on all the time.
+     *
+     * Durations are kept in buckets which are linear within each power of
+     * two: durations under 16 ns each get their own bucket, and each power
+     * of two from there up is split into 16 equal buckets. Durations of 2^36
+     * ns (about 69 seconds) or more all share the last bucket.
+     *
+     * Any number of threads may record at once, and the counts may be read
+     * while they do. A reading taken while durations are being recorded may
+     * be off by the durations recorded during the reading.
+     */
+    class LatencyHistogram
+    {
+        // Types
+        public:
+            /**
+             * This summarizes the durations recorded. All durations are in
+             * nanoseconds. Percentiles are the upper bound of the bucket in
+             * which they fall, but never more than the longest duration.
+             */
+            struct Summary
+            {
+                uint64_t count = 0;
+                uint64_t sum = 0;
+                uint64_t max = 0;
+                uint64_t p50 = 0;
+                uint64_t p90 = 0;
+                uint64_t p99 = 0;
+                uint64_t p999 = 0;
+            };
+
+            /**
+             * This is the number of bits of each duration kept, below its
+             * highest set bit.
+             */
+            static constexpr unsigned int SUB_BUCKET_BITS = 4;
+
+            /**
+             * This is the number of bits in the longest duration told apart
+             * from the others.
+             */
+            static constexpr unsigned int MAX_DURATION_BITS = 36;
+
+            /**
+             * This is the number of buckets.
+             */
+            static constexpr size_t BUCKET_COUNT = (
+                (MAX_DURATION_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS
+            );
+
+        // Lifecycle Management
+        public:
+            ~LatencyHistogram() noexcept;
+            LatencyHistogram(const LatencyHistogram& other) = delete;
+            LatencyHistogram(LatencyHistogram&&) noexcept = delete;
+            LatencyHistogram& operator=(const LatencyHistogram& other) = delete;
+            LatencyHistogram& operator=(LatencyHistogram&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * Default constructor
+             */
+            LatencyHistogram();
+
+            /**
+             * This method counts one duration.
+             *
+             * @param[in] nanoseconds This is the duration.
+             */
+            void Record(uint64_t nanoseconds);
+
+            /**
+             * This method summarizes the durations recorded.
+             *
+             * @return The summary is returned.
+             */
+            Summary GetSummary() const;
+
+            /**
+             * This method returns the number of durations recorded which were
+             * shorter than the given duration. It's exact when the given
+             * duration is a power of two, since buckets never straddle one.
+             *
+             * @param[in] nanoseconds This is the duration to compare with.
+             *
+             * @return The number of shorter durations is returned.
+             */
+            uint64_t GetCountBelow(uint64_t nanoseconds) const;
+
+            /**
+             * This method returns the number of durations recorded.
+             *
+             * @return The number of durations recorded is returned.
+             */
+            uint64_t GetCount() const;
+
+            /**
+             * This method returns the total of the durations recorded.
+             *
+             * @return The total of the durations recorded, in nanoseconds,
+             * is returned.
+             */
+            uint64_t GetSum() const;
+
+            /**
+             * This method forgets all the durations recorded.
+             */
+            void Clear();
+
+            /**
+             * This method returns the bucket in which the given duration is
+             * counted.
+             *
+             * @param[in] nanoseconds This is the duration.
+             *
+             * @return The index of the bucket is returned.
+             */
+            static size_t GetBucket(uint64_t nanoseconds);
+
+            /**
+             * This method returns the shortest duration counted in the given
+             * bucket.
+             *
+             * @param[in] bucket This is the index of the bucket.
+             *
+             * @return The shortest duration of the bucket, in nanoseconds, is
+             * returned.
+             */
+            static uint64_t GetBucketStart(size_t bucket);
+
+        private:
+            /**
+             * These are the number of durations counted in each bucket.
+             */
+            std::atomic< uint64_t > buckets_[BUCKET_COUNT];
+
+            /**
+             * These are the total and longest of the durations recorded. The
+             * number of durations isn't kept apart from the buckets, to keep
+             * recording cheap.
+             */
+            std::atomic< uint64_t > sum_{0};
+            std::atomic< uint64_t > max_{0};
+    };
+}
+
+#endif /* TWITCH_BOT_LATENCY_HISTOGRAM_HPP */
@@ -0,0 +1,111 @@
+#ifndef TWITCH_BOT_LINE_FRAMER_HPP
+#define TWITCH_BOT_LINE_FRAMER_HPP
+
+#include <stddef.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace TwitchBot
+{
+    /**
+     * This class buffers the raw text received from the Twitch server and
+     * splits it into complete lines, each terminated by a CRLF.
+     *
+     * Lines are handed out as views into the buffer instead of copies. The
+     * buffer is only compacted when appending new data would otherwise have
+     * to grow it, so extracting many lines received in one chunk costs a
+     * single scan over the data.
+     */
+    class LineFramer
+    {
+        // Lifecycle Management
+        public:
+            ~LineFramer() noexcept;
+            LineFramer(const LineFramer& other) = delete;
+            LineFramer(LineFramer&&) noexcept;
+            LineFramer& operator=(const LineFramer& other) = delete;
+            LineFramer& operator=(LineFramer&&) noexcept;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * Default constructor
+             */
+            LineFramer();
+
+            /**
+             * This method adds text received from the Twitch server to the
+             * end of the buffer.
+             *
+             * Any line views previously returned by NextLine are invalidated.
+             *
+             * @param[in] data This points to the text received.
+             *
+             * @param[in] length This is the number of characters received.
+             */
+            void Append(const char* data, size_t length);
+
+            /**
+             * This method adds text received from the Twitch server to the
+             * end of the buffer.
+             *
+             * Any line views previously returned by NextLine are invalidated.
+             *
+             * @param[in] data This is the text received.
+             */
+            void Append(const std::string& data);
+
+            /**
+             * This method extracts the next complete line from the buffer.
+             *
+             * @param[out] line This is where to store a view of the next line,
+             * without its CRLF. The view stays valid until the next call to
+             * Append or Clear.
+             *
+             * @return an indication of whether or not a complete line was
+             * extracted is returned.
+             */
+            bool NextLine(std::string_view& line);
+
+            /**
+             * This method returns the number of characters received which
+             * have not yet been extracted as part of a complete line.
+             *
+             * @return The number of characters still buffered.
+             */
+            size_t GetBufferedLength() const;
+
+            /**
+             * This method discards everything in the buffer.
+             */
+            void Clear();
+
+        private:
+            /**
+             * This holds the received characters. Only the range from begin_
+             * to end_ is meaningful.
+             */
+            std::vector< char > buffer_;
+
+            /**
+             * This is the offset of the first character not yet extracted as
+             * part of a line.
+             */
+            size_t begin_ = 0;
+
+            /**
+             * This is the offset just past the last character received.
+             */
+            size_t end_ = 0;
+
+            /**
+             * This is the offset up to which the buffer has already been
+             * searched for a line terminator, so that partial lines are not
+             * searched again each time more data arrives.
+             */
+            size_t scanned_ = 0;
+    };
+}
+
+#endif /* TWITCH_BOT_LINE_FRAMER_HPP */
@@ -0,0 +1,145 @@
+#ifndef TWITCH_BOT_LOOPBACK_SERVER_HPP
+#define TWITCH_BOT_LOOPBACK_SERVER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace TwitchBot
+{
+    /**
+     * This is a small stand-in for the Twitch IRC server, listening on the
+     * loopback interface, so that connections can be exercised on a machine
+     * with no network.
+     *
+     * It answers just enough of the protocol for a client to log in and
+     * keep a session going: NICK is answered with the welcome numerics and
+     * the end of the MOTD, PING with PONG, CAP REQ with an ACK, and JOIN and
+     * PART are echoed back. QUIT closes the client's connection. Every line
+     * received from any client is also handed to a delegate, and arbitrary
+     * text can be sent to all clients, or to those in a channel, to play the
+     * part of chat traffic.
+     *
+     * The server runs on a thread of its own, which also calls the delegate.
+     */
+    class LoopbackServer
+    {
+        // Types
+        public:
+            /**
+             * This is the type of function to call for each line received
+             * from a client.
+             *
+             * @param[in] line This is the line received, without its CRLF.
+             */
+            typedef std::function< void(const std::string& line) > LineReceivedDelegate;
+
+        // Lifecycle Management
+        public:
+            ~LoopbackServer() noexcept;
+            LoopbackServer(const LoopbackServer& other) = delete;
+            LoopbackServer(LoopbackServer&&) noexcept = delete;
+            LoopbackServer& operator=(const LoopbackServer& other) = delete;
+            LoopbackServer& operator=(LoopbackServer&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a server which isn't listening yet.
+             */
+            LoopbackServer();
+
+            /**
+             * This method sets up a function to call for each line received
+             * from a client. It must be called before Start.
+             *
+             * @param[in] lineReceivedDelegate This is the function to call.
+             */
+            void SetLineReceivedDelegate(LineReceivedDelegate lineReceivedDelegate);
+
+            /**
+             * This method starts listening for clients.
+             *
+             * @param[in] port This is the TCP port on which to listen, or
+             * zero to have one picked.
+             *
+             * @return an indication of whether or not the server started is
+             * returned.
+             */
+            bool Start(uint16_t port = 0);
+
+            /**
+             * This method stops the server, closing all client connections.
+             */
+            void Stop();
+
+            /**
+             * This method returns the TCP port on which the server listens.
+             *
+             * @return The port is returned, or zero if not started.
+             */
+            uint16_t GetPort() const;
+
+            /**
+             * This method sends the given text, as is, to every client.
+             *
+             * @param[in] text This is the text to send, including any CRLF.
+             */
+            void Broadcast(const std::string& text);
+
+            /**
+             * This method sends the given text, as is, to every client which
+             * has joined the given channel, the way the Twitch server only
+             * sends a channel's chat, and its RECONNECT notices, to the
+             * connections in the channel. Text sent this way and with
+             * Broadcast at about the same time may not keep its order.
+             *
+             * @param[in] channel This is the name of the channel, without
+             * its '#'.
+             *
+             * @param[in] text This is the text to send, including any CRLF.
+             */
+            void SendToChannel(
+                const std::string& channel,
+                const std::string& text
+            );
+
+            /**
+             * This method closes the connections to all clients, as if the
+             * server had dropped them.
+             */
+            void DisconnectClients();
+
+            /**
+             * This method returns the number of clients connected.
+             *
+             * @return The number of clients connected is returned.
+             */
+            size_t GetClientCount() const;
+
+            /**
+             * This method returns the number of lines received from all
+             * clients since the server started.
+             *
+             * @return The number of lines received is returned.
+             */
+            uint64_t GetLinesReceived() const;
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_LOOPBACK_SERVER_HPP */
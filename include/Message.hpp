@@ -0,0 +1,150 @@
+#ifndef TWITCH_BOT_MESSAGE_HPP
+#define TWITCH_BOT_MESSAGE_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageTags.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SymbolTable.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * These are the commands which the Twitch server sends, and which can be
+     * told apart without comparing command strings. Numeric replies are
+     * named after their names in RFC 1459 (for example, EndOfMotd is "376").
+     */
+    enum class KnownCommand
+    {
+        Welcome,
+        YourHost,
+        Created,
+        MyInfo,
+        NamesReply,
+        EndOfNames,
+        Motd,
+        MotdStart,
+        EndOfMotd,
+        UnknownCommand,
+        Cap,
+        ClearChat,
+        ClearMsg,
+        GlobalUserState,
+        HostTarget,
+        Join,
+        Notice,
+        Part,
+        Ping,
+        Pong,
+        Privmsg,
+        Reconnect,
+        RoomState,
+        UserNotice,
+        UserState,
+        Whisper,
+
+        /**
+         * This is any other command, including none at all.
+         */
+        Other
+    };
+
+    /**
+     * This function returns which known command is the given command.
+     *
+     * @param[in] command This is the command portion of a message.
+     *
+     * @return The known command is returned, or KnownCommand::Other if it
+     * isn't one of the known commands.
+     */
+    KnownCommand FindKnownCommand(std::string_view command);
+
+    /**
+     * This contains all the information parsed from a single message from the
+     * Twitch server.
+     *
+     * Its tags are split up the first time they are looked up, so a message
+     * must not be read from more than one thread at a time (see
+     * MessageTags).
+     */
+    struct Message
+    {
+        /**
+         * These are the IRCv3 message tags (if any), provided ahead of the
+         * prefix.
+         */
+        MessageTags tags;
+
+        /**
+         * If this is not an empty string, the message included is a prefix
+         * which is stored here without the leading colon (:) character.
+         */
+        std::string prefix;
+
+        /**
+         * This is the command portion of the message, which may be a 3 digit
+         * code, or an IRC command.
+         *
+         * If it's empty, the message was invalid or there was no message.
+         */
+        std::string command;
+
+        /**
+         * This is the command portion of the message again, when it's one of
+         * the known commands, so that it can be checked without comparing
+         * strings.
+         */
+        KnownCommand knownCommand = KnownCommand::Other;
+
+        /**
+         * These are the parameters(If any), provided within the message.
+         */
+        std::vector< std::string > parameters;
+
+        /**
+         * If the first parameter names a channel (such as "#name"), this is
+         * the symbol of the channel name, without the leading hash (#)
+         * character. Otherwise, it's SymbolTable::NO_SYMBOL.
+         */
+        SymbolTable::Symbol channelSymbol = SymbolTable::NO_SYMBOL;
+
+        /**
+         * If the prefix names a user (such as "name!name@name.tmi.twitch.tv"),
+         * this is the symbol of the user's login name, if the name is
+         * already in the manager's SymbolTable. Senders aren't added to the
+         * table, so otherwise, it's SymbolTable::NO_SYMBOL.
+         */
+        SymbolTable::Symbol userSymbol = SymbolTable::NO_SYMBOL;
+
+        /**
+         * This method returns which known command the message has. Messages
+         * made without the MessageManager may not have their known command
+         * filled in, so it's found from the command in that case.
+         *
+         * @return The known command is returned, or KnownCommand::Other if
+         * the command isn't one of the known commands.
+         */
+        KnownCommand GetKnownCommand() const;
+
+        /**
+         * This method returns the name of the channel named by the first
+         * parameter, without the leading hash (#) character.
+         *
+         * @return The name of the channel is returned, or an empty string
+         * if there are no parameters.
+         */
+        std::string_view GetChannelName() const;
+
+        /**
+         * This method returns the nickname of the user in the prefix (the
+         * part before the exclamation mark (!), or the whole prefix if it
+         * has none).
+         *
+         * @return The nickname is returned.
+         */
+        std::string_view GetNickname() const;
+    };
+}
+
+#endif /* TWITCH_BOT_MESSAGE_HPP */
@@ -1,13 +1,27 @@
+#ifndef TWITCH_BOT_MESSAGE_MANAGER_HPP
+#define TWITCH_BOT_MESSAGE_MANAGER_HPP
+
 #include <string>
 #include <vector>
 #include <functional>
 #include <memory>
+#include <optional>
 
 #include </home/criogenesis/Downloads/TwitchCppBot/include/Connection.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LatencyHistogram.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/OutboundScheduler.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SymbolTable.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Task.hpp>
 #include </home/criogenesis/Downloads/TwitchCppBot/include/TimeKeeper.hpp>
 
 namespace TwitchBot
 {
+    class ChatAnalytics;
+    class ChatIndex;
+    class ChatLog;
+    class Executor;
+
     /**
      * This class represents a MessageManager agent that connects to the chat,
      * sends messages to the chat, and reads the user input from the chat.
@@ -36,6 +50,299 @@ namespace TwitchBot
              */
             typedef std::function < void() > LoggedOutDelegate;
 
+            /**
+             * @brief This is the type of function used to hand the user each
+             * message received from the Twitch server. It's called from the
+             * worker thread, in the order the messages were received, or, if
+             * an executor is provided, from the executor's threads, in the
+             * order the messages of each channel were received.
+             */
+            typedef std::function < void(const Message& message) > MessageReceivedDelegate;
+
+            /**
+             * These are measurements of the traffic handled by the manager,
+             * and of how long each stage of handling it took.
+             */
+            struct Stats
+            {
+                /**
+                 * This is the number of chunks of text received from the
+                 * Twitch server, and the number of characters in them.
+                 */
+                uint64_t chunks = 0;
+                uint64_t bytes = 0;
+
+                /**
+                 * This is the number of valid messages received.
+                 */
+                uint64_t messages = 0;
+
+                /**
+                 * This is the number of lines received which weren't valid
+                 * messages.
+                 */
+                uint64_t parseFailures = 0;
+
+                /**
+                 * This is the number of incomplete lines thrown away because
+                 * the connection was closed before the rest arrived.
+                 */
+                uint64_t linesDropped = 0;
+
+                /**
+                 * This is the number of chunks of text thrown away because
+                 * they arrived while the connection was being closed and the
+                 * worker was too far behind to take them.
+                 */
+                uint64_t chunksDropped = 0;
+
+                /**
+                 * This is the number of times the connection in use was
+                 * replaced, after it was lost or the server asked the agent
+                 * to reconnect.
+                 */
+                uint64_t reconnects = 0;
+
+                /**
+                 * This is the number of PINGs from the server answered.
+                 */
+                uint64_t pingsAnswered = 0;
+
+                /**
+                 * This is the number of connections given up on because the
+                 * server didn't answer a PING from the agent in time.
+                 */
+                uint64_t keepAliveTimeouts = 0;
+
+                /**
+                 * This is how long each action, such as a chunk of text
+                 * received, waited for the worker thread.
+                 */
+                LatencyHistogram::Summary queueWait;
+
+                /**
+                 * This is how long it took to unpack a line into a message.
+                 * Only a sample of the lines are timed.
+                 */
+                LatencyHistogram::Summary parse;
+
+                /**
+                 * This is how long it took to handle a message, including
+                 * calling the message received delegate if there's no
+                 * executor, or handing the call to the executor if there is.
+                 * Only a sample of the messages are timed.
+                 */
+                LatencyHistogram::Summary dispatch;
+
+                /**
+                 * This is how long each line sent waited to be sent, mostly
+                 * because of rate limits.
+                 */
+                LatencyHistogram::Summary outboundWait;
+
+                /**
+                 * This is how long the server took to answer each PING sent
+                 * by the agent, measured as soon as the PONG arrived.
+                 */
+                LatencyHistogram::Summary serverRoundTrip;
+            };
+
+#ifdef TWITCH_BOT_COROUTINES
+            /**
+             * This picks out which messages NextMessage waits for. A message
+             * must pass every part of the filter which is set.
+             */
+            struct MessageFilter
+            {
+                /**
+                 * If this isn't KnownCommand::Other, only messages with this
+                 * command pass.
+                 */
+                KnownCommand command = KnownCommand::Other;
+
+                /**
+                 * If this isn't empty, only messages in this channel pass.
+                 * It's the name of the channel, without the leading hash (#)
+                 * character, in any case.
+                 */
+                std::string channel;
+
+                /**
+                 * If this isn't empty, only messages from the user with this
+                 * login name, in any case, pass.
+                 */
+                std::string user;
+
+                /**
+                 * If this is set, only messages for which it returns true
+                 * pass. It's called on the worker thread.
+                 */
+                std::function< bool(const Message& message) > predicate;
+            };
+
+            /**
+             * @brief This is an operation of the manager for a coroutine to
+             * co_await, such as logging in. The operation is handed to the
+             * worker thread when it's awaited, and the coroutine is resumed
+             * on the worker thread when the operation completes, with an
+             * indication of whether or not it succeeded.
+             *
+             * Since the worker thread also keeps the connection alive, a
+             * coroutine resumed by an operation should hand off anything
+             * slow before awaiting anything else.
+             */
+            class Operation
+            {
+                // Lifecycle Management
+                public:
+                    ~Operation() noexcept;
+                    Operation(const Operation& other) = delete;
+                    Operation(Operation&&) noexcept = delete;
+                    Operation& operator=(const Operation& other) = delete;
+                    Operation& operator=(Operation&&) noexcept = delete;
+
+                // Beginning of Public Methods
+                public:
+                    bool await_ready() const noexcept;
+
+                    /**
+                     * This method hands the operation to the worker thread,
+                     * unless the manager is shutting down, in which case the
+                     * operation fails at once. The awaiting coroutine must
+                     * not be destroyed until it's resumed.
+                     *
+                     * @param[in] handle This is the awaiting coroutine.
+                     *
+                     * @return an indication of whether or not the coroutine
+                     * should stay suspended is returned.
+                     */
+                    bool await_suspend(std::coroutine_handle<> handle);
+
+                    bool await_resume() const noexcept;
+
+                protected:
+                    /**
+                     * These are the kinds of operation.
+                     */
+                    enum class Kind
+                    {
+                        LogIn,
+                        LogOut,
+                        Join,
+                        NextMessage
+                    };
+
+                    /**
+                     * This constructs an operation of the given manager.
+                     *
+                     * @param[in] manager This is the manager.
+                     *
+                     * @param[in] kind This is the kind of operation.
+                     *
+                     * @param[in] timeout This is how long to wait for the
+                     * operation to complete, in seconds, or 0.0 to wait as
+                     * long as it takes.
+                     *
+                     * @param[in] first This is the first string the
+                     * operation needs, if any, such as a nickname.
+                     *
+                     * @param[in] second This is the second string the
+                     * operation needs, if any, such as a token.
+                     */
+                    Operation(
+                        MessageManager* manager,
+                        Kind kind,
+                        double timeout,
+                        std::string first = std::string(),
+                        std::string second = std::string()
+                    );
+
+                private:
+                    friend class MessageManager;
+
+                    /**
+                     * This is the manager performing the operation.
+                     */
+                    MessageManager* manager_;
+
+                    /**
+                     * This is the kind of operation, and how long to wait
+                     * for it, in seconds.
+                     */
+                    Kind kind_;
+                    double timeout_;
+
+                    /**
+                     * These are the strings the operation needs, such as the
+                     * nickname and token to log in with, or the channel to
+                     * join.
+                     */
+                    std::string first_;
+                    std::string second_;
+
+                    /**
+                     * This is the coroutine awaiting the operation.
+                     */
+                    std::coroutine_handle<> handle_;
+
+                    /**
+                     * This indicates whether or not the operation succeeded.
+                     */
+                    bool succeeded_ = false;
+
+                    /**
+                     * These are kept by the worker thread while the
+                     * operation is waiting: the timer for its timeout, the
+                     * symbol of the channel it's about, and its place in the
+                     * list of operations waiting alongside it.
+                     */
+                    uint64_t timer_ = 0;
+                    SymbolTable::Symbol channelSymbol_ = SymbolTable::NO_SYMBOL;
+                    size_t waitingIndex_ = 0;
+            };
+
+            /**
+             * @brief This is what NextMessage returns for a coroutine to
+             * co_await. It completes with the next message which passes the
+             * filter, or with nothing if none did in time.
+             */
+            class MessageOperation
+                : public Operation
+            {
+                // Beginning of Public Methods
+                public:
+                    std::optional< Message > await_resume();
+
+                private:
+                    friend class MessageManager;
+
+                    /**
+                     * This constructs a wait for a message.
+                     */
+                    MessageOperation(
+                        MessageManager* manager,
+                        MessageFilter filter,
+                        double timeout
+                    );
+
+                    /**
+                     * This picks out which message to wait for.
+                     */
+                    MessageFilter filter_;
+
+                    /**
+                     * This is the symbol of the user the message must be
+                     * from, if any, once the worker has looked it up.
+                     */
+                    SymbolTable::Symbol userSymbol_ = SymbolTable::NO_SYMBOL;
+
+                    /**
+                     * This is the message which passed the filter.
+                     */
+                    Message message_;
+            };
+#endif /* TWITCH_BOT_COROUTINES */
+
         // Lifecycle Management
         public:
             ~MessageManager() noexcept;
@@ -55,6 +362,11 @@ namespace TwitchBot
              * @brief This method will provide a connectionFactory object with
              * the ability to connect to the Twitch server.
              *
+             * The factory is called on the worker thread, but each
+             * connection's Connect method is called on a thread of its own,
+             * so that looking up and connecting to the server doesn't hold
+             * up the worker.
+             *
              * @param[in] connectionFactory This is the method to call in order
              * to connect to the Twitch server.
              */
@@ -64,11 +376,146 @@ namespace TwitchBot
              * @brief This method will provide a means of measuring elapsed time
              * periods.
              *
+             * If the time keeper's time can be moved on other than by the
+             * passing of real time, as a SimulatedTimeKeeper's can, the
+             * worker wakes up whenever it is, so that timeouts fire without
+             * waiting for real.
+             *
              * @param[in] timeKeeper This is the object used to measure elapsed
              * time periods.
              */
             void SetTimeKeeper(std::shared_ptr< TimeKeeper > timeKeeper);
             
+            /**
+             * @brief This method provides a pool of threads on which to call
+             * the delegates, so that slow delegates don't hold up the worker
+             * thread, which keeps the session going with the Twitch
+             * server. Messages from each channel are handed over one at a
+             * time, in order, and so are all other messages and the logged
+             * in and logged out notifications. If no executor is provided,
+             * delegates are called from the worker thread.
+             *
+             * The manager waits, when destroyed, for any delegates it has
+             * handed to the executor to finish, so it must not be destroyed
+             * from a delegate.
+             *
+             * @param[in] executor This is the pool of threads on which to
+             * call the delegates.
+             */
+            void SetExecutor(std::shared_ptr< Executor > executor);
+
+            /**
+             * @brief This method provides the table in which the names of
+             * the channels of received messages are interned, and their
+             * senders looked up, so that several managers can share one. Otherwise each
+             * manager has a table of its own. It must be called before
+             * logging in.
+             *
+             * @param[in] symbolTable This is the table in which to intern
+             * names.
+             */
+            void SetSymbolTable(std::shared_ptr< SymbolTable > symbolTable);
+
+            /**
+             * @brief This method returns the table in which the names of the
+             * channels of received messages are interned, and their senders
+             * looked up, for turning the symbols of messages back into
+             * names.
+             *
+             * @return The table in which names are interned is returned.
+             */
+            std::shared_ptr< SymbolTable > GetSymbolTable() const;
+
+            /**
+             * @brief This method provides an archive into which each message
+             * received is added, on the worker thread, just before it's
+             * handed to the message received delegate. Adding a message
+             * only copies it into memory; the log writes it out to disk on
+             * a thread of its own. It must be called before logging in.
+             *
+             * @param[in] chatLog This is the archive to add messages to, or
+             * nullptr for none. It should already be open.
+             */
+            void SetChatLog(std::shared_ptr< ChatLog > chatLog);
+
+            /**
+             * @brief This method provides a full-text index to which each
+             * PRIVMSG received is fed, on the worker thread, just before
+             * it's handed to the message received delegate. Feeding a
+             * message only copies it onto the index's queue; the index
+             * indexes it on a thread of its own, and drops it rather than
+             * wait if it's fallen too far behind. It must be called before
+             * logging in.
+             *
+             * @param[in] chatIndex This is the index to feed messages to,
+             * or nullptr for none.
+             */
+            void SetChatIndex(std::shared_ptr< ChatIndex > chatIndex);
+
+            /**
+             * @brief This method provides the analytics in which each
+             * PRIVMSG received is counted, on the worker thread, just
+             * before it's handed to the message received delegate, at the
+             * time given by the time keeper. It must be called before
+             * logging in.
+             *
+             * @param[in] chatAnalytics These are the analytics in which to
+             * count messages, or nullptr for none.
+             */
+            void SetChatAnalytics(std::shared_ptr< ChatAnalytics > chatAnalytics);
+
+            /**
+             * @brief This method sets whether or not the manager reconnects
+             * on its own when the connection is lost, or can't be made,
+             * until LogOut is called. Reconnecting waits longer after each
+             * failed attempt in a row, up to a minute, with some randomness
+             * so that many agents dropped at once don't come back at once.
+             * The new connection logs in and joins every channel the agent
+             * was in, as fast as the rate limits allow. It's enabled unless
+             * this is called to disable it.
+             *
+             * Whenever the server asks the agent to reconnect, it does so
+             * regardless, before the old connection is closed.
+             *
+             * @param[in] autoReconnect This indicates whether or not to
+             * reconnect on its own.
+             */
+            void SetAutoReconnect(bool autoReconnect);
+
+            /**
+             * @brief This method sets whether or not the manager keeps a
+             * second connection logged in while the agent is logged in, so
+             * that when the server asks the agent to reconnect, or the
+             * connection is lost, the second connection takes over at once,
+             * only needing to join the channels again. Messages keep being
+             * taken from the old connection, if it's still open, until each
+             * channel is joined on the new one. It's disabled unless this is
+             * called to enable it.
+             *
+             * @param[in] warmStandby This indicates whether or not to keep
+             * a second connection ready.
+             */
+            void SetWarmStandby(bool warmStandby);
+
+            /**
+             * @brief This method sets how often the manager sends the server
+             * a PING on each connection logged in, to measure the round trip
+             * (see Stats::serverRoundTrip) and make sure the connection
+             * still works, and how long it waits for the PONG before
+             * treating the connection as lost. By default, a PING is sent
+             * every 60 seconds, and the PONG is waited for 10 seconds.
+             *
+             * PINGs from the server are always answered, as soon as they
+             * arrive, ahead of anything waiting to be sent.
+             *
+             * @param[in] pingInterval This is how often to send a PING, in
+             * seconds, or zero not to.
+             *
+             * @param[in] pongTimeout This is how long to wait for the PONG,
+             * in seconds.
+             */
+            void SetKeepAlive(double pingInterval, double pongTimeout);
+
             /**
              * @brief This method is is called to setup a callback to happen
              * when the user agent successfully logs into the Twitch server.
@@ -87,6 +534,15 @@ namespace TwitchBot
              */
             void SetLoggedOutDelegate(LoggedOutDelegate loggedOutDelegate);
 
+            /**
+             * @brief This method is is called to setup a callback to happen
+             * for each message received from the Twitch server.
+             *
+             * @param[in] messageReceivedDelegate This is the function to call
+             * for each message received from the Twitch server.
+             */
+            void SetMessageReceivedDelegate(MessageReceivedDelegate messageReceivedDelegate);
+
             /**
              * @brief This method starts the process of logging into the Twitch
              * server.
@@ -111,6 +567,188 @@ namespace TwitchBot
              */
             void LogOut(const std::string& farewell);
 
+#ifdef TWITCH_BOT_COROUTINES
+            /**
+             * @brief This method logs into the Twitch server, for a coroutine
+             * to co_await. The operation succeeds once the server has
+             * welcomed the agent, at once if it's already logged in, and
+             * fails if the connection can't be made or is closed, or if the
+             * timeout passes first.
+             *
+             * @param[in] nickname This is the nickname associated to the twitch
+             * user account.
+             *
+             * @param[in] token This is the oauth token associated to the user
+             * account used for authentication with the Twitch server.
+             *
+             * @param[in] timeout This is how long to wait, in seconds, or
+             * 0.0 to wait as long as the manager waits for the server.
+             *
+             * @return The operation to co_await is returned.
+             */
+            Operation LogInAsync(
+                const std::string& nickname,
+                const std::string& token,
+                double timeout = 0.0
+            );
+
+            /**
+             * @brief This method logs out of the Twitch server, for a
+             * coroutine to co_await. The operation succeeds once the
+             * connection is closed. Every other operation still waiting
+             * fails.
+             *
+             * @param[in] farewell this is the message sent back to the Twitch
+             * server just before the connection is closed.
+             *
+             * @return The operation to co_await is returned.
+             */
+            Operation LogOutAsync(const std::string& farewell);
+
+            /**
+             * @brief This method joins a Twitch chat channel, for a coroutine
+             * to co_await. The operation succeeds once the server confirms
+             * the agent has joined, and fails if the agent isn't logged in or
+             * the connection is closed, or if the timeout passes first.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character, in any case.
+             *
+             * @param[in] timeout This is how long to wait, in seconds, or
+             * 0.0 to wait as long as it takes.
+             *
+             * @return The operation to co_await is returned.
+             */
+            Operation JoinAsync(
+                const std::string& channel,
+                double timeout = 0.0
+            );
+
+            /**
+             * @brief This method waits for the next message received which
+             * passes the given filter, for a coroutine to co_await, such as
+             * a reply to a command just sent. Only messages received after
+             * the operation reaches the worker thread are considered. The
+             * message is also delivered as usual. The operation fails if the
+             * connection is closed, or if the timeout passes first.
+             *
+             * GCC 12 mishandles a temporary filter written as a braced list
+             * within the co_await expression, so give the filter a name
+             * first.
+             *
+             * @param[in] filter This picks out which message to wait for.
+             *
+             * @param[in] timeout This is how long to wait, in seconds, or
+             * 0.0 to wait as long as it takes.
+             *
+             * @return The operation to co_await is returned. It completes
+             * with the message, or with nothing if it failed.
+             */
+            MessageOperation NextMessage(
+                MessageFilter filter,
+                double timeout = 0.0
+            );
+#endif /* TWITCH_BOT_COROUTINES */
+
+            /**
+             * @brief This method joins a Twitch chat channel. The JOIN is
+             * paced to stay within Twitch's JOIN rate limit. Twitch channel
+             * names are in lower case, so the name is folded to lower case
+             * here and in the other methods which take one.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character, in any case.
+             */
+            void Join(const std::string& channel);
+
+            /**
+             * @brief This method joins several Twitch chat channels at once,
+             * with a single request to the worker. The JOINs are paced to
+             * stay within Twitch's JOIN rate limit.
+             *
+             * @param[in] channels These are the names of the channels, without
+             * the leading hash (#) character, in any case.
+             */
+            void Join(const std::vector< std::string >& channels);
+
+            /**
+             * @brief This method leaves a Twitch chat channel.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character, in any case.
+             */
+            void Leave(const std::string& channel);
+
+            /**
+             * @brief This method sends a chat message to a channel. Messages
+             * are paced to stay within Twitch's chat rate limits, which are
+             * higher in channels where the bot is a moderator.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character, in any case.
+             *
+             * @param[in] text This is the message to send.
+             */
+            void SendMessage(const std::string& channel, const std::string& text);
+
+            /**
+             * @brief This method sends a moderation command (such as
+             * "/timeout user 600") to a channel. Moderation commands count
+             * against the same rate limits as chat messages, but are sent
+             * ahead of any chat messages waiting.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character, in any case.
+             *
+             * @param[in] command This is the command to send.
+             */
+            void SendModeration(const std::string& channel, const std::string& command);
+
+            /**
+             * @brief This method returns measurements of the lines waiting to
+             * be sent to the Twitch server, such as queue depths and how long
+             * lines waited because of rate limits.
+             *
+             * @return The measurements are returned.
+             */
+            OutboundScheduler::Stats GetOutboundStats();
+
+            /**
+             * @brief This method returns measurements of the traffic handled
+             * by the manager and how long it took. It may be called from any
+             * thread at any time.
+             *
+             * @return The measurements are returned.
+             */
+            Stats GetStats();
+
+            /**
+             * @brief This method returns the same measurements as GetStats,
+             * and the outbound measurements, in the Prometheus text
+             * exposition format.
+             *
+             * @return The measurements, as text, are returned.
+             */
+            std::string GetStatsText();
+
+            /**
+             * @brief This method has the worker thread write the measurements
+             * (see GetStatsText) to a file periodically, and once more when
+             * the manager is destroyed. Each time, the file is written under
+             * a temporary name and then renamed, so that readers never see
+             * it half written.
+             *
+             * @param[in] path This is the path of the file. If it's empty,
+             * the measurements stop being written.
+             *
+             * @param[in] intervalSeconds This is how often to write the
+             * file, in seconds of time keeper time.
+             */
+            void SetStatsFile(
+                const std::string& path,
+                double intervalSeconds
+            );
+
         private:
             /**
              * A struct that contains the private properties of the instance.
@@ -125,4 +763,6 @@ namespace TwitchBot
             std::unique_ptr< Impl > impl_;
 
     };
-}
\ No newline at end of file
+}
+
+#endif /* TWITCH_BOT_MESSAGE_MANAGER_HPP */
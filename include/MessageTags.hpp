@@ -0,0 +1,306 @@
+#ifndef TWITCH_BOT_MESSAGE_TAGS_HPP
+#define TWITCH_BOT_MESSAGE_TAGS_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace TwitchBot
+{
+    /**
+     * These are the message tags which Twitch commonly sends, and which can
+     * be looked up without comparing key strings. Each is named after its key
+     * with the hyphens removed (for example, TmiSentTs is "tmi-sent-ts").
+     */
+    enum class KnownTag
+    {
+        BadgeInfo,
+        Badges,
+        BanDuration,
+        Bits,
+        Color,
+        DisplayName,
+        EmoteOnly,
+        Emotes,
+        FirstMessage,
+        FollowersOnly,
+        Id,
+        Login,
+        Mod,
+        MsgId,
+        RoomId,
+        Slow,
+        SubsOnly,
+        Subscriber,
+        TargetMsgId,
+        TargetUserId,
+        TmiSentTs,
+        Turbo,
+        UserId,
+        UserType,
+        Vip,
+
+        /**
+         * This is the number of known tags, not a tag itself.
+         */
+        Count
+    };
+
+    /**
+     * This holds the IRCv3 message tags block of a message received from the
+     * Twitch server.
+     *
+     * Assigning the tags only copies the raw text. The text is split into
+     * keys and values the first time any tag is looked up, and escaped
+     * values are only unescaped when they are read, so tags of messages
+     * that are never looked at cost almost nothing.
+     *
+     * Because the first lookup fills in the split of the text, even though
+     * the lookup methods are const, the tags (and so the Message holding
+     * them) must not be read from more than one thread at a time. A thread
+     * handing a message to others should give each a copy, as the
+     * MessageManager does.
+     */
+    class MessageTags
+    {
+        // Beginning of Public Methods
+        public:
+            /**
+             * This method replaces the tags with the given tags block.
+             *
+             * @param[in] raw This is the tags block, without the leading
+             * at sign (@) character.
+             */
+            void Assign(std::string_view raw);
+
+            /**
+             * This method removes all tags.
+             */
+            void Clear();
+
+            /**
+             * This method returns an indication of whether or not there are
+             * any tags.
+             *
+             * @return true if there are no tags.
+             */
+            bool Empty() const;
+
+            /**
+             * This method returns the tags block exactly as received.
+             *
+             * @return The tags block, without the leading at sign (@)
+             * character.
+             */
+            std::string_view GetRaw() const;
+
+            /**
+             * This method returns an indication of whether or not the given
+             * tag is present.
+             *
+             * @param[in] key This is the key of the tag to look for.
+             *
+             * @return true if the tag is present.
+             */
+            bool Has(std::string_view key) const;
+
+            /**
+             * This method returns an indication of whether or not the given
+             * tag is present.
+             *
+             * @param[in] tag This is the tag to look for.
+             *
+             * @return true if the tag is present.
+             */
+            bool Has(KnownTag tag) const;
+
+            /**
+             * This method looks up the value of a tag, as it was received,
+             * without undoing escaping.
+             *
+             * @param[in] key This is the key of the tag to look up.
+             *
+             * @return A view of the value is returned, which is empty if the
+             * tag is not present. The view is valid until the tags are next
+             * assigned.
+             */
+            std::string_view GetRawValue(std::string_view key) const;
+
+            /**
+             * This method looks up the value of a known tag, as it was
+             * received, without undoing escaping.
+             *
+             * @param[in] tag This is the tag to look up.
+             *
+             * @return A view of the value is returned, which is empty if the
+             * tag is not present. The view is valid until the tags are next
+             * assigned.
+             */
+            std::string_view GetRawValue(KnownTag tag) const;
+
+            /**
+             * This method looks up the value of a tag, and undoes the IRCv3
+             * escaping of the value.
+             *
+             * @param[in] key This is the key of the tag to look up.
+             *
+             * @return The value is returned, which is empty if the tag is not
+             * present.
+             */
+            std::string GetValue(std::string_view key) const;
+
+            /**
+             * This method looks up the value of a known tag, and undoes the
+             * IRCv3 escaping of the value.
+             *
+             * @param[in] tag This is the tag to look up.
+             *
+             * @return The value is returned, which is empty if the tag is not
+             * present.
+             */
+            std::string GetValue(KnownTag tag) const;
+
+            /**
+             * This method looks up the value of a known tag holding a whole
+             * number.
+             *
+             * @param[in] tag This is the tag to look up.
+             *
+             * @param[out] value This is where to store the number.
+             *
+             * @return an indication of whether or not the tag is present and
+             * holds a whole number which fits in 64 bits is returned.
+             */
+            bool GetInteger(KnownTag tag, int64_t& value) const;
+
+            /**
+             * This method returns the Twitch user ID of the sender.
+             *
+             * @return The user ID is returned, or 0 if it is not present.
+             */
+            uint64_t GetUserId() const;
+
+            /**
+             * This method returns the Twitch user ID of the channel.
+             *
+             * @return The room ID is returned, or 0 if it is not present.
+             */
+            uint64_t GetRoomId() const;
+
+            /**
+             * This method returns when the Twitch server sent the message.
+             *
+             * @return The time is returned, in milliseconds since the Unix
+             * epoch, or 0 if it is not present.
+             */
+            int64_t GetSentTime() const;
+
+            /**
+             * This method returns the unique ID of the message.
+             *
+             * @return The ID is returned, or an empty view if it is not
+             * present.
+             */
+            std::string_view GetMessageId() const;
+
+            /**
+             * This method returns the ID of the notice, for NOTICE and
+             * USERNOTICE messages.
+             *
+             * @return The ID is returned, or an empty view if it is not
+             * present.
+             */
+            std::string_view GetNoticeId() const;
+
+            /**
+             * This method returns the badges of the sender, in the form
+             * "name/version,name/version".
+             *
+             * @return The badges are returned, or an empty view if there are
+             * none.
+             */
+            std::string_view GetBadges() const;
+
+            /**
+             * This method returns the emotes used in the message, in the form
+             * "id:first-last,first-last/id:first-last".
+             *
+             * @return The emotes are returned, or an empty view if there are
+             * none.
+             */
+            std::string_view GetEmotes() const;
+
+            /**
+             * This method returns the display name of the sender.
+             *
+             * @return The display name is returned, or an empty string if it
+             * is not present.
+             */
+            std::string GetDisplayName() const;
+
+            /**
+             * This method undoes the IRCv3 escaping of a tag value.
+             *
+             * @param[in] value This is the value as received.
+             *
+             * @return The unescaped value is returned.
+             */
+            static std::string Unescape(std::string_view value);
+
+        private:
+            /**
+             * This locates a single tag within the raw tags block.
+             */
+            struct Entry
+            {
+                uint32_t keyOffset;
+                uint32_t keyLength;
+                uint32_t valueOffset;
+                uint32_t valueLength;
+            };
+
+            /**
+             * This method splits the raw tags block into keys and values,
+             * if that hasn't already been done.
+             */
+            void Index() const;
+
+            /**
+             * This method records the location of a single tag found while
+             * indexing.
+             */
+            void AddEntry(size_t keyBegin, size_t keyEnd, size_t valueEnd, bool haveValue) const;
+
+            /**
+             * This method returns the value of the given entry.
+             */
+            std::string_view GetEntryValue(const Entry& entry) const;
+
+            /**
+             * This holds the tags block exactly as received.
+             */
+            std::string raw_;
+
+            /**
+             * These locate every tag in the raw tags block. This is only
+             * filled in when a tag is first looked up.
+             */
+            mutable std::vector< Entry > entries_;
+
+            /**
+             * For each known tag, this is one more than the position of its
+             * entry in entries_, or 0 if the tag is not present.
+             */
+            mutable uint16_t known_[(size_t)KnownTag::Count] = {};
+
+            /**
+             * This flag indicates whether or not entries_ and known_ have
+             * been filled in for the current tags block.
+             */
+            mutable bool indexed_ = true;
+    };
+}
+
+#endif /* TWITCH_BOT_MESSAGE_TAGS_HPP */
@@ -0,0 +1,122 @@
+#ifndef TWITCH_BOT_MESSAGE_TOKENIZER_HPP
+#define TWITCH_BOT_MESSAGE_TOKENIZER_HPP
+
+#include <stddef.h>
+#include <string_view>
+
+namespace TwitchBot
+{
+    /**
+     * This is the largest number of parameters an IRC message may have
+     * (RFC 1459). When the limit is reached, the rest of the line becomes
+     * the last parameter.
+     */
+    constexpr size_t MAX_MESSAGE_PARAMETERS = 15;
+
+    /**
+     * This holds the boundaries of the parts of a single line received from
+     * the Twitch server. Every part is a view into the line that was
+     * tokenized, so it is only valid as long as the line is.
+     */
+    struct MessageTokens
+    {
+        /**
+         * If the line begins with IRCv3 message tags, this is the tags block
+         * without the leading at sign (@) character. Otherwise it's empty.
+         */
+        std::string_view tags;
+
+        /**
+         * If the line includes a prefix, this is the prefix without the
+         * leading colon (:) character. Otherwise it's empty.
+         */
+        std::string_view prefix;
+
+        /**
+         * This is the command portion of the line.
+         */
+        std::string_view command;
+
+        /**
+         * These are the parameters (if any) provided within the line. The
+         * last one has its leading colon (:) removed.
+         */
+        std::string_view parameters[MAX_MESSAGE_PARAMETERS];
+
+        /**
+         * This is the number of entries of parameters which are used.
+         */
+        size_t parameterCount = 0;
+    };
+
+    /**
+     * These are the ways the tokenizer can search for the boundaries between
+     * the parts of a line.
+     */
+    enum class ScanImplementation
+    {
+        /**
+         * Look at one character at a time. This works on every processor.
+         */
+        Scalar,
+
+        /**
+         * Look at 16 characters at a time using SSE2 instructions.
+         */
+        Sse2,
+
+        /**
+         * Look at 32 characters at a time using AVX2 instructions.
+         */
+        Avx2
+    };
+
+    /**
+     * This function splits a single line received from the Twitch server
+     * into its parts, in one pass over the line.
+     *
+     * @param[in] line This is the line to split, without its CRLF.
+     *
+     * @param[out] tokens This is where to store the parts of the line.
+     *
+     * @return an indication of whether or not the line is a valid message
+     * (it has a command) is returned.
+     */
+    bool TokenizeMessage(std::string_view line, MessageTokens& tokens);
+
+    /**
+     * This function finds the first occurrence of the given character,
+     * using the fastest search the processor supports.
+     *
+     * @param[in] begin This points to the first character to search.
+     *
+     * @param[in] end This points just past the last character to search.
+     *
+     * @param[in] character This is the character to find.
+     *
+     * @return A pointer to the first occurrence of the character is
+     * returned, or end if the character is not present.
+     */
+    const char* FindCharacter(const char* begin, const char* end, char character);
+
+    /**
+     * This function selects how the tokenizer searches for boundaries. By
+     * default the fastest search the processor supports is selected when
+     * the program starts. All of them give identical results.
+     *
+     * @param[in] implementation This is the search to use.
+     *
+     * @return an indication of whether or not the processor supports the
+     * given search is returned. If it doesn't, nothing is changed.
+     */
+    bool SelectScanImplementation(ScanImplementation implementation);
+
+    /**
+     * This function returns which search the tokenizer currently uses.
+     *
+     * @return The search currently in use is returned.
+     */
+    ScanImplementation GetScanImplementation();
+}
+
+#endif /* TWITCH_BOT_MESSAGE_TOKENIZER_HPP */
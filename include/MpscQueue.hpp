@@ -0,0 +1,206 @@
+#ifndef TWITCH_BOT_MPSC_QUEUE_HPP
+#define TWITCH_BOT_MPSC_QUEUE_HPP
+
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace TwitchBot
+{
+    /**
+     * This is a bounded queue which any number of threads may push onto, but
+     * only one thread may pop from, without any locking.
+     *
+     * Each slot of the ring carries a sequence number which tells producers
+     * and the consumer whose turn it is to use the slot, so producers only
+     * contend on claiming a position, and items are moved in and out rather
+     * than copied.
+     *
+     * @tparam T This is the type of item held in the queue. It must be
+     * default constructible and move assignable.
+     */
+    template< typename T > class MpscQueue
+    {
+        // Lifecycle Management
+        public:
+            ~MpscQueue() noexcept = default;
+            MpscQueue(const MpscQueue& other) = delete;
+            MpscQueue(MpscQueue&&) noexcept = delete;
+            MpscQueue& operator=(const MpscQueue& other) = delete;
+            MpscQueue& operator=(MpscQueue&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs an empty queue.
+             *
+             * @param[in] capacity This is the most items the queue can hold
+             * at once. It is rounded up to a power of two.
+             */
+            explicit MpscQueue(size_t capacity)
+            {
+                capacity_ = 2;
+                while (capacity_ < capacity)
+                {
+                    capacity_ *= 2;
+                }
+                slots_.reset(new Slot[capacity_]);
+                for (size_t i = 0; i < capacity_; ++i)
+                {
+                    slots_[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            /**
+             * This method adds an item to the back of the queue, if there is
+             * room. It may be called from any thread.
+             *
+             * @param[in,out] item This is the item to add. It is moved from
+             * only if it was added.
+             *
+             * @return an indication of whether or not the item was added
+             * (false if the queue is full) is returned.
+             */
+            bool TryPush(T& item)
+            {
+                auto position = enqueuePosition_.load(std::memory_order_relaxed);
+                Slot* slot;
+                while (true)
+                {
+                    slot = &slots_[position & (capacity_ - 1)];
+                    const auto sequence = slot->sequence.load(std::memory_order_acquire);
+                    const auto difference = (ptrdiff_t)sequence - (ptrdiff_t)position;
+                    if (difference == 0)
+                    {
+                        if (
+                            enqueuePosition_.compare_exchange_weak(
+                                position,
+                                position + 1,
+                                std::memory_order_relaxed
+                            )
+                        )
+                        {
+                            break;
+                        }
+                    }
+                    else if (difference < 0)
+                    {
+                        return false;
+                    }
+                    else
+                    {
+                        position = enqueuePosition_.load(std::memory_order_relaxed);
+                    }
+                }
+                slot->item = std::move(item);
+                slot->sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+
+            /**
+             * This method removes the item at the front of the queue, if
+             * there is one. It may only be called from the consumer thread.
+             *
+             * @param[out] item This is where to move the item removed.
+             *
+             * @return an indication of whether or not an item was removed
+             * (false if the queue is empty) is returned.
+             */
+            bool TryPop(T& item)
+            {
+                auto& slot = slots_[dequeuePosition_ & (capacity_ - 1)];
+                const auto sequence = slot.sequence.load(std::memory_order_acquire);
+                if (sequence != dequeuePosition_ + 1)
+                {
+                    return false;
+                }
+                item = std::move(slot.item);
+                slot.sequence.store(dequeuePosition_ + capacity_, std::memory_order_release);
+                ++dequeuePosition_;
+                return true;
+            }
+
+            /**
+             * This method removes up to the given number of items from the
+             * front of the queue, and hands each to the given function in
+             * order. It may only be called from the consumer thread.
+             *
+             * @param[in] handler This is the function to call with each item
+             * removed.
+             *
+             * @param[in] limit This is the most items to remove.
+             *
+             * @return The number of items removed is returned.
+             */
+            template< typename Handler > size_t PopBatch(Handler&& handler, size_t limit)
+            {
+                size_t count = 0;
+                T item;
+                while ((count < limit) && TryPop(item))
+                {
+                    handler(item);
+                    ++count;
+                }
+                return count;
+            }
+
+            /**
+             * This method returns an indication of whether or not the queue
+             * is empty. It is only exact when called from the consumer
+             * thread, and even then an item may be pushed right after.
+             *
+             * @return true if there was nothing to pop.
+             */
+            bool Empty() const
+            {
+                const auto& slot = slots_[dequeuePosition_ & (capacity_ - 1)];
+                return (slot.sequence.load(std::memory_order_acquire) != dequeuePosition_ + 1);
+            }
+
+            /**
+             * This method returns the most items the queue can hold at once.
+             *
+             * @return The capacity of the queue.
+             */
+            size_t GetCapacity() const
+            {
+                return capacity_;
+            }
+
+        private:
+            /**
+             * This holds one item of the queue, and the sequence number which
+             * says whether the item is ready to be pushed or popped.
+             */
+            struct alignas(64) Slot
+            {
+                std::atomic< size_t > sequence;
+                T item;
+            };
+
+            /**
+             * These are the slots of the ring.
+             */
+            std::unique_ptr< Slot[] > slots_;
+
+            /**
+             * This is the number of slots, which is a power of two.
+             */
+            size_t capacity_ = 0;
+
+            /**
+             * This is the position at which the next item will be pushed.
+             * Producers claim positions by advancing it.
+             */
+            alignas(64) std::atomic< size_t > enqueuePosition_{0};
+
+            /**
+             * This is the position of the next item to pop. Only the consumer
+             * uses it.
+             */
+            alignas(64) size_t dequeuePosition_ = 0;
+    };
+}
+
+#endif /* TWITCH_BOT_MPSC_QUEUE_HPP */
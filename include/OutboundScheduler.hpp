@@ -0,0 +1,288 @@
+#ifndef TWITCH_BOT_OUTBOUND_SCHEDULER_HPP
+#define TWITCH_BOT_OUTBOUND_SCHEDULER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LatencyHistogram.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * These are the priorities of lines sent to the Twitch server. Lines in
+     * an earlier lane are always sent before lines in a later one.
+     */
+    enum class OutboundLane
+    {
+        /**
+         * Lines which keep the connection alive or manage the session, such
+         * as PONG, PASS, NICK and QUIT.
+         */
+        Critical,
+
+        /**
+         * Moderation actions taken by the bot.
+         */
+        Moderation,
+
+        /**
+         * Chat messages, and joining and leaving channels.
+         */
+        Chat,
+
+        /**
+         * This is the number of lanes, not a lane itself.
+         */
+        Count
+    };
+
+    /**
+     * These are the Twitch rate limits which a line may count against.
+     */
+    enum class RateLimitClass
+    {
+        /**
+         * The line doesn't count against any limit.
+         */
+        None,
+
+        /**
+         * A PRIVMSG to a channel in which the bot is not a moderator or the
+         * broadcaster. This counts against both the regular and the
+         * moderator PRIVMSG limits.
+         */
+        Message,
+
+        /**
+         * A PRIVMSG to a channel in which the bot is a moderator or the
+         * broadcaster. This only counts against the moderator PRIVMSG limit.
+         */
+        ModeratorMessage,
+
+        /**
+         * A JOIN.
+         */
+        Join
+    };
+
+    /**
+     * This queues lines to be sent to the Twitch server, and decides when
+     * each may be sent without going over Twitch's rate limits.
+     *
+     * Each limit allows a number of lines per window of time. A limit hands
+     * out that many tokens, and each token used comes back exactly one
+     * window later, so no window of that length ever holds more lines than
+     * the limit allows. Within a lane, lines counting against the same limit
+     * keep their order, but a line held back by one limit doesn't hold back
+     * lines counting against another. Lines counting against no limit keep
+     * their place behind any earlier line held back. Lines ready to go are
+     * coalesced into a single batch, so they can be written to the
+     * connection at once.
+     *
+     * The scheduler is not thread-safe; it's meant to be owned by the
+     * MessageManager worker thread. Times are in seconds, as measured by the
+     * TimeKeeper.
+     */
+    class OutboundScheduler
+    {
+        // Types
+        public:
+            /**
+             * This describes a single rate limit.
+             */
+            struct Limit
+            {
+                /**
+                 * This is the most lines allowed in any window.
+                 */
+                size_t lines = 0;
+
+                /**
+                 * This is the length of the window, in seconds.
+                 */
+                double window = 0.0;
+            };
+
+            /**
+             * These are the rate limits to honor.
+             */
+            struct Limits
+            {
+                /**
+                 * This limits PRIVMSGs to channels in which the bot is not a
+                 * moderator.
+                 */
+                Limit message{20, 30.0};
+
+                /**
+                 * This limits all PRIVMSGs, including those to channels in
+                 * which the bot is a moderator.
+                 */
+                Limit moderatorMessage{100, 30.0};
+
+                /**
+                 * This limits JOINs.
+                 */
+                Limit join{20, 10.0};
+            };
+
+            /**
+             * These are measurements of the scheduler's queues.
+             */
+            struct Stats
+            {
+                /**
+                 * This is the number of lines waiting in each lane.
+                 */
+                size_t queueDepth[(size_t)OutboundLane::Count] = {};
+
+                /**
+                 * This is the most lines ever waiting in each lane.
+                 */
+                size_t maxQueueDepth[(size_t)OutboundLane::Count] = {};
+
+                /**
+                 * This is the number of lines sent from each lane.
+                 */
+                uint64_t linesSent[(size_t)OutboundLane::Count] = {};
+
+                /**
+                 * This is the total time lines from each lane waited before
+                 * being sent, in seconds.
+                 */
+                double totalWait[(size_t)OutboundLane::Count] = {};
+
+                /**
+                 * This is the longest time a line from each lane waited
+                 * before being sent, in seconds.
+                 */
+                double maxWait[(size_t)OutboundLane::Count] = {};
+
+                /**
+                 * This is the number of batches handed out.
+                 */
+                uint64_t batches = 0;
+
+                /**
+                 * This is the number of times a line had to wait because of a
+                 * rate limit.
+                 */
+                uint64_t throttled = 0;
+            };
+
+        // Lifecycle Management
+        public:
+            ~OutboundScheduler() noexcept;
+            OutboundScheduler(const OutboundScheduler& other) = delete;
+            OutboundScheduler(OutboundScheduler&&) noexcept = delete;
+            OutboundScheduler& operator=(const OutboundScheduler& other) = delete;
+            OutboundScheduler& operator=(OutboundScheduler&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a scheduler with Twitch's default limits for
+             * a regular (not verified) bot account.
+             */
+            OutboundScheduler();
+
+            /**
+             * This method changes the rate limits to honor. Lines already
+             * sent still count against the new limits.
+             *
+             * @param[in] limits These are the rate limits to honor.
+             */
+            void SetLimits(const Limits& limits);
+
+            /**
+             * This method queues a line to be sent.
+             *
+             * @param[in] lane This is the priority of the line.
+             *
+             * @param[in] limitClass This is the rate limit the line counts
+             * against.
+             *
+             * @param[in] line This is the line to send, including its CRLF.
+             *
+             * @param[in] now This is the current time, in seconds.
+             */
+            void Enqueue(
+                OutboundLane lane,
+                RateLimitClass limitClass,
+                std::string line,
+                double now
+            );
+
+            /**
+             * This method takes all the lines which may be sent now, in
+             * order of priority, and joins them into one batch.
+             *
+             * @param[in] now This is the current time, in seconds.
+             *
+             * @param[out] batch This is where to store the lines to send.
+             *
+             * @return an indication of whether or not there was anything to
+             * send is returned.
+             */
+            bool Dequeue(double now, std::string& batch);
+
+            /**
+             * This method returns when the next line held back by a rate
+             * limit may be sent.
+             *
+             * @param[out] when This is where to store the time, in seconds.
+             *
+             * @return an indication of whether or not any line is waiting is
+             * returned.
+             */
+            bool GetNextSendTime(double& when) const;
+
+            /**
+             * This method returns an indication of whether or not any lines
+             * are waiting.
+             *
+             * @return true if no lines are waiting.
+             */
+            bool Empty() const;
+
+            /**
+             * This method discards all waiting lines, such as when the
+             * connection is closed. Lines already sent still count against
+             * the limits.
+             */
+            void Clear();
+
+            /**
+             * This method returns measurements of the scheduler's queues.
+             *
+             * @return The measurements are returned.
+             */
+            Stats GetStats() const;
+
+            /**
+             * This method returns how long each line sent waited, from being
+             * queued until being handed out in a batch. It may be read from
+             * any thread while the scheduler is in use.
+             *
+             * @return The histogram of waits is returned.
+             */
+            const LatencyHistogram& GetWaitHistogram() const;
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_OUTBOUND_SCHEDULER_HPP */
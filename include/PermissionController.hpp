@@ -0,0 +1,287 @@
+#ifndef TWITCH_BOT_PERMISSION_CONTROLLER_HPP
+#define TWITCH_BOT_PERMISSION_CONTROLLER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string_view>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageTags.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This works out what roles (moderator, subscriber, and so on) users have
+     * in each channel, from the badges Twitch attaches to their messages, so
+     * that commands can be limited to some of them.
+     *
+     * Roles are decoded into a bit mask, so checking a permission is then a
+     * single AND of two masks. The roles of each user seen are also kept in
+     * a cache of fixed size, keyed by channel and user ID, so they can be
+     * looked up without a message from the user at hand, such as when the
+     * user is the target of a command. Each cached user takes one 16 byte
+     * entry, so the cache for 100,000 chatters fits in two megabytes. When
+     * the cache is full, a user not seen recently among those competing for
+     * the same few entries is forgotten.
+     *
+     * The roles of the sender of a message are always decoded from the
+     * message itself, which is quicker than finding them in the cache, and
+     * keeps the cache up to date when a user's badges change. Cached roles
+     * are dropped for a user when they're banned or timed out (CLEARCHAT),
+     * and for a whole channel when chat is cleared or the channel is joined
+     * again (ROOMSTATE). The bot's own roles in each channel are kept
+     * separately, from USERSTATE.
+     *
+     * The controller may only be used from one thread at a time, such as
+     * the worker thread of a MessageManager.
+     */
+    class PermissionController
+    {
+        // Types
+        public:
+            /**
+             * This is a set of roles, with one bit for each.
+             */
+            typedef uint32_t RoleMask;
+
+            /**
+             * These are the roles a user may have in a channel.
+             */
+            enum Role : RoleMask
+            {
+                /**
+                 * Every user has this role.
+                 */
+                Viewer = 1 << 0,
+
+                Subscriber = 1 << 1,
+                Founder = 1 << 2,
+                Vip = 1 << 3,
+                Moderator = 1 << 4,
+                Broadcaster = 1 << 5,
+                Staff = 1 << 6,
+                Admin = 1 << 7,
+                GlobalModerator = 1 << 8,
+                Partner = 1 << 9,
+                Turbo = 1 << 10,
+                Prime = 1 << 11,
+                Artist = 1 << 12,
+
+                /**
+                 * The user has cheered bits in the channel.
+                 */
+                Cheerer = 1 << 13,
+            };
+
+            /**
+             * This is the set of roles which may moderate a channel.
+             */
+            static constexpr RoleMask MODERATION_ROLES = (
+                Moderator | Broadcaster | Staff | Admin | GlobalModerator
+            );
+
+            /**
+             * This contains measurements of the cache of roles.
+             */
+            struct Stats
+            {
+                /**
+                 * This is the number of users the cache can hold.
+                 */
+                size_t capacity = 0;
+
+                /**
+                 * This is the number of users held in the cache.
+                 */
+                size_t entries = 0;
+
+                /**
+                 * This is the number of bytes taken by each cached user.
+                 */
+                size_t bytesPerEntry = 0;
+
+                /**
+                 * This is the number of bytes taken by the cache's table of
+                 * users.
+                 */
+                size_t bytes = 0;
+
+                /**
+                 * This is the number of messages whose sender was already in
+                 * the cache, with the same roles.
+                 */
+                uint64_t hits = 0;
+
+                /**
+                 * This is the number of messages whose sender wasn't in the
+                 * cache.
+                 */
+                uint64_t misses = 0;
+
+                /**
+                 * This is the number of messages whose sender was in the
+                 * cache, but with different roles, which were replaced.
+                 */
+                uint64_t refreshes = 0;
+
+                /**
+                 * This is the number of users forgotten to make room for
+                 * others.
+                 */
+                uint64_t evictions = 0;
+
+                /**
+                 * This is the number of users and channels whose roles were
+                 * dropped because of CLEARCHAT or ROOMSTATE, or by
+                 * ForgetChannel.
+                 */
+                uint64_t invalidations = 0;
+            };
+
+        // Lifecycle Management
+        public:
+            ~PermissionController() noexcept;
+            PermissionController(const PermissionController& other) = delete;
+            PermissionController(PermissionController&&) noexcept;
+            PermissionController& operator=(const PermissionController& other) = delete;
+            PermissionController& operator=(PermissionController&&) noexcept;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a controller with an empty cache.
+             *
+             * @param[in] capacity This is the number of users the cache can
+             * hold. It's rounded up to a power of two.
+             */
+            explicit PermissionController(size_t capacity = 65536);
+
+            /**
+             * This method looks at a message received from the Twitch server,
+             * updating the cache as needed, and returns the roles of the user
+             * who sent it.
+             *
+             * PRIVMSG and USERNOTICE messages give the sender's roles.
+             * USERSTATE messages give the bot's own roles. CLEARCHAT and
+             * ROOMSTATE messages drop cached roles.
+             *
+             * @param[in] message This is the message received.
+             *
+             * @return The roles of the sender in the channel of the message
+             * are returned, or 0 if the message doesn't say.
+             */
+            RoleMask Resolve(const Message& message);
+
+            /**
+             * This method returns an indication of whether or not the sender
+             * of a message has any of the given roles in the channel of the
+             * message. The message is looked at as in Resolve.
+             *
+             * @param[in] message This is the message received.
+             *
+             * @param[in] required This is the set of roles, any of which
+             * allows the sender.
+             *
+             * @return an indication of whether or not the sender has any of
+             * the required roles is returned.
+             */
+            bool Check(
+                const Message& message,
+                RoleMask required
+            );
+
+            /**
+             * This method looks up the cached roles of a user in a channel.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character.
+             *
+             * @param[in] userId This is the Twitch user ID of the user.
+             *
+             * @param[out] roles This is where to store the user's roles.
+             *
+             * @return an indication of whether or not the user's roles in the
+             * channel are in the cache is returned.
+             */
+            bool GetRoles(
+                std::string_view channel,
+                uint64_t userId,
+                RoleMask& roles
+            );
+
+            /**
+             * This method returns the bot's own roles in a channel, as last
+             * given by USERSTATE.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character.
+             *
+             * @return The bot's roles are returned, or 0 if they aren't known.
+             */
+            RoleMask GetOwnRoles(std::string_view channel) const;
+
+            /**
+             * This method drops all cached roles in a channel, including the
+             * bot's own, such as when leaving it.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character.
+             */
+            void ForgetChannel(std::string_view channel);
+
+            /**
+             * This method drops all cached roles.
+             */
+            void Clear();
+
+            /**
+             * This method returns measurements of the cache.
+             *
+             * @return The measurements of the cache are returned.
+             */
+            Stats GetStats() const;
+
+            /**
+             * This method returns an indication of whether or not a set of
+             * roles includes any of the required ones.
+             *
+             * @param[in] roles This is the set of roles a user has.
+             *
+             * @param[in] required This is the set of roles, any of which
+             * allows the user.
+             *
+             * @return an indication of whether or not the user is allowed is
+             * returned.
+             */
+            static bool Allows(RoleMask roles, RoleMask required)
+            {
+                return (roles & required) != 0;
+            }
+
+            /**
+             * This method decodes the roles given by the tags of a message,
+             * without using the cache.
+             *
+             * @param[in] tags This is the tags of the message.
+             *
+             * @return The roles given by the tags are returned.
+             */
+            static RoleMask DecodeRoles(const MessageTags& tags);
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_PERMISSION_CONTROLLER_HPP */
@@ -0,0 +1,258 @@
+#ifndef TWITCH_BOT_PHRASE_FILTER_HPP
+#define TWITCH_BOT_PHRASE_FILTER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This looks for banned phrases in chat lines, for moderation.
+     *
+     * The list of phrases is compiled into one Aho-Corasick automaton,
+     * which finds every phrase in a line in one pass over it, however many
+     * phrases there are. Its states are numbered breadth first, so the
+     * shallow ones, where scanning spends most of its time, are together.
+     * Those states also have a full table of where to go next, so they're
+     * left in one lookup; deeper states only list the ways on from them,
+     * and fall back along the longest suffix of what they've matched
+     * which is also the start of a phrase.
+     *
+     * Text is normalized one byte at a time before it's matched, so every
+     * match is also a range of bytes of the original text:
+     * - With case folding, ASCII letters are matched without regard to
+     *   case.
+     * - With leetspeak folding, digits and symbols standing in for letters
+     *   are matched as those letters: 0 as o, 3 as e, 4 and @ as a, 5 and
+     *   $ as s, 7 and + as t, 8 as b and 9 as g. Since 1, ! and | can stand
+     *   for either i or l, those five are all taken for the same letter.
+     *
+     * Phrases may be matched only as whole words, so that banning "ass"
+     * doesn't ban "class". Word characters are ASCII letters and digits
+     * and any characters outside of ASCII, as they are in the text before
+     * it's normalized.
+     *
+     * Setting a new list of phrases doesn't wait for it to be compiled.
+     * A thread of the filter's own compiles it, and swaps it in for the
+     * old one once it's done. Lines are scanned with whichever list was
+     * in use when the scan started, and any number of threads may scan at
+     * once.
+     */
+    class PhraseFilter
+    {
+        // Types
+        public:
+            /**
+             * These are the settings of the filter, which apply to every
+             * phrase.
+             */
+            struct Settings
+            {
+                /**
+                 * This indicates whether or not ASCII letters are matched
+                 * without regard to case.
+                 */
+                bool foldCase = true;
+
+                /**
+                 * This indicates whether or not digits and symbols standing
+                 * in for letters are matched as those letters.
+                 */
+                bool foldLeetspeak = true;
+            };
+
+            /**
+             * This is one banned phrase.
+             */
+            struct Phrase
+            {
+                /**
+                 * This is the text of the phrase.
+                 */
+                std::string text;
+
+                /**
+                 * This indicates whether or not the phrase only matches
+                 * whole words: neither the character before it nor the one
+                 * after it may be a word character.
+                 */
+                bool wholeWord = false;
+            };
+
+            /**
+             * This is one banned phrase found in a chat line.
+             */
+            struct Match
+            {
+                /**
+                 * This is the position of the phrase in the list set.
+                 */
+                size_t phrase = 0;
+
+                /**
+                 * These are the byte offsets into the line of the start of
+                 * the phrase and of the end of it.
+                 */
+                size_t begin = 0;
+                size_t end = 0;
+            };
+
+            /**
+             * This is the type of function called with each phrase found.
+             *
+             * @param[in] match This is the phrase found.
+             *
+             * @return an indication of whether or not to keep looking is
+             * returned.
+             */
+            using MatchVisitor = std::function<
+                bool(const Match& match)
+            >;
+
+            /**
+             * These are the measurements of the filter.
+             */
+            struct Stats
+            {
+                /**
+                 * These are the number of phrases and states of the
+                 * automaton in use, and how much memory it uses, in bytes.
+                 */
+                size_t phrases = 0;
+                size_t states = 0;
+                size_t memoryUsage = 0;
+
+                /**
+                 * These are the number of lists of phrases set, and the
+                 * number of them compiled and swapped in. Lists set while
+                 * another is being compiled replace each other, so only
+                 * the last one is compiled.
+                 */
+                uint64_t listsSet = 0;
+                uint64_t listsCompiled = 0;
+
+                /**
+                 * This is how long it took to compile the automaton in
+                 * use, in seconds.
+                 */
+                double compileTime = 0.0;
+            };
+
+        // Lifecycle Management
+        public:
+            ~PhraseFilter() noexcept;
+            PhraseFilter(const PhraseFilter& other) = delete;
+            PhraseFilter(PhraseFilter&&) noexcept = delete;
+            PhraseFilter& operator=(const PhraseFilter& other) = delete;
+            PhraseFilter& operator=(PhraseFilter&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a filter with no phrases, using the default
+             * settings, and starts its thread.
+             */
+            PhraseFilter();
+
+            /**
+             * This constructs a filter with no phrases and starts its
+             * thread.
+             *
+             * @param[in] settings These are the settings of the filter.
+             */
+            explicit PhraseFilter(const Settings& settings);
+
+            /**
+             * This method sets the list of banned phrases. The list is
+             * compiled in the background, and lines are scanned with the
+             * old list until it's done. Empty phrases are left out.
+             *
+             * @param[in] phrases These are the banned phrases.
+             */
+            void SetPhrases(std::vector< Phrase > phrases);
+
+            /**
+             * This method waits until the last list of phrases set is in
+             * use.
+             */
+            void Flush();
+
+            /**
+             * This method looks for banned phrases in a chat line, in the
+             * order in which they end in it.
+             *
+             * @param[in] text This is the text of the chat line.
+             *
+             * @param[in] visitor This is the function to call with each
+             * phrase found.
+             *
+             * @return The number of phrases found is returned.
+             */
+            size_t Scan(
+                std::string_view text,
+                MatchVisitor visitor
+            ) const;
+
+            /**
+             * This method checks whether a chat line has any banned phrase
+             * in it, stopping at the first found.
+             *
+             * @param[in] text This is the text of the chat line.
+             *
+             * @param[out] match This is where to store the phrase found.
+             *
+             * @return an indication of whether or not a banned phrase was
+             * found is returned.
+             */
+            bool Check(
+                std::string_view text,
+                Match& match
+            ) const;
+
+            /**
+             * This method checks whether a message received from the Twitch
+             * server is a PRIVMSG with any banned phrase in its text.
+             *
+             * @param[in] message This is the message received.
+             *
+             * @param[out] match This is where to store the phrase found,
+             * as a range of the last parameter of the message.
+             *
+             * @return an indication of whether or not a banned phrase was
+             * found is returned.
+             */
+            bool Check(
+                const Message& message,
+                Match& match
+            ) const;
+
+            /**
+             * This method returns the measurements of the filter.
+             *
+             * @return The measurements are returned.
+             */
+            Stats GetStats() const;
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_PHRASE_FILTER_HPP */
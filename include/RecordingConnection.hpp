@@ -0,0 +1,68 @@
+#ifndef TWITCH_BOT_RECORDING_CONNECTION_HPP
+#define TWITCH_BOT_RECORDING_CONNECTION_HPP
+
+#include <memory>
+#include <string>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Connection.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TrafficCapture.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This is a Connection which passes everything through to another
+     * Connection, and records each chunk of text received into a capture,
+     * with the time since Connect was called, so that the traffic can be
+     * replayed later.
+     */
+    class RecordingConnection
+        : public Connection
+    {
+        // Lifecycle Management
+        public:
+            ~RecordingConnection() noexcept;
+            RecordingConnection(const RecordingConnection& other) = delete;
+            RecordingConnection(RecordingConnection&&) noexcept = delete;
+            RecordingConnection& operator=(const RecordingConnection& other) = delete;
+            RecordingConnection& operator=(RecordingConnection&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a connection which records another.
+             *
+             * @param[in] connection This is the connection to pass
+             * everything through to.
+             *
+             * @param[in] capture This is where to record the text received.
+             * It must already be open.
+             */
+            RecordingConnection(
+                std::shared_ptr< Connection > connection,
+                std::shared_ptr< CaptureWriter > capture
+            );
+
+        // Connection
+        public:
+            virtual void SetMessageReceivedDelegate(MessageReceivedDelegate messageReceivedDelegate) override;
+            virtual void SetDisconnectedDelegate(DisconnectedDelegate disconnectedDelegate) override;
+            virtual bool Connect() override;
+            virtual bool Disconnect() override;
+            virtual void Send(const std::string& message) override;
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_RECORDING_CONNECTION_HPP */
@@ -0,0 +1,377 @@
+#ifndef TWITCH_BOT_SHARDED_MESSAGE_MANAGER_HPP
+#define TWITCH_BOT_SHARDED_MESSAGE_MANAGER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Executor.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageManager.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/OutboundScheduler.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SymbolTable.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TimeKeeper.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This spreads the channels the bot sits in over several connections to
+     * the Twitch server, called shards. Each shard is a MessageManager, with
+     * its own connection, worker thread and rate limits, so messages from
+     * different shards are parsed in parallel.
+     *
+     * Each channel is assigned to one shard by rendezvous hashing over the
+     * shards which are logged in: the channel goes to the shard with the
+     * highest hash of the channel and shard together. The assignment only
+     * depends on the channel name and which shards are up, so it's stable
+     * from run to run. When a shard drops, only its own channels move, each
+     * to the shard which ranks next for it; when the shard comes back, those
+     * channels move back.
+     *
+     * Everything sent to and received from a channel goes through the
+     * channel's shard, so messages for any one channel stay in order. When
+     * a channel moves, its messages are only handed over from the new shard,
+     * and whatever the old shard receives for it before leaving is dropped.
+     */
+    class ShardedMessageManager
+    {
+        // Types
+        public:
+            /**
+             * @brief This is the type of function used to hand the user each
+             * message received from the Twitch server. It's called from the
+             * worker thread of the shard which received the message, or from
+             * the executor's threads if one is provided.
+             *
+             * @param[in] shard This is the index of the shard.
+             *
+             * @param[in] message This is the message received.
+             */
+            typedef std::function< void(size_t shard, const Message& message) > MessageReceivedDelegate;
+
+            /**
+             * @brief This is the type of function used to notify the user when
+             * a shard logs in or out.
+             *
+             * @param[in] shard This is the index of the shard.
+             */
+            typedef std::function< void(size_t shard) > ShardDelegate;
+
+            /**
+             * This contains measurements of the load on a single shard.
+             */
+            struct ShardStats
+            {
+                /**
+                 * This indicates whether or not the shard is logged in.
+                 */
+                bool loggedIn = false;
+
+                /**
+                 * This is the number of channels assigned to the shard.
+                 */
+                size_t channels = 0;
+
+                /**
+                 * This is the number of messages received by the shard.
+                 */
+                uint64_t messagesReceived = 0;
+
+                /**
+                 * This is the number of times the shard logged in.
+                 */
+                uint64_t logIns = 0;
+
+                /**
+                 * This is the number of times the shard dropped, other than
+                 * by logging out.
+                 */
+                uint64_t drops = 0;
+
+                /**
+                 * This is the number of channels moved to the shard from
+                 * another one.
+                 */
+                uint64_t channelsMovedIn = 0;
+
+                /**
+                 * These are measurements of the lines waiting to be sent by
+                 * the shard.
+                 */
+                OutboundScheduler::Stats outbound;
+
+                /**
+                 * These are measurements of the traffic handled by the
+                 * shard, and how long it took.
+                 */
+                MessageManager::Stats manager;
+            };
+
+        // Lifecycle Management
+        public:
+            ~ShardedMessageManager() noexcept;
+            ShardedMessageManager(const ShardedMessageManager& other) = delete;
+            ShardedMessageManager(ShardedMessageManager&&) noexcept = delete;
+            ShardedMessageManager& operator=(const ShardedMessageManager& other) = delete;
+            ShardedMessageManager& operator=(ShardedMessageManager&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs the shards.
+             *
+             * @param[in] shardCount This is the number of shards. At least
+             * one is always made.
+             */
+            explicit ShardedMessageManager(size_t shardCount);
+
+            /**
+             * @brief This method provides the function each shard uses to
+             * connect to the Twitch server.
+             *
+             * @param[in] connectionFactory This is the method to call in order
+             * to connect to the Twitch server.
+             */
+            void SetConnectionFactory(MessageManager::ConnectionFactory connectionFactory);
+
+            /**
+             * @brief This method provides the means of measuring time for all
+             * shards.
+             *
+             * @param[in] timeKeeper This is the object used to measure elapsed
+             * time periods.
+             */
+            void SetTimeKeeper(std::shared_ptr< TimeKeeper > timeKeeper);
+
+            /**
+             * @brief This method provides a pool of threads, shared by all
+             * shards, on which to call the delegates (see
+             * MessageManager::SetExecutor). The messages of each channel are
+             * handed over on one strand, whichever shard they come from.
+             *
+             * @param[in] executor This is the pool of threads on which to
+             * call the delegates.
+             */
+            void SetExecutor(std::shared_ptr< Executor > executor);
+
+            /**
+             * @brief This method sets whether or not each shard reconnects on
+             * its own when it drops (see MessageManager::SetAutoReconnect).
+             *
+             * @param[in] autoReconnect This indicates whether or not to
+             * reconnect on its own.
+             */
+            void SetAutoReconnect(bool autoReconnect);
+
+            /**
+             * @brief This method sets whether or not each shard keeps a
+             * standby connection ready (see MessageManager::SetWarmStandby).
+             *
+             * @param[in] warmStandby This indicates whether or not to keep
+             * a second connection ready.
+             */
+            void SetWarmStandby(bool warmStandby);
+
+            /**
+             * @brief This method sets how often each shard sends the server
+             * a PING, and how long it waits for the PONG (see
+             * MessageManager::SetKeepAlive).
+             *
+             * @param[in] pingInterval This is how often to send a PING, in
+             * seconds, or zero not to.
+             *
+             * @param[in] pongTimeout This is how long to wait for the PONG,
+             * in seconds.
+             */
+            void SetKeepAlive(double pingInterval, double pongTimeout);
+
+            /**
+             * @brief This method provides the table, shared by all shards, in
+             * which the names of the channels and users of received messages
+             * are interned (see MessageManager::SetSymbolTable). The shards
+             * share a table of their own otherwise, so symbols from any shard
+             * can be compared with each other.
+             *
+             * @param[in] symbolTable This is the table in which to intern
+             * names.
+             */
+            void SetSymbolTable(std::shared_ptr< SymbolTable > symbolTable);
+
+            /**
+             * @brief This method provides the archive, shared by all shards,
+             * into which each message received is added (see
+             * MessageManager::SetChatLog).
+             *
+             * @param[in] chatLog This is the archive to add messages to, or
+             * nullptr for none.
+             */
+            void SetChatLog(std::shared_ptr< ChatLog > chatLog);
+
+            /**
+             * @brief This method provides the full-text index, shared by
+             * all shards, to which each PRIVMSG received is fed (see
+             * MessageManager::SetChatIndex).
+             *
+             * @param[in] chatIndex This is the index to feed messages to,
+             * or nullptr for none.
+             */
+            void SetChatIndex(std::shared_ptr< ChatIndex > chatIndex);
+
+            /**
+             * @brief This method provides the analytics, shared by all
+             * shards, in which each PRIVMSG received is counted (see
+             * MessageManager::SetChatAnalytics).
+             *
+             * @param[in] chatAnalytics These are the analytics in which to
+             * count messages, or nullptr for none.
+             */
+            void SetChatAnalytics(std::shared_ptr< ChatAnalytics > chatAnalytics);
+
+            /**
+             * @brief This method returns the table in which the names of the
+             * channels and users of received messages are interned.
+             *
+             * @return The table in which names are interned is returned.
+             */
+            std::shared_ptr< SymbolTable > GetSymbolTable() const;
+
+            /**
+             * @brief This method sets up a callback to happen for each message
+             * received on any shard.
+             *
+             * @param[in] messageReceivedDelegate This is the function to call.
+             */
+            void SetMessageReceivedDelegate(MessageReceivedDelegate messageReceivedDelegate);
+
+            /**
+             * @brief This method sets up a callback to happen whenever a shard
+             * logs in.
+             *
+             * @param[in] shardLoggedInDelegate This is the function to call.
+             */
+            void SetShardLoggedInDelegate(ShardDelegate shardLoggedInDelegate);
+
+            /**
+             * @brief This method sets up a callback to happen whenever a shard
+             * logs out or drops.
+             *
+             * @param[in] shardLoggedOutDelegate This is the function to call.
+             */
+            void SetShardLoggedOutDelegate(ShardDelegate shardLoggedOutDelegate);
+
+            /**
+             * @brief This method logs every shard into the Twitch server.
+             * Shards already connected are left alone, so calling it again
+             * brings back only the shards which dropped.
+             *
+             * @param[in] nickname This is the nickname associated to the twitch
+             * user account.
+             *
+             * @param[in] token This is the oauth token associated to the user
+             * account used for authentication with the Twitch server.
+             */
+            void LogIn(
+                const std::string& nickname,
+                const std::string& token
+            );
+
+            /**
+             * @brief This method logs every shard out of the Twitch server.
+             * Channels aren't moved between shards while logging out.
+             *
+             * @param[in] farewell this is the message sent back to the Twitch
+             * server just before each connection is closed.
+             */
+            void LogOut(const std::string& farewell);
+
+            /**
+             * @brief This method joins a Twitch chat channel on the shard
+             * assigned to it. If no shard is logged in, the channel is joined
+             * once one is. Twitch channel names are in lower case, so the
+             * name is folded to lower case before it's assigned, here and in
+             * the other methods which take one.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character, in any case.
+             */
+            void Join(const std::string& channel);
+
+            /**
+             * @brief This method leaves a Twitch chat channel.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character, in any case.
+             */
+            void Leave(const std::string& channel);
+
+            /**
+             * @brief This method sends a chat message to a channel, through
+             * the channel's shard.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character, in any case.
+             *
+             * @param[in] text This is the text of the message.
+             */
+            void SendMessage(const std::string& channel, const std::string& text);
+
+            /**
+             * @brief This method sends a moderation command to a channel,
+             * through the channel's shard.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character, in any case.
+             *
+             * @param[in] command This is the command to send.
+             */
+            void SendModeration(const std::string& channel, const std::string& command);
+
+            /**
+             * @brief This method returns the shard which a channel is on.
+             *
+             * @param[in] channel This is the name of the channel, without the
+             * leading hash (#) character, in any case.
+             *
+             * @param[out] shard This is where to store the index of the shard.
+             *
+             * @return an indication of whether or not the channel has been
+             * joined and is assigned to a shard which is logged in is
+             * returned.
+             */
+            bool GetShard(const std::string& channel, size_t& shard);
+
+            /**
+             * @brief This method returns the number of shards.
+             *
+             * @return The number of shards is returned.
+             */
+            size_t GetShardCount() const;
+
+            /**
+             * @brief This method returns measurements of the load on each
+             * shard.
+             *
+             * @return The measurements of each shard, in order, are
+             * returned.
+             */
+            std::vector< ShardStats > GetStats();
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_SHARDED_MESSAGE_MANAGER_HPP */
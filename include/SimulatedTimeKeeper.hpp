@@ -0,0 +1,167 @@
+#ifndef TWITCH_BOT_SIMULATED_TIME_KEEPER_HPP
+#define TWITCH_BOT_SIMULATED_TIME_KEEPER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TimeKeeper.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This is a TimeKeeper whose time only moves when told to, so that
+     * recorded traffic can be replayed with the times at which it was
+     * recorded, however fast it's actually fed in, and so that anything
+     * waiting for time to pass can be tested without waiting for real.
+     *
+     * The time is kept in whole nanoseconds. Timers may be set, and are
+     * fired by the thread which moves the time past their deadlines, in
+     * order of deadline (and in the order they were set, for the same
+     * deadline), with the time set to each timer's deadline while its
+     * function runs. Every time the time is changed, the functions
+     * registered with AddTimeChangedDelegate are called, so that a
+     * MessageManager using the time keeper wakes up to look at its own
+     * timeouts (such as for logging in) and rate limits, rather than
+     * sleeping for real. The functions of timers may set more timers, but
+     * mustn't move the time themselves.
+     */
+    class SimulatedTimeKeeper
+        : public TimeKeeper
+    {
+        // Types
+        public:
+            /**
+             * This is the type of function called when a timer fires.
+             */
+            typedef std::function< void() > Callback;
+
+            /**
+             * This identifies a timer, so that it can be cancelled. Zero is
+             * never used, so it can stand for "no timer".
+             */
+            typedef uint64_t TimerId;
+
+        // Lifecycle Management
+        public:
+            ~SimulatedTimeKeeper() noexcept;
+            SimulatedTimeKeeper(const SimulatedTimeKeeper& other) = delete;
+            SimulatedTimeKeeper(SimulatedTimeKeeper&&) noexcept = delete;
+            SimulatedTimeKeeper& operator=(const SimulatedTimeKeeper& other) = delete;
+            SimulatedTimeKeeper& operator=(SimulatedTimeKeeper&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a time keeper whose time is zero, with no
+             * timers.
+             */
+            SimulatedTimeKeeper();
+
+            /**
+             * This method sets the current time. It may be called from any
+             * thread. If the time moves forward, any timers due by then
+             * are fired first.
+             *
+             * @param[in] time This is the new current time, in seconds.
+             */
+            void SetCurrentTime(double time);
+
+            /**
+             * This method moves the current time forward, firing any timers
+             * due by then. It may be called from any thread.
+             *
+             * @param[in] seconds This is how far to move the time, in
+             * seconds.
+             */
+            void Advance(double seconds);
+
+            /**
+             * This method sets the current time, in nanoseconds. It may be
+             * called from any thread. If the time moves forward, any timers
+             * due by then are fired first.
+             *
+             * @param[in] time This is the new current time, in
+             * nanoseconds.
+             */
+            void SetCurrentTimeNanoseconds(int64_t time);
+
+            /**
+             * This method moves the current time forward, firing any timers
+             * due by then. It may be called from any thread.
+             *
+             * @param[in] nanoseconds This is how far to move the time, in
+             * nanoseconds.
+             */
+            void AdvanceNanoseconds(int64_t nanoseconds);
+
+            /**
+             * This method moves the time forward to the deadline of the
+             * next timer, if there is one, and fires it, along with any
+             * others due at the same time.
+             *
+             * @return an indication of whether or not there was a timer to
+             * fire is returned.
+             */
+            bool AdvanceToNextTimer();
+
+            /**
+             * This method sets a timer. It may be called from any thread,
+             * including from the functions of timers.
+             *
+             * @param[in] deadline This is the time, in nanoseconds, at which
+             * to call the function. If it has already passed, the function
+             * is called the next time the time is moved.
+             *
+             * @param[in] callback This is the function to call.
+             *
+             * @return An identifier for the timer is returned, which may be
+             * used to cancel it.
+             */
+            TimerId Schedule(
+                int64_t deadline,
+                Callback callback
+            );
+
+            /**
+             * This method cancels a timer, if it hasn't fired yet.
+             *
+             * @param[in] id This identifies the timer to cancel.
+             *
+             * @return an indication of whether or not a timer was cancelled
+             * is returned.
+             */
+            bool Cancel(TimerId id);
+
+            /**
+             * This method returns the number of timers set which haven't
+             * fired or been cancelled.
+             *
+             * @return The number of timers is returned.
+             */
+            size_t GetTimerCount() const;
+
+        // TimeKeeper
+        public:
+            virtual double GetCurrentTime() override;
+            virtual int64_t GetCurrentTimeNanoseconds() override;
+            virtual uint64_t AddTimeChangedDelegate(TimeChangedDelegate timeChangedDelegate) override;
+            virtual void RemoveTimeChangedDelegate(uint64_t token) override;
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_SIMULATED_TIME_KEEPER_HPP */
@@ -0,0 +1,121 @@
+#ifndef TWITCH_BOT_SOCKET_CONNECTION_HPP
+#define TWITCH_BOT_SOCKET_CONNECTION_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Connection.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This is a Connection to the Twitch server over a plain TCP socket.
+     *
+     * The socket is non-blocking and serviced by a thread of its own, which
+     * waits on it with epoll. Text passed to Send is queued and the thread
+     * is woken; everything queued by the time it runs is written with a
+     * single writev call, so many small sends turn into few system calls.
+     * Received text is read into a buffer which is reused for every read,
+     * and handed to the message received delegate from the thread. The
+     * disconnected delegate is also called from the thread, when the server
+     * closes its end of the connection.
+     *
+     * Delegates must be set before calling Connect; they're picked up when
+     * the connection is established. A delegate may disconnect, or even
+     * destroy, the connection it's called from; the thread keeps what it
+     * needs alive until it's done.
+     */
+    class SocketConnection
+        : public Connection
+    {
+        // Types
+        public:
+            /**
+             * These are measurements of the traffic over the connection.
+             */
+            struct Stats
+            {
+                /**
+                 * This is the number of bytes written to the socket.
+                 */
+                uint64_t bytesSent = 0;
+
+                /**
+                 * This is the number of bytes read from the socket.
+                 */
+                uint64_t bytesReceived = 0;
+
+                /**
+                 * This is the number of times Send was called.
+                 */
+                uint64_t sends = 0;
+
+                /**
+                 * This is the number of writev calls made.
+                 */
+                uint64_t writes = 0;
+
+                /**
+                 * This is the number of read calls which returned data.
+                 */
+                uint64_t reads = 0;
+            };
+
+        // Lifecycle Management
+        public:
+            ~SocketConnection() noexcept;
+            SocketConnection(const SocketConnection& other) = delete;
+            SocketConnection(SocketConnection&&) noexcept = delete;
+            SocketConnection& operator=(const SocketConnection& other) = delete;
+            SocketConnection& operator=(SocketConnection&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a connection which isn't connected yet.
+             *
+             * @param[in] host This is the name or address of the server.
+             *
+             * @param[in] port This is the TCP port of the server.
+             */
+            SocketConnection(
+                const std::string& host,
+                uint16_t port
+            );
+
+            /**
+             * This method returns measurements of the traffic over the
+             * connection.
+             *
+             * @return The measurements are returned.
+             */
+            Stats GetStats() const;
+
+        // Connection
+        public:
+            virtual void SetMessageReceivedDelegate(MessageReceivedDelegate messageReceivedDelegate) override;
+            virtual void SetDisconnectedDelegate(DisconnectedDelegate disconnectedDelegate) override;
+            virtual bool Connect() override;
+            virtual bool Disconnect() override;
+            virtual void Send(const std::string& message) override;
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance. It's
+             * shared with the thread, which may outlive the connection if
+             * one of the delegates destroys it.
+             */
+            std::shared_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_SOCKET_CONNECTION_HPP */
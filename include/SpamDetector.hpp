@@ -0,0 +1,264 @@
+#ifndef TWITCH_BOT_SPAM_DETECTOR_HPP
+#define TWITCH_BOT_SPAM_DETECTOR_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string_view>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * These are the reasons a chat line may be taken for spam.
+     */
+    enum class SpamReason
+    {
+        /**
+         * The line doesn't look like spam.
+         */
+        None,
+
+        /**
+         * The user has sent the same line several times in a short while.
+         */
+        Repeat,
+
+        /**
+         * The user has sent many lines in a very short while.
+         */
+        Flood,
+
+        /**
+         * Many users have sent the same line to the channel in a short
+         * while, as in a copy-paste raid.
+         */
+        CopyPaste
+    };
+
+    /**
+     * This is what the detector makes of one chat line.
+     */
+    struct SpamVerdict
+    {
+        /**
+         * This is why the line was taken for spam, if it was.
+         */
+        SpamReason reason = SpamReason::None;
+
+        /**
+         * This is the fingerprint of the line (see
+         * SpamDetector::Fingerprint).
+         */
+        uint64_t fingerprint = 0;
+
+        /**
+         * This is how many times the line was seen, counting this one: by
+         * the user for Repeat, by about this many users for CopyPaste, and
+         * the number of lines the user sent for Flood.
+         */
+        uint32_t count = 0;
+    };
+
+    /**
+     * This looks at chat lines as they arrive and picks out spam: the same
+     * line sent over and over by one user, many lines sent at once by one
+     * user, and the same line sent by many users, as in a bot raid.
+     *
+     * Lines are compared by fingerprint, a hash of the text after
+     * normalizing it, so that changes in case, spacing, punctuation,
+     * repeated letters and invisible characters don't make a line look
+     * new. Each user's last few lines in each channel are kept in a table
+     * of fixed size, which forgets the users who have been quiet longest
+     * when it's full. Lines sent by many users are counted in a counting
+     * filter, and each user is counted once per line, using a Bloom filter
+     * of which users sent which lines. Both filters age: each is split
+     * into two halves of the window, and the older half is cleared and
+     * reused as time moves on, so the window is really between a half and
+     * all of its length. The memory used is fixed when the detector is
+     * made, and the counts of users are close, but not exact, as long as
+     * the filters aren't overfull for the traffic.
+     *
+     * The detector isn't safe to use from more than one thread at a time.
+     * It's meant to be fed from the message received delegate of a
+     * MessageManager, or of a TrafficReplayer to measure it.
+     */
+    class SpamDetector
+    {
+        // Types
+        public:
+            /**
+             * These are the thresholds of the detector, and the memory it
+             * may use.
+             */
+            struct Settings
+            {
+                /**
+                 * This is how far back, in seconds, to look for repeats,
+                 * both by one user and by many.
+                 */
+                double window = 30.0;
+
+                /**
+                 * This is how many times one user must send the same line
+                 * within the window for it to be a Repeat. It's at most
+                 * one more than the number of lines kept for each user (7).
+                 */
+                size_t repeatLimit = 3;
+
+                /**
+                 * These are how many lines one user must send to a channel
+                 * within how many seconds for them to be a Flood. The
+                 * number of lines is at most 7.
+                 */
+                size_t floodLimit = 6;
+                double floodWindow = 3.0;
+
+                /**
+                 * This is about how many users must send the same line to a
+                 * channel within the window for it to be CopyPaste.
+                 */
+                size_t crowdLimit = 8;
+
+                /**
+                 * This is the shortest normalized line which may be
+                 * CopyPaste, so that many users saying "gg" or "lol" at
+                 * once isn't taken for a raid.
+                 */
+                size_t minCrowdLength = 12;
+
+                /**
+                 * This is about how much memory the detector may use, in
+                 * bytes.
+                 */
+                size_t memoryBudget = 16 << 20;
+            };
+
+            /**
+             * These are counts of the lines checked, and of those taken for
+             * each kind of spam.
+             */
+            struct Stats
+            {
+                uint64_t lines = 0;
+                uint64_t repeats = 0;
+                uint64_t floods = 0;
+                uint64_t copyPastes = 0;
+            };
+
+        // Lifecycle Management
+        public:
+            ~SpamDetector() noexcept;
+            SpamDetector(const SpamDetector& other) = delete;
+            SpamDetector(SpamDetector&&) noexcept;
+            SpamDetector& operator=(const SpamDetector& other) = delete;
+            SpamDetector& operator=(SpamDetector&&) noexcept;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a detector which has seen no lines, using the
+             * default settings.
+             */
+            SpamDetector();
+
+            /**
+             * This constructs a detector which has seen no lines.
+             *
+             * @param[in] settings These are the thresholds of the detector,
+             * and the memory it may use.
+             */
+            explicit SpamDetector(const Settings& settings);
+
+            /**
+             * This method checks a chat line, and remembers it for checking
+             * the lines after it. It doesn't allocate memory.
+             *
+             * @param[in] channel This is the channel of the chat line.
+             *
+             * @param[in] user This identifies the user who sent the line.
+             *
+             * @param[in] text This is the text of the chat line.
+             *
+             * @param[in] now This is the current time, in seconds. It
+             * shouldn't go backwards.
+             *
+             * @return What the detector makes of the line is returned. If
+             * the line is spam for more than one reason, CopyPaste is given
+             * first, then Repeat, then Flood.
+             */
+            SpamVerdict Check(
+                std::string_view channel,
+                std::string_view user,
+                std::string_view text,
+                double now
+            );
+
+            /**
+             * This method checks a message received from the Twitch server,
+             * if it's a PRIVMSG. Users are identified by their user-id tag
+             * if there is one, and by nickname otherwise.
+             *
+             * @param[in] message This is the message received.
+             *
+             * @param[in] now This is the current time, in seconds.
+             *
+             * @return What the detector makes of the message is returned.
+             */
+            SpamVerdict Check(
+                const Message& message,
+                double now
+            );
+
+            /**
+             * This method returns the counts of lines checked and taken for
+             * spam.
+             *
+             * @return The counts are returned.
+             */
+            Stats GetStats() const;
+
+            /**
+             * This method returns how much memory the detector uses.
+             *
+             * @return The memory used, in bytes, is returned.
+             */
+            size_t GetMemoryUsage() const;
+
+            /**
+             * This function computes the fingerprint of a chat line. ASCII
+             * letters are folded to lower case, ASCII spaces, punctuation
+             * and control characters are left out, as are zero-width
+             * characters and the tag character some clients add to get
+             * around Twitch's own duplicate check, and runs of the same
+             * character count as one.
+             *
+             * @param[in] text This is the text of the chat line.
+             *
+             * @param[out] length This is where to store the number of
+             * characters (bytes) left after normalizing.
+             *
+             * @return The fingerprint is returned.
+             */
+            static uint64_t Fingerprint(
+                std::string_view text,
+                size_t& length
+            );
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_SPAM_DETECTOR_HPP */
@@ -0,0 +1,105 @@
+#ifndef TWITCH_BOT_STEADY_TIME_KEEPER_HPP
+#define TWITCH_BOT_STEADY_TIME_KEEPER_HPP
+
+#include <stdint.h>
+#include <memory>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TimeKeeper.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This is a TimeKeeper which reads a steady clock, one which never
+     * goes backwards and isn't changed when the system time is set, in
+     * whole nanoseconds. Its time starts from some unspecified moment,
+     * such as when the system booted, so it's only good for measuring
+     * time between two readings.
+     *
+     * The time may be read in one of two ways:
+     * - The standard steady clock (CLOCK_MONOTONIC on Linux, which the C
+     *   library reads without a system call).
+     * - The processor's cycle counter (TSC), where it ticks at a constant
+     *   rate whatever the processor's speed or power state, which is cheaper
+     *   still. The rate is measured against the steady clock when the time
+     *   keeper is made, which takes a few milliseconds. After that, the rate
+     *   is adjusted a little each second, so that the time keeper keeps
+     *   step with the steady clock without ever jumping backwards.
+     *
+     * Any number of threads may read the time at once.
+     */
+    class SteadyTimeKeeper
+        : public TimeKeeper
+    {
+        // Types
+        public:
+            /**
+             * These are the ways the time may be read.
+             */
+            enum class Source
+            {
+                /**
+                 * The standard steady clock is used.
+                 */
+                SteadyClock,
+
+                /**
+                 * The processor's cycle counter is used, measured against
+                 * the standard steady clock.
+                 */
+                CycleCounter
+            };
+
+        // Lifecycle Management
+        public:
+            ~SteadyTimeKeeper() noexcept;
+            SteadyTimeKeeper(const SteadyTimeKeeper& other) = delete;
+            SteadyTimeKeeper(SteadyTimeKeeper&&) noexcept = delete;
+            SteadyTimeKeeper& operator=(const SteadyTimeKeeper& other) = delete;
+            SteadyTimeKeeper& operator=(SteadyTimeKeeper&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a time keeper which reads the standard steady
+             * clock.
+             */
+            SteadyTimeKeeper();
+
+            /**
+             * This constructs a time keeper which reads the time in the
+             * given way, if it can. The cycle counter is only used on x86
+             * processors whose counter ticks at a constant rate; otherwise
+             * the standard steady clock is used.
+             *
+             * @param[in] source This is the way to read the time.
+             */
+            explicit SteadyTimeKeeper(Source source);
+
+            /**
+             * This method returns the way the time is actually read.
+             *
+             * @return The way the time is read is returned.
+             */
+            Source GetSource() const;
+
+        // TimeKeeper
+        public:
+            virtual double GetCurrentTime() override;
+            virtual int64_t GetCurrentTimeNanoseconds() override;
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_STEADY_TIME_KEEPER_HPP */
@@ -0,0 +1,220 @@
+#ifndef TWITCH_BOT_SYMBOL_TABLE_HPP
+#define TWITCH_BOT_SYMBOL_TABLE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace TwitchBot
+{
+    /**
+     * This gives each distinct name, such as a channel or user name, a
+     * small number (a symbol), so that names can be compared, hashed and
+     * stored as numbers rather than as strings.
+     *
+     * Symbols are handed out in order from 1, and are never taken back, so
+     * the table only grows. Each name is stored once, and the name of a
+     * symbol stays valid as long as the table does. Since nothing is ever
+     * freed, only names of which there are few, such as channels, or which
+     * something is waiting for, should be interned. Other names, such as
+     * the senders of every chat line, should only be looked up with Find.
+     *
+     * Any number of threads may use the table at once. Looking up the name
+     * of a symbol doesn't lock at all, and interning a name already in the
+     * table only takes a shared lock on one of several parts of the table.
+     * A thread interning many names should go through a Cache, which avoids
+     * even that for names it has seen recently.
+     */
+    class SymbolTable
+    {
+        // Types
+        public:
+            /**
+             * This is the type of a symbol.
+             */
+            typedef uint32_t Symbol;
+
+            /**
+             * This is never the symbol of a name. It stands for no name.
+             */
+            static constexpr Symbol NO_SYMBOL = 0;
+
+            /**
+             * This is a cache of recently interned names, for use by one
+             * thread at a time. Each cache slot holds a copy of a short name
+             * and its symbol in one cache line, so a hit costs a hash of the
+             * name and a comparison within the slot, without locking or
+             * touching the table. Longer names always go to the table.
+             */
+            class Cache
+            {
+                // Lifecycle Management
+                public:
+                    ~Cache() noexcept;
+                    Cache(const Cache& other) = delete;
+                    Cache(Cache&&) noexcept;
+                    Cache& operator=(const Cache& other) = delete;
+                    Cache& operator=(Cache&&) noexcept;
+
+                // Beginning of Public Methods
+                public:
+                    /**
+                     * This constructs a cache in front of the given table.
+                     *
+                     * @param[in] table This is the table in which names are
+                     * interned.
+                     */
+                    explicit Cache(std::shared_ptr< SymbolTable > table);
+
+                    /**
+                     * This method returns the symbol of the given name,
+                     * adding the name to the table if it isn't there yet.
+                     *
+                     * @param[in] name This is the name to intern.
+                     *
+                     * @return The symbol of the name is returned, or
+                     * NO_SYMBOL if the name is empty.
+                     */
+                    Symbol Intern(std::string_view name);
+
+                    /**
+                     * This method returns the symbol of the given name,
+                     * without adding the name to the table. Names found
+                     * are kept in the cache, but names which aren't in the
+                     * table are not, since they may be added later.
+                     *
+                     * @param[in] name This is the name to look up.
+                     *
+                     * @return The symbol of the name is returned, or
+                     * NO_SYMBOL if the name isn't in the table.
+                     */
+                    Symbol Find(std::string_view name);
+
+                    /**
+                     * This method returns the table behind the cache.
+                     *
+                     * @return The table behind the cache is returned.
+                     */
+                    const std::shared_ptr< SymbolTable >& GetTable() const;
+
+                private:
+                    /**
+                     * This is the longest name kept in the cache. Twitch
+                     * login names are at most 25 characters, and rarely
+                     * more than this.
+                     */
+                    static constexpr size_t MAX_NAME_LENGTH = 23;
+
+                    /**
+                     * This is one slot of the cache.
+                     */
+                    struct Entry
+                    {
+                        uint32_t hash = 0;
+                        Symbol symbol = NO_SYMBOL;
+                        uint8_t length = 0;
+                        char name[MAX_NAME_LENGTH];
+                    };
+
+                    /**
+                     * This is the table in which names are interned.
+                     */
+                    std::shared_ptr< SymbolTable > table_;
+
+                    /**
+                     * These are the slots of the cache.
+                     */
+                    std::vector< Entry > entries_;
+            };
+
+        // Lifecycle Management
+        public:
+            ~SymbolTable() noexcept;
+            SymbolTable(const SymbolTable& other) = delete;
+            SymbolTable(SymbolTable&&) noexcept = delete;
+            SymbolTable& operator=(const SymbolTable& other) = delete;
+            SymbolTable& operator=(SymbolTable&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * Default constructor
+             */
+            SymbolTable();
+
+            /**
+             * This method returns the symbol of the given name, adding the
+             * name to the table if it isn't there yet. Names are compared
+             * exactly, so differences in case make different names.
+             *
+             * @param[in] name This is the name to intern.
+             *
+             * @return The symbol of the name is returned, or NO_SYMBOL if
+             * the name is empty.
+             */
+            Symbol Intern(std::string_view name);
+
+            /**
+             * This method returns the symbol of the given name, without
+             * adding the name to the table.
+             *
+             * @param[in] name This is the name to look up.
+             *
+             * @return The symbol of the name is returned, or NO_SYMBOL if
+             * the name isn't in the table.
+             */
+            Symbol Find(std::string_view name) const;
+
+            /**
+             * This method returns the name of the given symbol.
+             *
+             * @param[in] symbol This is the symbol whose name to return.
+             *
+             * @return The name of the symbol is returned, or an empty
+             * string if it isn't a symbol from this table.
+             */
+            std::string_view GetName(Symbol symbol) const;
+
+            /**
+             * This method returns the number of names in the table.
+             *
+             * @return The number of names in the table is returned.
+             */
+            size_t GetCount() const;
+
+            /**
+             * This method returns about how much memory the table uses,
+             * including the names themselves and the indexes into them.
+             *
+             * @return The memory used, in bytes, is returned.
+             */
+            size_t GetMemoryUsage() const;
+
+            /**
+             * This method returns the hash of a name used by the table, so
+             * that callers can keep their own caches of symbols.
+             *
+             * @param[in] name This is the name to hash.
+             *
+             * @return The hash of the name is returned.
+             */
+            static uint64_t Hash(std::string_view name);
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_SYMBOL_TABLE_HPP */
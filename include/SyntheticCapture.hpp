@@ -0,0 +1,85 @@
+#ifndef TWITCH_BOT_SYNTHETIC_CAPTURE_HPP
+#define TWITCH_BOT_SYNTHETIC_CAPTURE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace TwitchBot
+{
+    /**
+     * These are the settings of a synthetic capture (see
+     * WriteSyntheticCapture).
+     */
+    struct SyntheticCaptureSettings
+    {
+        /**
+         * This picks the traffic made. The same settings always make the
+         * same capture, byte for byte.
+         */
+        uint64_t seed = 1;
+
+        /**
+         * This is the number of chat lines (PRIVMSG) in the capture.
+         */
+        size_t chatLines = 200000;
+
+        /**
+         * These are the number of users chatting, and of channels they
+         * chat in. Each user chats about as often as any other, but the
+         * first channels are far busier than the rest, as they are in
+         * real traffic.
+         */
+        size_t users = 20000;
+        size_t channels = 4;
+
+        /**
+         * This is the rate at which chat lines arrive, across all the
+         * channels, in lines per second of capture time.
+         */
+        double chatLinesPerSecond = 2000.0;
+
+        /**
+         * This is how many bytes the server hands over at once. Lines are
+         * cut wherever a chunk ends, as they are when read from a socket.
+         */
+        size_t chunkSize = 16384;
+
+        /**
+         * This is the fraction of chat lines which are a copy-paste raid:
+         * the same line, dressed up in different ways, sent by many new
+         * users at once.
+         */
+        double raidFraction = 0.02;
+    };
+
+    /**
+     * This function writes a capture file (see CaptureWriter) of made-up
+     * traffic from the Twitch server, as a bot which has logged in and
+     * joined some busy channels would receive it, so that replays (see
+     * TrafficReplayer) can be compared from one build to another without
+     * a recording of real traffic.
+     *
+     * Chat lines carry the tags the server sends with them, some with
+     * emotes and text outside of ASCII, among the other messages a bot
+     * sees: the welcome, JOINs, ROOMSTATE, PINGs, subscription and raid
+     * notices, and bans.
+     *
+     * @param[in] path This is the path of the capture file to write.
+     *
+     * @param[in] settings These are the settings of the capture.
+     *
+     * @param[out] messages This is where to store the number of messages
+     * (lines) written.
+     *
+     * @return an indication of whether or not the capture was written is
+     * returned.
+     */
+    bool WriteSyntheticCapture(
+        const std::string& path,
+        const SyntheticCaptureSettings& settings,
+        uint64_t& messages
+    );
+}
+
+#endif /* TWITCH_BOT_SYNTHETIC_CAPTURE_HPP */
@@ -0,0 +1,327 @@
+#ifndef TWITCH_BOT_TASK_HPP
+#define TWITCH_BOT_TASK_HPP
+
+#include <stddef.h>
+
+/**
+ * The coroutine parts of the library are only built when the compiler
+ * supports C++20 coroutines. The library and the programs using it must
+ * be built with the same setting.
+ */
+#if defined(__cpp_impl_coroutine) && (__cpp_impl_coroutine >= 201902L)
+#define TWITCH_BOT_COROUTINES 1
+#endif
+
+#ifdef TWITCH_BOT_COROUTINES
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace TwitchBot
+{
+    /**
+     * This function allocates memory for the frame of a coroutine. Frames
+     * are kept in pools by size, each thread keeping a few of each size on
+     * hand, so that starting a coroutine usually doesn't go to the heap,
+     * even when coroutines start on one thread and finish on another.
+     *
+     * @param[in] size This is the size of the frame, in bytes.
+     *
+     * @return The memory for the frame is returned.
+     */
+    void* AllocateCoroutineFrame(size_t size);
+
+    /**
+     * This function gives back memory allocated by AllocateCoroutineFrame.
+     * It may be called from any thread.
+     *
+     * @param[in] frame This is the memory to give back.
+     *
+     * @param[in] size This is the size of the frame, in bytes, as given to
+     * AllocateCoroutineFrame.
+     */
+    void FreeCoroutineFrame(void* frame, size_t size);
+
+    template< typename T > class Task;
+
+    /**
+     * This holds what every Task's coroutine needs to remember, whatever
+     * it returns.
+     */
+    class TaskPromiseBase
+    {
+        // Types
+        public:
+            /**
+             * This is what a task does when it finishes: hand control to the
+             * coroutine awaiting it, if any, or clean up after itself if no
+             * one is.
+             */
+            struct FinalAwaiter
+            {
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                template< typename Promise > std::coroutine_handle<> await_suspend(
+                    std::coroutine_handle< Promise > handle
+                ) noexcept
+                {
+                    auto& promise = handle.promise();
+                    if (promise.continuation_)
+                    {
+                        return promise.continuation_;
+                    }
+                    if (promise.detached_)
+                    {
+                        handle.destroy();
+                    }
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept
+                {
+                }
+            };
+
+        // Beginning of Public Methods
+        public:
+            static void* operator new(size_t size)
+            {
+                return AllocateCoroutineFrame(size);
+            }
+
+            static void operator delete(void* frame, size_t size)
+            {
+                FreeCoroutineFrame(frame, size);
+            }
+
+            std::suspend_always initial_suspend() const noexcept
+            {
+                return {};
+            }
+
+            FinalAwaiter final_suspend() const noexcept
+            {
+                return {};
+            }
+
+            void unhandled_exception() noexcept
+            {
+                if (detached_)
+                {
+                    // No one is waiting to hear about it.
+                    std::terminate();
+                }
+                exception_ = std::current_exception();
+            }
+
+        protected:
+            /**
+             * This method throws the exception which ended the task, if any.
+             */
+            void RethrowIfFailed() const
+            {
+                if (exception_ != nullptr)
+                {
+                    std::rethrow_exception(exception_);
+                }
+            }
+
+        private:
+            template< typename T > friend class Task;
+
+            /**
+             * This is the coroutine awaiting the task, if any.
+             */
+            std::coroutine_handle<> continuation_;
+
+            /**
+             * This indicates whether or not the task was started with no one
+             * to await it, so that it cleans up after itself.
+             */
+            bool detached_ = false;
+
+            /**
+             * This is the exception which ended the task, if any.
+             */
+            std::exception_ptr exception_;
+    };
+
+    /**
+     * This is the promise of a Task which returns a value.
+     */
+    template< typename T > class TaskPromise
+        : public TaskPromiseBase
+    {
+        public:
+            Task< T > get_return_object() noexcept;
+
+            template< typename Value > void return_value(Value&& value)
+            {
+                value_.emplace(std::forward< Value >(value));
+            }
+
+            T TakeResult()
+            {
+                RethrowIfFailed();
+                return std::move(*value_);
+            }
+
+        private:
+            std::optional< T > value_;
+    };
+
+    /**
+     * This is the promise of a Task which doesn't return a value.
+     */
+    template<> class TaskPromise< void >
+        : public TaskPromiseBase
+    {
+        public:
+            Task< void > get_return_object() noexcept;
+
+            void return_void() noexcept
+            {
+            }
+
+            void TakeResult()
+            {
+                RethrowIfFailed();
+            }
+    };
+
+    /**
+     * This is the return type of a coroutine which may await other tasks
+     * and the operations of a MessageManager, such as:
+     *
+     *     TwitchBot::Task< bool > Greet(TwitchBot::MessageManager& manager)
+     *     {
+     *         if (!co_await manager.JoinAsync("channel", 10.0))
+     *         {
+     *             co_return false;
+     *         }
+     *         manager.SendMessage("channel", "Hello!");
+     *         co_return true;
+     *     }
+     *
+     * A task doesn't run until it's awaited, or started with Start. Its
+     * frame comes from the pools of AllocateCoroutineFrame.
+     *
+     * @tparam T This is the type of value the coroutine returns.
+     */
+    template< typename T = void > class Task
+    {
+        // Types
+        public:
+            typedef TaskPromise< T > promise_type;
+
+        // Lifecycle Management
+        public:
+            ~Task() noexcept
+            {
+                if (handle_)
+                {
+                    handle_.destroy();
+                }
+            }
+            Task(const Task& other) = delete;
+            Task(Task&& other) noexcept
+                : handle_(std::exchange(other.handle_, nullptr))
+            {
+            }
+            Task& operator=(const Task& other) = delete;
+            Task& operator=(Task&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    if (handle_)
+                    {
+                        handle_.destroy();
+                    }
+                    handle_ = std::exchange(other.handle_, nullptr);
+                }
+                return *this;
+            }
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a task which takes over the given coroutine.
+             *
+             * @param[in] handle This is the coroutine of the task.
+             */
+            explicit Task(std::coroutine_handle< promise_type > handle) noexcept
+                : handle_(handle)
+            {
+            }
+
+            /**
+             * This method starts the task on the calling thread, with no one
+             * to await it. The task cleans up after itself when it finishes,
+             * and what it returns is thrown away. It must not end with an
+             * exception.
+             */
+            void Start() &&
+            {
+                auto handle = std::exchange(handle_, nullptr);
+                handle.promise().detached_ = true;
+                handle.resume();
+            }
+
+            /**
+             * This method lets one coroutine await another, running it until
+             * it finishes and then picking up where it left off, without
+             * going through the caller.
+             */
+            auto operator co_await() && noexcept
+            {
+                struct Awaiter
+                {
+                    std::coroutine_handle< promise_type > handle;
+
+                    bool await_ready() const noexcept
+                    {
+                        return !handle || handle.done();
+                    }
+
+                    std::coroutine_handle<> await_suspend(
+                        std::coroutine_handle<> continuation
+                    ) noexcept
+                    {
+                        handle.promise().continuation_ = continuation;
+                        return handle;
+                    }
+
+                    T await_resume()
+                    {
+                        return handle.promise().TakeResult();
+                    }
+                };
+                return Awaiter{handle_};
+            }
+
+        private:
+            /**
+             * This is the coroutine of the task, if the task still owns it.
+             */
+            std::coroutine_handle< promise_type > handle_;
+    };
+
+    template< typename T > Task< T > TaskPromise< T >::get_return_object() noexcept
+    {
+        return Task< T >(std::coroutine_handle< TaskPromise< T > >::from_promise(*this));
+    }
+
+    inline Task< void > TaskPromise< void >::get_return_object() noexcept
+    {
+        return Task< void >(std::coroutine_handle< TaskPromise< void > >::from_promise(*this));
+    }
+}
+
+#endif /* TWITCH_BOT_COROUTINES */
+
+#endif /* TWITCH_BOT_TASK_HPP */
@@ -1,3 +1,9 @@
+#ifndef TWITCH_BOT_TIME_KEEPER_HPP
+#define TWITCH_BOT_TIME_KEEPER_HPP
+
+#include <math.h>
+#include <stdint.h>
+#include <functional>
 
 namespace TwitchBot
 {
@@ -6,9 +12,26 @@ namespace TwitchBot
      * This represents the time Keeping requirements of the Twitch::Server. To
      * integrate the Twitch::Server into a larger program, implement this
      * interface in terms of the actual server time.
+     *
+     * Time may be given either as seconds, in floating point, or as whole
+     * nanoseconds. Implementations need only give one; the other is worked
+     * out from it.
      */
     class TimeKeeper
     {
+        // Types
+        public:
+            /**
+             * This is the type of function called when the time changes
+             * other than by the passing of real time, such as when a
+             * simulated time is moved forward.
+             */
+            typedef std::function< void() > TimeChangedDelegate;
+
+        // Lifecycle Management
+        public:
+            virtual ~TimeKeeper() noexcept = default;
+
         public:
         // Methods
 
@@ -18,5 +41,49 @@ namespace TwitchBot
          * @return The current server time, in seconds.
          */
         virtual double GetCurrentTime() = 0;
+
+        /**
+         * This method returns the current server time, in nanoseconds. By
+         * default it's worked out from GetCurrentTime.
+         *
+         * @return The current server time, in nanoseconds.
+         */
+        virtual int64_t GetCurrentTimeNanoseconds()
+        {
+            return (int64_t)llround(GetCurrentTime() * 1e9);
+        }
+
+        /**
+         * This method registers a function to call whenever the time changes
+         * other than by the passing of real time, so that anything waiting
+         * for a time to come can look again. By default the time only ever
+         * passes, and the function is never called.
+         *
+         * @param[in] timeChangedDelegate This is the function to call. It
+         * may be called from any thread.
+         *
+         * @return A token is returned which may be given to
+         * RemoveTimeChangedDelegate to unregister the function.
+         */
+        virtual uint64_t AddTimeChangedDelegate(TimeChangedDelegate timeChangedDelegate)
+        {
+            (void)timeChangedDelegate;
+            return 0;
+        }
+
+        /**
+         * This method unregisters a function registered by
+         * AddTimeChangedDelegate. Once it returns, the function isn't being
+         * called and won't be again.
+         *
+         * @param[in] token This is the token returned when the function was
+         * registered.
+         */
+        virtual void RemoveTimeChangedDelegate(uint64_t token)
+        {
+            (void)token;
+        }
     };
-}
\ No newline at end of file
+}
+
+#endif /* TWITCH_BOT_TIME_KEEPER_HPP */
@@ -0,0 +1,236 @@
+#ifndef TWITCH_BOT_TIMER_WHEEL_HPP
+#define TWITCH_BOT_TIMER_WHEEL_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+namespace TwitchBot
+{
+    /**
+     * This keeps track of any number of timers, and calls each one's
+     * function once its deadline has passed.
+     *
+     * Timers are kept in a hierarchy of wheels of 64 slots each. The first
+     * wheel has one slot per tick, and each slot of the next wheel covers a
+     * whole turn of the one before it. Scheduling and cancelling a timer
+     * take constant time. As time advances, the timers in a slot of an outer
+     * wheel are moved to the inner wheels, until they reach the first wheel
+     * and expire.
+     *
+     * Time is measured in ticks, whose length is up to the user. The wheel is
+     * not thread-safe; it's meant to be owned by one worker thread.
+     */
+    class TimerWheel
+    {
+        // Types
+        public:
+            /**
+             * This is the type of function called when a timer expires.
+             */
+            typedef std::function< void() > Callback;
+
+            /**
+             * This identifies a scheduled timer, so that it can be cancelled.
+             * Zero is never used, so it can stand for "no timer".
+             */
+            typedef uint64_t TimerId;
+
+        // Lifecycle Management
+        public:
+            ~TimerWheel() noexcept;
+            TimerWheel(const TimerWheel& other) = delete;
+            TimerWheel(TimerWheel&&) noexcept = delete;
+            TimerWheel& operator=(const TimerWheel& other) = delete;
+            TimerWheel& operator=(TimerWheel&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * This constructs a wheel with no timers.
+             *
+             * @param[in] now This is the current time, in ticks.
+             */
+            explicit TimerWheel(uint64_t now = 0);
+
+            /**
+             * This method schedules a function to be called once the given
+             * time has been reached.
+             *
+             * @param[in] deadline This is the time, in ticks, at which to
+             * call the function. If it has already passed, the function is
+             * called the next time the wheel is advanced.
+             *
+             * @param[in] callback This is the function to call.
+             *
+             * @return An identifier for the timer is returned, which may be
+             * used to cancel it.
+             */
+            TimerId Schedule(uint64_t deadline, Callback callback);
+
+            /**
+             * This method cancels a timer, if it hasn't expired yet.
+             *
+             * @param[in] id This identifies the timer to cancel. Identifiers
+             * of timers which have already expired or been cancelled are
+             * ignored.
+             *
+             * @return an indication of whether or not a timer was cancelled
+             * is returned.
+             */
+            bool Cancel(TimerId id);
+
+            /**
+             * This method moves the current time forward, calling the
+             * functions of all timers whose deadlines are reached, in order
+             * of deadline.
+             *
+             * Functions may schedule and cancel timers.
+             *
+             * @param[in] now This is the current time, in ticks. Time never
+             * moves backwards; an earlier time is ignored.
+             *
+             * @return The number of timers which expired is returned.
+             */
+            size_t Advance(uint64_t now);
+
+            /**
+             * This method returns when the wheel next needs to be advanced.
+             *
+             * @param[out] deadline This is where to store the time, in ticks.
+             * It's exact for timers due within 64 ticks. For later timers
+             * it may be earlier than the actual deadline, since those timers
+             * first need to be moved to an inner wheel.
+             *
+             * @return an indication of whether or not there are any timers
+             * is returned.
+             */
+            bool GetNextDeadline(uint64_t& deadline) const;
+
+            /**
+             * This method returns the current time of the wheel.
+             *
+             * @return The time, in ticks, the wheel was last advanced to.
+             */
+            uint64_t GetNow() const;
+
+            /**
+             * This method returns the number of timers scheduled.
+             *
+             * @return The number of timers which haven't yet expired or been
+             * cancelled.
+             */
+            size_t GetCount() const;
+
+            /**
+             * This method returns an indication of whether or not there are
+             * no timers scheduled.
+             *
+             * @return true if there are no timers.
+             */
+            bool Empty() const;
+
+        private:
+            /**
+             * This holds a single timer.
+             */
+            struct Node
+            {
+                /**
+                 * This is when the timer expires, in ticks.
+                 */
+                uint64_t deadline = 0;
+
+                /**
+                 * This is the function to call when the timer expires.
+                 */
+                Callback callback;
+
+                /**
+                 * These link the nodes in the same slot, or in the list of
+                 * unused nodes.
+                 */
+                uint32_t previous = 0;
+                uint32_t next = 0;
+
+                /**
+                 * This is increased every time the node is reused, so that
+                 * identifiers of old timers don't match new ones.
+                 */
+                uint32_t generation = 0;
+
+                /**
+                 * This is the slot which holds the node, or all bits set if
+                 * the node isn't in any slot.
+                 */
+                uint32_t slot = 0xFFFFFFFF;
+            };
+
+            /**
+             * This method places a node into the slot matching its deadline.
+             */
+            void Insert(uint32_t index);
+
+            /**
+             * This method adds a node to the end of the given slot.
+             */
+            void Link(uint32_t index, uint32_t slot);
+
+            /**
+             * This method removes a node from its slot.
+             */
+            void Unlink(uint32_t index);
+
+            /**
+             * This method returns a node to the list of unused nodes.
+             */
+            void Release(uint32_t index);
+
+            /**
+             * This method finds the slot holding the timers which expire
+             * first, and the time at which that slot is reached.
+             */
+            bool FindNextSlot(uint32_t& slot, uint64_t& expiration) const;
+
+            /**
+             * These are all the nodes, used or not.
+             */
+            std::vector< Node > nodes_;
+
+            /**
+             * This is the first of each slot's nodes. The last slot holds
+             * timers which are due and waiting to be called.
+             */
+            std::vector< uint32_t > heads_;
+
+            /**
+             * This is the last of each slot's nodes, so that timers which
+             * become due together are called in the order they were placed.
+             */
+            std::vector< uint32_t > tails_;
+
+            /**
+             * For each wheel, this has a bit set for each slot which holds
+             * any nodes.
+             */
+            std::vector< uint64_t > occupied_;
+
+            /**
+             * This is the first unused node.
+             */
+            uint32_t freeList_;
+
+            /**
+             * This is the time, in ticks, the wheel was last advanced to.
+             */
+            uint64_t now_ = 0;
+
+            /**
+             * This is the number of timers scheduled.
+             */
+            size_t count_ = 0;
+    };
+}
+
+#endif /* TWITCH_BOT_TIMER_WHEEL_HPP */
@@ -0,0 +1,221 @@
+#ifndef TWITCH_BOT_TRAFFIC_CAPTURE_HPP
+#define TWITCH_BOT_TRAFFIC_CAPTURE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace TwitchBot
+{
+    /**
+     * This writes a capture file: the raw text received from the Twitch
+     * server, chunk by chunk, exactly as the connection handed it over,
+     * along with when each chunk arrived.
+     *
+     * The file starts with an 8 byte signature. Each chunk follows as the
+     * time since the previous chunk, in nanoseconds, and the length of the
+     * chunk, both as variable-length integers (7 bits per byte, low bits
+     * first), and then the text itself. Chunks are gathered in memory and
+     * written in large blocks.
+     */
+    class CaptureWriter
+    {
+        // Lifecycle Management
+        public:
+            ~CaptureWriter() noexcept;
+            CaptureWriter(const CaptureWriter& other) = delete;
+            CaptureWriter(CaptureWriter&&) noexcept = delete;
+            CaptureWriter& operator=(const CaptureWriter& other) = delete;
+            CaptureWriter& operator=(CaptureWriter&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * Default constructor
+             */
+            CaptureWriter();
+
+            /**
+             * This method creates the capture file, replacing any file
+             * already there.
+             *
+             * @param[in] path This is the path of the file.
+             *
+             * @return an indication of whether or not the file was created
+             * is returned.
+             */
+            bool Open(const std::string& path);
+
+            /**
+             * This method adds a chunk to the capture. It may be called from
+             * any thread.
+             *
+             * @param[in] time This is when the chunk arrived, in nanoseconds
+             * since any fixed point. It must not go backwards.
+             *
+             * @param[in] data This is the text received.
+             */
+            void Record(uint64_t time, std::string_view data);
+
+            /**
+             * This method writes out everything recorded and closes the
+             * file.
+             *
+             * @return an indication of whether or not everything recorded
+             * was written is returned.
+             */
+            bool Close();
+
+            /**
+             * This method returns the number of chunks recorded.
+             *
+             * @return The number of chunks recorded is returned.
+             */
+            uint64_t GetRecordCount() const;
+
+        private:
+            /**
+             * This method writes out the chunks gathered in memory. The
+             * mutex must be held.
+             */
+            void Flush();
+
+            /**
+             * This is used to synchronize access to the object.
+             */
+            mutable std::mutex mutex_;
+
+            /**
+             * This is the file descriptor of the capture file, or -1 if it
+             * isn't open.
+             */
+            int file_ = -1;
+
+            /**
+             * These are the chunks not yet written to the file.
+             */
+            std::string buffer_;
+
+            /**
+             * This is when the previous chunk arrived.
+             */
+            uint64_t lastTime_ = 0;
+
+            /**
+             * This is the number of chunks recorded.
+             */
+            uint64_t recordCount_ = 0;
+
+            /**
+             * This indicates whether or not any write to the file failed.
+             */
+            bool failed_ = false;
+    };
+
+    /**
+     * This reads a capture file written by CaptureWriter. The file is
+     * mapped into memory, so chunks are handed out as views into it without
+     * being copied. A file which was cut short, such as by a crash while
+     * recording, reads up to its last complete chunk.
+     */
+    class CaptureReader
+    {
+        // Types
+        public:
+            /**
+             * This is one chunk of text from the capture.
+             */
+            struct Record
+            {
+                /**
+                 * This is when the chunk arrived, in nanoseconds since the
+                 * recording started.
+                 */
+                uint64_t time = 0;
+
+                /**
+                 * This is the text received. It stays valid while the file
+                 * is open.
+                 */
+                std::string_view data;
+            };
+
+        // Lifecycle Management
+        public:
+            ~CaptureReader() noexcept;
+            CaptureReader(const CaptureReader& other) = delete;
+            CaptureReader(CaptureReader&&) noexcept = delete;
+            CaptureReader& operator=(const CaptureReader& other) = delete;
+            CaptureReader& operator=(CaptureReader&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * Default constructor
+             */
+            CaptureReader();
+
+            /**
+             * This method opens a capture file and maps it into memory.
+             *
+             * @param[in] path This is the path of the file.
+             *
+             * @return an indication of whether or not the file was opened,
+             * and is a capture file, is returned.
+             */
+            bool Open(const std::string& path);
+
+            /**
+             * This method unmaps and closes the capture file.
+             */
+            void Close();
+
+            /**
+             * This method reads the next chunk from the capture.
+             *
+             * @param[out] record This is where to store the chunk.
+             *
+             * @return an indication of whether or not there was another
+             * complete chunk is returned.
+             */
+            bool Next(Record& record);
+
+            /**
+             * This method goes back to the first chunk of the capture.
+             */
+            void Rewind();
+
+            /**
+             * This method returns the size of the capture file.
+             *
+             * @return The size of the capture file, in bytes, is returned.
+             */
+            size_t GetSize() const;
+
+        private:
+            /**
+             * This points to the capture file mapped into memory, or is
+             * nullptr if no file is open.
+             */
+            const char* data_ = nullptr;
+
+            /**
+             * This is the size of the capture file.
+             */
+            size_t size_ = 0;
+
+            /**
+             * This is the offset of the next chunk in the file.
+             */
+            size_t position_ = 0;
+
+            /**
+             * This is when the previous chunk arrived.
+             */
+            uint64_t time_ = 0;
+    };
+}
+
+#endif /* TWITCH_BOT_TRAFFIC_CAPTURE_HPP */
@@ -0,0 +1,198 @@
+#ifndef TWITCH_BOT_TRAFFIC_REPLAYER_HPP
+#define TWITCH_BOT_TRAFFIC_REPLAYER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageManager.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SpamDetector.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This feeds a capture of traffic from the Twitch server (see
+     * CaptureWriter) through a MessageManager, and measures how fast the
+     * manager handles it.
+     *
+     * The capture is handed to the manager through a stand-in Connection,
+     * chunk by chunk, and a SimulatedTimeKeeper is set to the time each
+     * chunk was recorded, so that timeouts and rate limits behave as they
+     * did while recording. Chunks are fed either as fast as the manager
+     * takes them, or spaced out as they were recorded.
+     *
+     * The latency of a chunk is the time from handing it to the manager
+     * until the last message completed by it has been handed to the
+     * message received delegate.
+     *
+     * If a SpamDetector is given, it checks each message as it's delivered,
+     * at the time its chunk was recorded, and the detection latency of a
+     * message taken for spam is the time from handing the manager the chunk
+     * which completed it until the detector's verdict.
+     */
+    class TrafficReplayer
+    {
+        // Types
+        public:
+            /**
+             * These are the ways in which the capture can be fed.
+             */
+            enum class Pace
+            {
+                /**
+                 * Feed each chunk as soon as the manager takes it.
+                 */
+                FullSpeed,
+
+                /**
+                 * Feed each chunk at the time it was recorded, measured
+                 * from the start of the replay.
+                 */
+                RealTime
+            };
+
+            /**
+             * These are the measurements of a replay.
+             */
+            struct Report
+            {
+                /**
+                 * This is the number of chunks fed.
+                 */
+                uint64_t chunks = 0;
+
+                /**
+                 * This is the number of bytes fed.
+                 */
+                uint64_t bytes = 0;
+
+                /**
+                 * This is the number of valid messages in the capture.
+                 */
+                uint64_t messages = 0;
+
+                /**
+                 * This is the number of messages handed to the message
+                 * received delegate. It's less than messages if the manager
+                 * lost any.
+                 */
+                uint64_t messagesDelivered = 0;
+
+                /**
+                 * This is how long the capture took to record, in seconds.
+                 */
+                double captureSeconds = 0.0;
+
+                /**
+                 * This is how long the replay took, in seconds, from feeding
+                 * the first chunk to delivering the last message.
+                 */
+                double seconds = 0.0;
+
+                /**
+                 * These are the rates at which messages were delivered and
+                 * bytes were fed.
+                 */
+                double messagesPerSecond = 0.0;
+                double bytesPerSecond = 0.0;
+
+                /**
+                 * These are the median, 99th and 99.9th percentile chunk
+                 * latencies, in microseconds.
+                 */
+                double latencyP50 = 0.0;
+                double latencyP99 = 0.0;
+                double latencyP999 = 0.0;
+
+                /**
+                 * This is the number of messages the spam detector, if any,
+                 * took for spam.
+                 */
+                uint64_t spamMessages = 0;
+
+                /**
+                 * These are the median, 99th and 99.9th percentile
+                 * detection latencies, in microseconds.
+                 */
+                double detectionLatencyP50 = 0.0;
+                double detectionLatencyP99 = 0.0;
+                double detectionLatencyP999 = 0.0;
+
+                /**
+                 * These are the manager's own measurements of the replay.
+                 */
+                MessageManager::Stats manager;
+            };
+
+        // Lifecycle Management
+        public:
+            ~TrafficReplayer() noexcept;
+            TrafficReplayer(const TrafficReplayer& other) = delete;
+            TrafficReplayer(TrafficReplayer&&) noexcept = delete;
+            TrafficReplayer& operator=(const TrafficReplayer& other) = delete;
+            TrafficReplayer& operator=(TrafficReplayer&&) noexcept = delete;
+
+        // Beginning of Public Methods
+        public:
+            /**
+             * Default constructor
+             */
+            TrafficReplayer();
+
+            /**
+             * @brief This method sets up a callback to happen for each
+             * message the manager receives during a replay, as the work
+             * being measured along with the manager's own.
+             *
+             * @param[in] messageReceivedDelegate This is the function to
+             * call.
+             */
+            void SetMessageReceivedDelegate(MessageManager::MessageReceivedDelegate messageReceivedDelegate);
+
+            /**
+             * @brief This method sets up a spam detector to check each
+             * message the manager receives during a replay, measuring how
+             * soon spam is detected. The detector is used only from the
+             * manager's worker thread.
+             *
+             * @param[in] spamDetector This is the detector to use, or
+             * nullptr for none.
+             */
+            void SetSpamDetector(std::shared_ptr< SpamDetector > spamDetector);
+
+            /**
+             * @brief This method replays a capture through a new
+             * MessageManager.
+             *
+             * @param[in] path This is the path of the capture file.
+             *
+             * @param[in] pace This is how fast to feed the capture.
+             *
+             * @param[out] report This is where to store the measurements.
+             *
+             * @return an indication of whether or not the capture was
+             * replayed is returned.
+             */
+            bool Replay(
+                const std::string& path,
+                Pace pace,
+                Report& report
+            );
+
+        private:
+            /**
+             * A struct that contains the private properties of the instance.
+             * This is defined within the implementation and declared here to
+             * ensure that it is scoped within the class.
+             */
+            struct Impl;
+
+            /**
+             * This contains the private properties of the instance.
+             */
+            std::unique_ptr< Impl > impl_;
+    };
+}
+
+#endif /* TWITCH_BOT_TRAFFIC_REPLAYER_HPP */
@@ -0,0 +1,833 @@
+#include <math.h>
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/ChatAnalytics.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/EmoteDecoder.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Hashing.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SymbolTable.hpp>
+
+namespace
+{
+    /**
+     * These are the fewest and most bits of user-id hashes which may pick
+     * HyperLogLog registers.
+     */
+    constexpr size_t MIN_USER_PRECISION = 4;
+    constexpr size_t MAX_USER_PRECISION = 18;
+
+    /**
+     * This is the number of seconds for which messages are counted.
+     */
+    constexpr int64_t RATE_SECONDS = 64;
+
+    /**
+     * This is the number of bytes kept of each word or emote name, counting
+     * its length.
+     */
+    constexpr size_t TOP_TEXT_SIZE = 32;
+
+    /**
+     * This is mixed into the hash of each emote id, so that emotes and
+     * words are counted apart in the Count-Min sketch.
+     */
+    constexpr uint64_t EMOTE_SEED = 0x3C6EF372FE94F82B;
+
+    /**
+     * This holds, for each byte, the byte to use for it in a word (ASCII
+     * letters folded to lower case), or zero if it's not part of words.
+     */
+    struct WordCharacters
+    {
+        char map[256] = {};
+
+        constexpr WordCharacters()
+        {
+            for (int c = 0; c < 256; ++c)
+            {
+                if (
+                    ((c >= '0') && (c <= '9'))
+                    || ((c >= 'a') && (c <= 'z'))
+                    || (c >= 0x80)
+                )
+                {
+                    map[c] = (char)c;
+                }
+                else if ((c >= 'A') && (c <= 'Z'))
+                {
+                    map[c] = (char)(c - 'A' + 'a');
+                }
+            }
+        }
+    };
+    constexpr WordCharacters WORD_CHARACTERS;
+
+    /**
+     * This holds 2 to the power of minus each register value.
+     */
+    struct InversePowers
+    {
+        double values[66] = {};
+
+        constexpr InversePowers()
+        {
+            double value = 1.0;
+            for (auto& entry: values)
+            {
+                entry = value;
+                value /= 2.0;
+            }
+        }
+    };
+    constexpr InversePowers INVERSE_POWERS;
+
+    /**
+     * This is a HyperLogLog sketch, which estimates how many different
+     * hashes it has seen.
+     */
+    class UserSketch
+    {
+    public:
+        explicit UserSketch(size_t precision)
+            : precision_((unsigned int)precision)
+            , registers_((size_t)1 << precision)
+        {
+            Clear();
+        }
+
+        void Add(uint64_t hash)
+        {
+            const auto index = (size_t)(hash >> (64 - precision_));
+            const auto rank = (uint8_t)(
+                __builtin_clzll((hash << precision_) | ((uint64_t)1 << (precision_ - 1))) + 1
+            );
+            auto& value = registers_[index];
+            if (rank > value)
+            {
+                // Keep the sum over the registers up to date, so that an
+                // estimate needn't go over them.
+                inverseSum_ += INVERSE_POWERS.values[rank] - INVERSE_POWERS.values[value];
+                if (value == 0)
+                {
+                    --zeros_;
+                }
+                value = rank;
+            }
+        }
+
+        uint64_t Estimate() const
+        {
+            const auto count = (double)registers_.size();
+            const auto alpha = (
+                (registers_.size() >= 128)
+                ? (0.7213 / (1.0 + 1.079 / count))
+                : (registers_.size() >= 64)
+                ? 0.709
+                : (registers_.size() >= 32)
+                ? 0.697
+                : 0.673
+            );
+            const auto estimate = alpha * count * count / inverseSum_;
+
+            // For small counts, where many registers are still zero, count
+            // those instead (linear counting).
+            if (
+                (estimate <= 2.5 * count)
+                && (zeros_ > 0)
+            )
+            {
+                return (uint64_t)llround(count * log(count / (double)zeros_));
+            }
+            return (uint64_t)llround(estimate);
+        }
+
+        void Clear()
+        {
+            std::fill(registers_.begin(), registers_.end(), (uint8_t)0);
+            inverseSum_ = (double)registers_.size();
+            zeros_ = registers_.size();
+        }
+
+        size_t GetMemoryUsage() const
+        {
+            return registers_.capacity();
+        }
+
+    private:
+        unsigned int precision_;
+        std::vector< uint8_t > registers_;
+        double inverseSum_ = 0.0;
+        size_t zeros_ = 0;
+    };
+
+    /**
+     * This is a Count-Min sketch, which estimates, never too low, how many
+     * times each hash has been seen.
+     */
+    class CountSketch
+    {
+    public:
+        CountSketch(size_t depth, size_t width)
+            : depth_(depth)
+        {
+            width_ = 2;
+            while (width_ < width)
+            {
+                width_ *= 2;
+            }
+            counters_.resize(depth_ * width_);
+        }
+
+        /**
+         * This counts a hash the given number of times, raising only the
+         * counters which would be below the new estimate, and returns the
+         * new estimate.
+         */
+        uint32_t Add(uint64_t hash, uint32_t times)
+        {
+            // Each row picks its counter with its own combination of two
+            // halves of the hash.
+            const auto first = (uint32_t)hash;
+            const auto step = (uint32_t)(hash >> 32) | 1;
+            const auto mask = (uint32_t)(width_ - 1);
+            uint32_t* picked[MAX_DEPTH];
+            uint32_t smallest = UINT32_MAX;
+            for (size_t row = 0; row < depth_; ++row)
+            {
+                picked[row] = &counters_[row * width_ + ((first + (uint32_t)row * step) & mask)];
+                smallest = std::min(smallest, *picked[row]);
+            }
+            const auto estimate = (
+                (smallest > UINT32_MAX - times)
+                ? UINT32_MAX
+                : smallest + times
+            );
+            for (size_t row = 0; row < depth_; ++row)
+            {
+                *picked[row] = std::max(*picked[row], estimate);
+            }
+            return estimate;
+        }
+
+        void Halve(unsigned int times)
+        {
+            for (auto& counter: counters_)
+            {
+                counter >>= times;
+            }
+        }
+
+        size_t GetMemoryUsage() const
+        {
+            return counters_.capacity() * sizeof(uint32_t);
+        }
+
+        /**
+         * This is the most rows a sketch may have.
+         */
+        static constexpr size_t MAX_DEPTH = 8;
+
+    private:
+        size_t depth_;
+        size_t width_ = 0;
+        std::vector< uint32_t > counters_;
+    };
+
+    /**
+     * This keeps the words or emotes with the highest counts, in a heap
+     * with the lowest count on top, so that the one to drop for a new one
+     * is always at hand.
+     */
+    class TopHeap
+    {
+    public:
+        struct Entry
+        {
+            uint32_t count;
+            std::array< char, TOP_TEXT_SIZE > text;
+        };
+
+        explicit TopHeap(size_t capacity)
+            : capacity_(capacity)
+        {
+            hashes_.reserve(capacity);
+            entries_.reserve(capacity);
+        }
+
+        /**
+         * This gives the new count of a word or emote, which is taken in if
+         * it's not already in the heap and its count is higher than the
+         * lowest one in it.
+         */
+        void Offer(uint64_t hash, uint32_t count, std::string_view text)
+        {
+            // The heap is small enough that looking through its hashes one
+            // after another is quicker than keeping a map of them.
+            size_t i = 0;
+            while (
+                (i < hashes_.size())
+                && (hashes_[i] != hash)
+            )
+            {
+                ++i;
+            }
+            if (i < hashes_.size())
+            {
+                entries_[i].count = count;
+                SiftDown(i);
+                return;
+            }
+            if (hashes_.size() < capacity_)
+            {
+                hashes_.push_back(hash);
+                entries_.push_back(MakeEntry(count, text));
+                SiftUp(hashes_.size() - 1);
+                return;
+            }
+            if (
+                !entries_.empty()
+                && (count > entries_[0].count)
+            )
+            {
+                hashes_[0] = hash;
+                entries_[0] = MakeEntry(count, text);
+                SiftDown(0);
+            }
+        }
+
+        void Halve(unsigned int times)
+        {
+            // Halving every count keeps them in heap order.
+            for (auto& entry: entries_)
+            {
+                entry.count >>= times;
+            }
+        }
+
+        const std::vector< Entry >& GetEntries() const
+        {
+            return entries_;
+        }
+
+        size_t GetMemoryUsage() const
+        {
+            return hashes_.capacity() * sizeof(uint64_t) + entries_.capacity() * sizeof(Entry);
+        }
+
+    private:
+        static Entry MakeEntry(uint32_t count, std::string_view text)
+        {
+            Entry entry;
+            entry.count = count;
+            const auto length = std::min(text.length(), TOP_TEXT_SIZE - 1);
+            entry.text[0] = (char)length;
+            std::copy(text.begin(), text.begin() + length, entry.text.begin() + 1);
+            return entry;
+        }
+
+        void Swap(size_t a, size_t b)
+        {
+            std::swap(hashes_[a], hashes_[b]);
+            std::swap(entries_[a], entries_[b]);
+        }
+
+        void SiftUp(size_t i)
+        {
+            while (i > 0)
+            {
+                const auto parent = (i - 1) / 2;
+                if (entries_[parent].count <= entries_[i].count)
+                {
+                    break;
+                }
+                Swap(i, parent);
+                i = parent;
+            }
+        }
+
+        void SiftDown(size_t i)
+        {
+            for (;;)
+            {
+                auto smallest = i;
+                const auto left = 2 * i + 1;
+                const auto right = left + 1;
+                if (
+                    (left < entries_.size())
+                    && (entries_[left].count < entries_[smallest].count)
+                )
+                {
+                    smallest = left;
+                }
+                if (
+                    (right < entries_.size())
+                    && (entries_[right].count < entries_[smallest].count)
+                )
+                {
+                    smallest = right;
+                }
+                if (smallest == i)
+                {
+                    break;
+                }
+                Swap(i, smallest);
+                i = smallest;
+            }
+        }
+
+        size_t capacity_;
+        std::vector< uint64_t > hashes_;
+        std::vector< Entry > entries_;
+    };
+
+    /**
+     * This returns the entries of a heap, most used first.
+     */
+    std::vector< TwitchBot::ChatAnalytics::TopEntry > GetTopEntries(
+        const std::vector< TopHeap::Entry >& entries
+    )
+    {
+        std::vector< TwitchBot::ChatAnalytics::TopEntry > top;
+        top.reserve(entries.size());
+        for (const auto& entry: entries)
+        {
+            TwitchBot::ChatAnalytics::TopEntry topEntry;
+            topEntry.text.assign(entry.text.data() + 1, (size_t)(unsigned char)entry.text[0]);
+            topEntry.count = entry.count;
+            top.push_back(std::move(topEntry));
+        }
+        std::sort(
+            top.begin(),
+            top.end(),
+            [](const TwitchBot::ChatAnalytics::TopEntry& a, const TwitchBot::ChatAnalytics::TopEntry& b)
+            {
+                return a.count > b.count;
+            }
+        );
+        return top;
+    }
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a ChatAnalytics instance.
+     */
+    struct ChatAnalytics::Impl
+    {
+        // Types
+
+        /**
+         * These are the measurements of one channel.
+         */
+        struct Channel
+        {
+            std::mutex mutex;
+            std::string name;
+            uint64_t messages = 0;
+
+            /**
+             * These are the counts of messages of each of the last
+             * RATE_SECONDS seconds, by second modulo RATE_SECONDS, and the
+             * latest second counted.
+             */
+            std::array< uint32_t, RATE_SECONDS > perSecond{};
+            int64_t lastSecond = 0;
+
+            /**
+             * These count the users since the channel was first seen, in
+             * the current window, and in the last whole window, and
+             * number the current window.
+             */
+            UserSketch users;
+            UserSketch windowUsers;
+            uint64_t lastWindowUsers = 0;
+            int64_t window = 0;
+
+            /**
+             * These count words and emotes, and keep the most used.
+             */
+            CountSketch counts;
+            TopHeap topWords;
+            TopHeap topEmotes;
+
+            /**
+             * This finds the emotes of each chat line, reusing its storage
+             * from one line to the next.
+             */
+            EmoteDecoder emoteDecoder;
+
+            explicit Channel(const Settings& settings)
+                : users(settings.userPrecision)
+                , windowUsers(settings.userPrecision)
+                , counts(settings.sketchDepth, settings.sketchWidth)
+                , topWords(settings.topCount)
+                , topEmotes(settings.topCount)
+            {
+            }
+        };
+
+        // Properties
+
+        /**
+         * These are the settings of the analytics.
+         */
+        Settings settings;
+
+        /**
+         * This is used to synchronize access to the channels. Feeding in a
+         * message and taking a snapshot only take it shared.
+         */
+        mutable std::shared_mutex mutex;
+
+        /**
+         * These are the channels seen, by name.
+         */
+        std::unordered_map< std::string, std::unique_ptr< Channel > > channels;
+
+        // Methods
+
+        explicit Impl(const Settings& newSettings)
+            : settings(newSettings)
+        {
+            settings.userPrecision = std::min(
+                std::max(settings.userPrecision, MIN_USER_PRECISION),
+                MAX_USER_PRECISION
+            );
+            settings.sketchDepth = std::min(
+                std::max(settings.sketchDepth, (size_t)1),
+                CountSketch::MAX_DEPTH
+            );
+            if (settings.topCount == 0)
+            {
+                settings.topCount = 1;
+            }
+            if (!(settings.window > 0.0))
+            {
+                settings.window = 60.0;
+            }
+        }
+
+        /**
+         * This method finds the given channel, adding it if it hasn't been
+         * seen before.
+         */
+        Channel& GetChannel(std::string_view name)
+        {
+            const std::string key(name);
+            {
+                std::shared_lock< decltype(mutex) > lock(mutex);
+                const auto channel = channels.find(key);
+                if (channel != channels.end())
+                {
+                    return *channel->second;
+                }
+            }
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            auto& channel = channels[key];
+            if (channel == nullptr)
+            {
+                channel = std::make_unique< Channel >(settings);
+                channel->name = key;
+            }
+            return *channel;
+        }
+
+        /**
+         * This method moves a channel on to the window of time with the
+         * given number, if it's not there already. The channel's mutex must
+         * be held.
+         */
+        void MoveToWindow(Channel& channel, int64_t window)
+        {
+            if (window <= channel.window)
+            {
+                return;
+            }
+            channel.lastWindowUsers = (
+                (window == channel.window + 1)
+                ? channel.windowUsers.Estimate()
+                : 0
+            );
+            channel.windowUsers.Clear();
+            const auto windowsPassed = (unsigned int)std::min< int64_t >(window - channel.window, 32);
+            channel.counts.Halve(windowsPassed);
+            channel.topWords.Halve(windowsPassed);
+            channel.topEmotes.Halve(windowsPassed);
+            channel.window = window;
+        }
+
+        /**
+         * This method counts the emotes of a chat line, given its emotes
+         * tag. The channel's mutex must be held.
+         */
+        void CountEmotes(
+            Channel& channel,
+            std::string_view text,
+            std::string_view emotes
+        )
+        {
+            // The emote is used once for each of its spans, which are next
+            // to each other, and its name is taken from the first.
+            (void)channel.emoteDecoder.Decode(emotes, text);
+            const auto& spans = channel.emoteDecoder.GetSpans();
+            for (size_t i = 0; i < spans.size();)
+            {
+                const auto& span = spans[i];
+                size_t next = i + 1;
+                while (
+                    (next < spans.size())
+                    && (spans[next].id.data() == span.id.data())
+                )
+                {
+                    ++next;
+                }
+                const auto hash = Mix(SymbolTable::Hash(span.id) ^ EMOTE_SEED);
+                const auto count = channel.counts.Add(hash, (uint32_t)(next - i));
+                channel.topEmotes.Offer(hash, count, text.substr(span.begin, span.end - span.begin));
+                i = next;
+            }
+        }
+
+        /**
+         * These are the measurements of a channel as copied out of it, to
+         * be made into a snapshot without holding its mutex.
+         */
+        struct ChannelCopy
+        {
+            ChannelSnapshot snapshot;
+            std::array< uint32_t, RATE_SECONDS > perSecond;
+            int64_t lastSecond = 0;
+            std::vector< TopHeap::Entry > topWords;
+            std::vector< TopHeap::Entry > topEmotes;
+        };
+
+        /**
+         * This method copies the measurements of a channel, taking its
+         * mutex only while copying.
+         */
+        void CopyChannel(
+            Channel& channel,
+            ChannelCopy& copy
+        ) const
+        {
+            copy.topWords.reserve(settings.topCount);
+            copy.topEmotes.reserve(settings.topCount);
+            std::lock_guard< decltype(channel.mutex) > lock(channel.mutex);
+            copy.snapshot.messages = channel.messages;
+            copy.snapshot.users = channel.users.Estimate();
+            copy.snapshot.windowUsers = channel.windowUsers.Estimate();
+            copy.snapshot.lastWindowUsers = channel.lastWindowUsers;
+            copy.perSecond = channel.perSecond;
+            copy.lastSecond = channel.lastSecond;
+            copy.topWords.assign(channel.topWords.GetEntries().begin(), channel.topWords.GetEntries().end());
+            copy.topEmotes.assign(channel.topEmotes.GetEntries().begin(), channel.topEmotes.GetEntries().end());
+        }
+
+        /**
+         * This method makes a snapshot from the copied measurements of a
+         * channel.
+         */
+        static void FinishSnapshot(
+            const Channel& channel,
+            ChannelCopy& copy,
+            double now,
+            ChannelSnapshot& snapshot
+        )
+        {
+            snapshot = std::move(copy.snapshot);
+            snapshot.channel = channel.name;
+
+            // Add up the counts of the seconds before the current one which
+            // are still kept.
+            const auto second = (int64_t)floor(now);
+            uint64_t sums[3] = {0, 0, 0};
+            const int64_t spans[3] = {1, 10, 60};
+            for (int64_t past = 1; past <= spans[2]; ++past)
+            {
+                const auto counted = second - past;
+                if (
+                    (counted > copy.lastSecond)
+                    || (counted <= copy.lastSecond - RATE_SECONDS)
+                )
+                {
+                    continue;
+                }
+                const auto count = copy.perSecond[(size_t)(counted & (RATE_SECONDS - 1))];
+                for (size_t i = 0; i < 3; ++i)
+                {
+                    if (past <= spans[i])
+                    {
+                        sums[i] += count;
+                    }
+                }
+            }
+            snapshot.messagesPerSecond = (double)sums[0] / (double)spans[0];
+            snapshot.messagesPerSecond10 = (double)sums[1] / (double)spans[1];
+            snapshot.messagesPerSecond60 = (double)sums[2] / (double)spans[2];
+            snapshot.topWords = GetTopEntries(copy.topWords);
+            snapshot.topEmotes = GetTopEntries(copy.topEmotes);
+        }
+    };
+
+    ChatAnalytics::~ChatAnalytics() noexcept = default;
+
+    ChatAnalytics::ChatAnalytics()
+        : impl_(new Impl(Settings()))
+    {
+    }
+
+    ChatAnalytics::ChatAnalytics(const Settings& settings)
+        : impl_(new Impl(settings))
+    {
+    }
+
+    bool ChatAnalytics::Add(
+        const Message& message,
+        double now
+    )
+    {
+        if (
+            (message.GetKnownCommand() != KnownCommand::Privmsg)
+            || (message.parameters.size() < 2)
+        )
+        {
+            return false;
+        }
+        auto user = message.tags.GetRawValue(KnownTag::UserId);
+        if (user.empty())
+        {
+            user = message.GetNickname();
+        }
+        Add(message.GetChannelName(), user, message.parameters.back(), message.tags.GetEmotes(), now);
+        return true;
+    }
+
+    void ChatAnalytics::Add(
+        std::string_view channelName,
+        std::string_view user,
+        std::string_view text,
+        std::string_view emotes,
+        double now
+    )
+    {
+        auto& impl = *impl_;
+        auto& channel = impl.GetChannel(channelName);
+        std::lock_guard< decltype(channel.mutex) > lock(channel.mutex);
+        impl.MoveToWindow(channel, (int64_t)floor(now / impl.settings.window));
+
+        // Count the message in its second, clearing the counts of any
+        // seconds skipped since the last message.
+        const auto second = (int64_t)floor(now);
+        if (second > channel.lastSecond)
+        {
+            const auto skipped = std::min(second - channel.lastSecond, RATE_SECONDS);
+            for (int64_t i = 1; i <= skipped; ++i)
+            {
+                channel.perSecond[(size_t)((channel.lastSecond + i) & (RATE_SECONDS - 1))] = 0;
+            }
+            channel.lastSecond = second;
+        }
+        ++channel.perSecond[(size_t)(channel.lastSecond & (RATE_SECONDS - 1))];
+        ++channel.messages;
+
+        // The symbol table's hash only has to spread names over its slots,
+        // so mix it further before its top bits pick HyperLogLog registers.
+        const auto userHash = Mix(SymbolTable::Hash(user));
+        channel.users.Add(userHash);
+        channel.windowUsers.Add(userHash);
+
+        // Count each word, folded to lower case.
+        char word[TOP_TEXT_SIZE];
+        size_t length = 0;
+        size_t wordLength = 0;
+        const auto countWord = [&]{
+            const std::string_view kept(word, length);
+            const auto hash = Mix(SymbolTable::Hash(kept) ^ wordLength);
+            const auto count = channel.counts.Add(hash, 1);
+            channel.topWords.Offer(hash, count, kept);
+        };
+        for (const auto c: text)
+        {
+            const auto mapped = WORD_CHARACTERS.map[(unsigned char)c];
+            if (mapped != 0)
+            {
+                if (length < TOP_TEXT_SIZE - 1)
+                {
+                    word[length++] = mapped;
+                }
+                ++wordLength;
+            }
+            else if (wordLength > 0)
+            {
+                countWord();
+                length = 0;
+                wordLength = 0;
+            }
+        }
+        if (wordLength > 0)
+        {
+            countWord();
+        }
+        if (!emotes.empty())
+        {
+            impl.CountEmotes(channel, text, emotes);
+        }
+    }
+
+    auto ChatAnalytics::GetSnapshot(double now) const -> std::vector< ChannelSnapshot >
+    {
+        std::vector< ChannelSnapshot > snapshots;
+        std::shared_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+        snapshots.resize(impl_->channels.size());
+        size_t i = 0;
+        Impl::ChannelCopy copy;
+        for (const auto& channel: impl_->channels)
+        {
+            impl_->CopyChannel(*channel.second, copy);
+            Impl::FinishSnapshot(*channel.second, copy, now, snapshots[i++]);
+        }
+        return snapshots;
+    }
+
+    bool ChatAnalytics::GetSnapshot(
+        std::string_view channelName,
+        double now,
+        ChannelSnapshot& snapshot
+    ) const
+    {
+        std::shared_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+        const auto channel = impl_->channels.find(std::string(channelName));
+        if (channel == impl_->channels.end())
+        {
+            return false;
+        }
+        Impl::ChannelCopy copy;
+        impl_->CopyChannel(*channel->second, copy);
+        Impl::FinishSnapshot(*channel->second, copy, now, snapshot);
+        return true;
+    }
+
+    size_t ChatAnalytics::GetMemoryUsage() const
+    {
+        std::shared_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+        size_t memoryUsage = sizeof(Impl);
+        for (const auto& channel: impl_->channels)
+        {
+            memoryUsage += (
+                sizeof(Impl::Channel)
+                + channel.first.capacity()
+                + channel.second->name.capacity()
+                + channel.second->users.GetMemoryUsage()
+                + channel.second->windowUsers.GetMemoryUsage()
+                + channel.second->counts.GetMemoryUsage()
+                + channel.second->topWords.GetMemoryUsage()
+                + channel.second->topEmotes.GetMemoryUsage()
+            );
+        }
+        return memoryUsage;
+    }
+}
@@ -0,0 +1,1413 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/ChatIndex.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Hashing.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MpscQueue.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SymbolTable.hpp>
+
+namespace
+{
+    /**
+     * This is the number of bytes of each word which count.
+     */
+    constexpr size_t MAX_WORD_LENGTH = 64;
+
+    /**
+     * This is the number of messages in a posting list between skip
+     * entries.
+     */
+    constexpr uint32_t SKIP_INTERVAL = 64;
+
+    /**
+     * This is the most segments kept before runs of segments are merged
+     * even if they're lopsided, for each segment merged at once.
+     */
+    constexpr size_t MAX_SEGMENTS_PER_MERGE_FACTOR = 4;
+
+    /**
+     * These are mixed into the user-id of a message, and the symbol of its
+     * channel, to make the words which stand for them in the index.
+     */
+    constexpr uint64_t USER_WORD_SEED = 0x5BE0CD19137E2179;
+    constexpr uint64_t CHANNEL_WORD_SEED = 0x1F83D9ABFB41BD6B;
+
+    /**
+     * This is the number before the first message of a posting list, so
+     * that the first difference is one more than the number of the first
+     * message.
+     */
+    constexpr uint32_t NO_MESSAGE = 0xFFFFFFFF;
+
+    /**
+     * This is the position of the words which stand for the user and
+     * channel of a message, which aren't anywhere in its text.
+     */
+    constexpr uint32_t NO_POSITION = 0xFFFFFFFF;
+
+    /**
+     * This holds, for each byte, the byte to use for it in a word (ASCII
+     * letters folded to lower case), or zero if it's not part of words.
+     */
+    struct WordCharacters
+    {
+        char map[256] = {};
+
+        constexpr WordCharacters()
+        {
+            for (int c = 0; c < 256; ++c)
+            {
+                if (
+                    ((c >= '0') && (c <= '9'))
+                    || ((c >= 'a') && (c <= 'z'))
+                    || (c >= 0x80)
+                )
+                {
+                    map[c] = (char)c;
+                }
+                else if ((c >= 'A') && (c <= 'Z'))
+                {
+                    map[c] = (char)(c - 'A' + 'a');
+                }
+            }
+        }
+    };
+    constexpr WordCharacters WORD_CHARACTERS;
+
+    /**
+     * This returns the steady clock time, in nanoseconds.
+     */
+    int64_t GetSteadyTime()
+    {
+        return std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    /**
+     * This splits the given text into words, and calls the given function
+     * with the hash of each, in order.
+     */
+    template< typename Handler > void ForEachWord(
+        std::string_view text,
+        Handler&& handler
+    )
+    {
+        char word[MAX_WORD_LENGTH];
+        size_t length = 0;
+        bool inWord = false;
+        for (const auto c: text)
+        {
+            const auto mapped = WORD_CHARACTERS.map[(unsigned char)c];
+            if (mapped != 0)
+            {
+                if (length < MAX_WORD_LENGTH)
+                {
+                    word[length++] = mapped;
+                }
+                inWord = true;
+            }
+            else if (inWord)
+            {
+                handler(TwitchBot::SymbolTable::Hash(std::string_view(word, length)));
+                length = 0;
+                inWord = false;
+            }
+        }
+        if (inWord)
+        {
+            handler(TwitchBot::SymbolTable::Hash(std::string_view(word, length)));
+        }
+    }
+
+    /**
+     * These return the words which stand for a user and a channel.
+     */
+    uint64_t GetUserWord(uint64_t userId)
+    {
+        return TwitchBot::Mix(userId ^ USER_WORD_SEED);
+    }
+    uint64_t GetChannelWord(TwitchBot::SymbolTable::Symbol channel)
+    {
+        return TwitchBot::Mix((uint64_t)channel ^ CHANNEL_WORD_SEED);
+    }
+
+    /**
+     * This adds a variable-length integer to the end of the given buffer.
+     */
+    void WriteNumber(std::vector< uint8_t >& buffer, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            buffer.push_back((uint8_t)(value | 0x80));
+            value >>= 7;
+        }
+        buffer.push_back((uint8_t)value);
+    }
+
+    /**
+     * This reads a variable-length integer, and moves past it.
+     */
+    inline uint32_t ReadNumber(const uint8_t*& input)
+    {
+        uint32_t value = *input++;
+        if (value < 0x80)
+        {
+            return value;
+        }
+        value &= 0x7F;
+        for (unsigned int shift = 7;; shift += 7)
+        {
+            const uint32_t byte = *input++;
+            value |= (byte & 0x7F) << shift;
+            if (byte < 0x80)
+            {
+                return value;
+            }
+        }
+    }
+
+    /**
+     * This moves past the given number of variable-length integers.
+     */
+    inline const uint8_t* SkipNumbers(const uint8_t* input, uint32_t count)
+    {
+        while (count > 0)
+        {
+            if (*input++ < 0x80)
+            {
+                --count;
+            }
+        }
+        return input;
+    }
+
+    /**
+     * This is a chat line waiting to be indexed.
+     */
+    struct PendingMessage
+    {
+        /**
+         * These are when the line was sent, in seconds since the UNIX
+         * epoch, and the user-id of the user who sent it.
+         */
+        double time = 0.0;
+        uint64_t userId = 0;
+
+        /**
+         * This is when the line was fed in, by the steady clock, in
+         * nanoseconds.
+         */
+        int64_t addedAt = 0;
+
+        /**
+         * These are the lengths of the channel and nickname at the start
+         * of strings, which are followed by the text of the line.
+         */
+        uint32_t channelLength = 0;
+        uint32_t userLength = 0;
+        std::string strings;
+    };
+
+    /**
+     * This is one word of a segment, and where its posting list is.
+     */
+    struct Term
+    {
+        /**
+         * This is the hash of the word.
+         */
+        uint64_t word = 0;
+
+        /**
+         * These are where the posting list starts, and where its skip
+         * entries start, in those of the segment.
+         */
+        uint32_t postings = 0;
+        uint32_t skips = 0;
+
+        /**
+         * This is the number of messages in the posting list.
+         */
+        uint32_t count = 0;
+    };
+
+    /**
+     * This is one skip entry of a posting list, at the start of every
+     * SKIP_INTERVAL messages after the first ones.
+     */
+    struct Skip
+    {
+        /**
+         * This is the number of the message just before the skip entry.
+         */
+        uint32_t lastMessage = 0;
+
+        /**
+         * This is where the next message starts in the postings of the
+         * segment.
+         */
+        uint32_t offset = 0;
+    };
+
+    /**
+     * This is a batch of messages indexed together. It never changes once
+     * made.
+     */
+    struct Segment
+    {
+        /**
+         * These are the time, user-id and channel symbol of each message.
+         */
+        std::vector< double > times;
+        std::vector< uint64_t > userIds;
+        std::vector< TwitchBot::SymbolTable::Symbol > channels;
+
+        /**
+         * These are the nickname and text of each message, one after the
+         * other, and where each starts, with one more at the end.
+         */
+        std::string strings;
+        std::vector< uint32_t > stringOffsets{0};
+
+        /**
+         * These are the words in the segment, sorted by hash, their posting
+         * lists, and the skip entries of the lists.
+         */
+        std::vector< Term > terms;
+        std::vector< uint8_t > postings;
+        std::vector< Skip > skips;
+
+        /**
+         * These are the earliest and latest times of the messages.
+         */
+        double firstTime = std::numeric_limits< double >::infinity();
+        double lastTime = -std::numeric_limits< double >::infinity();
+
+        /**
+         * This adds a message to the segment, without indexing it.
+         */
+        void AddMessage(
+            double time,
+            uint64_t userId,
+            TwitchBot::SymbolTable::Symbol channel,
+            std::string_view user,
+            std::string_view text
+        )
+        {
+            times.push_back(time);
+            userIds.push_back(userId);
+            channels.push_back(channel);
+            strings.append(user);
+            stringOffsets.push_back((uint32_t)strings.length());
+            strings.append(text);
+            stringOffsets.push_back((uint32_t)strings.length());
+            firstTime = std::min(firstTime, time);
+            lastTime = std::max(lastTime, time);
+        }
+
+        size_t GetMessageCount() const
+        {
+            return times.size();
+        }
+
+        std::string_view GetUser(uint32_t message) const
+        {
+            return std::string_view(strings).substr(
+                stringOffsets[message * 2],
+                stringOffsets[message * 2 + 1] - stringOffsets[message * 2]
+            );
+        }
+
+        std::string_view GetText(uint32_t message) const
+        {
+            return std::string_view(strings).substr(
+                stringOffsets[message * 2 + 1],
+                stringOffsets[message * 2 + 2] - stringOffsets[message * 2 + 1]
+            );
+        }
+
+        /**
+         * This looks up a word in the segment.
+         */
+        const Term* FindTerm(uint64_t word) const
+        {
+            const auto term = std::lower_bound(
+                terms.begin(),
+                terms.end(),
+                word,
+                [](const Term& term, uint64_t word){ return term.word < word; }
+            );
+            if (
+                (term == terms.end())
+                || (term->word != word)
+            )
+            {
+                return nullptr;
+            }
+            return &*term;
+        }
+
+        size_t GetMemoryUsage() const
+        {
+            return (
+                sizeof(Segment)
+                + times.capacity() * sizeof(double)
+                + userIds.capacity() * sizeof(uint64_t)
+                + channels.capacity() * sizeof(TwitchBot::SymbolTable::Symbol)
+                + strings.capacity()
+                + stringOffsets.capacity() * sizeof(uint32_t)
+                + terms.capacity() * sizeof(Term)
+                + postings.capacity()
+                + skips.capacity() * sizeof(Skip)
+            );
+        }
+    };
+
+    /**
+     * These are the segments of the index, oldest first, as seen by one
+     * search.
+     */
+    typedef std::vector< std::shared_ptr< const Segment > > Snapshot;
+
+    /**
+     * This writes the posting lists of a segment, one word at a time.
+     */
+    class PostingWriter
+    {
+    public:
+        explicit PostingWriter(Segment& segment)
+            : segment_(segment)
+        {
+        }
+
+        void Begin(uint64_t word)
+        {
+            term_ = Term();
+            term_.word = word;
+            term_.postings = (uint32_t)segment_.postings.size();
+            term_.skips = (uint32_t)segment_.skips.size();
+            lastMessage_ = NO_MESSAGE;
+        }
+
+        void Add(
+            uint32_t message,
+            const uint32_t* positions,
+            size_t positionCount
+        )
+        {
+            if (
+                (term_.count > 0)
+                && (term_.count % SKIP_INTERVAL == 0)
+            )
+            {
+                Skip skip;
+                skip.lastMessage = lastMessage_;
+                skip.offset = (uint32_t)segment_.postings.size();
+                segment_.skips.push_back(skip);
+            }
+            WriteNumber(segment_.postings, message - lastMessage_);
+            WriteNumber(segment_.postings, (uint32_t)positionCount);
+            uint32_t lastPosition = 0;
+            for (size_t i = 0; i < positionCount; ++i)
+            {
+                WriteNumber(segment_.postings, positions[i] - lastPosition);
+                lastPosition = positions[i];
+            }
+            lastMessage_ = message;
+            ++term_.count;
+        }
+
+        void End()
+        {
+            if (term_.count > 0)
+            {
+                segment_.terms.push_back(term_);
+            }
+        }
+
+    private:
+        Segment& segment_;
+        Term term_;
+        uint32_t lastMessage_ = NO_MESSAGE;
+    };
+
+    /**
+     * This walks through the posting list of one word in a segment.
+     */
+    class PostingCursor
+    {
+    public:
+        PostingCursor(const Segment& segment, const Term& term)
+            : segment_(&segment)
+            , term_(&term)
+            , next_(segment.postings.data() + term.postings)
+        {
+        }
+
+        /**
+         * This moves on to the next message of the list.
+         *
+         * @return an indication of whether or not there was one is
+         * returned.
+         */
+        bool Next()
+        {
+            if (positions_ != nullptr)
+            {
+                next_ = SkipNumbers(positions_, positionCount_);
+                positions_ = nullptr;
+            }
+            if (index_ >= term_->count)
+            {
+                message_ = NO_MESSAGE;
+                return false;
+            }
+            message_ += ReadNumber(next_);
+            positionCount_ = ReadNumber(next_);
+            positions_ = next_;
+            ++index_;
+            return true;
+        }
+
+        /**
+         * This moves on to the first message of the list numbered at least
+         * the given number, using the skip entries to jump ahead.
+         *
+         * @return an indication of whether or not there was one is
+         * returned.
+         */
+        bool SkipTo(uint32_t target)
+        {
+            if (index_ > 0)
+            {
+                if (message_ == NO_MESSAGE)
+                {
+                    return false;
+                }
+                if (message_ >= target)
+                {
+                    return true;
+                }
+            }
+            const auto skipCount = (term_->count - 1) / SKIP_INTERVAL;
+            const auto skips = segment_->skips.data() + term_->skips;
+            const auto skip = std::lower_bound(
+                skips,
+                skips + skipCount,
+                target,
+                [](const Skip& skip, uint32_t target){ return skip.lastMessage < target; }
+            );
+            if (skip != skips)
+            {
+                const auto& before = *(skip - 1);
+                const auto skipIndex = (uint32_t)(skip - skips) * SKIP_INTERVAL;
+                if (skipIndex > index_)
+                {
+                    message_ = before.lastMessage;
+                    next_ = segment_->postings.data() + before.offset;
+                    positions_ = nullptr;
+                    index_ = skipIndex;
+                }
+            }
+            while (Next())
+            {
+                if (message_ >= target)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * This reads where the word appears in the current message.
+         */
+        void GetPositions(std::vector< uint32_t >& positions) const
+        {
+            positions.clear();
+            auto input = positions_;
+            uint32_t position = 0;
+            for (uint32_t i = 0; i < positionCount_; ++i)
+            {
+                position += ReadNumber(input);
+                positions.push_back(position);
+            }
+        }
+
+        uint32_t GetMessage() const
+        {
+            return message_;
+        }
+
+        uint32_t GetCount() const
+        {
+            return term_->count;
+        }
+
+    private:
+        const Segment* segment_;
+        const Term* term_;
+        const uint8_t* next_;
+        const uint8_t* positions_ = nullptr;
+        uint32_t positionCount_ = 0;
+        uint32_t message_ = NO_MESSAGE;
+        uint32_t index_ = 0;
+    };
+
+    /**
+     * This is one place a word appears in a batch being indexed.
+     */
+    struct Occurrence
+    {
+        uint64_t word;
+        uint32_t message;
+        uint32_t position;
+    };
+
+    /**
+     * This indexes the occurrences of words in a new segment.
+     */
+    void IndexOccurrences(
+        Segment& segment,
+        std::vector< Occurrence >& occurrences
+    )
+    {
+        // Messages are numbered, and words numbered within each, in the
+        // order they're added, so sorting by word alone, keeping that order
+        // otherwise, puts each posting list in order.
+        std::stable_sort(
+            occurrences.begin(),
+            occurrences.end(),
+            [](const Occurrence& a, const Occurrence& b){ return a.word < b.word; }
+        );
+        PostingWriter writer(segment);
+        std::vector< uint32_t > positions;
+        size_t i = 0;
+        while (i < occurrences.size())
+        {
+            const auto word = occurrences[i].word;
+            writer.Begin(word);
+            while (
+                (i < occurrences.size())
+                && (occurrences[i].word == word)
+            )
+            {
+                const auto message = occurrences[i].message;
+                positions.clear();
+                while (
+                    (i < occurrences.size())
+                    && (occurrences[i].word == word)
+                    && (occurrences[i].message == message)
+                )
+                {
+                    if (occurrences[i].position != NO_POSITION)
+                    {
+                        positions.push_back(occurrences[i].position);
+                    }
+                    ++i;
+                }
+                writer.Add(message, positions.data(), positions.size());
+            }
+            writer.End();
+        }
+    }
+
+    /**
+     * This merges the given segments, in order, into one.
+     */
+    std::shared_ptr< const Segment > MergeSegments(
+        const std::vector< std::shared_ptr< const Segment > >& sources
+    )
+    {
+        auto merged = std::make_shared< Segment >();
+        size_t messageCount = 0;
+        size_t stringsSize = 0;
+        size_t postingsSize = 0;
+        for (const auto& source: sources)
+        {
+            messageCount += source->GetMessageCount();
+            stringsSize += source->strings.length();
+            postingsSize += source->postings.size();
+        }
+        merged->times.reserve(messageCount);
+        merged->userIds.reserve(messageCount);
+        merged->channels.reserve(messageCount);
+        merged->strings.reserve(stringsSize);
+        merged->stringOffsets.reserve(messageCount * 2 + 1);
+        merged->postings.reserve(postingsSize + postingsSize / 8);
+        std::vector< uint32_t > firstMessages;
+        for (const auto& source: sources)
+        {
+            firstMessages.push_back((uint32_t)merged->GetMessageCount());
+            const auto stringsBase = (uint32_t)merged->strings.length();
+            merged->times.insert(merged->times.end(), source->times.begin(), source->times.end());
+            merged->userIds.insert(merged->userIds.end(), source->userIds.begin(), source->userIds.end());
+            merged->channels.insert(merged->channels.end(), source->channels.begin(), source->channels.end());
+            merged->strings.append(source->strings);
+            for (size_t i = 1; i < source->stringOffsets.size(); ++i)
+            {
+                merged->stringOffsets.push_back(stringsBase + source->stringOffsets[i]);
+            }
+            merged->firstTime = std::min(merged->firstTime, source->firstTime);
+            merged->lastTime = std::max(merged->lastTime, source->lastTime);
+        }
+
+        // Walk the words of all the segments in order of hash, copying the
+        // posting lists of each word one after the other.
+        struct Source
+        {
+            uint64_t word;
+            uint32_t segment;
+            const Term* term;
+        };
+        std::vector< Source > words;
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            for (const auto& term: sources[i]->terms)
+            {
+                words.push_back(Source{term.word, (uint32_t)i, &term});
+            }
+        }
+        std::sort(
+            words.begin(),
+            words.end(),
+            [](const Source& a, const Source& b)
+            {
+                return (
+                    (a.word < b.word)
+                    || ((a.word == b.word) && (a.segment < b.segment))
+                );
+            }
+        );
+        PostingWriter writer(*merged);
+        std::vector< uint32_t > positions;
+        size_t i = 0;
+        while (i < words.size())
+        {
+            const auto word = words[i].word;
+            writer.Begin(word);
+            for (; (i < words.size()) && (words[i].word == word); ++i)
+            {
+                const auto& source = *sources[words[i].segment];
+                const auto firstMessage = firstMessages[words[i].segment];
+                PostingCursor cursor(source, *words[i].term);
+                while (cursor.Next())
+                {
+                    cursor.GetPositions(positions);
+                    writer.Add(firstMessage + cursor.GetMessage(), positions.data(), positions.size());
+                }
+            }
+            writer.End();
+        }
+        return merged;
+    }
+
+    /**
+     * This returns how lopsided a merge of the given segments would be,
+     * as the number of messages in the largest over those of the others.
+     */
+    size_t GetMergeSize(
+        const Snapshot& segments,
+        size_t first,
+        size_t count,
+        bool& balanced
+    )
+    {
+        size_t total = 0;
+        size_t largest = 0;
+        for (size_t i = first; i < first + count; ++i)
+        {
+            const auto messages = segments[i]->GetMessageCount();
+            total += messages;
+            largest = std::max(largest, messages);
+        }
+        balanced = (largest <= total - largest);
+        return total;
+    }
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a ChatIndex instance.
+     */
+    struct ChatIndex::Impl
+    {
+        // Properties
+
+        /**
+         * These are the settings of the index.
+         */
+        Settings settings;
+
+        /**
+         * These are the messages waiting to be indexed.
+         */
+        MpscQueue< PendingMessage > queue;
+
+        /**
+         * This is used to synchronize access to the segments and to wait
+         * for the threads of the index.
+         */
+        mutable std::mutex mutex;
+
+        /**
+         * This is used to wake the indexer thread when messages are
+         * queued, and the merger thread when segments are added.
+         */
+        std::condition_variable indexerWake;
+        std::condition_variable mergerWake;
+
+        /**
+         * This is signaled whenever a batch becomes searchable.
+         */
+        std::condition_variable indexed;
+
+        /**
+         * This is set while the indexer thread waits for messages, so that
+         * only then does anyone queuing one need to lock the mutex and
+         * signal it.
+         */
+        std::atomic< bool > indexerWaiting{false};
+
+        /**
+         * This is set to have the threads of the index stop.
+         */
+        bool stopping = false;
+
+        /**
+         * These are the segments of the index, oldest first. Searches copy
+         * the pointer, and so keep the segments they look at, while the
+         * index goes on to replace it.
+         */
+        std::shared_ptr< const Snapshot > segments = std::make_shared< Snapshot >();
+
+        /**
+         * This gives channel names the small numbers which the segments
+         * keep.
+         */
+        SymbolTable channels;
+
+        /**
+         * These count the messages fed in, indexed and dropped, the
+         * batches indexed and the merges done.
+         */
+        std::atomic< uint64_t > messagesAdded{0};
+        std::atomic< uint64_t > messagesIndexed{0};
+        std::atomic< uint64_t > messagesDropped{0};
+        std::atomic< uint64_t > batches{0};
+        std::atomic< uint64_t > merges{0};
+        std::atomic< uint64_t > messagesExpired{0};
+
+        /**
+         * This counts how long messages took from being fed in to being
+         * searchable.
+         */
+        LatencyHistogram ingestLag;
+
+        /**
+         * These are the threads which index batches and merge segments.
+         */
+        std::thread indexer;
+        std::thread merger;
+
+        // Methods
+
+        explicit Impl(const Settings& newSettings)
+            : settings(newSettings)
+            , queue(newSettings.queueCapacity)
+        {
+            if (settings.batchSize == 0)
+            {
+                settings.batchSize = 1;
+            }
+            if (settings.mergeFactor < 2)
+            {
+                settings.mergeFactor = 2;
+            }
+        }
+
+        /**
+         * This method queues a message, and wakes the indexer thread if
+         * it's waiting.
+         */
+        bool Queue(PendingMessage& message)
+        {
+            if (!queue.TryPush(message))
+            {
+                ++messagesDropped;
+                return false;
+            }
+            ++messagesAdded;
+
+            // This pairs with the fence in Indexer, so that either the
+            // indexer sees the message just queued, or this sees that the
+            // indexer is waiting.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (indexerWaiting.load(std::memory_order_relaxed))
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                indexerWaiting = false;
+                indexerWake.notify_one();
+            }
+            return true;
+        }
+
+        /**
+         * This method is the body of the indexer thread.
+         */
+        void Indexer()
+        {
+            std::vector< PendingMessage > batch;
+            std::vector< Occurrence > occurrences;
+            for (;;)
+            {
+                batch.clear();
+                (void)queue.PopBatch(
+                    [&](PendingMessage& message){ batch.push_back(std::move(message)); },
+                    settings.batchSize
+                );
+                if (batch.empty())
+                {
+                    std::unique_lock< decltype(mutex) > lock(mutex);
+                    indexerWaiting = true;
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (!queue.Empty() || stopping)
+                    {
+                        indexerWaiting = false;
+                        if (stopping)
+                        {
+                            return;
+                        }
+                        continue;
+                    }
+                    indexerWake.wait(
+                        lock,
+                        [this]{ return !indexerWaiting || stopping; }
+                    );
+                    indexerWaiting = false;
+                    continue;
+                }
+
+                // Index the batch as a segment of its own.
+                auto segment = std::make_shared< Segment >();
+                occurrences.clear();
+                for (const auto& message: batch)
+                {
+                    const auto number = (uint32_t)segment->GetMessageCount();
+                    const std::string_view strings(message.strings);
+                    const auto channelName = strings.substr(0, message.channelLength);
+                    const auto user = strings.substr(message.channelLength, message.userLength);
+                    const auto text = strings.substr(message.channelLength + message.userLength);
+                    const auto channel = channels.Intern(channelName);
+                    segment->AddMessage(message.time, message.userId, channel, user, text);
+                    uint32_t position = 0;
+                    ForEachWord(
+                        text,
+                        [&](uint64_t word)
+                        {
+                            occurrences.push_back(Occurrence{word, number, position++});
+                        }
+                    );
+                    if (message.userId != 0)
+                    {
+                        occurrences.push_back(Occurrence{GetUserWord(message.userId), number, NO_POSITION});
+                    }
+                    if (channel != SymbolTable::NO_SYMBOL)
+                    {
+                        occurrences.push_back(Occurrence{GetChannelWord(channel), number, NO_POSITION});
+                    }
+                }
+                IndexOccurrences(*segment, occurrences);
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    auto newSegments = std::make_shared< Snapshot >(*segments);
+                    newSegments->push_back(std::move(segment));
+                    segments = std::move(newSegments);
+                    messagesIndexed += batch.size();
+                    ++batches;
+                    indexed.notify_all();
+                    mergerWake.notify_one();
+                }
+                const auto now = GetSteadyTime();
+                for (const auto& message: batch)
+                {
+                    ingestLag.Record((uint64_t)std::max(now - message.addedAt, (int64_t)0));
+                }
+            }
+        }
+
+        /**
+         * This method picks a run of segments to merge, if any should be.
+         *
+         * @return an indication of whether or not there's a run to merge
+         * is returned.
+         */
+        bool PickMerge(
+            const Snapshot& candidates,
+            size_t& first
+        ) const
+        {
+            // Merge the smallest run of segments which is about even, so
+            // that each message is copied only a few times over, or the
+            // smallest run of all if there are too many segments.
+            const auto count = settings.mergeFactor;
+            if (candidates.size() < count)
+            {
+                return false;
+            }
+            size_t bestBalanced = 0;
+            size_t bestBalancedSize = std::numeric_limits< size_t >::max();
+            size_t best = 0;
+            size_t bestSize = std::numeric_limits< size_t >::max();
+            for (size_t i = 0; i + count <= candidates.size(); ++i)
+            {
+                bool balanced = false;
+                const auto size = GetMergeSize(candidates, i, count, balanced);
+                if (balanced && (size < bestBalancedSize))
+                {
+                    bestBalanced = i;
+                    bestBalancedSize = size;
+                }
+                if (size < bestSize)
+                {
+                    best = i;
+                    bestSize = size;
+                }
+            }
+            if (bestBalancedSize != std::numeric_limits< size_t >::max())
+            {
+                first = bestBalanced;
+                return true;
+            }
+            if (candidates.size() > count * MAX_SEGMENTS_PER_MERGE_FACTOR)
+            {
+                first = best;
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * This method drops the segments older than the retention period,
+         * and then the oldest segments while the index uses more memory
+         * than its budget. It's called with the mutex held.
+         */
+        void Expire()
+        {
+            if (
+                (
+                    (settings.retention <= 0.0)
+                    && (settings.memoryBudget == 0)
+                )
+                || segments->empty()
+            )
+            {
+                return;
+            }
+            double latest = -std::numeric_limits< double >::infinity();
+            size_t memoryUsage = 0;
+            for (const auto& segment: *segments)
+            {
+                latest = std::max(latest, segment->lastTime);
+                memoryUsage += segment->GetMemoryUsage();
+            }
+            std::shared_ptr< Snapshot > newSegments;
+            uint64_t expired = 0;
+            for (size_t i = 0; i < segments->size(); ++i)
+            {
+                const auto& segment = (*segments)[i];
+                if (
+                    (i + 1 < segments->size())
+                    && (
+                        (
+                            (settings.retention > 0.0)
+                            && (segment->lastTime < latest - settings.retention)
+                        )
+                        || (
+                            (settings.memoryBudget != 0)
+                            && (memoryUsage > settings.memoryBudget)
+                        )
+                    )
+                )
+                {
+                    if (newSegments == nullptr)
+                    {
+                        newSegments = std::make_shared< Snapshot >(segments->begin(), segments->begin() + i);
+                    }
+                    memoryUsage -= segment->GetMemoryUsage();
+                    expired += segment->GetMessageCount();
+                    continue;
+                }
+                if (newSegments != nullptr)
+                {
+                    newSegments->push_back(segment);
+                }
+            }
+            if (newSegments != nullptr)
+            {
+                segments = std::move(newSegments);
+                messagesExpired += expired;
+            }
+        }
+
+        /**
+         * This method is the body of the merger thread.
+         */
+        void Merger()
+        {
+            std::unique_lock< decltype(mutex) > lock(mutex);
+            for (;;)
+            {
+                if (stopping)
+                {
+                    return;
+                }
+                Expire();
+                const auto current = segments;
+                size_t first = 0;
+                if (!PickMerge(*current, first))
+                {
+                    mergerWake.wait(lock);
+                    continue;
+                }
+                const Snapshot sources(
+                    current->begin() + first,
+                    current->begin() + first + settings.mergeFactor
+                );
+                lock.unlock();
+                auto merged = MergeSegments(sources);
+                lock.lock();
+
+                // Segments are only ever added at the end meanwhile, and
+                // only this thread drops them, so the ones merged are still
+                // where they were.
+                auto newSegments = std::make_shared< Snapshot >();
+                newSegments->reserve(segments->size() - sources.size() + 1);
+                newSegments->insert(newSegments->end(), segments->begin(), segments->begin() + first);
+                newSegments->push_back(std::move(merged));
+                newSegments->insert(
+                    newSegments->end(),
+                    segments->begin() + first + sources.size(),
+                    segments->end()
+                );
+                segments = std::move(newSegments);
+                ++merges;
+            }
+        }
+
+        /**
+         * This method looks for messages in one segment.
+         *
+         * @return an indication of whether or not to keep looking is
+         * returned.
+         */
+        bool SearchSegment(
+            const Segment& segment,
+            const Query& query,
+            const std::vector< uint64_t >& words,
+            const std::vector< uint64_t >& filters,
+            const HitVisitor& visitor,
+            size_t& found
+        ) const
+        {
+            if (
+                (segment.lastTime < query.since)
+                || (segment.firstTime > query.until)
+            )
+            {
+                return true;
+            }
+
+            // Find the posting list of each distinct word, and of each
+            // filter, and note which list goes with each word of a phrase.
+            std::vector< PostingCursor > cursors;
+            std::vector< size_t > phraseCursors;
+            std::vector< uint64_t > cursorWords;
+            for (const auto word: words)
+            {
+                const auto existing = std::find(cursorWords.begin(), cursorWords.end(), word);
+                if (existing != cursorWords.end())
+                {
+                    phraseCursors.push_back((size_t)(existing - cursorWords.begin()));
+                    continue;
+                }
+                const auto term = segment.FindTerm(word);
+                if (term == nullptr)
+                {
+                    return true;
+                }
+                phraseCursors.push_back(cursors.size());
+                cursorWords.push_back(word);
+                cursors.emplace_back(segment, *term);
+            }
+            for (const auto filter: filters)
+            {
+                const auto term = segment.FindTerm(filter);
+                if (term == nullptr)
+                {
+                    return true;
+                }
+                cursorWords.push_back(filter);
+                cursors.emplace_back(segment, *term);
+            }
+
+            // Walk the shortest list, and skip ahead in the others to each
+            // message in it, jumping ahead whenever one of them has no such
+            // message.
+            std::vector< size_t > order(cursors.size());
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                order[i] = i;
+            }
+            std::sort(
+                order.begin(),
+                order.end(),
+                [&](size_t a, size_t b){ return cursors[a].GetCount() < cursors[b].GetCount(); }
+            );
+            std::vector< std::vector< uint32_t > > positions(cursors.size());
+            auto& lead = cursors[order[0]];
+            uint32_t target = 0;
+            while (lead.SkipTo(target))
+            {
+                target = lead.GetMessage();
+                bool all = true;
+                for (size_t i = 1; i < order.size(); ++i)
+                {
+                    auto& cursor = cursors[order[i]];
+                    if (!cursor.SkipTo(target))
+                    {
+                        return true;
+                    }
+                    if (cursor.GetMessage() != target)
+                    {
+                        target = cursor.GetMessage();
+                        all = false;
+                        break;
+                    }
+                }
+                if (!all)
+                {
+                    continue;
+                }
+                const auto message = target++;
+                const auto time = segment.times[message];
+                if (
+                    (time < query.since)
+                    || (time > query.until)
+                )
+                {
+                    continue;
+                }
+                if (query.phrase && (words.size() > 1))
+                {
+                    for (size_t i = 0; i < cursorWords.size() - filters.size(); ++i)
+                    {
+                        cursors[i].GetPositions(positions[i]);
+                    }
+                    bool match = false;
+                    for (const auto start: positions[phraseCursors[0]])
+                    {
+                        match = true;
+                        for (size_t i = 1; i < words.size(); ++i)
+                        {
+                            const auto& wordPositions = positions[phraseCursors[i]];
+                            if (!std::binary_search(wordPositions.begin(), wordPositions.end(), start + (uint32_t)i))
+                            {
+                                match = false;
+                                break;
+                            }
+                        }
+                        if (match)
+                        {
+                            break;
+                        }
+                    }
+                    if (!match)
+                    {
+                        continue;
+                    }
+                }
+                ++found;
+                if (visitor != nullptr)
+                {
+                    Hit hit;
+                    hit.time = time;
+                    hit.userId = segment.userIds[message];
+                    hit.channel = channels.GetName(segment.channels[message]);
+                    hit.user = segment.GetUser(message);
+                    hit.text = segment.GetText(message);
+                    if (!visitor(hit))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+    };
+
+    ChatIndex::~ChatIndex() noexcept
+    {
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            impl_->stopping = true;
+            impl_->indexerWake.notify_all();
+            impl_->mergerWake.notify_all();
+            impl_->indexed.notify_all();
+        }
+        impl_->indexer.join();
+        impl_->merger.join();
+    }
+
+    ChatIndex::ChatIndex()
+        : ChatIndex(Settings())
+    {
+    }
+
+    ChatIndex::ChatIndex(const Settings& settings)
+        : impl_(new Impl(settings))
+    {
+        impl_->indexer = std::thread(&Impl::Indexer, impl_.get());
+        impl_->merger = std::thread(&Impl::Merger, impl_.get());
+    }
+
+    bool ChatIndex::Add(const Message& message)
+    {
+        if (
+            (message.GetKnownCommand() != KnownCommand::Privmsg)
+            || (message.parameters.size() < 2)
+        )
+        {
+            return false;
+        }
+        double time;
+        const auto sentTime = message.tags.GetSentTime();
+        if (sentTime > 0)
+        {
+            time = (double)sentTime / 1000.0;
+        }
+        else
+        {
+            time = std::chrono::duration< double >(
+                std::chrono::system_clock::now().time_since_epoch()
+            ).count();
+        }
+        return Add(
+            time,
+            message.tags.GetUserId(),
+            message.GetChannelName(),
+            message.GetNickname(),
+            message.parameters.back()
+        );
+    }
+
+    bool ChatIndex::Add(
+        double time,
+        uint64_t userId,
+        std::string_view channel,
+        std::string_view user,
+        std::string_view text
+    )
+    {
+        PendingMessage message;
+        message.time = time;
+        message.userId = userId;
+        message.addedAt = GetSteadyTime();
+        message.channelLength = (uint32_t)channel.length();
+        message.userLength = (uint32_t)user.length();
+        message.strings.reserve(channel.length() + user.length() + text.length());
+        message.strings.append(channel);
+        message.strings.append(user);
+        message.strings.append(text);
+        return impl_->Queue(message);
+    }
+
+    void ChatIndex::Flush()
+    {
+        const auto target = impl_->messagesAdded.load();
+        std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+        impl_->indexed.wait(
+            lock,
+            [&]{ return (impl_->messagesIndexed >= target) || impl_->stopping; }
+        );
+    }
+
+    size_t ChatIndex::Search(
+        const Query& query,
+        HitVisitor visitor
+    ) const
+    {
+        std::vector< uint64_t > words;
+        ForEachWord(
+            query.text,
+            [&](uint64_t word){ words.push_back(word); }
+        );
+        std::vector< uint64_t > filters;
+        if (query.userId != 0)
+        {
+            filters.push_back(GetUserWord(query.userId));
+        }
+        if (!query.channel.empty())
+        {
+            std::string_view channel(query.channel);
+            if (channel[0] == '#')
+            {
+                channel.remove_prefix(1);
+            }
+            const auto symbol = impl_->channels.Find(channel);
+            if (symbol == SymbolTable::NO_SYMBOL)
+            {
+                return 0;
+            }
+            filters.push_back(GetChannelWord(symbol));
+        }
+        if (words.empty() && filters.empty())
+        {
+            return 0;
+        }
+        std::shared_ptr< const Snapshot > segments;
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            segments = impl_->segments;
+        }
+        size_t found = 0;
+        for (const auto& segment: *segments)
+        {
+            if (!impl_->SearchSegment(*segment, query, words, filters, visitor, found))
+            {
+                break;
+            }
+        }
+        return found;
+    }
+
+    auto ChatIndex::GetStats() const -> Stats
+    {
+        std::shared_ptr< const Snapshot > segments;
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            segments = impl_->segments;
+        }
+        Stats stats;
+        stats.messagesAdded = impl_->messagesAdded;
+        stats.messagesIndexed = impl_->messagesIndexed;
+        stats.messagesDropped = impl_->messagesDropped;
+        stats.batches = impl_->batches;
+        stats.merges = impl_->merges;
+        stats.messagesExpired = impl_->messagesExpired;
+        stats.segments = segments->size();
+        for (const auto& segment: *segments)
+        {
+            stats.postingBytes += segment->postings.size();
+            stats.memoryUsage += segment->GetMemoryUsage();
+        }
+        stats.ingestLag = impl_->ingestLag.GetSummary();
+        return stats;
+    }
+}
@@ -0,0 +1,1487 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/ChatLog.hpp>
+
+namespace
+{
+    /**
+     * These are the signatures at the start of every segment file and
+     * every index file.
+     */
+    constexpr char SEGMENT_SIGNATURE[8] = {'T', 'W', 'B', 'L', 'O', 'G', '0', '1'};
+    constexpr char INDEX_SIGNATURE[8] = {'T', 'W', 'B', 'I', 'D', 'X', '0', '1'};
+
+    /**
+     * These are the sizes of the header of a segment, and of the header of
+     * a record (the length and checksum of its body).
+     */
+    constexpr size_t SEGMENT_HEADER_SIZE = 64;
+    constexpr size_t RECORD_HEADER_SIZE = 8;
+
+    /**
+     * These are the smallest and largest segments allowed, whatever the
+     * settings ask for. Offsets within a segment are kept in 32 bits.
+     */
+    constexpr size_t MIN_SEGMENT_SIZE = 1 << 16;
+    constexpr size_t MAX_SEGMENT_SIZE = (size_t)1 << 31;
+
+    /**
+     * This is the number of digits in the number of a segment, in the
+     * names of its files.
+     */
+    constexpr size_t SEGMENT_NAME_DIGITS = 8;
+
+    /**
+     * This is the multiplier of the checksum of records and indexes.
+     */
+    constexpr uint64_t CHECKSUM_MULTIPLIER = 0x9E3779B97F4A7C15;
+
+    /**
+     * This is the number of text fields in the body of a record.
+     */
+    constexpr size_t RECORD_TEXT_FIELDS = 5;
+
+    /**
+     * This returns the steady clock time, in nanoseconds.
+     */
+    int64_t GetSteadyTime()
+    {
+        return std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    /**
+     * This returns the number of bytes in the given variable-length
+     * integer.
+     */
+    size_t NumberLength(uint64_t value)
+    {
+        size_t length = 1;
+        while (value >= 0x80)
+        {
+            value >>= 7;
+            ++length;
+        }
+        return length;
+    }
+
+    /**
+     * This writes a variable-length integer at the given place, advancing
+     * it past the number.
+     */
+    void WriteNumber(uint8_t*& output, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            *output++ = (uint8_t)((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        *output++ = (uint8_t)value;
+    }
+
+    /**
+     * This reads a variable-length integer at the given offset of the given
+     * data, advancing the offset past it.
+     *
+     * @return an indication of whether or not the whole number was there is
+     * returned.
+     */
+    bool ReadNumber(const uint8_t* data, size_t size, size_t& position, uint64_t& value)
+    {
+        value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7)
+        {
+            if (position >= size)
+            {
+                return false;
+            }
+            const auto byte = data[position++];
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * This computes the checksum of the given bytes, a word at a time.
+     */
+    uint64_t Checksum(const uint8_t* data, size_t length)
+    {
+        uint64_t hash = (length + 1) * CHECKSUM_MULTIPLIER;
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            (void)memcpy(&word, data + i, sizeof(word));
+            hash = (hash ^ word) * CHECKSUM_MULTIPLIER;
+            hash ^= hash >> 29;
+        }
+        uint64_t tail = 0;
+        (void)memcpy(&tail, data + i, length - i);
+        hash = (hash ^ tail) * CHECKSUM_MULTIPLIER;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    /**
+     * This reads a fixed-size value at the given place.
+     */
+    template< typename T > T Load(const uint8_t* data)
+    {
+        T value;
+        (void)memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    /**
+     * This writes a fixed-size value at the given place, advancing it past
+     * the value.
+     */
+    template< typename T > void Store(uint8_t*& output, T value)
+    {
+        (void)memcpy(output, &value, sizeof(value));
+        output += sizeof(value);
+    }
+
+    /**
+     * This returns the path of a file of the segment with the given number.
+     */
+    std::string GetSegmentPath(
+        const std::string& directory,
+        uint64_t number,
+        const char* extension
+    )
+    {
+        char name[32];
+        (void)snprintf(
+            name,
+            sizeof(name),
+            "%0*llu.%s",
+            (int)SEGMENT_NAME_DIGITS,
+            (unsigned long long)number,
+            extension
+        );
+        return directory + "/" + name;
+    }
+
+    /**
+     * This makes sure the names of files just made in the given directory
+     * are on disk.
+     */
+    void SyncDirectory(const std::string& directory)
+    {
+        const auto file = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (file >= 0)
+        {
+            (void)fsync(file);
+            (void)close(file);
+        }
+    }
+
+    /**
+     * This reads the record at the given offset of the given segment data,
+     * without checking its checksum.
+     *
+     * @return The offset past the record is returned, or 0 if there isn't a
+     * whole record there.
+     */
+    size_t ReadRecord(
+        const uint8_t* data,
+        size_t end,
+        size_t position,
+        TwitchBot::ChatLog::Entry& entry
+    )
+    {
+        if (position + RECORD_HEADER_SIZE > end)
+        {
+            return 0;
+        }
+        const auto length = Load< uint32_t >(data + position);
+        auto field = position + RECORD_HEADER_SIZE;
+        const auto bodyEnd = field + length;
+        if (
+            (length < sizeof(double))
+            || (bodyEnd > end)
+        )
+        {
+            return 0;
+        }
+        entry.time = Load< double >(data + field);
+        field += sizeof(double);
+        if (!ReadNumber(data, bodyEnd, field, entry.userId))
+        {
+            return 0;
+        }
+        std::string_view* texts[RECORD_TEXT_FIELDS] = {
+            &entry.command,
+            &entry.channel,
+            &entry.user,
+            &entry.id,
+            &entry.text,
+        };
+        for (auto text: texts)
+        {
+            uint64_t textLength;
+            if (
+                !ReadNumber(data, bodyEnd, field, textLength)
+                || (textLength > bodyEnd - field)
+            )
+            {
+                return 0;
+            }
+            *text = std::string_view((const char*)data + field, (size_t)textLength);
+            field += (size_t)textLength;
+        }
+        return bodyEnd;
+    }
+
+    /**
+     * This is one segment file of the archive, mapped into memory.
+     */
+    struct Segment
+    {
+        /**
+         * This is the number of the segment, which orders the segments and
+         * names their files.
+         */
+        uint64_t number = 0;
+
+        /**
+         * This is the file descriptor of the segment file.
+         */
+        int file = -1;
+
+        /**
+         * These are where the segment is mapped into memory, and its size.
+         */
+        uint8_t* data = nullptr;
+        size_t size = 0;
+
+        /**
+         * These are the offsets of the end of the records written into
+         * the segment, and of the end of those written out to disk.
+         */
+        size_t end = SEGMENT_HEADER_SIZE;
+        size_t committed = 0;
+
+        /**
+         * This is the number, among all blocks of the indexes, of the first
+         * block of the segment.
+         */
+        size_t firstBlock = 0;
+
+        /**
+         * This is the number of records in the segment.
+         */
+        uint64_t records = 0;
+
+        /**
+         * This indicates whether or not the segment is full, so that
+         * nothing more is added to it.
+         */
+        bool sealed = false;
+
+        /**
+         * This indicates whether or not the index of the segment is saved
+         * in a file of its own.
+         */
+        bool indexSaved = false;
+
+        /**
+         * These are the users with records in each block of the segment,
+         * by user-id and block number within the segment, kept until the
+         * index of the segment is saved.
+         */
+        std::vector< std::pair< uint64_t, uint32_t > > userBlocks;
+
+        ~Segment() noexcept
+        {
+            if (data != nullptr)
+            {
+                (void)munmap(data, size);
+            }
+            if (file >= 0)
+            {
+                (void)close(file);
+            }
+        }
+    };
+
+    /**
+     * This is one block of the indexes: a run of records in one segment.
+     */
+    struct Block
+    {
+        /**
+         * This is the position of the segment among those of the archive.
+         */
+        uint32_t segment = 0;
+
+        /**
+         * This is the offset of the first record of the block in the
+         * segment.
+         */
+        uint32_t offset = 0;
+
+        /**
+         * This is the time of the first record of the block.
+         */
+        double firstTime = 0.0;
+    };
+
+    /**
+     * This is a stretch of records to look through.
+     */
+    struct Range
+    {
+        const uint8_t* data = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a ChatLog instance.
+     */
+    struct ChatLog::Impl
+    {
+        // Properties
+
+        /**
+         * These are the settings of the log.
+         */
+        Settings settings;
+
+        /**
+         * This is the path of the directory holding the archive.
+         */
+        std::string directory;
+
+        /**
+         * This is used to synchronize access to the object.
+         */
+        mutable std::mutex mutex;
+
+        /**
+         * This is used to wake the committer thread, and to wait for it.
+         */
+        std::condition_variable committerWake;
+        std::condition_variable committerDone;
+
+        /**
+         * This is the thread which writes what's been added out to disk,
+         * makes new segments and saves their indexes.
+         */
+        std::thread committer;
+
+        /**
+         * These indicate whether or not the archive is open, and whether
+         * or not the committer thread should stop.
+         */
+        bool open = false;
+        bool stopping = false;
+
+        /**
+         * These are the segments of the archive, oldest first, with the
+         * one being filled last.
+         */
+        std::vector< std::unique_ptr< Segment > > segments;
+
+        /**
+         * This is the segment made ahead of time to be filled next, if the
+         * committer has made it.
+         */
+        std::unique_ptr< Segment > spare;
+
+        /**
+         * These are whether or not the committer failed to make the next
+         * segment the last time it tried, and the number of times it has
+         * failed.
+         */
+        bool spareFailed = false;
+        uint64_t spareFailures = 0;
+
+        /**
+         * This is the number of the next segment to make.
+         */
+        uint64_t nextSegmentNumber = 0;
+
+        /**
+         * These are the blocks of the indexes, oldest first, and the number
+         * of records in the last one.
+         */
+        std::vector< Block > blocks;
+        size_t recordsInBlock = 0;
+
+        /**
+         * These are the blocks with records from each user, by user-id,
+         * oldest first.
+         */
+        std::unordered_map< uint64_t, std::vector< uint32_t > > userBlocks;
+
+        /**
+         * This is the time of the last record added.
+         */
+        double lastTime = 0.0;
+
+        /**
+         * These are the number of bytes ever added, and of those written
+         * out to disk, and whether or not a commit has been asked for.
+         */
+        uint64_t bytesAdded = 0;
+        uint64_t bytesCommitted = 0;
+        bool commitRequested = false;
+
+        /**
+         * These are the measurements of the log.
+         */
+        Stats stats;
+        LatencyHistogram commitHistogram;
+
+        // Methods
+
+        /**
+         * This method maps the segment file with the given number into
+         * memory, making it if asked to.
+         *
+         * @return The segment is returned, or nullptr if it couldn't be
+         * mapped.
+         */
+        std::unique_ptr< Segment > MapSegment(uint64_t number, bool create) const
+        {
+            const auto path = GetSegmentPath(directory, number, "log");
+            auto segment = std::make_unique< Segment >();
+            segment->number = number;
+            segment->file = ::open(
+                path.c_str(),
+                O_RDWR | O_CLOEXEC | (create ? (O_CREAT | O_EXCL) : 0),
+                0644
+            );
+            if (segment->file < 0)
+            {
+                return nullptr;
+            }
+            if (create)
+            {
+                segment->size = settings.segmentSize;
+                if (posix_fallocate(segment->file, 0, (off_t)segment->size) != 0)
+                {
+                    (void)unlink(path.c_str());
+                    return nullptr;
+                }
+            }
+            else
+            {
+                struct stat status;
+                if (
+                    (fstat(segment->file, &status) != 0)
+                    || ((size_t)status.st_size < SEGMENT_HEADER_SIZE)
+                    || ((size_t)status.st_size > MAX_SEGMENT_SIZE)
+                )
+                {
+                    return nullptr;
+                }
+                segment->size = (size_t)status.st_size;
+            }
+
+            // Mapping a new segment brings in all its pages, so that
+            // filling it doesn't stop for page faults.
+            const auto mapping = mmap(
+                nullptr,
+                segment->size,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED | (create ? MAP_POPULATE : 0),
+                segment->file,
+                0
+            );
+            if (mapping == MAP_FAILED)
+            {
+                if (create)
+                {
+                    (void)unlink(path.c_str());
+                }
+                return nullptr;
+            }
+            segment->data = (uint8_t*)mapping;
+            if (create)
+            {
+                auto header = segment->data;
+                (void)memcpy(header, SEGMENT_SIGNATURE, sizeof(SEGMENT_SIGNATURE));
+                header += sizeof(SEGMENT_SIGNATURE);
+                Store< uint64_t >(header, number);
+            }
+            return segment;
+        }
+
+        /**
+         * This method notes a record in the indexes. The mutex must be held
+         * or the committer thread not running.
+         */
+        void IndexRecord(
+            Segment& segment,
+            uint32_t segmentPosition,
+            size_t offset,
+            double time,
+            uint64_t userId
+        )
+        {
+            if (
+                blocks.empty()
+                || (blocks.back().segment != segmentPosition)
+                || (recordsInBlock >= settings.recordsPerBlock)
+            )
+            {
+                Block block;
+                block.segment = segmentPosition;
+                block.offset = (uint32_t)offset;
+                block.firstTime = time;
+                blocks.push_back(block);
+                recordsInBlock = 0;
+            }
+            ++recordsInBlock;
+            ++segment.records;
+            if (userId != 0)
+            {
+                const auto block = (uint32_t)(blocks.size() - 1);
+                auto& list = userBlocks[userId];
+                if (
+                    list.empty()
+                    || (list.back() != block)
+                )
+                {
+                    list.push_back(block);
+                    segment.userBlocks.emplace_back(userId, (uint32_t)(block - segment.firstBlock));
+                }
+            }
+        }
+
+        /**
+         * This method looks through the records of a segment read from
+         * disk, indexing them, and cuts off any torn record along with
+         * everything after it.
+         */
+        void ScanSegment(Segment& segment, uint32_t segmentPosition)
+        {
+            size_t position = SEGMENT_HEADER_SIZE;
+            Entry entry;
+            while (position + RECORD_HEADER_SIZE <= segment.size)
+            {
+                const auto length = Load< uint32_t >(segment.data + position);
+                if (length == 0)
+                {
+                    break;
+                }
+                const auto checksum = Load< uint32_t >(segment.data + position + 4);
+                const auto next = ReadRecord(segment.data, segment.size, position, entry);
+                if (
+                    (next == 0)
+                    || (
+                        (uint32_t)Checksum(segment.data + position + RECORD_HEADER_SIZE, length)
+                        != checksum
+                    )
+                )
+                {
+                    break;
+                }
+                IndexRecord(segment, segmentPosition, position, entry.time, entry.userId);
+                lastTime = std::max(lastTime, entry.time);
+                position = next;
+            }
+            segment.end = position;
+
+            // Zero whatever follows the last whole record, up to the last
+            // byte which isn't zero already.
+            auto lastWritten = segment.size;
+            while (
+                (lastWritten > position)
+                && (segment.data[lastWritten - 1] == 0)
+            )
+            {
+                --lastWritten;
+            }
+            if (lastWritten > position)
+            {
+                (void)memset(segment.data + position, 0, lastWritten - position);
+                (void)msync(segment.data, segment.size, MS_SYNC);
+                stats.bytesTruncated += lastWritten - position;
+            }
+            segment.committed = segment.end;
+        }
+
+        /**
+         * This method saves the index of a full segment in a file of its
+         * own, so that the segment needn't be looked through again when
+         * the archive is next opened.
+         */
+        bool SaveIndex(
+            uint64_t number,
+            size_t end,
+            uint64_t records,
+            const std::vector< Block >& segmentBlocks,
+            const std::vector< std::pair< uint64_t, uint32_t > >& segmentUserBlocks
+        ) const
+        {
+            std::vector< uint8_t > buffer(
+                sizeof(INDEX_SIGNATURE)
+                + 4 * sizeof(uint64_t)
+                + segmentBlocks.size() * (sizeof(uint32_t) + sizeof(double))
+                + segmentUserBlocks.size() * (sizeof(uint64_t) + sizeof(uint32_t))
+                + sizeof(uint64_t)
+            );
+            auto output = buffer.data();
+            (void)memcpy(output, INDEX_SIGNATURE, sizeof(INDEX_SIGNATURE));
+            output += sizeof(INDEX_SIGNATURE);
+            Store< uint64_t >(output, end);
+            Store< uint64_t >(output, records);
+            Store< uint64_t >(output, segmentBlocks.size());
+            for (const auto& block: segmentBlocks)
+            {
+                Store< uint32_t >(output, block.offset);
+                Store< double >(output, block.firstTime);
+            }
+            Store< uint64_t >(output, segmentUserBlocks.size());
+            for (const auto& userBlock: segmentUserBlocks)
+            {
+                Store< uint64_t >(output, userBlock.first);
+                Store< uint32_t >(output, userBlock.second);
+            }
+            Store< uint64_t >(output, Checksum(buffer.data(), (size_t)(output - buffer.data())));
+
+            // Write the index beside where it goes, and move it into place
+            // once it's all on disk, so that a crash never leaves half of
+            // one.
+            const auto path = GetSegmentPath(directory, number, "idx");
+            const auto temporaryPath = path + ".tmp";
+            const auto file = ::open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (file < 0)
+            {
+                return false;
+            }
+            size_t written = 0;
+            while (written < buffer.size())
+            {
+                const auto result = write(file, buffer.data() + written, buffer.size() - written);
+                if (result < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    break;
+                }
+                written += (size_t)result;
+            }
+            const auto synced = (fsync(file) == 0);
+            (void)close(file);
+            if (
+                (written < buffer.size())
+                || !synced
+                || (rename(temporaryPath.c_str(), path.c_str()) != 0)
+            )
+            {
+                (void)unlink(temporaryPath.c_str());
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * This method loads the saved index of a segment read from disk, if
+         * there is one and it's whole.
+         *
+         * @return an indication of whether or not the index was loaded is
+         * returned.
+         */
+        bool LoadIndex(Segment& segment, uint32_t segmentPosition)
+        {
+            const auto path = GetSegmentPath(directory, segment.number, "idx");
+            const auto file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (file < 0)
+            {
+                return false;
+            }
+            std::vector< uint8_t > buffer;
+            struct stat status;
+            if (fstat(file, &status) == 0)
+            {
+                buffer.resize((size_t)status.st_size);
+                size_t read = 0;
+                while (read < buffer.size())
+                {
+                    const auto result = ::read(file, buffer.data() + read, buffer.size() - read);
+                    if (result <= 0)
+                    {
+                        if ((result < 0) && (errno == EINTR))
+                        {
+                            continue;
+                        }
+                        break;
+                    }
+                    read += (size_t)result;
+                }
+                buffer.resize(read);
+            }
+            (void)close(file);
+            const auto size = buffer.size();
+            const auto data = buffer.data();
+            if (
+                (size < sizeof(INDEX_SIGNATURE) + 5 * sizeof(uint64_t))
+                || (memcmp(data, INDEX_SIGNATURE, sizeof(INDEX_SIGNATURE)) != 0)
+                || (
+                    Load< uint64_t >(data + size - sizeof(uint64_t))
+                    != Checksum(data, size - sizeof(uint64_t))
+                )
+            )
+            {
+                return false;
+            }
+            size_t position = sizeof(INDEX_SIGNATURE);
+            const auto end = Load< uint64_t >(data + position);
+            position += sizeof(uint64_t);
+            const auto records = Load< uint64_t >(data + position);
+            position += sizeof(uint64_t);
+            const auto blockCount = Load< uint64_t >(data + position);
+            position += sizeof(uint64_t);
+            const auto blocksSize = blockCount * (sizeof(uint32_t) + sizeof(double));
+            if (
+                (end < SEGMENT_HEADER_SIZE)
+                || (end > segment.size)
+                || (blocksSize > size - position - 2 * sizeof(uint64_t))
+            )
+            {
+                return false;
+            }
+            const auto blocksStart = position;
+            position += (size_t)blocksSize;
+            const auto pairCount = Load< uint64_t >(data + position);
+            position += sizeof(uint64_t);
+            if (pairCount * (sizeof(uint64_t) + sizeof(uint32_t)) != size - position - sizeof(uint64_t))
+            {
+                return false;
+            }
+            segment.end = (size_t)end;
+            segment.committed = segment.end;
+            segment.records = records;
+            segment.indexSaved = true;
+            for (position = blocksStart; position < blocksStart + blocksSize; position += sizeof(uint32_t) + sizeof(double))
+            {
+                Block block;
+                block.segment = segmentPosition;
+                block.offset = Load< uint32_t >(data + position);
+                block.firstTime = Load< double >(data + position + sizeof(uint32_t));
+                blocks.push_back(block);
+                lastTime = std::max(lastTime, block.firstTime);
+            }
+            position += sizeof(uint64_t);
+            for (uint64_t i = 0; i < pairCount; ++i)
+            {
+                const auto userId = Load< uint64_t >(data + position);
+                const auto block = Load< uint32_t >(data + position + sizeof(uint64_t));
+                userBlocks[userId].push_back((uint32_t)segment.firstBlock + block);
+                position += sizeof(uint64_t) + sizeof(uint32_t);
+            }
+            recordsInBlock = settings.recordsPerBlock;
+            return true;
+        }
+
+        /**
+         * This method writes out to disk whatever has been added since the
+         * last commit. The mutex must be held by the given lock, and is
+         * let go while writing.
+         */
+        void Commit(std::unique_lock< std::mutex >& lock)
+        {
+            struct Dirty
+            {
+                uint8_t* data;
+                size_t begin;
+                size_t end;
+                Segment* segment;
+            };
+            std::vector< Dirty > dirty;
+            for (const auto& segment: segments)
+            {
+                if (segment->end > segment->committed)
+                {
+                    dirty.push_back({segment->data, segment->committed, segment->end, segment.get()});
+                }
+            }
+            const auto target = bytesAdded;
+            commitRequested = false;
+            lock.unlock();
+            const auto start = GetSteadyTime();
+            const auto pageSize = (size_t)sysconf(_SC_PAGESIZE);
+            for (const auto& range: dirty)
+            {
+                const auto begin = range.begin - range.begin % pageSize;
+                (void)msync(range.data + begin, range.end - begin, MS_SYNC);
+            }
+            commitHistogram.Record((uint64_t)(GetSteadyTime() - start));
+            lock.lock();
+            for (const auto& range: dirty)
+            {
+                range.segment->committed = range.end;
+            }
+            bytesCommitted = target;
+            ++stats.commits;
+            committerDone.notify_all();
+        }
+
+        /**
+         * This method is the body of the committer thread.
+         */
+        void Committer()
+        {
+            std::unique_lock< decltype(mutex) > lock(mutex);
+            auto lastCommit = std::chrono::steady_clock::now();
+            const auto commitInterval = std::chrono::duration_cast< std::chrono::steady_clock::duration >(
+                std::chrono::duration< double >(settings.commitInterval)
+            );
+            for (;;)
+            {
+                // Make the next segment ahead of time.
+                if (
+                    !stopping
+                    && (spare == nullptr)
+                    && !spareFailed
+                )
+                {
+                    const auto number = nextSegmentNumber;
+                    lock.unlock();
+                    auto segment = MapSegment(number, true);
+                    if (segment != nullptr)
+                    {
+                        SyncDirectory(directory);
+                    }
+                    lock.lock();
+                    if (segment == nullptr)
+                    {
+                        spareFailed = true;
+                        ++spareFailures;
+                    }
+                    else
+                    {
+                        ++nextSegmentNumber;
+                        spare = std::move(segment);
+                    }
+                    committerDone.notify_all();
+                    continue;
+                }
+
+                // Write out what's been added, every so often, or once
+                // enough has been added, or when asked to.
+                const auto now = std::chrono::steady_clock::now();
+                if (
+                    (bytesAdded > bytesCommitted)
+                    && (
+                        commitRequested
+                        || stopping
+                        || (bytesAdded - bytesCommitted >= settings.commitBytes)
+                        || (now - lastCommit >= commitInterval)
+                    )
+                )
+                {
+                    Commit(lock);
+                    lastCommit = std::chrono::steady_clock::now();
+                    continue;
+                }
+
+                // Save the index of each full segment once it's all on
+                // disk.
+                Segment* full = nullptr;
+                uint32_t fullPosition = 0;
+                for (size_t i = 0; i < segments.size(); ++i)
+                {
+                    const auto& segment = segments[i];
+                    if (
+                        segment->sealed
+                        && !segment->indexSaved
+                        && (segment->committed >= segment->end)
+                    )
+                    {
+                        full = segment.get();
+                        fullPosition = (uint32_t)i;
+                        break;
+                    }
+                }
+                if (full != nullptr)
+                {
+                    std::vector< Block > segmentBlocks;
+                    for (
+                        auto block = full->firstBlock;
+                        (block < blocks.size()) && (blocks[block].segment == fullPosition);
+                        ++block
+                    )
+                    {
+                        segmentBlocks.push_back(blocks[block]);
+                    }
+                    const auto segmentUserBlocks = std::move(full->userBlocks);
+                    full->userBlocks.clear();
+                    full->indexSaved = true;
+                    const auto number = full->number;
+                    const auto end = full->end;
+                    const auto records = full->records;
+                    lock.unlock();
+                    (void)SaveIndex(number, end, records, segmentBlocks, segmentUserBlocks);
+                    lock.lock();
+                    continue;
+                }
+                if (stopping)
+                {
+                    break;
+                }
+                spareFailed = false;
+                (void)committerWake.wait_until(lock, lastCommit + commitInterval);
+            }
+        }
+
+        /**
+         * This method moves on to the next segment, once the one being
+         * filled is full, waiting for the committer to make it if it's not
+         * ready yet. The mutex must be held by the given lock. Another
+         * thread may move on while this one waits, in which case this one
+         * doesn't.
+         *
+         * @return an indication of whether or not there's a segment to
+         * fill is returned.
+         */
+        bool NextSegment(std::unique_lock< std::mutex >& lock)
+        {
+            if (spare == nullptr)
+            {
+                ++stats.segmentStalls;
+                const auto failures = spareFailures;
+                const auto full = segments.back().get();
+                committerWake.notify_one();
+                committerDone.wait(
+                    lock,
+                    [&]{
+                        return (
+                            !open
+                            || (spare != nullptr)
+                            || (spareFailures != failures)
+                            || (segments.back().get() != full)
+                        );
+                    }
+                );
+                if (!open)
+                {
+                    return false;
+                }
+                if (segments.back().get() != full)
+                {
+                    return true;
+                }
+                if (spare == nullptr)
+                {
+                    return false;
+                }
+            }
+            segments.back()->sealed = true;
+            spare->firstBlock = blocks.size();
+            segments.push_back(std::move(spare));
+            committerWake.notify_one();
+            return true;
+        }
+
+        /**
+         * This method gathers the stretches of records in the given blocks,
+         * in order, joining those which follow each other. The mutex must be
+         * held.
+         */
+        void AddRange(std::vector< Range >& ranges, size_t block) const
+        {
+            const auto& segment = *segments[blocks[block].segment];
+            Range range;
+            range.data = segment.data;
+            range.begin = blocks[block].offset;
+            range.end = (
+                (
+                    (block + 1 < blocks.size())
+                    && (blocks[block + 1].segment == blocks[block].segment)
+                )
+                ? blocks[block + 1].offset
+                : segment.end
+            );
+            if (
+                !ranges.empty()
+                && (ranges.back().data == range.data)
+                && (ranges.back().end == range.begin)
+            )
+            {
+                ranges.back().end = range.end;
+            }
+            else
+            {
+                ranges.push_back(range);
+            }
+        }
+
+        /**
+         * This method looks through the given stretches of records for
+         * those in the given stretch of time, and from the given user if
+         * any.
+         */
+        static size_t Visit(
+            const std::vector< Range >& ranges,
+            uint64_t userId,
+            double since,
+            double until,
+            const EntryVisitor& visitor
+        )
+        {
+            size_t found = 0;
+            Entry entry;
+            for (const auto& range: ranges)
+            {
+                auto position = range.begin;
+                while (position < range.end)
+                {
+                    const auto next = ReadRecord(range.data, range.end, position, entry);
+                    if (next == 0)
+                    {
+                        break;
+                    }
+                    position = next;
+                    if (entry.time > until)
+                    {
+                        return found;
+                    }
+                    if (
+                        (entry.time < since)
+                        || ((userId != 0) && (entry.userId != userId))
+                    )
+                    {
+                        continue;
+                    }
+                    ++found;
+                    if (
+                        (visitor != nullptr)
+                        && !visitor(entry)
+                    )
+                    {
+                        return found;
+                    }
+                }
+            }
+            return found;
+        }
+    };
+
+    ChatLog::~ChatLog() noexcept
+    {
+        Close();
+    }
+
+    ChatLog::ChatLog()
+        : ChatLog(Settings())
+    {
+    }
+
+    ChatLog::ChatLog(const Settings& settings)
+        : impl_(new Impl())
+    {
+        impl_->settings = settings;
+        impl_->settings.segmentSize = std::min(
+            std::max(settings.segmentSize, MIN_SEGMENT_SIZE),
+            MAX_SEGMENT_SIZE
+        );
+        impl_->settings.recordsPerBlock = std::max< size_t >(settings.recordsPerBlock, 1);
+    }
+
+    bool ChatLog::Open(const std::string& directory)
+    {
+        Close();
+        auto& impl = *impl_;
+        if (
+            (mkdir(directory.c_str(), 0755) != 0)
+            && (errno != EEXIST)
+        )
+        {
+            return false;
+        }
+        impl.directory = directory;
+        impl.stats = Stats();
+        impl.commitHistogram.Clear();
+
+        // Find the segments already in the archive.
+        std::vector< uint64_t > numbers;
+        const auto listing = opendir(directory.c_str());
+        if (listing == nullptr)
+        {
+            return false;
+        }
+        while (const auto item = readdir(listing))
+        {
+            const std::string_view name(item->d_name);
+            if (
+                (name.length() != SEGMENT_NAME_DIGITS + 4)
+                || (name.substr(SEGMENT_NAME_DIGITS) != ".log")
+            )
+            {
+                continue;
+            }
+            uint64_t number = 0;
+            bool valid = true;
+            for (const auto c: name.substr(0, SEGMENT_NAME_DIGITS))
+            {
+                valid &= ((c >= '0') && (c <= '9'));
+                number = number * 10 + (uint64_t)(c - '0');
+            }
+            if (valid)
+            {
+                numbers.push_back(number);
+            }
+        }
+        (void)closedir(listing);
+        std::sort(numbers.begin(), numbers.end());
+
+        // Load each segment's index, or look through it to make one, and
+        // recover the last one.
+        for (const auto number: numbers)
+        {
+            auto segment = impl.MapSegment(number, false);
+            impl.nextSegmentNumber = number + 1;
+            if (segment == nullptr)
+            {
+                continue;
+            }
+            if (
+                (memcmp(segment->data, SEGMENT_SIGNATURE, sizeof(SEGMENT_SIGNATURE)) != 0)
+                || (Load< uint64_t >(segment->data + sizeof(SEGMENT_SIGNATURE)) != number)
+            )
+            {
+                // A segment made just before a crash may not have its header
+                // on disk yet. It's empty, so it's made again.
+                if (
+                    std::all_of(
+                        segment->data,
+                        segment->data + SEGMENT_HEADER_SIZE,
+                        [](uint8_t byte){ return byte == 0; }
+                    )
+                )
+                {
+                    segment.reset();
+                    (void)unlink(GetSegmentPath(directory, number, "log").c_str());
+                }
+                continue;
+            }
+            const auto position = (uint32_t)impl.segments.size();
+            segment->firstBlock = impl.blocks.size();
+            if (!impl.LoadIndex(*segment, position))
+            {
+                impl.ScanSegment(*segment, position);
+            }
+            impl.stats.recordsRecovered += segment->records;
+            segment->sealed = true;
+            impl.segments.push_back(std::move(segment));
+        }
+        if (impl.segments.empty())
+        {
+            auto segment = impl.MapSegment(impl.nextSegmentNumber, true);
+            if (segment == nullptr)
+            {
+                return false;
+            }
+            ++impl.nextSegmentNumber;
+            impl.segments.push_back(std::move(segment));
+            SyncDirectory(directory);
+        }
+        else
+        {
+            // The last segment is filled from where it left off, unless it
+            // was full already.
+            auto& last = *impl.segments.back();
+            if (last.indexSaved)
+            {
+                auto segment = impl.MapSegment(impl.nextSegmentNumber, true);
+                if (segment == nullptr)
+                {
+                    return false;
+                }
+                ++impl.nextSegmentNumber;
+                segment->firstBlock = impl.blocks.size();
+                impl.segments.push_back(std::move(segment));
+                SyncDirectory(directory);
+            }
+            else
+            {
+                last.sealed = false;
+            }
+        }
+        impl.open = true;
+        impl.stopping = false;
+        impl.spareFailed = false;
+        impl.bytesAdded = 0;
+        impl.bytesCommitted = 0;
+        impl.committer = std::thread(&Impl::Committer, impl_.get());
+        return true;
+    }
+
+    void ChatLog::Close()
+    {
+        auto& impl = *impl_;
+        {
+            std::lock_guard< decltype(impl.mutex) > lock(impl.mutex);
+            if (!impl.open)
+            {
+                return;
+            }
+            impl.stopping = true;
+            impl.committerWake.notify_all();
+        }
+        impl.committer.join();
+        std::lock_guard< decltype(impl.mutex) > lock(impl.mutex);
+        impl.open = false;
+        impl.committerDone.notify_all();
+        if (impl.spare != nullptr)
+        {
+            const auto path = GetSegmentPath(impl.directory, impl.spare->number, "log");
+            impl.spare.reset();
+            (void)unlink(path.c_str());
+        }
+        impl.segments.clear();
+        impl.blocks.clear();
+        impl.userBlocks.clear();
+        impl.recordsInBlock = 0;
+        impl.lastTime = 0.0;
+    }
+
+    bool ChatLog::Append(const Message& message)
+    {
+        Entry entry;
+
+        // Take the time the server gave the message, if any.
+        const auto sentTime = message.tags.GetSentTime();
+        if (sentTime > 0)
+        {
+            entry.time = (double)sentTime / 1000.0;
+        }
+        else
+        {
+            entry.time = std::chrono::duration< double >(
+                std::chrono::system_clock::now().time_since_epoch()
+            ).count();
+        }
+        entry.userId = message.tags.GetUserId();
+        entry.command = message.command;
+        if (
+            !message.parameters.empty()
+            && !message.parameters[0].empty()
+            && (message.parameters[0][0] == '#')
+        )
+        {
+            entry.channel = std::string_view(message.parameters[0]).substr(1);
+        }
+        const auto nicknameEnd = message.prefix.find('!');
+        if (nicknameEnd != std::string::npos)
+        {
+            entry.user = std::string_view(message.prefix).substr(0, nicknameEnd);
+        }
+        entry.id = message.tags.GetMessageId();
+        if (message.parameters.size() >= 2)
+        {
+            entry.text = message.parameters.back();
+        }
+        return Append(entry);
+    }
+
+    bool ChatLog::Append(const Entry& entry)
+    {
+        auto& impl = *impl_;
+        const std::string_view* texts[RECORD_TEXT_FIELDS] = {
+            &entry.command,
+            &entry.channel,
+            &entry.user,
+            &entry.id,
+            &entry.text,
+        };
+        size_t bodySize = sizeof(double) + NumberLength(entry.userId);
+        for (const auto text: texts)
+        {
+            bodySize += NumberLength(text->length()) + text->length();
+        }
+        const auto recordSize = RECORD_HEADER_SIZE + bodySize;
+        std::unique_lock< decltype(impl.mutex) > lock(impl.mutex);
+        if (
+            !impl.open
+            || (recordSize > impl.settings.segmentSize - SEGMENT_HEADER_SIZE)
+        )
+        {
+            return false;
+        }
+        while (impl.segments.back()->end + recordSize > impl.segments.back()->size)
+        {
+            if (!impl.NextSegment(lock))
+            {
+                return false;
+            }
+        }
+        auto& segment = *impl.segments.back();
+        const auto offset = segment.end;
+        const auto time = std::max(entry.time, impl.lastTime);
+        impl.lastTime = time;
+
+        // Write the body, then the header which covers it.
+        const auto body = segment.data + offset + RECORD_HEADER_SIZE;
+        auto output = body;
+        Store< double >(output, time);
+        WriteNumber(output, entry.userId);
+        for (const auto text: texts)
+        {
+            WriteNumber(output, text->length());
+            if (!text->empty())
+            {
+                (void)memcpy(output, text->data(), text->length());
+                output += text->length();
+            }
+        }
+        auto header = segment.data + offset;
+        Store< uint32_t >(header, (uint32_t)bodySize);
+        Store< uint32_t >(header, (uint32_t)Checksum(body, bodySize));
+        segment.end += recordSize;
+        impl.IndexRecord(
+            segment,
+            (uint32_t)(impl.segments.size() - 1),
+            offset,
+            time,
+            entry.userId
+        );
+        ++impl.stats.records;
+        impl.stats.bytes += recordSize;
+        impl.bytesAdded += recordSize;
+        if (impl.bytesAdded - impl.bytesCommitted >= impl.settings.commitBytes)
+        {
+            impl.committerWake.notify_one();
+        }
+        return true;
+    }
+
+    bool ChatLog::Flush()
+    {
+        auto& impl = *impl_;
+        std::unique_lock< decltype(impl.mutex) > lock(impl.mutex);
+        const auto target = impl.bytesAdded;
+        if (!impl.open)
+        {
+            return false;
+        }
+        impl.commitRequested = true;
+        impl.committerWake.notify_one();
+        impl.committerDone.wait(
+            lock,
+            [&]{ return (impl.bytesCommitted >= target) || !impl.open; }
+        );
+        return (impl.bytesCommitted >= target);
+    }
+
+    size_t ChatLog::Find(
+        double since,
+        double until,
+        EntryVisitor visitor
+    ) const
+    {
+        const auto& impl = *impl_;
+        std::vector< Range > ranges;
+        {
+            std::lock_guard< decltype(impl.mutex) > lock(impl.mutex);
+            if (!impl.open)
+            {
+                return 0;
+            }
+
+            // Start with the last block starting before the stretch of
+            // time, since it may have records in it.
+            auto block = (size_t)(
+                std::lower_bound(
+                    impl.blocks.begin(),
+                    impl.blocks.end(),
+                    since,
+                    [](const Block& block, double time){ return block.firstTime < time; }
+                ) - impl.blocks.begin()
+            );
+            if (block > 0)
+            {
+                --block;
+            }
+            for (; (block < impl.blocks.size()) && (impl.blocks[block].firstTime <= until); ++block)
+            {
+                impl.AddRange(ranges, block);
+            }
+        }
+        return Impl::Visit(ranges, 0, since, until, visitor);
+    }
+
+    size_t ChatLog::FindByUser(
+        uint64_t userId,
+        double since,
+        double until,
+        EntryVisitor visitor
+    ) const
+    {
+        const auto& impl = *impl_;
+        std::vector< Range > ranges;
+        {
+            std::lock_guard< decltype(impl.mutex) > lock(impl.mutex);
+            const auto user = impl.userBlocks.find(userId);
+            if (
+                !impl.open
+                || (userId == 0)
+                || (user == impl.userBlocks.end())
+            )
+            {
+                return 0;
+            }
+
+            // Skip the user's blocks which end before the stretch of time,
+            // which are those followed by a block starting before it.
+            const auto& list = user->second;
+            auto next = std::lower_bound(
+                list.begin(),
+                list.end(),
+                since,
+                [&](uint32_t block, double time)
+                {
+                    return (
+                        (block + 1 < impl.blocks.size())
+                        && (impl.blocks[block + 1].firstTime < time)
+                    );
+                }
+            );
+            for (; (next != list.end()) && (impl.blocks[*next].firstTime <= until); ++next)
+            {
+                impl.AddRange(ranges, *next);
+            }
+        }
+        return Impl::Visit(ranges, userId, since, until, visitor);
+    }
+
+    ChatLog::Stats ChatLog::GetStats() const
+    {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        auto stats = impl_->stats;
+        stats.segments = impl_->segments.size();
+        stats.commit = impl_->commitHistogram.GetSummary();
+        return stats;
+    }
+}
@@ -1,4 +1,655 @@
-class CommandController
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/CommandController.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Hashing.hpp>
+
+namespace
 {
-    
-}
\ No newline at end of file
+    /**
+     * This marks a slot of the lookup table which holds no name.
+     */
+    constexpr uint32_t EMPTY_SLOT = 0xFFFFFFFF;
+
+    /**
+     * This is the average number of names hashed into each bucket while
+     * building the lookup table. Each bucket gets its own displacement,
+     * which is searched for so that its names land in free slots.
+     */
+    constexpr size_t NAMES_PER_BUCKET = 4;
+
+    /**
+     * This is the most displacements tried for one bucket before starting
+     * over with a different seed.
+     */
+    constexpr uint32_t MAX_DISPLACEMENT_TRIES = 1 << 16;
+
+    /**
+     * These are the number of slots in each command's tables of cooldowns,
+     * by channel and by user in a channel, and the number of slots probed
+     * to find a channel or user in them. When a table is busy, whoever's
+     * cooldown ran out longest ago, or would run out soonest, is forgotten.
+     */
+    constexpr size_t CHANNEL_COOLDOWN_SLOTS = 256;
+    constexpr size_t USER_COOLDOWN_SLOTS = 1024;
+    constexpr size_t COOLDOWN_PROBES = 8;
+
+    /**
+     * This indicates whether or not the given character separates words.
+     */
+    inline bool IsSpace(char c)
+    {
+        return (c == ' ') || (c == '\t');
+    }
+
+    /**
+     * This indicates whether or not two names are the same, without regard
+     * to case. The second name must already be in lower case.
+     */
+    inline bool NamesMatch(std::string_view name, std::string_view folded)
+    {
+        if (name.length() != folded.length())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < name.length(); ++i)
+        {
+            if (TwitchBot::FoldCase(name[i]) != folded[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * This returns the given text without white space at either end.
+     */
+    std::string_view Trim(std::string_view text)
+    {
+        size_t begin = 0;
+        while ((begin < text.length()) && IsSpace(text[begin]))
+        {
+            ++begin;
+        }
+        size_t end = text.length();
+        while ((end > begin) && IsSpace(text[end - 1]))
+        {
+            --end;
+        }
+        return text.substr(begin, end - begin);
+    }
+
+    /**
+     * This holds when a command may next be used in a channel, or by a user
+     * in a channel.
+     */
+    struct Cooldown
+    {
+        /**
+         * This is the hash of the channel, or of the user and channel
+         * together, or 0 if the slot is free.
+         */
+        uint64_t key = 0;
+
+        /**
+         * This is when the command may be used again, in seconds.
+         */
+        double readyTime = 0.0;
+    };
+
+    /**
+     * This finds the slot of a table of cooldowns which holds the given
+     * key, or else the slot to take over for it.
+     *
+     * @param[in,out] table This is the table of cooldowns.
+     *
+     * @param[in] key This is the key to find. It must not be 0.
+     *
+     * @return The slot is returned.
+     */
+    Cooldown& FindCooldown(std::vector< Cooldown >& table, uint64_t key)
+    {
+        const auto mask = table.size() - 1;
+        const auto start = (size_t)key & mask;
+        Cooldown* slot = nullptr;
+        for (size_t probe = 0; probe < COOLDOWN_PROBES; ++probe)
+        {
+            auto& candidate = table[(start + probe) & mask];
+            if (candidate.key == key)
+            {
+                return candidate;
+            }
+            if (
+                (slot == nullptr)
+                || (candidate.key == 0)
+                || (
+                    (slot->key != 0)
+                    && (candidate.readyTime < slot->readyTime)
+                )
+            )
+            {
+                slot = &candidate;
+            }
+        }
+        return *slot;
+    }
+
+    /**
+     * This holds a single registered command.
+     */
+    struct Command
+    {
+        /**
+         * This is the name under which the command was registered, in lower
+         * case.
+         */
+        std::string name;
+
+        /**
+         * This is the function to call when the command is used.
+         */
+        TwitchBot::CommandController::Handler handler;
+
+        /**
+         * This is the least time, in seconds, between any two uses in the
+         * same channel.
+         */
+        double cooldown = 0.0;
+
+        /**
+         * This is the least time, in seconds, between two uses by the same
+         * user in the same channel.
+         */
+        double userCooldown = 0.0;
+
+        /**
+         * These are the channels in which the command was used recently, if
+         * it has a cooldown, and the users who used it recently, by channel,
+         * if it has a per-user cooldown.
+         */
+        std::vector< Cooldown > channels;
+        std::vector< Cooldown > users;
+    };
+
+    /**
+     * This is one name in the lookup table: a command's name or one of its
+     * aliases.
+     */
+    struct Name
+    {
+        /**
+         * This is the name, in lower case.
+         */
+        std::string text;
+
+        /**
+         * This is the index of the command the name stands for.
+         */
+        uint32_t command = 0;
+    };
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a CommandController instance.
+     */
+    struct CommandController::Impl
+    {
+        // Properties
+
+        /**
+         * This is the character which starts every command.
+         */
+        char prefix = '!';
+
+        /**
+         * These are the registered commands.
+         */
+        std::vector< Command > commands;
+
+        /**
+         * These are all the names which may be looked up.
+         */
+        std::vector< Name > names;
+
+        /**
+         * This indicates whether or not the lookup table has been built.
+         */
+        bool compiled = false;
+
+        /**
+         * This is the seed of the hash used to build the lookup table.
+         */
+        uint64_t seed = 0;
+
+        /**
+         * This is the displacement of each bucket of names.
+         */
+        std::vector< uint32_t > displacements;
+
+        /**
+         * This is the index, in names, of the name in each slot of the
+         * lookup table, or EMPTY_SLOT.
+         */
+        std::vector< uint32_t > slots;
+
+        /**
+         * This is the number of slots, less one. The number of slots is a
+         * power of two.
+         */
+        uint64_t slotMask = 0;
+
+        /**
+         * These are the shortest and longest names, so that words which
+         * can't be names are rejected without hashing them.
+         */
+        size_t minimumLength = 0;
+        size_t maximumLength = 0;
+
+        /**
+         * This has a bit set for each character which starts some name.
+         */
+        uint64_t firstCharacters[4] = {};
+
+        // Methods
+
+        /**
+         * This method returns the index of the name with the given lower case
+         * text, or EMPTY_SLOT if there's none. It's only used while
+         * registering, so it doesn't need to be fast.
+         */
+        uint32_t FindName(const std::string& text) const
+        {
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                if (names[i].text == text)
+                {
+                    return (uint32_t)i;
+                }
+            }
+            return EMPTY_SLOT;
+        }
+
+        /**
+         * This method returns the slot which holds the name with the given
+         * hash.
+         */
+        uint64_t GetSlot(uint64_t hash) const
+        {
+            const auto bucket = (hash >> 32) % displacements.size();
+            return Mix(hash ^ displacements[bucket]) & slotMask;
+        }
+
+        /**
+         * This method tries to build the lookup table with the given seed.
+         *
+         * @return an indication of whether or not every name was given a
+         * slot of its own is returned.
+         */
+        bool TryBuild(uint64_t trySeed)
+        {
+            seed = trySeed;
+            const auto bucketCount = (names.size() + NAMES_PER_BUCKET - 1) / NAMES_PER_BUCKET;
+            displacements.assign((bucketCount == 0) ? 1 : bucketCount, 0);
+            slots.assign(slotMask + 1, EMPTY_SLOT);
+            std::vector< std::vector< uint32_t > > buckets(displacements.size());
+            std::vector< uint64_t > hashes(names.size());
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                hashes[i] = HashTextFoldingCase(names[i].text, seed);
+                buckets[(hashes[i] >> 32) % displacements.size()].push_back((uint32_t)i);
+            }
+
+            // Place the biggest buckets first, while there's the most room.
+            std::vector< uint32_t > order(buckets.size());
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                order[i] = (uint32_t)i;
+            }
+            std::stable_sort(
+                order.begin(),
+                order.end(),
+                [&](uint32_t a, uint32_t b){ return buckets[a].size() > buckets[b].size(); }
+            );
+            std::vector< uint64_t > trial;
+            for (const auto bucket: order)
+            {
+                if (buckets[bucket].empty())
+                {
+                    break;
+                }
+                bool placed = false;
+                for (uint32_t displacement = 0; displacement < MAX_DISPLACEMENT_TRIES; ++displacement)
+                {
+                    trial.clear();
+                    bool fits = true;
+                    for (const auto name: buckets[bucket])
+                    {
+                        const auto slot = Mix(hashes[name] ^ displacement) & slotMask;
+                        if (
+                            (slots[slot] != EMPTY_SLOT)
+                            || (std::find(trial.begin(), trial.end(), slot) != trial.end())
+                        )
+                        {
+                            fits = false;
+                            break;
+                        }
+                        trial.push_back(slot);
+                    }
+                    if (!fits)
+                    {
+                        continue;
+                    }
+                    displacements[bucket] = displacement;
+                    for (size_t i = 0; i < trial.size(); ++i)
+                    {
+                        slots[trial[i]] = buckets[bucket][i];
+                    }
+                    placed = true;
+                    break;
+                }
+                if (!placed)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+
+    CommandController::~CommandController() noexcept = default;
+    CommandController::CommandController(CommandController&&) noexcept = default;
+    CommandController& CommandController::operator=(CommandController&&) noexcept = default;
+
+    CommandController::CommandController(char prefix)
+        : impl_(new Impl())
+    {
+        impl_->prefix = prefix;
+    }
+
+    bool CommandController::Register(
+        const std::string& name,
+        Handler handler,
+        double cooldown,
+        double userCooldown
+    )
+    {
+        Name entry;
+        entry.text.reserve(name.length());
+        for (const auto c: name)
+        {
+            if (IsSpace(c))
+            {
+                return false;
+            }
+            entry.text.push_back(FoldCase(c));
+        }
+        if (
+            impl_->compiled
+            || entry.text.empty()
+            || (impl_->FindName(entry.text) != EMPTY_SLOT)
+        )
+        {
+            return false;
+        }
+        Command command;
+        command.name = entry.text;
+        command.handler = std::move(handler);
+        command.cooldown = cooldown;
+        command.userCooldown = userCooldown;
+        entry.command = (uint32_t)impl_->commands.size();
+        impl_->commands.push_back(std::move(command));
+        impl_->names.push_back(std::move(entry));
+        return true;
+    }
+
+    bool CommandController::AddAlias(
+        const std::string& alias,
+        const std::string& name
+    )
+    {
+        Name entry;
+        std::string foldedName;
+        for (const auto c: alias)
+        {
+            if (IsSpace(c))
+            {
+                return false;
+            }
+            entry.text.push_back(FoldCase(c));
+        }
+        for (const auto c: name)
+        {
+            foldedName.push_back(FoldCase(c));
+        }
+        const auto target = impl_->FindName(foldedName);
+        if (
+            impl_->compiled
+            || entry.text.empty()
+            || (target == EMPTY_SLOT)
+            || (impl_->FindName(entry.text) != EMPTY_SLOT)
+        )
+        {
+            return false;
+        }
+        entry.command = impl_->names[target].command;
+        impl_->names.push_back(std::move(entry));
+        return true;
+    }
+
+    void CommandController::Compile()
+    {
+        if (impl_->compiled)
+        {
+            return;
+        }
+        impl_->compiled = true;
+        if (impl_->names.empty())
+        {
+            return;
+        }
+
+        // Keep the table at most half full, which makes finding a
+        // displacement for each bucket quick.
+        size_t slotCount = 2;
+        while (slotCount < impl_->names.size() * 2)
+        {
+            slotCount *= 2;
+        }
+        impl_->slotMask = slotCount - 1;
+        for (uint64_t seed = 0; !impl_->TryBuild(Mix(seed + 1)); ++seed)
+        {
+        }
+        impl_->minimumLength = impl_->names[0].text.length();
+        impl_->maximumLength = impl_->minimumLength;
+        for (const auto& name: impl_->names)
+        {
+            const auto first = (uint8_t)name.text[0];
+            impl_->firstCharacters[first / 64] |= (uint64_t)1 << (first % 64);
+            if ((first >= 'a') && (first <= 'z'))
+            {
+                const auto upper = (uint8_t)(first - ('a' - 'A'));
+                impl_->firstCharacters[upper / 64] |= (uint64_t)1 << (upper % 64);
+            }
+            if (name.text.length() < impl_->minimumLength)
+            {
+                impl_->minimumLength = name.text.length();
+            }
+            if (name.text.length() > impl_->maximumLength)
+            {
+                impl_->maximumLength = name.text.length();
+            }
+        }
+        for (auto& command: impl_->commands)
+        {
+            if (command.cooldown > 0.0)
+            {
+                command.channels.resize(CHANNEL_COOLDOWN_SLOTS);
+            }
+            if (command.userCooldown > 0.0)
+            {
+                command.users.resize(USER_COOLDOWN_SLOTS);
+            }
+        }
+    }
+
+    bool CommandController::Lookup(
+        std::string_view text,
+        CommandInvocation& invocation
+    ) const
+    {
+        // Most chat lines aren't commands, and this is where nearly all of
+        // them are turned away.
+        if (
+            (text.length() < 2)
+            || (text[0] != impl_->prefix)
+            || impl_->slots.empty()
+        )
+        {
+            return false;
+        }
+        const auto first = (uint8_t)text[1];
+        if ((impl_->firstCharacters[first / 64] & ((uint64_t)1 << (first % 64))) == 0)
+        {
+            return false;
+        }
+        size_t nameEnd = 1;
+        while (
+            (nameEnd < text.length())
+            && !IsSpace(text[nameEnd])
+            && (nameEnd <= impl_->maximumLength)
+        )
+        {
+            ++nameEnd;
+        }
+        const auto name = text.substr(1, nameEnd - 1);
+        if (
+            (name.length() < impl_->minimumLength)
+            || (name.length() > impl_->maximumLength)
+            || ((nameEnd < text.length()) && !IsSpace(text[nameEnd]))
+        )
+        {
+            return false;
+        }
+        const auto slot = impl_->slots[impl_->GetSlot(HashTextFoldingCase(name, impl_->seed))];
+        if (
+            (slot == EMPTY_SLOT)
+            || !NamesMatch(name, impl_->names[slot].text)
+        )
+        {
+            return false;
+        }
+
+        // Split the arguments into words, leaving anything past the last
+        // one in it.
+        const auto commandIndex = impl_->names[slot].command;
+        invocation.command = commandIndex;
+        invocation.name = impl_->commands[commandIndex].name;
+        invocation.argumentText = Trim(text.substr(nameEnd));
+        invocation.argumentCount = 0;
+        auto remaining = invocation.argumentText;
+        while (!remaining.empty())
+        {
+            if (invocation.argumentCount == MAX_COMMAND_ARGUMENTS - 1)
+            {
+                invocation.arguments[invocation.argumentCount++] = remaining;
+                break;
+            }
+            size_t wordEnd = 0;
+            while ((wordEnd < remaining.length()) && !IsSpace(remaining[wordEnd]))
+            {
+                ++wordEnd;
+            }
+            invocation.arguments[invocation.argumentCount++] = remaining.substr(0, wordEnd);
+            remaining = Trim(remaining.substr(wordEnd));
+        }
+        return true;
+    }
+
+    CommandController::DispatchResult CommandController::Dispatch(
+        std::string_view channel,
+        std::string_view user,
+        std::string_view text,
+        double now
+    )
+    {
+        CommandInvocation invocation;
+        if (!Lookup(text, invocation))
+        {
+            return DispatchResult::NotCommand;
+        }
+        invocation.channel = channel;
+        invocation.user = user;
+        auto& command = impl_->commands[invocation.command];
+
+        // Cooldowns are kept for each channel, and for each user in each
+        // channel, so a command used in one channel is still ready in the
+        // others.
+        auto channelKey = HashTextFoldingCase(channel, 0);
+        if (channelKey == 0)
+        {
+            channelKey = 1;
+        }
+        Cooldown* channelSlot = nullptr;
+        if (!command.channels.empty())
+        {
+            channelSlot = &FindCooldown(command.channels, channelKey);
+            if ((channelSlot->key == channelKey) && (now < channelSlot->readyTime))
+            {
+                return DispatchResult::CoolingDown;
+            }
+        }
+        if (!command.users.empty())
+        {
+            auto userKey = HashTextFoldingCase(user, channelKey);
+            if (userKey == 0)
+            {
+                userKey = 1;
+            }
+            auto& userSlot = FindCooldown(command.users, userKey);
+            if ((userSlot.key == userKey) && (now < userSlot.readyTime))
+            {
+                return DispatchResult::CoolingDown;
+            }
+            userSlot.key = userKey;
+            userSlot.readyTime = now + command.userCooldown;
+        }
+        if (channelSlot != nullptr)
+        {
+            channelSlot->key = channelKey;
+            channelSlot->readyTime = now + command.cooldown;
+        }
+        if (command.handler != nullptr)
+        {
+            command.handler(invocation);
+        }
+        return DispatchResult::Dispatched;
+    }
+
+    CommandController::DispatchResult CommandController::Dispatch(
+        const Message& message,
+        double now
+    )
+    {
+        if (
+            (message.GetKnownCommand() != KnownCommand::Privmsg)
+            || (message.parameters.size() < 2)
+        )
+        {
+            return DispatchResult::NotCommand;
+        }
+        std::string_view user = message.tags.GetRawValue(KnownTag::UserId);
+        if (user.empty())
+        {
+            user = message.GetNickname();
+        }
+        return Dispatch(message.GetChannelName(), user, message.parameters[1], now);
+    }
+
+    size_t CommandController::GetCommandCount() const
+    {
+        return impl_->commands.size();
+    }
+}
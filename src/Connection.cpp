@@ -1,6 +1,23 @@
 #include </home/criogenesis/Downloads/TwitchCppBot/include/Connection.hpp>
 
+namespace
+{
+    /**
+     * These are the characters considered white space.
+     */
+    constexpr const char* WHITE_SPACE = " \t\r\n\f\v";
+}
+
 namespace TwitchBot 
 {
-    
-}
\ No newline at end of file
+    std::string Connection::TrimWhiteSpaceFrontBack(const std::string& exampleString)
+    {
+        const auto first = exampleString.find_first_not_of(WHITE_SPACE);
+        if (first == std::string::npos)
+        {
+            return "";
+        }
+        const auto last = exampleString.find_last_not_of(WHITE_SPACE);
+        return exampleString.substr(first, last - first + 1);
+    }
+}
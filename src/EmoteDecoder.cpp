@@ -0,0 +1,241 @@
+#include </home/criogenesis/Downloads/TwitchCppBot/include/EmoteDecoder.hpp>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    /**
+     * This is more than any character number which can be in a chat line,
+     * and is where numbers read from the emotes tag stop growing, so that
+     * huge ones can't overflow.
+     */
+    constexpr uint64_t MAX_CHARACTER_NUMBER = (uint64_t)1 << 32;
+
+    /**
+     * This reads the number starting at the given character, moving past
+     * it, but not past the given end.
+     *
+     * @return an indication of whether or not there was a number is
+     * returned.
+     */
+    bool ReadNumber(
+        const char*& next,
+        const char* end,
+        uint64_t& value
+    )
+    {
+        const auto start = next;
+        value = 0;
+        while (next < end)
+        {
+            const auto digit = (unsigned int)(unsigned char)*next - '0';
+            if (digit > 9)
+            {
+                break;
+            }
+            if (value < MAX_CHARACTER_NUMBER)
+            {
+                value = value * 10 + digit;
+            }
+            ++next;
+        }
+        return (next != start);
+    }
+
+    /**
+     * This returns the offset of the first byte of the given text which
+     * isn't ASCII, or the length of the text if there isn't one.
+     */
+    size_t FindNonAscii(std::string_view text)
+    {
+        const auto characters = (const unsigned char*)text.data();
+        const auto length = text.length();
+        size_t offset = 0;
+#ifdef __SSE2__
+        for (; offset + 16 <= length; offset += 16)
+        {
+            const auto block = _mm_loadu_si128((const __m128i*)(characters + offset));
+            const auto high = (unsigned int)_mm_movemask_epi8(block);
+            if (high != 0)
+            {
+                return offset + (size_t)__builtin_ctz(high);
+            }
+        }
+#endif /* __SSE2__ */
+        for (; offset < length; ++offset)
+        {
+            if (characters[offset] >= 0x80)
+            {
+                return offset;
+            }
+        }
+        return length;
+    }
+}
+
+namespace TwitchBot
+{
+    EmoteDecoder::~EmoteDecoder() noexcept = default;
+    EmoteDecoder::EmoteDecoder(EmoteDecoder&&) noexcept = default;
+    EmoteDecoder& EmoteDecoder::operator=(EmoteDecoder&&) noexcept = default;
+
+    EmoteDecoder::EmoteDecoder()
+    {
+    }
+
+    bool EmoteDecoder::Decode(
+        std::string_view emotes,
+        std::string_view text
+    )
+    {
+        spans_.clear();
+        if (emotes.empty())
+        {
+            return true;
+        }
+        const auto ascii = FindCharacters(text);
+        const uint64_t characterCount = (
+            ascii
+            ? text.length()
+            : characters_.size() - 1
+        );
+        auto next = emotes.data();
+        const auto end = next + emotes.length();
+        while (next < end)
+        {
+            const auto idStart = next;
+            while ((next < end) && (*next != ':'))
+            {
+                ++next;
+            }
+            if ((next == end) || (next == idStart))
+            {
+                return false;
+            }
+            const std::string_view id(idStart, (size_t)(next - idStart));
+            ++next;
+            for (;;)
+            {
+                uint64_t first = 0;
+                uint64_t last = 0;
+                if (!ReadNumber(next, end, first))
+                {
+                    return false;
+                }
+                if ((next == end) || (*next != '-'))
+                {
+                    last = first;
+                }
+                else if (!ReadNumber(++next, end, last))
+                {
+                    return false;
+                }
+                if ((first <= last) && (last < characterCount))
+                {
+                    EmoteSpan span;
+                    span.id = id;
+                    if (ascii)
+                    {
+                        span.begin = (uint32_t)first;
+                        span.end = (uint32_t)last + 1;
+                    }
+                    else
+                    {
+                        span.begin = characters_[first];
+                        span.end = characters_[last + 1];
+                    }
+                    spans_.push_back(span);
+                }
+                if (next == end)
+                {
+                    return true;
+                }
+                const auto separator = *next++;
+                if (separator == '/')
+                {
+                    break;
+                }
+                if (separator != ',')
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool EmoteDecoder::Decode(const Message& message)
+    {
+        if (message.parameters.empty())
+        {
+            spans_.clear();
+            return true;
+        }
+        return Decode(message.tags.GetEmotes(), message.parameters.back());
+    }
+
+    const std::vector< EmoteSpan >& EmoteDecoder::GetSpans() const
+    {
+        return spans_;
+    }
+
+    bool EmoteDecoder::FindCharacters(std::string_view text)
+    {
+        // The text before its first byte outside of ASCII has one
+        // character for each byte.
+        auto offset = FindNonAscii(text);
+        const auto length = text.length();
+        if (offset == length)
+        {
+            return true;
+        }
+        characters_.resize(length + 1);
+        const auto characterOffsets = characters_.data();
+        for (size_t i = 0; i < offset; ++i)
+        {
+            characterOffsets[i] = (uint32_t)i;
+        }
+
+        // Every byte but those continuing a UTF-8 sequence (10xxxxxx)
+        // starts a character.
+        const auto characters = (const unsigned char*)text.data();
+        size_t count = offset;
+#ifdef __SSE2__
+        const auto continuationLimit = _mm_set1_epi8((char)0xC0);
+        for (; offset + 16 <= length; offset += 16)
+        {
+            const auto block = _mm_loadu_si128((const __m128i*)(characters + offset));
+            if (_mm_movemask_epi8(block) == 0)
+            {
+                for (size_t i = 0; i < 16; ++i)
+                {
+                    characterOffsets[count + i] = (uint32_t)(offset + i);
+                }
+                count += 16;
+                continue;
+            }
+
+            // As signed bytes, continuation bytes are the ones below 0xC0.
+            auto starts = ~(unsigned int)_mm_movemask_epi8(
+                _mm_cmplt_epi8(block, continuationLimit)
+            ) & 0xFFFF;
+            while (starts != 0)
+            {
+                characterOffsets[count++] = (uint32_t)(offset + (size_t)__builtin_ctz(starts));
+                starts &= starts - 1;
+            }
+        }
+#endif /* __SSE2__ */
+        for (; offset < length; ++offset)
+        {
+            if ((characters[offset] & 0xC0) != 0x80)
+            {
+                characterOffsets[count++] = (uint32_t)offset;
+            }
+        }
+        characterOffsets[count] = (uint32_t)length;
+        characters_.resize(count + 1);
+        return false;
+    }
+}
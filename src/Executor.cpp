@@ -0,0 +1,378 @@
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Executor.hpp>
+
+namespace
+{
+    /**
+     * This is the most tasks a strand runs in a row before going to the back
+     * of the queue, so that a busy strand doesn't keep a thread from other
+     * work for long.
+     */
+    constexpr size_t STRAND_BATCH_SIZE = 32;
+
+    /**
+     * These identify the pool, if any, to which the current thread belongs,
+     * and which queue is its own.
+     */
+    thread_local const void* currentPool = nullptr;
+    thread_local size_t currentQueue = 0;
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the state shared by copies of a strand.
+     */
+    struct Executor::Strand::State
+    {
+        /**
+         * This is the pool on which the strand runs its tasks.
+         */
+        std::shared_ptr< Executor::Impl > pool;
+
+        /**
+         * This is used to synchronize access to the tasks.
+         */
+        std::mutex mutex;
+
+        /**
+         * These are the tasks waiting to run, in order.
+         */
+        std::deque< Task > tasks;
+
+        /**
+         * This flag indicates whether or not the strand is in one of the
+         * pool's queues, or running, so that it's never run by two threads
+         * at once.
+         */
+        bool scheduled = false;
+    };
+
+    /**
+     * This contains the private properties of an Executor instance.
+     */
+    struct Executor::Impl
+    {
+        // Types
+
+        /**
+         * This is one item of work in a queue: either a single task, or a
+         * strand with tasks waiting.
+         */
+        struct Work
+        {
+            Task task;
+            std::shared_ptr< Strand::State > strand;
+        };
+
+        /**
+         * This is the queue of work belonging to one thread.
+         */
+        struct alignas(64) WorkQueue
+        {
+            std::mutex mutex;
+            std::deque< Work > work;
+        };
+
+        // Properties
+
+        /**
+         * These are the queues of work, one for each thread.
+         */
+        std::vector< std::unique_ptr< WorkQueue > > queues;
+
+        /**
+         * These are the threads of the pool.
+         */
+        std::vector< std::thread > threads;
+
+        /**
+         * This is where the next item of work posted from outside the pool
+         * goes, modulo the number of queues.
+         */
+        std::atomic< size_t > nextQueue{0};
+
+        /**
+         * This is the number of items of work in all the queues.
+         */
+        std::atomic< size_t > queued{0};
+
+        /**
+         * This is the number of threads about to wait, or waiting, for work.
+         * Only when this isn't zero does anyone posting work need to lock the
+         * mutex and signal a thread.
+         */
+        std::atomic< size_t > idle{0};
+
+        /**
+         * These are the measurements of the pool.
+         */
+        std::atomic< uint64_t > tasksRun{0};
+        std::atomic< uint64_t > steals{0};
+
+        /**
+         * This is used to wait for work, and to signal threads waiting for
+         * work.
+         */
+        std::mutex idleMutex;
+        std::condition_variable wakeThreads;
+
+        /**
+         * This flag indicates whether or not the threads should stop, once
+         * all the work queued is done.
+         */
+        std::atomic< bool > stopping{false};
+
+        /**
+         * This flag indicates whether or not the threads have stopped, after
+         * which work posted is dropped.
+         */
+        std::atomic< bool > stopped{false};
+
+        // Methods
+
+        /**
+         * This method adds an item of work to a queue, and wakes up a thread
+         * if any are waiting.
+         */
+        void Push(Work work)
+        {
+            if (stopped)
+            {
+                return;
+            }
+            const auto queue = (
+                (currentPool == this)
+                ? currentQueue
+                : (nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size())
+            );
+            // Counting the work before queuing it means the count never
+            // drops below zero when another thread takes it right away.
+            queued.fetch_add(1);
+            {
+                std::lock_guard< decltype(queues[queue]->mutex) > lock(queues[queue]->mutex);
+                queues[queue]->work.push_back(std::move(work));
+            }
+
+            // This pairs with the fence in Worker, so that either the thread
+            // about to wait sees the work just queued, or this sees that
+            // the thread is waiting.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (idle.load(std::memory_order_relaxed) != 0)
+            {
+                std::lock_guard< decltype(idleMutex) > lock(idleMutex);
+                wakeThreads.notify_one();
+            }
+        }
+
+        /**
+         * This method takes the next item of work for the given thread: the
+         * oldest from its own queue, or else the newest from another's.
+         *
+         * @return an indication of whether or not any work was found is
+         * returned.
+         */
+        bool Pop(size_t self, Work& work)
+        {
+            for (size_t i = 0; i < queues.size(); ++i)
+            {
+                auto& queue = *queues[(self + i) % queues.size()];
+                std::lock_guard< decltype(queue.mutex) > lock(queue.mutex);
+                if (queue.work.empty())
+                {
+                    continue;
+                }
+                if (i == 0)
+                {
+                    work = std::move(queue.work.front());
+                    queue.work.pop_front();
+                }
+                else
+                {
+                    work = std::move(queue.work.back());
+                    queue.work.pop_back();
+                    steals.fetch_add(1, std::memory_order_relaxed);
+                }
+                queued.fetch_sub(1);
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * This method runs the tasks waiting in a strand, up to a limit, and
+         * queues the strand again if any are left.
+         */
+        void RunStrand(const std::shared_ptr< Strand::State >& strand)
+        {
+            for (size_t i = 0; i < STRAND_BATCH_SIZE; ++i)
+            {
+                Task task;
+                {
+                    std::lock_guard< decltype(strand->mutex) > lock(strand->mutex);
+                    if (strand->tasks.empty())
+                    {
+                        strand->scheduled = false;
+                        return;
+                    }
+                    task = std::move(strand->tasks.front());
+                    strand->tasks.pop_front();
+                }
+                task();
+                tasksRun.fetch_add(1, std::memory_order_relaxed);
+            }
+            {
+                std::lock_guard< decltype(strand->mutex) > lock(strand->mutex);
+                if (strand->tasks.empty())
+                {
+                    strand->scheduled = false;
+                    return;
+                }
+            }
+            Work work;
+            work.strand = strand;
+            Push(std::move(work));
+        }
+
+        /**
+         * This runs in each thread of the pool, and does work until the pool
+         * is stopped and no work is left.
+         */
+        void Worker(size_t self)
+        {
+            currentPool = this;
+            currentQueue = self;
+            Work work;
+            while (true)
+            {
+                if (Pop(self, work))
+                {
+                    if (work.strand == nullptr)
+                    {
+                        work.task();
+                        tasksRun.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    else
+                    {
+                        RunStrand(work.strand);
+                    }
+                    work = Work();
+                    continue;
+                }
+                std::unique_lock< decltype(idleMutex) > lock(idleMutex);
+                idle.fetch_add(1);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                wakeThreads.wait(
+                    lock,
+                    [this]
+                    {
+                        return (
+                            (queued.load() != 0)
+                            || stopping
+                        );
+                    }
+                );
+                idle.fetch_sub(1);
+                if (stopping && (queued.load() == 0))
+                {
+                    return;
+                }
+            }
+        }
+    };
+
+    void Executor::Strand::Post(Task task)
+    {
+        if (state_ == nullptr)
+        {
+            return;
+        }
+        {
+            std::lock_guard< decltype(state_->mutex) > lock(state_->mutex);
+            state_->tasks.push_back(std::move(task));
+            if (state_->scheduled)
+            {
+                return;
+            }
+            state_->scheduled = true;
+        }
+        Executor::Impl::Work work;
+        work.strand = state_;
+        state_->pool->Push(std::move(work));
+    }
+
+    bool Executor::Strand::IsValid() const
+    {
+        return (state_ != nullptr);
+    }
+
+    Executor::~Executor() noexcept
+    {
+        {
+            std::lock_guard< decltype(impl_->idleMutex) > lock(impl_->idleMutex);
+            impl_->stopping = true;
+            impl_->wakeThreads.notify_all();
+        }
+        for (auto& thread: impl_->threads)
+        {
+            thread.join();
+        }
+        impl_->stopped = true;
+    }
+
+    Executor::Executor(size_t threadCount)
+        : impl_(std::make_shared< Impl >())
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::thread::hardware_concurrency();
+            if (threadCount == 0)
+            {
+                threadCount = 1;
+            }
+        }
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            impl_->queues.emplace_back(new Impl::WorkQueue());
+        }
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            impl_->threads.emplace_back(&Impl::Worker, impl_.get(), i);
+        }
+    }
+
+    void Executor::Post(Task task)
+    {
+        Impl::Work work;
+        work.task = std::move(task);
+        impl_->Push(std::move(work));
+    }
+
+    auto Executor::MakeStrand() -> Strand
+    {
+        Strand strand;
+        strand.state_ = std::make_shared< Strand::State >();
+        strand.state_->pool = impl_;
+        return strand;
+    }
+
+    size_t Executor::GetThreadCount() const
+    {
+        return impl_->threads.size();
+    }
+
+    auto Executor::GetStats() const -> Stats
+    {
+        Stats stats;
+        stats.tasksRun = impl_->tasksRun.load(std::memory_order_relaxed);
+        stats.steals = impl_->steals.load(std::memory_order_relaxed);
+        stats.queued = impl_->queued.load(std::memory_order_relaxed);
+        return stats;
+    }
+}
@@ -0,0 +1,147 @@
+#include </home/criogenesis/Downloads/TwitchCppBot/include/KeepAliveScanner.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageTokenizer.hpp>
+
+namespace
+{
+    /**
+     * This is the longest line considered as a keepalive message. The
+     * server's are far shorter, so the start of any longer line isn't kept
+     * between chunks.
+     */
+    constexpr size_t MAX_KEEP_ALIVE_LINE_LENGTH = 512;
+
+    /**
+     * This is the length of the command of a keepalive message.
+     */
+    constexpr size_t KEEP_ALIVE_COMMAND_LENGTH = 4;
+}
+
+namespace TwitchBot
+{
+    KeepAliveScanner::~KeepAliveScanner() noexcept = default;
+    KeepAliveScanner::KeepAliveScanner(KeepAliveScanner&&) noexcept = default;
+    KeepAliveScanner& KeepAliveScanner::operator=(KeepAliveScanner&&) noexcept = default;
+
+    KeepAliveScanner::KeepAliveScanner()
+    {
+    }
+
+    void KeepAliveScanner::Scan(std::string_view text)
+    {
+        text_ = text;
+    }
+
+    bool KeepAliveScanner::NextKeepAlive(Kind& kind, std::string_view& parameter)
+    {
+        if (partialComplete_)
+        {
+            partial_.clear();
+            partialComplete_ = false;
+        }
+        while (!text_.empty())
+        {
+            const auto begin = text_.data();
+            const auto end = begin + text_.length();
+            const auto lineEnd = FindCharacter(begin, end, '\n');
+            if (lineEnd == end)
+            {
+                // The line continues in the next chunk, so keep its start
+                // if it might be a keepalive message.
+                if (
+                    !skipping_
+                    && (partial_.length() + text_.length() <= MAX_KEEP_ALIVE_LINE_LENGTH)
+                    && (!partial_.empty() || (text_[0] != '@'))
+                )
+                {
+                    partial_.append(text_);
+                }
+                else
+                {
+                    partial_.clear();
+                    skipping_ = true;
+                }
+                text_ = std::string_view();
+                return false;
+            }
+            const std::string_view rest(begin, (size_t)(lineEnd - begin));
+            text_.remove_prefix(rest.length() + 1);
+            if (skipping_)
+            {
+                skipping_ = false;
+                continue;
+            }
+            if (!partial_.empty())
+            {
+                if (partial_.length() + rest.length() > MAX_KEEP_ALIVE_LINE_LENGTH)
+                {
+                    partial_.clear();
+                    continue;
+                }
+                partial_.append(rest);
+                partialComplete_ = true;
+                if (Match(partial_, kind, parameter))
+                {
+                    return true;
+                }
+                partial_.clear();
+                partialComplete_ = false;
+                continue;
+            }
+            if (Match(rest, kind, parameter))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool KeepAliveScanner::Match(
+        std::string_view line,
+        Kind& kind,
+        std::string_view& parameter
+    )
+    {
+        if (!line.empty() && (line.back() == '\r'))
+        {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || (line[0] == '@'))
+        {
+            return false;
+        }
+
+        // Look past the prefix, if any, at the command, before going to the
+        // trouble of splitting the line into its parts.
+        size_t commandStart = 0;
+        if (line[0] == ':')
+        {
+            commandStart = line.find(' ');
+            if (commandStart == std::string_view::npos)
+            {
+                return false;
+            }
+            ++commandStart;
+        }
+        const auto command = line.substr(commandStart, KEEP_ALIVE_COMMAND_LENGTH);
+        const auto commandEnd = commandStart + KEEP_ALIVE_COMMAND_LENGTH;
+        if (
+            ((command != "PING") && (command != "PONG"))
+            || ((line.length() > commandEnd) && (line[commandEnd] != ' '))
+        )
+        {
+            return false;
+        }
+        MessageTokens tokens;
+        if (!TokenizeMessage(line, tokens))
+        {
+            return false;
+        }
+        kind = ((tokens.command == "PING") ? Kind::Ping : Kind::Pong);
+        parameter = (
+            (tokens.parameterCount > 0)
+            ? tokens.parameters[tokens.parameterCount - 1]
+            : std::string_view()
+        );
+        return true;
+    }
+}
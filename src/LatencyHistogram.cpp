@@ -0,0 +1,153 @@
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LatencyHistogram.hpp>
+
+namespace
+{
+    /**
+     * This is the number of buckets in each power of two.
+     */
+    constexpr uint64_t SUB_BUCKET_COUNT = (uint64_t)1 << TwitchBot::LatencyHistogram::SUB_BUCKET_BITS;
+
+    /**
+     * This is the longest duration told apart from the others.
+     */
+    constexpr uint64_t MAX_DURATION = ((uint64_t)1 << TwitchBot::LatencyHistogram::MAX_DURATION_BITS) - 1;
+}
+
+namespace TwitchBot
+{
+    LatencyHistogram::~LatencyHistogram() noexcept = default;
+
+    LatencyHistogram::LatencyHistogram()
+    {
+        Clear();
+    }
+
+    void LatencyHistogram::Record(uint64_t nanoseconds)
+    {
+        buckets_[GetBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+        auto max = max_.load(std::memory_order_relaxed);
+        while (
+            (nanoseconds > max)
+            && !max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed)
+        )
+        {
+        }
+    }
+
+    auto LatencyHistogram::GetSummary() const -> Summary
+    {
+        Summary summary;
+        uint64_t counts[BUCKET_COUNT];
+        for (size_t i = 0; i < BUCKET_COUNT; ++i)
+        {
+            counts[i] = buckets_[i].load(std::memory_order_relaxed);
+            summary.count += counts[i];
+        }
+        summary.sum = sum_.load(std::memory_order_relaxed);
+        summary.max = max_.load(std::memory_order_relaxed);
+        const struct
+        {
+            double fraction;
+            uint64_t* percentile;
+        } percentiles[] = {
+            {0.50, &summary.p50},
+            {0.90, &summary.p90},
+            {0.99, &summary.p99},
+            {0.999, &summary.p999},
+        };
+        size_t bucket = 0;
+        uint64_t seen = 0;
+        for (const auto& percentile: percentiles)
+        {
+            // This is the rank of the duration at the percentile, counting
+            // from one, rounded up.
+            auto rank = (uint64_t)(percentile.fraction * (double)summary.count);
+            if ((double)rank < percentile.fraction * (double)summary.count)
+            {
+                ++rank;
+            }
+            if (rank == 0)
+            {
+                continue;
+            }
+            while ((bucket < BUCKET_COUNT) && (seen + counts[bucket] < rank))
+            {
+                seen += counts[bucket++];
+            }
+            auto end = (
+                (bucket + 1 < BUCKET_COUNT)
+                ? GetBucketStart(bucket + 1) - 1
+                : summary.max
+            );
+            *percentile.percentile = ((end < summary.max) ? end : summary.max);
+        }
+        return summary;
+    }
+
+    uint64_t LatencyHistogram::GetCountBelow(uint64_t nanoseconds) const
+    {
+        if (nanoseconds > MAX_DURATION)
+        {
+            return GetCount();
+        }
+        const auto end = GetBucket(nanoseconds);
+        uint64_t count = 0;
+        for (size_t i = 0; i < end; ++i)
+        {
+            count += buckets_[i].load(std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    uint64_t LatencyHistogram::GetCount() const
+    {
+        uint64_t count = 0;
+        for (const auto& bucket: buckets_)
+        {
+            count += bucket.load(std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    uint64_t LatencyHistogram::GetSum() const
+    {
+        return sum_.load(std::memory_order_relaxed);
+    }
+
+    void LatencyHistogram::Clear()
+    {
+        for (auto& bucket: buckets_)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t LatencyHistogram::GetBucket(uint64_t nanoseconds)
+    {
+        if (nanoseconds < SUB_BUCKET_COUNT)
+        {
+            return (size_t)nanoseconds;
+        }
+        if (nanoseconds > MAX_DURATION)
+        {
+            nanoseconds = MAX_DURATION;
+        }
+        const auto exponent = (unsigned int)(63 - __builtin_clzll(nanoseconds));
+        const auto subBucket = (nanoseconds >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+        return (size_t)(((exponent - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS) + subBucket);
+    }
+
+    uint64_t LatencyHistogram::GetBucketStart(size_t bucket)
+    {
+        if (bucket < SUB_BUCKET_COUNT)
+        {
+            return bucket;
+        }
+        const auto exponent = (unsigned int)(bucket >> SUB_BUCKET_BITS) + SUB_BUCKET_BITS - 1;
+        const auto subBucket = (uint64_t)(bucket & (SUB_BUCKET_COUNT - 1));
+        return (SUB_BUCKET_COUNT + subBucket) << (exponent - SUB_BUCKET_BITS);
+    }
+}
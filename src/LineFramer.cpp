@@ -0,0 +1,123 @@
+#include <string.h>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LineFramer.hpp>
+
+namespace
+{
+    /**
+     * This is the smallest size to which the buffer is grown, so that the
+     * first few chunks received don't each cause a reallocation.
+     */
+    constexpr size_t MINIMUM_BUFFER_SIZE = 4096;
+}
+
+namespace TwitchBot
+{
+    LineFramer::~LineFramer() noexcept = default;
+    LineFramer::LineFramer(LineFramer&&) noexcept = default;
+    LineFramer& LineFramer::operator=(LineFramer&&) noexcept = default;
+
+    LineFramer::LineFramer()
+    {
+    }
+
+    void LineFramer::Append(const char* data, size_t length)
+    {
+        // Once everything has been extracted, start over at the front of the
+        // buffer; this is free and is by far the most common case.
+        if (begin_ == end_)
+        {
+            begin_ = end_ = scanned_ = 0;
+        }
+
+        if (buffer_.size() - end_ < length)
+        {
+            const auto buffered = end_ - begin_;
+            if (buffer_.size() - buffered >= length)
+            {
+                // There is enough room if the partial line is moved to the
+                // front of the buffer.
+                memmove(buffer_.data(), buffer_.data() + begin_, buffered);
+            }
+            else
+            {
+                // Grow geometrically, and copy only the partial line.
+                auto newSize = buffer_.size() * 2;
+                if (newSize < MINIMUM_BUFFER_SIZE)
+                {
+                    newSize = MINIMUM_BUFFER_SIZE;
+                }
+                if (newSize < buffered + length)
+                {
+                    newSize = buffered + length;
+                }
+                std::vector< char > newBuffer(newSize);
+                if (buffered > 0)
+                {
+                    memcpy(newBuffer.data(), buffer_.data() + begin_, buffered);
+                }
+                buffer_.swap(newBuffer);
+            }
+            scanned_ -= begin_;
+            end_ = buffered;
+            begin_ = 0;
+        }
+
+        if (length > 0)
+        {
+            memcpy(buffer_.data() + end_, data, length);
+            end_ += length;
+        }
+    }
+
+    void LineFramer::Append(const std::string& data)
+    {
+        Append(data.data(), data.length());
+    }
+
+    bool LineFramer::NextLine(std::string_view& line)
+    {
+        const auto buffer = buffer_.data();
+        while (scanned_ < end_)
+        {
+            const auto carriageReturn = (const char*)memchr(
+                buffer + scanned_,
+                '\r',
+                end_ - scanned_
+            );
+            if (carriageReturn == nullptr)
+            {
+                scanned_ = end_;
+                break;
+            }
+            const auto lineEnd = (size_t)(carriageReturn - buffer);
+
+            // The line feed may not have been received yet, in which case
+            // the search resumes from the carriage return next time.
+            if (lineEnd + 1 >= end_)
+            {
+                scanned_ = lineEnd;
+                break;
+            }
+            if (buffer[lineEnd + 1] != '\n')
+            {
+                scanned_ = lineEnd + 1;
+                continue;
+            }
+
+            line = std::string_view(buffer + begin_, lineEnd - begin_);
+            begin_ = scanned_ = lineEnd + 2;
+            return true;
+        }
+        return false;
+    }
+
+    size_t LineFramer::GetBufferedLength() const
+    {
+        return end_ - begin_;
+    }
+
+    void LineFramer::Clear()
+    {
+        begin_ = end_ = scanned_ = 0;
+    }
+}
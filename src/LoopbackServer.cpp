@@ -0,0 +1,626 @@
+#include <arpa/inet.h>
+#include <atomic>
+#include <errno.h>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LineFramer.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LoopbackServer.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageTokenizer.hpp>
+
+namespace
+{
+    /**
+     * This is the line terminator used by IRC.
+     */
+    constexpr const char* CRLF = "\r\n";
+
+    /**
+     * This is the name the server gives itself.
+     */
+    constexpr const char* SERVER_NAME = "tmi.twitch.tv";
+
+    /**
+     * This is the size of the buffer into which client text is read.
+     */
+    constexpr size_t RECEIVE_BUFFER_SIZE = 65536;
+
+    /**
+     * This is the most events handled per wait.
+     */
+    constexpr int MAX_EVENTS = 64;
+
+    /**
+     * This holds what the server knows about one client.
+     */
+    struct Client
+    {
+        /**
+         * This splits the text received from the client into lines.
+         */
+        TwitchBot::LineFramer framer;
+
+        /**
+         * This is text waiting to be written to the client.
+         */
+        std::string output;
+
+        /**
+         * This is the nickname the client gave.
+         */
+        std::string nickname;
+
+        /**
+         * These are the channels the client has joined, with their '#'.
+         */
+        std::unordered_set< std::string > channels;
+
+        /**
+         * This indicates whether or not the client's connection should be
+         * closed once its output is written.
+         */
+        bool closing = false;
+
+        /**
+         * This indicates whether or not the server is waiting for the
+         * client's socket to become writable.
+         */
+        bool watchingWrites = false;
+    };
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a LoopbackServer instance.
+     */
+    struct LoopbackServer::Impl
+    {
+        // Properties
+
+        /**
+         * This is the function to call for each line received.
+         */
+        LineReceivedDelegate lineReceivedDelegate;
+
+        /**
+         * This is the listening socket, or -1 if not started.
+         */
+        int listener = -1;
+
+        /**
+         * This is the epoll instance used to wait on all sockets.
+         */
+        int epoll = -1;
+
+        /**
+         * This is the event used to wake the thread when there is text to
+         * broadcast, or when it should stop.
+         */
+        int wake = -1;
+
+        /**
+         * This is the TCP port on which the server listens.
+         */
+        uint16_t port = 0;
+
+        /**
+         * This is the thread running the server.
+         */
+        std::thread thread;
+
+        /**
+         * This is set to tell the thread to stop.
+         */
+        std::atomic< bool > stop{false};
+
+        /**
+         * This synchronizes access to the requests made of the thread.
+         */
+        std::mutex mutex;
+
+        /**
+         * This is text waiting to be sent to every client.
+         */
+        std::string broadcast;
+
+        /**
+         * This is text waiting to be sent to the clients in a channel,
+         * paired with the channel, with its '#'.
+         */
+        std::vector< std::pair< std::string, std::string > > channelTexts;
+
+        /**
+         * This indicates whether or not all clients should be dropped.
+         */
+        bool dropClients = false;
+
+        /**
+         * These are the connected clients, by socket.
+         */
+        std::unordered_map< int, Client > clients;
+
+        /**
+         * This is the number of clients connected.
+         */
+        std::atomic< size_t > clientCount{0};
+
+        /**
+         * This is the number of lines received from all clients.
+         */
+        std::atomic< uint64_t > linesReceived{0};
+
+        // Methods
+
+        /**
+         * This method wakes the thread.
+         */
+        void Wake()
+        {
+            const uint64_t one = 1;
+            (void)write(wake, &one, sizeof(one));
+        }
+
+        /**
+         * This method queues a line, in reply to the given client.
+         */
+        void Reply(Client& client, const std::string& line)
+        {
+            client.output += line;
+            client.output += CRLF;
+        }
+
+        /**
+         * This method answers a single line received from a client.
+         */
+        void Handle(Client& client, std::string_view line)
+        {
+            MessageTokens tokens;
+            if (!TokenizeMessage(line, tokens))
+            {
+                return;
+            }
+            const std::string server(SERVER_NAME);
+            const auto firstParameter = (
+                (tokens.parameterCount > 0)
+                ? std::string(tokens.parameters[0])
+                : std::string()
+            );
+            const auto user = ":" + client.nickname + "!" + client.nickname + "@" + client.nickname + "." + server;
+            if (tokens.command == "NICK")
+            {
+                client.nickname = firstParameter;
+                const auto target = " " + client.nickname + " :";
+                Reply(client, ":" + server + " 001" + target + "Welcome, GLHF!");
+                Reply(client, ":" + server + " 002" + target + "Your host is " + server);
+                Reply(client, ":" + server + " 003" + target + "This server is rather new");
+                Reply(client, ":" + server + " 004" + target + "-");
+                Reply(client, ":" + server + " 375" + target + "-");
+                Reply(client, ":" + server + " 372" + target + "You are in a maze of twisty passages, all alike.");
+                Reply(client, ":" + server + " 376" + target + ">");
+            }
+            else if (tokens.command == "PING")
+            {
+                Reply(client, ":" + server + " PONG " + server + " :" + firstParameter);
+            }
+            else if (tokens.command == "CAP")
+            {
+                if (
+                    (tokens.parameterCount >= 2)
+                    && (tokens.parameters[0] == "REQ")
+                )
+                {
+                    Reply(client, ":" + server + " CAP * ACK :" + std::string(tokens.parameters[1]));
+                }
+            }
+            else if (tokens.command == "JOIN")
+            {
+                (void)client.channels.insert(firstParameter);
+                Reply(client, user + " JOIN " + firstParameter);
+            }
+            else if (tokens.command == "PART")
+            {
+                (void)client.channels.erase(firstParameter);
+                Reply(client, user + " PART " + firstParameter);
+            }
+            else if (tokens.command == "QUIT")
+            {
+                client.closing = true;
+            }
+        }
+
+        /**
+         * This method writes as much of a client's output as its socket
+         * will take without blocking.
+         *
+         * @return an indication of whether or not the client is still
+         * connected is returned.
+         */
+        bool Flush(int sock, Client& client)
+        {
+            size_t written = 0;
+            while (written < client.output.length())
+            {
+                const auto amount = send(
+                    sock,
+                    client.output.data() + written,
+                    client.output.length() - written,
+                    MSG_NOSIGNAL
+                );
+                if (amount < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+                    {
+                        return false;
+                    }
+                    break;
+                }
+                written += (size_t)amount;
+            }
+            client.output.erase(0, written);
+            if (client.output.empty() && client.closing)
+            {
+                return false;
+            }
+            const auto wantWrites = !client.output.empty();
+            if (wantWrites != client.watchingWrites)
+            {
+                struct epoll_event event;
+                event.events = EPOLLIN | EPOLLRDHUP | (wantWrites ? (uint32_t)EPOLLOUT : 0);
+                event.data.fd = sock;
+                (void)epoll_ctl(epoll, EPOLL_CTL_MOD, sock, &event);
+                client.watchingWrites = wantWrites;
+            }
+            return true;
+        }
+
+        /**
+         * This method closes a client's connection and forgets the client.
+         */
+        void Drop(int sock)
+        {
+            (void)epoll_ctl(epoll, EPOLL_CTL_DEL, sock, nullptr);
+            (void)close(sock);
+            clients.erase(sock);
+            clientCount = clients.size();
+        }
+
+        /**
+         * This method accepts all clients waiting to connect.
+         */
+        void Accept()
+        {
+            while (true)
+            {
+                const auto sock = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (sock < 0)
+                {
+                    return;
+                }
+                int noDelay = 1;
+                (void)setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+                struct epoll_event event;
+                event.events = EPOLLIN | EPOLLRDHUP;
+                event.data.fd = sock;
+                if (epoll_ctl(epoll, EPOLL_CTL_ADD, sock, &event) != 0)
+                {
+                    (void)close(sock);
+                    continue;
+                }
+                (void)clients[sock];
+                clientCount = clients.size();
+            }
+        }
+
+        /**
+         * This method reads and answers whatever a client has sent.
+         *
+         * @return an indication of whether or not the client is still
+         * connected is returned.
+         */
+        bool Receive(int sock, Client& client, std::vector< char >& buffer, std::string& lineCopy)
+        {
+            while (true)
+            {
+                const auto amount = recv(sock, buffer.data(), buffer.size(), 0);
+                if (amount == 0)
+                {
+                    return false;
+                }
+                if (amount < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return ((errno == EAGAIN) || (errno == EWOULDBLOCK));
+                }
+                client.framer.Append(buffer.data(), (size_t)amount);
+                std::string_view line;
+                while (client.framer.NextLine(line))
+                {
+                    ++linesReceived;
+                    Handle(client, line);
+                    if (lineReceivedDelegate != nullptr)
+                    {
+                        lineCopy.assign(line.data(), line.length());
+                        lineReceivedDelegate(lineCopy);
+                    }
+                }
+                if ((size_t)amount < buffer.size())
+                {
+                    return true;
+                }
+            }
+        }
+
+        /**
+         * This method is the body of the thread running the server.
+         */
+        void Run()
+        {
+            std::vector< char > buffer(RECEIVE_BUFFER_SIZE);
+            std::string lineCopy;
+            std::string toBroadcast;
+            std::vector< std::pair< std::string, std::string > > toChannels;
+            struct epoll_event events[MAX_EVENTS];
+            while (!stop.load())
+            {
+                const auto count = epoll_wait(epoll, events, MAX_EVENTS, -1);
+                if (count < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    break;
+                }
+                for (int i = 0; i < count; ++i)
+                {
+                    const auto sock = events[i].data.fd;
+                    if (sock == wake)
+                    {
+                        uint64_t value;
+                        (void)read(wake, &value, sizeof(value));
+                    }
+                    else if (sock == listener)
+                    {
+                        Accept();
+                    }
+                    else
+                    {
+                        auto clientEntry = clients.find(sock);
+                        if (clientEntry == clients.end())
+                        {
+                            continue;
+                        }
+                        auto& client = clientEntry->second;
+                        if (
+                            (
+                                ((events[i].events & ~EPOLLOUT) != 0)
+                                && !Receive(sock, client, buffer, lineCopy)
+                            )
+                            || !Flush(sock, client)
+                        )
+                        {
+                            Drop(sock);
+                        }
+                    }
+                }
+
+                // Carry out what was asked of the server by other threads.
+                bool drop;
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    toBroadcast.swap(broadcast);
+                    toChannels.swap(channelTexts);
+                    drop = dropClients;
+                    dropClients = false;
+                }
+                if (drop)
+                {
+                    while (!clients.empty())
+                    {
+                        Drop(clients.begin()->first);
+                    }
+                }
+                if (!toBroadcast.empty() || !toChannels.empty())
+                {
+                    std::vector< int > dropped;
+                    for (auto& clientEntry: clients)
+                    {
+                        auto& client = clientEntry.second;
+                        client.output += toBroadcast;
+                        for (const auto& channelText: toChannels)
+                        {
+                            if (client.channels.count(channelText.first) != 0)
+                            {
+                                client.output += channelText.second;
+                            }
+                        }
+                        if (!Flush(clientEntry.first, client))
+                        {
+                            dropped.push_back(clientEntry.first);
+                        }
+                    }
+                    for (auto sock: dropped)
+                    {
+                        Drop(sock);
+                    }
+                    toBroadcast.clear();
+                    toChannels.clear();
+                }
+            }
+            while (!clients.empty())
+            {
+                Drop(clients.begin()->first);
+            }
+        }
+    };
+
+    LoopbackServer::~LoopbackServer() noexcept
+    {
+        Stop();
+    }
+
+    LoopbackServer::LoopbackServer()
+        : impl_(new Impl())
+    {
+    }
+
+    void LoopbackServer::SetLineReceivedDelegate(LineReceivedDelegate lineReceivedDelegate)
+    {
+        impl_->lineReceivedDelegate = lineReceivedDelegate;
+    }
+
+    bool LoopbackServer::Start(uint16_t port)
+    {
+        if (impl_->thread.joinable())
+        {
+            return false;
+        }
+        impl_->listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (impl_->listener < 0)
+        {
+            return false;
+        }
+        int reuse = 1;
+        (void)setsockopt(impl_->listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        struct sockaddr_in address;
+        (void)memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        socklen_t addressLength = sizeof(address);
+        impl_->epoll = epoll_create1(EPOLL_CLOEXEC);
+        impl_->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        struct epoll_event listenEvent;
+        listenEvent.events = EPOLLIN;
+        listenEvent.data.fd = impl_->listener;
+        struct epoll_event wakeEvent;
+        wakeEvent.events = EPOLLIN;
+        wakeEvent.data.fd = impl_->wake;
+        if (
+            (bind(impl_->listener, (struct sockaddr*)&address, sizeof(address)) != 0)
+            || (listen(impl_->listener, SOMAXCONN) != 0)
+            || (getsockname(impl_->listener, (struct sockaddr*)&address, &addressLength) != 0)
+            || (impl_->epoll < 0)
+            || (impl_->wake < 0)
+            || (epoll_ctl(impl_->epoll, EPOLL_CTL_ADD, impl_->listener, &listenEvent) != 0)
+            || (epoll_ctl(impl_->epoll, EPOLL_CTL_ADD, impl_->wake, &wakeEvent) != 0)
+        )
+        {
+            for (auto sock: {impl_->listener, impl_->epoll, impl_->wake})
+            {
+                if (sock >= 0)
+                {
+                    (void)close(sock);
+                }
+            }
+            impl_->listener = impl_->epoll = impl_->wake = -1;
+            return false;
+        }
+        impl_->port = ntohs(address.sin_port);
+        impl_->stop = false;
+        impl_->linesReceived = 0;
+        impl_->thread = std::thread(&Impl::Run, impl_.get());
+        return true;
+    }
+
+    void LoopbackServer::Stop()
+    {
+        if (!impl_->thread.joinable())
+        {
+            return;
+        }
+        impl_->stop = true;
+        impl_->Wake();
+        impl_->thread.join();
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        (void)close(impl_->listener);
+        (void)close(impl_->epoll);
+        (void)close(impl_->wake);
+        impl_->listener = impl_->epoll = impl_->wake = -1;
+        impl_->port = 0;
+        impl_->broadcast.clear();
+        impl_->channelTexts.clear();
+        impl_->dropClients = false;
+    }
+
+    uint16_t LoopbackServer::GetPort() const
+    {
+        return impl_->port;
+    }
+
+    void LoopbackServer::Broadcast(const std::string& text)
+    {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        if (impl_->wake < 0)
+        {
+            return;
+        }
+        const auto wasEmpty = impl_->broadcast.empty();
+        impl_->broadcast += text;
+        if (wasEmpty)
+        {
+            impl_->Wake();
+        }
+    }
+
+    void LoopbackServer::SendToChannel(
+        const std::string& channel,
+        const std::string& text
+    )
+    {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        if (impl_->wake < 0)
+        {
+            return;
+        }
+        const auto wasEmpty = (
+            impl_->broadcast.empty()
+            && impl_->channelTexts.empty()
+        );
+        impl_->channelTexts.emplace_back("#" + channel, text);
+        if (wasEmpty)
+        {
+            impl_->Wake();
+        }
+    }
+
+    void LoopbackServer::DisconnectClients()
+    {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        if (impl_->wake < 0)
+        {
+            return;
+        }
+        impl_->dropClients = true;
+        impl_->Wake();
+    }
+
+    size_t LoopbackServer::GetClientCount() const
+    {
+        return impl_->clientCount.load();
+    }
+
+    uint64_t LoopbackServer::GetLinesReceived() const
+    {
+        return impl_->linesReceived.load();
+    }
+}
@@ -0,0 +1,150 @@
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+
+namespace
+{
+    /**
+     * These are the known commands, in the same order as the
+     * TwitchBot::KnownCommand enumeration.
+     */
+    const std::string_view KNOWN_COMMANDS[] = {
+        "001",
+        "002",
+        "003",
+        "004",
+        "353",
+        "366",
+        "372",
+        "375",
+        "376",
+        "421",
+        "CAP",
+        "CLEARCHAT",
+        "CLEARMSG",
+        "GLOBALUSERSTATE",
+        "HOSTTARGET",
+        "JOIN",
+        "NOTICE",
+        "PART",
+        "PING",
+        "PONG",
+        "PRIVMSG",
+        "RECONNECT",
+        "ROOMSTATE",
+        "USERNOTICE",
+        "USERSTATE",
+        "WHISPER",
+    };
+    static_assert(
+        sizeof(KNOWN_COMMANDS) / sizeof(KNOWN_COMMANDS[0]) == (size_t)TwitchBot::KnownCommand::Other,
+        "KNOWN_COMMANDS must list every known command"
+    );
+
+    /**
+     * This is the length of the shortest known command.
+     */
+    constexpr size_t MIN_KNOWN_COMMAND_LENGTH = 3;
+
+    /**
+     * This is the number of slots in the table of known commands. It must be
+     * a power of two, comfortably larger than the number of known commands.
+     */
+    constexpr size_t KNOWN_COMMAND_TABLE_SIZE = 64;
+
+    /**
+     * This computes where in the table of known commands to start looking
+     * for the given command, which must be at least
+     * MIN_KNOWN_COMMAND_LENGTH characters long. It was chosen so that the
+     * known commands don't collide.
+     */
+    size_t HashCommand(std::string_view command)
+    {
+        return (
+            command.length()
+            + (unsigned char)command[0]
+            + (unsigned char)command[1] * 19
+            + (unsigned char)command.back() * 7
+        ) & (KNOWN_COMMAND_TABLE_SIZE - 1);
+    }
+
+    /**
+     * This is an open-addressed hash table of the known commands, so that
+     * most commands are matched or rejected with a single comparison.
+     */
+    struct KnownCommandTable
+    {
+        /**
+         * Each slot holds one more than the position in KNOWN_COMMANDS of a
+         * known command, or 0 if the slot is empty.
+         */
+        uint8_t slots[KNOWN_COMMAND_TABLE_SIZE] = {};
+
+        KnownCommandTable()
+        {
+            for (size_t i = 0; i < (size_t)TwitchBot::KnownCommand::Other; ++i)
+            {
+                auto slot = HashCommand(KNOWN_COMMANDS[i]);
+                while (slots[slot] != 0)
+                {
+                    slot = (slot + 1) & (KNOWN_COMMAND_TABLE_SIZE - 1);
+                }
+                slots[slot] = (uint8_t)(i + 1);
+            }
+        }
+    };
+
+    /**
+     * This is the table of known commands.
+     */
+    const KnownCommandTable knownCommandTable;
+}
+
+namespace TwitchBot
+{
+    KnownCommand FindKnownCommand(std::string_view command)
+    {
+        if (command.length() < MIN_KNOWN_COMMAND_LENGTH)
+        {
+            return KnownCommand::Other;
+        }
+        auto slot = HashCommand(command);
+        while (knownCommandTable.slots[slot] != 0)
+        {
+            const auto i = (size_t)knownCommandTable.slots[slot] - 1;
+            if (KNOWN_COMMANDS[i] == command)
+            {
+                return (KnownCommand)i;
+            }
+            slot = (slot + 1) & (KNOWN_COMMAND_TABLE_SIZE - 1);
+        }
+        return KnownCommand::Other;
+    }
+
+    KnownCommand Message::GetKnownCommand() const
+    {
+        if (knownCommand != KnownCommand::Other)
+        {
+            return knownCommand;
+        }
+        return FindKnownCommand(command);
+    }
+
+    std::string_view Message::GetChannelName() const
+    {
+        if (parameters.empty())
+        {
+            return std::string_view();
+        }
+        std::string_view channel(parameters[0]);
+        if (!channel.empty() && (channel[0] == '#'))
+        {
+            channel.remove_prefix(1);
+        }
+        return channel;
+    }
+
+    std::string_view Message::GetNickname() const
+    {
+        std::string_view nickname(prefix);
+        return nickname.substr(0, nickname.find('!'));
+    }
+}
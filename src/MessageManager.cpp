@@ -1,11 +1,34 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
-#include <mutex>
+#include <ctype.h>
 #include <deque>
-#include <queue>
+#include <math.h>
+#include <mutex>
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/ChatAnalytics.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/ChatIndex.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/ChatLog.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Executor.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Hashing.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/KeepAliveScanner.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LineFramer.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
 #include </home/criogenesis/Downloads/TwitchCppBot/include/MessageManager.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageTokenizer.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MpscQueue.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/OutboundScheduler.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/PermissionController.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SymbolTable.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TimerWheel.hpp>
 
 namespace
 {
@@ -23,6 +46,209 @@ namespace
      */
     constexpr double LOG_IN_TIMEOUT_SECONDS(5);
 
+    /**
+     * These are the capabilities requested when logging in: tags on
+     * messages, such as badges, and Twitch's own commands, such as
+     * USERSTATE and RECONNECT.
+     */
+    const std::string CAPABILITIES = "twitch.tv/tags twitch.tv/commands";
+
+    /**
+     * These are how long to wait before the second attempt in a row to
+     * reconnect, which doubles with each attempt after that, and the
+     * longest to wait.
+     */
+    constexpr double RECONNECT_INITIAL_DELAY_SECONDS = 1.0;
+    constexpr double RECONNECT_MAX_DELAY_SECONDS = 60.0;
+
+    /**
+     * This is how long to wait before trying again to make a standby
+     * connection, when one can't be made.
+     */
+    constexpr double STANDBY_RETRY_SECONDS = 5.0;
+
+    /**
+     * This is how long to wait after logging in before making a standby
+     * connection. Making a connection holds up the worker for a round trip
+     * or more, so it's put off until joining the channels is well under
+     * way.
+     */
+    constexpr double STANDBY_DELAY_SECONDS = 1.0;
+
+    /**
+     * This is the longest to keep taking messages from a connection which
+     * the server asked the agent to replace.
+     */
+    constexpr double DRAIN_TIMEOUT_SECONDS = 30.0;
+
+    /**
+     * These are how often, by default, the agent sends the server a PING on
+     * each connection logged in, and how long it waits for the PONG before
+     * giving up on the connection.
+     */
+    constexpr double DEFAULT_PING_INTERVAL_SECONDS = 60.0;
+    constexpr double DEFAULT_PONG_TIMEOUT_SECONDS = 10.0;
+
+    /**
+     * This is the most actions which can be waiting for the worker at once.
+     * If the worker falls this far behind, whoever is posting actions waits
+     * for it to catch up, except for the workers of other MessageManagers.
+     */
+    constexpr size_t ACTION_QUEUE_CAPACITY = 1024;
+
+    /**
+     * This is the most actions the worker performs in a row before checking
+     * whether any timeout conditions have expired.
+     */
+    constexpr size_t ACTION_BATCH_SIZE = 64;
+
+    /**
+     * This is the most memory held in buffers of received text kept for
+     * reuse, and the largest buffer kept. There can be as many buffers in
+     * use as there are actions waiting, so enough are kept for a full
+     * queue of typical chunks, which a burst of traffic such as a raid can
+     * produce.
+     */
+    constexpr size_t MAX_SPARE_BUFFER_BYTES = 4 << 20;
+    constexpr size_t MAX_SPARE_BUFFER_CAPACITY = 65536;
+
+    /**
+     * This is the number of timer wheel ticks per second of time keeper time.
+     * Timeouts are accurate to one tick.
+     */
+    constexpr double TIMER_TICKS_PER_SECOND = 1000.0;
+
+    /**
+     * This is how many lines are received for each one whose parse and
+     * dispatch stages are timed. Reading the clock costs nearly a tenth as
+     * much as handling a whole message, so timing every line would slow
+     * the worker down noticeably.
+     */
+    constexpr size_t STAGE_SAMPLE_INTERVAL = 32;
+
+    /**
+     * These are the bounds of the buckets written out for the stage
+     * histograms in the Prometheus text format, as powers of two
+     * nanoseconds, from 128 ns to about 69 seconds.
+     */
+    constexpr unsigned int FIRST_EXPORTED_BUCKET_BITS = 7;
+    constexpr unsigned int LAST_EXPORTED_BUCKET_BITS = 36;
+
+    /**
+     * These are the names of the outbound lanes, as Prometheus labels.
+     */
+    const char* const OUTBOUND_LANE_NAMES[] = {"critical", "moderation", "chat"};
+
+    /**
+     * This converts a time keeper time into timer wheel ticks, rounding up
+     * so that a timeout never fires early.
+     *
+     * @param[in] seconds This is the time keeper time, in seconds.
+     *
+     * @return The time, in timer wheel ticks, is returned.
+     */
+    uint64_t SecondsToTicks(double seconds)
+    {
+        if (seconds <= 0.0)
+        {
+            return 0;
+        }
+        return (uint64_t)ceil(seconds * TIMER_TICKS_PER_SECOND);
+    }
+
+    /**
+     * This returns the time of the steady clock, in nanoseconds, for
+     * measuring how long things take.
+     *
+     * @return The time, in nanoseconds, is returned.
+     */
+    int64_t GetSteadyTime()
+    {
+        return std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    /**
+     * This adds to one of the counters of traffic. Only the worker thread
+     * changes the counters, so they don't need the cost of an atomic
+     * addition, only to be safe to read from other threads.
+     *
+     * @param[in,out] counter This is the counter to change.
+     *
+     * @param[in] amount This is the amount to add.
+     */
+    void AddToCounter(std::atomic< uint64_t >& counter, uint64_t amount)
+    {
+        counter.store(
+            counter.load(std::memory_order_relaxed) + amount,
+            std::memory_order_relaxed
+        );
+    }
+
+    /**
+     * This appends a single Prometheus sample to the given text.
+     *
+     * @param[in,out] text This is the text to which to append the sample.
+     *
+     * @param[in] name This is the name of the metric, including any labels.
+     *
+     * @param[in] value This is the value of the sample.
+     */
+    void AppendSample(std::string& text, const std::string& name, double value)
+    {
+        char number[32];
+        (void)snprintf(number, sizeof(number), "%.9g", value);
+        text += name;
+        text += ' ';
+        text += number;
+        text += '\n';
+    }
+
+    /**
+     * This appends the samples of one latency histogram, in the Prometheus
+     * text format, to the given text. Bucket bounds are in seconds.
+     *
+     * @param[in,out] text This is the text to which to append the samples.
+     *
+     * @param[in] name This is the name of the metric.
+     *
+     * @param[in] stage This is the name of the stage, used as a label, or
+     * an empty string if the metric has no stages.
+     *
+     * @param[in] histogram This is the histogram to append.
+     */
+    void AppendHistogram(
+        std::string& text,
+        const std::string& name,
+        const std::string& stage,
+        const TwitchBot::LatencyHistogram& histogram
+    )
+    {
+        const auto count = histogram.GetCount();
+        const auto stageLabel = (stage.empty() ? std::string() : "stage=\"" + stage + "\"");
+        const auto bucketLabels = (stage.empty() ? std::string() : stageLabel + ",");
+        const auto totalLabels = (stage.empty() ? std::string() : "{" + stageLabel + "}");
+        for (
+            auto bits = FIRST_EXPORTED_BUCKET_BITS;
+            bits <= LAST_EXPORTED_BUCKET_BITS;
+            ++bits
+        )
+        {
+            const auto bound = (uint64_t)1 << bits;
+            char label[32];
+            (void)snprintf(label, sizeof(label), "%.9g", (double)bound / 1e9);
+            AppendSample(
+                text,
+                name + "_bucket{" + bucketLabels + "le=\"" + label + "\"}",
+                (double)histogram.GetCountBelow(bound)
+            );
+        }
+        AppendSample(text, name + "_bucket{" + bucketLabels + "le=\"+Inf\"}", (double)count);
+        AppendSample(text, name + "_sum" + totalLabels, (double)histogram.GetSum() / 1e9);
+        AppendSample(text, name + "_count" + totalLabels, (double)count);
+    }
+
     /**
      * These are the states in which the MessageManager class can be.
      */
@@ -66,20 +292,54 @@ namespace
         /**
          * Handle when the server closes its end of the connection.
          */
-        ServerDisconnected
+        ServerDisconnected,
+
+        /**
+         * Handle a connection finishing connecting, or failing to.
+         */
+        LinkConnected,
+
+        /**
+         * Join a Twitch chat channel.
+         */
+        Join,
+
+        /**
+         * Leave a Twitch chat channel.
+         */
+        Leave,
+
+        /**
+         * Send a chat message to a channel.
+         */
+        SendMessage,
+
+        /**
+         * Send a moderation command to a channel, ahead of chat messages.
+         */
+        SendModeration,
+
+        /**
+         * Start or stop writing the measurements to a file periodically.
+         */
+        SetStatsFile,
+
+#ifdef TWITCH_BOT_COROUTINES
+        /**
+         * Start an operation awaited by a coroutine.
+         */
+        Await
+#endif /* TWITCH_BOT_COROUTINES */
     };
 
     /**
-     * This is used to convey all actions by the MessageManager class worker to
-     * perform, including the perameters.
+     * These are the parameters of the few actions which are rarely
+     * performed, such as logging in. They're kept apart from the action, so
+     * that the actions which come and go all the time, such as handing over
+     * received text, don't carry them through the queue.
      */
-    struct Action
+    struct ActionDetails
     {
-        /**
-         * This is the type of action to perform.
-         */
-        ActionType type;
-
         /**
          * This is used with the LogIn action, to provide the nickname to be
            used in the chat session.
@@ -92,75 +352,164 @@ namespace
          */
         std::string token;
 
+        /**
+         * This is used with the Join action, to provide the names of any
+         * further channels to join at once.
+         */
+        std::vector< std::string > channels;
+
+        /**
+         * This is used with the SetStatsFile action, to provide how often to
+         * write the file, in seconds.
+         */
+        double interval = 0.0;
+
+        /**
+         * These are used with the LinkConnected action, to provide the
+         * connection, and whether or not it was made.
+         */
+        std::shared_ptr< TwitchBot::Connection > connection;
+        bool connected = false;
+    };
+
+    /**
+     * This is used to convey all actions by the MessageManager class worker to
+     * perform, including the perameters.
+     */
+    struct Action
+    {
+        /**
+         * This is the type of action to perform.
+         */
+        ActionType type;
+
         /**
          * This is used with multiple actions, to provide the client with some
          * text to be sent to the server.
          */
         std::string message;
+
+        /**
+         * This is used with actions on a channel, to provide the name of the
+         * channel, without the leading hash (#) character.
+         */
+        std::string channel;
+
+        /**
+         * This is when the action was posted, in nanoseconds of the steady
+         * clock, to measure how long it waited for the worker.
+         */
+        int64_t posted = 0;
+
+        /**
+         * This is used with the ProcessMessageRecieved, ServerDisconnected
+         * and LinkConnected actions, to identify the connection concerned.
+         */
+        uint64_t connectionId = 0;
+
+        /**
+         * This holds the parameters of the actions which need more than the
+         * above, and is only allocated for them.
+         */
+        std::unique_ptr< ActionDetails > details;
+
+#ifdef TWITCH_BOT_COROUTINES
+        /**
+         * This is used with the Await action, to provide the operation to
+         * start.
+         */
+        TwitchBot::MessageManager::Operation* operation = nullptr;
+#endif /* TWITCH_BOT_COROUTINES */
     };
 
     /**
-     * This contains all the information parsed from a single message from the
-     * Twitch server.
-     *
+     * This is what the thread delivering the traffic of a connection keeps
+     * track of, to handle keepalive messages as soon as they arrive.
      */
-    struct Message
+    struct LinkKeepAlive
     {
         /**
-         * If this is not an empty string, the message included is a prefix
-         * which is stored here without the leading colon (:) character.
+         * This finds the keepalive messages in the traffic.
          */
-        std::string prefix;
+        TwitchBot::KeepAliveScanner scanner;
 
         /**
-         * This is the command portion of the message, which may be a 3 digit
-         * code, or an IRC command.
-         *
-         * If it's empty, the message was invalid or there was no message.
+         * This is the token of the latest PING from the agent which the
+         * server answered, or zero if none was.
          */
-        std::string command;
+        std::atomic< int64_t > lastPong{0};
 
         /**
-         * These are the parameters(If any), provided within the message.
+         * This is set by the worker before it closes the connection. Closing
+         * waits for the thread delivering the traffic, so from then on, that
+         * thread throws away what it can't hand to the worker right away,
+         * rather than waiting for room in the queue of actions.
          */
-        std::vector< std::string > parameters;
+        std::atomic< bool > closing{false};
     };
 
-    /** 
-     * This represents a condition that the worker is awaiting, which might time
-     * out. 
+    /**
+     * This is everything the worker keeps about one connection to the Twitch
+     * server.
      */
-    struct TimeoutCondition
+    struct ServerLink
     {
-        // Properties 
+        /**
+         * This is the interface to the connection, if it's open.
+         */
+        std::shared_ptr< TwitchBot::Connection > connection;
 
         /**
-         * This is the type of action which prompted the wait condition.
+         * This identifies the connection, to match traffic to it.
          */
-        ActionType type;
+        uint64_t id = 0;
+
+        /**
+         * This indicates whether or not the connection is still being made,
+         * off the worker thread. Nothing is sent on it until it's made, and
+         * it's given up on, rather than closed, if no longer wanted.
+         */
+        bool connecting = false;
+
+        /**
+         * This is a buffer to receive the characters coming in from the
+         * Twitch server, until a complete line has been received.
+         */
+        TwitchBot::LineFramer dataReceived;
+
+        /**
+         * This indicates whether or not the agent has finished logging in
+         * on the connection (we've received the MOTD from the server).
+         */
+        bool loggedIn = false;
 
         /**
-         * This is the time, according to the time keeper,  at which the
-         * condition will be considered to have timed out.
+         * This is the timeout waiting for the MOTD after logging in, so it
+         * can be cancelled once the MOTD arrives.
          */
-         double expiration = 0.0;
+        TwitchBot::TimerWheel::TimerId logInTimeout = 0;
 
-         // Methods
+        /**
+         * This is shared with the thread delivering the connection's
+         * traffic, which answers the server's PINGs and notes the PONGs.
+         */
+        std::shared_ptr< LinkKeepAlive > keepAlive;
 
-         /**
-          * This method is used to sort timeout conditions by expiration time.
-          *
-          * @param[in] rhs This is the other timeout condition to compare with
-          * this one.
-          *
-          * @return this returns true of the other timeout condition will expire
-          * first.
-          */
-          bool operator<(const TimeoutCondition& rhs) const
-          {
-            return( expiration > rhs.expiration );
-          }
+        /**
+         * This is the token of the latest PING sent by the agent, or zero
+         * if none was, and the timer which sends the next PING or gives up
+         * waiting for the PONG.
+         */
+        int64_t pingToken = 0;
+        TwitchBot::TimerWheel::TimerId keepAliveTimer = 0;
     };
+
+    /**
+     * This is the worker thread of the MessageManager running on the current
+     * thread, if any, so that actions posted by the worker itself (such as
+     * by a delegate or coroutine it's running) don't wait on its own queue.
+     */
+    thread_local const void* runningWorker = nullptr;
 }
 
 namespace TwitchBot 
@@ -181,6 +530,13 @@ namespace TwitchBot
          */
         std::shared_ptr< TimeKeeper > timeKeeper;
 
+        /**
+         * This is the token of the function registered with the time keeper
+         * to wake the worker when the time changes other than by the
+         * passing of real time.
+         */
+        uint64_t timeChangedToken = 0;
+
         /**
          * This is the function to call when the user agent successfully logs
          * into the Twitch server.
@@ -193,6 +549,87 @@ namespace TwitchBot
          */
         LoggedOutDelegate loggedOutDelegate;
 
+        /**
+         * This is the function to call for each message received from the
+         * Twitch server.
+         */
+        MessageReceivedDelegate messageReceivedDelegate;
+
+        /**
+         * This is the pool of threads on which to call the delegates, if
+         * any.
+         */
+        std::shared_ptr< Executor > executor;
+
+        /**
+         * These indicate whether or not to reconnect on losing the
+         * connection, and whether or not to keep a standby connection.
+         */
+        bool autoReconnect = true;
+        bool warmStandby = false;
+
+        /**
+         * These are how often to send the server a PING on each connection
+         * logged in, or zero not to, and how long to wait for the PONG.
+         */
+        double pingInterval = DEFAULT_PING_INTERVAL_SECONDS;
+        double pongTimeout = DEFAULT_PONG_TIMEOUT_SECONDS;
+
+        /**
+         * This is the table in which the names of channels, and of users
+         * the worker waits for, are interned, and the worker thread's cache
+         * in front of it.
+         */
+        std::shared_ptr< SymbolTable > symbolTable = std::make_shared< SymbolTable >();
+        SymbolTable::Cache symbolCache{symbolTable};
+
+        /**
+         * This is the archive into which each message received is added, if
+         * any.
+         */
+        std::shared_ptr< ChatLog > chatLog;
+
+        /**
+         * This is the full-text index to which each PRIVMSG received is
+         * fed, if any.
+         */
+        std::shared_ptr< ChatIndex > chatIndex;
+
+        /**
+         * These are the analytics in which each PRIVMSG received is
+         * counted, if any.
+         */
+        std::shared_ptr< ChatAnalytics > chatAnalytics;
+
+        /**
+         * This is the name and symbol of the channel of the last message
+         * parsed, since messages tend to come in runs from one channel.
+         */
+        std::string lastChannel;
+        SymbolTable::Symbol lastChannelSymbol = SymbolTable::NO_SYMBOL;
+
+        /**
+         * These are the strands on which the delegates are called for the
+         * messages of each channel, by channel symbol, and for everything
+         * else. A channel's strand is kept after leaving the channel, so
+         * that its messages stay in order if it's joined again. Only the
+         * worker thread uses them.
+         */
+        std::unordered_map< SymbolTable::Symbol, Executor::Strand > channelStrands;
+        Executor::Strand serverStrand;
+
+        /**
+         * This is the number of delegate calls handed to the executor which
+         * haven't finished yet.
+         */
+        std::atomic< size_t > callsPending{0};
+
+        /**
+         * This is used to signal that all delegate calls handed to the
+         * executor have finished.
+         */
+        std::condition_variable callsDone;
+
         /**
          * This is used to synchronize access to the object.
          */
@@ -206,7 +643,14 @@ namespace TwitchBot
         /**
          * This flag indicates whether or not the worker should be stopped.
          */
-        bool stopWorker = false;
+        std::atomic< bool > stopWorker{false};
+
+        /**
+         * This flag indicates whether or not the worker is about to wait, or
+         * is waiting, to be woken up. Only when this is set does anyone
+         * posting an action need to lock the mutex and signal the worker.
+         */
+        std::atomic< bool > workerWaiting{false};
 
         /**
          * This is used to preform background tasks for the object.
@@ -216,180 +660,498 @@ namespace TwitchBot
         /**
          * These are the actions to be performed by the worker thread.
          */
-        std::deque< Action > actions;
+        MpscQueue< Action > actions{ACTION_QUEUE_CAPACITY};
 
-        //Methods
-        
         /**
-         * This method extracts the next message received from the Twitch
-         * server.
-         *
-         * @param[in,out] dataReceived All incoming data in the form of a buffer
-         * to receive the characters coming in from the Twitch server, until a
-         * complete line has been received, removed from the buffer, and
-         * handeled.
-         *
-         * @param[out] message this is where to store the next message received.
-         *
-         * @return an indication of whether or not a complete line was extracted
-         * is returned.
+         * These are actions posted by the workers of other MessageManagers,
+         * such as other shards, and by the threads making connections, to
+         * be performed by the worker thread. They have no limit, so that a
+         * worker never waits on another worker, which may in turn be waiting
+         * on it, and the worker is never kept from joining a thread which
+         * made a connection. The flag is set whenever the
+         * list isn't empty, so the worker needn't lock the mutex to check.
          */
-        bool GetNextMessage(std::string& dataReceived, Message& message)
-        {
-            // "dataReceived.find" will attempt to find the indeces of the where
-            // CRLF would start in "dataReceived" and set it equal to "lineEnd"
-            // (probably being returned back as an int)
-            const auto lineEnd = dataReceived.find(CRLF);
-            
-            // We simply return out of the function if it fails to find the CRLF
-            if (lineEnd == std::string::npos)
-            {
-                return false;
-            }
+        std::mutex pendingActionsMutex;
+        std::deque< Action > pendingActions;
+        std::atomic< bool > pendingActionsWaiting{false};
 
-            // "line" should now contain the revelant data without the CRLF
-            const auto line = dataReceived.substr(0, lineEnd);
+        /**
+         * This holds the lines waiting to be sent to the Twitch server, and
+         * paces them to stay within Twitch's rate limits. Only the worker
+         * thread uses it.
+         */
+        OutboundScheduler outbound;
 
-            // Remove the line from the buffer
-            dataReceived = dataReceived.substr(lineEnd + CRLF.length());
+        /**
+         * This is a copy of the outbound measurements, updated by the worker
+         * whenever it sends anything. It's guarded by the mutex.
+         */
+        OutboundScheduler::Stats outboundStats;
 
-            // Unpack the message from the line
-            size_t offset = 0;
-            int state = 0;
-            message = Message();
-            while (offset < line.length())
-            {
-                switch (state)
-                {
-                    // First character of the line could be ':', which singals a
-                    // prefix or is the first charater of the command.
-                    case 0:
-                    {
-                        if (line[offset] == ':')
-                        {
-                            state = 1;
-                        }
-                        else
-                        {
+        /**
+         * These count the traffic received. Only the worker thread changes
+         * them.
+         */
+        std::atomic< uint64_t > chunksReceived{0};
+        std::atomic< uint64_t > bytesReceived{0};
+        std::atomic< uint64_t > messagesReceived{0};
+        std::atomic< uint64_t > parseFailures{0};
+        std::atomic< uint64_t > linesDropped{0};
+        std::atomic< uint64_t > reconnects{0};
 
-                        }
-                    } break;
-                    
-                    // Prefix
-                    case 1:
-                    {
-                        if (line[offset] == ' ')
-                        {
-                            state = 2;
-                        }
-                        else
-                        {
-                            message.prefix += line[offset];
-                        }
+        /**
+         * These count the server's PINGs answered, the chunks of traffic
+         * thrown away while their connection was closing, and the
+         * connections given up on for want of a PONG. The first two are
+         * changed by the threads delivering the traffic, not the worker.
+         */
+        std::atomic< uint64_t > pingsAnswered{0};
+        std::atomic< uint64_t > chunksDropped{0};
+        std::atomic< uint64_t > keepAliveTimeouts{0};
 
-                    } break;
+        /**
+         * These measure how long each stage of handling the traffic took
+         * (see Stats).
+         */
+        LatencyHistogram queueWaitHistogram;
+        LatencyHistogram parseHistogram;
+        LatencyHistogram dispatchHistogram;
 
-                    // First character of command
-                    case 2:
-                    {
-                        if (line[offset] != ' ')
-                        {
-                            state = 3;
-                            message.command += line[offset];
-                        }
+        /**
+         * This measures how long the server took to answer each PING sent
+         * by the agent.
+         */
+        LatencyHistogram serverRoundTripHistogram;
 
-                    } break;
-                    
-                    // Command
-                    case 3:
-                    {
-                        if (line[offset] == ' ')
-                        {
-                            state = 4;
-                        }
-                        else
-                        {
-                            message.command += line[offset];
-                        }
-                    } break;
+        /**
+         * These are buffers of received text which the worker is done with,
+         * kept so that the text of later chunks can be copied into them
+         * rather than into newly allocated memory. They're guarded by their
+         * own mutex, since they're taken by whichever thread the connection
+         * delivers text on.
+         */
+        std::mutex spareBuffersMutex;
+        std::vector< std::string > spareBuffers;
+        size_t spareBufferBytes = 0;
 
-                    // First character of parameter
-                    case 4:
-                    {
-                        if (line[offset] == ':')
-                        {
-                            state = 6;
-                            message.parameters.push_back("");
-                        }
-                        else if (line[offset] != ' ')
-                        {
-                            state = 5;
-                            message.parameters.push_back(line.substr(offset, 1));
-                        }
+        /**
+         * These are parameter strings set aside when a message had fewer
+         * parameters than the one before it, so that their storage is reused
+         * by later messages with more. Only the worker thread uses them.
+         */
+        std::vector< std::string > spareParameters;
 
-                    } break;
-                    
-                    // Parameter (not last, or last having no spaces)
-                    case 5:
-                    {
-                        if (line[offset] == ' ')
-                        {
-                            state = 4;
-                        }
-                        else
-                        {
-                            message.parameters.back() += line[offset];
-                        }
-                    } break;
+        /**
+         * These are actions posted by the worker thread itself, performed
+         * before those in the queue. Only the worker thread uses them.
+         */
+        std::deque< Action > workerActions;
 
-                    // Last Parameter (May include spaces)
-                    case 6:
-                    {
-                        message.parameters.back() += line[offset];
-                    } break;
-                }
-                ++offset;
-            }
+        /**
+         * This is the symbol of the agent's nickname, to recognize when the
+         * server confirms the agent has joined a channel. Only the worker
+         * thread uses it.
+         */
+        SymbolTable::Symbol nicknameSymbol = SymbolTable::NO_SYMBOL;
+
+#ifdef TWITCH_BOT_COROUTINES
+        /**
+         * These are the operations the worker is waiting to complete:
+         * logging in, joining channels, and waiting for messages in a
+         * channel, by channel symbol, or in any channel. Each operation
+         * remembers its place in its list, so that it can be taken out
+         * quickly. Only the worker thread uses them.
+         */
+        std::vector< Operation* > logInOperations;
+        std::vector< Operation* > joinOperations;
+        std::unordered_map< SymbolTable::Symbol, std::vector< Operation* > > channelMessageOperations;
+        std::vector< Operation* > anyMessageOperations;
+
+        /**
+         * This is the number of operations waiting for messages, so that
+         * messages are only checked against them when there are any.
+         */
+        size_t messageOperationCount = 0;
+
+        /**
+         * This is where the worker keeps its timeouts, while it's running,
+         * so that operations can time out.
+         */
+        TimerWheel* operationTimeouts = nullptr;
+
+        /**
+         * This is set by the worker thread once it has stopped, just before
+         * it fails the operations left over, so that operations handed to
+         * it afterwards fail at once rather than never completing. The
+         * mutex is held while operations are handed to the worker, so that
+         * none slips in after the leftovers are gone.
+         */
+        std::mutex operationsMutex;
+        bool operationsClosed = false;
+#endif /* TWITCH_BOT_COROUTINES */
 
-            // Invalid end states
-            if ((state == 0) || (state == 1) || (state == 2))
+        //Methods
+        
+        /**
+         * This method unpacks a single line received from the Twitch server
+         * into its parts.
+         *
+         * @param[in] line This is the line to unpack, without its CRLF.
+         *
+         * @param[out] message this is where to store the unpacked message.
+         * If the line is not a valid message, the command is left empty.
+         */
+        void ParseMessage(std::string_view line, Message& message)
+        {
+            // The strings of the previous message are reused, so that their
+            // storage is only allocated once.
+            MessageTokens tokens;
+            message.prefix.clear();
+            message.command.clear();
+            message.knownCommand = KnownCommand::Other;
+            message.channelSymbol = SymbolTable::NO_SYMBOL;
+            message.userSymbol = SymbolTable::NO_SYMBOL;
+            if (!TokenizeMessage(line, tokens))
             {
-                message.command.clear();
+                message.tags.Clear();
+                SetParameterCount(message, 0);
                 // If logging facility is being implemented in the future, an
                 // error would be logged here for an invalid message.
+                return;
+            }
+            message.tags.Assign(tokens.tags);
+            message.prefix.assign(tokens.prefix);
+            message.command.assign(tokens.command);
+            SetParameterCount(message, tokens.parameterCount);
+            for (size_t i = 0; i < tokens.parameterCount; ++i)
+            {
+                message.parameters[i].assign(tokens.parameters[i]);
+            }
+            message.knownCommand = FindKnownCommand(tokens.command);
+            if (
+                (tokens.parameterCount > 0)
+                && (tokens.parameters[0].length() > 1)
+                && (tokens.parameters[0][0] == '#')
+            )
+            {
+                const auto channel = tokens.parameters[0].substr(1);
+                if (channel != lastChannel)
+                {
+                    lastChannel.assign(channel);
+                    lastChannelSymbol = symbolCache.Intern(channel);
+                }
+                message.channelSymbol = lastChannelSymbol;
+            }
+            // Senders are only looked up, not interned, so that the table
+            // doesn't grow with every chatter. The worker only compares
+            // them with names it has interned itself, such as the agent's
+            // nickname and the users operations are waiting for.
+            const auto userEnd = tokens.prefix.find('!');
+            if (userEnd != std::string_view::npos)
+            {
+                message.userSymbol = symbolCache.Find(tokens.prefix.substr(0, userEnd));
+            }
+        }
+
+        /**
+         * This method changes the number of parameters of a message, moving
+         * parameter strings to and from the spare ones rather than
+         * destroying and constructing them.
+         *
+         * @param[in,out] message This is the message to change.
+         *
+         * @param[in] count This is the number of parameters it should have.
+         */
+        void SetParameterCount(Message& message, size_t count)
+        {
+            while (message.parameters.size() > count)
+            {
+                spareParameters.push_back(std::move(message.parameters.back()));
+                message.parameters.pop_back();
+            }
+            while (message.parameters.size() < count)
+            {
+                if (spareParameters.empty())
+                {
+                    message.parameters.emplace_back();
+                }
+                else
+                {
+                    message.parameters.push_back(std::move(spareParameters.back()));
+                    spareParameters.pop_back();
+                }
+            }
+        }
+
+        /**
+         * This method handles the keepalive messages in text received from
+         * the Twitch server, on the thread delivering it, before the text
+         * joins the queue for the worker. A PING is answered right away,
+         * ahead of anything waiting in the outbound queue, however far
+         * behind the worker is. A PONG answering the agent's own PING is
+         * timed and noted, so the worker doesn't mistake a connection for
+         * dead just because it hasn't got to the PONG yet.
+         *
+         * @param[in,out] connection This is the connection on which the text
+         * was received.
+         *
+         * @param[in,out] keepAlive This is what's kept track of for the
+         * connection's keepalive messages.
+         *
+         * @param[in] rawText This is the raw text received from the Twitch
+         * server.
+         */
+        void HandleKeepAlive(
+            Connection& connection,
+            LinkKeepAlive& keepAlive,
+            const std::string& rawText
+        )
+        {
+            keepAlive.scanner.Scan(rawText);
+            KeepAliveScanner::Kind kind;
+            std::string_view parameter;
+            while (keepAlive.scanner.NextKeepAlive(kind, parameter))
+            {
+                if (kind == KeepAliveScanner::Kind::Ping)
+                {
+                    connection.Send("PONG :" + std::string(parameter) + CRLF);
+                    pingsAnswered.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                // The agent's PINGs carry the time they were sent. A token
+                // which isn't a number, or is too big to be one of them,
+                // answers someone else's PING.
+                int64_t token = 0;
+                for (const auto c: parameter)
+                {
+                    if (
+                        (c < '0') || (c > '9')
+                        || (token > (INT64_MAX - 9) / 10)
+                    )
+                    {
+                        token = 0;
+                        break;
+                    }
+                    token = token * 10 + (c - '0');
+                }
+                if (
+                    (token == 0)
+                    || (token <= keepAlive.lastPong.load(std::memory_order_relaxed))
+                )
+                {
+                    continue;
+                }
+                const auto now = GetSteadyTime();
+                if (token <= now)
+                {
+                    serverRoundTripHistogram.Record((uint64_t)(now - token));
+                }
+                keepAlive.lastPong.store(token, std::memory_order_release);
             }
-            return true;
         }
 
         /**
          * This method is called to whenever any message is received from the
          * Twitch server for the user agent.
          *
+         * @param[in] connectionId This identifies the connection on which
+         * the text was received.
+         *
          * @param[in] rawText This is the raw text received from the Twitch
          * server.
+         *
+         * @param[in] closing This is set once the connection is being
+         * closed, after which the text is thrown away if the worker is too
+         * far behind to take it.
          */
-        void MessageReceived(const std::string& rawText)
+        void MessageReceived(
+            uint64_t connectionId,
+            const std::string& rawText,
+            const std::atomic< bool >& closing
+        )
         {
-            std::lock_guard< decltype(mutex) > lock(mutex);
             Action action;
             action.type = ActionType::ProcessMessageRecieved;
-            action.message = rawText;
-            actions.push_back(action);
-            wakeWorker.notify_one();
+            action.connectionId = connectionId;
+            {
+                std::lock_guard< decltype(spareBuffersMutex) > lock(spareBuffersMutex);
+                if (!spareBuffers.empty())
+                {
+                    action.message = std::move(spareBuffers.back());
+                    spareBuffers.pop_back();
+                    spareBufferBytes -= action.message.capacity();
+                }
+            }
+            action.message.assign(rawText);
+            if (!PostQueuedAction(action, &closing))
+            {
+                chunksDropped.fetch_add(1, std::memory_order_relaxed);
+                RecycleBuffer(action.message);
+            }
+        }
+
+        /**
+         * This method keeps the buffer of a chunk of received text which the
+         * worker is done with, to be reused for a later chunk, unless enough
+         * memory is kept already or it's unusually large.
+         *
+         * @param[in,out] buffer This is the buffer to keep. If it's kept,
+         * it's left empty.
+         */
+        void RecycleBuffer(std::string& buffer)
+        {
+            if (buffer.capacity() > MAX_SPARE_BUFFER_CAPACITY)
+            {
+                return;
+            }
+            std::lock_guard< decltype(spareBuffersMutex) > lock(spareBuffersMutex);
+            if (
+                (spareBuffers.size() < ACTION_QUEUE_CAPACITY)
+                && (spareBufferBytes + buffer.capacity() <= MAX_SPARE_BUFFER_BYTES)
+            )
+            {
+                spareBufferBytes += buffer.capacity();
+                spareBuffers.push_back(std::move(buffer));
+            }
         }
 
         /**
         * This method is called when the Twitch server closes its end of the
         * connection.
+        *
+        * @param[in] connectionId This identifies the connection which was
+        * closed.
+        *
+        * @param[in] closing This is set once the worker is closing the
+        * connection itself, after which there's no need to tell it.
         */
-        void ServerDisconnected()
+        void ServerDisconnected(
+            uint64_t connectionId,
+            const std::atomic< bool >& closing
+        )
         {
-            std::lock_guard< decltype(mutex) > lock(mutex);
             Action action;
             action.type = ActionType::ServerDisconnected;
-            action.message = rawText;
-            actions.push_back(action);
-            wakeWorker.notify_one();
+            action.connectionId = connectionId;
+            (void)PostQueuedAction(action, &closing);
+        }
+
+        /**
+         * This method hands the given action to the worker thread. It may be
+         * called from any thread.
+         *
+         * If the queue is full, this waits for the worker to make room,
+         * unless the worker is stopping, or the action is posted by the
+         * worker of another MessageManager, in which case it goes in the
+         * list of pending actions instead.
+         *
+         * @param[in,out] action This is the action to perform. It is moved
+         * into the queue of actions, if it's posted.
+         *
+         * @return an indication of whether or not the action was posted is
+         * returned. It isn't if the queue is full and the worker is
+         * stopping.
+         */
+        bool PostAction(Action& action)
+        {
+            if (runningWorker == this)
+            {
+                action.posted = GetSteadyTime();
+                workerActions.push_back(std::move(action));
+                return true;
+            }
+            if (runningWorker != nullptr)
+            {
+                PostPendingAction(action);
+                return true;
+            }
+            return PostQueuedAction(action);
+        }
+
+        /**
+         * This method hands the given action to the worker thread, in the
+         * list of pending actions, which never waits for the worker.
+         *
+         * @param[in,out] action This is the action to perform. It is moved
+         * into the list of pending actions.
+         */
+        void PostPendingAction(Action& action)
+        {
+            action.posted = GetSteadyTime();
+            {
+                std::lock_guard< decltype(pendingActionsMutex) > lock(pendingActionsMutex);
+                pendingActions.push_back(std::move(action));
+                pendingActionsWaiting.store(true, std::memory_order_release);
+            }
+            WakeWorker();
+        }
+
+        /**
+         * This method hands the given action to the worker thread, in the
+         * queue of actions. It's how the threads delivering the traffic of
+         * the connections post it.
+         *
+         * If the queue is full, this waits for the worker to make room,
+         * unless the worker is stopping, or the given flag is set. Closing a
+         * connection waits for the thread delivering its traffic, so that
+         * thread must be able to give up.
+         *
+         * @param[in,out] action This is the action to perform. It is moved
+         * into the queue of actions, if it's posted.
+         *
+         * @param[in] abandon If not nullptr, this is set once the action is
+         * no longer wanted, such as traffic of a connection being closed,
+         * after which the action is dropped rather than waiting for room in
+         * the queue.
+         *
+         * @return an indication of whether or not the action was posted is
+         * returned.
+         */
+        bool PostQueuedAction(
+            Action& action,
+            const std::atomic< bool >* abandon = nullptr
+        )
+        {
+            action.posted = GetSteadyTime();
+            while (!actions.TryPush(action))
+            {
+                if (
+                    stopWorker.load(std::memory_order_relaxed)
+                    || (
+                        (abandon != nullptr)
+                        && abandon->load(std::memory_order_acquire)
+                    )
+                )
+                {
+                    return false;
+                }
+
+                // The worker has fallen behind, so give it a chance to catch
+                // up.
+                WakeWorker();
+                std::this_thread::yield();
+            }
+            WakeWorker();
+            return true;
+        }
+
+        /**
+         * This method wakes up the worker thread if it is waiting. If the
+         * worker is already running, this doesn't touch the mutex at all.
+         */
+        void WakeWorker()
+        {
+            // This pairs with the fence in Worker, so that either the worker
+            // sees the action just posted, or this sees that the worker is
+            // waiting.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (workerWaiting.load(std::memory_order_relaxed))
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                workerWaiting = false;
+                wakeWorker.notify_one();
+            }
         }
 
         /**
@@ -406,15 +1168,486 @@ namespace TwitchBot
         {
             if (!farewell.empty())
             {
-                connection->Send("QUIT :", farewell + CRLF);
+                outbound.Enqueue(
+                    OutboundLane::Critical,
+                    RateLimitClass::None,
+                    "QUIT :" + farewell + CRLF,
+                    GetCurrentTime()
+                );
+                FlushOutbound(connection);
+            }
+            outbound.Clear();
+            connection.Disconnect();
+            NotifyLoggedOut();
+        }
+
+        /**
+         * This method calls a delegate on the given strand of the executor,
+         * or right away on the worker thread if there's no executor.
+         *
+         * @param[in,out] strand This is the strand on which to call the
+         * delegate. It's made if it isn't valid yet.
+         *
+         * @param[in] call This calls the delegate.
+         */
+        void CallDelegate(Executor::Strand& strand, Executor::Task call)
+        {
+            if (executor == nullptr)
+            {
+                call();
+                return;
+            }
+            if (!strand.IsValid())
+            {
+                strand = executor->MakeStrand();
+            }
+            ++callsPending;
+            strand.Post(
+                [this, call = std::move(call)]
+                {
+                    call();
+                    if (--callsPending == 0)
+                    {
+                        std::lock_guard< decltype(mutex) > lock(mutex);
+                        callsDone.notify_all();
+                    }
+                }
+            );
+        }
+
+        /**
+         * This method hands a message received from the Twitch server to the
+         * user, on the strand for the message's channel, after adding it to
+         * the archive, feeding it to the full-text index and counting it in
+         * the analytics, if any.
+         *
+         * @param[in] message This is the message received.
+         */
+        void DeliverMessage(const Message& message)
+        {
+            if (chatLog != nullptr)
+            {
+                (void)chatLog->Append(message);
+            }
+            if (chatIndex != nullptr)
+            {
+                (void)chatIndex->Add(message);
+            }
+            if (chatAnalytics != nullptr)
+            {
+                (void)chatAnalytics->Add(message, GetCurrentTime());
+            }
+            if (messageReceivedDelegate == nullptr)
+            {
+                return;
+            }
+            if (executor == nullptr)
+            {
+                messageReceivedDelegate(message);
+                return;
+            }
+            auto strand = &serverStrand;
+            if (message.channelSymbol != SymbolTable::NO_SYMBOL)
+            {
+                strand = &channelStrands[message.channelSymbol];
+            }
+            CallDelegate(
+                *strand,
+                [this, message]{ messageReceivedDelegate(message); }
+            );
+        }
+
+        /**
+         * This method tells the user that the agent has logged out, or
+         * failed to log in.
+         */
+        void NotifyLoggedOut()
+        {
+            if (loggedOutDelegate != nullptr)
+            {
+                CallDelegate(serverStrand, [this]{ loggedOutDelegate(); });
+            }
+        }
+
+        /**
+         * This method returns the current time, in seconds. If no time keeper
+         * was provided, a steady clock is used instead.
+         *
+         * @return The current time, in seconds.
+         */
+        double GetCurrentTime()
+        {
+            if (timeKeeper != nullptr)
+            {
+                return timeKeeper->GetCurrentTime();
+            }
+            return std::chrono::duration< double >(
+                std::chrono::steady_clock::now().time_since_epoch()
+            ).count();
+        }
+
+        /**
+         * This method sends every line which the outbound rate limits allow
+         * right now, coalesced into as few writes as possible.
+         *
+         * @param[in,out] connection This is the connection on which to send.
+         */
+        void FlushOutbound(Connection& connection)
+        {
+            const auto now = GetCurrentTime();
+            std::string batch;
+            bool sent = false;
+            while (outbound.Dequeue(now, batch))
+            {
+                connection.Send(batch);
+                sent = true;
+            }
+            if (sent)
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                outboundStats = outbound.GetStats();
+            }
+        }
+
+        /**
+         * This method returns the measurements in the Prometheus text
+         * exposition format.
+         *
+         * @return The measurements, as text, are returned.
+         */
+        std::string FormatStats()
+        {
+            std::string text;
+            text += "# HELP twitchbot_chunks_received_total Chunks of text received from the server.\n";
+            text += "# TYPE twitchbot_chunks_received_total counter\n";
+            AppendSample(text, "twitchbot_chunks_received_total", (double)chunksReceived.load(std::memory_order_relaxed));
+            text += "# HELP twitchbot_bytes_received_total Characters received from the server.\n";
+            text += "# TYPE twitchbot_bytes_received_total counter\n";
+            AppendSample(text, "twitchbot_bytes_received_total", (double)bytesReceived.load(std::memory_order_relaxed));
+            text += "# HELP twitchbot_messages_received_total Valid messages received from the server.\n";
+            text += "# TYPE twitchbot_messages_received_total counter\n";
+            AppendSample(text, "twitchbot_messages_received_total", (double)messagesReceived.load(std::memory_order_relaxed));
+            text += "# HELP twitchbot_parse_failures_total Lines received which were not valid messages.\n";
+            text += "# TYPE twitchbot_parse_failures_total counter\n";
+            AppendSample(text, "twitchbot_parse_failures_total", (double)parseFailures.load(std::memory_order_relaxed));
+            text += "# HELP twitchbot_lines_dropped_total Incomplete lines thrown away when the connection closed.\n";
+            text += "# TYPE twitchbot_lines_dropped_total counter\n";
+            AppendSample(text, "twitchbot_lines_dropped_total", (double)linesDropped.load(std::memory_order_relaxed));
+            text += "# HELP twitchbot_chunks_dropped_total Chunks of text thrown away while their connection was closing.\n";
+            text += "# TYPE twitchbot_chunks_dropped_total counter\n";
+            AppendSample(text, "twitchbot_chunks_dropped_total", (double)chunksDropped.load(std::memory_order_relaxed));
+            text += "# HELP twitchbot_reconnects_total Times the connection in use was replaced.\n";
+            text += "# TYPE twitchbot_reconnects_total counter\n";
+            AppendSample(text, "twitchbot_reconnects_total", (double)reconnects.load(std::memory_order_relaxed));
+            text += "# HELP twitchbot_stage_seconds Time taken by each stage of handling traffic.\n";
+            text += "# TYPE twitchbot_stage_seconds histogram\n";
+            AppendHistogram(text, "twitchbot_stage_seconds", "queue_wait", queueWaitHistogram);
+            AppendHistogram(text, "twitchbot_stage_seconds", "parse", parseHistogram);
+            AppendHistogram(text, "twitchbot_stage_seconds", "dispatch", dispatchHistogram);
+            AppendHistogram(text, "twitchbot_stage_seconds", "outbound_wait", outbound.GetWaitHistogram());
+            text += "# HELP twitchbot_pings_answered_total PINGs from the server answered.\n";
+            text += "# TYPE twitchbot_pings_answered_total counter\n";
+            AppendSample(text, "twitchbot_pings_answered_total", (double)pingsAnswered.load(std::memory_order_relaxed));
+            text += "# HELP twitchbot_keepalive_timeouts_total Connections given up on for want of a PONG.\n";
+            text += "# TYPE twitchbot_keepalive_timeouts_total counter\n";
+            AppendSample(text, "twitchbot_keepalive_timeouts_total", (double)keepAliveTimeouts.load(std::memory_order_relaxed));
+            text += "# HELP twitchbot_server_round_trip_seconds Time for the server to answer a PING.\n";
+            text += "# TYPE twitchbot_server_round_trip_seconds histogram\n";
+            AppendHistogram(text, "twitchbot_server_round_trip_seconds", "", serverRoundTripHistogram);
+            OutboundScheduler::Stats outboundCopy;
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                outboundCopy = outboundStats;
+            }
+            text += "# HELP twitchbot_outbound_lines_sent_total Lines sent to the server, by lane.\n";
+            text += "# TYPE twitchbot_outbound_lines_sent_total counter\n";
+            for (size_t lane = 0; lane < (size_t)OutboundLane::Count; ++lane)
+            {
+                AppendSample(
+                    text,
+                    std::string("twitchbot_outbound_lines_sent_total{lane=\"") + OUTBOUND_LANE_NAMES[lane] + "\"}",
+                    (double)outboundCopy.linesSent[lane]
+                );
+            }
+            text += "# HELP twitchbot_outbound_queue_depth Lines waiting to be sent, by lane.\n";
+            text += "# TYPE twitchbot_outbound_queue_depth gauge\n";
+            for (size_t lane = 0; lane < (size_t)OutboundLane::Count; ++lane)
+            {
+                AppendSample(
+                    text,
+                    std::string("twitchbot_outbound_queue_depth{lane=\"") + OUTBOUND_LANE_NAMES[lane] + "\"}",
+                    (double)outboundCopy.queueDepth[lane]
+                );
+            }
+            text += "# HELP twitchbot_outbound_throttled_total Times a line was held back by a rate limit.\n";
+            text += "# TYPE twitchbot_outbound_throttled_total counter\n";
+            AppendSample(text, "twitchbot_outbound_throttled_total", (double)outboundCopy.throttled);
+            return text;
+        }
+
+        /**
+         * This method writes the measurements to a file, under a temporary
+         * name first and then renamed over the file.
+         *
+         * @param[in] path This is the path of the file.
+         */
+        void WriteStatsFile(const std::string& path)
+        {
+            const auto text = FormatStats();
+            const auto temporaryPath = path + ".tmp";
+            const auto file = fopen(temporaryPath.c_str(), "w");
+            if (file == nullptr)
+            {
+                return;
+            }
+            const auto written = fwrite(text.data(), 1, text.length(), file);
+            if (
+                (fclose(file) != 0)
+                || (written != text.length())
+            )
+            {
+                (void)remove(temporaryPath.c_str());
+                return;
+            }
+            (void)rename(temporaryPath.c_str(), path.c_str());
+        }
+
+        /**
+         * This method takes the next action for the worker to perform,
+         * first from those the worker posted itself, then from those other
+         * workers posted, then from the queue.
+         *
+         * @param[out] action This is where to store the action.
+         *
+         * @return an indication of whether or not there was an action to
+         * perform is returned.
+         */
+        bool NextAction(Action& action)
+        {
+            if (
+                workerActions.empty()
+                && pendingActionsWaiting.load(std::memory_order_acquire)
+            )
+            {
+                std::lock_guard< decltype(pendingActionsMutex) > lock(pendingActionsMutex);
+                workerActions.swap(pendingActions);
+                pendingActionsWaiting.store(false, std::memory_order_relaxed);
+            }
+            if (!workerActions.empty())
+            {
+                action = std::move(workerActions.front());
+                workerActions.pop_front();
+                return true;
+            }
+            return actions.TryPop(action);
+        }
+
+#ifdef TWITCH_BOT_COROUTINES
+        /**
+         * This method puts an operation in a list of operations the worker
+         * is waiting to complete, and starts its timeout, if it has one.
+         *
+         * @param[in,out] operation This is the operation to wait for.
+         *
+         * @param[in,out] waiting This is the list of operations to which to
+         * add it.
+         */
+        void WaitForOperation(
+            Operation* operation,
+            std::vector< Operation* >& waiting
+        )
+        {
+            operation->waitingIndex_ = waiting.size();
+            waiting.push_back(operation);
+            if (operation->timeout_ > 0.0)
+            {
+                operation->timer_ = operationTimeouts->Schedule(
+                    SecondsToTicks(GetCurrentTime() + operation->timeout_),
+                    [this, operation]
+                    {
+                        operation->timer_ = 0;
+                        CompleteOperation(operation, false);
+                    }
+                );
             }
-            connection->Disconnect();
-            if(loggedOutDelegate != nullptr)
+        }
+
+        /**
+         * This method returns the list of waiting operations which holds
+         * the given operation.
+         *
+         * @param[in] operation This is the waiting operation.
+         *
+         * @return The list holding the operation is returned.
+         */
+        std::vector< Operation* >& GetWaitingList(Operation* operation)
+        {
+            switch (operation->kind_)
             {
-                loggedOutDelegate();
+                case Operation::Kind::LogIn: return logInOperations;
+                case Operation::Kind::Join: return joinOperations;
+                default:
+                {
+                    if (operation->channelSymbol_ == SymbolTable::NO_SYMBOL)
+                    {
+                        return anyMessageOperations;
+                    }
+                    return channelMessageOperations[operation->channelSymbol_];
+                }
             }
         }
 
+        /**
+         * This method finishes an operation, taking it out of whichever
+         * list of waiting operations it's in, and resumes the coroutine
+         * awaiting it, right here on the worker thread.
+         *
+         * @param[in,out] operation This is the operation to finish.
+         *
+         * @param[in] succeeded This indicates whether or not the operation
+         * succeeded.
+         *
+         * @param[in] waiting This indicates whether or not the operation is
+         * in a list of waiting operations.
+         */
+        void CompleteOperation(
+            Operation* operation,
+            bool succeeded,
+            bool waiting = true
+        )
+        {
+            if (waiting)
+            {
+                operationTimeouts->Cancel(operation->timer_);
+                operation->timer_ = 0;
+                auto& list = GetWaitingList(operation);
+                list.back()->waitingIndex_ = operation->waitingIndex_;
+                list[operation->waitingIndex_] = list.back();
+                list.pop_back();
+                if (operation->kind_ == Operation::Kind::NextMessage)
+                {
+                    --messageOperationCount;
+                }
+            }
+            operation->succeeded_ = succeeded;
+            operation->handle_.resume();
+        }
+
+        /**
+         * This method fails every operation in the given list.
+         *
+         * @param[in,out] waiting This is the list of operations to fail.
+         */
+        void FailOperations(std::vector< Operation* >& waiting)
+        {
+            while (!waiting.empty())
+            {
+                CompleteOperation(waiting.back(), false);
+            }
+        }
+
+        /**
+         * This method fails every operation the worker is waiting to
+         * complete.
+         */
+        void FailAllOperations()
+        {
+            FailOperations(logInOperations);
+            FailOperations(joinOperations);
+            FailOperations(anyMessageOperations);
+            for (auto& channelOperations: channelMessageOperations)
+            {
+                FailOperations(channelOperations.second);
+            }
+        }
+
+        /**
+         * This method completes every operation waiting for the given
+         * message, such as the server confirming the agent has joined a
+         * channel, or the next message in a channel.
+         *
+         * @param[in] message This is the message received.
+         */
+        void CompleteOperations(const Message& message)
+        {
+            if (
+                (message.knownCommand == KnownCommand::Join)
+                && (message.userSymbol == nicknameSymbol)
+            )
+            {
+                size_t i = 0;
+                while (i < joinOperations.size())
+                {
+                    if (joinOperations[i]->channelSymbol_ == message.channelSymbol)
+                    {
+                        CompleteOperation(joinOperations[i], true);
+                    }
+                    else
+                    {
+                        ++i;
+                    }
+                }
+            }
+            if (messageOperationCount != 0)
+            {
+                if (message.channelSymbol != SymbolTable::NO_SYMBOL)
+                {
+                    const auto channelOperations = channelMessageOperations.find(message.channelSymbol);
+                    if (channelOperations != channelMessageOperations.end())
+                    {
+                        CompleteMessageOperations(message, channelOperations->second);
+                    }
+                }
+                CompleteMessageOperations(message, anyMessageOperations);
+            }
+        }
+
+        /**
+         * This method completes every operation waiting for a message which
+         * the given message passes the filter of.
+         *
+         * @param[in] message This is the message received.
+         *
+         * @param[in,out] waiting This is the list of operations to check.
+         */
+        void CompleteMessageOperations(
+            const Message& message,
+            std::vector< Operation* >& waiting
+        )
+        {
+            size_t i = 0;
+            while (i < waiting.size())
+            {
+                const auto operation = (MessageOperation*)waiting[i];
+                const auto& filter = operation->filter_;
+                if (
+                    (
+                        (filter.command == KnownCommand::Other)
+                        || (filter.command == message.knownCommand)
+                    )
+                    && (
+                        (operation->userSymbol_ == SymbolTable::NO_SYMBOL)
+                        || (operation->userSymbol_ == message.userSymbol)
+                    )
+                    && (
+                        (filter.predicate == nullptr)
+                        || filter.predicate(message)
+                    )
+                )
+                {
+                    // This takes the operation out of the list, putting the
+                    // last one in its place, so look at the same place again.
+                    operation->message_ = message;
+                    CompleteOperation(operation, true);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+#endif /* TWITCH_BOT_COROUTINES */
+
         /**
          * This method signals the worker thread to stop.
          */
@@ -431,171 +1664,1066 @@ namespace TwitchBot
          */
         void Worker()
         {
-            // This is the interface to the current connection to the Twitch
-            // server, if we are connected.
-            std::shared_ptr< Connection > connection;
+            // These are the connections to the Twitch server: the one in
+            // use, if any, a spare one logged in ahead of time, if warm
+            // standby is enabled, and one being replaced, which is kept until
+            // the channels are joined again on its replacement, so that no
+            // messages are missed in between.
+            ServerLink primary;
+            ServerLink standby;
+            ServerLink draining;
+
+            // This is the number which identifies the next connection made,
+            // so that traffic from connections since replaced is ignored.
+            uint64_t nextLinkId = 1;
+
+            // This holds each message received while it's handled. It lives
+            // as long as the worker, so that once its strings have grown to
+            // fit the messages received, parsing doesn't allocate memory.
+            Message message;
+
+            // Actions posted from this thread, such as by a coroutine
+            // resumed here, go straight to the worker's own list.
+            runningWorker = this;
 
-            // All incoming data in the form of a buffer to receive the
-            // characters coming in from the Twitch server, until a complete
-            // line has been received, removed from the buffer, and handeled.
-            std::string dataReceived;
+            // This holds onto any conditions that the worker is awaiting, which
+            // might time out. Time is measured in ticks of the time keeper's
+            // time (see SecondsToTicks).
+            TimerWheel timeouts;
+#ifdef TWITCH_BOT_COROUTINES
+            operationTimeouts = &timeouts;
+#endif /* TWITCH_BOT_COROUTINES */
+
+            // This is the timer which wakes the worker when lines held back
+            // by a rate limit may be sent, and when it is due, in ticks.
+            TimerWheel::TimerId outboundTimeout = 0;
+            uint64_t outboundDeadline = 0;
+
+            // These are the symbols of the channels in which the bot is a
+            // moderator or the broadcaster, which gives it a higher chat rate
+            // limit.
+            std::unordered_set< SymbolTable::Symbol > moderatedChannels;
+
+            // This counts the lines received since the last one whose parse
+            // and dispatch stages were timed.
+            size_t linesSinceSample = 0;
+
+            // This is where, and how often, to write the measurements, and
+            // the timer which next writes them.
+            std::string statsPath;
+            double statsInterval = 0.0;
+            TimerWheel::TimerId statsTimer = 0;
+            std::function< void() > writeStats = [&]
+            {
+                WriteStatsFile(statsPath);
+                statsTimer = timeouts.Schedule(
+                    SecondsToTicks(GetCurrentTime() + statsInterval),
+                    writeStats
+                );
+            };
+
+            // This is the session which the agent keeps up, from LogIn until
+            // LogOut: the nickname and token to log in with, and the symbols
+            // of the channels to be in.
+            bool sessionActive = false;
+            std::string sessionNickname;
+            std::string sessionToken;
+            std::unordered_set< SymbolTable::Symbol > sessionChannels;
+
+            // These are the symbols of the channels joined again on the
+            // connection in use since it replaced the one draining, and the
+            // timer which closes the one draining regardless.
+            std::unordered_set< SymbolTable::Symbol > rejoinedChannels;
+            TimerWheel::TimerId drainTimeout = 0;
+
+            // These are the number of attempts in a row to reconnect since
+            // the agent was last logged in, and the timers which make the
+            // next attempt to reconnect, or to make a standby connection.
+            size_t reconnectAttempts = 0;
+            TimerWheel::TimerId reconnectTimer = 0;
+            TimerWheel::TimerId standbyTimer = 0;
+
+            // This indicates whether or not the user was last told that the
+            // agent logged in, rather than logged out, so that replacing
+            // the connection without losing the session isn't reported.
+            bool loggedInNotified = false;
+
+            // This spreads out the delays before reconnecting.
+            std::minstd_rand jitter((std::minstd_rand::result_type)GetSteadyTime());
+
+            // This returns the connection from which traffic with the given
+            // identifier came, or nullptr if it's since been closed.
+            const auto findLink = [&](uint64_t id) -> ServerLink*
+            {
+                for (auto link: {&primary, &standby, &draining})
+                {
+                    if (
+                        (link->connection != nullptr)
+                        && (link->id == id)
+                    )
+                    {
+                        return link;
+                    }
+                }
+                return nullptr;
+            };
 
-            // This flag indiciates whether or not the client has finished
-            // logging into the Twitch server (we've received the MOTD from the
-            // server).
-            bool loggedIn = false;
+            // This closes a connection other than the one in use, quietly.
+            const auto closeLink = [&](ServerLink& link)
+            {
+                if (link.connection == nullptr)
+                {
+                    return;
+                }
+                link.keepAlive->closing.store(true, std::memory_order_release);
+                if (!link.connecting)
+                {
+                    link.connection->Disconnect();
+                }
+                if (link.dataReceived.GetBufferedLength() != 0)
+                {
+                    AddToCounter(linesDropped, 1);
+                }
+                timeouts.Cancel(link.logInTimeout);
+                timeouts.Cancel(link.keepAliveTimer);
+                link = ServerLink();
+            };
+
+            // This closes the connection in use, if any, and forgets the
+            // state of the session on the server.
+            const auto closeConnection = [&](const std::string& farewell)
+            {
+                if (primary.connection == nullptr)
+                {
+                    return;
+                }
+                primary.keepAlive->closing.store(true, std::memory_order_release);
+                if (primary.connecting)
+                {
+                    outbound.Clear();
+                    NotifyLoggedOut();
+                }
+                else
+                {
+                    Disconnect(*primary.connection, farewell);
+                }
+                if (primary.dataReceived.GetBufferedLength() != 0)
+                {
+                    AddToCounter(linesDropped, 1);
+                }
+                timeouts.Cancel(primary.logInTimeout);
+                timeouts.Cancel(primary.keepAliveTimer);
+                primary = ServerLink();
+                loggedInNotified = false;
+                moderatedChannels.clear();
+#ifdef TWITCH_BOT_COROUTINES
+                FailAllOperations();
+#endif /* TWITCH_BOT_COROUTINES */
+            };
+
+            // This handles losing a connection, or giving up waiting for it
+            // to log in, and is defined below.
+            std::function< void(uint64_t id, const std::string& farewell) > loseLink;
+
+            // These are the threads making connections, by the identifiers
+            // of the connections. Each is joined once the worker hears the
+            // outcome.
+            std::unordered_map< uint64_t, std::thread > connectors;
+
+            // This starts making a connection, on a thread of its own, since
+            // looking up the server and connecting to it may take a while.
+            // The worker carries on, and is told the outcome with a
+            // LinkConnected action. The time allowed to log in includes the
+            // time taken to connect.
+            const auto openLink = [&](ServerLink& link)
+            {
+                link.connection = connectionFactory();
+                link.id = nextLinkId++;
+                link.connecting = true;
+                link.keepAlive = std::make_shared< LinkKeepAlive >();
+                const auto id = link.id;
+                const auto connection = link.connection.get();
+                const auto keepAlive = link.keepAlive;
+                link.connection->SetMessageReceivedDelegate(
+                    [this, id, connection, keepAlive](const std::string& rawText)
+                    {
+                        HandleKeepAlive(*connection, *keepAlive, rawText);
+                        MessageReceived(id, rawText, keepAlive->closing);
+                    }
+                );
+                link.connection->SetDisconnectedDelegate(
+                    [this, id, keepAlive]
+                    {
+                        ServerDisconnected(id, keepAlive->closing);
+                    }
+                );
+                connectors[id] = std::thread(
+                    [this, id, connecting = link.connection]
+                    {
+                        Action action;
+                        action.type = ActionType::LinkConnected;
+                        action.connectionId = id;
+                        action.details = std::make_unique< ActionDetails >();
+                        action.details->connected = connecting->Connect();
+                        action.details->connection = connecting;
+                        PostPendingAction(action);
+                    }
+                );
+                if (timeKeeper != nullptr)
+                {
+                    const auto now = GetCurrentTime();
+                    link.logInTimeout = timeouts.Schedule(
+                        SecondsToTicks(now + LOG_IN_TIMEOUT_SECONDS),
+                        [&loseLink, id]
+                        {
+                            loseLink(id, "Timeout waiting for MOTD");
+                        }
+                    );
+                }
+            };
+
+            // This schedules the next PING on the given connection, if
+            // keepalive PINGs are enabled, after the given delay. The PING
+            // goes straight to the connection, ahead of anything waiting to
+            // be sent, and if the PONG doesn't come in time, the connection
+            // is treated as lost.
+            std::function< void(ServerLink& link, double delay) > schedulePing = [&](ServerLink& link, double delay)
+            {
+                timeouts.Cancel(link.keepAliveTimer);
+                link.keepAliveTimer = 0;
+                if (pingInterval <= 0.0)
+                {
+                    return;
+                }
+                const auto id = link.id;
+                const auto now = GetCurrentTime();
+                link.keepAliveTimer = timeouts.Schedule(
+                    SecondsToTicks(now + delay),
+                    [&, id]
+                    {
+                        const auto pinged = findLink(id);
+                        if (pinged == nullptr)
+                        {
+                            return;
+                        }
+                        pinged->keepAliveTimer = 0;
+                        pinged->pingToken = GetSteadyTime();
+                        pinged->connection->Send("PING :" + std::to_string(pinged->pingToken) + CRLF);
+                        const auto sent = GetCurrentTime();
+                        pinged->keepAliveTimer = timeouts.Schedule(
+                            SecondsToTicks(sent + pongTimeout),
+                            [&, id]
+                            {
+                                const auto waiting = findLink(id);
+                                if (waiting == nullptr)
+                                {
+                                    return;
+                                }
+                                waiting->keepAliveTimer = 0;
+                                if (waiting->keepAlive->lastPong.load(std::memory_order_acquire) < waiting->pingToken)
+                                {
+                                    AddToCounter(keepAliveTimeouts, 1);
+                                    loseLink(id, "");
+                                    return;
+                                }
+                                schedulePing(*waiting, std::max(0.0, pingInterval - pongTimeout));
+                            }
+                        );
+                    }
+                );
+            };
+
+            // This asks to join every channel of the session on the
+            // connection in use, as fast as the rate limits allow.
+            const auto rejoinChannels = [&]
+            {
+                const auto now = GetCurrentTime();
+                for (const auto channel: sessionChannels)
+                {
+                    outbound.Enqueue(
+                        OutboundLane::Chat,
+                        RateLimitClass::Join,
+                        "JOIN #" + std::string(symbolTable->GetName(channel)) + CRLF,
+                        now
+                    );
+                }
+            };
+
+            // This makes a standby connection, if one is wanted and there
+            // isn't one already, trying again later if it can't be made.
+            std::function< void(double delay) > scheduleStandby;
+            const auto openStandby = [&]
+            {
+                if (
+                    !warmStandby
+                    || !sessionActive
+                    || !primary.loggedIn
+                    || (standby.connection != nullptr)
+                )
+                {
+                    return;
+                }
+                openLink(standby);
+            };
+
+            // This schedules making a standby connection after the given
+            // delay.
+            scheduleStandby = [&](double delay)
+            {
+                if (
+                    !warmStandby
+                    || !sessionActive
+                    || (standby.connection != nullptr)
+                    || (standbyTimer != 0)
+                )
+                {
+                    return;
+                }
+                const auto now = GetCurrentTime();
+                standbyTimer = timeouts.Schedule(
+                    SecondsToTicks(now + delay),
+                    [&]
+                    {
+                        standbyTimer = 0;
+                        openStandby();
+                    }
+                );
+            };
+
+            // This handles the agent finishing logging in on the connection
+            // in use, telling the user unless they were never told the
+            // session was lost.
+            const auto primaryLoggedIn = [&]
+            {
+                primary.loggedIn = true;
+                reconnectAttempts = 0;
+                if (primary.keepAliveTimer == 0)
+                {
+                    schedulePing(primary, pingInterval);
+                }
+
+                // The standby is scheduled before the user is told, so once
+                // they know the agent is logged in, its timer is set.
+                scheduleStandby(STANDBY_DELAY_SECONDS);
+                if (
+                    !loggedInNotified
+                    && (loggedInDelegate != nullptr)
+                )
+                {
+                    CallDelegate(
+                        serverStrand,
+                        [this]{ loggedInDelegate(); }
+                    );
+                }
+                loggedInNotified = true;
+#ifdef TWITCH_BOT_COROUTINES
+                while (!logInOperations.empty())
+                {
+                    CompleteOperation(logInOperations.back(), true);
+                }
+#endif /* TWITCH_BOT_COROUTINES */
+            };
+
+            // This indicates whether or not the server asked the agent to
+            // reconnect while the standby connection was still being made,
+            // so that it takes over once it's made.
+            bool switchWhenStandbyConnected = false;
+
+            // This makes the standby connection the one in use, and joins
+            // the channels of the session on it.
+            const auto promoteStandby = [&]
+            {
+                switchWhenStandbyConnected = false;
+                primary = std::move(standby);
+                standby = ServerLink();
+                AddToCounter(reconnects, 1);
+                rejoinChannels();
+            };
+
+            // This makes a new connection to use, and starts logging in and
+            // joining the channels of the session on it, all at once, as
+            // soon as it's made.
+            std::function< void() > scheduleReconnect;
+            const auto openPrimary = [&]
+            {
+                if (primary.connection != nullptr)
+                {
+                    return;
+                }
+                openLink(primary);
+                rejoinChannels();
+            };
+
+            // This schedules the next attempt to reconnect, if reconnecting
+            // is enabled. The first attempt in a row is made right away, and
+            // each one after that waits for a random time between half of
+            // and all of a delay which doubles each time, up to a limit.
+            scheduleReconnect = [&]
+            {
+                if (
+                    !autoReconnect
+                    || !sessionActive
+                    || (primary.connection != nullptr)
+                    || (reconnectTimer != 0)
+                )
+                {
+                    return;
+                }
+                double delay = 0.0;
+                if (reconnectAttempts > 0)
+                {
+                    delay = std::min(
+                        RECONNECT_MAX_DELAY_SECONDS,
+                        RECONNECT_INITIAL_DELAY_SECONDS * (double)(1ull << std::min< size_t >(reconnectAttempts - 1, 16))
+                    );
+                    delay *= 0.5 + 0.5 * std::uniform_real_distribution< double >()(jitter);
+                }
+                ++reconnectAttempts;
+                const auto now = GetCurrentTime();
+                reconnectTimer = timeouts.Schedule(
+                    SecondsToTicks(now + delay),
+                    [&]
+                    {
+                        reconnectTimer = 0;
+                        if (primary.connection == nullptr)
+                        {
+                            AddToCounter(reconnects, 1);
+                            openPrimary();
+                        }
+                    }
+                );
+            };
+
+            loseLink = [&](uint64_t id, const std::string& farewell)
+            {
+                if (
+                    (primary.connection != nullptr)
+                    && (primary.id == id)
+                )
+                {
+                    closeConnection(farewell);
+                    if (
+                        autoReconnect
+                        && sessionActive
+                        && (standby.connection != nullptr)
+                    )
+                    {
+                        const auto standbyLoggedIn = standby.loggedIn;
+                        promoteStandby();
+                        if (standbyLoggedIn)
+                        {
+                            primaryLoggedIn();
+                        }
+                    }
+                    else
+                    {
+                        scheduleReconnect();
+                    }
+                }
+                else if (
+                    (standby.connection != nullptr)
+                    && (standby.id == id)
+                )
+                {
+                    switchWhenStandbyConnected = false;
+                    closeLink(standby);
+                    scheduleStandby(STANDBY_RETRY_SECONDS);
+                }
+                else if (
+                    (draining.connection != nullptr)
+                    && (draining.id == id)
+                )
+                {
+                    closeLink(draining);
+                    timeouts.Cancel(drainTimeout);
+                    drainTimeout = 0;
+                }
+            };
+
+            // This makes the standby connection the one in use, in place of
+            // one the server asked the agent to leave. Messages are still
+            // taken from the old connection until each channel is joined on
+            // the new one.
+            const auto switchToStandby = [&]
+            {
+                closeLink(draining);
+                timeouts.Cancel(drainTimeout);
+                draining = std::move(primary);
+                primary = ServerLink();
+                timeouts.Cancel(draining.logInTimeout);
+                draining.logInTimeout = 0;
+                rejoinedChannels.clear();
+                const auto now = GetCurrentTime();
+                drainTimeout = timeouts.Schedule(
+                    SecondsToTicks(now + DRAIN_TIMEOUT_SECONDS),
+                    [&]
+                    {
+                        drainTimeout = 0;
+                        closeLink(draining);
+                    }
+                );
+                promoteStandby();
+                if (primary.loggedIn)
+                {
+                    scheduleStandby(STANDBY_DELAY_SECONDS);
+                }
+            };
+
+            // This handles the server asking the agent to reconnect, which
+            // it does a while before closing the connection. The standby
+            // connection takes over if there is one, and otherwise a new
+            // connection is made, and takes over once it's made. The old
+            // connection is still good until then, and if the new one can't
+            // be made, reconnecting starts as usual when the old one is
+            // closed.
+            const auto serverAskedToReconnect = [&]
+            {
+                if (!sessionActive)
+                {
+                    return;
+                }
+                if (standby.connection == nullptr)
+                {
+                    openLink(standby);
+                }
+                if (standby.connecting)
+                {
+                    switchWhenStandbyConnected = true;
+                    return;
+                }
+                switchToStandby();
+            };
+
+            // This handles the outcome of making a connection. Once made,
+            // logging in starts, sending the capabilities to request, the
+            // token and the nickname in a single write, ahead of anything
+            // else waiting to be sent. A connection no longer wanted is
+            // closed, and a failure is handled like losing the connection.
+            const auto linkConnected = [&](Action& action)
+            {
+                const auto connector = connectors.find(action.connectionId);
+                if (connector != connectors.end())
+                {
+                    connector->second.join();
+                    connectors.erase(connector);
+                }
+                // The link holds its own reference to the connection, so
+                // if the link was given up on, dropping this one closes it.
+                action.details->connection = nullptr;
+                const auto link = findLink(action.connectionId);
+                if (link == nullptr)
+                {
+                    return;
+                }
+                if (action.details->connected)
+                {
+                    link->connecting = false;
+                    link->connection->Send(
+                        "CAP REQ :" + CAPABILITIES + CRLF
+                        + "PASS oauth:" + sessionToken + CRLF
+                        + "NICK " + sessionNickname + CRLF
+                    );
+                    if (
+                        (link == &standby)
+                        && switchWhenStandbyConnected
+                        && (primary.connection != nullptr)
+                    )
+                    {
+                        switchToStandby();
+                    }
+                    return;
+                }
+                if (link == &primary)
+                {
+                    timeouts.Cancel(primary.logInTimeout);
+                    primary = ServerLink();
+                    outbound.Clear();
+                    moderatedChannels.clear();
+#ifdef TWITCH_BOT_COROUTINES
+                    FailAllOperations();
+#endif /* TWITCH_BOT_COROUTINES */
+
+                    // The user only hears about the first failure in a row.
+                    if (reconnectAttempts == 0)
+                    {
+                        NotifyLoggedOut();
+                    }
+                    loggedInNotified = false;
+                    scheduleReconnect();
+                }
+                else if (link == &standby)
+                {
+                    switchWhenStandbyConnected = false;
+                    timeouts.Cancel(standby.logInTimeout);
+                    standby = ServerLink();
+                    scheduleStandby(STANDBY_RETRY_SECONDS);
+                }
+                else
+                {
+                    closeLink(*link);
+                }
+            };
+
+            // This starts a session, logging in unless the agent is already
+            // connected.
+            const auto logIn = [&](const std::string& nickname, const std::string& token)
+            {
+                sessionActive = true;
+                sessionNickname = nickname;
+                sessionToken = token;
 
+                // Twitch identifies the agent by its nickname in lower case.
+                std::string login(nickname);
+                for (auto& c: login)
+                {
+                    c = (char)tolower((unsigned char)c);
+                }
+                nicknameSymbol = symbolCache.Intern(login);
+                if (primary.connection != nullptr)
+                {
+                    return;
+                }
+                reconnectAttempts = 0;
+                timeouts.Cancel(reconnectTimer);
+                reconnectTimer = 0;
+                openPrimary();
+            };
+
+            // This ends the session, closing every connection.
+            const auto logOut = [&](const std::string& farewell)
+            {
+                sessionActive = false;
+                sessionChannels.clear();
+                timeouts.Cancel(reconnectTimer);
+                reconnectTimer = 0;
+                timeouts.Cancel(standbyTimer);
+                standbyTimer = 0;
+                timeouts.Cancel(drainTimeout);
+                drainTimeout = 0;
+                closeLink(standby);
+                closeLink(draining);
+                closeConnection(farewell);
+            };
+
+            // This asks to join a channel, and remembers it as part of the
+            // session, so that it's joined again after reconnecting.
+            const auto join = [&](const std::string& channel)
+            {
+                sessionChannels.insert(symbolCache.Intern(channel));
+                if (primary.connection != nullptr)
+                {
+                    outbound.Enqueue(
+                        OutboundLane::Chat,
+                        RateLimitClass::Join,
+                        "JOIN #" + channel + CRLF,
+                        GetCurrentTime()
+                    );
+                }
+            };
 
-            // This holds onto any conditions that the worker is awaiting, which
-            // might time out.
-            std::priority_queue< TimeoutCondition > timeoutConditions;
-            
-            std::unique_lock< decltype(mutex) > lock(mutex);
-            while(!stopWorker)
+            // This handles a message received on a connection other than
+            // the one in use: noting when a standby connection has logged
+            // in, and delivering the messages of channels not yet joined
+            // again on the connection in use.
+            const auto handleOtherLinkMessage = [&](ServerLink& link)
             {
-                lock.unlock();
-                if (!timeoutConditions.empty())
-                {
-                    // Priority queue is being used here because, if we have
-                    // multiple things being used here, they'll be sorted based
-                    // on their timeout expirations, therefore whatever is at
-                    // the top of the priority queue realistically should be the
-                    // next thing that should expire regardless of the order we
-                    // pushed it onto the queue.
-                    const auto timeoutCondition = timeoutConditions.top();
-                    if(timeKeeper->GetCurrentTime() >= timeoutCondition.expiration)
+                if (&link == &standby)
+                {
+                    if (
+                        (message.knownCommand == KnownCommand::EndOfMotd)
+                        && !link.loggedIn
+                    )
                     {
-                        switch (timeoutCondition.type)
-                        {
-                            case ActionType::LogIn:
-                            {
-                                Disconnect(*connection, "Timeout waiting for MOTD");
-                            } 
-
-                            default:
-                            {
-
-                            } break;
-                        } 
-                        timeoutConditions.pop();
+                        link.loggedIn = true;
+                        timeouts.Cancel(link.logInTimeout);
+                        link.logInTimeout = 0;
+                        schedulePing(link, pingInterval);
                     }
                 }
-                lock.lock();
-                while(!actions.empty())
+                else if (
+                    (message.channelSymbol != SymbolTable::NO_SYMBOL)
+                    && (rejoinedChannels.count(message.channelSymbol) == 0)
+                )
+                {
+                    DeliverMessage(message);
+#ifdef TWITCH_BOT_COROUTINES
+                    CompleteOperations(message);
+#endif /* TWITCH_BOT_COROUTINES */
+                }
+            };
+            
+            std::unique_lock< decltype(mutex) > lock(mutex, std::defer_lock);
+            while(!stopWorker)
+            {
+                if (lock.owns_lock())
                 {
-                    const auto nextAction = actions.front();
-                    actions.pop_front();
                     lock.unlock();
+                }
+                if (!timeouts.Empty())
+                {
+                    timeouts.Advance(SecondsToTicks(GetCurrentTime()));
+                }
+                Action nextAction;
+                size_t actionsPerformed = 0;
+                while(
+                    (actionsPerformed < ACTION_BATCH_SIZE)
+                    && NextAction(nextAction)
+                )
+                {
+                    ++actionsPerformed;
+                    queueWaitHistogram.Record((uint64_t)(GetSteadyTime() - nextAction.posted));
                     switch (nextAction.type)
                     {
                         case ActionType::LogIn:
                         {
-                            if(connection != nullptr)
+                            logIn(nextAction.details->nickname, nextAction.details->token);
+                        } break;
+
+                        case ActionType::LogOut: 
+                        {
+                            logOut(nextAction.message);
+
+                        } break;
+
+                        case ActionType::ProcessMessageRecieved:
+                        {
+                            const auto link = findLink(nextAction.connectionId);
+                            if (link == nullptr)
                             {
+                                RecycleBuffer(nextAction.message);
                                 break;
                             }
-
-                            connection = connectionFactory();
-                            connection->SetMessageReceivedDelegate
-                            (
-                                std::bind(&Impl::MessageReceived, this, std::placeholders::_1)
-                            );
-
-                            connection->SetDisconnectedDelegate
-                            (
-                                std::bind(&Impl::ServerDisconnected, this)
-                            );
-                            if(connection->Connect())
+                            link->dataReceived.Append(nextAction.message);
+                            AddToCounter(chunksReceived, 1);
+                            AddToCounter(bytesReceived, nextAction.message.length());
+                            std::string_view line;
+                            uint64_t messagesParsed = 0;
+                            uint64_t linesInvalid = 0;
+                            bool reconnectRequested = false;
+                            while(link->dataReceived.NextLine(line))
                             {
-                                connection->Send("Pass oauth:", nextAction.token + CRLF);
-                                connection->Send("NICK", nextAction.nickname + CRLF);
-
-                                if(timeKeeper != nullptr)
+                                const auto timed = (++linesSinceSample == STAGE_SAMPLE_INTERVAL);
+                                int64_t parseStart = 0;
+                                if (timed)
+                                {
+                                    linesSinceSample = 0;
+                                    parseStart = GetSteadyTime();
+                                }
+                                ParseMessage(line, message);
+                                int64_t parseEnd = 0;
+                                if (timed)
+                                {
+                                    parseEnd = GetSteadyTime();
+                                    parseHistogram.Record((uint64_t)(parseEnd - parseStart));
+                                }
+                                if (message.command.empty())
+                                {
+                                    if (!line.empty())
+                                    {
+                                        ++linesInvalid;
+                                    }
+                                    continue;
+                                }
+                                ++messagesParsed;
+                                if (link != &primary)
+                                {
+                                    handleOtherLinkMessage(*link);
+                                    continue;
+                                }
+                                if (
+                                    (message.knownCommand == KnownCommand::UserState)
+                                    && (message.channelSymbol != SymbolTable::NO_SYMBOL)
+                                )
+                                {
+                                    // Twitch tells us our own badges in each
+                                    // channel we join or speak in.
+                                    const auto channel = message.channelSymbol;
+                                    if (
+                                        PermissionController::Allows(
+                                            PermissionController::DecodeRoles(message.tags),
+                                            PermissionController::MODERATION_ROLES
+                                        )
+                                    )
+                                    {
+                                        moderatedChannels.insert(channel);
+                                    }
+                                    else
+                                    {
+                                        moderatedChannels.erase(channel);
+                                    }
+                                }
+                                else if (message.knownCommand == KnownCommand::EndOfMotd)
+                                {
+                                    if(!primary.loggedIn)
+                                    {
+                                        timeouts.Cancel(primary.logInTimeout);
+                                        primary.logInTimeout = 0;
+                                        primaryLoggedIn();
+                                    }
+                                }
+                                else if (message.knownCommand == KnownCommand::Reconnect)
                                 {
-                                    TimeoutCondition timeoutCondition;
-                                    timeoutCondition.type = ActionType::LogIn;
-                                    timeoutCondition.expiration = timeKeeper->GetCurrentTime() + LOG_IN_TIMEOUT_SECONDS;
-                                    timeoutConditions.push(timeoutCondition);
+                                    reconnectRequested = true;
                                 }
-                                if(loggedInDelegate != nullptr)
+                                else if (
+                                    (message.knownCommand == KnownCommand::Join)
+                                    && (message.userSymbol == nicknameSymbol)
+                                    && (draining.connection != nullptr)
+                                )
                                 {
-                                    loggedInDelegate();
+                                    // Once every channel is joined again,
+                                    // the old connection has nothing more
+                                    // to give.
+                                    rejoinedChannels.insert(message.channelSymbol);
+                                    size_t rejoined = 0;
+                                    for (const auto channel: sessionChannels)
+                                    {
+                                        rejoined += rejoinedChannels.count(channel);
+                                    }
+                                    if (rejoined == sessionChannels.size())
+                                    {
+                                        closeLink(draining);
+                                        timeouts.Cancel(drainTimeout);
+                                        drainTimeout = 0;
+                                    }
                                 }
+                                DeliverMessage(message);
+                                if (timed)
+                                {
+                                    dispatchHistogram.Record((uint64_t)(GetSteadyTime() - parseEnd));
+                                }
+#ifdef TWITCH_BOT_COROUTINES
+                                CompleteOperations(message);
+#endif /* TWITCH_BOT_COROUTINES */
+                            }
+                            AddToCounter(messagesReceived, messagesParsed);
+                            AddToCounter(parseFailures, linesInvalid);
+                            RecycleBuffer(nextAction.message);
+                            if (reconnectRequested)
+                            {
+                                serverAskedToReconnect();
+                            }
+                        } break;
+
+                        case ActionType::ServerDisconnected:
+                        {
+                            loseLink(nextAction.connectionId, "");
+                        } break;
+
+                        case ActionType::LinkConnected:
+                        {
+                            linkConnected(nextAction);
+                        } break;
+
+                        case ActionType::Join:
+                        {
+                            if (!nextAction.channel.empty())
+                            {
+                                join(nextAction.channel);
                             }
-                            else
+                            if (nextAction.details != nullptr)
                             {
-                                if(loggedOutDelegate != nullptr)
+                                for (const auto& channel: nextAction.details->channels)
                                 {
-                                    loggedOutDelegate();
+                                    join(channel);
                                 }
                             }
-                            
-                            
                         } break;
 
-                        case ActionType::LogOut: 
+                        case ActionType::Leave:
+                        {
+                            const auto channel = symbolTable->Find(nextAction.channel);
+                            sessionChannels.erase(channel);
+                            rejoinedChannels.erase(channel);
+                            moderatedChannels.erase(channel);
+
+                            // The channel's strand is kept, since it may
+                            // still have messages to hand over.
+                            outbound.Enqueue(
+                                OutboundLane::Chat,
+                                RateLimitClass::None,
+                                "PART #" + nextAction.channel + CRLF,
+                                GetCurrentTime()
+                            );
+                        } break;
+
+                        case ActionType::SendMessage:
+                        case ActionType::SendModeration:
+                        {
+                            outbound.Enqueue(
+                                (
+                                    (nextAction.type == ActionType::SendModeration)
+                                    ? OutboundLane::Moderation
+                                    : OutboundLane::Chat
+                                ),
+                                (
+                                    (moderatedChannels.count(symbolCache.Intern(nextAction.channel)) != 0)
+                                    ? RateLimitClass::ModeratorMessage
+                                    : RateLimitClass::Message
+                                ),
+                                "PRIVMSG #" + nextAction.channel + " :" + nextAction.message + CRLF,
+                                GetCurrentTime()
+                            );
+                        } break;
+
+                        case ActionType::SetStatsFile:
                         {
-                            if(connection != nullptr)
+                            timeouts.Cancel(statsTimer);
+                            statsTimer = 0;
+                            statsPath = nextAction.message;
+                            statsInterval = nextAction.details->interval;
+                            if (
+                                !statsPath.empty()
+                                && (statsInterval > 0.0)
+                            )
                             {
-                                Disconnect(*connection, nextAction.message);
+                                const auto now = GetCurrentTime();
+                                statsTimer = timeouts.Schedule(
+                                    SecondsToTicks(now + statsInterval),
+                                    writeStats
+                                );
                             }
-                            
                         } break;
-
-                        case ActionType::ProcessMessageRecieved:
+#ifdef TWITCH_BOT_COROUTINES
+                        case ActionType::Await:
                         {
-                            dataReceived += nextAction.message;
-                            Message message;
-                            while(GetNextMessage(dataReceived, message))
+                            const auto operation = nextAction.operation;
+                            switch (operation->kind_)
                             {
-                                if (message.command.empty())
+                                case Operation::Kind::LogIn:
                                 {
-                                    continue;
-                                }
-                                if (message.command == "376") // RPL_ENDOFMOTD (RFC_1459)
+                                    logIn(operation->first_, operation->second_);
+                                    if (primary.loggedIn)
+                                    {
+                                        CompleteOperation(operation, true, false);
+                                    }
+                                    else if (primary.connection == nullptr)
+                                    {
+                                        CompleteOperation(operation, false, false);
+                                    }
+                                    else
+                                    {
+                                        WaitForOperation(operation, logInOperations);
+                                    }
+                                } break;
+
+                                case Operation::Kind::LogOut:
                                 {
-                                    if(!loggedIn)
+                                    logOut(operation->first_);
+                                    CompleteOperation(operation, true, false);
+                                } break;
+
+                                case Operation::Kind::Join:
+                                {
+                                    if (
+                                        (primary.connection == nullptr)
+                                        || operation->first_.empty()
+                                    )
                                     {
-                                        loggedIn = true;
-                                        if (loggedInDelegate != nullptr)
-                                        {
-                                            loggedInDelegate();
-                                        }
+                                        CompleteOperation(operation, false, false);
+                                        break;
                                     }
-                                }
+                                    operation->channelSymbol_ = symbolCache.Intern(operation->first_);
+                                    sessionChannels.insert(operation->channelSymbol_);
+                                    outbound.Enqueue(
+                                        OutboundLane::Chat,
+                                        RateLimitClass::Join,
+                                        "JOIN #" + operation->first_ + CRLF,
+                                        GetCurrentTime()
+                                    );
+                                    WaitForOperation(operation, joinOperations);
+                                } break;
+
+                                case Operation::Kind::NextMessage:
+                                {
+                                    const auto messageOperation = (MessageOperation*)operation;
+                                    messageOperation->channelSymbol_ = symbolCache.Intern(messageOperation->filter_.channel);
+                                    messageOperation->userSymbol_ = symbolCache.Intern(messageOperation->filter_.user);
+                                    ++messageOperationCount;
+                                    WaitForOperation(operation, GetWaitingList(operation));
+                                } break;
                             }
                         } break;
+#endif /* TWITCH_BOT_COROUTINES */
 
-                        case ActionType::ServerDisconnected:
-                        {
-                            Disconnect(*connection);
-                        } break;
                         // Potentially place diagnostic actions inside this
                         // function for the future.
                         //
                         // Example: "You gave me an action that I do not
                         // understand etc."
-                        defafult: 
+                        default: 
                         {
                             
                         } break;
                     }
-                    lock.lock();
                 }
 
-                if (!timeoutConditions.empty())
+                // Send whatever the rate limits allow, and if anything is
+                // held back, make sure the worker wakes up when it may go.
+                // Nothing goes until the connection is made.
+                double nextSendTime;
+                if (
+                    (primary.connection != nullptr)
+                    && !primary.connecting
+                )
+                {
+                    FlushOutbound(*primary.connection);
+                    if (outbound.GetNextSendTime(nextSendTime))
+                    {
+                        const auto deadline = SecondsToTicks(nextSendTime);
+                        if ((outboundTimeout == 0) || (deadline != outboundDeadline))
+                        {
+                            timeouts.Cancel(outboundTimeout);
+                            outboundDeadline = deadline;
+                            outboundTimeout = timeouts.Schedule(
+                                deadline,
+                                [&]
+                                {
+                                    outboundTimeout = 0;
+                                }
+                            );
+                        }
+                    }
+                }
+
+                // If the batch was cut short, there may be more actions
+                // waiting, so don't wait for a signal.
+                if (actionsPerformed == ACTION_BATCH_SIZE)
+                {
+                    continue;
+                }
+
+                lock.lock();
+                workerWaiting = true;
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (
+                    !actions.Empty()
+                    || !workerActions.empty()
+                    || pendingActionsWaiting
+                    || stopWorker
+                )
+                {
+                    workerWaiting = false;
+                    continue;
+                }
+                uint64_t nextDeadline;
+                if (timeouts.GetNextDeadline(nextDeadline))
                 {
+                    // Sleep exactly until the next timeout is due (rounded
+                    // up to a whole tick), rather than polling.
+                    const auto now = GetCurrentTime();
+                    const auto delay = (double)nextDeadline / TIMER_TICKS_PER_SECOND - now;
                     wakeWorker.wait_for
                     (
                         lock,
-                        std::chrono::milliseconds(50),
+                        std::chrono::duration< double >(delay > 0.0 ? delay : 0.0),
                         [this]
                         {
                             return
                             (
                                 stopWorker 
                                 ||
-                                !actions.empty()
+                                !workerWaiting
                             );
                         }
                     );
@@ -611,24 +2739,79 @@ namespace TwitchBot
                             (
                                 stopWorker 
                                 ||
-                                !actions.empty()
+                                !workerWaiting
                             );
                         }
                     );
                 }
+                workerWaiting = false;
+            }
+            if (lock.owns_lock())
+            {
+                lock.unlock();
+            }
+
+            // Connections still being made are given up on once they're
+            // done, when their LinkConnected actions are dropped below.
+            for (auto& connector: connectors)
+            {
+                connector.second.join();
+            }
+            connectors.clear();
+#ifdef TWITCH_BOT_COROUTINES
+            // Whatever is still waiting, or waiting to start, won't happen
+            // now. Coroutines resumed here may await more operations, which
+            // fail in turn.
+            FailAllOperations();
+            {
+                std::lock_guard< decltype(operationsMutex) > lock(operationsMutex);
+                operationsClosed = true;
+            }
+#endif /* TWITCH_BOT_COROUTINES */
+            Action leftoverAction;
+            while (NextAction(leftoverAction))
+            {
+#ifdef TWITCH_BOT_COROUTINES
+                if (leftoverAction.type == ActionType::Await)
+                {
+                    CompleteOperation(leftoverAction.operation, false, false);
+                }
+#endif /* TWITCH_BOT_COROUTINES */
+                // A stats file set just before the manager is destroyed
+                // still gets its final write.
+                if (leftoverAction.type == ActionType::SetStatsFile)
+                {
+                    statsPath = leftoverAction.message;
+                }
+                leftoverAction.details = nullptr;
+            }
+            if (!statsPath.empty())
+            {
+                WriteStatsFile(statsPath);
             }
         }
     };
     
     MessageManager::~MessageManager()
     {
+        if (impl_->timeKeeper != nullptr)
+        {
+            impl_->timeKeeper->RemoveTimeChangedDelegate(impl_->timeChangedToken);
+        }
         impl_->StopWorker();
         impl_->worker.join();
+        std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+        impl_->callsDone.wait(
+            lock,
+            [this]{ return (impl_->callsPending == 0); }
+        );
     }
 
     MessageManager::MessageManager()
         : impl_ (new Impl())
     {
+        impl_->spareBuffers.reserve(ACTION_QUEUE_CAPACITY);
+        impl_->spareParameters.reserve(MAX_MESSAGE_PARAMETERS);
         impl_->worker = std::thread(&Impl::Worker, impl_.get());
     }
 
@@ -639,7 +2822,72 @@ namespace TwitchBot
 
     void MessageManager::SetTimeKeeper(std::shared_ptr< TimeKeeper > timeKeeper)
     {
+        if (impl_->timeKeeper != nullptr)
+        {
+            impl_->timeKeeper->RemoveTimeChangedDelegate(impl_->timeChangedToken);
+            impl_->timeChangedToken = 0;
+        }
         impl_ ->timeKeeper = timeKeeper;
+
+        // The worker sleeps until its next timeout is due, so if the time
+        // is moved other than by the passing of real time, it needs to wake
+        // up and look again.
+        if (timeKeeper != nullptr)
+        {
+            const auto impl = impl_.get();
+            impl_->timeChangedToken = timeKeeper->AddTimeChangedDelegate(
+                [impl]{ impl->WakeWorker(); }
+            );
+        }
+    }
+
+    void MessageManager::SetExecutor(std::shared_ptr< Executor > executor)
+    {
+        impl_->executor = executor;
+    }
+
+    void MessageManager::SetSymbolTable(std::shared_ptr< SymbolTable > symbolTable)
+    {
+        impl_->symbolTable = symbolTable;
+        impl_->symbolCache = SymbolTable::Cache(symbolTable);
+        impl_->lastChannel.clear();
+        impl_->lastChannelSymbol = SymbolTable::NO_SYMBOL;
+    }
+
+    std::shared_ptr< SymbolTable > MessageManager::GetSymbolTable() const
+    {
+        return impl_->symbolTable;
+    }
+
+    void MessageManager::SetChatLog(std::shared_ptr< ChatLog > chatLog)
+    {
+        impl_->chatLog = chatLog;
+    }
+
+    void MessageManager::SetChatIndex(std::shared_ptr< ChatIndex > chatIndex)
+    {
+        impl_->chatIndex = chatIndex;
+    }
+
+    void MessageManager::SetChatAnalytics(std::shared_ptr< ChatAnalytics > chatAnalytics)
+    {
+        impl_->chatAnalytics = chatAnalytics;
+    }
+
+    void MessageManager::SetAutoReconnect(bool autoReconnect)
+    {
+        impl_->autoReconnect = autoReconnect;
+    }
+
+    void MessageManager::SetWarmStandby(bool warmStandby)
+    {
+        impl_->warmStandby = warmStandby;
+    }
+
+    void MessageManager::SetKeepAlive(double pingInterval, double pongTimeout)
+    {
+        impl_->pingInterval = pingInterval;
+        impl_->pongTimeout = pongTimeout;
     }
 
     void MessageManager::SetLoggedInDelegate(LoggedInDelegate loggedInDelegate)
@@ -652,25 +2900,217 @@ namespace TwitchBot
         impl_ ->loggedOutDelegate = loggedOutDelegate;
     }
 
+    void MessageManager::SetMessageReceivedDelegate(MessageReceivedDelegate messageReceivedDelegate)
+    {
+        impl_ ->messageReceivedDelegate = messageReceivedDelegate;
+    }
+
     void MessageManager::LogIn(const std::string& nickname, const std::string& token)
     {
-        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
         Action action;
         action.type = ActionType::LogIn;
-        action.nickname = nickname;
-        action.token = token;
-        impl_->actions.push_back(action);
-        impl_->wakeWorker.notify_one();
-
+        action.details = std::make_unique< ActionDetails >();
+        action.details->nickname = nickname;
+        action.details->token = token;
+        impl_->PostAction(action);
     }
 
     void MessageManager::LogOut(const std::string& farewell)
     {
-        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
         Action action;
         action.type = ActionType::LogOut;
         action.message = farewell;
-        impl_->actions.push_back(action);
-        impl_->wakeWorker.notify_one();
+        impl_->PostAction(action);
+    }
+
+    void MessageManager::Join(const std::string& channel)
+    {
+        Action action;
+        action.type = ActionType::Join;
+        action.channel = FoldCase(channel);
+        impl_->PostAction(action);
+    }
+
+    void MessageManager::Join(const std::vector< std::string >& channels)
+    {
+        Action action;
+        action.type = ActionType::Join;
+        action.details = std::make_unique< ActionDetails >();
+        action.details->channels.reserve(channels.size());
+        for (const auto& channel: channels)
+        {
+            action.details->channels.push_back(FoldCase(channel));
+        }
+        impl_->PostAction(action);
+    }
+
+    void MessageManager::Leave(const std::string& channel)
+    {
+        Action action;
+        action.type = ActionType::Leave;
+        action.channel = FoldCase(channel);
+        impl_->PostAction(action);
+    }
+
+    void MessageManager::SendMessage(const std::string& channel, const std::string& text)
+    {
+        Action action;
+        action.type = ActionType::SendMessage;
+        action.channel = FoldCase(channel);
+        action.message = text;
+        impl_->PostAction(action);
+    }
+
+    void MessageManager::SendModeration(const std::string& channel, const std::string& command)
+    {
+        Action action;
+        action.type = ActionType::SendModeration;
+        action.channel = FoldCase(channel);
+        action.message = command;
+        impl_->PostAction(action);
+    }
+
+#ifdef TWITCH_BOT_COROUTINES
+    MessageManager::Operation::~Operation() noexcept = default;
+
+    MessageManager::Operation::Operation(
+        MessageManager* manager,
+        Kind kind,
+        double timeout,
+        std::string first,
+        std::string second
+    )
+        : manager_(manager)
+        , kind_(kind)
+        , timeout_(timeout)
+        , first_(std::move(first))
+        , second_(std::move(second))
+    {
+    }
+
+    bool MessageManager::Operation::await_ready() const noexcept
+    {
+        return false;
+    }
+
+    bool MessageManager::Operation::await_suspend(std::coroutine_handle<> handle)
+    {
+        handle_ = handle;
+        succeeded_ = false;
+        const auto impl = manager_->impl_.get();
+        Action action;
+        action.type = ActionType::Await;
+        action.operation = this;
+
+        // Once posted, the worker may resume the coroutine, which may
+        // destroy this operation, so it must not be touched again. If it
+        // isn't posted, because the worker has stopped, or is stopping and
+        // has no room for it, the operation fails without suspending.
+        std::lock_guard< decltype(impl->operationsMutex) > lock(impl->operationsMutex);
+        return (
+            !impl->operationsClosed
+            && impl->PostAction(action)
+        );
+    }
+
+    bool MessageManager::Operation::await_resume() const noexcept
+    {
+        return succeeded_;
+    }
+
+    MessageManager::MessageOperation::MessageOperation(
+        MessageManager* manager,
+        MessageFilter filter,
+        double timeout
+    )
+        : Operation(manager, Kind::NextMessage, timeout)
+        , filter_(std::move(filter))
+    {
+        filter_.channel = FoldCase(filter_.channel);
+        filter_.user = FoldCase(filter_.user);
+    }
+
+    std::optional< Message > MessageManager::MessageOperation::await_resume()
+    {
+        if (!Operation::await_resume())
+        {
+            return std::nullopt;
+        }
+        return std::move(message_);
+    }
+
+    auto MessageManager::LogInAsync(
+        const std::string& nickname,
+        const std::string& token,
+        double timeout
+    ) -> Operation
+    {
+        return Operation(this, Operation::Kind::LogIn, timeout, nickname, token);
+    }
+
+    auto MessageManager::LogOutAsync(const std::string& farewell) -> Operation
+    {
+        return Operation(this, Operation::Kind::LogOut, 0.0, farewell);
+    }
+
+    auto MessageManager::JoinAsync(
+        const std::string& channel,
+        double timeout
+    ) -> Operation
+    {
+        return Operation(this, Operation::Kind::Join, timeout, FoldCase(channel));
+    }
+
+    auto MessageManager::NextMessage(
+        MessageFilter filter,
+        double timeout
+    ) -> MessageOperation
+    {
+        return MessageOperation(this, std::move(filter), timeout);
+    }
+#endif /* TWITCH_BOT_COROUTINES */
+
+    OutboundScheduler::Stats MessageManager::GetOutboundStats()
+    {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        return impl_->outboundStats;
+    }
+
+    auto MessageManager::GetStats() -> Stats
+    {
+        Stats stats;
+        stats.chunks = impl_->chunksReceived.load(std::memory_order_relaxed);
+        stats.bytes = impl_->bytesReceived.load(std::memory_order_relaxed);
+        stats.messages = impl_->messagesReceived.load(std::memory_order_relaxed);
+        stats.parseFailures = impl_->parseFailures.load(std::memory_order_relaxed);
+        stats.linesDropped = impl_->linesDropped.load(std::memory_order_relaxed);
+        stats.chunksDropped = impl_->chunksDropped.load(std::memory_order_relaxed);
+        stats.reconnects = impl_->reconnects.load(std::memory_order_relaxed);
+        stats.pingsAnswered = impl_->pingsAnswered.load(std::memory_order_relaxed);
+        stats.keepAliveTimeouts = impl_->keepAliveTimeouts.load(std::memory_order_relaxed);
+        stats.queueWait = impl_->queueWaitHistogram.GetSummary();
+        stats.parse = impl_->parseHistogram.GetSummary();
+        stats.dispatch = impl_->dispatchHistogram.GetSummary();
+        stats.outboundWait = impl_->outbound.GetWaitHistogram().GetSummary();
+        stats.serverRoundTrip = impl_->serverRoundTripHistogram.GetSummary();
+        return stats;
+    }
+
+    std::string MessageManager::GetStatsText()
+    {
+        return impl_->FormatStats();
+    }
+
+    void MessageManager::SetStatsFile(
+        const std::string& path,
+        double intervalSeconds
+    )
+    {
+        Action action;
+        action.type = ActionType::SetStatsFile;
+        action.message = path;
+        action.details = std::make_unique< ActionDetails >();
+        action.details->interval = intervalSeconds;
+        impl_->PostAction(action);
     }
 }
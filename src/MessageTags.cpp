@@ -0,0 +1,420 @@
+#include <string.h>
+#include <algorithm>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageTags.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageTokenizer.hpp>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    /**
+     * These are the keys of the known tags, in the same order as the
+     * TwitchBot::KnownTag enumeration.
+     */
+    const std::string_view KNOWN_TAG_KEYS[] = {
+        "badge-info",
+        "badges",
+        "ban-duration",
+        "bits",
+        "color",
+        "display-name",
+        "emote-only",
+        "emotes",
+        "first-msg",
+        "followers-only",
+        "id",
+        "login",
+        "mod",
+        "msg-id",
+        "room-id",
+        "slow",
+        "subs-only",
+        "subscriber",
+        "target-msg-id",
+        "target-user-id",
+        "tmi-sent-ts",
+        "turbo",
+        "user-id",
+        "user-type",
+        "vip",
+    };
+    static_assert(
+        sizeof(KNOWN_TAG_KEYS) / sizeof(KNOWN_TAG_KEYS[0]) == (size_t)TwitchBot::KnownTag::Count,
+        "KNOWN_TAG_KEYS must list every known tag"
+    );
+
+    /**
+     * This is the number of slots in the table of known tags. It must be a
+     * power of two, comfortably larger than the number of known tags.
+     */
+    constexpr size_t KNOWN_TAG_TABLE_SIZE = 64;
+
+    /**
+     * This computes where in the table of known tags to start looking for
+     * the given key. It was chosen so that the known keys don't collide.
+     */
+    size_t HashTagKey(std::string_view key)
+    {
+        return (
+            key.length() * 3
+            + (unsigned char)key.front()
+            + (unsigned char)key.back() * 44
+        ) & (KNOWN_TAG_TABLE_SIZE - 1);
+    }
+
+    /**
+     * This is an open-addressed hash table of the known tags, so that most
+     * keys are matched or rejected with a single comparison.
+     */
+    struct KnownTagTable
+    {
+        /**
+         * Each slot holds one more than the position in KNOWN_TAG_KEYS of a
+         * known tag, or 0 if the slot is empty.
+         */
+        uint8_t slots[KNOWN_TAG_TABLE_SIZE] = {};
+
+        KnownTagTable()
+        {
+            for (size_t i = 0; i < (size_t)TwitchBot::KnownTag::Count; ++i)
+            {
+                auto slot = HashTagKey(KNOWN_TAG_KEYS[i]);
+                while (slots[slot] != 0)
+                {
+                    slot = (slot + 1) & (KNOWN_TAG_TABLE_SIZE - 1);
+                }
+                slots[slot] = (uint8_t)(i + 1);
+            }
+        }
+    };
+
+    /**
+     * This is the table of known tags.
+     */
+    const KnownTagTable knownTagTable;
+
+    /**
+     * This returns which known tag has the given key, or Count if it isn't
+     * a known tag.
+     */
+    TwitchBot::KnownTag FindKnownTag(std::string_view key)
+    {
+        auto slot = HashTagKey(key);
+        while (knownTagTable.slots[slot] != 0)
+        {
+            const auto i = (size_t)knownTagTable.slots[slot] - 1;
+            if (KNOWN_TAG_KEYS[i] == key)
+            {
+                return (TwitchBot::KnownTag)i;
+            }
+            slot = (slot + 1) & (KNOWN_TAG_TABLE_SIZE - 1);
+        }
+        return TwitchBot::KnownTag::Count;
+    }
+
+    /**
+     * This returns a mask with a bit set for each semicolon (;) or equals
+     * sign (=) among the given characters, of which there are at most 64.
+     */
+    uint64_t FindSeparators(const char* characters, size_t length)
+    {
+        uint64_t separators = 0;
+        size_t offset = 0;
+#ifdef __SSE2__
+        const auto semicolon = _mm_set1_epi8(';');
+        const auto equals = _mm_set1_epi8('=');
+        for (; offset + 16 <= length; offset += 16)
+        {
+            const auto block = _mm_loadu_si128((const __m128i*)(characters + offset));
+            const auto matches = _mm_or_si128(
+                _mm_cmpeq_epi8(block, semicolon),
+                _mm_cmpeq_epi8(block, equals)
+            );
+            separators |= (uint64_t)(unsigned int)_mm_movemask_epi8(matches) << offset;
+        }
+#endif /* __SSE2__ */
+        for (; offset < length; ++offset)
+        {
+            if ((characters[offset] == ';') || (characters[offset] == '='))
+            {
+                separators |= (uint64_t)1 << offset;
+            }
+        }
+        return separators;
+    }
+
+    /**
+     * This parses a whole number, which may be negative. Numbers which
+     * don't fit in 64 bits are rejected rather than wrapped around.
+     */
+    bool ParseInteger(std::string_view text, int64_t& value)
+    {
+        if (text.empty())
+        {
+            return false;
+        }
+        size_t offset = 0;
+        bool negative = false;
+        if (text[0] == '-')
+        {
+            negative = true;
+            ++offset;
+            if (text.length() == 1)
+            {
+                return false;
+            }
+        }
+        const auto limit = (uint64_t)INT64_MAX + (negative ? 1 : 0);
+        uint64_t magnitude = 0;
+        for (; offset < text.length(); ++offset)
+        {
+            const auto digit = (unsigned int)(text[offset] - '0');
+            if (
+                (digit > 9)
+                || (magnitude > (limit - digit) / 10)
+            )
+            {
+                return false;
+            }
+            magnitude = magnitude * 10 + digit;
+        }
+        value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+        return true;
+    }
+}
+
+namespace TwitchBot
+{
+    void MessageTags::Assign(std::string_view raw)
+    {
+        raw_.assign(raw);
+        indexed_ = raw_.empty();
+        if (indexed_)
+        {
+            entries_.clear();
+            memset(known_, 0, sizeof(known_));
+        }
+    }
+
+    void MessageTags::Clear()
+    {
+        Assign(std::string_view());
+    }
+
+    bool MessageTags::Empty() const
+    {
+        return raw_.empty();
+    }
+
+    std::string_view MessageTags::GetRaw() const
+    {
+        return raw_;
+    }
+
+    bool MessageTags::Has(std::string_view key) const
+    {
+        Index();
+        for (const auto& entry: entries_)
+        {
+            if (std::string_view(raw_.data() + entry.keyOffset, entry.keyLength) == key)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool MessageTags::Has(KnownTag tag) const
+    {
+        Index();
+        return (known_[(size_t)tag] != 0);
+    }
+
+    std::string_view MessageTags::GetRawValue(std::string_view key) const
+    {
+        Index();
+
+        // If a key is repeated, the last one wins.
+        for (auto entry = entries_.rbegin(); entry != entries_.rend(); ++entry)
+        {
+            if (std::string_view(raw_.data() + entry->keyOffset, entry->keyLength) == key)
+            {
+                return GetEntryValue(*entry);
+            }
+        }
+        return std::string_view();
+    }
+
+    std::string_view MessageTags::GetRawValue(KnownTag tag) const
+    {
+        Index();
+        const auto position = known_[(size_t)tag];
+        if (position == 0)
+        {
+            return std::string_view();
+        }
+        return GetEntryValue(entries_[position - 1]);
+    }
+
+    std::string MessageTags::GetValue(std::string_view key) const
+    {
+        return Unescape(GetRawValue(key));
+    }
+
+    std::string MessageTags::GetValue(KnownTag tag) const
+    {
+        return Unescape(GetRawValue(tag));
+    }
+
+    bool MessageTags::GetInteger(KnownTag tag, int64_t& value) const
+    {
+        return ParseInteger(GetRawValue(tag), value);
+    }
+
+    uint64_t MessageTags::GetUserId() const
+    {
+        int64_t value = 0;
+        return GetInteger(KnownTag::UserId, value) ? (uint64_t)value : 0;
+    }
+
+    uint64_t MessageTags::GetRoomId() const
+    {
+        int64_t value = 0;
+        return GetInteger(KnownTag::RoomId, value) ? (uint64_t)value : 0;
+    }
+
+    int64_t MessageTags::GetSentTime() const
+    {
+        int64_t value = 0;
+        return GetInteger(KnownTag::TmiSentTs, value) ? value : 0;
+    }
+
+    std::string_view MessageTags::GetMessageId() const
+    {
+        return GetRawValue(KnownTag::Id);
+    }
+
+    std::string_view MessageTags::GetNoticeId() const
+    {
+        return GetRawValue(KnownTag::MsgId);
+    }
+
+    std::string_view MessageTags::GetBadges() const
+    {
+        return GetRawValue(KnownTag::Badges);
+    }
+
+    std::string_view MessageTags::GetEmotes() const
+    {
+        return GetRawValue(KnownTag::Emotes);
+    }
+
+    std::string MessageTags::GetDisplayName() const
+    {
+        return GetValue(KnownTag::DisplayName);
+    }
+
+    std::string MessageTags::Unescape(std::string_view value)
+    {
+        // Most values have nothing escaped.
+        const auto end = value.data() + value.length();
+        auto backslash = FindCharacter(value.data(), end, '\\');
+        if (backslash == end)
+        {
+            return std::string(value);
+        }
+
+        std::string unescaped;
+        unescaped.reserve(value.length());
+        auto offset = value.data();
+        while (backslash != end)
+        {
+            unescaped.append(offset, backslash - offset);
+            if (backslash + 1 == end)
+            {
+                // A trailing lone backslash is dropped.
+                offset = end;
+                break;
+            }
+            switch (backslash[1])
+            {
+                case ':': unescaped += ';'; break;
+                case 's': unescaped += ' '; break;
+                case 'r': unescaped += '\r'; break;
+                case 'n': unescaped += '\n'; break;
+                default: unescaped += backslash[1]; break;
+            }
+            offset = backslash + 2;
+            backslash = FindCharacter(offset, end, '\\');
+        }
+        unescaped.append(offset, end - offset);
+        return unescaped;
+    }
+
+    void MessageTags::Index() const
+    {
+        if (indexed_)
+        {
+            return;
+        }
+        indexed_ = true;
+        entries_.clear();
+        memset(known_, 0, sizeof(known_));
+        // Rather than looking at one character at a time, find every
+        // separator (; or =) in a block of characters at once, and then
+        // visit only the separators.
+        const auto begin = raw_.data();
+        const auto length = raw_.length();
+        size_t keyBegin = 0;
+        size_t keyEnd = 0;
+        bool haveEquals = false;
+        for (size_t block = 0; block < length; block += 64)
+        {
+            auto separators = FindSeparators(begin + block, std::min(length - block, (size_t)64));
+            while (separators != 0)
+            {
+                const auto offset = block + __builtin_ctzll(separators);
+                separators &= separators - 1;
+                if (begin[offset] == '=')
+                {
+                    if (!haveEquals)
+                    {
+                        haveEquals = true;
+                        keyEnd = offset;
+                    }
+                    continue;
+                }
+                AddEntry(keyBegin, haveEquals ? keyEnd : offset, offset, haveEquals);
+                keyBegin = offset + 1;
+                haveEquals = false;
+            }
+        }
+        AddEntry(keyBegin, haveEquals ? keyEnd : length, length, haveEquals);
+    }
+
+    void MessageTags::AddEntry(size_t keyBegin, size_t keyEnd, size_t valueEnd, bool haveValue) const
+    {
+        if (keyEnd <= keyBegin)
+        {
+            return;
+        }
+        Entry entry;
+        entry.keyOffset = (uint32_t)keyBegin;
+        entry.keyLength = (uint32_t)(keyEnd - keyBegin);
+        entry.valueOffset = (uint32_t)(haveValue ? keyEnd + 1 : keyEnd);
+        entry.valueLength = (uint32_t)(valueEnd - entry.valueOffset);
+        entries_.push_back(entry);
+        const auto tag = FindKnownTag(std::string_view(raw_.data() + keyBegin, entry.keyLength));
+        if (tag != KnownTag::Count)
+        {
+            known_[(size_t)tag] = (uint16_t)entries_.size();
+        }
+    }
+
+    std::string_view MessageTags::GetEntryValue(const Entry& entry) const
+    {
+        return std::string_view(raw_.data() + entry.valueOffset, entry.valueLength);
+    }
+}
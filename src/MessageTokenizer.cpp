@@ -0,0 +1,242 @@
+#include <atomic>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageTokenizer.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TWITCH_BOT_X86_SCAN 1
+#endif
+
+namespace
+{
+    /**
+     * This is the type of function used to find the first occurrence of a
+     * character.
+     */
+    typedef const char* (*FindFunction)(const char* begin, const char* end, char character);
+
+    /**
+     * This looks at one character at a time.
+     */
+    const char* FindScalar(const char* begin, const char* end, char character)
+    {
+        while ((begin < end) && (*begin != character))
+        {
+            ++begin;
+        }
+        return begin;
+    }
+
+#ifdef TWITCH_BOT_X86_SCAN
+    /**
+     * This looks at 16 characters at a time, and the remainder one at a time.
+     */
+    const char* FindSse2(const char* begin, const char* end, char character)
+    {
+        const auto pattern = _mm_set1_epi8(character);
+        while (end - begin >= 16)
+        {
+            const auto block = _mm_loadu_si128((const __m128i*)begin);
+            const auto mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(block, pattern));
+            if (mask != 0)
+            {
+                return begin + __builtin_ctz(mask);
+            }
+            begin += 16;
+        }
+        return FindScalar(begin, end, character);
+    }
+
+    /**
+     * This looks at 32 characters at a time, and the remainder using SSE2.
+     */
+    __attribute__((target("avx2")))
+    const char* FindAvx2(const char* begin, const char* end, char character)
+    {
+        const auto pattern = _mm256_set1_epi8(character);
+        while (end - begin >= 32)
+        {
+            const auto block = _mm256_loadu_si256((const __m256i*)begin);
+            const auto mask = (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, pattern));
+            if (mask != 0)
+            {
+                return begin + __builtin_ctz(mask);
+            }
+            begin += 32;
+        }
+        return FindSse2(begin, end, character);
+    }
+#endif /* TWITCH_BOT_X86_SCAN */
+
+    /**
+     * This returns the search function for the given implementation, or
+     * nullptr if the processor doesn't support it.
+     */
+    FindFunction GetFindFunction(TwitchBot::ScanImplementation implementation)
+    {
+        switch (implementation)
+        {
+            case TwitchBot::ScanImplementation::Scalar:
+            {
+                return FindScalar;
+            }
+
+#ifdef TWITCH_BOT_X86_SCAN
+            case TwitchBot::ScanImplementation::Sse2:
+            {
+                if (__builtin_cpu_supports("sse2"))
+                {
+                    return FindSse2;
+                }
+            } break;
+
+            case TwitchBot::ScanImplementation::Avx2:
+            {
+                if (__builtin_cpu_supports("avx2"))
+                {
+                    return FindAvx2;
+                }
+            } break;
+#endif /* TWITCH_BOT_X86_SCAN */
+
+            default:
+            {
+            } break;
+        }
+        return nullptr;
+    }
+
+    /**
+     * This picks the fastest implementation the processor supports.
+     */
+    TwitchBot::ScanImplementation DetectScanImplementation()
+    {
+        for (const auto implementation:
+            {
+                TwitchBot::ScanImplementation::Avx2,
+                TwitchBot::ScanImplementation::Sse2
+            }
+        )
+        {
+            if (GetFindFunction(implementation) != nullptr)
+            {
+                return implementation;
+            }
+        }
+        return TwitchBot::ScanImplementation::Scalar;
+    }
+
+    /**
+     * This is the implementation currently in use.
+     */
+    std::atomic< TwitchBot::ScanImplementation > selectedImplementation(DetectScanImplementation());
+
+    /**
+     * This is the search function currently in use.
+     */
+    std::atomic< FindFunction > selectedFind(GetFindFunction(selectedImplementation.load()));
+
+    /**
+     * This returns a pointer to the first character which is not a space.
+     */
+    const char* SkipSpaces(const char* begin, const char* end)
+    {
+        while ((begin < end) && (*begin == ' '))
+        {
+            ++begin;
+        }
+        return begin;
+    }
+}
+
+namespace TwitchBot
+{
+    bool TokenizeMessage(std::string_view line, MessageTokens& tokens)
+    {
+        const auto find = selectedFind.load(std::memory_order_relaxed);
+        auto offset = line.data();
+        const auto end = offset + line.length();
+        tokens.tags = std::string_view();
+        tokens.prefix = std::string_view();
+        tokens.command = std::string_view();
+        tokens.parameterCount = 0;
+
+        // Tags
+        if ((offset < end) && (*offset == '@'))
+        {
+            const auto tagsEnd = find(offset + 1, end, ' ');
+            if (tagsEnd == end)
+            {
+                return false;
+            }
+            tokens.tags = std::string_view(offset + 1, tagsEnd - offset - 1);
+            offset = SkipSpaces(tagsEnd, end);
+        }
+
+        // Prefix
+        if ((offset < end) && (*offset == ':'))
+        {
+            const auto prefixEnd = find(offset + 1, end, ' ');
+            if (prefixEnd == end)
+            {
+                return false;
+            }
+            tokens.prefix = std::string_view(offset + 1, prefixEnd - offset - 1);
+            offset = SkipSpaces(prefixEnd, end);
+        }
+
+        // Command
+        if (offset == end)
+        {
+            return false;
+        }
+        const auto commandEnd = find(offset, end, ' ');
+        tokens.command = std::string_view(offset, commandEnd - offset);
+        offset = commandEnd;
+
+        // Parameters
+        while (true)
+        {
+            offset = SkipSpaces(offset, end);
+            if (offset == end)
+            {
+                break;
+            }
+            if (*offset == ':')
+            {
+                tokens.parameters[tokens.parameterCount++] = std::string_view(offset + 1, end - offset - 1);
+                break;
+            }
+            if (tokens.parameterCount + 1 == MAX_MESSAGE_PARAMETERS)
+            {
+                tokens.parameters[tokens.parameterCount++] = std::string_view(offset, end - offset);
+                break;
+            }
+            const auto parameterEnd = find(offset, end, ' ');
+            tokens.parameters[tokens.parameterCount++] = std::string_view(offset, parameterEnd - offset);
+            offset = parameterEnd;
+        }
+        return true;
+    }
+
+    const char* FindCharacter(const char* begin, const char* end, char character)
+    {
+        return selectedFind.load(std::memory_order_relaxed)(begin, end, character);
+    }
+
+    bool SelectScanImplementation(ScanImplementation implementation)
+    {
+        const auto find = GetFindFunction(implementation);
+        if (find == nullptr)
+        {
+            return false;
+        }
+        selectedFind.store(find);
+        selectedImplementation.store(implementation);
+        return true;
+    }
+
+    ScanImplementation GetScanImplementation()
+    {
+        return selectedImplementation.load();
+    }
+}
@@ -0,0 +1,430 @@
+#include <deque>
+#include <utility>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/OutboundScheduler.hpp>
+
+namespace
+{
+    /**
+     * This is the most characters to put in one batch. Lines beyond this
+     * are left for the next batch, so one write never grows without bound.
+     */
+    constexpr size_t MAX_BATCH_LENGTH = 8192;
+
+    /**
+     * This hands out a fixed number of tokens, and takes each token back one
+     * window after it was used.
+     */
+    class TokenBucket
+    {
+        public:
+            /**
+             * This changes the number of tokens and the window.
+             */
+            void Configure(const TwitchBot::OutboundScheduler::Limit& limit)
+            {
+                limit_ = limit;
+                while (used_.size() > limit_.lines)
+                {
+                    used_.pop_front();
+                }
+            }
+
+            /**
+             * This returns when the next token will be available.
+             */
+            double GetAvailableTime(double now)
+            {
+                Refill(now);
+                if (used_.size() < limit_.lines)
+                {
+                    return now;
+                }
+                return used_.front() + limit_.window;
+            }
+
+            /**
+             * This uses a token, which must be available.
+             */
+            void Take(double now)
+            {
+                used_.push_back(now);
+            }
+
+        private:
+            /**
+             * This takes back tokens whose window has passed.
+             */
+            void Refill(double now)
+            {
+                while (!used_.empty() && (used_.front() + limit_.window <= now))
+                {
+                    used_.pop_front();
+                }
+            }
+
+            /**
+             * This is the limit the bucket enforces.
+             */
+            TwitchBot::OutboundScheduler::Limit limit_;
+
+            /**
+             * These are the times at which each token still out was used, in
+             * order.
+             */
+            std::deque< double > used_;
+    };
+
+    /**
+     * This is the number of rate limit classes.
+     */
+    constexpr size_t LIMIT_CLASS_COUNT = (size_t)TwitchBot::RateLimitClass::Join + 1;
+
+    /**
+     * This is a line waiting to be sent.
+     */
+    struct PendingLine
+    {
+        /**
+         * This is the line to send, including its CRLF.
+         */
+        std::string line;
+
+        /**
+         * This is when the line was queued, in seconds.
+         */
+        double queued;
+
+        /**
+         * This is the order in which the line was queued, relative to all
+         * other lines.
+         */
+        uint64_t sequence;
+    };
+
+    /**
+     * These are the lines waiting in a single lane. Lines are kept apart by
+     * the rate limit they count against, so that a line held back by one
+     * limit doesn't hold back lines which count against another.
+     */
+    struct Lane
+    {
+        /**
+         * These are the lines waiting for each rate limit class, in order.
+         */
+        std::deque< PendingLine > lines[LIMIT_CLASS_COUNT];
+
+        /**
+         * This returns the number of lines waiting.
+         */
+        size_t GetDepth() const
+        {
+            size_t depth = 0;
+            for (const auto& queue: lines)
+            {
+                depth += queue.size();
+            }
+            return depth;
+        }
+    };
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of an OutboundScheduler instance.
+     */
+    struct OutboundScheduler::Impl
+    {
+        /**
+         * This limits PRIVMSGs to channels in which the bot is not a
+         * moderator.
+         */
+        TokenBucket message;
+
+        /**
+         * This limits all PRIVMSGs.
+         */
+        TokenBucket moderatorMessage;
+
+        /**
+         * This limits JOINs.
+         */
+        TokenBucket join;
+
+        /**
+         * These are the lines waiting in each lane.
+         */
+        Lane lanes[(size_t)OutboundLane::Count];
+
+        /**
+         * This is the sequence number to give the next line queued.
+         */
+        uint64_t nextSequence = 0;
+
+        /**
+         * These are measurements of the queues.
+         */
+        Stats stats;
+
+        /**
+         * This counts how long each line sent waited.
+         */
+        LatencyHistogram waitHistogram;
+
+        // Methods
+
+        /**
+         * This method returns when a line of the given class may be sent.
+         */
+        double GetAvailableTime(RateLimitClass limitClass, double now)
+        {
+            switch (limitClass)
+            {
+                case RateLimitClass::Message:
+                {
+                    const auto regular = message.GetAvailableTime(now);
+                    const auto moderator = moderatorMessage.GetAvailableTime(now);
+                    return (regular > moderator) ? regular : moderator;
+                }
+
+                case RateLimitClass::ModeratorMessage:
+                {
+                    return moderatorMessage.GetAvailableTime(now);
+                }
+
+                case RateLimitClass::Join:
+                {
+                    return join.GetAvailableTime(now);
+                }
+
+                default:
+                {
+                    return now;
+                }
+            }
+        }
+
+        /**
+         * This method counts a line of the given class as sent.
+         */
+        void Take(RateLimitClass limitClass, double now)
+        {
+            switch (limitClass)
+            {
+                case RateLimitClass::Message:
+                {
+                    message.Take(now);
+                    moderatorMessage.Take(now);
+                } break;
+
+                case RateLimitClass::ModeratorMessage:
+                {
+                    moderatorMessage.Take(now);
+                } break;
+
+                case RateLimitClass::Join:
+                {
+                    join.Take(now);
+                } break;
+
+                default:
+                {
+                } break;
+            }
+        }
+    };
+
+    OutboundScheduler::~OutboundScheduler() noexcept = default;
+
+    OutboundScheduler::OutboundScheduler()
+        : impl_(new Impl())
+    {
+        SetLimits(Limits());
+    }
+
+    void OutboundScheduler::SetLimits(const Limits& limits)
+    {
+        impl_->message.Configure(limits.message);
+        impl_->moderatorMessage.Configure(limits.moderatorMessage);
+        impl_->join.Configure(limits.join);
+    }
+
+    void OutboundScheduler::Enqueue(
+        OutboundLane lane,
+        RateLimitClass limitClass,
+        std::string line,
+        double now
+    )
+    {
+        PendingLine pendingLine;
+        pendingLine.line = std::move(line);
+        pendingLine.queued = now;
+        pendingLine.sequence = impl_->nextSequence++;
+        impl_->lanes[(size_t)lane].lines[(size_t)limitClass].push_back(std::move(pendingLine));
+        const auto depth = impl_->lanes[(size_t)lane].GetDepth();
+        auto& maxQueueDepth = impl_->stats.maxQueueDepth[(size_t)lane];
+        if (depth > maxQueueDepth)
+        {
+            maxQueueDepth = depth;
+        }
+    }
+
+    bool OutboundScheduler::Dequeue(double now, std::string& batch)
+    {
+        batch.clear();
+        bool full = false;
+        for (
+            size_t lane = 0;
+            (lane < (size_t)OutboundLane::Count) && !full;
+            ++lane
+        )
+        {
+            // Take lines from the lane in the order they were queued, but
+            // skip over lines held back by a rate limit. Those lines, and
+            // any later lines counting against the same limit, wait. Lines
+            // counting against no limit, such as PART, never overtake a
+            // line held back, since they may depend on it.
+            auto& queues = impl_->lanes[lane].lines;
+            bool blocked[LIMIT_CLASS_COUNT] = {};
+            uint64_t firstBlocked = UINT64_MAX;
+            while (true)
+            {
+                size_t next = LIMIT_CLASS_COUNT;
+                for (size_t limitClass = 0; limitClass < LIMIT_CLASS_COUNT; ++limitClass)
+                {
+                    if (blocked[limitClass] || queues[limitClass].empty())
+                    {
+                        continue;
+                    }
+                    if (
+                        (next == LIMIT_CLASS_COUNT)
+                        || (queues[limitClass].front().sequence < queues[next].front().sequence)
+                    )
+                    {
+                        next = limitClass;
+                    }
+                }
+                if (next == LIMIT_CLASS_COUNT)
+                {
+                    break;
+                }
+                auto& pendingLine = queues[next].front();
+                if (
+                    !batch.empty()
+                    && (batch.length() + pendingLine.line.length() > MAX_BATCH_LENGTH)
+                )
+                {
+                    // Once the batch is full, stop for good, rather than
+                    // letting lines of lower lanes which still fit jump
+                    // ahead of this one.
+                    full = true;
+                    break;
+                }
+                if (
+                    ((RateLimitClass)next == RateLimitClass::None)
+                    && (pendingLine.sequence > firstBlocked)
+                )
+                {
+                    blocked[next] = true;
+                    continue;
+                }
+                if (impl_->GetAvailableTime((RateLimitClass)next, now) > now)
+                {
+                    ++impl_->stats.throttled;
+                    blocked[next] = true;
+                    if (pendingLine.sequence < firstBlocked)
+                    {
+                        firstBlocked = pendingLine.sequence;
+                    }
+                    continue;
+                }
+                impl_->Take((RateLimitClass)next, now);
+                batch += pendingLine.line;
+                const auto wait = now - pendingLine.queued;
+                impl_->stats.totalWait[lane] += wait;
+                if (wait > impl_->stats.maxWait[lane])
+                {
+                    impl_->stats.maxWait[lane] = wait;
+                }
+                impl_->waitHistogram.Record((wait > 0.0) ? (uint64_t)(wait * 1e9) : 0);
+                ++impl_->stats.linesSent[lane];
+                queues[next].pop_front();
+            }
+        }
+        if (batch.empty())
+        {
+            return false;
+        }
+        ++impl_->stats.batches;
+        return true;
+    }
+
+    bool OutboundScheduler::GetNextSendTime(double& when) const
+    {
+        bool waiting = false;
+        for (auto& lane: impl_->lanes)
+        {
+            // Lines counting against no limit only wait behind other lines,
+            // so they're sent whenever those are.
+            for (size_t limitClass = 0; limitClass < LIMIT_CLASS_COUNT; ++limitClass)
+            {
+                const auto& queue = lane.lines[limitClass];
+                if (
+                    queue.empty()
+                    || ((RateLimitClass)limitClass == RateLimitClass::None)
+                )
+                {
+                    continue;
+                }
+                const auto available = impl_->GetAvailableTime(
+                    (RateLimitClass)limitClass,
+                    queue.front().queued
+                );
+                if (!waiting || (available < when))
+                {
+                    when = available;
+                    waiting = true;
+                }
+            }
+        }
+        return waiting;
+    }
+
+    bool OutboundScheduler::Empty() const
+    {
+        for (const auto& lane: impl_->lanes)
+        {
+            if (lane.GetDepth() != 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void OutboundScheduler::Clear()
+    {
+        for (auto& lane: impl_->lanes)
+        {
+            for (auto& queue: lane.lines)
+            {
+                queue.clear();
+            }
+        }
+    }
+
+    OutboundScheduler::Stats OutboundScheduler::GetStats() const
+    {
+        auto stats = impl_->stats;
+        for (size_t lane = 0; lane < (size_t)OutboundLane::Count; ++lane)
+        {
+            stats.queueDepth[lane] = impl_->lanes[lane].GetDepth();
+        }
+        return stats;
+    }
+
+    const LatencyHistogram& OutboundScheduler::GetWaitHistogram() const
+    {
+        return impl_->waitHistogram;
+    }
+}
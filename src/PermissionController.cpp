@@ -1,4 +1,491 @@
-class PermissionController
+#include <unordered_map>
+#include <vector>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Hashing.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/PermissionController.hpp>
+
+namespace
 {
+    /**
+     * This is the number of entries in each set of the cache. A user may be
+     * cached in any entry of the one set their channel and user ID hash to.
+     * A set fills one cache line, so looking a user up reads memory once.
+     */
+    constexpr size_t WAYS_PER_SET = 4;
+
+    /**
+     * This bit of an entry's roles is set when the entry is used, and
+     * cleared as entries are passed over when looking for one to take over,
+     * so entries used recently get a second chance.
+     */
+    constexpr uint32_t REFERENCED_FLAG = 0x80000000;
+
+    /**
+     * This marks a user ID made from a nickname rather than given by
+     * Twitch, which is used when a message has no user-id tag.
+     */
+    constexpr uint64_t NICKNAME_USER_FLAG = (uint64_t)1 << 63;
+
+    /**
+     * This relates the name of a Twitch badge to the role it shows.
+     */
+    struct BadgeRole
+    {
+        std::string_view name;
+        TwitchBot::PermissionController::RoleMask role;
+    };
+
+    /**
+     * These are the badges which show roles.
+     */
+    const BadgeRole BADGE_ROLES[] = {
+        {"broadcaster", TwitchBot::PermissionController::Broadcaster},
+        {"moderator", TwitchBot::PermissionController::Moderator},
+        {"subscriber", TwitchBot::PermissionController::Subscriber},
+        {"founder", TwitchBot::PermissionController::Founder | TwitchBot::PermissionController::Subscriber},
+        {"vip", TwitchBot::PermissionController::Vip},
+        {"staff", TwitchBot::PermissionController::Staff},
+        {"admin", TwitchBot::PermissionController::Admin},
+        {"global_mod", TwitchBot::PermissionController::GlobalModerator},
+        {"partner", TwitchBot::PermissionController::Partner},
+        {"turbo", TwitchBot::PermissionController::Turbo},
+        {"premium", TwitchBot::PermissionController::Prime},
+        {"artist-badge", TwitchBot::PermissionController::Artist},
+        {"bits", TwitchBot::PermissionController::Cheerer},
+    };
+
+    /**
+     * This returns the key of the channel named by the first parameter of a
+     * message, or by the given name.
+     */
+    uint64_t GetChannelKey(std::string_view channel)
+    {
+        if (!channel.empty() && (channel[0] == '#'))
+        {
+            channel.remove_prefix(1);
+        }
+        return TwitchBot::HashTextFoldingCase(channel);
+    }
+
+    /**
+     * This returns the key of the user who sent a message: their Twitch
+     * user ID if the message has one, or else a hash of their nickname.
+     */
+    uint64_t GetUserKey(const TwitchBot::Message& message)
+    {
+        const auto userId = message.tags.GetUserId();
+        if (
+            (userId != 0)
+            && ((userId & NICKNAME_USER_FLAG) == 0)
+        )
+        {
+            return userId;
+        }
+        return TwitchBot::HashTextFoldingCase(message.GetNickname()) | NICKNAME_USER_FLAG;
+    }
+
+    /**
+     * This holds the roles of one user in one channel.
+     */
+    struct Entry
+    {
+        /**
+         * This is the key of the user, or 0 if the entry is free.
+         */
+        uint64_t user = 0;
+
+        /**
+         * This is the generation of the channel when the roles were
+         * decoded. Generations are unique across channels, so this also
+         * tells which channel the entry is for. If the channel's generation
+         * has changed since, the roles are out of date.
+         */
+        uint32_t generation = 0;
+
+        /**
+         * These are the user's roles, along with REFERENCED_FLAG.
+         */
+        uint32_t roles = 0;
+    };
+
+    /**
+     * This is a set of entries which fills one cache line.
+     */
+    struct alignas(64) Set
+    {
+        Entry ways[WAYS_PER_SET];
+    };
+
+    static_assert(
+        TwitchBot::PermissionController::Cheerer < REFERENCED_FLAG,
+        "Every role must fit in an entry, beside REFERENCED_FLAG"
+    );
+
+    /**
+     * This holds what's known about one channel.
+     */
+    struct Channel
+    {
+        /**
+         * This changes whenever all cached roles in the channel are
+         * dropped. Generations are never reused.
+         */
+        uint32_t generation = 0;
+
+        /**
+         * These are the bot's own roles in the channel.
+         */
+        TwitchBot::PermissionController::RoleMask ownRoles = 0;
+    };
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a PermissionController
+     * instance.
+     */
+    struct PermissionController::Impl
+    {
+        // Properties
+
+        /**
+         * These are the cached roles.
+         */
+        std::vector< Set > sets;
+
+        /**
+         * This is the number of sets, less one. The number of sets is a
+         * power of two.
+         */
+        uint64_t setMask = 0;
+
+        /**
+         * These are the channels seen, by key.
+         */
+        std::unordered_map< uint64_t, Channel > channels;
+
+        /**
+         * This is the channel most recently looked up, and its key, since
+         * messages from the same channel tend to come in runs.
+         */
+        Channel* lastChannel = nullptr;
+        uint64_t lastChannelKey = 0;
+
+        /**
+         * This is the generation to give the next channel seen or
+         * invalidated.
+         */
+        uint32_t nextGeneration = 1;
+
+        /**
+         * These are the measurements of the cache.
+         */
+        Stats stats;
+
+        // Methods
+
+        /**
+         * This method returns the channel with the given key, adding it if
+         * it hasn't been seen before.
+         */
+        Channel& GetChannel(uint64_t channelKey)
+        {
+            if (
+                (lastChannel != nullptr)
+                && (lastChannelKey == channelKey)
+            )
+            {
+                return *lastChannel;
+            }
+            auto& channel = channels[channelKey];
+            if (channel.generation == 0)
+            {
+                channel.generation = nextGeneration++;
+            }
+            lastChannel = &channel;
+            lastChannelKey = channelKey;
+            return channel;
+        }
+
+        /**
+         * This method returns the set which may hold the given user in the
+         * given generation of a channel.
+         */
+        Set& GetSet(uint32_t generation, uint64_t userKey)
+        {
+            return sets[Mix(userKey ^ ((uint64_t)generation << 32)) & setMask];
+        }
+
+        /**
+         * This method returns the entry holding the given user in the given
+         * generation of a channel, or nullptr if there's none.
+         */
+        Entry* Find(uint32_t generation, uint64_t userKey)
+        {
+            auto& set = GetSet(generation, userKey);
+            for (auto& entry: set.ways)
+            {
+                if (
+                    (entry.user == userKey)
+                    && (entry.generation == generation)
+                )
+                {
+                    return &entry;
+                }
+            }
+            return nullptr;
+        }
+
+        /**
+         * This method drops all cached roles in one channel, by moving it to
+         * a new generation. The old entries are taken over in time.
+         */
+        void Invalidate(uint64_t channelKey)
+        {
+            GetChannel(channelKey).generation = nextGeneration++;
+            ++stats.invalidations;
+        }
+
+        /**
+         * This method decodes the roles of the sender of a message, and
+         * caches them.
+         */
+        RoleMask Lookup(const Message& message)
+        {
+            // The message being handled is already in the processor's cache,
+            // while the user's entry most likely isn't, so decoding the
+            // roles from the message is quicker than finding them in the
+            // cache. It also means they're never out of date.
+            const auto roles = DecodeRoles(message.tags);
+            const auto generation = GetChannel(GetChannelKey(message.parameters[0])).generation;
+            const auto userKey = GetUserKey(message);
+            auto& set = GetSet(generation, userKey);
+            for (auto& entry: set.ways)
+            {
+                if (
+                    (entry.user == userKey)
+                    && (entry.generation == generation)
+                )
+                {
+                    if ((entry.roles & ~REFERENCED_FLAG) == roles)
+                    {
+                        ++stats.hits;
+                    }
+                    else
+                    {
+                        ++stats.refreshes;
+                    }
+                    entry.roles = roles | REFERENCED_FLAG;
+                    return roles;
+                }
+            }
+
+            // Take over a free entry if there is one, or else the first one
+            // not used since it was last passed over.
+            ++stats.misses;
+            Entry* victim = nullptr;
+            for (auto& entry: set.ways)
+            {
+                if (entry.user == 0)
+                {
+                    victim = &entry;
+                    ++stats.entries;
+                    break;
+                }
+            }
+            while (victim == nullptr)
+            {
+                for (auto& entry: set.ways)
+                {
+                    if ((entry.roles & REFERENCED_FLAG) == 0)
+                    {
+                        victim = &entry;
+                        break;
+                    }
+                    entry.roles &= ~REFERENCED_FLAG;
+                }
+            }
+            if (victim->user != 0)
+            {
+                ++stats.evictions;
+            }
+            victim->user = userKey;
+            victim->generation = generation;
+            victim->roles = roles | REFERENCED_FLAG;
+            return roles;
+        }
+    };
+
+    PermissionController::~PermissionController() noexcept = default;
+    PermissionController::PermissionController(PermissionController&&) noexcept = default;
+    PermissionController& PermissionController::operator=(PermissionController&&) noexcept = default;
+
+    PermissionController::PermissionController(size_t capacity)
+        : impl_(new Impl())
+    {
+        size_t setCount = 1;
+        while (setCount * WAYS_PER_SET < capacity)
+        {
+            setCount *= 2;
+        }
+        impl_->setMask = setCount - 1;
+        impl_->sets.resize(setCount);
+        impl_->stats.capacity = setCount * WAYS_PER_SET;
+        impl_->stats.bytesPerEntry = sizeof(Entry);
+        impl_->stats.bytes = setCount * sizeof(Set);
+    }
+
+    PermissionController::RoleMask PermissionController::Resolve(const Message& message)
+    {
+        if (
+            message.parameters.empty()
+            || message.parameters[0].empty()
+            || (message.parameters[0][0] != '#')
+        )
+        {
+            return 0;
+        }
+        const auto knownCommand = message.GetKnownCommand();
+        if (
+            (knownCommand == KnownCommand::Privmsg)
+            || (knownCommand == KnownCommand::UserNotice)
+        )
+        {
+            return impl_->Lookup(message);
+        }
+        const auto channelKey = GetChannelKey(message.parameters[0]);
+        if (knownCommand == KnownCommand::UserState)
+        {
+            const auto roles = DecodeRoles(message.tags);
+            impl_->GetChannel(channelKey).ownRoles = roles;
+            return roles;
+        }
+        if (knownCommand == KnownCommand::ClearChat)
+        {
+            // A ban or timeout names the user. Without one, the whole chat
+            // was cleared.
+            int64_t targetUserId;
+            if (
+                message.tags.GetInteger(KnownTag::TargetUserId, targetUserId)
+                && (targetUserId > 0)
+            )
+            {
+                const auto entry = impl_->Find(
+                    impl_->GetChannel(channelKey).generation,
+                    (uint64_t)targetUserId
+                );
+                if (entry != nullptr)
+                {
+                    *entry = Entry();
+                    --impl_->stats.entries;
+                    ++impl_->stats.invalidations;
+                }
+            }
+            else
+            {
+                impl_->Invalidate(channelKey);
+            }
+        }
+        else if (knownCommand == KnownCommand::RoomState)
+        {
+            impl_->Invalidate(channelKey);
+        }
+        return 0;
+    }
+
+    bool PermissionController::Check(
+        const Message& message,
+        RoleMask required
+    )
+    {
+        return Allows(Resolve(message), required);
+    }
+
+    bool PermissionController::GetRoles(
+        std::string_view channel,
+        uint64_t userId,
+        RoleMask& roles
+    )
+    {
+        const auto channelEntry = impl_->channels.find(GetChannelKey(channel));
+        if (channelEntry == impl_->channels.end())
+        {
+            return false;
+        }
+        const auto entry = impl_->Find(channelEntry->second.generation, userId);
+        if (entry == nullptr)
+        {
+            return false;
+        }
+        entry->roles |= REFERENCED_FLAG;
+        roles = entry->roles & ~REFERENCED_FLAG;
+        return true;
+    }
+
+    PermissionController::RoleMask PermissionController::GetOwnRoles(std::string_view channel) const
+    {
+        const auto channelEntry = impl_->channels.find(GetChannelKey(channel));
+        if (channelEntry == impl_->channels.end())
+        {
+            return 0;
+        }
+        return channelEntry->second.ownRoles;
+    }
+
+    void PermissionController::ForgetChannel(std::string_view channel)
+    {
+        // Cached entries are left to be taken over, since their generation
+        // will never be used again.
+        impl_->channels.erase(GetChannelKey(channel));
+        impl_->lastChannel = nullptr;
+        ++impl_->stats.invalidations;
+    }
+
+    void PermissionController::Clear()
+    {
+        for (auto& set: impl_->sets)
+        {
+            set = Set();
+        }
+        impl_->channels.clear();
+        impl_->lastChannel = nullptr;
+        impl_->stats.entries = 0;
+    }
+
+    auto PermissionController::GetStats() const -> Stats
+    {
+        return impl_->stats;
+    }
 
-}
\ No newline at end of file
+    PermissionController::RoleMask PermissionController::DecodeRoles(const MessageTags& tags)
+    {
+        RoleMask roles = Viewer;
+        auto badges = tags.GetBadges();
+        while (!badges.empty())
+        {
+            auto badgeEnd = badges.find(',');
+            if (badgeEnd == std::string_view::npos)
+            {
+                badgeEnd = badges.length();
+            }
+            const auto badge = badges.substr(0, badgeEnd);
+            const auto name = badge.substr(0, badge.find('/'));
+            for (const auto& badgeRole: BADGE_ROLES)
+            {
+                if (badgeRole.name == name)
+                {
+                    roles |= badgeRole.role;
+                    break;
+                }
+            }
+            badges.remove_prefix(
+                (badgeEnd < badges.length()) ? badgeEnd + 1 : badgeEnd
+            );
+        }
+        if (tags.GetRawValue(KnownTag::Mod) == "1")
+        {
+            roles |= Moderator;
+        }
+        return roles;
+    }
+}
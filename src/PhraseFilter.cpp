@@ -0,0 +1,773 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/PhraseFilter.hpp>
+
+namespace
+{
+    /**
+     * This marks the lack of a state.
+     */
+    constexpr uint32_t NO_STATE = 0xFFFFFFFF;
+
+    /**
+     * This bit is set in the transitions to states where any phrase ends,
+     * so that scanning only looks any further on reaching them.
+     */
+    constexpr uint32_t MATCH_BIT = 0x80000000;
+
+    /**
+     * These are the deepest states given a full table of transitions, and
+     * the most memory, in bytes, those tables may use.
+     */
+    constexpr size_t DENSE_DEPTH = 3;
+    constexpr size_t MAX_DENSE_SIZE = 2 << 20;
+
+    /**
+     * This is the alphabet of the automaton: each byte is matched as its
+     * class. Bytes which normalize to the same byte are in the same
+     * class, and bytes which aren't in any phrase are all in class 0.
+     */
+    typedef uint16_t CharacterClass;
+
+    /**
+     * This returns an indication of whether or not the given byte of text,
+     * before it's normalized, is part of a word.
+     */
+    bool IsWordCharacter(unsigned char c)
+    {
+        return (
+            ((c >= 'a') && (c <= 'z'))
+            || ((c >= 'A') && (c <= 'Z'))
+            || ((c >= '0') && (c <= '9'))
+            || (c >= 0x80)
+        );
+    }
+
+    /**
+     * This is the phrase list compiled into an Aho-Corasick automaton.
+     * State 0 is the start, and states are numbered breadth first.
+     */
+    struct Automaton
+    {
+        /**
+         * This is one state of the automaton, which stands for having
+         * just matched the start of one or more phrases. It only holds
+         * what's needed to move on from it, so that as many states as
+         * possible fit in the cache.
+         */
+        struct State
+        {
+            /**
+             * This is where to carry on from if the state doesn't lead on
+             * with the character read: the state matching the longest
+             * suffix of what this one matched.
+             */
+            uint32_t fail = 0;
+
+            /**
+             * These locate the transitions which lead on from the state,
+             * in edges, sorted by class.
+             */
+            uint32_t edges = 0;
+            uint32_t edgeCount = 0;
+        };
+
+        /**
+         * This is one transition of a state which doesn't have a full
+         * table: the state to go to next, with MATCH_BIT set if any phrase
+         * ends there, and the class of character which leads there.
+         */
+        struct Edge
+        {
+            uint32_t target = 0;
+            CharacterClass label = 0;
+        };
+
+        /**
+         * These are the phrases found on reaching a state.
+         */
+        struct StateOutputs
+        {
+            /**
+             * These locate the phrases which end at the state, in outputs.
+             */
+            uint32_t first = 0;
+            uint32_t count = 0;
+
+            /**
+             * This is the next state down the chain of fail states where
+             * any phrase ends, or NO_STATE if there isn't one.
+             */
+            uint32_t link = NO_STATE;
+        };
+
+        /**
+         * This is the class of each byte.
+         */
+        std::array< CharacterClass, 256 > classes{};
+
+        /**
+         * This is the number of classes.
+         */
+        size_t classCount = 1;
+
+        /**
+         * These are the number of states with a full table of transitions,
+         * which are the first ones, and their tables, one after another.
+         * Each transition is the state to go to next, with MATCH_BIT set if
+         * any phrase ends there.
+         */
+        size_t denseStates = 0;
+        std::vector< uint32_t > dense;
+
+        /**
+         * These are the states and their transitions.
+         */
+        std::vector< State > states;
+        std::vector< Edge > edges;
+
+        /**
+         * These are the phrases found on reaching each state, and the
+         * positions in the list of the phrases ending at each state.
+         */
+        std::vector< StateOutputs > stateOutputs;
+        std::vector< uint32_t > outputs;
+
+        /**
+         * These are the length of each phrase in the list, in bytes, and
+         * whether or not it only matches whole words.
+         */
+        std::vector< uint32_t > phraseLengths;
+        std::vector< bool > phraseWholeWord;
+
+        /**
+         * These are the number of phrases compiled, and how long it took,
+         * in seconds.
+         */
+        size_t phrases = 0;
+        double compileTime = 0.0;
+
+        /**
+         * This method returns the state to go to from the given one on
+         * reading a character of the given class, without MATCH_BIT.
+         */
+        uint32_t Next(
+            uint32_t state,
+            CharacterClass characterClass
+        ) const
+        {
+            for (;;)
+            {
+                if (state < denseStates)
+                {
+                    return dense[state * classCount + characterClass] & ~MATCH_BIT;
+                }
+                const auto& current = states[state];
+                const auto first = edges.data() + current.edges;
+                const auto last = first + current.edgeCount;
+                for (auto edge = first; edge != last; ++edge)
+                {
+                    if (edge->label == characterClass)
+                    {
+                        return edge->target & ~MATCH_BIT;
+                    }
+                }
+                state = current.fail;
+            }
+        }
+
+        /**
+         * This method looks for phrases in the given text, calling the
+         * given visitor with each one found until it returns false.
+         *
+         * @return The number of phrases found is returned.
+         */
+        template< typename Visitor > size_t Scan(
+            std::string_view text,
+            Visitor&& visitor
+        ) const
+        {
+            const auto characters = (const unsigned char*)text.data();
+            const auto length = text.length();
+            const auto denseTable = dense.data();
+            const auto edgeTable = edges.data();
+            size_t found = 0;
+            uint32_t state = 0;
+            for (size_t i = 0; i < length; ++i)
+            {
+                // No phrase has any byte of class 0 in it, so after one,
+                // scanning starts over.
+                const auto characterClass = classes[characters[i]];
+                if (characterClass == 0)
+                {
+                    state = 0;
+                    continue;
+                }
+                uint32_t next;
+                for (;;)
+                {
+                    if (state < denseStates)
+                    {
+                        next = denseTable[state * classCount + characterClass];
+                        break;
+                    }
+                    const auto& current = states[state];
+                    auto edge = edgeTable + current.edges;
+                    const auto last = edge + current.edgeCount;
+                    while ((edge != last) && (edge->label != characterClass))
+                    {
+                        ++edge;
+                    }
+                    if (edge != last)
+                    {
+                        next = edge->target;
+                        break;
+                    }
+                    state = current.fail;
+                }
+                state = next & ~MATCH_BIT;
+                if ((next & MATCH_BIT) == 0)
+                {
+                    continue;
+                }
+                const auto end = i + 1;
+                auto output = (
+                    (stateOutputs[state].count > 0)
+                    ? state
+                    : stateOutputs[state].link
+                );
+                for (; output != NO_STATE; output = stateOutputs[output].link)
+                {
+                    const auto& ending = stateOutputs[output];
+                    for (uint32_t j = 0; j < ending.count; ++j)
+                    {
+                        const auto phrase = outputs[ending.first + j];
+                        const auto begin = end - phraseLengths[phrase];
+                        if (
+                            phraseWholeWord[phrase]
+                            && (
+                                ((begin > 0) && IsWordCharacter(characters[begin - 1]))
+                                || ((end < length) && IsWordCharacter(characters[end]))
+                            )
+                        )
+                        {
+                            continue;
+                        }
+                        ++found;
+                        TwitchBot::PhraseFilter::Match match;
+                        match.phrase = phrase;
+                        match.begin = begin;
+                        match.end = end;
+                        if (!visitor(match))
+                        {
+                            return found;
+                        }
+                    }
+                }
+            }
+            return found;
+        }
+
+        /**
+         * This method returns how much memory the automaton uses.
+         */
+        size_t GetMemoryUsage() const
+        {
+            return (
+                sizeof(*this)
+                + dense.capacity() * sizeof(uint32_t)
+                + states.capacity() * sizeof(State)
+                + edges.capacity() * sizeof(Edge)
+                + stateOutputs.capacity() * sizeof(StateOutputs)
+                + outputs.capacity() * sizeof(uint32_t)
+                + phraseLengths.capacity() * sizeof(uint32_t)
+                + phraseWholeWord.capacity() / 8
+            );
+        }
+    };
+
+    /**
+     * This makes the table of which byte each byte is normalized to.
+     */
+    std::array< unsigned char, 256 > MakeNormalization(
+        const TwitchBot::PhraseFilter::Settings& settings
+    )
+    {
+        std::array< unsigned char, 256 > normalization;
+        for (size_t i = 0; i < normalization.size(); ++i)
+        {
+            normalization[i] = (unsigned char)i;
+        }
+        if (settings.foldCase)
+        {
+            for (unsigned char c = 'A'; c <= 'Z'; ++c)
+            {
+                normalization[c] = (unsigned char)(c - 'A' + 'a');
+            }
+        }
+        if (settings.foldLeetspeak)
+        {
+            static const std::pair< char, char > LEETSPEAK[] = {
+                {'0', 'o'},
+                {'1', 'i'}, {'!', 'i'}, {'|', 'i'}, {'l', 'i'},
+                {'3', 'e'},
+                {'4', 'a'}, {'@', 'a'},
+                {'5', 's'}, {'$', 's'},
+                {'7', 't'}, {'+', 't'},
+                {'8', 'b'},
+                {'9', 'g'},
+            };
+            for (const auto& letter: LEETSPEAK)
+            {
+                normalization[(unsigned char)letter.first] = (unsigned char)letter.second;
+            }
+            if (settings.foldCase)
+            {
+                normalization['L'] = 'i';
+            }
+        }
+        return normalization;
+    }
+
+    /**
+     * This compiles the given list of phrases into an automaton.
+     */
+    std::shared_ptr< const Automaton > Compile(
+        const std::vector< TwitchBot::PhraseFilter::Phrase >& phrases,
+        const std::array< unsigned char, 256 >& normalization
+    )
+    {
+        const auto compileStart = std::chrono::steady_clock::now();
+        auto automaton = std::make_shared< Automaton >();
+
+        // Normalize the phrases, and give a class to each byte found in
+        // them, in order of the bytes, so that phrases sorted by their
+        // bytes are also sorted by their classes.
+        std::vector< std::string > normalized(phrases.size());
+        std::array< bool, 256 > used{};
+        std::vector< uint32_t > order;
+        automaton->phraseLengths.resize(phrases.size());
+        automaton->phraseWholeWord.resize(phrases.size());
+        for (size_t i = 0; i < phrases.size(); ++i)
+        {
+            const auto& text = phrases[i].text;
+            if (text.empty())
+            {
+                continue;
+            }
+            auto& phrase = normalized[i];
+            phrase.resize(text.length());
+            for (size_t j = 0; j < text.length(); ++j)
+            {
+                phrase[j] = (char)normalization[(unsigned char)text[j]];
+                used[(unsigned char)phrase[j]] = true;
+            }
+            automaton->phraseLengths[i] = (uint32_t)text.length();
+            automaton->phraseWholeWord[i] = phrases[i].wholeWord;
+            order.push_back((uint32_t)i);
+        }
+        automaton->phrases = order.size();
+        std::array< CharacterClass, 256 > byteClasses{};
+        for (size_t i = 0; i < used.size(); ++i)
+        {
+            if (used[i])
+            {
+                byteClasses[i] = (CharacterClass)automaton->classCount++;
+            }
+        }
+        for (size_t i = 0; i < automaton->classes.size(); ++i)
+        {
+            automaton->classes[i] = byteClasses[normalization[i]];
+        }
+
+        // Build the trie of the phrases, taking them in sorted order so
+        // that each one only adds states after where it stops sharing the
+        // start of the one before it. This also adds the children of each
+        // state in order of their classes.
+        std::stable_sort(
+            order.begin(),
+            order.end(),
+            [&](uint32_t lhs, uint32_t rhs){ return normalized[lhs] < normalized[rhs]; }
+        );
+        std::vector< uint32_t > parents(1, NO_STATE);
+        std::vector< CharacterClass > labels(1, 0);
+        std::vector< uint32_t > ends(phrases.size(), NO_STATE);
+        std::vector< uint32_t > path(1, 0);
+        const std::string* previous = nullptr;
+        for (const auto phrase: order)
+        {
+            const auto& text = normalized[phrase];
+            size_t shared = 0;
+            if (previous != nullptr)
+            {
+                const auto limit = std::min(text.length(), previous->length());
+                while ((shared < limit) && (text[shared] == (*previous)[shared]))
+                {
+                    ++shared;
+                }
+            }
+            path.resize(shared + 1);
+            for (size_t i = shared; i < text.length(); ++i)
+            {
+                const auto child = (uint32_t)parents.size();
+                parents.push_back(path.back());
+                labels.push_back(byteClasses[(unsigned char)text[i]]);
+                path.push_back(child);
+            }
+            ends[phrase] = path.back();
+            previous = &text;
+        }
+        const auto stateCount = parents.size();
+        std::vector< uint32_t > firstChild(stateCount + 1, 0);
+        for (size_t i = 1; i < stateCount; ++i)
+        {
+            ++firstChild[parents[i] + 1];
+        }
+        for (size_t i = 0; i < stateCount; ++i)
+        {
+            firstChild[i + 1] += firstChild[i];
+        }
+        std::vector< uint32_t > children(stateCount);
+        {
+            auto next = firstChild;
+            for (size_t i = 1; i < stateCount; ++i)
+            {
+                children[next[parents[i]]++] = (uint32_t)i;
+            }
+        }
+
+        // Number the states breadth first, and lay out their transitions
+        // in that order.
+        std::vector< uint32_t > trieStates(1, 0);
+        std::vector< uint32_t > numbers(stateCount, 0);
+        std::vector< uint32_t > depths(1, 0);
+        trieStates.reserve(stateCount);
+        depths.reserve(stateCount);
+        auto& states = automaton->states;
+        auto& edges = automaton->edges;
+        auto& stateOutputs = automaton->stateOutputs;
+        states.resize(stateCount);
+        edges.reserve(stateCount - 1);
+        for (size_t i = 0; i < stateCount; ++i)
+        {
+            const auto trieState = trieStates[i];
+            states[i].edges = (uint32_t)edges.size();
+            states[i].edgeCount = firstChild[trieState + 1] - firstChild[trieState];
+            for (auto j = firstChild[trieState]; j < firstChild[trieState + 1]; ++j)
+            {
+                const auto child = children[j];
+                numbers[child] = (uint32_t)trieStates.size();
+                trieStates.push_back(child);
+                depths.push_back(depths[i] + 1);
+                Automaton::Edge edge;
+                edge.target = numbers[child];
+                edge.label = labels[child];
+                edges.push_back(edge);
+            }
+        }
+        stateOutputs.resize(stateCount);
+        for (const auto phrase: order)
+        {
+            ++stateOutputs[numbers[ends[phrase]]].count;
+        }
+        uint32_t outputs = 0;
+        for (auto& stateOutput: stateOutputs)
+        {
+            stateOutput.first = outputs;
+            outputs += stateOutput.count;
+            stateOutput.count = 0;
+        }
+        automaton->outputs.resize(order.size());
+        for (const auto phrase: order)
+        {
+            auto& stateOutput = stateOutputs[numbers[ends[phrase]]];
+            automaton->outputs[stateOutput.first + stateOutput.count++] = phrase;
+        }
+
+        // Find the fail state of each state from those of the states
+        // before it, and fill in the tables of the shallow states, whose
+        // fail states are shallower still.
+        const auto classCount = automaton->classCount;
+        while (
+            (automaton->denseStates < stateCount)
+            && ((automaton->denseStates + 1) * classCount * sizeof(uint32_t) <= MAX_DENSE_SIZE)
+            && (depths[automaton->denseStates] <= DENSE_DEPTH)
+        )
+        {
+            ++automaton->denseStates;
+        }
+        automaton->dense.resize(automaton->denseStates * classCount);
+        for (size_t i = 0; i < stateCount; ++i)
+        {
+            const auto& state = states[i];
+            const auto first = edges.data() + state.edges;
+            const auto last = first + state.edgeCount;
+            if (i < automaton->denseStates)
+            {
+                const auto row = automaton->dense.data() + i * classCount;
+                if (i == 0)
+                {
+                    std::fill(row, row + classCount, 0);
+                }
+                else
+                {
+                    std::copy_n(automaton->dense.data() + state.fail * classCount, classCount, row);
+                }
+                for (auto edge = first; edge != last; ++edge)
+                {
+                    row[edge->label] = edge->target;
+                }
+            }
+            for (auto edge = first; edge != last; ++edge)
+            {
+                auto& child = states[edge->target];
+                child.fail = (
+                    (i == 0)
+                    ? 0
+                    : automaton->Next(state.fail, edge->label)
+                );
+                const auto& fail = stateOutputs[child.fail];
+                stateOutputs[edge->target].link = (
+                    (fail.count > 0)
+                    ? child.fail
+                    : fail.link
+                );
+            }
+        }
+
+        // Mark the transitions to states where any phrase ends.
+        const auto markMatch = [&](uint32_t& target){
+            const auto& stateOutput = stateOutputs[target];
+            if ((stateOutput.count > 0) || (stateOutput.link != NO_STATE))
+            {
+                target |= MATCH_BIT;
+            }
+        };
+        for (auto& target: automaton->dense)
+        {
+            markMatch(target);
+        }
+        for (auto& edge: edges)
+        {
+            markMatch(edge.target);
+        }
+        automaton->compileTime = std::chrono::duration< double >(
+            std::chrono::steady_clock::now() - compileStart
+        ).count();
+        return automaton;
+    }
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a PhraseFilter instance.
+     */
+    struct PhraseFilter::Impl
+    {
+        // Properties
+
+        /**
+         * This is the table of which byte each byte is normalized to.
+         */
+        std::array< unsigned char, 256 > normalization;
+
+        /**
+         * This is used to synchronize access to the properties below, and
+         * for the thread of the filter.
+         */
+        mutable std::mutex mutex;
+
+        /**
+         * This is used to wake the compiler thread when a list is set.
+         */
+        std::condition_variable compilerWake;
+
+        /**
+         * This is used to wake callers of Flush when a list is swapped
+         * in.
+         */
+        std::condition_variable compiled;
+
+        /**
+         * This is the last list set, if it hasn't been taken to be
+         * compiled yet.
+         */
+        std::vector< Phrase > pending;
+        bool hasPending = false;
+
+        /**
+         * These are the number of lists set, the number of the list in
+         * use (counting from one, in the order they were set), and the
+         * number of lists compiled.
+         */
+        uint64_t listsSet = 0;
+        uint64_t listInUse = 0;
+        uint64_t listsCompiled = 0;
+
+        /**
+         * This is set to have the thread of the filter stop.
+         */
+        bool stopping = false;
+
+        /**
+         * This is the automaton in use. It never changes; compiling a new
+         * list replaces it.
+         */
+        std::shared_ptr< const Automaton > automaton;
+
+        /**
+         * This is the thread which compiles lists.
+         */
+        std::thread compiler;
+
+        // Methods
+
+        explicit Impl(const Settings& settings)
+            : normalization(MakeNormalization(settings))
+            , automaton(Compile({}, normalization))
+        {
+        }
+
+        /**
+         * This method returns the automaton in use.
+         */
+        std::shared_ptr< const Automaton > GetAutomaton() const
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            return automaton;
+        }
+
+        /**
+         * This method is the body of the compiler thread.
+         */
+        void Compiler()
+        {
+            std::unique_lock< decltype(mutex) > lock(mutex);
+            for (;;)
+            {
+                if (stopping)
+                {
+                    return;
+                }
+                if (!hasPending)
+                {
+                    compilerWake.wait(lock);
+                    continue;
+                }
+                const auto phrases = std::move(pending);
+                const auto list = listsSet;
+                pending.clear();
+                hasPending = false;
+                lock.unlock();
+                auto newAutomaton = Compile(phrases, normalization);
+                lock.lock();
+                automaton = std::move(newAutomaton);
+                listInUse = list;
+                ++listsCompiled;
+                compiled.notify_all();
+            }
+        }
+    };
+
+    PhraseFilter::~PhraseFilter() noexcept
+    {
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            impl_->stopping = true;
+            impl_->compilerWake.notify_all();
+            impl_->compiled.notify_all();
+        }
+        impl_->compiler.join();
+    }
+
+    PhraseFilter::PhraseFilter()
+        : PhraseFilter(Settings())
+    {
+    }
+
+    PhraseFilter::PhraseFilter(const Settings& settings)
+        : impl_(new Impl(settings))
+    {
+        impl_->compiler = std::thread(&Impl::Compiler, impl_.get());
+    }
+
+    void PhraseFilter::SetPhrases(std::vector< Phrase > phrases)
+    {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        impl_->pending = std::move(phrases);
+        impl_->hasPending = true;
+        ++impl_->listsSet;
+        impl_->compilerWake.notify_one();
+    }
+
+    void PhraseFilter::Flush()
+    {
+        std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+        const auto target = impl_->listsSet;
+        impl_->compiled.wait(
+            lock,
+            [&]{ return (impl_->listInUse >= target) || impl_->stopping; }
+        );
+    }
+
+    size_t PhraseFilter::Scan(
+        std::string_view text,
+        MatchVisitor visitor
+    ) const
+    {
+        const auto automaton = impl_->GetAutomaton();
+        return automaton->Scan(text, visitor);
+    }
+
+    bool PhraseFilter::Check(
+        std::string_view text,
+        Match& match
+    ) const
+    {
+        const auto automaton = impl_->GetAutomaton();
+        return automaton->Scan(
+            text,
+            [&](const Match& found){
+                match = found;
+                return false;
+            }
+        ) > 0;
+    }
+
+    bool PhraseFilter::Check(
+        const Message& message,
+        Match& match
+    ) const
+    {
+        if (
+            (message.GetKnownCommand() != KnownCommand::Privmsg)
+            || (message.parameters.size() < 2)
+        )
+        {
+            return false;
+        }
+        return Check(message.parameters.back(), match);
+    }
+
+    auto PhraseFilter::GetStats() const -> Stats
+    {
+        Stats stats;
+        std::shared_ptr< const Automaton > automaton;
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            automaton = impl_->automaton;
+            stats.listsSet = impl_->listsSet;
+            stats.listsCompiled = impl_->listsCompiled;
+        }
+        stats.phrases = automaton->phrases;
+        stats.states = automaton->states.size();
+        stats.memoryUsage = automaton->GetMemoryUsage();
+        stats.compileTime = automaton->compileTime;
+        return stats;
+    }
+}
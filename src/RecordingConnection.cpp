@@ -0,0 +1,83 @@
+#include <atomic>
+#include <chrono>
+#include <utility>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/RecordingConnection.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a RecordingConnection
+     * instance.
+     */
+    struct RecordingConnection::Impl
+    {
+        /**
+         * This is the connection everything is passed through to.
+         */
+        std::shared_ptr< Connection > connection;
+
+        /**
+         * This is where the text received is recorded.
+         */
+        std::shared_ptr< CaptureWriter > capture;
+
+        /**
+         * This is when Connect was called, in nanoseconds of the steady
+         * clock. Recorded times are measured from here.
+         */
+        std::atomic< int64_t > start{0};
+    };
+
+    RecordingConnection::~RecordingConnection() noexcept = default;
+
+    RecordingConnection::RecordingConnection(
+        std::shared_ptr< Connection > connection,
+        std::shared_ptr< CaptureWriter > capture
+    )
+        : impl_(new Impl())
+    {
+        impl_->connection = std::move(connection);
+        impl_->capture = std::move(capture);
+    }
+
+    void RecordingConnection::SetMessageReceivedDelegate(MessageReceivedDelegate messageReceivedDelegate)
+    {
+        auto impl = impl_.get();
+        impl_->connection->SetMessageReceivedDelegate(
+            [impl, messageReceivedDelegate](const std::string& message)
+            {
+                const auto now = std::chrono::duration_cast< std::chrono::nanoseconds >(
+                    std::chrono::steady_clock::now().time_since_epoch()
+                ).count();
+                impl->capture->Record((uint64_t)(now - impl->start.load()), message);
+                if (messageReceivedDelegate != nullptr)
+                {
+                    messageReceivedDelegate(message);
+                }
+            }
+        );
+    }
+
+    void RecordingConnection::SetDisconnectedDelegate(DisconnectedDelegate disconnectedDelegate)
+    {
+        impl_->connection->SetDisconnectedDelegate(disconnectedDelegate);
+    }
+
+    bool RecordingConnection::Connect()
+    {
+        impl_->start = std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+        return impl_->connection->Connect();
+    }
+
+    bool RecordingConnection::Disconnect()
+    {
+        return impl_->connection->Disconnect();
+    }
+
+    void RecordingConnection::Send(const std::string& message)
+    {
+        impl_->connection->Send(message);
+    }
+}
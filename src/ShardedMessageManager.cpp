@@ -0,0 +1,816 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Hashing.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/ShardedMessageManager.hpp>
+
+namespace
+{
+    /**
+     * This stands for "no shard", such as for a channel joined while no
+     * shard is logged in.
+     */
+    constexpr size_t NO_SHARD = (size_t)-1;
+
+    /**
+     * This is what is known about a channel which has been joined.
+     */
+    struct Assignment
+    {
+        /**
+         * This is the hash of the channel name.
+         */
+        uint64_t hash = 0;
+
+        /**
+         * This is the shard which the channel is on, or NO_SHARD.
+         */
+        size_t shard = NO_SHARD;
+
+        /**
+         * This is the symbol of the channel name.
+         */
+        TwitchBot::SymbolTable::Symbol symbol = TwitchBot::SymbolTable::NO_SYMBOL;
+
+        /**
+         * This is the strand of the executor on which the messages of the
+         * channel are delivered, whichever shard they come from, if there
+         * is an executor.
+         */
+        TwitchBot::Executor::Strand strand;
+    };
+
+    /**
+     * These are the changes of channel membership to make on one shard,
+     * gathered while holding the lock and made after releasing it.
+     */
+    struct MembershipChanges
+    {
+        /**
+         * These are the channels to join.
+         */
+        std::vector< std::string > joins;
+
+        /**
+         * These are the channels to leave.
+         */
+        std::vector< std::string > leaves;
+    };
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a ShardedMessageManager
+     * instance.
+     */
+    struct ShardedMessageManager::Impl
+    {
+        // Types
+
+        /**
+         * These are the sets of shards from which a channel's shard may be
+         * picked.
+         */
+        enum class Eligible
+        {
+            /**
+             * Shards which are logged in, or are in the middle of logging
+             * in and expected to be soon.
+             */
+            Expected,
+
+            /**
+             * All shards.
+             */
+            Any
+        };
+
+        /**
+         * This holds a single shard and what's known about it.
+         */
+        struct Shard
+        {
+            /**
+             * This is the agent handling the shard's connection.
+             */
+            std::unique_ptr< MessageManager > manager;
+
+            /**
+             * This indicates whether or not the shard is logged in.
+             */
+            bool up = false;
+
+            /**
+             * This indicates whether or not the shard has been asked to log
+             * in, but hasn't yet.
+             */
+            bool connecting = false;
+
+            /**
+             * This is the strand of the executor on which the delegates are
+             * called for everything of the shard's other than the messages
+             * of channels, if there is an executor. Only the shard's worker
+             * thread uses it.
+             */
+            Executor::Strand serverStrand;
+
+            /**
+             * These are measurements of the shard's load.
+             */
+            std::atomic< uint64_t > messagesReceived{0};
+            uint64_t logIns = 0;
+            uint64_t drops = 0;
+            uint64_t channelsMovedIn = 0;
+        };
+
+        // Properties
+
+        /**
+         * This is the function to call for each message received.
+         */
+        MessageReceivedDelegate messageReceivedDelegate;
+
+        /**
+         * This is the function to call whenever a shard logs in.
+         */
+        ShardDelegate shardLoggedInDelegate;
+
+        /**
+         * This is the function to call whenever a shard logs out or drops.
+         */
+        ShardDelegate shardLoggedOutDelegate;
+
+        /**
+         * This is the pool of threads on which to call the delegates, if
+         * any. The shards are given none, so that the messages of a channel
+         * go through a single strand, even as the channel moves between
+         * shards.
+         */
+        std::shared_ptr< Executor > executor;
+
+        /**
+         * This is the number of delegate calls handed to the executor which
+         * haven't finished yet.
+         */
+        std::atomic< size_t > callsPending{0};
+
+        /**
+         * This is used to signal that all delegate calls handed to the
+         * executor have finished.
+         */
+        std::condition_variable callsDone;
+
+        /**
+         * This is used to synchronize access to the channel assignments and
+         * the state of the shards.
+         */
+        std::mutex mutex;
+
+        /**
+         * This is the table, shared by the shards, in which the names of
+         * channels are interned.
+         */
+        std::shared_ptr< SymbolTable > symbolTable;
+
+        /**
+         * These are the channels joined, by name, and by the symbol of the
+         * name, so that received messages can be checked against their
+         * channel's assignment without building its name.
+         */
+        std::unordered_map< std::string, Assignment > channels;
+        std::unordered_map< SymbolTable::Symbol, Assignment* > channelsBySymbol;
+
+        /**
+         * This indicates whether or not the shards are being logged out on
+         * purpose, in which case their channels aren't moved.
+         */
+        bool loggingOut = false;
+
+        /**
+         * This indicates whether or not the object is being destroyed, in
+         * which case the shards' delegates do nothing.
+         */
+        bool stopping = false;
+
+        /**
+         * These are the shards. They are declared last so that they're
+         * destroyed first, while the rest of the object is still intact.
+         */
+        std::vector< std::unique_ptr< Shard > > shards;
+
+        // Methods
+
+        /**
+         * This method picks the shard for a channel: the eligible shard with
+         * the highest hash of the channel and shard together.
+         *
+         * @param[in] hash This is the hash of the channel name.
+         *
+         * @param[in] eligible This is the set of shards to pick from.
+         *
+         * @return The index of the shard is returned, or NO_SHARD if no
+         * shard is eligible.
+         */
+        size_t PickShard(uint64_t hash, Eligible eligible) const
+        {
+            size_t best = NO_SHARD;
+            uint64_t bestScore = 0;
+            for (size_t i = 0; i < shards.size(); ++i)
+            {
+                const auto& shard = *shards[i];
+                if ((eligible == Eligible::Expected) && !shard.up && !shard.connecting)
+                {
+                    continue;
+                }
+                const auto score = Mix(hash ^ Mix(i + 1));
+                if ((best == NO_SHARD) || (score > bestScore))
+                {
+                    best = i;
+                    bestScore = score;
+                }
+            }
+            return best;
+        }
+
+        /**
+         * This method returns the shard through which to send to a channel.
+         * It must be called with the mutex held.
+         */
+        size_t RouteTo(const std::string& channel) const
+        {
+            const auto assignment = channels.find(channel);
+            if (
+                (assignment != channels.end())
+                && (assignment->second.shard != NO_SHARD)
+                && shards[assignment->second.shard]->up
+            )
+            {
+                return assignment->second.shard;
+            }
+
+            // Lines for a channel whose shard is still logging in wait on
+            // that shard, so they go out on the same connection as
+            // everything that follows.
+            const auto hash = (
+                (assignment == channels.end())
+                ? HashText(channel)
+                : assignment->second.hash
+            );
+            const auto shard = PickShard(hash, Eligible::Expected);
+            return (shard == NO_SHARD) ? PickShard(hash, Eligible::Any) : shard;
+        }
+
+        /**
+         * This method calls a delegate on the given strand of the executor,
+         * or right away if there's no executor.
+         *
+         * @param[in,out] strand This is the strand on which to call the
+         * delegate. It's made if it isn't valid yet.
+         *
+         * @param[in] call This calls the delegate.
+         */
+        void CallDelegate(Executor::Strand& strand, Executor::Task call)
+        {
+            if (executor == nullptr)
+            {
+                call();
+                return;
+            }
+            if (!strand.IsValid())
+            {
+                strand = executor->MakeStrand();
+            }
+            ++callsPending;
+            strand.Post(
+                [this, call = std::move(call)]
+                {
+                    call();
+                    if (--callsPending == 0)
+                    {
+                        std::lock_guard< decltype(mutex) > lock(mutex);
+                        callsDone.notify_all();
+                    }
+                }
+            );
+        }
+
+        /**
+         * This method is called from a shard's worker for each message it
+         * receives, and hands the message to the user.
+         *
+         * The messages of a channel are only handed over from the shard the
+         * channel is assigned to. When a channel moves, the new shard joins
+         * it while the old one may still be receiving its messages, so
+         * those from the old shard are dropped, rather than handed over
+         * twice and out of order with those of the new shard.
+         *
+         * @param[in] shard This is the index of the shard.
+         *
+         * @param[in] message This is the message received.
+         */
+        void ShardMessageReceived(size_t shard, const Message& message)
+        {
+            if (messageReceivedDelegate == nullptr)
+            {
+                return;
+            }
+            if (message.channelSymbol == SymbolTable::NO_SYMBOL)
+            {
+                CallDelegate(
+                    shards[shard]->serverStrand,
+                    [this, shard, message]{ messageReceivedDelegate(shard, message); }
+                );
+                return;
+            }
+            Executor::Strand strand;
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                const auto channel = channelsBySymbol.find(message.channelSymbol);
+                if (
+                    (channel == channelsBySymbol.end())
+                    || (channel->second->shard != shard)
+                )
+                {
+                    return;
+                }
+                if (executor != nullptr)
+                {
+                    if (!channel->second->strand.IsValid())
+                    {
+                        channel->second->strand = executor->MakeStrand();
+                    }
+                    strand = channel->second->strand;
+                }
+            }
+            CallDelegate(
+                strand,
+                [this, shard, message]{ messageReceivedDelegate(shard, message); }
+            );
+        }
+
+        /**
+         * This method makes the given changes of channel membership. It must
+         * be called without the mutex held, since the shards' workers may
+         * need it in order to make progress.
+         */
+        void Apply(const std::vector< MembershipChanges >& changes)
+        {
+            for (size_t i = 0; i < changes.size(); ++i)
+            {
+                for (const auto& channel: changes[i].leaves)
+                {
+                    shards[i]->manager->Leave(channel);
+                }
+                if (!changes[i].joins.empty())
+                {
+                    shards[i]->manager->Join(changes[i].joins);
+                }
+            }
+        }
+
+        /**
+         * This method is called from a shard's worker when the shard logs in.
+         * Channels which rank the shard first move onto it, and all of its
+         * channels are joined again on the new connection.
+         */
+        void ShardLoggedIn(size_t shard)
+        {
+            std::vector< MembershipChanges > changes(shards.size());
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                if (stopping)
+                {
+                    return;
+                }
+                shards[shard]->up = true;
+                shards[shard]->connecting = false;
+                ++shards[shard]->logIns;
+                for (auto& channel: channels)
+                {
+                    auto& assignment = channel.second;
+                    if (PickShard(assignment.hash, Eligible::Expected) != shard)
+                    {
+                        continue;
+                    }
+                    changes[shard].joins.push_back(channel.first);
+                    if (assignment.shard != shard)
+                    {
+                        if (assignment.shard != NO_SHARD)
+                        {
+                            ++shards[shard]->channelsMovedIn;
+                            if (shards[assignment.shard]->up)
+                            {
+                                changes[assignment.shard].leaves.push_back(channel.first);
+                            }
+                        }
+                        assignment.shard = shard;
+                    }
+                }
+            }
+            Apply(changes);
+            if (shardLoggedInDelegate != nullptr)
+            {
+                CallDelegate(
+                    shards[shard]->serverStrand,
+                    [this, shard]{ shardLoggedInDelegate(shard); }
+                );
+            }
+        }
+
+        /**
+         * This method is called from a shard's worker when the shard logs
+         * out, drops, or fails to connect. Unless logging out on purpose,
+         * the shard's channels move to the shards which rank next for them,
+         * and the shard leaves them, so that it doesn't join them again on
+         * its own when it reconnects. Those which rank it first come back
+         * when it logs in again.
+         */
+        void ShardLoggedOut(size_t shard)
+        {
+            std::vector< MembershipChanges > changes(shards.size());
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                if (stopping)
+                {
+                    return;
+                }
+                const auto wasUp = shards[shard]->up;
+                shards[shard]->up = false;
+                shards[shard]->connecting = false;
+                if (!loggingOut)
+                {
+                    if (wasUp)
+                    {
+                        ++shards[shard]->drops;
+                    }
+
+                    // Channels on this shard, and channels which were waiting
+                    // for it to log in, go to the next shard in their ranking.
+                    // If that shard is still logging in, they wait for it.
+                    for (auto& channel: channels)
+                    {
+                        auto& assignment = channel.second;
+                        if (
+                            (assignment.shard != shard)
+                            && (assignment.shard != NO_SHARD)
+                        )
+                        {
+                            continue;
+                        }
+                        if (assignment.shard == shard)
+                        {
+                            changes[shard].leaves.push_back(channel.first);
+                        }
+                        const auto next = PickShard(assignment.hash, Eligible::Expected);
+                        if ((next != NO_SHARD) && shards[next]->up)
+                        {
+                            if (assignment.shard == shard)
+                            {
+                                ++shards[next]->channelsMovedIn;
+                            }
+                            assignment.shard = next;
+                            changes[next].joins.push_back(channel.first);
+                        }
+                        else
+                        {
+                            assignment.shard = NO_SHARD;
+                        }
+                    }
+                }
+            }
+            Apply(changes);
+            if (shardLoggedOutDelegate != nullptr)
+            {
+                CallDelegate(
+                    shards[shard]->serverStrand,
+                    [this, shard]{ shardLoggedOutDelegate(shard); }
+                );
+            }
+        }
+    };
+
+    ShardedMessageManager::~ShardedMessageManager() noexcept
+    {
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            impl_->stopping = true;
+        }
+        impl_->shards.clear();
+        std::unique_lock< decltype(impl_->mutex) > lock(impl_->mutex);
+        impl_->callsDone.wait(
+            lock,
+            [this]{ return (impl_->callsPending == 0); }
+        );
+    }
+
+    ShardedMessageManager::ShardedMessageManager(size_t shardCount)
+        : impl_(new Impl())
+    {
+        if (shardCount == 0)
+        {
+            shardCount = 1;
+        }
+        impl_->symbolTable = std::make_shared< SymbolTable >();
+        for (size_t i = 0; i < shardCount; ++i)
+        {
+            std::unique_ptr< Impl::Shard > shard(new Impl::Shard());
+            shard->manager.reset(new MessageManager());
+            shard->manager->SetSymbolTable(impl_->symbolTable);
+            auto impl = impl_.get();
+            auto shardPointer = shard.get();
+            shard->manager->SetLoggedInDelegate(
+                [impl, i]{ impl->ShardLoggedIn(i); }
+            );
+            shard->manager->SetLoggedOutDelegate(
+                [impl, i]{ impl->ShardLoggedOut(i); }
+            );
+            shard->manager->SetMessageReceivedDelegate(
+                [impl, shardPointer, i](const Message& message)
+                {
+                    impl->ShardMessageReceived(i, message);
+                    ++shardPointer->messagesReceived;
+                }
+            );
+            impl_->shards.push_back(std::move(shard));
+        }
+    }
+
+    void ShardedMessageManager::SetConnectionFactory(MessageManager::ConnectionFactory connectionFactory)
+    {
+        for (auto& shard: impl_->shards)
+        {
+            shard->manager->SetConnectionFactory(connectionFactory);
+        }
+    }
+
+    void ShardedMessageManager::SetTimeKeeper(std::shared_ptr< TimeKeeper > timeKeeper)
+    {
+        for (auto& shard: impl_->shards)
+        {
+            shard->manager->SetTimeKeeper(timeKeeper);
+        }
+    }
+
+    void ShardedMessageManager::SetExecutor(std::shared_ptr< Executor > executor)
+    {
+        impl_->executor = executor;
+    }
+
+    void ShardedMessageManager::SetAutoReconnect(bool autoReconnect)
+    {
+        for (auto& shard: impl_->shards)
+        {
+            shard->manager->SetAutoReconnect(autoReconnect);
+        }
+    }
+
+    void ShardedMessageManager::SetWarmStandby(bool warmStandby)
+    {
+        for (auto& shard: impl_->shards)
+        {
+            shard->manager->SetWarmStandby(warmStandby);
+        }
+    }
+
+    void ShardedMessageManager::SetKeepAlive(double pingInterval, double pongTimeout)
+    {
+        for (auto& shard: impl_->shards)
+        {
+            shard->manager->SetKeepAlive(pingInterval, pongTimeout);
+        }
+    }
+
+    void ShardedMessageManager::SetSymbolTable(std::shared_ptr< SymbolTable > symbolTable)
+    {
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            impl_->symbolTable = symbolTable;
+            impl_->channelsBySymbol.clear();
+            for (auto& channel: impl_->channels)
+            {
+                channel.second.symbol = symbolTable->Intern(channel.first);
+                impl_->channelsBySymbol[channel.second.symbol] = &channel.second;
+            }
+        }
+        for (auto& shard: impl_->shards)
+        {
+            shard->manager->SetSymbolTable(symbolTable);
+        }
+    }
+
+    void ShardedMessageManager::SetChatLog(std::shared_ptr< ChatLog > chatLog)
+    {
+        for (auto& shard: impl_->shards)
+        {
+            shard->manager->SetChatLog(chatLog);
+        }
+    }
+
+    void ShardedMessageManager::SetChatIndex(std::shared_ptr< ChatIndex > chatIndex)
+    {
+        for (auto& shard: impl_->shards)
+        {
+            shard->manager->SetChatIndex(chatIndex);
+        }
+    }
+
+    void ShardedMessageManager::SetChatAnalytics(std::shared_ptr< ChatAnalytics > chatAnalytics)
+    {
+        for (auto& shard: impl_->shards)
+        {
+            shard->manager->SetChatAnalytics(chatAnalytics);
+        }
+    }
+
+    std::shared_ptr< SymbolTable > ShardedMessageManager::GetSymbolTable() const
+    {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        return impl_->symbolTable;
+    }
+
+    void ShardedMessageManager::SetMessageReceivedDelegate(MessageReceivedDelegate messageReceivedDelegate)
+    {
+        impl_->messageReceivedDelegate = messageReceivedDelegate;
+    }
+
+    void ShardedMessageManager::SetShardLoggedInDelegate(ShardDelegate shardLoggedInDelegate)
+    {
+        impl_->shardLoggedInDelegate = shardLoggedInDelegate;
+    }
+
+    void ShardedMessageManager::SetShardLoggedOutDelegate(ShardDelegate shardLoggedOutDelegate)
+    {
+        impl_->shardLoggedOutDelegate = shardLoggedOutDelegate;
+    }
+
+    void ShardedMessageManager::LogIn(
+        const std::string& nickname,
+        const std::string& token
+    )
+    {
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            impl_->loggingOut = false;
+            for (auto& shard: impl_->shards)
+            {
+                if (!shard->up)
+                {
+                    shard->connecting = true;
+                }
+            }
+        }
+        for (auto& shard: impl_->shards)
+        {
+            shard->manager->LogIn(nickname, token);
+        }
+    }
+
+    void ShardedMessageManager::LogOut(const std::string& farewell)
+    {
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            impl_->loggingOut = true;
+        }
+        for (auto& shard: impl_->shards)
+        {
+            shard->manager->LogOut(farewell);
+        }
+    }
+
+    void ShardedMessageManager::Join(const std::string& channelName)
+    {
+        const auto channel = FoldCase(channelName);
+        size_t shard;
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            if (impl_->channels.find(channel) != impl_->channels.end())
+            {
+                return;
+            }
+            // If the channel's shard is still logging in, the channel is
+            // joined once it has.
+            Assignment assignment;
+            assignment.hash = HashText(channel);
+            assignment.symbol = impl_->symbolTable->Intern(channel);
+            shard = impl_->PickShard(assignment.hash, Impl::Eligible::Expected);
+            if ((shard != NO_SHARD) && impl_->shards[shard]->up)
+            {
+                assignment.shard = shard;
+            }
+            else
+            {
+                shard = NO_SHARD;
+            }
+            auto& joined = impl_->channels[channel];
+            joined = assignment;
+            impl_->channelsBySymbol[joined.symbol] = &joined;
+        }
+        if (shard != NO_SHARD)
+        {
+            impl_->shards[shard]->manager->Join(channel);
+        }
+    }
+
+    void ShardedMessageManager::Leave(const std::string& channelName)
+    {
+        const auto channel = FoldCase(channelName);
+        size_t shard = NO_SHARD;
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            const auto assignment = impl_->channels.find(channel);
+            if (assignment == impl_->channels.end())
+            {
+                return;
+            }
+            if (
+                (assignment->second.shard != NO_SHARD)
+                && impl_->shards[assignment->second.shard]->up
+            )
+            {
+                shard = assignment->second.shard;
+            }
+            impl_->channelsBySymbol.erase(assignment->second.symbol);
+            impl_->channels.erase(assignment);
+        }
+        if (shard != NO_SHARD)
+        {
+            impl_->shards[shard]->manager->Leave(channel);
+        }
+    }
+
+    void ShardedMessageManager::SendMessage(const std::string& channelName, const std::string& text)
+    {
+        const auto channel = FoldCase(channelName);
+        size_t shard;
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            shard = impl_->RouteTo(channel);
+        }
+        impl_->shards[shard]->manager->SendMessage(channel, text);
+    }
+
+    void ShardedMessageManager::SendModeration(const std::string& channelName, const std::string& command)
+    {
+        const auto channel = FoldCase(channelName);
+        size_t shard;
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            shard = impl_->RouteTo(channel);
+        }
+        impl_->shards[shard]->manager->SendModeration(channel, command);
+    }
+
+    bool ShardedMessageManager::GetShard(const std::string& channelName, size_t& shard)
+    {
+        const auto channel = FoldCase(channelName);
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        const auto assignment = impl_->channels.find(channel);
+        if (
+            (assignment == impl_->channels.end())
+            || (assignment->second.shard == NO_SHARD)
+            || !impl_->shards[assignment->second.shard]->up
+        )
+        {
+            return false;
+        }
+        shard = assignment->second.shard;
+        return true;
+    }
+
+    size_t ShardedMessageManager::GetShardCount() const
+    {
+        return impl_->shards.size();
+    }
+
+    std::vector< ShardedMessageManager::ShardStats > ShardedMessageManager::GetStats()
+    {
+        std::vector< ShardStats > stats(impl_->shards.size());
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            for (size_t i = 0; i < impl_->shards.size(); ++i)
+            {
+                const auto& shard = *impl_->shards[i];
+                stats[i].loggedIn = shard.up;
+                stats[i].messagesReceived = shard.messagesReceived.load();
+                stats[i].logIns = shard.logIns;
+                stats[i].drops = shard.drops;
+                stats[i].channelsMovedIn = shard.channelsMovedIn;
+            }
+            for (const auto& channel: impl_->channels)
+            {
+                if (channel.second.shard != NO_SHARD)
+                {
+                    ++stats[channel.second.shard].channels;
+                }
+            }
+        }
+        for (size_t i = 0; i < impl_->shards.size(); ++i)
+        {
+            stats[i].outbound = impl_->shards[i]->manager->GetOutboundStats();
+            stats[i].manager = impl_->shards[i]->manager->GetStats();
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,228 @@
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SimulatedTimeKeeper.hpp>
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a SimulatedTimeKeeper
+     * instance.
+     */
+    struct SimulatedTimeKeeper::Impl
+    {
+        // Properties
+
+        /**
+         * This is the current time, in nanoseconds.
+         */
+        std::atomic< int64_t > time{0};
+
+        /**
+         * This is held while the time is moved, so that only one thread
+         * fires timers at once.
+         */
+        std::mutex moving;
+
+        /**
+         * This is used to synchronize access to the timers.
+         */
+        mutable std::mutex timersMutex;
+
+        /**
+         * These are the timers set, by deadline and then by identifier, so
+         * that those with the same deadline fire in the order they were
+         * set, and the deadline of each timer, by identifier.
+         */
+        std::map< std::pair< int64_t, TimerId >, Callback > timers;
+        std::unordered_map< TimerId, int64_t > deadlines;
+
+        /**
+         * This is the identifier of the next timer set.
+         */
+        TimerId nextTimerId = 1;
+
+        /**
+         * This is used to synchronize access to the functions called when
+         * the time changes. It's held while they're called, so that once
+         * one is unregistered, it's no longer being called.
+         */
+        std::mutex delegatesMutex;
+
+        /**
+         * These are the functions called when the time changes, by token,
+         * and the token of the next one registered.
+         */
+        std::map< uint64_t, TimeChangedDelegate > delegates;
+        uint64_t nextDelegateToken = 1;
+
+        // Methods
+
+        /**
+         * This method calls every function registered to be called when the
+         * time changes.
+         */
+        void NotifyTimeChanged()
+        {
+            std::lock_guard< decltype(delegatesMutex) > lock(delegatesMutex);
+            for (const auto& delegate: delegates)
+            {
+                delegate.second();
+            }
+        }
+
+        /**
+         * This method takes the earliest timer due by the given time, if
+         * any.
+         *
+         * @return an indication of whether or not there was a timer due is
+         * returned.
+         */
+        bool TakeDueTimer(
+            int64_t target,
+            int64_t& deadline,
+            Callback& callback
+        )
+        {
+            std::lock_guard< decltype(timersMutex) > lock(timersMutex);
+            if (
+                timers.empty()
+                || (timers.begin()->first.first > target)
+            )
+            {
+                return false;
+            }
+            const auto timer = timers.begin();
+            deadline = timer->first.first;
+            callback = std::move(timer->second);
+            deadlines.erase(timer->first.second);
+            timers.erase(timer);
+            return true;
+        }
+
+        /**
+         * This method sets the time, firing the timers due by then in order
+         * of deadline first. The moving mutex must be held.
+         */
+        void MoveTo(int64_t target)
+        {
+            int64_t deadline;
+            Callback callback;
+            while (TakeDueTimer(target, deadline, callback))
+            {
+                if (deadline > time.load())
+                {
+                    time = deadline;
+                    NotifyTimeChanged();
+                }
+                callback();
+            }
+            time = target;
+            NotifyTimeChanged();
+        }
+    };
+
+    SimulatedTimeKeeper::~SimulatedTimeKeeper() noexcept = default;
+
+    SimulatedTimeKeeper::SimulatedTimeKeeper()
+        : impl_(new Impl())
+    {
+    }
+
+    void SimulatedTimeKeeper::SetCurrentTime(double time)
+    {
+        SetCurrentTimeNanoseconds((int64_t)llround(time * 1e9));
+    }
+
+    void SimulatedTimeKeeper::Advance(double seconds)
+    {
+        AdvanceNanoseconds((int64_t)llround(seconds * 1e9));
+    }
+
+    void SimulatedTimeKeeper::SetCurrentTimeNanoseconds(int64_t time)
+    {
+        std::lock_guard< decltype(impl_->moving) > lock(impl_->moving);
+        impl_->MoveTo(time);
+    }
+
+    void SimulatedTimeKeeper::AdvanceNanoseconds(int64_t nanoseconds)
+    {
+        std::lock_guard< decltype(impl_->moving) > lock(impl_->moving);
+        impl_->MoveTo(impl_->time.load() + nanoseconds);
+    }
+
+    bool SimulatedTimeKeeper::AdvanceToNextTimer()
+    {
+        std::lock_guard< decltype(impl_->moving) > lock(impl_->moving);
+        int64_t deadline;
+        {
+            std::lock_guard< decltype(impl_->timersMutex) > timersLock(impl_->timersMutex);
+            if (impl_->timers.empty())
+            {
+                return false;
+            }
+            deadline = impl_->timers.begin()->first.first;
+        }
+        impl_->MoveTo(std::max(deadline, impl_->time.load()));
+        return true;
+    }
+
+    auto SimulatedTimeKeeper::Schedule(
+        int64_t deadline,
+        Callback callback
+    ) -> TimerId
+    {
+        std::lock_guard< decltype(impl_->timersMutex) > lock(impl_->timersMutex);
+        const auto id = impl_->nextTimerId++;
+        impl_->timers[std::make_pair(deadline, id)] = std::move(callback);
+        impl_->deadlines[id] = deadline;
+        return id;
+    }
+
+    bool SimulatedTimeKeeper::Cancel(TimerId id)
+    {
+        std::lock_guard< decltype(impl_->timersMutex) > lock(impl_->timersMutex);
+        const auto deadline = impl_->deadlines.find(id);
+        if (deadline == impl_->deadlines.end())
+        {
+            return false;
+        }
+        impl_->timers.erase(std::make_pair(deadline->second, id));
+        impl_->deadlines.erase(deadline);
+        return true;
+    }
+
+    size_t SimulatedTimeKeeper::GetTimerCount() const
+    {
+        std::lock_guard< decltype(impl_->timersMutex) > lock(impl_->timersMutex);
+        return impl_->timers.size();
+    }
+
+    double SimulatedTimeKeeper::GetCurrentTime()
+    {
+        return (double)impl_->time.load() / 1e9;
+    }
+
+    int64_t SimulatedTimeKeeper::GetCurrentTimeNanoseconds()
+    {
+        return impl_->time;
+    }
+
+    uint64_t SimulatedTimeKeeper::AddTimeChangedDelegate(TimeChangedDelegate timeChangedDelegate)
+    {
+        std::lock_guard< decltype(impl_->delegatesMutex) > lock(impl_->delegatesMutex);
+        const auto token = impl_->nextDelegateToken++;
+        impl_->delegates[token] = std::move(timeChangedDelegate);
+        return token;
+    }
+
+    void SimulatedTimeKeeper::RemoveTimeChangedDelegate(uint64_t token)
+    {
+        std::lock_guard< decltype(impl_->delegatesMutex) > lock(impl_->delegatesMutex);
+        (void)impl_->delegates.erase(token);
+    }
+}
@@ -0,0 +1,579 @@
+#include <atomic>
+#include <errno.h>
+#include <mutex>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SocketConnection.hpp>
+
+namespace
+{
+    /**
+     * This is the size of the buffer into which received text is read.
+     */
+    constexpr size_t RECEIVE_BUFFER_SIZE = 65536;
+
+    /**
+     * This is the most reads done for one readiness event, so that a busy
+     * socket can't keep queued sends waiting forever.
+     */
+    constexpr int MAX_READS_PER_EVENT = 16;
+
+    /**
+     * This is the most pieces of text handed to one gather write.
+     */
+    constexpr size_t MAX_WRITE_PIECES = 64;
+
+    /**
+     * This is the longest to wait for the server to accept a connection.
+     */
+    constexpr int CONNECT_TIMEOUT_MILLISECONDS = 5000;
+
+    /**
+     * This is the longest to wait, when disconnecting, for text still
+     * queued to be written.
+     */
+    constexpr int FLUSH_TIMEOUT_MILLISECONDS = 1000;
+
+    /**
+     * This opens a non-blocking socket connected to the given server.
+     *
+     * @return The socket is returned, or -1 if no connection could be made.
+     */
+    int OpenSocket(const std::string& host, uint16_t port)
+    {
+        struct addrinfo hints;
+        (void)memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* addresses;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+        {
+            return -1;
+        }
+        int sock = -1;
+        for (auto address = addresses; address != nullptr; address = address->ai_next)
+        {
+            sock = socket(
+                address->ai_family,
+                SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                address->ai_protocol
+            );
+            if (sock < 0)
+            {
+                continue;
+            }
+            if (connect(sock, address->ai_addr, address->ai_addrlen) == 0)
+            {
+                break;
+            }
+            if (errno == EINPROGRESS)
+            {
+                struct pollfd pollSocket;
+                pollSocket.fd = sock;
+                pollSocket.events = POLLOUT;
+                int error = 0;
+                socklen_t errorLength = sizeof(error);
+                if (
+                    (poll(&pollSocket, 1, CONNECT_TIMEOUT_MILLISECONDS) == 1)
+                    && (getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &errorLength) == 0)
+                    && (error == 0)
+                )
+                {
+                    break;
+                }
+            }
+            (void)close(sock);
+            sock = -1;
+        }
+        freeaddrinfo(addresses);
+        if (sock >= 0)
+        {
+            // Lines are already coalesced before they're written, so there's
+            // nothing to gain from Nagle's algorithm holding them back.
+            int noDelay = 1;
+            (void)setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        }
+        return sock;
+    }
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a SocketConnection instance.
+     */
+    struct SocketConnection::Impl
+    {
+        // Properties
+
+        /**
+         * This is the name or address of the server.
+         */
+        std::string host;
+
+        /**
+         * This is the TCP port of the server.
+         */
+        uint16_t port = 0;
+
+        /**
+         * This is the function to call whenever text is received.
+         */
+        MessageReceivedDelegate messageReceivedDelegate;
+
+        /**
+         * This is the function to call when the server closes its end of
+         * the connection.
+         */
+        DisconnectedDelegate disconnectedDelegate;
+
+        /**
+         * This is the connected socket, or -1 if not connected.
+         */
+        int sock = -1;
+
+        /**
+         * This is the epoll instance used to wait on the socket and the wake
+         * event.
+         */
+        int epoll = -1;
+
+        /**
+         * This is the event used to wake the thread when text is queued or
+         * the connection is being closed.
+         */
+        int wake = -1;
+
+        /**
+         * This is the thread servicing the socket.
+         */
+        std::thread loop;
+
+        /**
+         * This is set to tell the thread to flush what's queued and stop.
+         */
+        std::atomic< bool > stop{false};
+
+        /**
+         * This synchronizes access to the queue of text to send, and to the
+         * open flag.
+         */
+        std::mutex mutex;
+
+        /**
+         * This indicates whether or not the thread is servicing the socket,
+         * so that text may be queued and the thread woken.
+         */
+        bool open = false;
+
+        /**
+         * This is the text queued by Send, waiting for the thread to take
+         * it.
+         */
+        std::vector< std::string > pending;
+
+        /**
+         * These are measurements of the traffic.
+         */
+        std::atomic< uint64_t > bytesSent{0};
+        std::atomic< uint64_t > bytesReceived{0};
+        std::atomic< uint64_t > sends{0};
+        std::atomic< uint64_t > writes{0};
+        std::atomic< uint64_t > reads{0};
+
+        // Methods
+
+        /**
+         * This method wakes the thread. It must be called with the mutex
+         * held, while the connection is open.
+         */
+        void Wake()
+        {
+            const uint64_t one = 1;
+            (void)write(wake, &one, sizeof(one));
+        }
+
+        /**
+         * This method writes as much of the given text as the socket will
+         * take without blocking.
+         *
+         * @param[in,out] writing This is the text to write. Pieces fully
+         * written are removed.
+         *
+         * @param[in,out] offset This is how much of the first piece was
+         * already written.
+         *
+         * @return an indication of whether or not the connection is still
+         * usable is returned.
+         */
+        bool Flush(
+            std::vector< std::string >& writing,
+            size_t& offset
+        )
+        {
+            size_t first = 0;
+            struct iovec pieces[MAX_WRITE_PIECES];
+            while (first < writing.size())
+            {
+                size_t count = 0;
+                for (
+                    size_t i = first;
+                    (i < writing.size()) && (count < MAX_WRITE_PIECES);
+                    ++i, ++count
+                )
+                {
+                    const auto skip = (i == first) ? offset : 0;
+                    pieces[count].iov_base = (void*)(writing[i].data() + skip);
+                    pieces[count].iov_len = writing[i].length() - skip;
+                }
+                struct msghdr message;
+                (void)memset(&message, 0, sizeof(message));
+                message.msg_iov = pieces;
+                message.msg_iovlen = count;
+                const auto written = sendmsg(sock, &message, MSG_NOSIGNAL);
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    writing.erase(writing.begin(), writing.begin() + first);
+                    return ((errno == EAGAIN) || (errno == EWOULDBLOCK));
+                }
+                ++writes;
+                bytesSent += (uint64_t)written;
+                auto remaining = (size_t)written;
+                while (remaining > 0)
+                {
+                    const auto left = writing[first].length() - offset;
+                    if (remaining < left)
+                    {
+                        offset += remaining;
+                        break;
+                    }
+                    remaining -= left;
+                    offset = 0;
+                    ++first;
+                }
+            }
+            writing.clear();
+            return true;
+        }
+
+        /**
+         * This method reads whatever the socket has received, handing it to
+         * the message received delegate.
+         *
+         * @return an indication of whether or not the connection is still
+         * open is returned.
+         */
+        bool Receive(
+            const MessageReceivedDelegate& messageReceived,
+            std::vector< char >& buffer,
+            std::string& received
+        )
+        {
+            for (int i = 0; i < MAX_READS_PER_EVENT; ++i)
+            {
+                const auto amount = recv(sock, buffer.data(), buffer.size(), 0);
+                if (amount > 0)
+                {
+                    ++reads;
+                    bytesReceived += (uint64_t)amount;
+                    if (messageReceived != nullptr)
+                    {
+                        received.assign(buffer.data(), (size_t)amount);
+                        messageReceived(received);
+                    }
+                    if ((size_t)amount < buffer.size())
+                    {
+                        return true;
+                    }
+                }
+                else if (amount == 0)
+                {
+                    return false;
+                }
+                else if (errno == EINTR)
+                {
+                    continue;
+                }
+                else
+                {
+                    return ((errno == EAGAIN) || (errno == EWOULDBLOCK));
+                }
+            }
+            return true;
+        }
+
+        /**
+         * This method is the body of the thread servicing the socket.
+         */
+        void Run(
+            MessageReceivedDelegate messageReceived,
+            DisconnectedDelegate disconnected
+        )
+        {
+            std::vector< char > buffer(RECEIVE_BUFFER_SIZE);
+            std::string received;
+            std::vector< std::string > writing;
+            std::vector< std::string > taken;
+            size_t offset = 0;
+            bool watchingWrites = false;
+            bool closedByServer = false;
+            struct epoll_event events[2];
+            while (!stop.load())
+            {
+                const auto count = epoll_wait(epoll, events, 2, -1);
+                if (count < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    closedByServer = true;
+                    break;
+                }
+                for (int i = 0; i < count; ++i)
+                {
+                    if (events[i].data.fd == wake)
+                    {
+                        uint64_t value;
+                        (void)read(wake, &value, sizeof(value));
+                    }
+                    else if ((events[i].events & ~EPOLLOUT) != 0)
+                    {
+                        if (!Receive(messageReceived, buffer, received))
+                        {
+                            closedByServer = true;
+                        }
+                    }
+                }
+                if (closedByServer)
+                {
+                    break;
+                }
+
+                // Take everything queued so far, and write it all at once.
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    taken.swap(pending);
+                }
+                for (auto& text: taken)
+                {
+                    writing.push_back(std::move(text));
+                }
+                taken.clear();
+                if (!Flush(writing, offset))
+                {
+                    closedByServer = true;
+                    break;
+                }
+
+                // Only ask to hear about the socket becoming writable while
+                // there's text it wouldn't take.
+                const auto wantWrites = !writing.empty();
+                if (wantWrites != watchingWrites)
+                {
+                    struct epoll_event event;
+                    event.events = EPOLLIN | EPOLLRDHUP | (wantWrites ? (uint32_t)EPOLLOUT : 0);
+                    event.data.fd = sock;
+                    (void)epoll_ctl(epoll, EPOLL_CTL_MOD, sock, &event);
+                    watchingWrites = wantWrites;
+                }
+            }
+
+            // When asked to stop, give whatever is still queued a little
+            // time to go out, so that a farewell such as QUIT isn't lost.
+            if (!closedByServer)
+            {
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    taken.swap(pending);
+                }
+                for (auto& text: taken)
+                {
+                    writing.push_back(std::move(text));
+                }
+                struct pollfd pollSocket;
+                pollSocket.fd = sock;
+                pollSocket.events = POLLOUT;
+                while (
+                    Flush(writing, offset)
+                    && !writing.empty()
+                    && (poll(&pollSocket, 1, FLUSH_TIMEOUT_MILLISECONDS) == 1)
+                )
+                {
+                }
+            }
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                open = false;
+                pending.clear();
+                (void)close(sock);
+                (void)close(epoll);
+                (void)close(wake);
+                sock = epoll = wake = -1;
+            }
+            if (closedByServer && (disconnected != nullptr))
+            {
+                disconnected();
+            }
+        }
+
+        /**
+         * This method waits for the thread to finish, unless called from the
+         * thread itself, such as from one of the delegates.
+         */
+        void Join()
+        {
+            if (!loop.joinable())
+            {
+                return;
+            }
+            if (loop.get_id() == std::this_thread::get_id())
+            {
+                loop.detach();
+            }
+            else
+            {
+                loop.join();
+            }
+        }
+    };
+
+    SocketConnection::~SocketConnection() noexcept
+    {
+        (void)Disconnect();
+        impl_->Join();
+    }
+
+    SocketConnection::SocketConnection(
+        const std::string& host,
+        uint16_t port
+    )
+        : impl_(std::make_shared< Impl >())
+    {
+        impl_->host = host;
+        impl_->port = port;
+    }
+
+    SocketConnection::Stats SocketConnection::GetStats() const
+    {
+        Stats stats;
+        stats.bytesSent = impl_->bytesSent.load();
+        stats.bytesReceived = impl_->bytesReceived.load();
+        stats.sends = impl_->sends.load();
+        stats.writes = impl_->writes.load();
+        stats.reads = impl_->reads.load();
+        return stats;
+    }
+
+    void SocketConnection::SetMessageReceivedDelegate(MessageReceivedDelegate messageReceivedDelegate)
+    {
+        impl_->messageReceivedDelegate = messageReceivedDelegate;
+    }
+
+    void SocketConnection::SetDisconnectedDelegate(DisconnectedDelegate disconnectedDelegate)
+    {
+        impl_->disconnectedDelegate = disconnectedDelegate;
+    }
+
+    bool SocketConnection::Connect()
+    {
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            if (impl_->open)
+            {
+                return false;
+            }
+        }
+        impl_->Join();
+        const auto sock = OpenSocket(impl_->host, impl_->port);
+        if (sock < 0)
+        {
+            return false;
+        }
+        const auto epoll = epoll_create1(EPOLL_CLOEXEC);
+        const auto wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        struct epoll_event socketEvent;
+        socketEvent.events = EPOLLIN | EPOLLRDHUP;
+        socketEvent.data.fd = sock;
+        struct epoll_event wakeEvent;
+        wakeEvent.events = EPOLLIN;
+        wakeEvent.data.fd = wake;
+        if (
+            (epoll < 0)
+            || (wake < 0)
+            || (epoll_ctl(epoll, EPOLL_CTL_ADD, sock, &socketEvent) != 0)
+            || (epoll_ctl(epoll, EPOLL_CTL_ADD, wake, &wakeEvent) != 0)
+        )
+        {
+            (void)close(sock);
+            if (epoll >= 0)
+            {
+                (void)close(epoll);
+            }
+            if (wake >= 0)
+            {
+                (void)close(wake);
+            }
+            return false;
+        }
+        impl_->sock = sock;
+        impl_->epoll = epoll;
+        impl_->wake = wake;
+        impl_->stop = false;
+        impl_->open = true;
+        impl_->loop = std::thread(
+            &Impl::Run,
+            impl_,
+            impl_->messageReceivedDelegate,
+            impl_->disconnectedDelegate
+        );
+        return true;
+    }
+
+    bool SocketConnection::Disconnect()
+    {
+        {
+            std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+            if (!impl_->open)
+            {
+                return false;
+            }
+            impl_->stop = true;
+            impl_->Wake();
+        }
+        impl_->Join();
+        return true;
+    }
+
+    void SocketConnection::Send(const std::string& message)
+    {
+        std::lock_guard< decltype(impl_->mutex) > lock(impl_->mutex);
+        if (!impl_->open)
+        {
+            return;
+        }
+        ++impl_->sends;
+        impl_->pending.push_back(message);
+
+        // The thread only needs waking for the first piece queued; it takes
+        // everything queued at once.
+        if (impl_->pending.size() == 1)
+        {
+            impl_->Wake();
+        }
+    }
+}
@@ -0,0 +1,629 @@
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Hashing.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SpamDetector.hpp>
+
+namespace
+{
+    /**
+     * This is the number of lines kept for each user in each channel.
+     */
+    constexpr size_t RECENT_LINES = 6;
+
+    /**
+     * This is the number of users kept in each set of the table of users.
+     * A user may be kept in any slot of the one set picked by its hash.
+     */
+    constexpr size_t USER_WAYS = 4;
+
+    /**
+     * These are the number of bits set in the filter of which users sent
+     * which lines, and the number of counters counted in, for each line.
+     * They're all in one block, so that each line costs one cache miss in
+     * each filter rather than one for each bit or counter.
+     */
+    constexpr size_t PAIR_FILTER_HASHES = 3;
+    constexpr size_t CROWD_COUNTER_HASHES = 2;
+
+    /**
+     * These are the number of words, in each half, of a block of the filter
+     * of which users sent which lines, and the number of counters in a
+     * block of the counts of users who sent each line.
+     */
+    constexpr size_t PAIR_BLOCK_WORDS = 4;
+    constexpr size_t CROWD_BLOCK_COUNTERS = 16;
+
+    /**
+     * This is the fewest entries in each of the detector's tables, however
+     * small the memory budget.
+     */
+    constexpr size_t MIN_TABLE_ENTRIES = 1024;
+
+    /**
+     * These are the starting value and the multiplier of the hash of
+     * normalized text.
+     */
+    constexpr uint64_t FINGERPRINT_SEED = 0x84222325CBF29CE4;
+    constexpr uint64_t FINGERPRINT_MULTIPLIER = 0x9E3779B97F4A7C15;
+
+    /**
+     * This is how much normalized text is gathered before hashing it. It's
+     * a multiple of the size of a word, and big enough for most chat lines.
+     */
+    constexpr size_t FINGERPRINT_BUFFER_SIZE = 512;
+
+    /**
+     * This is how many times a second times are counted in, within the
+     * detector.
+     */
+    constexpr double TICKS_PER_SECOND = 1000.0;
+
+    /**
+     * This maps each ASCII character to what it becomes in normalized text:
+     * letters are folded to lower case, digits are kept, and everything
+     * else becomes 0, meaning it's left out.
+     */
+    struct NormalizedCharacters
+    {
+        uint8_t table[128];
+
+        constexpr NormalizedCharacters()
+            : table()
+        {
+            for (int c = 0; c < 128; ++c)
+            {
+                if ((c >= 'A') && (c <= 'Z'))
+                {
+                    table[c] = (uint8_t)(c + ('a' - 'A'));
+                }
+                else if (
+                    ((c >= 'a') && (c <= 'z'))
+                    || ((c >= '0') && (c <= '9'))
+                )
+                {
+                    table[c] = (uint8_t)c;
+                }
+            }
+        }
+    };
+    constexpr NormalizedCharacters NORMALIZED_CHARACTERS;
+
+    /**
+     * This adds the given bytes to the given hash of normalized text, a
+     * word at a time. The number of bytes must be a multiple of the size of
+     * a word.
+     */
+    inline uint64_t HashWords(uint64_t hash, const uint8_t* bytes, size_t length)
+    {
+        for (size_t i = 0; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            (void)memcpy(&word, bytes + i, sizeof(word));
+            hash = (hash ^ word) * FINGERPRINT_MULTIPLIER;
+            hash ^= hash >> 29;
+        }
+        return hash;
+    }
+
+    /**
+     * This returns the length of the invisible character at the given
+     * position of the given text, or 0 if there isn't one there. These are
+     * the zero-width space, non-joiner and joiner, the word joiner, the
+     * byte order mark, and the tag characters (U+E0000 to U+E007F), one of
+     * which some clients add to get around Twitch's own duplicate check.
+     */
+    inline size_t InvisibleCharacterLength(std::string_view text, size_t i)
+    {
+        const auto remaining = text.length() - i;
+        const auto c = (const uint8_t*)text.data() + i;
+        if (remaining >= 3)
+        {
+            if (
+                (
+                    (c[0] == 0xE2)
+                    && (
+                        ((c[1] == 0x80) && (c[2] >= 0x8B) && (c[2] <= 0x8D))
+                        || ((c[1] == 0x81) && (c[2] == 0xA0))
+                    )
+                )
+                || ((c[0] == 0xEF) && (c[1] == 0xBB) && (c[2] == 0xBF))
+            )
+            {
+                return 3;
+            }
+        }
+        if (
+            (remaining >= 4)
+            && (c[0] == 0xF3)
+            && (c[1] == 0xA0)
+            && ((c[2] == 0x80) || (c[2] == 0x81))
+        )
+        {
+            return 4;
+        }
+        return 0;
+    }
+
+    /**
+     * This returns the largest power of two no greater than the given
+     * number, or MIN_TABLE_ENTRIES if that's larger.
+     */
+    size_t TableSize(size_t limit)
+    {
+        size_t size = MIN_TABLE_ENTRIES;
+        while (size * 2 <= limit)
+        {
+            size *= 2;
+        }
+        return size;
+    }
+
+    /**
+     * This is one block of the filter of which users sent which lines,
+     * with the bits of both halves of the window side by side in one cache
+     * line.
+     */
+    struct alignas(64) PairBlock
+    {
+        uint64_t halves[2][PAIR_BLOCK_WORDS] = {};
+    };
+
+    /**
+     * This is one block of the counts of users who sent each line, with
+     * the counts for both halves of the window side by side in one cache
+     * line.
+     */
+    struct alignas(64) CrowdBlock
+    {
+        uint16_t counters[CROWD_BLOCK_COUNTERS][2] = {};
+    };
+
+    /**
+     * This holds the last few lines one user sent to one channel. It fills
+     * a cache line.
+     */
+    struct alignas(64) UserHistory
+    {
+        /**
+         * This is the hash of the channel and the user, or 0 if the slot is
+         * free.
+         */
+        uint64_t key = 0;
+
+        /**
+         * These are the fingerprints of the lines, folded to 32 bits, and
+         * when they were sent, in ticks, oldest first from next.
+         */
+        uint32_t fingerprints[RECENT_LINES] = {};
+        uint32_t times[RECENT_LINES] = {};
+
+        /**
+         * This is the number of lines kept, and the slot of the next one.
+         */
+        uint8_t count = 0;
+        uint8_t next = 0;
+
+        /**
+         * This returns when the user last sent a line, in ticks.
+         */
+        uint32_t GetLastTime() const
+        {
+            return times[(next + RECENT_LINES - 1) % RECENT_LINES];
+        }
+    };
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a SpamDetector instance.
+     */
+    struct SpamDetector::Impl
+    {
+        // Properties
+
+        /**
+         * These are the thresholds of the detector.
+         */
+        Settings settings;
+
+        /**
+         * These are the windows, in ticks.
+         */
+        uint32_t windowTicks = 0;
+        uint32_t floodWindowTicks = 0;
+
+        /**
+         * This is the table of users, in sets of USER_WAYS slots, and a
+         * mask of the number of sets.
+         */
+        std::vector< UserHistory > users;
+        size_t userSetMask = 0;
+
+        /**
+         * This is the filter of which users sent which lines to which
+         * channels, and a mask of the number of blocks in it.
+         */
+        std::vector< PairBlock > seenPairs;
+        size_t seenPairsMask = 0;
+
+        /**
+         * These are the counts of users who sent each line to each channel,
+         * and a mask of the number of blocks in them.
+         */
+        std::vector< CrowdBlock > crowdCounts;
+        size_t crowdCountsMask = 0;
+
+        /**
+         * This is which half of the filters is being filled, and when it
+         * started being filled, in seconds.
+         */
+        size_t currentHalf = 0;
+        double halfStart = 0.0;
+
+        /**
+         * This is the time from which ticks are counted, in seconds, once
+         * the first line is checked.
+         */
+        bool started = false;
+        double epoch = 0.0;
+
+        /**
+         * These are the counts of lines checked and taken for spam.
+         */
+        Stats stats;
+
+        // Methods
+
+        /**
+         * This method clears the older half of the filters, and starts
+         * filling it, whenever half the window has passed.
+         */
+        void Age(double now)
+        {
+            const auto halfWindow = settings.window / 2.0;
+            if (now - halfStart < halfWindow)
+            {
+                return;
+            }
+            const auto stale = (now - halfStart >= settings.window);
+            currentHalf = 1 - currentHalf;
+            halfStart = now;
+            if (stale)
+            {
+                std::fill(seenPairs.begin(), seenPairs.end(), PairBlock());
+                std::fill(crowdCounts.begin(), crowdCounts.end(), CrowdBlock());
+                return;
+            }
+            for (auto& block: seenPairs)
+            {
+                std::fill(
+                    std::begin(block.halves[currentHalf]),
+                    std::end(block.halves[currentHalf]),
+                    0
+                );
+            }
+            for (auto& block: crowdCounts)
+            {
+                for (auto& counter: block.counters)
+                {
+                    counter[currentHalf] = 0;
+                }
+            }
+        }
+
+        /**
+         * This method returns the slot of the table of users for the given
+         * key, taking over the slot of the user quiet longest in its set if
+         * the user isn't there yet.
+         */
+        UserHistory& FindUser(uint64_t key, uint32_t now)
+        {
+            const auto set = &users[(key & userSetMask) * USER_WAYS];
+            UserHistory* victim = nullptr;
+            for (size_t way = 0; way < USER_WAYS; ++way)
+            {
+                auto& slot = set[way];
+                if (slot.key == key)
+                {
+                    return slot;
+                }
+                if (
+                    (victim == nullptr)
+                    || (slot.key == 0)
+                    || (
+                        (victim->key != 0)
+                        && (now - slot.GetLastTime() > now - victim->GetLastTime())
+                    )
+                )
+                {
+                    victim = &slot;
+                }
+            }
+            *victim = UserHistory();
+            victim->key = key;
+            return *victim;
+        }
+
+        /**
+         * This method checks whether every bit for the given key is set in
+         * each half of the filter of users and lines, and sets them in the
+         * half being filled.
+         *
+         * @return an indication of whether or not the key was in either
+         * half already is returned.
+         */
+        bool TestAndAddPair(uint64_t key)
+        {
+            auto& block = seenPairs[key & seenPairsMask];
+            uint64_t masks[PAIR_BLOCK_WORDS] = {};
+            for (size_t i = 0; i < PAIR_FILTER_HASHES; ++i)
+            {
+                const auto bit = (key >> (32 + 8 * i)) % (PAIR_BLOCK_WORDS * 64);
+                masks[bit / 64] |= ((uint64_t)1 << (bit % 64));
+            }
+            bool inCurrentHalf = true;
+            bool inOlderHalf = true;
+            for (size_t word = 0; word < PAIR_BLOCK_WORDS; ++word)
+            {
+                auto& current = block.halves[currentHalf][word];
+                inCurrentHalf &= ((current & masks[word]) == masks[word]);
+                inOlderHalf &= ((block.halves[1 - currentHalf][word] & masks[word]) == masks[word]);
+                current |= masks[word];
+            }
+            return (inCurrentHalf || inOlderHalf);
+        }
+
+        /**
+         * This method counts one more user for the given key, if asked to,
+         * and returns about how many users there are for it in the window.
+         */
+        uint32_t CountCrowd(uint64_t key, bool add)
+        {
+            auto& block = crowdCounts[key & crowdCountsMask];
+            const auto first = (key >> 32) % CROWD_BLOCK_COUNTERS;
+            const auto step = 1 + (key >> 40) % (CROWD_BLOCK_COUNTERS - 1);
+            uint32_t estimate = UINT32_MAX;
+            for (size_t i = 0; i < CROWD_COUNTER_HASHES; ++i)
+            {
+                auto& counter = block.counters[(first + i * step) % CROWD_BLOCK_COUNTERS];
+                if (
+                    add
+                    && (counter[currentHalf] < UINT16_MAX)
+                )
+                {
+                    ++counter[currentHalf];
+                }
+                estimate = std::min(
+                    estimate,
+                    (uint32_t)counter[0] + counter[1]
+                );
+            }
+            return estimate;
+        }
+    };
+
+    SpamDetector::~SpamDetector() noexcept = default;
+    SpamDetector::SpamDetector(SpamDetector&&) noexcept = default;
+    SpamDetector& SpamDetector::operator=(SpamDetector&&) noexcept = default;
+
+    SpamDetector::SpamDetector()
+        : SpamDetector(Settings())
+    {
+    }
+
+    SpamDetector::SpamDetector(const Settings& settings)
+        : impl_(new Impl())
+    {
+        impl_->settings = settings;
+        impl_->settings.repeatLimit = std::min(
+            std::max< size_t >(impl_->settings.repeatLimit, 2),
+            RECENT_LINES + 1
+        );
+        impl_->settings.floodLimit = std::min(
+            std::max< size_t >(impl_->settings.floodLimit, 2),
+            RECENT_LINES + 1
+        );
+        impl_->windowTicks = (uint32_t)(settings.window * TICKS_PER_SECOND);
+        impl_->floodWindowTicks = (uint32_t)(settings.floodWindow * TICKS_PER_SECOND);
+
+        // Half the memory goes to the users, and a quarter to each filter.
+        const auto userSlots = TableSize(settings.memoryBudget / 2 / sizeof(UserHistory));
+        impl_->users.resize(userSlots);
+        impl_->userSetMask = userSlots / USER_WAYS - 1;
+        const auto pairBlocks = TableSize(settings.memoryBudget / 4 / sizeof(PairBlock));
+        impl_->seenPairs.resize(pairBlocks);
+        impl_->seenPairsMask = pairBlocks - 1;
+        const auto crowdBlocks = TableSize(settings.memoryBudget / 4 / sizeof(CrowdBlock));
+        impl_->crowdCounts.resize(crowdBlocks);
+        impl_->crowdCountsMask = crowdBlocks - 1;
+    }
+
+    SpamVerdict SpamDetector::Check(
+        std::string_view channel,
+        std::string_view user,
+        std::string_view text,
+        double now
+    )
+    {
+        auto& impl = *impl_;
+        if (!impl.started)
+        {
+            impl.started = true;
+            impl.epoch = now;
+            impl.halfStart = now;
+        }
+        impl.Age(now);
+        ++impl.stats.lines;
+        const auto tick = (uint32_t)(int64_t)((now - impl.epoch) * TICKS_PER_SECOND);
+        const auto channelHash = HashText(channel);
+        const auto userKey = Mix(channelHash ^ HashText(user)) | 1;
+
+        // Start bringing in the user's slots while the text is normalized,
+        // and the blocks of the filters for the line once its fingerprint is
+        // known, since with a large budget each is likely a cache miss.
+        const auto userSet = &impl.users[(userKey & impl.userSetMask) * USER_WAYS];
+        for (size_t way = 0; way < USER_WAYS; ++way)
+        {
+            __builtin_prefetch(userSet + way);
+        }
+        SpamVerdict verdict;
+        size_t length;
+        verdict.fingerprint = Fingerprint(text, length);
+        const auto crowdKey = Mix(channelHash ^ verdict.fingerprint);
+        const auto pairKey = Mix(crowdKey ^ userKey);
+        const auto crowdCandidate = (length >= impl.settings.minCrowdLength);
+        if (crowdCandidate)
+        {
+            __builtin_prefetch(&impl.seenPairs[pairKey & impl.seenPairsMask]);
+            __builtin_prefetch(&impl.crowdCounts[crowdKey & impl.crowdCountsMask]);
+        }
+
+        // Look back over what the user sent to the channel lately.
+        auto& history = impl.FindUser(userKey, tick);
+        const auto shortFingerprint = (uint32_t)verdict.fingerprint ^ (uint32_t)(verdict.fingerprint >> 32);
+        uint32_t repeats = 1;
+        uint32_t lines = 1;
+        for (size_t i = 0; i < history.count; ++i)
+        {
+            const auto age = tick - history.times[i];
+            if (
+                (age <= impl.windowTicks)
+                && (history.fingerprints[i] == shortFingerprint)
+            )
+            {
+                ++repeats;
+            }
+            if (age <= impl.floodWindowTicks)
+            {
+                ++lines;
+            }
+        }
+        history.fingerprints[history.next] = shortFingerprint;
+        history.times[history.next] = tick;
+        history.next = (uint8_t)((history.next + 1) % RECENT_LINES);
+        if (history.count < RECENT_LINES)
+        {
+            ++history.count;
+        }
+
+        // Count the user among those who sent the line to the channel,
+        // unless they already are.
+        uint32_t crowd = 0;
+        if (crowdCandidate)
+        {
+            const auto counted = impl.TestAndAddPair(pairKey);
+            crowd = impl.CountCrowd(crowdKey, !counted);
+        }
+
+        if (crowd >= impl.settings.crowdLimit)
+        {
+            verdict.reason = SpamReason::CopyPaste;
+            verdict.count = crowd;
+            ++impl.stats.copyPastes;
+        }
+        else if (repeats >= impl.settings.repeatLimit)
+        {
+            verdict.reason = SpamReason::Repeat;
+            verdict.count = repeats;
+            ++impl.stats.repeats;
+        }
+        else if (lines >= impl.settings.floodLimit)
+        {
+            verdict.reason = SpamReason::Flood;
+            verdict.count = lines;
+            ++impl.stats.floods;
+        }
+        return verdict;
+    }
+
+    SpamVerdict SpamDetector::Check(
+        const Message& message,
+        double now
+    )
+    {
+        if (
+            (message.GetKnownCommand() != KnownCommand::Privmsg)
+            || (message.parameters.size() < 2)
+        )
+        {
+            return SpamVerdict();
+        }
+        std::string_view user = message.tags.GetRawValue(KnownTag::UserId);
+        if (user.empty())
+        {
+            user = message.GetNickname();
+        }
+        return Check(message.GetChannelName(), user, message.parameters[1], now);
+    }
+
+    SpamDetector::Stats SpamDetector::GetStats() const
+    {
+        return impl_->stats;
+    }
+
+    size_t SpamDetector::GetMemoryUsage() const
+    {
+        return (
+            sizeof(Impl)
+            + impl_->users.size() * sizeof(UserHistory)
+            + impl_->seenPairs.size() * sizeof(PairBlock)
+            + impl_->crowdCounts.size() * sizeof(CrowdBlock)
+        );
+    }
+
+    uint64_t SpamDetector::Fingerprint(
+        std::string_view text,
+        size_t& length
+    )
+    {
+        // The normalized text is gathered first, without branching on each
+        // character since whether the next one is a letter or a space can't
+        // be predicted, and then hashed a word at a time.
+        uint8_t normalized[FINGERPRINT_BUFFER_SIZE];
+        size_t buffered = 0;
+        uint8_t previous = 0;
+        uint64_t hash = FINGERPRINT_SEED;
+        length = 0;
+        size_t i = 0;
+        while (i < text.length())
+        {
+            const auto c = (uint8_t)text[i];
+            uint8_t next = c;
+            if (c < 0x80)
+            {
+                next = NORMALIZED_CHARACTERS.table[c];
+                ++i;
+            }
+            else
+            {
+                const auto invisible = InvisibleCharacterLength(text, i);
+                if (invisible > 0)
+                {
+                    i += invisible;
+                    continue;
+                }
+                ++i;
+            }
+            const bool keep = (
+                (next != 0)
+                & (next != previous)
+            );
+            normalized[buffered] = next;
+            buffered += keep;
+            previous = (keep ? next : previous);
+            if (buffered == FINGERPRINT_BUFFER_SIZE)
+            {
+                hash = HashWords(hash, normalized, buffered);
+                length += buffered;
+                buffered = 0;
+            }
+        }
+        length += buffered;
+        const auto padding = (sizeof(uint64_t) - buffered % sizeof(uint64_t)) % sizeof(uint64_t);
+        (void)memset(normalized + buffered, 0, padding);
+        hash = HashWords(hash, normalized, buffered + padding);
+        return Mix(hash ^ length);
+    }
+}
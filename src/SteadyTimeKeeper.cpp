@@ -0,0 +1,312 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SteadyTimeKeeper.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TWITCH_BOT_CYCLE_COUNTER 1
+#endif
+
+namespace
+{
+    /**
+     * This is how long to measure the rate of the cycle counter against the
+     * steady clock, in nanoseconds, when the time keeper is made.
+     */
+    constexpr int64_t CALIBRATION_NANOSECONDS = 10000000;
+
+    /**
+     * This is how often the rate of the cycle counter is adjusted, in
+     * nanoseconds.
+     */
+    constexpr int64_t RECALIBRATION_NANOSECONDS = 1000000000;
+
+    /**
+     * This is how far the rate of the cycle counter may be adjusted from
+     * its measured rate, in parts per million, to keep step with the steady
+     * clock.
+     */
+    constexpr int64_t MAX_SLEW_PPM = 1000;
+
+    /**
+     * This is the number of fractional bits of the fixed point number of
+     * nanoseconds per cycle.
+     */
+    constexpr unsigned int SCALE_BITS = 32;
+
+    /**
+     * This returns the time of the standard steady clock, in nanoseconds.
+     */
+    int64_t GetSteadyClockTime()
+    {
+        return std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+#ifdef TWITCH_BOT_CYCLE_COUNTER
+    /**
+     * This returns an indication of whether or not the processor's cycle
+     * counter ticks at a constant rate, whatever the processor's speed or
+     * power state (an "invariant TSC").
+     */
+    bool IsCycleCounterInvariant()
+    {
+        unsigned int eax = 0;
+        unsigned int ebx = 0;
+        unsigned int ecx = 0;
+        unsigned int edx = 0;
+        if (
+            (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0)
+            || (eax < 0x80000007)
+        )
+        {
+            return false;
+        }
+        (void)__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        return ((edx & (1 << 8)) != 0);
+    }
+
+    /**
+     * This reads the cycle counter and the steady clock at about the same
+     * moment, taking the cycle count halfway through reading the clock, and
+     * the best of a few tries in case the thread was interrupted.
+     */
+    void ReadCyclesAndTime(uint64_t& cycles, int64_t& time)
+    {
+        uint64_t shortest = ~(uint64_t)0;
+        for (int i = 0; i < 3; ++i)
+        {
+            const auto before = __rdtsc();
+            const auto steadyTime = GetSteadyClockTime();
+            const auto after = __rdtsc();
+            if (after - before < shortest)
+            {
+                shortest = after - before;
+                cycles = before + (after - before) / 2;
+                time = steadyTime;
+            }
+        }
+    }
+#endif /* TWITCH_BOT_CYCLE_COUNTER */
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a SteadyTimeKeeper instance.
+     */
+    struct SteadyTimeKeeper::Impl
+    {
+        // Properties
+
+        /**
+         * This is the way the time is read.
+         */
+        Source source = Source::SteadyClock;
+
+        /**
+         * The time is worked out from the cycle counter as the time at an
+         * anchoring cycle count plus the cycles since then times the number
+         * of nanoseconds per cycle (scale, in fixed point). These are
+         * changed together under a sequence lock: the sequence number is
+         * odd while they're being changed, and readers try again if it was
+         * odd or changed while they read.
+         */
+        std::atomic< uint64_t > sequence{0};
+        std::atomic< uint64_t > anchorCycles{0};
+        std::atomic< int64_t > anchorTime{0};
+        std::atomic< uint64_t > scale{0};
+
+        /**
+         * This is the number of cycles after the anchor after which the
+         * rate is adjusted.
+         */
+        std::atomic< uint64_t > recalibrationCycles{0};
+
+        /**
+         * This is set while one thread adjusts the rate.
+         */
+        std::atomic< bool > recalibrating{false};
+
+        /**
+         * These are the cycle count and steady clock time read first, from
+         * which the long-run rate of the cycle counter is measured.
+         */
+        uint64_t firstCycles = 0;
+        int64_t firstTime = 0;
+
+        // Methods
+
+#ifdef TWITCH_BOT_CYCLE_COUNTER
+        /**
+         * This method measures the rate of the cycle counter and sets the
+         * first anchor.
+         */
+        void Calibrate()
+        {
+            ReadCyclesAndTime(firstCycles, firstTime);
+            uint64_t cycles = 0;
+            int64_t time = 0;
+            do
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                ReadCyclesAndTime(cycles, time);
+            } while (time - firstTime < CALIBRATION_NANOSECONDS);
+            const auto rate = ((unsigned __int128)(time - firstTime) << SCALE_BITS) / (cycles - firstCycles);
+            anchorCycles.store(cycles, std::memory_order_relaxed);
+            anchorTime.store(time, std::memory_order_relaxed);
+            scale.store((uint64_t)rate, std::memory_order_relaxed);
+            recalibrationCycles.store(
+                (uint64_t)(((unsigned __int128)RECALIBRATION_NANOSECONDS << SCALE_BITS) / rate),
+                std::memory_order_relaxed
+            );
+            sequence.store(2, std::memory_order_release);
+        }
+
+        /**
+         * This method sets a new anchor at the current cycle count, at the
+         * time worked out from the old one, so the time doesn't jump, and
+         * picks the rate which would bring the time back in step with the
+         * steady clock by the next adjustment.
+         */
+        void Recalibrate(
+            uint64_t oldAnchorCycles,
+            int64_t oldAnchorTime,
+            uint64_t oldScale
+        )
+        {
+            sequence.fetch_add(1, std::memory_order_acq_rel);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            uint64_t cycles = 0;
+            int64_t steadyTime = 0;
+            ReadCyclesAndTime(cycles, steadyTime);
+            auto time = oldAnchorTime + (int64_t)(
+                ((unsigned __int128)(cycles - oldAnchorCycles) * oldScale) >> SCALE_BITS
+            );
+
+            // The time may jump forward, if it has fallen far behind, but
+            // never back.
+            if (steadyTime - time > RECALIBRATION_NANOSECONDS / 1000)
+            {
+                time = steadyTime;
+            }
+            const auto rate = (int64_t)(
+                ((unsigned __int128)(steadyTime - firstTime) << SCALE_BITS) / (cycles - firstCycles)
+            );
+            const auto intervalCycles = (int64_t)(
+                ((unsigned __int128)RECALIBRATION_NANOSECONDS << SCALE_BITS) / (uint64_t)rate
+            );
+            const auto targetTime = steadyTime + RECALIBRATION_NANOSECONDS;
+            auto newScale = (int64_t)(
+                ((__int128)(targetTime - time) << SCALE_BITS) / intervalCycles
+            );
+            const auto slew = rate / 1000000 * MAX_SLEW_PPM;
+            newScale = std::min(std::max(newScale, rate - slew), rate + slew);
+            anchorCycles.store(cycles, std::memory_order_relaxed);
+            anchorTime.store(time, std::memory_order_relaxed);
+            scale.store((uint64_t)newScale, std::memory_order_relaxed);
+            recalibrationCycles.store((uint64_t)intervalCycles, std::memory_order_relaxed);
+            sequence.fetch_add(1, std::memory_order_release);
+        }
+
+        /**
+         * This method returns the time worked out from the cycle counter.
+         */
+        int64_t GetCycleCounterTime()
+        {
+            uint64_t oldSequence;
+            uint64_t cycles;
+            uint64_t oldAnchorCycles;
+            int64_t oldAnchorTime;
+            uint64_t oldScale;
+            uint64_t oldRecalibrationCycles;
+            for (;;)
+            {
+                oldSequence = sequence.load(std::memory_order_acquire);
+                if ((oldSequence & 1) != 0)
+                {
+                    continue;
+                }
+                oldAnchorCycles = anchorCycles.load(std::memory_order_relaxed);
+                oldAnchorTime = anchorTime.load(std::memory_order_relaxed);
+                oldScale = scale.load(std::memory_order_relaxed);
+                oldRecalibrationCycles = recalibrationCycles.load(std::memory_order_relaxed);
+                cycles = __rdtsc();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == oldSequence)
+                {
+                    break;
+                }
+            }
+            const auto elapsed = (
+                (cycles > oldAnchorCycles)
+                ? cycles - oldAnchorCycles
+                : 0
+            );
+            if (
+                (elapsed >= oldRecalibrationCycles)
+                && !recalibrating.exchange(true, std::memory_order_acquire)
+            )
+            {
+                if (sequence.load(std::memory_order_relaxed) == oldSequence)
+                {
+                    Recalibrate(oldAnchorCycles, oldAnchorTime, oldScale);
+                }
+                recalibrating.store(false, std::memory_order_release);
+            }
+            return oldAnchorTime + (int64_t)(
+                ((unsigned __int128)elapsed * oldScale) >> SCALE_BITS
+            );
+        }
+#endif /* TWITCH_BOT_CYCLE_COUNTER */
+    };
+
+    SteadyTimeKeeper::~SteadyTimeKeeper() noexcept = default;
+
+    SteadyTimeKeeper::SteadyTimeKeeper()
+        : SteadyTimeKeeper(Source::SteadyClock)
+    {
+    }
+
+    SteadyTimeKeeper::SteadyTimeKeeper(Source source)
+        : impl_(new Impl())
+    {
+#ifdef TWITCH_BOT_CYCLE_COUNTER
+        if (
+            (source == Source::CycleCounter)
+            && IsCycleCounterInvariant()
+        )
+        {
+            impl_->source = Source::CycleCounter;
+            impl_->Calibrate();
+        }
+#else /* TWITCH_BOT_CYCLE_COUNTER */
+        (void)source;
+#endif /* TWITCH_BOT_CYCLE_COUNTER */
+    }
+
+    auto SteadyTimeKeeper::GetSource() const -> Source
+    {
+        return impl_->source;
+    }
+
+    double SteadyTimeKeeper::GetCurrentTime()
+    {
+        return (double)GetCurrentTimeNanoseconds() / 1e9;
+    }
+
+    int64_t SteadyTimeKeeper::GetCurrentTimeNanoseconds()
+    {
+#ifdef TWITCH_BOT_CYCLE_COUNTER
+        if (impl_->source == Source::CycleCounter)
+        {
+            return impl_->GetCycleCounterTime();
+        }
+#endif /* TWITCH_BOT_CYCLE_COUNTER */
+        return GetSteadyClockTime();
+    }
+}
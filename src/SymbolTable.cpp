@@ -0,0 +1,540 @@
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SymbolTable.hpp>
+
+namespace
+{
+    /**
+     * This is the number of bits of a name's hash which select the part of
+     * the index from names to symbols where it's kept.
+     */
+    constexpr unsigned int SHARD_BITS = 4;
+
+    /**
+     * This is the number of parts into which the index from names to
+     * symbols is split, each with its own lock.
+     */
+    constexpr size_t SHARD_COUNT = (size_t)1 << SHARD_BITS;
+
+    /**
+     * This is the number of slots each part of the index from names to
+     * symbols starts with. It must be a power of two.
+     */
+    constexpr size_t INITIAL_SHARD_SLOTS = 64;
+
+    /**
+     * This is the number of bits of a symbol which select its place within
+     * a page of the index from symbols to names.
+     */
+    constexpr unsigned int PAGE_BITS = 12;
+
+    /**
+     * This is the number of symbols in each page of the index from symbols
+     * to names.
+     */
+    constexpr size_t PAGE_SIZE = (size_t)1 << PAGE_BITS;
+
+    /**
+     * This is the most pages the index from symbols to names can have, which
+     * limits the table to about 16 million names.
+     */
+    constexpr size_t MAX_PAGES = 4096;
+
+    /**
+     * This is the size of each block of memory in which names are stored.
+     * Names longer than a quarter of this get a block of their own.
+     */
+    constexpr size_t NAME_BLOCK_SIZE = 65536;
+
+    /**
+     * This is the number of slots in each Cache. It must be a power of two.
+     * It's sized to hold the chatters of a busy channel during a raid.
+     */
+    constexpr size_t CACHE_SIZE = 4096;
+
+    /**
+     * This is where the name of a symbol is stored.
+     */
+    struct Name
+    {
+        const char* text = nullptr;
+        uint32_t length = 0;
+    };
+
+    /**
+     * This is the longest name copied into the index from names to symbols.
+     * Longer names are compared with the names stored in the table.
+     */
+    constexpr size_t MAX_SLOT_NAME_LENGTH = 23;
+
+    /**
+     * This is one slot of the index from names to symbols: the symbol of a
+     * name, the low bits of the name's hash, so that most other names are
+     * passed over without looking at the name, and the index can be grown
+     * without hashing the names again, and a copy of the name if it's
+     * short. With many users chatting, the slot is rarely in the
+     * processor's cache, and this way it's the only memory touched.
+     */
+    struct Slot
+    {
+        uint32_t hash = 0;
+        TwitchBot::SymbolTable::Symbol symbol = TwitchBot::SymbolTable::NO_SYMBOL;
+
+        /**
+         * This is the length of the copy of the name, or 0 if the name is
+         * too long to copy.
+         */
+        uint8_t length = 0;
+        char name[MAX_SLOT_NAME_LENGTH];
+    };
+
+    /**
+     * This reads eight characters as a number.
+     */
+    inline uint64_t Load64(const char* characters)
+    {
+        uint64_t value;
+        (void)memcpy(&value, characters, sizeof(value));
+        return value;
+    }
+
+    /**
+     * This reads four characters as a number.
+     */
+    inline uint64_t Load32(const char* characters)
+    {
+        uint32_t value;
+        (void)memcpy(&value, characters, sizeof(value));
+        return value;
+    }
+
+    /**
+     * This mixes the bits of a hash.
+     */
+    inline uint64_t Mix(uint64_t hash)
+    {
+        hash ^= hash >> 31;
+        hash *= 0x9E3779B97F4A7C15ULL;
+        return hash ^ (hash >> 32);
+    }
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a SymbolTable instance.
+     */
+    struct SymbolTable::Impl
+    {
+        // Types
+
+        /**
+         * This is one part of the index from names to symbols. It's an
+         * open-addressed hash table, kept at most three quarters full.
+         */
+        struct alignas(64) Shard
+        {
+            mutable std::shared_mutex mutex;
+            std::vector< Slot > slots = std::vector< Slot >(INITIAL_SHARD_SLOTS);
+            size_t count = 0;
+        };
+
+        // Properties
+
+        /**
+         * These are the parts of the index from names to symbols.
+         */
+        Shard shards[SHARD_COUNT];
+
+        /**
+         * This is held while adding a name, and protects the blocks of
+         * names and the next symbol to hand out. It's only ever taken
+         * while holding the lock of a shard, never the other way around.
+         */
+        std::mutex namesMutex;
+
+        /**
+         * These are the blocks of memory in which names are stored.
+         */
+        std::vector< std::unique_ptr< char[] > > nameBlocks;
+
+        /**
+         * This is where the next name goes in the last block of names, and
+         * how much room is left there.
+         */
+        char* nextName = nullptr;
+        size_t nameBlockLeft = 0;
+
+        /**
+         * This is the number of bytes allocated for names.
+         */
+        size_t nameBytes = 0;
+
+        /**
+         * These are the pages of the index from symbols to names. A page is
+         * published before the symbols in it are handed out, and never
+         * changes or goes away after that, so it's read without locking.
+         */
+        std::atomic< Name* > pages[MAX_PAGES] = {};
+
+        /**
+         * This is one more than the last symbol handed out.
+         */
+        std::atomic< Symbol > nextSymbol{1};
+
+        // Methods
+
+        ~Impl() noexcept
+        {
+            for (auto& page: pages)
+            {
+                delete[] page.load(std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * This returns where the given symbol's name is stored. The symbol
+         * must have been handed out already.
+         */
+        const Name& GetEntry(Symbol symbol) const
+        {
+            const auto page = pages[symbol >> PAGE_BITS].load(std::memory_order_acquire);
+            return page[symbol & (PAGE_SIZE - 1)];
+        }
+
+        /**
+         * This returns the index of the slot in the given shard which holds
+         * the given name, or of the empty slot where it would go. The caller
+         * must hold the lock of the shard.
+         */
+        size_t FindSlot(
+            const Shard& shard,
+            std::string_view name,
+            uint64_t hash
+        ) const
+        {
+            const auto mask = shard.slots.size() - 1;
+            for (auto i = (size_t)(uint32_t)hash >> SHARD_BITS;; ++i)
+            {
+                const auto& slot = shard.slots[i & mask];
+                if (slot.symbol == NO_SYMBOL)
+                {
+                    return i & mask;
+                }
+                if (slot.hash != (uint32_t)hash)
+                {
+                    continue;
+                }
+                if (name.length() <= MAX_SLOT_NAME_LENGTH)
+                {
+                    if (
+                        (slot.length == name.length())
+                        && (memcmp(slot.name, name.data(), name.length()) == 0)
+                    )
+                    {
+                        return i & mask;
+                    }
+                }
+                else if (slot.length == 0)
+                {
+                    const auto& entry = GetEntry(slot.symbol);
+                    if (
+                        (entry.length == name.length())
+                        && (memcmp(entry.text, name.data(), name.length()) == 0)
+                    )
+                    {
+                        return i & mask;
+                    }
+                }
+            }
+        }
+
+        /**
+         * This doubles the number of slots in the given shard. The caller
+         * must hold the lock of the shard exclusively.
+         */
+        void GrowShard(Shard& shard)
+        {
+            std::vector< Slot > slots(shard.slots.size() * 2);
+            const auto mask = slots.size() - 1;
+            for (const auto& slot: shard.slots)
+            {
+                if (slot.symbol == NO_SYMBOL)
+                {
+                    continue;
+                }
+                auto i = (size_t)slot.hash >> SHARD_BITS;
+                while (slots[i & mask].symbol != NO_SYMBOL)
+                {
+                    ++i;
+                }
+                slots[i & mask] = slot;
+            }
+            shard.slots.swap(slots);
+        }
+
+        /**
+         * This copies the given name into the blocks of names.
+         */
+        const char* StoreName(std::string_view name)
+        {
+            if (name.length() > NAME_BLOCK_SIZE / 4)
+            {
+                nameBlocks.emplace_back(new char[name.length()]);
+                nameBytes += name.length();
+                (void)memcpy(nameBlocks.back().get(), name.data(), name.length());
+                return nameBlocks.back().get();
+            }
+            if (name.length() > nameBlockLeft)
+            {
+                nameBlocks.emplace_back(new char[NAME_BLOCK_SIZE]);
+                nameBytes += NAME_BLOCK_SIZE;
+                nextName = nameBlocks.back().get();
+                nameBlockLeft = NAME_BLOCK_SIZE;
+            }
+            const auto text = nextName;
+            (void)memcpy(text, name.data(), name.length());
+            nextName += name.length();
+            nameBlockLeft -= name.length();
+            return text;
+        }
+
+        /**
+         * This adds the given name to the given shard, and returns its
+         * symbol. The caller must hold the lock of the shard exclusively,
+         * and the name must not be in the table already.
+         */
+        Symbol AddName(Shard& shard, std::string_view name, uint64_t hash)
+        {
+            if (name.length() > UINT32_MAX)
+            {
+                return NO_SYMBOL;
+            }
+            Symbol symbol;
+            {
+                std::lock_guard< decltype(namesMutex) > lock(namesMutex);
+                symbol = nextSymbol.load(std::memory_order_relaxed);
+                const auto pageIndex = (size_t)symbol >> PAGE_BITS;
+                if (pageIndex >= MAX_PAGES)
+                {
+                    return NO_SYMBOL;
+                }
+                auto page = pages[pageIndex].load(std::memory_order_relaxed);
+                if (page == nullptr)
+                {
+                    page = new Name[PAGE_SIZE];
+                    pages[pageIndex].store(page, std::memory_order_release);
+                }
+                auto& entry = page[symbol & (PAGE_SIZE - 1)];
+                entry.text = StoreName(name);
+                entry.length = (uint32_t)name.length();
+                nextSymbol.store(symbol + 1, std::memory_order_release);
+            }
+            if ((shard.count + 1) * 4 > shard.slots.size() * 3)
+            {
+                GrowShard(shard);
+            }
+            auto& slot = shard.slots[FindSlot(shard, name, hash)];
+            slot.hash = (uint32_t)hash;
+            slot.symbol = symbol;
+            if (name.length() <= MAX_SLOT_NAME_LENGTH)
+            {
+                slot.length = (uint8_t)name.length();
+                (void)memcpy(slot.name, name.data(), name.length());
+            }
+            ++shard.count;
+            return symbol;
+        }
+    };
+
+    SymbolTable::~SymbolTable() noexcept = default;
+
+    SymbolTable::SymbolTable()
+        : impl_(new Impl())
+    {
+    }
+
+    auto SymbolTable::Intern(std::string_view name) -> Symbol
+    {
+        if (name.empty())
+        {
+            return NO_SYMBOL;
+        }
+        const auto hash = Hash(name);
+        auto& shard = impl_->shards[hash & (SHARD_COUNT - 1)];
+        {
+            std::shared_lock< decltype(shard.mutex) > lock(shard.mutex);
+            const auto symbol = shard.slots[impl_->FindSlot(shard, name, hash)].symbol;
+            if (symbol != NO_SYMBOL)
+            {
+                return symbol;
+            }
+        }
+        std::lock_guard< decltype(shard.mutex) > lock(shard.mutex);
+        const auto symbol = shard.slots[impl_->FindSlot(shard, name, hash)].symbol;
+        if (symbol != NO_SYMBOL)
+        {
+            return symbol;
+        }
+        return impl_->AddName(shard, name, hash);
+    }
+
+    auto SymbolTable::Find(std::string_view name) const -> Symbol
+    {
+        if (name.empty())
+        {
+            return NO_SYMBOL;
+        }
+        const auto hash = Hash(name);
+        const auto& shard = impl_->shards[hash & (SHARD_COUNT - 1)];
+        std::shared_lock< decltype(shard.mutex) > lock(shard.mutex);
+        return shard.slots[impl_->FindSlot(shard, name, hash)].symbol;
+    }
+
+    std::string_view SymbolTable::GetName(Symbol symbol) const
+    {
+        if (
+            (symbol == NO_SYMBOL)
+            || (symbol >= impl_->nextSymbol.load(std::memory_order_acquire))
+        )
+        {
+            return std::string_view();
+        }
+        const auto& entry = impl_->GetEntry(symbol);
+        return std::string_view(entry.text, entry.length);
+    }
+
+    size_t SymbolTable::GetCount() const
+    {
+        return (size_t)impl_->nextSymbol.load(std::memory_order_acquire) - 1;
+    }
+
+    size_t SymbolTable::GetMemoryUsage() const
+    {
+        size_t bytes = sizeof(Impl);
+        for (const auto& shard: impl_->shards)
+        {
+            std::shared_lock< decltype(shard.mutex) > lock(shard.mutex);
+            bytes += shard.slots.size() * sizeof(Slot);
+        }
+        std::lock_guard< decltype(impl_->namesMutex) > lock(impl_->namesMutex);
+        bytes += impl_->nameBytes;
+        for (const auto& page: impl_->pages)
+        {
+            if (page.load(std::memory_order_relaxed) != nullptr)
+            {
+                bytes += PAGE_SIZE * sizeof(Name);
+            }
+        }
+        return bytes;
+    }
+
+    uint64_t SymbolTable::Hash(std::string_view name)
+    {
+        // Names are hashed eight characters at a time, which for most names
+        // is once or twice. The last eight characters overlap the ones
+        // before them, and the length is mixed in to tell them apart.
+        const auto characters = name.data();
+        auto length = name.length();
+        auto hash = Mix(0x243F6A8885A308D3ULL ^ length);
+        if (length >= 8)
+        {
+            for (; length > 8; length -= 8)
+            {
+                hash = Mix(hash ^ Load64(characters + name.length() - length));
+            }
+            return Mix(hash ^ Load64(characters + name.length() - 8));
+        }
+        if (length >= 4)
+        {
+            return Mix(hash ^ ((Load32(characters + length - 4) << 32) | Load32(characters)));
+        }
+        if (length > 0)
+        {
+            return Mix(
+                hash
+                ^ (
+                    (uint64_t)(unsigned char)characters[0]
+                    | ((uint64_t)(unsigned char)characters[length / 2] << 8)
+                    | ((uint64_t)(unsigned char)characters[length - 1] << 16)
+                )
+            );
+        }
+        return hash;
+    }
+
+    SymbolTable::Cache::~Cache() noexcept = default;
+    SymbolTable::Cache::Cache(Cache&&) noexcept = default;
+    SymbolTable::Cache& SymbolTable::Cache::operator=(Cache&&) noexcept = default;
+
+    SymbolTable::Cache::Cache(std::shared_ptr< SymbolTable > table)
+        : table_(table)
+        , entries_(CACHE_SIZE)
+    {
+    }
+
+    auto SymbolTable::Cache::Intern(std::string_view name) -> Symbol
+    {
+        if (name.empty())
+        {
+            return NO_SYMBOL;
+        }
+        if (name.length() > MAX_NAME_LENGTH)
+        {
+            return table_->Intern(name);
+        }
+        const auto hash = Hash(name);
+        auto& entry = entries_[(hash >> 32) & (CACHE_SIZE - 1)];
+        if (
+            (entry.hash == (uint32_t)hash)
+            && (entry.length == name.length())
+            && (memcmp(entry.name, name.data(), name.length()) == 0)
+        )
+        {
+            return entry.symbol;
+        }
+        entry.hash = (uint32_t)hash;
+        entry.symbol = table_->Intern(name);
+        entry.length = (uint8_t)name.length();
+        (void)memcpy(entry.name, name.data(), name.length());
+        return entry.symbol;
+    }
+
+    auto SymbolTable::Cache::Find(std::string_view name) -> Symbol
+    {
+        if (name.empty())
+        {
+            return NO_SYMBOL;
+        }
+        if (name.length() > MAX_NAME_LENGTH)
+        {
+            return table_->Find(name);
+        }
+        const auto hash = Hash(name);
+        auto& entry = entries_[(hash >> 32) & (CACHE_SIZE - 1)];
+        if (
+            (entry.hash == (uint32_t)hash)
+            && (entry.length == name.length())
+            && (memcmp(entry.name, name.data(), name.length()) == 0)
+        )
+        {
+            return entry.symbol;
+        }
+        const auto symbol = table_->Find(name);
+        if (symbol != NO_SYMBOL)
+        {
+            entry.hash = (uint32_t)hash;
+            entry.symbol = symbol;
+            entry.length = (uint8_t)name.length();
+            (void)memcpy(entry.name, name.data(), name.length());
+        }
+        return symbol;
+    }
+
+    auto SymbolTable::Cache::GetTable() const -> const std::shared_ptr< SymbolTable >&
+    {
+        return table_;
+    }
+}
@@ -0,0 +1,362 @@
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SyntheticCapture.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TrafficCapture.hpp>
+
+namespace
+{
+    /**
+     * These are the words chat lines are made of. The ones outside of
+     * ASCII are each one character.
+     */
+    const char* const WORDS[] = {
+        "lol", "the", "what", "is", "this", "play", "nice", "gg", "wp", "no",
+        "way", "he", "just", "won", "clip", "it", "chat", "so", "bad", "good",
+        "streamer", "boss", "run", "again", "why", "omg", "1v5", "W", "L",
+        "!!!", "???", "caf\xc3\xa9", "\xf0\x9f\x98\x82", "\xe2\x9d\xa4",
+    };
+
+    /**
+     * These are the emotes used in chat lines, with their ids.
+     */
+    const struct
+    {
+        const char* id;
+        const char* name;
+    } EMOTES[] = {
+        {"25", "Kappa"},
+        {"88", "PogChamp"},
+        {"425618", "LUL"},
+        {"305954156", "PogU"},
+        {"emotesv2_dcd06b30a5c24f6eb871e8f5edbd44f7", "DinoDance"},
+    };
+
+    /**
+     * These are the lines pasted in copy-paste raids.
+     */
+    const char* const RAID_LINES[] = {
+        "This streamer is the worst I have ever seen, unfollow now and go watch someone else!!!",
+        "FREE VIEWERS AND FOLLOWERS at cheap-viewers dot example, first 100 free",
+        "\xe2\x96\x88\xe2\x96\x88\xe2\x96\x88 RAID RAID RAID \xe2\x96\x88\xe2\x96\x88\xe2\x96\x88 we came from the other channel",
+    };
+
+    /**
+     * This picks numbers from zero up to the given count, with smaller
+     * numbers far more likely, the way a few channels and words make up
+     * much of chat.
+     */
+    class Skewed
+    {
+    public:
+        explicit Skewed(size_t count)
+        {
+            double total = 0.0;
+            for (size_t i = 0; i < std::max< size_t >(count, 1); ++i)
+            {
+                total += 1.0 / pow((double)(i + 1), 1.1);
+                cumulative_.push_back(total);
+            }
+        }
+
+        size_t Pick(std::mt19937_64& generator)
+        {
+            const auto target = std::uniform_real_distribution< double >(0.0, cumulative_.back())(generator);
+            return std::min(
+                (size_t)(
+                    std::lower_bound(cumulative_.begin(), cumulative_.end(), target)
+                    - cumulative_.begin()
+                ),
+                cumulative_.size() - 1
+            );
+        }
+
+    private:
+        std::vector< double > cumulative_;
+    };
+
+    /**
+     * This returns the number of characters (code points) in the given
+     * text.
+     */
+    size_t CountCharacters(const std::string& text)
+    {
+        size_t characters = 0;
+        for (const auto c: text)
+        {
+            characters += (((unsigned char)c & 0xC0) != 0x80);
+        }
+        return characters;
+    }
+
+    /**
+     * This gathers the lines of a capture and cuts them into chunks, as the
+     * server would hand them over.
+     */
+    class ChunkWriter
+    {
+    public:
+        ChunkWriter(TwitchBot::CaptureWriter& capture, size_t chunkSize)
+            : capture_(capture)
+            , chunkSize_(std::max< size_t >(chunkSize, 1))
+        {
+        }
+
+        void Add(uint64_t time, const std::string& line)
+        {
+            pending_ += line;
+            pending_ += "\r\n";
+            ++lines_;
+            size_t offset = 0;
+            while (pending_.length() - offset >= chunkSize_)
+            {
+                capture_.Record(time, std::string_view(pending_).substr(offset, chunkSize_));
+                offset += chunkSize_;
+            }
+            (void)pending_.erase(0, offset);
+            lastTime_ = time;
+        }
+
+        void Finish()
+        {
+            if (!pending_.empty())
+            {
+                capture_.Record(lastTime_, pending_);
+                pending_.clear();
+            }
+        }
+
+        uint64_t GetLineCount() const
+        {
+            return lines_;
+        }
+
+    private:
+        TwitchBot::CaptureWriter& capture_;
+        size_t chunkSize_;
+        std::string pending_;
+        uint64_t lastTime_ = 0;
+        uint64_t lines_ = 0;
+    };
+
+    /**
+     * This returns the tags the server sends with a chat line.
+     */
+    std::string MakeChatTags(
+        std::mt19937_64& generator,
+        const std::string& name,
+        uint64_t userId,
+        uint64_t roomId,
+        const std::string& emotes,
+        uint64_t messageNumber,
+        uint64_t sentTime
+    )
+    {
+        const auto months = std::to_string(generator() % 48);
+        const bool subscriber = ((generator() % 3) == 0);
+        const bool moderator = ((generator() % 50) == 0);
+        std::string tags = "@badge-info=";
+        if (subscriber)
+        {
+            tags += "subscriber/" + months;
+        }
+        tags += ";badges=";
+        if (moderator)
+        {
+            tags += "moderator/1,";
+        }
+        if (subscriber)
+        {
+            tags += "subscriber/" + months;
+        }
+        static const char* const COLORS[] = {"#1E90FF", "#FF0000", "#8A2BE2", "", "#00FF7F"};
+        tags += ";client-nonce=" + std::to_string(generator()) + ";color=" + COLORS[generator() % 5];
+        tags += ";display-name=" + name + ";emotes=" + emotes + ";first-msg=0;flags=";
+        tags += ";id=3b8f1c4e-0d5a-4f4e-9c2b-" + std::to_string(100000000000 + messageNumber);
+        tags += ";mod=" + std::string(moderator ? "1" : "0") + ";returning-chatter=0";
+        tags += ";room-id=" + std::to_string(roomId) + ";subscriber=" + (subscriber ? "1" : "0");
+        tags += ";tmi-sent-ts=" + std::to_string(sentTime) + ";turbo=0;user-id=" + std::to_string(userId);
+        tags += ";user-type=" + std::string(moderator ? "mod" : "");
+        return tags;
+    }
+}
+
+namespace TwitchBot
+{
+    bool WriteSyntheticCapture(
+        const std::string& path,
+        const SyntheticCaptureSettings& settings,
+        uint64_t& messages
+    )
+    {
+        messages = 0;
+        CaptureWriter capture;
+        if (!capture.Open(path))
+        {
+            return false;
+        }
+        std::mt19937_64 generator(settings.seed);
+        ChunkWriter writer(capture, settings.chunkSize);
+        const auto channels = std::max< size_t >(settings.channels, 1);
+        const auto users = std::max< size_t >(settings.users, 1);
+        const auto linesPerSecond = std::max(settings.chatLinesPerSecond, 1e-3);
+
+        // The bot logs in and joins its channels.
+        writer.Add(0, ":tmi.twitch.tv 001 bot :Welcome, GLHF!");
+        writer.Add(0, ":tmi.twitch.tv 376 bot :>");
+        for (size_t channel = 0; channel < channels; ++channel)
+        {
+            const auto name = "#channel" + std::to_string(channel);
+            writer.Add(0, ":bot!bot@bot.tmi.twitch.tv JOIN " + name);
+            writer.Add(
+                0,
+                "@emote-only=0;followers-only=-1;r9k=0;room-id=" + std::to_string(1000 + channel)
+                + ";slow=0;subs-only=0 :tmi.twitch.tv ROOMSTATE " + name
+            );
+        }
+
+        Skewed pickChannel(channels);
+        Skewed pickWord(sizeof(WORDS) / sizeof(WORDS[0]));
+        constexpr uint64_t SENT_TIME_START = 1700000000000;
+        uint64_t raiders = 0;
+        for (size_t i = 0; i < settings.chatLines; ++i)
+        {
+            const auto seconds = (double)i / linesPerSecond;
+            const auto time = (uint64_t)llround(seconds * 1e9);
+            const auto sentTime = SENT_TIME_START + (uint64_t)(seconds * 1000.0);
+            const auto channel = pickChannel.Pick(generator);
+            const auto channelName = "#channel" + std::to_string(channel);
+
+            // Now and then the server has something else to say.
+            if ((i > 0) && ((i % 20000) == 0))
+            {
+                writer.Add(time, "PING :tmi.twitch.tv");
+            }
+            if ((i > 0) && ((i % 3000) == 0))
+            {
+                const auto user = generator() % users;
+                const auto name = "viewer" + std::to_string(user);
+                writer.Add(
+                    time,
+                    "@badge-info=subscriber/1;badges=subscriber/0;color=;display-name=" + name
+                    + ";emotes=;flags=;id=9d3e0b4a-" + std::to_string(i) + ";login=" + name
+                    + ";mod=0;msg-id=sub;msg-param-cumulative-months=1;msg-param-sub-plan=1000"
+                    + ";room-id=" + std::to_string(1000 + channel)
+                    + ";subscriber=1;system-msg=" + name + "\\ssubscribed\\sat\\sTier\\s1."
+                    + ";tmi-sent-ts=" + std::to_string(sentTime)
+                    + ";user-id=" + std::to_string(100000 + user) + ";user-type= :tmi.twitch.tv USERNOTICE "
+                    + channelName + " :first sub!"
+                );
+            }
+            if ((i > 0) && ((i % 7000) == 0))
+            {
+                const auto user = generator() % users;
+                writer.Add(
+                    time,
+                    "@ban-duration=600;room-id=" + std::to_string(1000 + channel)
+                    + ";target-user-id=" + std::to_string(100000 + user)
+                    + ";tmi-sent-ts=" + std::to_string(sentTime)
+                    + " :tmi.twitch.tv CLEARCHAT " + channelName + " :viewer" + std::to_string(user)
+                );
+            }
+
+            // Make the chat line, either a raider's paste, dressed up a
+            // little, or a line of words and emotes.
+            std::string name;
+            uint64_t userId;
+            std::string text;
+            std::map< std::string, std::vector< std::pair< size_t, size_t > > > emoteRanges;
+            if (std::uniform_real_distribution< double >(0.0, 1.0)(generator) < settings.raidFraction)
+            {
+                name = "raider" + std::to_string(raiders);
+                userId = 900000000 + raiders;
+                ++raiders;
+                text = RAID_LINES[(i / 1000) % (sizeof(RAID_LINES) / sizeof(RAID_LINES[0]))];
+                switch (generator() % 4)
+                {
+                    case 1:
+                    {
+                        std::transform(
+                            text.begin(),
+                            text.end(),
+                            text.begin(),
+                            [](char c){ return (char)toupper((unsigned char)c); }
+                        );
+                    } break;
+
+                    case 2:
+                    {
+                        text += " \xf3\xa0\x80\x80";
+                    } break;
+
+                    case 3:
+                    {
+                        text = "  " + text + "...";
+                    } break;
+
+                    default: break;
+                }
+            }
+            else
+            {
+                const auto user = generator() % users;
+                name = "viewer" + std::to_string(user);
+                userId = 100000 + user;
+                const auto words = 1 + generator() % 15;
+                size_t characters = 0;
+                for (size_t word = 0; word < words; ++word)
+                {
+                    if (word > 0)
+                    {
+                        text += ' ';
+                        ++characters;
+                    }
+                    std::string piece;
+                    if ((generator() % 8) == 0)
+                    {
+                        const auto& emote = EMOTES[generator() % (sizeof(EMOTES) / sizeof(EMOTES[0]))];
+                        piece = emote.name;
+                        emoteRanges[emote.id].emplace_back(characters, characters + piece.length() - 1);
+                    }
+                    else
+                    {
+                        piece = WORDS[pickWord.Pick(generator)];
+                    }
+                    text += piece;
+                    characters += CountCharacters(piece);
+                }
+            }
+            std::string emotes;
+            for (const auto& emote: emoteRanges)
+            {
+                if (!emotes.empty())
+                {
+                    emotes += '/';
+                }
+                emotes += emote.first + ":";
+                for (size_t range = 0; range < emote.second.size(); ++range)
+                {
+                    if (range > 0)
+                    {
+                        emotes += ',';
+                    }
+                    emotes += std::to_string(emote.second[range].first) + "-" + std::to_string(emote.second[range].second);
+                }
+            }
+            writer.Add(
+                time,
+                MakeChatTags(generator, name, userId, 1000 + channel, emotes, i, sentTime)
+                + " :" + name + "!" + name + "@" + name + ".tmi.twitch.tv PRIVMSG "
+                + channelName + " :" + text
+            );
+        }
+        writer.Finish();
+        messages = writer.GetLineCount();
+        return capture.Close();
+    }
+}
@@ -0,0 +1,192 @@
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Task.hpp>
+
+#ifdef TWITCH_BOT_COROUTINES
+
+#include <mutex>
+#include <new>
+
+namespace
+{
+    /**
+     * Frame sizes are rounded up to a multiple of this many bytes, and each
+     * rounded size has a pool of its own.
+     */
+    constexpr size_t FRAME_SIZE_GRANULARITY = 64;
+
+    /**
+     * This is the largest frame kept in a pool. Larger frames come straight
+     * from the heap.
+     */
+    constexpr size_t MAX_POOLED_FRAME_SIZE = 4096;
+
+    /**
+     * This is the number of pools.
+     */
+    constexpr size_t SIZE_CLASS_COUNT = MAX_POOLED_FRAME_SIZE / FRAME_SIZE_GRANULARITY;
+
+    /**
+     * This is the most frames of each size a thread keeps on hand.
+     */
+    constexpr size_t THREAD_CACHE_FRAMES = 64;
+
+    /**
+     * This is how many frames are moved at once between a thread and the
+     * pools shared by all threads.
+     */
+    constexpr size_t TRANSFER_FRAMES = THREAD_CACHE_FRAMES / 2;
+
+    /**
+     * This is the most memory kept in each of the shared pools, enough for
+     * many thousands of typical frames in flight at once. Any more goes
+     * back to the heap.
+     */
+    constexpr size_t MAX_SHARED_POOL_BYTES = 8 << 20;
+
+    /**
+     * This is laid over a frame while it's in a pool.
+     */
+    struct FreeFrame
+    {
+        FreeFrame* next;
+    };
+
+    /**
+     * This is a list of frames of one size which aren't in use.
+     */
+    struct FrameList
+    {
+        FreeFrame* head = nullptr;
+        size_t count = 0;
+
+        void Push(FreeFrame* frame)
+        {
+            frame->next = head;
+            head = frame;
+            ++count;
+        }
+
+        FreeFrame* Pop()
+        {
+            const auto frame = head;
+            head = frame->next;
+            --count;
+            return frame;
+        }
+    };
+
+    /**
+     * These are the pools shared by all threads.
+     */
+    struct SharedPools
+    {
+        std::mutex mutex;
+        FrameList lists[SIZE_CLASS_COUNT];
+    };
+
+    /**
+     * This returns the pools shared by all threads. They're never
+     * destroyed, so that threads which exit late can still give frames
+     * back.
+     */
+    SharedPools& GetSharedPools()
+    {
+        static auto pools = new SharedPools();
+        return *pools;
+    }
+
+    /**
+     * These are the frames a thread keeps on hand. What's left when the
+     * thread exits goes to the shared pools.
+     */
+    struct ThreadCache
+    {
+        FrameList lists[SIZE_CLASS_COUNT];
+
+        ~ThreadCache() noexcept
+        {
+            auto& pools = GetSharedPools();
+            std::lock_guard< decltype(pools.mutex) > lock(pools.mutex);
+            for (size_t i = 0; i < SIZE_CLASS_COUNT; ++i)
+            {
+                while (lists[i].count > 0)
+                {
+                    pools.lists[i].Push(lists[i].Pop());
+                }
+            }
+        }
+    };
+
+    /**
+     * These are the frames the current thread keeps on hand.
+     */
+    thread_local ThreadCache threadCache;
+
+    /**
+     * This returns which pool holds frames of the given size.
+     */
+    size_t GetSizeClass(size_t size)
+    {
+        return (size + FRAME_SIZE_GRANULARITY - 1) / FRAME_SIZE_GRANULARITY - 1;
+    }
+}
+
+namespace TwitchBot
+{
+    void* AllocateCoroutineFrame(size_t size)
+    {
+        if ((size == 0) || (size > MAX_POOLED_FRAME_SIZE))
+        {
+            return ::operator new(size);
+        }
+        const auto sizeClass = GetSizeClass(size);
+        auto& list = threadCache.lists[sizeClass];
+        if (list.count == 0)
+        {
+            auto& pools = GetSharedPools();
+            std::lock_guard< decltype(pools.mutex) > lock(pools.mutex);
+            auto& shared = pools.lists[sizeClass];
+            while ((shared.count > 0) && (list.count < TRANSFER_FRAMES))
+            {
+                list.Push(shared.Pop());
+            }
+        }
+        if (list.count == 0)
+        {
+            return ::operator new((sizeClass + 1) * FRAME_SIZE_GRANULARITY);
+        }
+        return list.Pop();
+    }
+
+    void FreeCoroutineFrame(void* frame, size_t size)
+    {
+        if ((size == 0) || (size > MAX_POOLED_FRAME_SIZE))
+        {
+            ::operator delete(frame);
+            return;
+        }
+        const auto sizeClass = GetSizeClass(size);
+        auto& list = threadCache.lists[sizeClass];
+        list.Push((FreeFrame*)frame);
+        if (list.count <= THREAD_CACHE_FRAMES)
+        {
+            return;
+        }
+        auto& pools = GetSharedPools();
+        std::lock_guard< decltype(pools.mutex) > lock(pools.mutex);
+        auto& shared = pools.lists[sizeClass];
+        while (list.count > THREAD_CACHE_FRAMES - TRANSFER_FRAMES)
+        {
+            const auto spare = list.Pop();
+            if (shared.count * (sizeClass + 1) * FRAME_SIZE_GRANULARITY < MAX_SHARED_POOL_BYTES)
+            {
+                shared.Push(spare);
+            }
+            else
+            {
+                ::operator delete(spare);
+            }
+        }
+    }
+}
+
+#endif /* TWITCH_BOT_COROUTINES */
@@ -0,0 +1,303 @@
+#include <utility>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TimerWheel.hpp>
+
+namespace
+{
+    /**
+     * This is the number of bits of the time covered by each wheel.
+     */
+    constexpr unsigned int SLOT_BITS = 6;
+
+    /**
+     * This is the number of slots in each wheel.
+     */
+    constexpr uint32_t SLOTS_PER_LEVEL = 1 << SLOT_BITS;
+
+    /**
+     * This is the number of wheels. Together they cover 2^36 ticks, which is
+     * over two years with millisecond ticks.
+     */
+    constexpr unsigned int LEVELS = 6;
+
+    /**
+     * This is the number of ticks covered by one turn of the outermost wheel.
+     */
+    constexpr uint64_t FULL_TURN = (uint64_t)1 << (SLOT_BITS * LEVELS);
+
+    /**
+     * This is the number of ticks covered by one slot of the outermost wheel.
+     */
+    constexpr uint64_t OUTER_SLOT_SPAN = (uint64_t)1 << (SLOT_BITS * (LEVELS - 1));
+
+    /**
+     * This is the longest time ahead which the wheels can represent. Timers
+     * further out are placed at the edge and moved inward again later. It's
+     * one outer slot short of a full turn, so that a timer in the next turn
+     * never lands in the outer slot currently being passed through.
+     */
+    constexpr uint64_t MAX_SPAN = FULL_TURN - OUTER_SLOT_SPAN;
+
+    /**
+     * This is the slot which holds timers which are due.
+     */
+    constexpr uint32_t DUE_SLOT = LEVELS * SLOTS_PER_LEVEL;
+
+    /**
+     * This marks the end of a list of nodes, or a node not in any slot.
+     */
+    constexpr uint32_t NONE = 0xFFFFFFFF;
+
+    /**
+     * This returns which wheel should hold a timer with the given deadline.
+     */
+    unsigned int GetLevel(uint64_t now, uint64_t deadline)
+    {
+        const auto differing = (now ^ deadline) | (SLOTS_PER_LEVEL - 1);
+        const auto significantBit = 63 - __builtin_clzll(differing);
+        const auto level = (unsigned int)significantBit / SLOT_BITS;
+        return (level < LEVELS) ? level : (LEVELS - 1);
+    }
+}
+
+namespace TwitchBot
+{
+    TimerWheel::~TimerWheel() noexcept = default;
+
+    TimerWheel::TimerWheel(uint64_t now)
+        : heads_(DUE_SLOT + 1, NONE)
+        , tails_(DUE_SLOT + 1, NONE)
+        , occupied_(LEVELS, 0)
+        , freeList_(NONE)
+        , now_(now)
+    {
+    }
+
+    TimerWheel::TimerId TimerWheel::Schedule(uint64_t deadline, Callback callback)
+    {
+        uint32_t index;
+        if (freeList_ == NONE)
+        {
+            index = (uint32_t)nodes_.size();
+            nodes_.emplace_back();
+        }
+        else
+        {
+            index = freeList_;
+            freeList_ = nodes_[index].next;
+        }
+        auto& node = nodes_[index];
+        node.deadline = deadline;
+        node.callback = std::move(callback);
+        ++count_;
+        Insert(index);
+        return ((TimerId)(node.generation + 1) << 32) | index;
+    }
+
+    bool TimerWheel::Cancel(TimerId id)
+    {
+        const auto index = (uint32_t)(id & 0xFFFFFFFF);
+        const auto generation = (uint32_t)(id >> 32) - 1;
+        if (
+            (index >= nodes_.size())
+            || (nodes_[index].generation != generation)
+            || (nodes_[index].slot == NONE)
+        )
+        {
+            return false;
+        }
+        Unlink(index);
+        Release(index);
+        return true;
+    }
+
+    size_t TimerWheel::Advance(uint64_t now)
+    {
+        size_t expired = 0;
+        while (true)
+        {
+            // Move everything in the next slot to be reached either into an
+            // inner wheel or into the slot of due timers.
+            uint32_t slot;
+            uint64_t expiration;
+            if (
+                (heads_[DUE_SLOT] == NONE)
+                && FindNextSlot(slot, expiration)
+                && (expiration <= now)
+            )
+            {
+                if (expiration > now_)
+                {
+                    now_ = expiration;
+                }
+                occupied_[slot / SLOTS_PER_LEVEL] &= ~((uint64_t)1 << (slot % SLOTS_PER_LEVEL));
+                auto index = heads_[slot];
+                heads_[slot] = NONE;
+                tails_[slot] = NONE;
+                while (index != NONE)
+                {
+                    const auto next = nodes_[index].next;
+                    nodes_[index].slot = NONE;
+                    Insert(index);
+                    index = next;
+                }
+                continue;
+            }
+
+            // Call the due timers one at a time, so that their functions can
+            // safely cancel any other timer.
+            const auto index = heads_[DUE_SLOT];
+            if (index == NONE)
+            {
+                break;
+            }
+            Unlink(index);
+            auto callback = std::move(nodes_[index].callback);
+            Release(index);
+            ++expired;
+            if (callback != nullptr)
+            {
+                callback();
+            }
+        }
+        if (now > now_)
+        {
+            now_ = now;
+        }
+        return expired;
+    }
+
+    bool TimerWheel::GetNextDeadline(uint64_t& deadline) const
+    {
+        if (heads_[DUE_SLOT] != NONE)
+        {
+            deadline = now_;
+            return true;
+        }
+        uint32_t slot;
+        return FindNextSlot(slot, deadline);
+    }
+
+    uint64_t TimerWheel::GetNow() const
+    {
+        return now_;
+    }
+
+    size_t TimerWheel::GetCount() const
+    {
+        return count_;
+    }
+
+    bool TimerWheel::Empty() const
+    {
+        return (count_ == 0);
+    }
+
+    void TimerWheel::Insert(uint32_t index)
+    {
+        const auto deadline = nodes_[index].deadline;
+        if (deadline <= now_)
+        {
+            Link(index, DUE_SLOT);
+            return;
+        }
+
+        // Timers beyond what the wheels can represent are placed at the far
+        // edge, and placed again when that slot is reached.
+        const auto placement = (deadline - now_ > MAX_SPAN) ? (now_ + MAX_SPAN) : deadline;
+        const auto level = GetLevel(now_, placement);
+        const auto slotInLevel = (uint32_t)(placement >> (level * SLOT_BITS)) & (SLOTS_PER_LEVEL - 1);
+        occupied_[level] |= (uint64_t)1 << slotInLevel;
+        Link(index, level * SLOTS_PER_LEVEL + slotInLevel);
+    }
+
+    void TimerWheel::Link(uint32_t index, uint32_t slot)
+    {
+        auto& node = nodes_[index];
+        node.slot = slot;
+        node.previous = tails_[slot];
+        node.next = NONE;
+        if (node.previous == NONE)
+        {
+            heads_[slot] = index;
+        }
+        else
+        {
+            nodes_[node.previous].next = index;
+        }
+        tails_[slot] = index;
+    }
+
+    void TimerWheel::Unlink(uint32_t index)
+    {
+        auto& node = nodes_[index];
+        if (node.previous == NONE)
+        {
+            heads_[node.slot] = node.next;
+        }
+        else
+        {
+            nodes_[node.previous].next = node.next;
+        }
+        if (node.next == NONE)
+        {
+            tails_[node.slot] = node.previous;
+        }
+        else
+        {
+            nodes_[node.next].previous = node.previous;
+        }
+        if ((heads_[node.slot] == NONE) && (node.slot != DUE_SLOT))
+        {
+            occupied_[node.slot / SLOTS_PER_LEVEL] &= ~((uint64_t)1 << (node.slot % SLOTS_PER_LEVEL));
+        }
+        node.slot = NONE;
+    }
+
+    void TimerWheel::Release(uint32_t index)
+    {
+        auto& node = nodes_[index];
+        node.callback = nullptr;
+        ++node.generation;
+        node.next = freeList_;
+        freeList_ = index;
+        --count_;
+    }
+
+    bool TimerWheel::FindNextSlot(uint32_t& slot, uint64_t& expiration) const
+    {
+        // Timers in an inner wheel always expire before those in an outer
+        // wheel, so the first occupied slot found, starting from the
+        // innermost wheel, is the next one reached.
+        for (unsigned int level = 0; level < LEVELS; ++level)
+        {
+            const auto shift = level * SLOT_BITS;
+            const auto current = (unsigned int)(now_ >> shift) & (SLOTS_PER_LEVEL - 1);
+            const auto turnMask = ((uint64_t)1 << (shift + SLOT_BITS)) - 1;
+            const auto ahead = occupied_[level] >> current;
+            unsigned int slotInLevel;
+            if (ahead != 0)
+            {
+                slotInLevel = current + (unsigned int)__builtin_ctzll(ahead);
+                expiration = (now_ & ~turnMask) + ((uint64_t)slotInLevel << shift);
+            }
+            else if ((level == LEVELS - 1) && (occupied_[level] != 0))
+            {
+                // Slots of the outermost wheel behind the current one hold
+                // timers for its next turn.
+                slotInLevel = (unsigned int)__builtin_ctzll(occupied_[level]);
+                expiration = (now_ & ~turnMask) + FULL_TURN + ((uint64_t)slotInLevel << shift);
+            }
+            else
+            {
+                continue;
+            }
+            slot = level * SLOTS_PER_LEVEL + slotInLevel;
+            if (expiration < now_)
+            {
+                expiration = now_;
+            }
+            return true;
+        }
+        return false;
+    }
+}
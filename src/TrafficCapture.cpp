@@ -0,0 +1,240 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TrafficCapture.hpp>
+
+namespace
+{
+    /**
+     * This is the signature at the start of every capture file.
+     */
+    constexpr char CAPTURE_SIGNATURE[8] = {'T', 'W', 'B', 'C', 'A', 'P', '0', '1'};
+
+    /**
+     * This is how much is gathered in memory before it's written to the
+     * capture file.
+     */
+    constexpr size_t WRITE_BLOCK_SIZE = 1 << 20;
+
+    /**
+     * This appends a variable-length integer to the given text.
+     */
+    void AppendNumber(std::string& text, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            text.push_back((char)((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        text.push_back((char)value);
+    }
+
+    /**
+     * This reads a variable-length integer at the given offset of the given
+     * data, advancing the offset past it.
+     *
+     * @return an indication of whether or not the whole number was there is
+     * returned.
+     */
+    bool ReadNumber(const char* data, size_t size, size_t& position, uint64_t& value)
+    {
+        value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7)
+        {
+            if (position >= size)
+            {
+                return false;
+            }
+            const auto byte = (uint8_t)data[position++];
+            value |= (uint64_t)(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+namespace TwitchBot
+{
+    CaptureWriter::~CaptureWriter() noexcept
+    {
+        (void)Close();
+    }
+
+    CaptureWriter::CaptureWriter() = default;
+
+    bool CaptureWriter::Open(const std::string& path)
+    {
+        std::lock_guard< decltype(mutex_) > lock(mutex_);
+        if (file_ >= 0)
+        {
+            return false;
+        }
+        file_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (file_ < 0)
+        {
+            return false;
+        }
+        buffer_.reserve(WRITE_BLOCK_SIZE + 4096);
+        buffer_.assign(CAPTURE_SIGNATURE, sizeof(CAPTURE_SIGNATURE));
+        lastTime_ = 0;
+        recordCount_ = 0;
+        failed_ = false;
+        return true;
+    }
+
+    void CaptureWriter::Record(uint64_t time, std::string_view data)
+    {
+        std::lock_guard< decltype(mutex_) > lock(mutex_);
+        if (file_ < 0)
+        {
+            return;
+        }
+        if (time < lastTime_)
+        {
+            time = lastTime_;
+        }
+        AppendNumber(buffer_, time - lastTime_);
+        AppendNumber(buffer_, data.length());
+        buffer_.append(data);
+        lastTime_ = time;
+        ++recordCount_;
+        if (buffer_.length() >= WRITE_BLOCK_SIZE)
+        {
+            Flush();
+        }
+    }
+
+    bool CaptureWriter::Close()
+    {
+        std::lock_guard< decltype(mutex_) > lock(mutex_);
+        if (file_ < 0)
+        {
+            return false;
+        }
+        Flush();
+        if (close(file_) != 0)
+        {
+            failed_ = true;
+        }
+        file_ = -1;
+        return !failed_;
+    }
+
+    uint64_t CaptureWriter::GetRecordCount() const
+    {
+        std::lock_guard< decltype(mutex_) > lock(mutex_);
+        return recordCount_;
+    }
+
+    void CaptureWriter::Flush()
+    {
+        size_t written = 0;
+        while (written < buffer_.length())
+        {
+            const auto result = write(file_, buffer_.data() + written, buffer_.length() - written);
+            if (result < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                failed_ = true;
+                break;
+            }
+            written += (size_t)result;
+        }
+        buffer_.clear();
+    }
+
+    CaptureReader::~CaptureReader() noexcept
+    {
+        Close();
+    }
+
+    CaptureReader::CaptureReader() = default;
+
+    bool CaptureReader::Open(const std::string& path)
+    {
+        Close();
+        const auto file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0)
+        {
+            return false;
+        }
+        struct stat status;
+        if (
+            (fstat(file, &status) != 0)
+            || ((size_t)status.st_size < sizeof(CAPTURE_SIGNATURE))
+        )
+        {
+            (void)close(file);
+            return false;
+        }
+        const auto mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        (void)close(file);
+        if (mapping == MAP_FAILED)
+        {
+            return false;
+        }
+        data_ = (const char*)mapping;
+        size_ = (size_t)status.st_size;
+        if (memcmp(data_, CAPTURE_SIGNATURE, sizeof(CAPTURE_SIGNATURE)) != 0)
+        {
+            Close();
+            return false;
+        }
+        (void)madvise(mapping, size_, MADV_SEQUENTIAL);
+        Rewind();
+        return true;
+    }
+
+    void CaptureReader::Close()
+    {
+        if (data_ != nullptr)
+        {
+            (void)munmap((void*)data_, size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+        position_ = 0;
+        time_ = 0;
+    }
+
+    bool CaptureReader::Next(Record& record)
+    {
+        auto position = position_;
+        uint64_t delay;
+        uint64_t length;
+        if (
+            (data_ == nullptr)
+            || !ReadNumber(data_, size_, position, delay)
+            || !ReadNumber(data_, size_, position, length)
+            || (length > size_ - position)
+        )
+        {
+            return false;
+        }
+        time_ += delay;
+        record.time = time_;
+        record.data = std::string_view(data_ + position, (size_t)length);
+        position_ = position + (size_t)length;
+        return true;
+    }
+
+    void CaptureReader::Rewind()
+    {
+        position_ = sizeof(CAPTURE_SIGNATURE);
+        time_ = 0;
+    }
+
+    size_t CaptureReader::GetSize() const
+    {
+        return size_;
+    }
+}
@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LineFramer.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageTokenizer.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SimulatedTimeKeeper.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TrafficCapture.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TrafficReplayer.hpp>
+
+namespace
+{
+    /**
+     * This is how long to wait for the manager to connect, or to deliver
+     * another message, before giving up on it.
+     */
+    constexpr auto STALL_TIMEOUT = std::chrono::seconds(5);
+
+    /**
+     * This is fed to the manager before the capture, so that it's logged in
+     * even if the capture starts after the server's welcome. It isn't
+     * counted in the measurements.
+     */
+    constexpr char WARM_UP_LINE[] = ":tmi.twitch.tv 376 replay :>\r\n";
+
+    /**
+     * This returns the steady clock time, in nanoseconds.
+     */
+    int64_t Now()
+    {
+        return std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    /**
+     * This is the Connection handed to the manager during a replay. It
+     * hands the manager whatever the replayer feeds it, and throws away
+     * whatever the manager sends.
+     */
+    class ReplayConnection
+        : public TwitchBot::Connection
+    {
+    public:
+        /**
+         * This method feeds a chunk of the capture to the manager.
+         */
+        void Feed(const std::string& data)
+        {
+            messageReceivedDelegate_(data);
+        }
+
+        /**
+         * This method waits for the manager to connect.
+         *
+         * @return an indication of whether or not the manager connected
+         * in time is returned.
+         */
+        bool AwaitConnect()
+        {
+            std::unique_lock< decltype(mutex_) > lock(mutex_);
+            return connectedCondition_.wait_for(
+                lock,
+                STALL_TIMEOUT,
+                [this]{ return connected_; }
+            );
+        }
+
+    // TwitchBot::Connection
+    public:
+        virtual void SetMessageReceivedDelegate(MessageReceivedDelegate messageReceivedDelegate) override
+        {
+            messageReceivedDelegate_ = messageReceivedDelegate;
+        }
+
+        virtual void SetDisconnectedDelegate(DisconnectedDelegate disconnectedDelegate) override
+        {
+            (void)disconnectedDelegate;
+        }
+
+        virtual bool Connect() override
+        {
+            std::lock_guard< decltype(mutex_) > lock(mutex_);
+            connected_ = true;
+            connectedCondition_.notify_all();
+            return true;
+        }
+
+        virtual bool Disconnect() override
+        {
+            return true;
+        }
+
+        virtual void Send(const std::string& message) override
+        {
+            (void)message;
+        }
+
+    private:
+        MessageReceivedDelegate messageReceivedDelegate_;
+        std::mutex mutex_;
+        std::condition_variable connectedCondition_;
+        bool connected_ = false;
+    };
+
+    /**
+     * This returns the given percentile of the given sorted latencies.
+     */
+    double Percentile(const std::vector< int64_t >& latencies, double fraction)
+    {
+        if (latencies.empty())
+        {
+            return 0.0;
+        }
+        const auto index = std::min(
+            latencies.size() - 1,
+            (size_t)(fraction * (double)latencies.size())
+        );
+        return (double)latencies[index] / 1000.0;
+    }
+}
+
+namespace TwitchBot
+{
+    /**
+     * This contains the private properties of a TrafficReplayer instance.
+     */
+    struct TrafficReplayer::Impl
+    {
+        /**
+         * This is the function to call for each message received during a
+         * replay.
+         */
+        MessageManager::MessageReceivedDelegate messageReceivedDelegate;
+
+        /**
+         * This is the spam detector to check each message received during a
+         * replay, if any.
+         */
+        std::shared_ptr< SpamDetector > spamDetector;
+    };
+
+    TrafficReplayer::~TrafficReplayer() noexcept = default;
+
+    TrafficReplayer::TrafficReplayer()
+        : impl_(new Impl())
+    {
+    }
+
+    void TrafficReplayer::SetMessageReceivedDelegate(MessageManager::MessageReceivedDelegate messageReceivedDelegate)
+    {
+        impl_->messageReceivedDelegate = messageReceivedDelegate;
+    }
+
+    void TrafficReplayer::SetSpamDetector(std::shared_ptr< SpamDetector > spamDetector)
+    {
+        impl_->spamDetector = spamDetector;
+    }
+
+    bool TrafficReplayer::Replay(
+        const std::string& path,
+        Pace pace,
+        Report& report
+    )
+    {
+        report = Report();
+        CaptureReader capture;
+        if (!capture.Open(path))
+        {
+            return false;
+        }
+
+        // Work out ahead of time how many messages the manager should have
+        // delivered once it has taken in each chunk, framing and tokenizing
+        // the capture the same way the manager does.
+        std::vector< uint64_t > messagesThrough;
+        std::vector< double > recordedAt;
+        {
+            LineFramer framer;
+            CaptureReader::Record record;
+            MessageTokens tokens;
+            std::string_view line;
+            uint64_t messages = 0;
+            while (capture.Next(record))
+            {
+                framer.Append(record.data.data(), record.data.length());
+                while (framer.NextLine(line))
+                {
+                    if (TokenizeMessage(line, tokens))
+                    {
+                        ++messages;
+                    }
+                }
+                messagesThrough.push_back(messages);
+                recordedAt.push_back((double)record.time / 1e9);
+                report.bytes += record.data.length();
+                report.captureSeconds = (double)record.time / 1e9;
+            }
+            report.chunks = messagesThrough.size();
+            report.messages = messages;
+            capture.Rewind();
+        }
+
+        // The delegate runs on the manager's worker thread. It finds the
+        // chunks completed by each message delivered, and measures them from
+        // when they were fed.
+        std::vector< int64_t > fedAt(messagesThrough.size(), 0);
+        std::vector< int64_t > latencies;
+        latencies.reserve(messagesThrough.size());
+        std::vector< int64_t > detectionLatencies;
+        std::mutex mutex;
+        std::condition_variable deliveredCondition;
+        uint64_t delivered = 0;
+        bool warmingUp = true;
+        size_t nextChunk = 0;
+        uint64_t checked = 0;
+        int64_t lastDeliveredAt = 0;
+        const auto userDelegate = impl_->messageReceivedDelegate;
+        const auto spamDetector = impl_->spamDetector;
+        const auto timeKeeper = std::make_shared< SimulatedTimeKeeper >();
+        const auto connection = std::make_shared< ReplayConnection >();
+        {
+            MessageManager manager;
+            manager.SetTimeKeeper(timeKeeper);
+
+            // The server's answers to the manager's own keepalive PINGs
+            // can't be in the capture, so once a minute of it had gone by,
+            // the manager would give up on the connection.
+            manager.SetKeepAlive(0.0, 0.0);
+            manager.SetConnectionFactory(
+                [connection]{ return connection; }
+            );
+            manager.SetMessageReceivedDelegate(
+                [&](const Message& message)
+                {
+                    if (userDelegate != nullptr)
+                    {
+                        userDelegate(message);
+                    }
+
+                    // The detector checks each message as part of the work
+                    // being measured, at the time of the first chunk through
+                    // which as many messages were in the capture. Messages
+                    // are only delivered on the worker thread, so the count
+                    // checked is kept without the lock; the first message is
+                    // the warm-up line.
+                    SpamVerdict verdict;
+                    size_t spamChunk = messagesThrough.size();
+                    if (spamDetector != nullptr)
+                    {
+                        if (checked > 0)
+                        {
+                            spamChunk = (size_t)(
+                                std::lower_bound(
+                                    messagesThrough.begin(),
+                                    messagesThrough.end(),
+                                    checked
+                                ) - messagesThrough.begin()
+                            );
+                            if (spamChunk < messagesThrough.size())
+                            {
+                                verdict = spamDetector->Check(message, recordedAt[spamChunk]);
+                            }
+                        }
+                        ++checked;
+                    }
+                    const auto now = Now();
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    if (warmingUp)
+                    {
+                        warmingUp = false;
+                        deliveredCondition.notify_all();
+                        return;
+                    }
+                    ++delivered;
+                    lastDeliveredAt = now;
+                    if (verdict.reason != SpamReason::None)
+                    {
+                        detectionLatencies.push_back(now - fedAt[spamChunk]);
+                    }
+                    while (
+                        (nextChunk < messagesThrough.size())
+                        && (messagesThrough[nextChunk] <= delivered)
+                    )
+                    {
+                        const auto previous = (
+                            (nextChunk == 0)
+                            ? 0
+                            : messagesThrough[nextChunk - 1]
+                        );
+                        if (messagesThrough[nextChunk] > previous)
+                        {
+                            latencies.push_back(now - fedAt[nextChunk]);
+                        }
+                        ++nextChunk;
+                    }
+                    deliveredCondition.notify_all();
+                }
+            );
+            manager.LogIn("replay", "replay");
+            if (!connection->AwaitConnect())
+            {
+                return false;
+            }
+            connection->Feed(WARM_UP_LINE);
+            {
+                std::unique_lock< decltype(mutex) > lock(mutex);
+                if (
+                    !deliveredCondition.wait_for(
+                        lock,
+                        STALL_TIMEOUT,
+                        [&]{ return !warmingUp; }
+                    )
+                )
+                {
+                    return false;
+                }
+            }
+
+            // Feed the capture.
+            const auto start = Now();
+            CaptureReader::Record record;
+            std::string data;
+            for (size_t chunk = 0; capture.Next(record); ++chunk)
+            {
+                if (pace == Pace::RealTime)
+                {
+                    std::this_thread::sleep_until(
+                        std::chrono::steady_clock::time_point(
+                            std::chrono::nanoseconds(start + (int64_t)record.time)
+                        )
+                    );
+                }
+                timeKeeper->SetCurrentTime((double)record.time / 1e9);
+                data.assign(record.data);
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    fedAt[chunk] = Now();
+                }
+                connection->Feed(data);
+            }
+
+            // Wait for the manager to catch up, as long as it keeps making
+            // progress.
+            {
+                std::unique_lock< decltype(mutex) > lock(mutex);
+                while (delivered < report.messages)
+                {
+                    const auto before = delivered;
+                    (void)deliveredCondition.wait_for(
+                        lock,
+                        STALL_TIMEOUT,
+                        [&]{ return delivered != before; }
+                    );
+                    if (delivered == before)
+                    {
+                        break;
+                    }
+                }
+                report.messagesDelivered = delivered;
+                report.seconds = (double)(std::max(lastDeliveredAt, start) - start) / 1e9;
+            }
+            report.manager = manager.GetStats();
+            manager.LogOut("");
+        }
+
+        if (report.seconds > 0.0)
+        {
+            report.messagesPerSecond = (double)report.messagesDelivered / report.seconds;
+            report.bytesPerSecond = (double)report.bytes / report.seconds;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        report.latencyP50 = Percentile(latencies, 0.50);
+        report.latencyP99 = Percentile(latencies, 0.99);
+        report.latencyP999 = Percentile(latencies, 0.999);
+        report.spamMessages = detectionLatencies.size();
+        std::sort(detectionLatencies.begin(), detectionLatencies.end());
+        report.detectionLatencyP50 = Percentile(detectionLatencies, 0.50);
+        report.detectionLatencyP99 = Percentile(detectionLatencies, 0.99);
+        report.detectionLatencyP999 = Percentile(detectionLatencies, 0.999);
+        return true;
+    }
+}
@@ -1,11 +1,208 @@
-#include <algorithm>
-#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 
-int main()
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageManager.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/RecordingConnection.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SocketConnection.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SyntheticCapture.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TrafficCapture.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TrafficReplayer.hpp>
+
+namespace
+{
+    /**
+     * This prints how to use the program.
+     */
+    void PrintUsage(const char* program)
+    {
+        fprintf(
+            stderr,
+            (
+                "usage: %s record <host> <port> <nickname> <token> <seconds> <file> [channel...]\n"
+                "       %s replay <file> [--realtime]\n"
+                "       %s synthesize <file> [chat lines] [seed]\n"
+            ),
+            program,
+            program,
+            program
+        );
+    }
+
+    /**
+     * This logs into a Twitch server, joins the given channels, and records
+     * everything received for the given time.
+     */
+    int Record(int argc, char* argv[])
+    {
+        if (argc < 8)
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        const std::string host = argv[2];
+        const auto port = (uint16_t)atoi(argv[3]);
+        const std::string nickname = argv[4];
+        const std::string token = argv[5];
+        const auto seconds = atof(argv[6]);
+        const std::string path = argv[7];
+        const std::vector< std::string > channels(argv + 8, argv + argc);
+
+        const auto capture = std::make_shared< TwitchBot::CaptureWriter >();
+        if (!capture->Open(path))
+        {
+            fprintf(stderr, "unable to create %s\n", path.c_str());
+            return 1;
+        }
+        {
+            TwitchBot::MessageManager manager;
+            manager.SetConnectionFactory(
+                [host, port, capture]
+                {
+                    return std::make_shared< TwitchBot::RecordingConnection >(
+                        std::make_shared< TwitchBot::SocketConnection >(host, port),
+                        capture
+                    );
+                }
+            );
+            manager.SetLoggedInDelegate(
+                [&manager, channels]{ manager.Join(channels); }
+            );
+            manager.LogIn(nickname, token);
+            std::this_thread::sleep_for(std::chrono::duration< double >(seconds));
+            manager.LogOut("");
+        }
+        const auto chunks = capture->GetRecordCount();
+        if (!capture->Close())
+        {
+            fprintf(stderr, "unable to write %s\n", path.c_str());
+            return 1;
+        }
+        printf("recorded %llu chunks to %s\n", (unsigned long long)chunks, path.c_str());
+        return 0;
+    }
+
+    /**
+     * This replays a capture through a MessageManager and prints the
+     * measurements.
+     */
+    int Replay(int argc, char* argv[])
+    {
+        if (argc < 3)
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        auto pace = TwitchBot::TrafficReplayer::Pace::FullSpeed;
+        if ((argc > 3) && (strcmp(argv[3], "--realtime") == 0))
+        {
+            pace = TwitchBot::TrafficReplayer::Pace::RealTime;
+        }
+        TwitchBot::TrafficReplayer replayer;
+        TwitchBot::TrafficReplayer::Report report;
+        if (!replayer.Replay(argv[2], pace, report))
+        {
+            fprintf(stderr, "unable to replay %s\n", argv[2]);
+            return 1;
+        }
+        printf(
+            (
+                "chunks:        %llu (%.3f s captured)\n"
+                "bytes:         %llu\n"
+                "messages:      %llu (%llu delivered)\n"
+                "elapsed:       %.6f s\n"
+                "messages/sec:  %.0f\n"
+                "bytes/sec:     %.0f\n"
+                "latency p50:   %.2f us\n"
+                "latency p99:   %.2f us\n"
+                "latency p999:  %.2f us\n"
+            ),
+            (unsigned long long)report.chunks,
+            report.captureSeconds,
+            (unsigned long long)report.bytes,
+            (unsigned long long)report.messages,
+            (unsigned long long)report.messagesDelivered,
+            report.seconds,
+            report.messagesPerSecond,
+            report.bytesPerSecond,
+            report.latencyP50,
+            report.latencyP99,
+            report.latencyP999
+        );
+        const struct
+        {
+            const char* name;
+            const TwitchBot::LatencyHistogram::Summary& summary;
+        } stages[] = {
+            {"queue wait", report.manager.queueWait},
+            {"parse", report.manager.parse},
+            {"dispatch", report.manager.dispatch},
+        };
+        for (const auto& stage: stages)
+        {
+            printf(
+                "%-13s  p50 %llu ns, p99 %llu ns, p999 %llu ns, max %llu ns (%llu timed)\n",
+                stage.name,
+                (unsigned long long)stage.summary.p50,
+                (unsigned long long)stage.summary.p99,
+                (unsigned long long)stage.summary.p999,
+                (unsigned long long)stage.summary.max,
+                (unsigned long long)stage.summary.count
+            );
+        }
+        return ((report.messagesDelivered == report.messages) ? 0 : 1);
+    }
+
+    /**
+     * This writes a capture of made-up traffic, to replay in place of a
+     * recording.
+     */
+    int Synthesize(int argc, char* argv[])
+    {
+        if (argc < 3)
+        {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        TwitchBot::SyntheticCaptureSettings settings;
+        if (argc > 3)
+        {
+            settings.chatLines = (size_t)strtoull(argv[3], nullptr, 10);
+        }
+        if (argc > 4)
+        {
+            settings.seed = (uint64_t)strtoull(argv[4], nullptr, 10);
+        }
+        uint64_t messages;
+        if (!TwitchBot::WriteSyntheticCapture(argv[2], settings, messages))
+        {
+            fprintf(stderr, "unable to write %s\n", argv[2]);
+            return 1;
+        }
+        printf("wrote %llu messages to %s\n", (unsigned long long)messages, argv[2]);
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[])
 {
-    std::string str = "H e l l o";
-    str.erase(remove(str.begin(), str.end(), ' '), str.end());
-    std::cout << str; // Output Hello
-    
-    return 0;
+    if ((argc >= 2) && (strcmp(argv[1], "record") == 0))
+    {
+        return Record(argc, argv);
+    }
+    if ((argc >= 2) && (strcmp(argv[1], "replay") == 0))
+    {
+        return Replay(argc, argv);
+    }
+    if ((argc >= 2) && (strcmp(argv[1], "synthesize") == 0))
+    {
+        return Synthesize(argc, argv);
+    }
+    PrintUsage(argv[0]);
+    return 1;
 }
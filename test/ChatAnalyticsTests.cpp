@@ -0,0 +1,309 @@
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/ChatAnalytics.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::ChatAnalytics;
+
+    /**
+     * This returns an indication of whether or not the given estimate is
+     * within the given fraction of the exact value.
+     */
+    bool IsClose(uint64_t estimate, size_t exact, double fraction)
+    {
+        return (fabs((double)estimate - (double)exact) <= fraction * (double)exact);
+    }
+
+    /**
+     * This picks numbers from zero up to the given count, with smaller
+     * numbers far more likely, the way a few words make up much of chat.
+     */
+    class Skewed
+    {
+        public:
+            Skewed(size_t count)
+            {
+                double total = 0.0;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    total += 1.0 / pow((double)(i + 1), 1.2);
+                    cumulative_.push_back(total);
+                }
+            }
+
+            size_t Pick(std::mt19937& generator)
+            {
+                const auto target = std::uniform_real_distribution< double >(0.0, cumulative_.back())(generator);
+                return (size_t)(
+                    std::lower_bound(cumulative_.begin(), cumulative_.end(), target)
+                    - cumulative_.begin()
+                );
+            }
+
+        private:
+            std::vector< double > cumulative_;
+    };
+
+    void TestUserCounts()
+    {
+        // The relative error of the sketches with the default settings is
+        // about 1.6%, so being off by 6% is most unlikely.
+        ChatAnalytics analytics;
+        std::mt19937 generator(5);
+        std::set< uint64_t > users;
+        size_t checked = 0;
+        for (const size_t target: {10, 1000, 20000, 200000})
+        {
+            while (users.size() < target)
+            {
+                // Users chat more than once, so draw from a pool larger
+                // than the number of users wanted so far.
+                const auto user = 1 + generator() % (target * 2);
+                (void)users.insert(user);
+                analytics.Add("chan", std::to_string(user), "hi", "", 10.0);
+            }
+            ChatAnalytics::ChannelSnapshot snapshot;
+            TWITCH_BOT_CHECK(analytics.GetSnapshot("chan", 10.0, snapshot));
+            if (target <= 1000)
+            {
+                TWITCH_BOT_CHECK(IsClose(snapshot.users, users.size(), 0.02));
+            }
+            TWITCH_BOT_CHECK(IsClose(snapshot.users, users.size(), 0.06));
+            TWITCH_BOT_CHECK(snapshot.windowUsers == snapshot.users);
+            ++checked;
+        }
+        TWITCH_BOT_CHECK(checked == 4);
+    }
+
+    void TestWindowUserCounts()
+    {
+        ChatAnalytics::Settings settings;
+        settings.window = 60.0;
+        ChatAnalytics analytics(settings);
+
+        // One crowd chats in the first window, and a smaller one, half of
+        // which was also in the first, in the second.
+        for (size_t user = 0; user < 5000; ++user)
+        {
+            analytics.Add("chan", "user" + std::to_string(user), "hi", "", 10.0 + (double)user * 0.001);
+        }
+        for (size_t user = 2500; user < 4500; ++user)
+        {
+            analytics.Add("chan", "user" + std::to_string(user), "hi", "", 70.0 + (double)user * 0.001);
+        }
+        ChatAnalytics::ChannelSnapshot snapshot;
+        TWITCH_BOT_CHECK(analytics.GetSnapshot("chan", 80.0, snapshot));
+        TWITCH_BOT_CHECK(IsClose(snapshot.users, 5000, 0.06));
+        TWITCH_BOT_CHECK(IsClose(snapshot.windowUsers, 2000, 0.06));
+        TWITCH_BOT_CHECK(IsClose(snapshot.lastWindowUsers, 5000, 0.06));
+
+        // Skipping a window leaves nobody in the last one.
+        analytics.Add("chan", "late", "hi", "", 200.0);
+        TWITCH_BOT_CHECK(analytics.GetSnapshot("chan", 200.0, snapshot));
+        TWITCH_BOT_CHECK(snapshot.windowUsers == 1);
+        TWITCH_BOT_CHECK(snapshot.lastWindowUsers == 0);
+    }
+
+    void TestTopWordsAndEmotes()
+    {
+        ChatAnalytics::Settings settings;
+        settings.window = 1e9;
+        ChatAnalytics analytics(settings);
+        std::mt19937 generator(9);
+        std::vector< std::string > vocabulary;
+        for (size_t i = 0; i < 3000; ++i)
+        {
+            std::string word;
+            const auto length = 3 + generator() % 6;
+            for (size_t j = 0; j < length; ++j)
+            {
+                word += (char)('a' + generator() % 26);
+            }
+            vocabulary.push_back(word);
+        }
+        const std::vector< std::string > emoteNames = {
+            "Kappa", "PogChamp", "LUL", "KEKW", "\xf0\x9f\x98\x82", "catJAM",
+        };
+        Skewed words(vocabulary.size());
+        Skewed emotes(emoteNames.size());
+        std::unordered_map< std::string, uint64_t > wordCounts;
+        std::map< std::string, uint64_t > emoteCounts;
+        for (size_t i = 0; i < 30000; ++i)
+        {
+            // Lines start with a word in another script, so that emote
+            // positions, which count characters, differ from byte offsets.
+            std::string text = "\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82";
+            wordCounts["\xd0\xbf\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82"] += 1;
+            size_t characters = 6;
+            std::map< size_t, std::vector< std::pair< size_t, size_t > > > spans;
+            const auto length = 1 + generator() % 8;
+            for (size_t j = 0; j < length; ++j)
+            {
+                text += ' ';
+                ++characters;
+                if ((generator() % 4) == 0)
+                {
+                    const auto emote = emotes.Pick(generator);
+                    const auto& name = emoteNames[emote];
+                    const size_t nameCharacters = (emote == 4) ? 1 : name.length();
+                    spans[emote].emplace_back(characters, characters + nameCharacters - 1);
+                    text += name;
+                    characters += nameCharacters;
+                    ++emoteCounts[name];
+
+                    // Emote names are words too.
+                    std::string folded(name);
+                    std::transform(
+                        folded.begin(),
+                        folded.end(),
+                        folded.begin(),
+                        [](char c){ return (char)tolower((unsigned char)c); }
+                    );
+                    ++wordCounts[folded];
+                }
+                else
+                {
+                    const auto& word = vocabulary[words.Pick(generator)];
+                    text += word;
+                    characters += word.length();
+                    ++wordCounts[word];
+                }
+            }
+            std::string tag;
+            for (const auto& emote: spans)
+            {
+                if (!tag.empty())
+                {
+                    tag += '/';
+                }
+                tag += std::to_string(100 + emote.first) + ":";
+                for (size_t j = 0; j < emote.second.size(); ++j)
+                {
+                    if (j > 0)
+                    {
+                        tag += ',';
+                    }
+                    tag += std::to_string(emote.second[j].first) + "-" + std::to_string(emote.second[j].second);
+                }
+            }
+            analytics.Add("chan", "user" + std::to_string(i % 100), text, tag, 10.0);
+        }
+        ChatAnalytics::ChannelSnapshot snapshot;
+        TWITCH_BOT_CHECK(analytics.GetSnapshot("chan", 10.0, snapshot));
+        TWITCH_BOT_CHECK(snapshot.messages == 30000);
+
+        // The ten most used words are all among those reported, and every
+        // count reported is at least the exact count, and not far over it.
+        std::vector< std::pair< uint64_t, std::string > > exactWords;
+        for (const auto& word: wordCounts)
+        {
+            exactWords.emplace_back(word.second, word.first);
+        }
+        std::sort(exactWords.rbegin(), exactWords.rend());
+        std::set< std::string > reportedWords;
+        for (const auto& entry: snapshot.topWords)
+        {
+            (void)reportedWords.insert(entry.text);
+            const auto exact = wordCounts[entry.text];
+            TWITCH_BOT_CHECK(entry.count >= exact);
+            TWITCH_BOT_CHECK(entry.count <= exact + exact / 20 + 20);
+        }
+        for (size_t i = 0; i < 10; ++i)
+        {
+            TWITCH_BOT_CHECK(reportedWords.count(exactWords[i].second) == 1);
+        }
+        for (size_t i = 1; i < snapshot.topWords.size(); ++i)
+        {
+            TWITCH_BOT_CHECK(snapshot.topWords[i - 1].count >= snapshot.topWords[i].count);
+        }
+
+        // There are few enough emotes that every one is reported, named as
+        // in the text.
+        TWITCH_BOT_CHECK(snapshot.topEmotes.size() == emoteCounts.size());
+        for (const auto& entry: snapshot.topEmotes)
+        {
+            const auto exact = emoteCounts.find(entry.text);
+            if (TWITCH_BOT_CHECK(exact != emoteCounts.end()))
+            {
+                TWITCH_BOT_CHECK(entry.count >= exact->second);
+                TWITCH_BOT_CHECK(entry.count <= exact->second + exact->second / 20 + 20);
+            }
+        }
+    }
+
+    void TestCountsHalveEachWindow()
+    {
+        ChatAnalytics::Settings settings;
+        settings.window = 60.0;
+        ChatAnalytics analytics(settings);
+        for (size_t i = 0; i < 100; ++i)
+        {
+            analytics.Add("chan", "user", "hype", "", 10.0);
+        }
+        analytics.Add("chan", "user", "calm", "", 70.0);
+        ChatAnalytics::ChannelSnapshot snapshot;
+        TWITCH_BOT_CHECK(analytics.GetSnapshot("chan", 70.0, snapshot));
+        TWITCH_BOT_CHECK(!snapshot.topWords.empty());
+        if (!snapshot.topWords.empty())
+        {
+            TWITCH_BOT_CHECK(snapshot.topWords[0].text == "hype");
+            TWITCH_BOT_CHECK(snapshot.topWords[0].count == 50);
+        }
+
+        // Two windows later, it's halved twice more.
+        analytics.Add("chan", "user", "calm", "", 190.0);
+        TWITCH_BOT_CHECK(analytics.GetSnapshot("chan", 190.0, snapshot));
+        if (TWITCH_BOT_CHECK(!snapshot.topWords.empty()))
+        {
+            TWITCH_BOT_CHECK(snapshot.topWords[0].text == "hype");
+            TWITCH_BOT_CHECK(snapshot.topWords[0].count == 12);
+        }
+    }
+
+    void TestMessageRates()
+    {
+        ChatAnalytics analytics;
+        for (size_t second = 0; second < 100; ++second)
+        {
+            for (size_t i = 0; i < 10; ++i)
+            {
+                analytics.Add("chan", "user", "hi", "", 1000.0 + (double)second + (double)i * 0.05);
+            }
+        }
+        ChatAnalytics::ChannelSnapshot snapshot;
+        TWITCH_BOT_CHECK(analytics.GetSnapshot("chan", 1100.0, snapshot));
+        TWITCH_BOT_CHECK(snapshot.messagesPerSecond == 10.0);
+        TWITCH_BOT_CHECK(snapshot.messagesPerSecond10 == 10.0);
+        TWITCH_BOT_CHECK(snapshot.messagesPerSecond60 == 10.0);
+
+        // Thirty quiet seconds later, only the minute still sees any.
+        TWITCH_BOT_CHECK(analytics.GetSnapshot("chan", 1130.0, snapshot));
+        TWITCH_BOT_CHECK(snapshot.messagesPerSecond == 0.0);
+        TWITCH_BOT_CHECK(snapshot.messagesPerSecond10 == 0.0);
+        TWITCH_BOT_CHECK(snapshot.messagesPerSecond60 == 5.0);
+        TWITCH_BOT_CHECK(!analytics.GetSnapshot("other", 1130.0, snapshot));
+    }
+}
+
+int main()
+{
+    TestUserCounts();
+    TestWindowUserCounts();
+    TestTopWordsAndEmotes();
+    TestCountsHalveEachWindow();
+    TestMessageRates();
+    return TwitchBot::Test::Finish();
+}
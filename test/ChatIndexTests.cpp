@@ -0,0 +1,289 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/ChatIndex.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    /**
+     * These are the number of lines fed to the index, and the number of
+     * users and channels they're spread over.
+     */
+    constexpr size_t LINES = 20000;
+    constexpr uint64_t USERS = 30;
+    constexpr size_t CHANNELS = 3;
+    constexpr double START_TIME = 1.7e9;
+
+    const char* const CHANNEL_NAMES[CHANNELS] = {"alpha", "beta", "gamma"};
+
+    /**
+     * This is one line fed to the index, along with its words, as the
+     * index should see them, for searching by brute force.
+     */
+    struct Line
+    {
+        double time = 0.0;
+        uint64_t userId = 0;
+        size_t channel = 0;
+        std::string user;
+        std::string text;
+        std::vector< std::string > words;
+    };
+
+    /**
+     * This splits text into words the way the index does: runs of ASCII
+     * letters and digits, and of characters outside of ASCII, with ASCII
+     * letters in lower case, and only the first 64 bytes of each counting.
+     */
+    std::vector< std::string > SplitWords(const std::string& text)
+    {
+        std::vector< std::string > words;
+        std::string word;
+        for (const auto c: text)
+        {
+            const auto byte = (unsigned char)c;
+            if (isalnum(byte) || (byte >= 0x80))
+            {
+                word += (char)tolower(byte);
+            }
+            else if (!word.empty())
+            {
+                words.push_back(word.substr(0, 64));
+                word.clear();
+            }
+        }
+        if (!word.empty())
+        {
+            words.push_back(word.substr(0, 64));
+        }
+        return words;
+    }
+
+    /**
+     * This makes lines of words picked from a small vocabulary, so that
+     * most words are in many lines, with a few phrases planted here and
+     * there, in mixed case and among punctuation.
+     */
+    std::vector< Line > MakeLines()
+    {
+        const std::vector< std::string > vocabulary = {
+            "the", "lol", "Kappa", "pog", "gg", "wp", "no", "way", "clip",
+            "it", "that", "was", "so", "good", "bad", "streamer", "chat",
+            "caf\xc3\xa9", "\xe3\x81\x82\xe3\x82\x8a\xe3\x81\x8c\xe3\x81\xa8\xe3\x81\x86",
+            "hype", "train", "42", "x" + std::string(80, 'y'),
+        };
+        const std::vector< std::string > phrases = {
+            "who remembers the old days",
+            "buy cheap followers",
+            "that was so good",
+        };
+        std::mt19937 generator(11);
+        std::vector< Line > lines;
+        for (size_t i = 0; i < LINES; ++i)
+        {
+            Line line;
+            line.time = START_TIME + (double)i * 0.5;
+            line.userId = 1 + generator() % USERS;
+            line.channel = generator() % CHANNELS;
+            line.user = "user" + std::to_string(line.userId);
+            const auto length = 1 + generator() % 10;
+            for (size_t j = 0; j < length; ++j)
+            {
+                if (j > 0)
+                {
+                    line.text += ((generator() % 4) == 0) ? ", " : " ";
+                }
+                line.text += vocabulary[generator() % vocabulary.size()];
+            }
+            if ((generator() % 50) == 0)
+            {
+                auto phrase = phrases[generator() % phrases.size()];
+                phrase[0] = (char)toupper((unsigned char)phrase[0]);
+                line.text += "! " + phrase + "?";
+            }
+            line.words = SplitWords(line.text);
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    /**
+     * This looks for messages the slow way: by looking at every line.
+     */
+    std::vector< double > SearchByBruteForce(
+        const std::vector< Line >& lines,
+        const TwitchBot::ChatIndex::Query& query
+    )
+    {
+        const auto words = SplitWords(query.text);
+        std::vector< double > times;
+        for (const auto& line: lines)
+        {
+            if (
+                (!query.channel.empty() && (query.channel != CHANNEL_NAMES[line.channel]))
+                || ((query.userId != 0) && (query.userId != line.userId))
+                || (line.time < query.since)
+                || (line.time > query.until)
+            )
+            {
+                continue;
+            }
+            bool matches = true;
+            if (query.phrase && !words.empty())
+            {
+                matches = (
+                    std::search(
+                        line.words.begin(),
+                        line.words.end(),
+                        words.begin(),
+                        words.end()
+                    ) != line.words.end()
+                );
+            }
+            else
+            {
+                for (const auto& word: words)
+                {
+                    if (std::find(line.words.begin(), line.words.end(), word) == line.words.end())
+                    {
+                        matches = false;
+                        break;
+                    }
+                }
+            }
+            if (matches)
+            {
+                times.push_back(line.time);
+            }
+        }
+        return times;
+    }
+
+    void TestSearchesMatchBruteForce()
+    {
+        TwitchBot::ChatIndex::Settings settings;
+        settings.batchSize = 500;
+        settings.mergeFactor = 4;
+        TwitchBot::ChatIndex index(settings);
+        const auto lines = MakeLines();
+        for (const auto& line: lines)
+        {
+            while (!index.Add(line.time, line.userId, CHANNEL_NAMES[line.channel], line.user, line.text))
+            {
+                index.Flush();
+            }
+        }
+        index.Flush();
+
+        struct Case
+        {
+            std::string text;
+            bool phrase;
+            const char* channel;
+            uint64_t userId;
+            double since;
+            double until;
+        };
+        const auto middle = START_TIME + (double)LINES * 0.25;
+        const auto late = START_TIME + (double)LINES * 0.3;
+        const auto forever = 1e18;
+        const Case cases[] = {
+            {"who remembers the old days", true, "", 0, 0.0, forever},
+            {"BUY cheap, followers", true, "", 0, 0.0, forever},
+            {"that was so good", true, "", 0, 0.0, forever},
+            {"that was so good", false, "", 0, 0.0, forever},
+            {"good so", true, "", 0, 0.0, forever},
+            {"kappa lol", false, "", 0, 0.0, forever},
+            {"kappa", false, "beta", 0, 0.0, forever},
+            {"gg wp", false, "gamma", 0, middle, late},
+            {"caf\xc3\xa9", false, "", 7, 0.0, forever},
+            {"\xe3\x81\x82\xe3\x82\x8a\xe3\x81\x8c\xe3\x81\xa8\xe3\x81\x86 42", false, "alpha", 0, 0.0, forever},
+            {"x" + std::string(63, 'y') + "zzz", false, "", 0, 0.0, forever},
+            {"", false, "", 3, 0.0, forever},
+            {"", false, "alpha", 0, middle, late},
+            {"", false, "beta", 12, 0.0, forever},
+            {"hype train", true, "beta", 5, 0.0, middle},
+            {"nothing", false, "", 0, 0.0, forever},
+            {"the", false, "nowhere", 0, 0.0, forever},
+        };
+        for (const auto& testCase: cases)
+        {
+            TwitchBot::ChatIndex::Query query;
+            query.text = testCase.text;
+            query.phrase = testCase.phrase;
+            query.channel = testCase.channel;
+            query.userId = testCase.userId;
+            query.since = testCase.since;
+            query.until = testCase.until;
+            std::vector< double > times;
+            const auto found = index.Search(
+                query,
+                [&](const TwitchBot::ChatIndex::Hit& hit)
+                {
+                    times.push_back(hit.time);
+                    const auto& line = lines[(size_t)((hit.time - START_TIME) * 2.0)];
+                    TWITCH_BOT_CHECK(hit.userId == line.userId);
+                    TWITCH_BOT_CHECK(hit.channel == CHANNEL_NAMES[line.channel]);
+                    TWITCH_BOT_CHECK(hit.user == line.user);
+                    TWITCH_BOT_CHECK(hit.text == line.text);
+                    return true;
+                }
+            );
+            const auto expected = SearchByBruteForce(lines, query);
+            if (
+                !TWITCH_BOT_CHECK(found == times.size())
+                || !TWITCH_BOT_CHECK(times == expected)
+            )
+            {
+                fprintf(
+                    stderr,
+                    "query \"%s\" (phrase %d, channel \"%s\", user %llu): found %zu, expected %zu\n",
+                    testCase.text.c_str(),
+                    (int)testCase.phrase,
+                    testCase.channel,
+                    (unsigned long long)testCase.userId,
+                    times.size(),
+                    expected.size()
+                );
+            }
+        }
+        const auto stats = index.GetStats();
+        TWITCH_BOT_CHECK(stats.messagesIndexed == LINES);
+        TWITCH_BOT_CHECK(stats.messagesDropped == 0);
+    }
+
+    void TestSearchStops()
+    {
+        TwitchBot::ChatIndex index;
+        for (size_t i = 0; i < 10; ++i)
+        {
+            TWITCH_BOT_CHECK(index.Add(START_TIME + (double)i, 1, "alpha", "user1", "hello there"));
+        }
+        index.Flush();
+        TwitchBot::ChatIndex::Query query;
+        query.text = "hello";
+        size_t visited = 0;
+        (void)index.Search(
+            query,
+            [&](const TwitchBot::ChatIndex::Hit&)
+            {
+                return (++visited < 3);
+            }
+        );
+        TWITCH_BOT_CHECK(visited == 3);
+        TWITCH_BOT_CHECK(index.Search(query, nullptr) == 10);
+    }
+}
+
+int main()
+{
+    TestSearchesMatchBruteForce();
+    TestSearchStops();
+    return TwitchBot::Test::Finish();
+}
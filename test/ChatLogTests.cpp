@@ -0,0 +1,260 @@
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/ChatLog.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    /**
+     * These are the number of records written, the number of users who
+     * wrote them, and the time of the first one.
+     */
+    constexpr size_t RECORDS = 3000;
+    constexpr uint64_t USERS = 7;
+    constexpr double START_TIME = 1.7e9;
+
+    /**
+     * These are settings which make the log use many small segments and
+     * blocks, so that the tests cross plenty of both.
+     */
+    TwitchBot::ChatLog::Settings MakeSettings()
+    {
+        TwitchBot::ChatLog::Settings settings;
+        settings.segmentSize = 1 << 16;
+        settings.recordsPerBlock = 8;
+        return settings;
+    }
+
+    /**
+     * This is a directory made for a test, which is removed along with
+     * everything in it when the test is done.
+     */
+    struct TemporaryDirectory
+    {
+        std::string path;
+
+        TemporaryDirectory()
+        {
+            char name[] = "/tmp/ChatLogTests.XXXXXX";
+            if (mkdtemp(name) != nullptr)
+            {
+                path = name;
+            }
+        }
+
+        ~TemporaryDirectory()
+        {
+            std::error_code error;
+            (void)std::filesystem::remove_all(path, error);
+        }
+
+        std::vector< std::string > List(const std::string& extension) const
+        {
+            std::vector< std::string > paths;
+            for (const auto& item: std::filesystem::directory_iterator(path))
+            {
+                if (item.path().extension() == extension)
+                {
+                    paths.push_back(item.path().string());
+                }
+            }
+            std::sort(paths.begin(), paths.end());
+            return paths;
+        }
+    };
+
+    uint64_t GetUser(size_t i)
+    {
+        return 1 + (uint64_t)(i * 5 % USERS);
+    }
+
+    bool Append(TwitchBot::ChatLog& log, size_t i)
+    {
+        const auto user = "user" + std::to_string(GetUser(i));
+        const auto id = "id-" + std::to_string(i);
+        const auto text = "message number " + std::to_string(i);
+        TwitchBot::ChatLog::Entry entry;
+        entry.time = START_TIME + (double)i;
+        entry.userId = GetUser(i);
+        entry.command = "PRIVMSG";
+        entry.channel = ((i % 2) == 0) ? "even" : "odd";
+        entry.user = user;
+        entry.id = id;
+        entry.text = text;
+        return log.Append(entry);
+    }
+
+    /**
+     * This writes the given number of records to a new log in the given
+     * directory, and closes it.
+     */
+    void Write(const std::string& directory, size_t records)
+    {
+        TwitchBot::ChatLog log(MakeSettings());
+        TWITCH_BOT_CHECK(log.Open(directory));
+        for (size_t i = 0; i < records; ++i)
+        {
+            TWITCH_BOT_CHECK(Append(log, i));
+        }
+        log.Close();
+    }
+
+    /**
+     * This checks that a log holds exactly the given number of the records
+     * written by Write, in order, and finds them by user and by time.
+     */
+    void CheckRecords(const TwitchBot::ChatLog& log, size_t records)
+    {
+        size_t next = 0;
+        const auto found = log.Find(
+            0.0,
+            1e18,
+            [&](const TwitchBot::ChatLog::Entry& entry)
+            {
+                TWITCH_BOT_CHECK(entry.time == START_TIME + (double)next);
+                TWITCH_BOT_CHECK(entry.userId == GetUser(next));
+                TWITCH_BOT_CHECK(entry.command == "PRIVMSG");
+                TWITCH_BOT_CHECK(entry.channel == (((next % 2) == 0) ? "even" : "odd"));
+                TWITCH_BOT_CHECK(entry.user == "user" + std::to_string(GetUser(next)));
+                TWITCH_BOT_CHECK(entry.id == "id-" + std::to_string(next));
+                TWITCH_BOT_CHECK(entry.text == "message number " + std::to_string(next));
+                ++next;
+                return true;
+            }
+        );
+        TWITCH_BOT_CHECK(found == records);
+        TWITCH_BOT_CHECK(next == records);
+
+        // A stretch of time in the middle, by everyone and by one user.
+        const size_t first = records / 3;
+        const size_t last = records / 2;
+        const auto since = START_TIME + (double)first;
+        const auto until = START_TIME + (double)last;
+        TWITCH_BOT_CHECK(log.Find(since, until, nullptr) == last - first + 1);
+        for (uint64_t user = 1; user <= USERS; ++user)
+        {
+            size_t expected = 0;
+            size_t expectedInStretch = 0;
+            for (size_t i = 0; i < records; ++i)
+            {
+                if (GetUser(i) == user)
+                {
+                    ++expected;
+                    if ((i >= first) && (i <= last))
+                    {
+                        ++expectedInStretch;
+                    }
+                }
+            }
+            TWITCH_BOT_CHECK(
+                log.FindByUser(
+                    user,
+                    0.0,
+                    1e18,
+                    [&](const TwitchBot::ChatLog::Entry& entry)
+                    {
+                        return TWITCH_BOT_CHECK(entry.userId == user);
+                    }
+                ) == expected
+            );
+            TWITCH_BOT_CHECK(log.FindByUser(user, since, until, nullptr) == expectedInStretch);
+        }
+    }
+
+    void TestReopen()
+    {
+        TemporaryDirectory directory;
+        Write(directory.path, RECORDS);
+        TWITCH_BOT_CHECK(directory.List(".log").size() > 2);
+        TwitchBot::ChatLog log(MakeSettings());
+        TWITCH_BOT_CHECK(log.Open(directory.path));
+        const auto stats = log.GetStats();
+        TWITCH_BOT_CHECK(stats.recordsRecovered == RECORDS);
+        TWITCH_BOT_CHECK(stats.bytesTruncated == 0);
+        CheckRecords(log, RECORDS);
+    }
+
+    void TestIndexRebuilt()
+    {
+        TemporaryDirectory directory;
+        Write(directory.path, RECORDS);
+
+        // Without the saved indexes of the full segments, each is looked
+        // through again, and indexed the same way.
+        const auto indexes = directory.List(".idx");
+        TWITCH_BOT_CHECK(!indexes.empty());
+        for (const auto& index: indexes)
+        {
+            TWITCH_BOT_CHECK(unlink(index.c_str()) == 0);
+        }
+        TwitchBot::ChatLog log(MakeSettings());
+        TWITCH_BOT_CHECK(log.Open(directory.path));
+        const auto stats = log.GetStats();
+        TWITCH_BOT_CHECK(stats.recordsRecovered == RECORDS);
+        TWITCH_BOT_CHECK(stats.bytesTruncated == 0);
+        CheckRecords(log, RECORDS);
+    }
+
+    void TestTornRecordCutOff()
+    {
+        TemporaryDirectory directory;
+        Write(directory.path, RECORDS);
+
+        // Tear the last record, as if the machine went down before all of
+        // it reached the disk: the last few bytes of its text never made
+        // it, and some stray bytes landed past it.
+        const auto segments = directory.List(".log");
+        TWITCH_BOT_CHECK(!segments.empty());
+        const auto descriptor = open(segments.back().c_str(), O_RDWR);
+        TWITCH_BOT_CHECK(descriptor >= 0);
+        std::vector< char > data(MakeSettings().segmentSize);
+        TWITCH_BOT_CHECK(pread(descriptor, data.data(), data.size(), 0) == (ssize_t)data.size());
+        auto end = data.size();
+        while ((end > 0) && (data[end - 1] == 0))
+        {
+            --end;
+        }
+        const std::vector< char > zeros(3, 0);
+        TWITCH_BOT_CHECK(pwrite(descriptor, zeros.data(), zeros.size(), end - zeros.size()) == (ssize_t)zeros.size());
+        const std::string stray = "stray";
+        TWITCH_BOT_CHECK(pwrite(descriptor, stray.data(), stray.length(), end + 100) == (ssize_t)stray.length());
+        (void)close(descriptor);
+        {
+            TwitchBot::ChatLog log(MakeSettings());
+            TWITCH_BOT_CHECK(log.Open(directory.path));
+            const auto stats = log.GetStats();
+            TWITCH_BOT_CHECK(stats.recordsRecovered == RECORDS - 1);
+            TWITCH_BOT_CHECK(stats.bytesTruncated > 0);
+            CheckRecords(log, RECORDS - 1);
+
+            // Adding picks up where the last whole record left off.
+            TWITCH_BOT_CHECK(Append(log, RECORDS - 1));
+            TWITCH_BOT_CHECK(Append(log, RECORDS));
+            CheckRecords(log, RECORDS + 1);
+        }
+
+        // Nothing is left to cut off the next time.
+        TwitchBot::ChatLog log(MakeSettings());
+        TWITCH_BOT_CHECK(log.Open(directory.path));
+        const auto stats = log.GetStats();
+        TWITCH_BOT_CHECK(stats.recordsRecovered == RECORDS + 1);
+        TWITCH_BOT_CHECK(stats.bytesTruncated == 0);
+        CheckRecords(log, RECORDS + 1);
+    }
+}
+
+int main()
+{
+    TestReopen();
+    TestIndexRebuilt();
+    TestTornRecordCutOff();
+    return TwitchBot::Test::Finish();
+}
@@ -0,0 +1,347 @@
+#include <string>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/CommandController.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::CommandController;
+    using DispatchResult = TwitchBot::CommandController::DispatchResult;
+
+    /**
+     * This makes a chat line as the MessageManager would parse it.
+     */
+    TwitchBot::Message MakeChat(
+        const std::string& tags,
+        const std::string& nickname,
+        const std::string& channel,
+        const std::string& text
+    )
+    {
+        TwitchBot::Message message;
+        message.tags.Assign(tags);
+        message.prefix = nickname + "!" + nickname + "@" + nickname + ".tmi.twitch.tv";
+        message.command = "PRIVMSG";
+        message.knownCommand = TwitchBot::KnownCommand::Privmsg;
+        message.parameters = {"#" + channel, text};
+        return message;
+    }
+
+    void TestLookupIgnoresCase()
+    {
+        CommandController controller;
+        TWITCH_BOT_CHECK(controller.Register("Uptime", nullptr));
+        TWITCH_BOT_CHECK(controller.Register("so", nullptr));
+        TWITCH_BOT_CHECK(!controller.Register("UPTIME", nullptr));
+        TWITCH_BOT_CHECK(!controller.Register("", nullptr));
+        TWITCH_BOT_CHECK(!controller.Register("two words", nullptr));
+        controller.Compile();
+        TWITCH_BOT_CHECK(controller.GetCommandCount() == 2);
+        TwitchBot::CommandInvocation invocation;
+        for (const auto text: {"!uptime", "!UPTIME", "!UpTiMe", "!uptime ", "!uptime\targ"})
+        {
+            TWITCH_BOT_CHECK(controller.Lookup(text, invocation));
+            TWITCH_BOT_CHECK(invocation.command == 0);
+            TWITCH_BOT_CHECK(invocation.name == "uptime");
+        }
+        TWITCH_BOT_CHECK(controller.Lookup("!SO someone", invocation));
+        TWITCH_BOT_CHECK(invocation.command == 1);
+        TWITCH_BOT_CHECK(invocation.name == "so");
+
+        // Names only match whole, with the prefix, at the start of the
+        // line.
+        for (const auto text: {"uptime", "?uptime", " !uptime", "!uptim", "!uptimes", "!uptime!", "!s", "!sox", "!Uptimé"})
+        {
+            TWITCH_BOT_CHECK(!controller.Lookup(text, invocation));
+        }
+    }
+
+    void TestLookupBeforeCompileAndWithoutCommands()
+    {
+        CommandController empty;
+        TwitchBot::CommandInvocation invocation;
+        TWITCH_BOT_CHECK(!empty.Lookup("!uptime", invocation));
+        empty.Compile();
+        TWITCH_BOT_CHECK(!empty.Lookup("!uptime", invocation));
+        TWITCH_BOT_CHECK(empty.Dispatch("a", "alice", "!uptime", 0.0) == DispatchResult::NotCommand);
+
+        CommandController controller;
+        TWITCH_BOT_CHECK(controller.Register("uptime", nullptr));
+        TWITCH_BOT_CHECK(!controller.Lookup("!uptime", invocation));
+        controller.Compile();
+        TWITCH_BOT_CHECK(controller.Lookup("!uptime", invocation));
+        TWITCH_BOT_CHECK(!controller.Register("late", nullptr));
+        TWITCH_BOT_CHECK(!controller.Lookup("!late", invocation));
+    }
+
+    void TestAliases()
+    {
+        CommandController controller;
+        TWITCH_BOT_CHECK(controller.Register("uptime", nullptr));
+        TWITCH_BOT_CHECK(controller.Register("followage", nullptr));
+        TWITCH_BOT_CHECK(controller.AddAlias("Up", "UPTIME"));
+        TWITCH_BOT_CHECK(controller.AddAlias("live", "uptime"));
+
+        // An alias may not take a name already in use, by a command or
+        // another alias, nor stand for a command which doesn't exist.
+        TWITCH_BOT_CHECK(!controller.AddAlias("followage", "uptime"));
+        TWITCH_BOT_CHECK(!controller.AddAlias("UP", "followage"));
+        TWITCH_BOT_CHECK(!controller.AddAlias("fa", "nothing"));
+        TWITCH_BOT_CHECK(!controller.AddAlias("", "uptime"));
+        TWITCH_BOT_CHECK(!controller.AddAlias("f a", "followage"));
+        TWITCH_BOT_CHECK(!controller.Register("live", nullptr));
+        controller.Compile();
+
+        // Nor may aliases be added once the table is built.
+        TWITCH_BOT_CHECK(!controller.AddAlias("fa", "followage"));
+        TWITCH_BOT_CHECK(controller.GetCommandCount() == 2);
+
+        TwitchBot::CommandInvocation invocation;
+        for (const auto text: {"!up", "!UP", "!live"})
+        {
+            TWITCH_BOT_CHECK(controller.Lookup(text, invocation));
+            TWITCH_BOT_CHECK(invocation.command == 0);
+            TWITCH_BOT_CHECK(invocation.name == "uptime");
+        }
+        TWITCH_BOT_CHECK(controller.Lookup("!followage", invocation));
+        TWITCH_BOT_CHECK(invocation.command == 1);
+        TWITCH_BOT_CHECK(!controller.Lookup("!fa", invocation));
+    }
+
+    void TestLengthLimits()
+    {
+        CommandController controller;
+        TWITCH_BOT_CHECK(controller.Register("ab", nullptr));
+        TWITCH_BOT_CHECK(controller.Register("abcdef", nullptr));
+        controller.Compile();
+        TwitchBot::CommandInvocation invocation;
+
+        // Words shorter than the shortest name, or longer than the longest,
+        // are turned away, even if a name is a prefix of them.
+        TWITCH_BOT_CHECK(!controller.Lookup("!a", invocation));
+        TWITCH_BOT_CHECK(controller.Lookup("!ab", invocation));
+        TWITCH_BOT_CHECK(controller.Lookup("!abcdef", invocation));
+        TWITCH_BOT_CHECK(controller.Lookup("!abcdef x", invocation));
+        TWITCH_BOT_CHECK(!controller.Lookup("!abcdefg", invocation));
+        TWITCH_BOT_CHECK(!controller.Lookup("!abcdefg x", invocation));
+        TWITCH_BOT_CHECK(!controller.Lookup("!" + std::string(1000, 'a'), invocation));
+    }
+
+    void TestLonePrefix()
+    {
+        CommandController controller;
+        TWITCH_BOT_CHECK(controller.Register("a", nullptr));
+        controller.Compile();
+        TwitchBot::CommandInvocation invocation;
+        TWITCH_BOT_CHECK(!controller.Lookup("", invocation));
+        TWITCH_BOT_CHECK(!controller.Lookup("!", invocation));
+        TWITCH_BOT_CHECK(!controller.Lookup("! ", invocation));
+        TWITCH_BOT_CHECK(!controller.Lookup("! a", invocation));
+        TWITCH_BOT_CHECK(!controller.Lookup("!!", invocation));
+        TWITCH_BOT_CHECK(controller.Lookup("!a", invocation));
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "alice", "!", 0.0) == DispatchResult::NotCommand);
+
+        // Another prefix may be chosen.
+        CommandController other('?');
+        TWITCH_BOT_CHECK(other.Register("a", nullptr));
+        other.Compile();
+        TWITCH_BOT_CHECK(other.Lookup("?a", invocation));
+        TWITCH_BOT_CHECK(!other.Lookup("!a", invocation));
+        TWITCH_BOT_CHECK(!other.Lookup("?", invocation));
+    }
+
+    void TestArguments()
+    {
+        CommandController controller;
+        TWITCH_BOT_CHECK(controller.Register("so", nullptr));
+        controller.Compile();
+        TwitchBot::CommandInvocation invocation;
+        TWITCH_BOT_CHECK(controller.Lookup("!so", invocation));
+        TWITCH_BOT_CHECK(invocation.argumentCount == 0);
+        TWITCH_BOT_CHECK(invocation.argumentText.empty());
+        TWITCH_BOT_CHECK(controller.Lookup("!so   \t ", invocation));
+        TWITCH_BOT_CHECK(invocation.argumentCount == 0);
+        TWITCH_BOT_CHECK(invocation.argumentText.empty());
+
+        // Arguments are split on runs of spaces and tabs, and the text of
+        // them all is kept without the white space at either end.
+        TWITCH_BOT_CHECK(controller.Lookup("!so  alice \t bob\tcarol  ", invocation));
+        TWITCH_BOT_CHECK(invocation.argumentText == "alice \t bob\tcarol");
+        TWITCH_BOT_CHECK(invocation.argumentCount == 3);
+        TWITCH_BOT_CHECK(invocation.arguments[0] == "alice");
+        TWITCH_BOT_CHECK(invocation.arguments[1] == "bob");
+        TWITCH_BOT_CHECK(invocation.arguments[2] == "carol");
+
+        // Exactly as many words as there are arguments fill them all.
+        std::string text = "!so";
+        std::vector< std::string > words;
+        for (size_t i = 0; i < TwitchBot::MAX_COMMAND_ARGUMENTS; ++i)
+        {
+            words.push_back("w" + std::to_string(i));
+            text += " " + words.back();
+        }
+        TWITCH_BOT_CHECK(controller.Lookup(text, invocation));
+        TWITCH_BOT_CHECK(invocation.argumentCount == TwitchBot::MAX_COMMAND_ARGUMENTS);
+        for (size_t i = 0; i < TwitchBot::MAX_COMMAND_ARGUMENTS; ++i)
+        {
+            TWITCH_BOT_CHECK(invocation.arguments[i] == words[i]);
+        }
+
+        // Past that, the rest of the text, white space and all, is left in
+        // the last argument.
+        text += "  extra\tmore ";
+        TWITCH_BOT_CHECK(controller.Lookup(text, invocation));
+        TWITCH_BOT_CHECK(invocation.argumentCount == TwitchBot::MAX_COMMAND_ARGUMENTS);
+        for (size_t i = 0; i + 1 < TwitchBot::MAX_COMMAND_ARGUMENTS; ++i)
+        {
+            TWITCH_BOT_CHECK(invocation.arguments[i] == words[i]);
+        }
+        TWITCH_BOT_CHECK(
+            invocation.arguments[TwitchBot::MAX_COMMAND_ARGUMENTS - 1]
+            == words.back() + "  extra\tmore"
+        );
+    }
+
+    void TestManyCommands()
+    {
+        // Every one of many names gets a slot of its own.
+        CommandController controller;
+        constexpr size_t commands = 1000;
+        for (size_t i = 0; i < commands; ++i)
+        {
+            TWITCH_BOT_CHECK(controller.Register("cmd" + std::to_string(i), nullptr));
+        }
+        controller.Compile();
+        TwitchBot::CommandInvocation invocation;
+        for (size_t i = 0; i < commands; ++i)
+        {
+            if (
+                !TWITCH_BOT_CHECK(controller.Lookup("!CMD" + std::to_string(i) + " x", invocation))
+                || !TWITCH_BOT_CHECK(invocation.command == i)
+            )
+            {
+                break;
+            }
+        }
+        TWITCH_BOT_CHECK(!controller.Lookup("!cmd1000", invocation));
+        TWITCH_BOT_CHECK(!controller.Lookup("!cmd", invocation));
+    }
+
+    void TestDispatchMessage()
+    {
+        CommandController controller;
+        std::vector< std::string > users;
+        std::vector< std::string > channels;
+        (void)controller.Register(
+            "hug",
+            [&](const TwitchBot::CommandInvocation& invocation)
+            {
+                users.emplace_back(invocation.user);
+                channels.emplace_back(invocation.channel);
+            },
+            0.0,
+            30.0
+        );
+        controller.Compile();
+
+        // Users are told apart by user ID when there is one, so a change of
+        // name doesn't dodge their cooldown.
+        TWITCH_BOT_CHECK(controller.Dispatch(MakeChat("user-id=42", "alice", "chan", "!hug"), 0.0) == DispatchResult::Dispatched);
+        TWITCH_BOT_CHECK(controller.Dispatch(MakeChat("user-id=42", "alice2", "chan", "!hug"), 1.0) == DispatchResult::CoolingDown);
+
+        // Without one, they're told apart by nickname.
+        TWITCH_BOT_CHECK(controller.Dispatch(MakeChat("", "bob", "chan", "!hug"), 2.0) == DispatchResult::Dispatched);
+        TWITCH_BOT_CHECK(controller.Dispatch(MakeChat("badges=", "bob", "chan", "!hug"), 3.0) == DispatchResult::CoolingDown);
+        TWITCH_BOT_CHECK(controller.Dispatch(MakeChat("", "carol", "chan", "!hug"), 4.0) == DispatchResult::Dispatched);
+        TWITCH_BOT_CHECK((users == std::vector< std::string >{"42", "bob", "carol"}));
+        TWITCH_BOT_CHECK((channels == std::vector< std::string >{"chan", "chan", "chan"}));
+
+        // Only chat lines are dispatched.
+        auto notice = MakeChat("", "tmi.twitch.tv", "chan", "!hug");
+        notice.command = "NOTICE";
+        notice.knownCommand = TwitchBot::KnownCommand::Notice;
+        TWITCH_BOT_CHECK(controller.Dispatch(notice, 100.0) == DispatchResult::NotCommand);
+        auto truncated = MakeChat("", "dave", "chan", "!hug");
+        truncated.parameters.pop_back();
+        TWITCH_BOT_CHECK(controller.Dispatch(truncated, 100.0) == DispatchResult::NotCommand);
+        TWITCH_BOT_CHECK(controller.Dispatch(MakeChat("", "dave", "chan", "hug"), 100.0) == DispatchResult::NotCommand);
+        TWITCH_BOT_CHECK(users.size() == 3);
+    }
+
+    void TestCooldownsArePerChannel()
+    {
+        CommandController controller;
+        size_t calls = 0;
+        (void)controller.Register(
+            "uptime",
+            [&](const TwitchBot::CommandInvocation&){ ++calls; },
+            10.0
+        );
+        controller.Compile();
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "alice", "!uptime", 100.0) == DispatchResult::Dispatched);
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "bob", "!uptime", 105.0) == DispatchResult::CoolingDown);
+
+        // The command cooling down in one channel is still ready in another.
+        TWITCH_BOT_CHECK(controller.Dispatch("b", "bob", "!uptime", 105.0) == DispatchResult::Dispatched);
+        TWITCH_BOT_CHECK(controller.Dispatch("b", "alice", "!uptime", 110.0) == DispatchResult::CoolingDown);
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "bob", "!uptime", 110.0) == DispatchResult::Dispatched);
+        TWITCH_BOT_CHECK(controller.Dispatch("b", "alice", "!uptime", 115.0) == DispatchResult::Dispatched);
+        TWITCH_BOT_CHECK(calls == 4);
+    }
+
+    void TestUserCooldownsArePerChannel()
+    {
+        CommandController controller;
+        size_t calls = 0;
+        (void)controller.Register(
+            "hug",
+            [&](const TwitchBot::CommandInvocation&){ ++calls; },
+            0.0,
+            30.0
+        );
+        controller.Compile();
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "alice", "!hug", 0.0) == DispatchResult::Dispatched);
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "bob", "!hug", 1.0) == DispatchResult::Dispatched);
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "alice", "!hug", 2.0) == DispatchResult::CoolingDown);
+
+        // The same user may use the command in another channel.
+        TWITCH_BOT_CHECK(controller.Dispatch("b", "alice", "!hug", 3.0) == DispatchResult::Dispatched);
+        TWITCH_BOT_CHECK(controller.Dispatch("b", "alice", "!hug", 4.0) == DispatchResult::CoolingDown);
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "alice", "!hug", 30.0) == DispatchResult::Dispatched);
+        TWITCH_BOT_CHECK(calls == 4);
+    }
+
+    void TestCoolingDownUserDoesNotHoldUpChannel()
+    {
+        CommandController controller;
+        (void)controller.Register("roll", nullptr, 5.0, 60.0);
+        controller.Compile();
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "alice", "!roll", 0.0) == DispatchResult::Dispatched);
+
+        // Turned away by their own cooldown, the user doesn't restart the
+        // channel's.
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "alice", "!roll", 5.0) == DispatchResult::CoolingDown);
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "bob", "!roll", 5.0) == DispatchResult::Dispatched);
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "carol", "!roll", 9.0) == DispatchResult::CoolingDown);
+        TWITCH_BOT_CHECK(controller.Dispatch("a", "carol", "!roll", 10.0) == DispatchResult::Dispatched);
+    }
+}
+
+int main()
+{
+    TestLookupIgnoresCase();
+    TestLookupBeforeCompileAndWithoutCommands();
+    TestAliases();
+    TestLengthLimits();
+    TestLonePrefix();
+    TestArguments();
+    TestManyCommands();
+    TestDispatchMessage();
+    TestCooldownsArePerChannel();
+    TestUserCooldownsArePerChannel();
+    TestCoolingDownUserDoesNotHoldUpChannel();
+    return TwitchBot::Test::Finish();
+}
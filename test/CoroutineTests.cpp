@@ -0,0 +1,210 @@
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageManager.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SimulatedTimeKeeper.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Task.hpp>
+
+#include "TestSupport.hpp"
+
+#ifndef TWITCH_BOT_COROUTINES
+#error These tests need C++20 coroutines.
+#endif /* TWITCH_BOT_COROUTINES */
+
+namespace
+{
+    /**
+     * These are the outcomes of an operation, as noted by the coroutines
+     * under test.
+     */
+    constexpr int PENDING = -1;
+    constexpr int FAILED = 0;
+    constexpr int SUCCEEDED = 1;
+
+    /**
+     * This is a stand-in connection which never answers, so that logging
+     * in never finishes.
+     */
+    class SilentConnection
+        : public TwitchBot::Test::FakeConnection
+    {
+        // TwitchBot::Connection
+        public:
+            virtual void Send(const std::string&) override
+            {
+            }
+    };
+
+    /**
+     * These are the steps of the conversation held by the Converse
+     * coroutine, and how each went.
+     */
+    struct Conversation
+    {
+        std::atomic< int > loggedIn{PENDING};
+        std::atomic< int > joined{PENDING};
+        std::atomic< int > replied{PENDING};
+        std::string reply;
+        std::atomic< int > timedOut{PENDING};
+        std::atomic< int > loggedOut{PENDING};
+    };
+
+    TwitchBot::Task<> Converse(
+        TwitchBot::MessageManager& manager,
+        Conversation& conversation
+    )
+    {
+        conversation.loggedIn = (
+            co_await manager.LogInAsync("bot", "token")
+            ? SUCCEEDED
+            : FAILED
+        );
+        conversation.joined = (
+            co_await manager.JoinAsync("Chan")
+            ? SUCCEEDED
+            : FAILED
+        );
+        TwitchBot::MessageManager::MessageFilter filter;
+        filter.command = TwitchBot::KnownCommand::Privmsg;
+        filter.channel = "CHAN";
+        filter.user = "Alice";
+        auto message = co_await manager.NextMessage(filter);
+        if (message)
+        {
+            conversation.reply = message->parameters[1];
+        }
+        conversation.replied = (message ? SUCCEEDED : FAILED);
+        message = co_await manager.NextMessage(filter, 2.0);
+        conversation.timedOut = (message ? FAILED : SUCCEEDED);
+        conversation.loggedOut = (
+            co_await manager.LogOutAsync("")
+            ? SUCCEEDED
+            : FAILED
+        );
+    }
+
+    TwitchBot::Task<> LogIn(
+        TwitchBot::MessageManager& manager,
+        double timeout,
+        std::atomic< int >& outcome
+    )
+    {
+        outcome = (
+            co_await manager.LogInAsync("bot", "token", timeout)
+            ? SUCCEEDED
+            : FAILED
+        );
+    }
+
+    TwitchBot::Task<> WaitForAnything(
+        TwitchBot::MessageManager& manager,
+        std::atomic< int >& outcome
+    )
+    {
+        TwitchBot::MessageManager::MessageFilter filter;
+        const auto message = co_await manager.NextMessage(filter);
+        outcome = (message ? SUCCEEDED : FAILED);
+    }
+
+    void TestConversation()
+    {
+        const auto connection = std::make_shared< TwitchBot::Test::FakeConnection >();
+        const auto timeKeeper = std::make_shared< TwitchBot::SimulatedTimeKeeper >();
+        TwitchBot::MessageManager manager;
+        manager.SetTimeKeeper(timeKeeper);
+        manager.SetConnectionFactory([&connection]{ return connection; });
+        Conversation conversation;
+        Converse(manager, conversation).Start();
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return conversation.loggedIn != PENDING; })
+        );
+        TWITCH_BOT_CHECK(conversation.loggedIn == SUCCEEDED);
+
+        // The channel's name is folded to lower case, and someone else
+        // joining isn't the agent joining.
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return connection->CountLines("JOIN #chan") == 1; })
+        );
+        connection->Receive(":someone!someone@someone.tmi.twitch.tv JOIN #chan\r\n");
+        connection->Receive(":bot!bot@bot.tmi.twitch.tv JOIN #chan\r\n");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return conversation.joined != PENDING; })
+        );
+        TWITCH_BOT_CHECK(conversation.joined == SUCCEEDED);
+
+        // Only the message passing the filter is picked out, whatever the
+        // case of the names the filter was given.
+        connection->Receive(
+            ":bob!bob@bob.tmi.twitch.tv PRIVMSG #chan :not alice\r\n"
+            ":alice!alice@alice.tmi.twitch.tv PRIVMSG #other :wrong channel\r\n"
+            ":alice!alice@alice.tmi.twitch.tv PRIVMSG #chan :hi bot\r\n"
+        );
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return conversation.replied != PENDING; })
+        );
+        TWITCH_BOT_CHECK(conversation.replied == SUCCEEDED);
+        TWITCH_BOT_CHECK(conversation.reply == "hi bot");
+
+        // Nothing more comes, so the next wait times out.
+        timeKeeper->Advance(1.0);
+        TWITCH_BOT_CHECK(conversation.timedOut == PENDING);
+        timeKeeper->Advance(1.5);
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return conversation.timedOut != PENDING; })
+        );
+        TWITCH_BOT_CHECK(conversation.timedOut == SUCCEEDED);
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return conversation.loggedOut != PENDING; })
+        );
+        TWITCH_BOT_CHECK(conversation.loggedOut == SUCCEEDED);
+        TWITCH_BOT_CHECK(!connection->IsConnected());
+    }
+
+    void TestLogInTimesOut()
+    {
+        const auto connection = std::make_shared< SilentConnection >();
+        const auto timeKeeper = std::make_shared< TwitchBot::SimulatedTimeKeeper >();
+        TwitchBot::MessageManager manager;
+        manager.SetTimeKeeper(timeKeeper);
+        manager.SetConnectionFactory([&connection]{ return connection; });
+        std::atomic< int > outcome{PENDING};
+        LogIn(manager, 1.0, outcome).Start();
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return connection->IsConnected(); })
+        );
+        timeKeeper->Advance(1.5);
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return outcome != PENDING; })
+        );
+        TWITCH_BOT_CHECK(outcome == FAILED);
+    }
+
+    void TestShutdownWhileAwaiting()
+    {
+        const auto connection = std::make_shared< TwitchBot::Test::FakeConnection >();
+        auto manager = std::make_unique< TwitchBot::MessageManager >();
+        manager->SetConnectionFactory([&connection]{ return connection; });
+        std::atomic< int > loggedIn{PENDING};
+        LogIn(*manager, 0.0, loggedIn).Start();
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return loggedIn != PENDING; })
+        );
+        TWITCH_BOT_CHECK(loggedIn == SUCCEEDED);
+        std::atomic< int > outcome{PENDING};
+        WaitForAnything(*manager, outcome).Start();
+
+        // Destroying the manager fails whatever is still waiting, rather
+        // than leaving the coroutine suspended forever.
+        manager = nullptr;
+        TWITCH_BOT_CHECK(outcome == FAILED);
+    }
+}
+
+int main()
+{
+    TestConversation();
+    TestLogInTimesOut();
+    TestShutdownWhileAwaiting();
+    return TwitchBot::Test::Finish();
+}
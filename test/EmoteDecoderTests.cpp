@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/EmoteDecoder.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::EmoteDecoder;
+
+    /**
+     * This is one use of an emote, as found by the reference decoder.
+     */
+    struct Span
+    {
+        std::string id;
+        size_t begin = 0;
+        size_t end = 0;
+
+        bool operator==(const Span& other) const
+        {
+            return (
+                (id == other.id)
+                && (begin == other.begin)
+                && (end == other.end)
+            );
+        }
+    };
+
+    /**
+     * This splits the given text at each separator.
+     */
+    std::vector< std::string > Split(const std::string& text, char separator)
+    {
+        std::vector< std::string > pieces;
+        size_t start = 0;
+        for (;;)
+        {
+            const auto end = text.find(separator, start);
+            if (end == std::string::npos)
+            {
+                pieces.push_back(text.substr(start));
+                return pieces;
+            }
+            pieces.push_back(text.substr(start, end - start));
+            start = end + 1;
+        }
+    }
+
+    /**
+     * This decodes a well-formed emotes tag the slow way: by splitting it
+     * into strings, and walking the text from its start for every range to
+     * find the bytes of the characters it covers.
+     */
+    std::vector< Span > DecodeByReference(const std::string& emotes, const std::string& text)
+    {
+        std::vector< Span > spans;
+        if (emotes.empty())
+        {
+            return spans;
+        }
+        for (const auto& emote: Split(emotes, '/'))
+        {
+            const auto colon = emote.find(':');
+            const auto id = emote.substr(0, colon);
+            for (const auto& range: Split(emote.substr(colon + 1), ','))
+            {
+                const auto dash = range.find('-');
+                const auto first = strtoull(range.substr(0, dash).c_str(), nullptr, 10);
+                const auto last = (
+                    (dash == std::string::npos)
+                    ? first
+                    : strtoull(range.substr(dash + 1).c_str(), nullptr, 10)
+                );
+                size_t character = 0;
+                size_t begin = std::string::npos;
+                size_t end = std::string::npos;
+                for (size_t i = 0; i <= text.length(); ++i)
+                {
+                    if (
+                        (i == text.length())
+                        || (((unsigned char)text[i] & 0xC0) != 0x80)
+                    )
+                    {
+                        if (character == first)
+                        {
+                            begin = i;
+                        }
+                        if (character == last + 1)
+                        {
+                            end = i;
+                            break;
+                        }
+                        ++character;
+                    }
+                }
+                if (
+                    (first <= last)
+                    && (begin < text.length())
+                    && (end != std::string::npos)
+                )
+                {
+                    Span span;
+                    span.id = id;
+                    span.begin = begin;
+                    span.end = end;
+                    spans.push_back(span);
+                }
+            }
+        }
+        return spans;
+    }
+
+    std::vector< Span > GetSpans(const EmoteDecoder& decoder)
+    {
+        std::vector< Span > spans;
+        for (const auto& decoded: decoder.GetSpans())
+        {
+            Span span;
+            span.id = std::string(decoded.id);
+            span.begin = decoded.begin;
+            span.end = decoded.end;
+            spans.push_back(span);
+        }
+        return spans;
+    }
+
+    void TestMatchesReference()
+    {
+        // Lines are made of pieces of one to four bytes per character, and
+        // are often longer than 16 bytes, so that both the quick pass over
+        // ASCII and the lookup of characters are used, on either side of
+        // 16-byte blocks. Ranges sometimes run past the end of the line or
+        // end before they start.
+        const std::vector< std::string > pieces = {
+            "Kappa", "PogChamp", " ", "\xc3\xa9", "\xf0\x9f\x98\x82",
+            "\xe6\x97\xa5\xe6\x9c\xac", "a", "LUL",
+        };
+        std::mt19937 generator(3);
+        EmoteDecoder decoder;
+        size_t spansChecked = 0;
+        for (size_t trial = 0; trial < 50000; ++trial)
+        {
+            std::string text;
+            const auto length = generator() % 40;
+            for (size_t i = 0; i < length; ++i)
+            {
+                text += pieces[generator() % pieces.size()];
+            }
+            size_t characters = 0;
+            for (const auto c: text)
+            {
+                characters += (((unsigned char)c & 0xC0) != 0x80);
+            }
+            std::string emotes;
+            const auto ids = 1 + generator() % 3;
+            for (size_t i = 0; i < ids; ++i)
+            {
+                if (i > 0)
+                {
+                    emotes += '/';
+                }
+                emotes += std::to_string(generator() % 100000) + ":";
+                const auto ranges = 1 + generator() % 4;
+                for (size_t j = 0; j < ranges; ++j)
+                {
+                    if (j > 0)
+                    {
+                        emotes += ',';
+                    }
+                    const auto first = generator() % (characters + 3);
+                    auto last = first + generator() % 6;
+                    if ((first > 0) && ((generator() % 10) == 0))
+                    {
+                        last = first - 1;
+                    }
+                    emotes += std::to_string(first);
+                    if ((generator() % 8) != 0)
+                    {
+                        emotes += "-" + std::to_string(last);
+                    }
+                }
+            }
+            TWITCH_BOT_CHECK(decoder.Decode(emotes, text));
+            const auto expected = DecodeByReference(emotes, text);
+            if (!TWITCH_BOT_CHECK(GetSpans(decoder) == expected))
+            {
+                fprintf(stderr, "emotes \"%s\", text \"%s\"\n", emotes.c_str(), text.c_str());
+                break;
+            }
+            spansChecked += expected.size();
+
+            // The spans cut the emote out of the text whole.
+            for (const auto& span: decoder.GetSpans())
+            {
+                TWITCH_BOT_CHECK(
+                    (span.end == text.length())
+                    || (((unsigned char)text[span.end] & 0xC0) != 0x80)
+                );
+            }
+        }
+        TWITCH_BOT_CHECK(spansChecked > 50000);
+    }
+
+    void TestMalformedTags()
+    {
+        // The spans before the mistake are kept.
+        EmoteDecoder decoder;
+        TWITCH_BOT_CHECK(!decoder.Decode("25:0-4,x", "Kappa Kappa"));
+        TWITCH_BOT_CHECK(decoder.GetSpans().size() == 1);
+        TWITCH_BOT_CHECK(!decoder.Decode(":0-1", "ab"));
+        TWITCH_BOT_CHECK(decoder.GetSpans().empty());
+        TWITCH_BOT_CHECK(!decoder.Decode("25:0-4/26", "Kappa"));
+        TWITCH_BOT_CHECK(decoder.GetSpans().size() == 1);
+        TWITCH_BOT_CHECK(!decoder.Decode("25:0-", "Kappa"));
+        TWITCH_BOT_CHECK(decoder.GetSpans().empty());
+
+        // Numbers too big for any line don't wrap around into range.
+        TWITCH_BOT_CHECK(decoder.Decode("25:18446744073709551616-18446744073709551620", "Kappa"));
+        TWITCH_BOT_CHECK(decoder.GetSpans().empty());
+        TWITCH_BOT_CHECK(decoder.Decode("", "Kappa"));
+        TWITCH_BOT_CHECK(decoder.GetSpans().empty());
+        TWITCH_BOT_CHECK(decoder.Decode(TwitchBot::Message()));
+        TWITCH_BOT_CHECK(decoder.GetSpans().empty());
+    }
+}
+
+int main()
+{
+    TestMatchesReference();
+    TestMalformedTags();
+    return TwitchBot::Test::Finish();
+}
@@ -0,0 +1,190 @@
+#include <stddef.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Executor.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::Executor;
+
+    using TwitchBot::Test::WaitUntil;
+
+    void TestThreadCount()
+    {
+        Executor pool(3);
+        TWITCH_BOT_CHECK(pool.GetThreadCount() == 3);
+        Executor defaultPool;
+        TWITCH_BOT_CHECK(defaultPool.GetThreadCount() >= 1);
+        TWITCH_BOT_CHECK(!Executor::Strand().IsValid());
+        TWITCH_BOT_CHECK(pool.MakeStrand().IsValid());
+    }
+
+    void TestPostRunsEveryTask()
+    {
+        constexpr size_t tasks = 10000;
+        std::atomic< size_t > run{0};
+        Executor pool(4);
+        for (size_t i = 0; i < tasks; ++i)
+        {
+            pool.Post([&]{ ++run; });
+        }
+        TWITCH_BOT_CHECK(WaitUntil([&]{ return pool.GetStats().tasksRun == tasks; }));
+        TWITCH_BOT_CHECK(run == tasks);
+        TWITCH_BOT_CHECK(pool.GetStats().queued == 0);
+    }
+
+    void TestIdleThreadsSteal()
+    {
+        // One task queues more work on its own thread's queue, then keeps
+        // that thread busy until the work is done, so the other threads
+        // can only get to it by stealing.
+        constexpr size_t tasks = 100;
+        std::atomic< size_t > run{0};
+        std::atomic< bool > allRun{false};
+        std::atomic< bool > done{false};
+        Executor pool(4);
+        pool.Post(
+            [&]
+            {
+                for (size_t i = 0; i < tasks; ++i)
+                {
+                    pool.Post([&]{ ++run; });
+                }
+                allRun = WaitUntil([&]{ return run == tasks; });
+                done = true;
+            }
+        );
+        TWITCH_BOT_CHECK(WaitUntil([&]{ return done.load(); }));
+        TWITCH_BOT_CHECK(allRun);
+        TWITCH_BOT_CHECK(pool.GetStats().steals >= tasks);
+    }
+
+    void TestStrandsRunInOrderOneAtATime()
+    {
+        // Many strands, each given far more tasks than it runs in a row,
+        // from threads of their own. Within a strand, tasks must run in the
+        // order posted and never overlap.
+        constexpr size_t strandCount = 16;
+        constexpr size_t tasksPerStrand = 5000;
+        struct Track
+        {
+            Executor::Strand strand;
+            std::atomic< size_t > running{0};
+            size_t next = 0;
+            bool inOrder = true;
+            bool overlapped = false;
+        };
+        std::vector< std::unique_ptr< Track > > tracks;
+        std::atomic< size_t > run{0};
+        Executor pool(4);
+        for (size_t i = 0; i < strandCount; ++i)
+        {
+            tracks.emplace_back(new Track());
+            tracks.back()->strand = pool.MakeStrand();
+        }
+        std::vector< std::thread > posters;
+        for (size_t t = 0; t < 4; ++t)
+        {
+            posters.emplace_back(
+                [&, t]
+                {
+                    for (size_t i = t; i < strandCount; i += 4)
+                    {
+                        auto& track = *tracks[i];
+                        for (size_t n = 0; n < tasksPerStrand; ++n)
+                        {
+                            track.strand.Post(
+                                [&track, &run, n]
+                                {
+                                    if (++track.running != 1)
+                                    {
+                                        track.overlapped = true;
+                                    }
+                                    track.inOrder = track.inOrder && (track.next++ == n);
+                                    --track.running;
+                                    ++run;
+                                }
+                            );
+                        }
+                    }
+                }
+            );
+        }
+        for (auto& poster: posters)
+        {
+            poster.join();
+        }
+        TWITCH_BOT_CHECK(WaitUntil([&]{ return run == strandCount * tasksPerStrand; }));
+        for (const auto& track: tracks)
+        {
+            TWITCH_BOT_CHECK(track->inOrder);
+            TWITCH_BOT_CHECK(!track->overlapped);
+            TWITCH_BOT_CHECK(track->next == tasksPerStrand);
+        }
+    }
+
+    void TestBusyStrandDoesNotStarveOthers()
+    {
+        // With a single thread, a strand with a long backlog goes to the
+        // back of the line after each batch, so a task posted behind it
+        // runs before the backlog is done.
+        std::atomic< size_t > backlogRun{0};
+        std::atomic< size_t > otherRun{0};
+        size_t backlogRunBeforeOther = 0;
+        std::atomic< bool > release{false};
+        Executor pool(1);
+        auto busy = pool.MakeStrand();
+        pool.Post([&]{ while (!release) { std::this_thread::yield(); } });
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            busy.Post([&]{ ++backlogRun; });
+        }
+        pool.Post(
+            [&]
+            {
+                backlogRunBeforeOther = backlogRun;
+                ++otherRun;
+            }
+        );
+        release = true;
+        TWITCH_BOT_CHECK(WaitUntil([&]{ return (backlogRun == 1000) && (otherRun == 1); }));
+        TWITCH_BOT_CHECK(backlogRunBeforeOther < 1000);
+    }
+
+    void TestDestroyRunsQueuedWork()
+    {
+        // Destroying the pool runs everything already posted, including
+        // strands with tasks waiting. A strand outliving its pool drops what
+        // it's given afterwards.
+        std::atomic< size_t > run{0};
+        Executor::Strand strand;
+        {
+            Executor pool(2);
+            strand = pool.MakeStrand();
+            for (size_t i = 0; i < 1000; ++i)
+            {
+                pool.Post([&]{ ++run; });
+                strand.Post([&]{ ++run; });
+            }
+        }
+        TWITCH_BOT_CHECK(run == 2000);
+        strand.Post([&]{ ++run; });
+        TWITCH_BOT_CHECK(run == 2000);
+    }
+}
+
+int main()
+{
+    TestThreadCount();
+    TestPostRunsEveryTask();
+    TestIdleThreadsSteal();
+    TestStrandsRunInOrderOneAtATime();
+    TestBusyStrandDoesNotStarveOthers();
+    TestDestroyRunsQueuedWork();
+    return TwitchBot::Test::Finish();
+}
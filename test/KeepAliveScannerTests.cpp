@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/KeepAliveScanner.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::KeepAliveScanner;
+
+    /**
+     * This feeds the given chunks to a scanner, one after another, and
+     * returns every keepalive message found, as "PING " or "PONG " followed
+     * by its parameter.
+     */
+    std::vector< std::string > ScanChunks(const std::vector< std::string >& chunks)
+    {
+        KeepAliveScanner scanner;
+        std::vector< std::string > found;
+        for (const auto& chunk: chunks)
+        {
+            scanner.Scan(chunk);
+            KeepAliveScanner::Kind kind;
+            std::string_view parameter;
+            while (scanner.NextKeepAlive(kind, parameter))
+            {
+                found.push_back(
+                    ((kind == KeepAliveScanner::Kind::Ping) ? "PING " : "PONG ")
+                    + std::string(parameter)
+                );
+            }
+        }
+        return found;
+    }
+
+    /**
+     * This splits the given text into chunks of random sizes, up to the
+     * given size, and scans them.
+     */
+    std::vector< std::string > ScanSplit(
+        const std::string& text,
+        size_t maxChunk,
+        std::mt19937& generator
+    )
+    {
+        std::vector< std::string > chunks;
+        for (size_t position = 0; position < text.length();)
+        {
+            const auto length = std::min< size_t >(
+                1 + generator() % maxChunk,
+                text.length() - position
+            );
+            chunks.push_back(text.substr(position, length));
+            position += length;
+        }
+        return ScanChunks(chunks);
+    }
+
+    void TestSplitStream()
+    {
+        // Make a stream of keepalive messages among lines which only look
+        // a bit like them, noting the ones which should be found.
+        std::mt19937 generator(1);
+        std::string stream;
+        std::vector< std::string > expected;
+        for (size_t i = 0; i < 5000; ++i)
+        {
+            const auto number = std::to_string(i);
+            switch (generator() % 8)
+            {
+                case 0:
+                {
+                    stream += "PING :tmi.twitch.tv" + number + "\r\n";
+                    expected.push_back("PING tmi.twitch.tv" + number);
+                } break;
+
+                case 1:
+                {
+                    stream += ":tmi.twitch.tv PONG tmi.twitch.tv :" + number + "\r\n";
+                    expected.push_back("PONG " + number);
+                } break;
+
+                case 2:
+                {
+                    stream += ":nick!nick@nick.tmi.twitch.tv JOIN #chan" + number + "\r\n";
+                } break;
+
+                case 3:
+                {
+                    stream += ":tmi.twitch.tv PINGS :no\r\n:a PONGO b\r\nPIN :no\r\n";
+                } break;
+
+                case 4:
+                {
+                    // This line is far longer than any keepalive message,
+                    // and ends looking like one.
+                    stream += ":tmi.twitch.tv NOTICE #c :" + std::string(600, 'x') + " PING :no\r\n";
+                } break;
+
+                default:
+                {
+                    stream += (
+                        "@badge-info=;badges=;color=#FF0000;display-name=u;id=abc;tmi-sent-ts=1"
+                        " :u!u@u.tmi.twitch.tv PRIVMSG #c :PING :not a ping " + number + "\r\n"
+                    );
+                } break;
+            }
+        }
+
+        // One byte at a time, in small chunks, in large chunks, and all at
+        // once, the same messages are found.
+        TWITCH_BOT_CHECK(ScanSplit(stream, 1, generator) == expected);
+        for (size_t trial = 0; trial < 100; ++trial)
+        {
+            TWITCH_BOT_CHECK(ScanSplit(stream, 20, generator) == expected);
+            TWITCH_BOT_CHECK(ScanSplit(stream, 3000, generator) == expected);
+        }
+        TWITCH_BOT_CHECK(ScanChunks({stream}) == expected);
+    }
+
+    void TestTaggedLines()
+    {
+        // The server never tags its keepalive messages, so tagged lines
+        // aren't looked at, whether whole or split.
+        const std::string text = (
+            "@a=b PING :tagged\r\n"
+            "@a=b :tmi.twitch.tv PONG tmi.twitch.tv :tagged\r\n"
+            "PING :untagged\r\n"
+        );
+        const std::vector< std::string > expected = {"PING untagged"};
+        TWITCH_BOT_CHECK(ScanChunks({text}) == expected);
+        for (size_t split = 1; split < text.length(); ++split)
+        {
+            TWITCH_BOT_CHECK(
+                ScanChunks({text.substr(0, split), text.substr(split)}) == expected
+            );
+        }
+    }
+
+    void TestOverLongPartials()
+    {
+        // The start of a line too long to be a keepalive message isn't
+        // kept between chunks, even when it starts like one, and doesn't
+        // get in the way of the lines after it.
+        const std::string longLine = "PING :" + std::string(1000, 'x') + "\r\n";
+        const std::vector< std::string > chunks = {
+            longLine.substr(0, 300),
+            longLine.substr(300, 400),
+            longLine.substr(700) + "PI",
+            "NG :after\r\n",
+        };
+        TWITCH_BOT_CHECK(ScanChunks(chunks) == std::vector< std::string >({"PING after"}));
+
+        // A keepalive message split just before its line feed is still
+        // found once the line feed arrives.
+        TWITCH_BOT_CHECK(
+            ScanChunks({"PING :a", "b\r", "\n"}) == std::vector< std::string >({"PING ab"})
+        );
+    }
+}
+
+int main()
+{
+    TestSplitStream();
+    TestTaggedLines();
+    TestOverLongPartials();
+    return TwitchBot::Test::Finish();
+}
@@ -0,0 +1,214 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LatencyHistogram.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::LatencyHistogram;
+
+    /**
+     * This is the longest duration told apart from the others.
+     */
+    constexpr uint64_t MAX_DURATION = ((uint64_t)1 << LatencyHistogram::MAX_DURATION_BITS) - 1;
+
+    void TestBuckets()
+    {
+        // Short durations each get a bucket of their own.
+        for (uint64_t nanoseconds = 0; nanoseconds < 16; ++nanoseconds)
+        {
+            TWITCH_BOT_CHECK(LatencyHistogram::GetBucket(nanoseconds) == nanoseconds);
+            TWITCH_BOT_CHECK(LatencyHistogram::GetBucketStart((size_t)nanoseconds) == nanoseconds);
+        }
+
+        // Every bucket starts where the one before it ends, its start falls
+        // in it, and each is no wider than a sixteenth of its start.
+        for (size_t bucket = 0; bucket < LatencyHistogram::BUCKET_COUNT; ++bucket)
+        {
+            const auto start = LatencyHistogram::GetBucketStart(bucket);
+            if (!TWITCH_BOT_CHECK(LatencyHistogram::GetBucket(start) == bucket))
+            {
+                break;
+            }
+            if (bucket == 0)
+            {
+                continue;
+            }
+            const auto previousStart = LatencyHistogram::GetBucketStart(bucket - 1);
+            TWITCH_BOT_CHECK(previousStart < start);
+            TWITCH_BOT_CHECK(LatencyHistogram::GetBucket(start - 1) == bucket - 1);
+            TWITCH_BOT_CHECK((start - previousStart) * 16 <= start || (start <= 16));
+        }
+
+        // Buckets never straddle a power of two.
+        for (unsigned int bits = 4; bits < LatencyHistogram::MAX_DURATION_BITS; ++bits)
+        {
+            const auto power = (uint64_t)1 << bits;
+            TWITCH_BOT_CHECK(LatencyHistogram::GetBucketStart(LatencyHistogram::GetBucket(power)) == power);
+        }
+
+        // Durations past the longest told apart all share the last bucket.
+        const auto last = LatencyHistogram::BUCKET_COUNT - 1;
+        TWITCH_BOT_CHECK(LatencyHistogram::GetBucket(MAX_DURATION) == last);
+        TWITCH_BOT_CHECK(LatencyHistogram::GetBucket(MAX_DURATION + 1) == last);
+        TWITCH_BOT_CHECK(LatencyHistogram::GetBucket(UINT64_MAX) == last);
+        TWITCH_BOT_CHECK(LatencyHistogram::GetBucketStart(last) <= MAX_DURATION);
+        TWITCH_BOT_CHECK(LatencyHistogram::GetBucket(LatencyHistogram::GetBucketStart(last) - 1) == last - 1);
+
+        // Random durations land in the bucket whose range holds them.
+        std::mt19937_64 generator(1);
+        for (size_t i = 0; i < 100000; ++i)
+        {
+            const auto nanoseconds = generator() >> (generator() % 64);
+            const auto bucket = LatencyHistogram::GetBucket(nanoseconds);
+            if (
+                !TWITCH_BOT_CHECK(bucket < LatencyHistogram::BUCKET_COUNT)
+                || !TWITCH_BOT_CHECK(LatencyHistogram::GetBucketStart(bucket) <= nanoseconds)
+                || !TWITCH_BOT_CHECK(
+                    (bucket == last)
+                    || (nanoseconds < LatencyHistogram::GetBucketStart(bucket + 1))
+                )
+            )
+            {
+                break;
+            }
+        }
+    }
+
+    void TestPercentiles()
+    {
+        LatencyHistogram histogram;
+        auto summary = histogram.GetSummary();
+        TWITCH_BOT_CHECK(summary.count == 0);
+        TWITCH_BOT_CHECK(summary.p50 == 0);
+        TWITCH_BOT_CHECK(summary.p999 == 0);
+
+        // With durations 0 to 9, each in a bucket of its own, the
+        // percentiles are the durations at ranks 5, 9, 10 and 10, counting
+        // from one and rounding up.
+        for (uint64_t nanoseconds = 0; nanoseconds < 10; ++nanoseconds)
+        {
+            histogram.Record(nanoseconds);
+        }
+        summary = histogram.GetSummary();
+        TWITCH_BOT_CHECK(summary.count == 10);
+        TWITCH_BOT_CHECK(summary.sum == 45);
+        TWITCH_BOT_CHECK(summary.max == 9);
+        TWITCH_BOT_CHECK(summary.p50 == 4);
+        TWITCH_BOT_CHECK(summary.p90 == 8);
+        TWITCH_BOT_CHECK(summary.p99 == 9);
+        TWITCH_BOT_CHECK(summary.p999 == 9);
+
+        // A single long duration among a thousand only shows at the 99.9th
+        // percentile once it's more than one in a thousand.
+        histogram.Clear();
+        TWITCH_BOT_CHECK(histogram.GetCount() == 0);
+        for (size_t i = 0; i < 999; ++i)
+        {
+            histogram.Record(10);
+        }
+        histogram.Record(5000);
+        summary = histogram.GetSummary();
+        TWITCH_BOT_CHECK(summary.p99 == 10);
+        TWITCH_BOT_CHECK(summary.p999 == 10);
+        TWITCH_BOT_CHECK(summary.max == 5000);
+        histogram.Record(5000);
+        summary = histogram.GetSummary();
+        TWITCH_BOT_CHECK(summary.p999 > 4000);
+        TWITCH_BOT_CHECK(summary.p999 <= 5000);
+
+        // Percentiles are the end of their bucket, but never past the
+        // longest duration.
+        histogram.Clear();
+        histogram.Record(1000);
+        summary = histogram.GetSummary();
+        TWITCH_BOT_CHECK(summary.p50 == 1000);
+        histogram.Record(1001);
+        histogram.Record(1002);
+        summary = histogram.GetSummary();
+        TWITCH_BOT_CHECK(summary.p50 == 1002);
+        histogram.Record(2000);
+        summary = histogram.GetSummary();
+        TWITCH_BOT_CHECK(
+            summary.p50
+            == LatencyHistogram::GetBucketStart(LatencyHistogram::GetBucket(1000) + 1) - 1
+        );
+
+        // Durations past the last bucket still count, and show as the
+        // longest.
+        histogram.Clear();
+        histogram.Record(UINT64_MAX / 2);
+        summary = histogram.GetSummary();
+        TWITCH_BOT_CHECK(summary.count == 1);
+        TWITCH_BOT_CHECK(summary.p50 == UINT64_MAX / 2);
+        TWITCH_BOT_CHECK(histogram.GetCountBelow(MAX_DURATION) == 0);
+        TWITCH_BOT_CHECK(histogram.GetCountBelow(UINT64_MAX) == 1);
+    }
+
+    void TestCountBelow()
+    {
+        LatencyHistogram histogram;
+        for (uint64_t nanoseconds = 1; nanoseconds <= 4096; ++nanoseconds)
+        {
+            histogram.Record(nanoseconds);
+        }
+        TWITCH_BOT_CHECK(histogram.GetCount() == 4096);
+        TWITCH_BOT_CHECK(histogram.GetSum() == (uint64_t)4096 * 4097 / 2);
+
+        // Counts below a power of two are exact.
+        for (unsigned int bits = 0; bits <= 13; ++bits)
+        {
+            const auto power = (uint64_t)1 << bits;
+            TWITCH_BOT_CHECK(histogram.GetCountBelow(power) == std::min< uint64_t >(power - 1, 4096));
+        }
+        TWITCH_BOT_CHECK(histogram.GetCountBelow(0) == 0);
+    }
+
+    void TestConcurrentRecording()
+    {
+        LatencyHistogram histogram;
+        constexpr size_t threadCount = 4;
+        constexpr size_t perThread = 100000;
+        std::vector< std::thread > threads;
+        for (size_t t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back(
+                [&, t]
+                {
+                    for (size_t i = 0; i < perThread; ++i)
+                    {
+                        histogram.Record(t * 1000 + i % 100);
+                    }
+                }
+            );
+        }
+        for (auto& thread: threads)
+        {
+            thread.join();
+        }
+        const auto summary = histogram.GetSummary();
+        TWITCH_BOT_CHECK(summary.count == threadCount * perThread);
+        TWITCH_BOT_CHECK(summary.max == (threadCount - 1) * 1000 + 99);
+        uint64_t sum = 0;
+        for (size_t t = 0; t < threadCount; ++t)
+        {
+            sum += (perThread / 100) * (t * 1000 * 100 + 99 * 100 / 2);
+        }
+        TWITCH_BOT_CHECK(summary.sum == sum);
+    }
+}
+
+int main()
+{
+    TestBuckets();
+    TestPercentiles();
+    TestCountBelow();
+    TestConcurrentRecording();
+    return TwitchBot::Test::Finish();
+}
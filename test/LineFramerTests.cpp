@@ -0,0 +1,145 @@
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LineFramer.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    /**
+     * This is how the MessageManager split lines before LineFramer: cut the
+     * first line off the front of the buffer, without its CRLF.
+     */
+    bool NextLineBySubstr(std::string& dataReceived, std::string& line)
+    {
+        const auto lineEnd = dataReceived.find("\r\n");
+        if (lineEnd == std::string::npos)
+        {
+            return false;
+        }
+        line = dataReceived.substr(0, lineEnd);
+        dataReceived = dataReceived.substr(lineEnd + 2);
+        return true;
+    }
+
+    /**
+     * This takes every complete line out of the framer.
+     */
+    std::vector< std::string > TakeLines(TwitchBot::LineFramer& framer)
+    {
+        std::vector< std::string > lines;
+        std::string_view line;
+        while (framer.NextLine(line))
+        {
+            lines.emplace_back(line);
+        }
+        return lines;
+    }
+
+    void TestPartialLinesAcrossChunks()
+    {
+        TwitchBot::LineFramer framer;
+        framer.Append(std::string("PING :tmi.tw"));
+        TWITCH_BOT_CHECK(TakeLines(framer).empty());
+        TWITCH_BOT_CHECK(framer.GetBufferedLength() == 12);
+        framer.Append(std::string("itch.tv\r"));
+        TWITCH_BOT_CHECK(TakeLines(framer).empty());
+        framer.Append(std::string("\n:a PRIVMSG #b :c\r\n:d"));
+        const auto lines = TakeLines(framer);
+        TWITCH_BOT_CHECK(
+            lines == std::vector< std::string >({
+                "PING :tmi.twitch.tv",
+                ":a PRIVMSG #b :c",
+            })
+        );
+        TWITCH_BOT_CHECK(framer.GetBufferedLength() == 2);
+    }
+
+    void TestEmptyLinesAndStrayCarriageReturns()
+    {
+        TwitchBot::LineFramer framer;
+        framer.Append(std::string("\r\n\r\na\rb\r\n\r\r\n"));
+        TWITCH_BOT_CHECK(
+            TakeLines(framer) == std::vector< std::string >({"", "", "a\rb", "\r"})
+        );
+        TWITCH_BOT_CHECK(framer.GetBufferedLength() == 0);
+    }
+
+    void TestClear()
+    {
+        TwitchBot::LineFramer framer;
+        framer.Append(std::string("partial"));
+        framer.Clear();
+        TWITCH_BOT_CHECK(framer.GetBufferedLength() == 0);
+        framer.Append(std::string("line\r\n"));
+        TWITCH_BOT_CHECK(TakeLines(framer) == std::vector< std::string >({"line"}));
+    }
+
+    void TestMatchesSubstrSplitting()
+    {
+        // Lines of random length, some empty and some with stray CRs, fed
+        // in random chunk sizes, from single bytes to more than the
+        // framer's initial buffer, so that partial lines are moved and the
+        // buffer grows.
+        std::mt19937 random(1);
+        std::string capture;
+        while (capture.length() < 256 * 1024)
+        {
+            const auto length = (random() % 20 == 0) ? 0 : random() % 600;
+            for (size_t i = 0; i < length; ++i)
+            {
+                capture += (random() % 50 == 0) ? '\r' : (char)('a' + random() % 26);
+            }
+            capture += "\r\n";
+        }
+        capture += "trailing partial line";
+        for (const size_t maxChunk: {5, 1400, 9000})
+        {
+            TwitchBot::LineFramer framer;
+            std::string dataReceived;
+            std::vector< std::string > framed;
+            std::vector< std::string > expected;
+            size_t offset = 0;
+            while (offset < capture.length())
+            {
+                const auto chunk = capture.substr(offset, 1 + random() % maxChunk);
+                offset += chunk.length();
+                framer.Append(chunk);
+                for (auto& line: TakeLines(framer))
+                {
+                    framed.push_back(std::move(line));
+                }
+                dataReceived += chunk;
+                std::string line;
+                while (NextLineBySubstr(dataReceived, line))
+                {
+                    expected.push_back(line);
+                }
+            }
+            TWITCH_BOT_CHECK(framed == expected);
+            TWITCH_BOT_CHECK(framer.GetBufferedLength() == dataReceived.length());
+        }
+    }
+
+    void TestMove()
+    {
+        TwitchBot::LineFramer framer;
+        framer.Append(std::string("one\r\ntw"));
+        TwitchBot::LineFramer moved(std::move(framer));
+        moved.Append(std::string("o\r\n"));
+        TWITCH_BOT_CHECK(TakeLines(moved) == std::vector< std::string >({"one", "two"}));
+    }
+}
+
+int main()
+{
+    TestPartialLinesAcrossChunks();
+    TestEmptyLinesAndStrayCarriageReturns();
+    TestClear();
+    TestMatchesSubstrSplitting();
+    TestMove();
+    return TwitchBot::Test::Finish();
+}
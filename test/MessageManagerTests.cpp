@@ -0,0 +1,835 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LoopbackServer.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageManager.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SimulatedTimeKeeper.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SocketConnection.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SymbolTable.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    /**
+     * This is a stand-in connection which takes as long to connect as the
+     * test wants, and connects or not as the test says.
+     */
+    class SlowConnection
+        : public TwitchBot::Test::FakeConnection
+    {
+        public:
+            /**
+             * This returns an indication of whether or not the connection
+             * is being made.
+             */
+            bool IsConnecting()
+            {
+                std::lock_guard< decltype(mutex_) > lock(mutex_);
+                return connecting_;
+            }
+
+            /**
+             * This lets the connection finish connecting, with the given
+             * outcome.
+             */
+            void Finish(bool succeed)
+            {
+                std::lock_guard< decltype(mutex_) > lock(mutex_);
+                finished_ = true;
+                succeed_ = succeed;
+                finishedCondition_.notify_all();
+            }
+
+        // TwitchBot::Connection
+        public:
+            virtual bool Connect() override
+            {
+                {
+                    std::unique_lock< decltype(mutex_) > lock(mutex_);
+                    connecting_ = true;
+                    finishedCondition_.wait(lock, [this]{ return finished_; });
+                    connecting_ = false;
+                    if (!succeed_)
+                    {
+                        return false;
+                    }
+                }
+                return FakeConnection::Connect();
+            }
+
+        private:
+            std::mutex mutex_;
+            std::condition_variable finishedCondition_;
+            bool connecting_ = false;
+            bool finished_ = false;
+            bool succeed_ = false;
+    };
+
+    /**
+     * This is a stand-in connection which can never be made.
+     */
+    class FailingConnection
+        : public TwitchBot::Test::FakeConnection
+    {
+        // TwitchBot::Connection
+        public:
+            virtual bool Connect() override
+            {
+                return false;
+            }
+    };
+
+    /**
+     * This counts the lines a LoopbackServer receives which start with
+     * given text.
+     */
+    class ServerLines
+    {
+        public:
+            void Add(const std::string& line)
+            {
+                std::lock_guard< decltype(mutex_) > lock(mutex_);
+                lines_.push_back(line);
+            }
+
+            size_t Count(const std::string& start)
+            {
+                std::lock_guard< decltype(mutex_) > lock(mutex_);
+                return (size_t)std::count_if(
+                    lines_.begin(),
+                    lines_.end(),
+                    [&](const std::string& line)
+                    {
+                        return (line.compare(0, start.length(), start) == 0);
+                    }
+                );
+            }
+
+        private:
+            std::mutex mutex_;
+            std::vector< std::string > lines_;
+    };
+
+    /**
+     * This reads the samples of text in the Prometheus text format, by
+     * name and labels, checking that every sample is well formed and
+     * comes after the HELP and TYPE of its metric.
+     */
+    std::map< std::string, double > ParseStatsText(const std::string& text)
+    {
+        std::map< std::string, double > samples;
+        std::set< std::string > described;
+        std::istringstream lines(text);
+        std::string line;
+        while (std::getline(lines, line))
+        {
+            if (line.compare(0, 7, "# HELP ") == 0)
+            {
+                continue;
+            }
+            if (line.compare(0, 7, "# TYPE ") == 0)
+            {
+                const auto nameEnd = line.find(' ', 7);
+                const auto type = line.substr(nameEnd + 1);
+                TWITCH_BOT_CHECK(
+                    (type == "counter")
+                    || (type == "gauge")
+                    || (type == "histogram")
+                );
+                described.insert(line.substr(7, nameEnd - 7));
+                continue;
+            }
+            const auto valueStart = line.rfind(' ');
+            if (!TWITCH_BOT_CHECK(valueStart != std::string::npos))
+            {
+                continue;
+            }
+            const auto key = line.substr(0, valueStart);
+            auto name = key.substr(0, key.find('{'));
+            for (const auto suffix: {"_bucket", "_sum", "_count"})
+            {
+                if (
+                    (described.count(name) == 0)
+                    && (name.length() > strlen(suffix))
+                    && (name.compare(name.length() - strlen(suffix), std::string::npos, suffix) == 0)
+                )
+                {
+                    name.erase(name.length() - strlen(suffix));
+                }
+            }
+            TWITCH_BOT_CHECK(described.count(name) == 1);
+            char* end = nullptr;
+            const auto value = strtod(line.c_str() + valueStart + 1, &end);
+            TWITCH_BOT_CHECK(*end == '\0');
+            TWITCH_BOT_CHECK(samples.count(key) == 0);
+            samples[key] = value;
+        }
+        return samples;
+    }
+
+    /**
+     * This checks that the buckets of a histogram in the given samples
+     * count up to its total.
+     */
+    void CheckHistogram(
+        const std::map< std::string, double >& samples,
+        const std::string& name,
+        const std::string& labels
+    )
+    {
+        const auto prefix = name + "_bucket{" + labels;
+
+        // The samples are in order of name, not of bound, so the bounds are
+        // put in order to check the counts only grow.
+        std::vector< std::pair< double, double > > bounds;
+        for (const auto& sample: samples)
+        {
+            if (sample.first.compare(0, prefix.length(), prefix) != 0)
+            {
+                continue;
+            }
+            const auto boundStart = sample.first.find("le=\"") + 4;
+            const auto bound = sample.first.substr(boundStart, sample.first.find('"', boundStart) - boundStart);
+            bounds.emplace_back(
+                (bound == "+Inf") ? HUGE_VAL : strtod(bound.c_str(), nullptr),
+                sample.second
+            );
+        }
+        if (!TWITCH_BOT_CHECK(bounds.size() > 1))
+        {
+            return;
+        }
+        std::sort(bounds.begin(), bounds.end());
+        TWITCH_BOT_CHECK(bounds.back().first == HUGE_VAL);
+        for (size_t i = 1; i < bounds.size(); ++i)
+        {
+            TWITCH_BOT_CHECK(bounds[i - 1].second <= bounds[i].second);
+        }
+        const auto totalLabels = (labels.empty() ? std::string() : "{" + labels.substr(0, labels.length() - 1) + "}");
+        const auto count = samples.find(name + "_count" + totalLabels);
+        if (TWITCH_BOT_CHECK(count != samples.end()))
+        {
+            TWITCH_BOT_CHECK(bounds.back().second == count->second);
+        }
+        TWITCH_BOT_CHECK(samples.count(name + "_sum" + totalLabels) == 1);
+    }
+
+    void TestWorkerCarriesOnWhileConnecting()
+    {
+        const auto connection = std::make_shared< SlowConnection >();
+        TwitchBot::MessageManager manager;
+        manager.SetConnectionFactory([&connection]{ return connection; });
+        std::mutex mutex;
+        bool loggedOut = false;
+        manager.SetLoggedOutDelegate(
+            [&]
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                loggedOut = true;
+            }
+        );
+        manager.LogIn("bot", "token");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return connection->IsConnecting(); })
+        );
+
+        // The worker isn't stuck in Connect, so logging out goes ahead, and
+        // the connection is given up on.
+        manager.LogOut("");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return loggedOut;
+                }
+            )
+        );
+        connection->Finish(true);
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return connection.use_count() == 1; })
+        );
+        TWITCH_BOT_CHECK(connection->GetLines().empty());
+    }
+
+    void TestFailedConnectIsRetried()
+    {
+        const auto failing = std::make_shared< SlowConnection >();
+        const auto working = std::make_shared< SlowConnection >();
+        failing->Finish(false);
+        working->Finish(true);
+        TwitchBot::MessageManager manager;
+        size_t made = 0;
+        manager.SetConnectionFactory(
+            [&]() -> std::shared_ptr< TwitchBot::Connection >
+            {
+                return (made++ == 0) ? failing : working;
+            }
+        );
+        std::mutex mutex;
+        size_t logIns = 0;
+        size_t logOuts = 0;
+        manager.SetLoggedInDelegate(
+            [&]
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                ++logIns;
+            }
+        );
+        manager.SetLoggedOutDelegate(
+            [&]
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                ++logOuts;
+            }
+        );
+        manager.LogIn("bot", "token");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return (logIns == 1);
+                }
+            )
+        );
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            TWITCH_BOT_CHECK(logOuts == 1);
+        }
+        TWITCH_BOT_CHECK(failing->GetLines().empty());
+        TWITCH_BOT_CHECK(working->CountLines("NICK bot") == 1);
+        manager.LogOut("");
+    }
+
+    void TestReconnectBackoff()
+    {
+        const auto timeKeeper = std::make_shared< TwitchBot::SimulatedTimeKeeper >();
+        timeKeeper->SetCurrentTime(1000.0);
+        TwitchBot::MessageManager manager;
+        manager.SetTimeKeeper(timeKeeper);
+        std::mutex mutex;
+        std::vector< double > attempts;
+        std::weak_ptr< FailingConnection > lastConnection;
+        manager.SetConnectionFactory(
+            [&]
+            {
+                const auto connection = std::make_shared< FailingConnection >();
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                attempts.push_back(timeKeeper->GetCurrentTime());
+                lastConnection = connection;
+                return connection;
+            }
+        );
+        const auto countAttempts = [&]
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            return attempts.size();
+        };
+
+        // When logging in fails, the first attempt to reconnect is made
+        // right away.
+        manager.LogIn("bot", "token");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return countAttempts() == 2; })
+        );
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            TWITCH_BOT_CHECK(attempts[1] == attempts[0]);
+        }
+
+        // Each attempt after that waits somewhere between half of and all
+        // of a delay which doubles each time, up to a minute.
+        const double delays[] = {1.0, 2.0, 4.0, 8.0, 16.0, 32.0, 60.0, 60.0};
+        size_t early = 0;
+        for (const auto delay: delays)
+        {
+            // Wait for the failed attempt to be handled, which schedules
+            // the next one, before moving the time.
+            const auto attempt = countAttempts();
+            TWITCH_BOT_CHECK(
+                TwitchBot::Test::WaitUntil(
+                    [&]
+                    {
+                        std::lock_guard< decltype(mutex) > lock(mutex);
+                        return lastConnection.expired();
+                    }
+                )
+            );
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            double last;
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                last = attempts.back();
+            }
+            timeKeeper->SetCurrentTime(last + delay * 0.5 - 0.001);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            TWITCH_BOT_CHECK(countAttempts() == attempt);
+            constexpr size_t steps = 20;
+            for (size_t step = 1; step <= steps; ++step)
+            {
+                timeKeeper->SetCurrentTime(last + delay * (0.5 + 0.5 * (double)step / (double)steps));
+                if (
+                    TwitchBot::Test::WaitUntil(
+                        [&]{ return countAttempts() > attempt; },
+                        std::chrono::milliseconds((step == steps) ? 5000 : 5)
+                    )
+                )
+                {
+                    break;
+                }
+            }
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            if (!TWITCH_BOT_CHECK(attempts.size() == attempt + 1))
+            {
+                break;
+            }
+            const auto waited = attempts.back() - last;
+            TWITCH_BOT_CHECK(waited >= delay * 0.5);
+            TWITCH_BOT_CHECK(waited <= delay + 0.001);
+            if (waited < delay * 0.99)
+            {
+                ++early;
+            }
+        }
+
+        // The delays are randomized, rather than always the longest.
+        TWITCH_BOT_CHECK(early > 0);
+        manager.LogOut("");
+    }
+
+    void TestChannelsRejoinedAfterDrop()
+    {
+        TwitchBot::LoopbackServer server;
+        ServerLines received;
+        server.SetLineReceivedDelegate([&](const std::string& line){ received.Add(line); });
+        TWITCH_BOT_CHECK(server.Start());
+        const auto timeKeeper = std::make_shared< TwitchBot::SimulatedTimeKeeper >();
+        TwitchBot::MessageManager manager;
+        manager.SetTimeKeeper(timeKeeper);
+        manager.SetConnectionFactory(
+            [&]
+            {
+                return std::make_shared< TwitchBot::SocketConnection >("127.0.0.1", server.GetPort());
+            }
+        );
+        std::atomic< size_t > logIns{0};
+        manager.SetLoggedInDelegate([&]{ ++logIns; });
+        manager.LogIn("bot", "token");
+        manager.Join("alpha");
+        manager.Join("beta");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]{ return (received.Count("JOIN #alpha") == 1) && (received.Count("JOIN #beta") == 1); }
+            )
+        );
+        manager.Leave("beta");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return received.Count("PART #beta") == 1; })
+        );
+
+        // The server dropping the agent has it connect and log in again at
+        // once, joining again the channels it's still in, without any time
+        // passing.
+        server.DisconnectClients();
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return received.Count("JOIN #alpha") == 2; })
+        );
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return logIns == 2; })
+        );
+        TWITCH_BOT_CHECK(received.Count("NICK bot") == 2);
+        TWITCH_BOT_CHECK(received.Count("JOIN #beta") == 1);
+        TWITCH_BOT_CHECK(server.GetClientCount() == 1);
+        TWITCH_BOT_CHECK(manager.GetStats().reconnects == 1);
+        manager.LogOut("");
+        server.Stop();
+    }
+
+    void TestServerReconnectWithWarmStandby()
+    {
+        TwitchBot::LoopbackServer server;
+        ServerLines received;
+        server.SetLineReceivedDelegate([&](const std::string& line){ received.Add(line); });
+        TWITCH_BOT_CHECK(server.Start());
+        const auto timeKeeper = std::make_shared< TwitchBot::SimulatedTimeKeeper >();
+        TwitchBot::MessageManager manager;
+        manager.SetTimeKeeper(timeKeeper);
+        manager.SetWarmStandby(true);
+        manager.SetConnectionFactory(
+            [&]
+            {
+                return std::make_shared< TwitchBot::SocketConnection >("127.0.0.1", server.GetPort());
+            }
+        );
+        std::atomic< size_t > logIns{0};
+        std::atomic< size_t > logOuts{0};
+        std::mutex mutex;
+        std::vector< bool > seen(300, false);
+        manager.SetLoggedInDelegate([&]{ ++logIns; });
+        manager.SetLoggedOutDelegate([&]{ ++logOuts; });
+        manager.SetMessageReceivedDelegate(
+            [&](const TwitchBot::Message& message)
+            {
+                if (message.GetKnownCommand() != TwitchBot::KnownCommand::Privmsg)
+                {
+                    return;
+                }
+                const auto number = std::stoul(message.parameters[1]);
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                if (number < seen.size())
+                {
+                    seen[number] = true;
+                }
+            }
+        );
+        const auto countSeen = [&]
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            return (size_t)std::count(seen.begin(), seen.end(), true);
+        };
+        const auto broadcast = [&](size_t first, size_t last)
+        {
+            for (size_t i = first; i < last; ++i)
+            {
+                server.SendToChannel("alpha", ":u!u@u.tmi.twitch.tv PRIVMSG #alpha :" + std::to_string(i) + "\r\n");
+            }
+        };
+        manager.LogIn("bot", "token");
+        manager.Join("alpha");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return received.Count("JOIN #alpha") == 1; })
+        );
+
+        // The standby connection is made, and logs in, a while after the
+        // first one has. The join goes out before the server's answer to
+        // logging in is handled, so the clock may only move on once the
+        // agent is logged in, and the standby's timer is set.
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return logIns == 1; })
+        );
+        timeKeeper->Advance(1.5);
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return received.Count("NICK bot") == 2; })
+        );
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return server.GetClientCount() == 2; })
+        );
+        broadcast(0, 100);
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return countSeen() == 100; })
+        );
+
+        // When the server asks the agent to reconnect, the standby takes
+        // over and joins the channel again, while the old connection keeps
+        // delivering the channel's messages until then. Like the Twitch
+        // server, this one only sends the channel's traffic, and the
+        // notice, to the connections in the channel.
+        server.SendToChannel("alpha", ":tmi.twitch.tv RECONNECT\r\n");
+        broadcast(100, 200);
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return received.Count("JOIN #alpha") == 2; })
+        );
+        broadcast(200, 300);
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return countSeen() == 300; })
+        );
+        TWITCH_BOT_CHECK(received.Count("NICK bot") == 2);
+        TWITCH_BOT_CHECK(logIns == 1);
+        TWITCH_BOT_CHECK(logOuts == 0);
+        TWITCH_BOT_CHECK(manager.GetStats().reconnects == 1);
+        manager.LogOut("");
+        server.Stop();
+    }
+
+    void TestSendersNotInterned()
+    {
+        const auto connection = std::make_shared< TwitchBot::Test::FakeConnection >();
+        TwitchBot::MessageManager manager;
+        manager.SetConnectionFactory([&connection]{ return connection; });
+        std::atomic< bool > loggedIn{false};
+        std::mutex mutex;
+        std::vector< TwitchBot::SymbolTable::Symbol > userSymbols;
+        manager.SetLoggedInDelegate([&]{ loggedIn = true; });
+        manager.SetMessageReceivedDelegate(
+            [&](const TwitchBot::Message& message)
+            {
+                if (message.GetKnownCommand() == TwitchBot::KnownCommand::Privmsg)
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    userSymbols.push_back(message.userSymbol);
+                }
+            }
+        );
+        manager.LogIn("bot", "token");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return (bool)loggedIn; })
+        );
+
+        // However many users chat, the table only holds the agent's own
+        // nickname and the channel. Messages from the agent still carry
+        // its symbol.
+        constexpr size_t chatters = 1000;
+        for (size_t i = 0; i < chatters; ++i)
+        {
+            const auto user = "user" + std::to_string(i);
+            connection->Receive(":" + user + "!" + user + "@" + user + ".tmi.twitch.tv PRIVMSG #chan :hi\r\n");
+        }
+        connection->Receive(":bot!bot@bot.tmi.twitch.tv PRIVMSG #chan :hi\r\n");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return userSymbols.size() == chatters + 1;
+                }
+            )
+        );
+        const auto table = manager.GetSymbolTable();
+        TWITCH_BOT_CHECK(table->GetCount() == 2);
+        TWITCH_BOT_CHECK(table->Find("user0") == TwitchBot::SymbolTable::NO_SYMBOL);
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            TWITCH_BOT_CHECK(userSymbols.front() == TwitchBot::SymbolTable::NO_SYMBOL);
+            TWITCH_BOT_CHECK(userSymbols.back() == table->Find("bot"));
+            TWITCH_BOT_CHECK(userSymbols.back() != TwitchBot::SymbolTable::NO_SYMBOL);
+        }
+        manager.LogOut("");
+    }
+
+    void TestOversizedPongTokenIgnored()
+    {
+        const auto connection = std::make_shared< TwitchBot::Test::FakeConnection >();
+        const auto timeKeeper = std::make_shared< TwitchBot::SimulatedTimeKeeper >();
+        timeKeeper->SetCurrentTime(1000.0);
+        TwitchBot::MessageManager manager;
+        manager.SetTimeKeeper(timeKeeper);
+        manager.SetKeepAlive(60.0, 10.0);
+        manager.SetConnectionFactory([&connection]{ return connection; });
+        std::atomic< bool > loggedIn{false};
+        manager.SetLoggedInDelegate([&]{ loggedIn = true; });
+        manager.LogIn("bot", "token");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return (bool)loggedIn; })
+        );
+
+        // A PONG whose token has more digits than any time the agent could
+        // have sent isn't taken for the answer to one of its PINGs, so the
+        // real answer still counts.
+        connection->Receive(":tmi.twitch.tv PONG tmi.twitch.tv :19446744073709551616\r\n");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    if (connection->CountLines("PING :") == 1)
+                    {
+                        return true;
+                    }
+                    timeKeeper->Advance(1.0);
+                    return false;
+                }
+            )
+        );
+        std::string token;
+        for (const auto& line: connection->GetLines())
+        {
+            if (line.compare(0, 6, "PING :") == 0)
+            {
+                token = line.substr(6);
+            }
+        }
+        connection->Receive(":tmi.twitch.tv PONG tmi.twitch.tv :" + token + "\r\n");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return manager.GetStats().serverRoundTrip.count == 1; })
+        );
+        timeKeeper->Advance(15.0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        TWITCH_BOT_CHECK(manager.GetStats().keepAliveTimeouts == 0);
+        TWITCH_BOT_CHECK(connection->IsConnected());
+        manager.LogOut("");
+    }
+
+    void TestStatsText()
+    {
+        const auto connection = std::make_shared< TwitchBot::Test::FakeConnection >();
+        TwitchBot::MessageManager manager;
+        manager.SetConnectionFactory([&connection]{ return connection; });
+        std::atomic< bool > loggedIn{false};
+        std::atomic< size_t > chatLines{0};
+        manager.SetLoggedInDelegate([&]{ loggedIn = true; });
+        manager.SetMessageReceivedDelegate(
+            [&](const TwitchBot::Message& message)
+            {
+                if (message.GetKnownCommand() == TwitchBot::KnownCommand::Privmsg)
+                {
+                    ++chatLines;
+                }
+            }
+        );
+        manager.LogIn("bot", "token");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return (bool)loggedIn; })
+        );
+        // Parsing is only timed for one line in every 32, so enough lines
+        // are sent for at least one to be timed.
+        for (size_t i = 0; i < 40; ++i)
+        {
+            connection->Receive(":u!u@u.tmi.twitch.tv PRIVMSG #chan :hi\r\n");
+        }
+        connection->Receive(":tmi.twitch.tv\r\n");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return chatLines == 40; })
+        );
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return manager.GetStats().parseFailures == 1; })
+        );
+
+        // The text has the same counts as GetStats, and every histogram's
+        // buckets add up.
+        const auto stats = manager.GetStats();
+        const auto samples = ParseStatsText(manager.GetStatsText());
+        TWITCH_BOT_CHECK(samples.at("twitchbot_messages_received_total") == (double)stats.messages);
+        TWITCH_BOT_CHECK(samples.at("twitchbot_messages_received_total") >= 41.0);
+        TWITCH_BOT_CHECK(samples.at("twitchbot_parse_failures_total") == 1.0);
+        TWITCH_BOT_CHECK(samples.at("twitchbot_chunks_received_total") == (double)stats.chunks);
+        TWITCH_BOT_CHECK(samples.at("twitchbot_bytes_received_total") == (double)stats.bytes);
+        TWITCH_BOT_CHECK(samples.at("twitchbot_reconnects_total") == 0.0);
+        for (const auto stage: {"queue_wait", "parse", "dispatch", "outbound_wait"})
+        {
+            CheckHistogram(samples, "twitchbot_stage_seconds", std::string("stage=\"") + stage + "\",");
+        }
+        TWITCH_BOT_CHECK(
+            samples.at("twitchbot_stage_seconds_count{stage=\"parse\"}")
+            == (double)stats.parse.count
+        );
+        TWITCH_BOT_CHECK(stats.parse.count > 0);
+        CheckHistogram(samples, "twitchbot_server_round_trip_seconds", "");
+        TWITCH_BOT_CHECK(samples.count("twitchbot_outbound_throttled_total") == 1);
+        manager.LogOut("");
+    }
+
+    void TestStatsFile()
+    {
+        char directoryName[] = "/tmp/MessageManagerTests.XXXXXX";
+        if (!TWITCH_BOT_CHECK(mkdtemp(directoryName) != nullptr))
+        {
+            return;
+        }
+        const std::string directory = directoryName;
+        const auto path = directory + "/stats.prom";
+        const auto readFile = [](const std::string& filePath)
+        {
+            std::ifstream file(filePath);
+            std::stringstream contents;
+            contents << file.rdbuf();
+            return contents.str();
+        };
+        const auto exists = [](const std::string& filePath)
+        {
+            struct stat status;
+            return (stat(filePath.c_str(), &status) == 0);
+        };
+        {
+            const auto timeKeeper = std::make_shared< TwitchBot::SimulatedTimeKeeper >();
+            const auto connection = std::make_shared< TwitchBot::Test::FakeConnection >();
+            TwitchBot::MessageManager manager;
+            manager.SetTimeKeeper(timeKeeper);
+            manager.SetConnectionFactory([&connection]{ return connection; });
+            std::atomic< bool > loggedIn{false};
+            manager.SetLoggedInDelegate([&]{ loggedIn = true; });
+            manager.SetStatsFile(path, 10.0);
+            manager.LogIn("bot", "token");
+            TWITCH_BOT_CHECK(
+                TwitchBot::Test::WaitUntil([&]{ return (bool)loggedIn; })
+            );
+
+            // Nothing is written until the interval has gone by, and then
+            // the file is whole, with no temporary file left behind.
+            TWITCH_BOT_CHECK(!exists(path));
+            timeKeeper->Advance(10.5);
+            TWITCH_BOT_CHECK(
+                TwitchBot::Test::WaitUntil([&]{ return exists(path); })
+            );
+            TWITCH_BOT_CHECK(!exists(path + ".tmp"));
+            auto samples = ParseStatsText(readFile(path));
+            TWITCH_BOT_CHECK(samples.count("twitchbot_messages_received_total") == 1);
+            TWITCH_BOT_CHECK(samples.count("twitchbot_outbound_throttled_total") == 1);
+
+            // Each interval writes the file again, over the old one.
+            for (size_t i = 0; i < 5; ++i)
+            {
+                connection->Receive(":u!u@u.tmi.twitch.tv PRIVMSG #chan :hi\r\n");
+            }
+            TWITCH_BOT_CHECK(
+                TwitchBot::Test::WaitUntil([&]{ return manager.GetStats().messages >= 6; })
+            );
+            const auto messages = (double)manager.GetStats().messages;
+            timeKeeper->Advance(10.0);
+            TWITCH_BOT_CHECK(
+                TwitchBot::Test::WaitUntil(
+                    [&]
+                    {
+                        const auto written = ParseStatsText(readFile(path));
+                        const auto sample = written.find("twitchbot_messages_received_total");
+                        return (
+                            (sample != written.end())
+                            && (sample->second == messages)
+                        );
+                    }
+                )
+            );
+            TWITCH_BOT_CHECK(!exists(path + ".tmp"));
+            manager.LogOut("");
+        }
+
+        // The file is written once more when the manager is destroyed, and
+        // writing stops once the path is cleared.
+        TWITCH_BOT_CHECK(unlink(path.c_str()) == 0);
+        {
+            TwitchBot::MessageManager manager;
+            manager.SetStatsFile(path, 3600.0);
+        }
+        TWITCH_BOT_CHECK(exists(path));
+        TWITCH_BOT_CHECK(!ParseStatsText(readFile(path)).empty());
+        TWITCH_BOT_CHECK(unlink(path.c_str()) == 0);
+        {
+            TwitchBot::MessageManager manager;
+            manager.SetStatsFile(path, 3600.0);
+            manager.SetStatsFile("", 0.0);
+        }
+        TWITCH_BOT_CHECK(!exists(path));
+        TWITCH_BOT_CHECK(rmdir(directory.c_str()) == 0);
+    }
+}
+
+int main()
+{
+    TestWorkerCarriesOnWhileConnecting();
+    TestFailedConnectIsRetried();
+    TestReconnectBackoff();
+    TestChannelsRejoinedAfterDrop();
+    TestServerReconnectWithWarmStandby();
+    TestSendersNotInterned();
+    TestOversizedPongTokenIgnored();
+    TestStatsText();
+    TestStatsFile();
+    return TwitchBot::Test::Finish();
+}
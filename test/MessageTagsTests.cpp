@@ -0,0 +1,223 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <string_view>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageTags.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::KnownTag;
+    using TwitchBot::MessageTags;
+
+    /**
+     * These are the keys of the known tags, in the same order as the
+     * KnownTag enumeration, written out again so the tests don't trust the
+     * parser's own list.
+     */
+    const char* const KNOWN_KEYS[] = {
+        "badge-info",
+        "badges",
+        "ban-duration",
+        "bits",
+        "color",
+        "display-name",
+        "emote-only",
+        "emotes",
+        "first-msg",
+        "followers-only",
+        "id",
+        "login",
+        "mod",
+        "msg-id",
+        "room-id",
+        "slow",
+        "subs-only",
+        "subscriber",
+        "target-msg-id",
+        "target-user-id",
+        "tmi-sent-ts",
+        "turbo",
+        "user-id",
+        "user-type",
+        "vip",
+    };
+    static_assert(
+        sizeof(KNOWN_KEYS) / sizeof(KNOWN_KEYS[0]) == (size_t)KnownTag::Count,
+        "KNOWN_KEYS must list every known tag"
+    );
+
+    void TestEscapes()
+    {
+        TWITCH_BOT_CHECK(MessageTags::Unescape("plain") == "plain");
+        TWITCH_BOT_CHECK(MessageTags::Unescape("a\\:b") == "a;b");
+        TWITCH_BOT_CHECK(MessageTags::Unescape("a\\sb") == "a b");
+        TWITCH_BOT_CHECK(MessageTags::Unescape("a\\\\b") == "a\\b");
+        TWITCH_BOT_CHECK(MessageTags::Unescape("\\r\\n") == "\r\n");
+        TWITCH_BOT_CHECK(MessageTags::Unescape("\\x") == "x");
+        TWITCH_BOT_CHECK(MessageTags::Unescape("ab\\") == "ab");
+        TWITCH_BOT_CHECK(MessageTags::Unescape("\\\\\\") == "\\");
+        TWITCH_BOT_CHECK(MessageTags::Unescape("").empty());
+
+        // Raw values keep their escapes, and values are unescaped as
+        // they're read.
+        MessageTags tags;
+        tags.Assign("display-name=Some\\sOne;system-msg=a\\:b\\\\c\\");
+        TWITCH_BOT_CHECK(tags.GetRawValue(KnownTag::DisplayName) == "Some\\sOne");
+        TWITCH_BOT_CHECK(tags.GetDisplayName() == "Some One");
+        TWITCH_BOT_CHECK(tags.GetRawValue("system-msg") == "a\\:b\\\\c\\");
+        TWITCH_BOT_CHECK(tags.GetValue("system-msg") == "a;b\\c");
+    }
+
+    void TestEmptyAndMissingValues()
+    {
+        MessageTags tags;
+        TWITCH_BOT_CHECK(tags.Empty());
+        TWITCH_BOT_CHECK(!tags.Has("color"));
+        TWITCH_BOT_CHECK(!tags.Has(KnownTag::Color));
+
+        // A tag with an empty value, or with no equals sign at all, is
+        // present with an empty value. Empty keys are ignored.
+        tags.Assign("color=;turbo;=orphan;;badges=vip/1");
+        TWITCH_BOT_CHECK(!tags.Empty());
+        TWITCH_BOT_CHECK(tags.GetRaw() == "color=;turbo;=orphan;;badges=vip/1");
+        TWITCH_BOT_CHECK(tags.Has("color"));
+        TWITCH_BOT_CHECK(tags.Has(KnownTag::Color));
+        TWITCH_BOT_CHECK(tags.GetRawValue(KnownTag::Color).empty());
+        TWITCH_BOT_CHECK(tags.Has("turbo"));
+        TWITCH_BOT_CHECK(tags.Has(KnownTag::Turbo));
+        TWITCH_BOT_CHECK(tags.GetValue("turbo").empty());
+        TWITCH_BOT_CHECK(!tags.Has(""));
+        TWITCH_BOT_CHECK(tags.GetBadges() == "vip/1");
+
+        // Tags which aren't there read as empty.
+        TWITCH_BOT_CHECK(!tags.Has("emotes"));
+        TWITCH_BOT_CHECK(!tags.Has(KnownTag::Emotes));
+        TWITCH_BOT_CHECK(tags.GetEmotes().empty());
+        TWITCH_BOT_CHECK(tags.GetRawValue("nope").empty());
+        TWITCH_BOT_CHECK(tags.GetUserId() == 0);
+        TWITCH_BOT_CHECK(tags.GetSentTime() == 0);
+
+        // A value may hold equals signs of its own.
+        tags.Assign("msg-param-a=b=c");
+        TWITCH_BOT_CHECK(tags.GetRawValue("msg-param-a") == "b=c");
+
+        // Clearing, and assigning again after a lookup, forget the old
+        // tags.
+        tags.Clear();
+        TWITCH_BOT_CHECK(tags.Empty());
+        TWITCH_BOT_CHECK(!tags.Has("msg-param-a"));
+        tags.Assign("id=one");
+        TWITCH_BOT_CHECK(tags.GetMessageId() == "one");
+        tags.Assign("msg-id=sub");
+        TWITCH_BOT_CHECK(tags.GetMessageId().empty());
+        TWITCH_BOT_CHECK(tags.GetNoticeId() == "sub");
+    }
+
+    void TestRepeatedKeys()
+    {
+        // If a key is repeated, the last one wins, both for known tags and
+        // for others.
+        MessageTags tags;
+        tags.Assign("color=#FF0000;custom=1;color=#00FF00;custom=2");
+        TWITCH_BOT_CHECK(tags.GetRawValue(KnownTag::Color) == "#00FF00");
+        TWITCH_BOT_CHECK(tags.GetRawValue("color") == "#00FF00");
+        TWITCH_BOT_CHECK(tags.GetRawValue("custom") == "2");
+        TWITCH_BOT_CHECK(tags.Has(KnownTag::Color));
+    }
+
+    void TestIntegers()
+    {
+        MessageTags tags;
+        int64_t value = 0;
+        tags.Assign("bits=100;ban-duration=-5;slow=9223372036854775807;room-id=-9223372036854775808");
+        TWITCH_BOT_CHECK(tags.GetInteger(KnownTag::Bits, value) && (value == 100));
+        TWITCH_BOT_CHECK(tags.GetInteger(KnownTag::BanDuration, value) && (value == -5));
+        TWITCH_BOT_CHECK(tags.GetInteger(KnownTag::Slow, value) && (value == INT64_MAX));
+        TWITCH_BOT_CHECK(tags.GetInteger(KnownTag::RoomId, value) && (value == INT64_MIN));
+
+        // Numbers past 64 bits are rejected rather than wrapped around, as
+        // are values which aren't whole numbers, and missing tags.
+        tags.Assign(
+            "bits=9223372036854775808;ban-duration=-9223372036854775809;"
+            "slow=99999999999999999999;user-id=12a;room-id=-;tmi-sent-ts=;"
+            "followers-only=1.5"
+        );
+        TWITCH_BOT_CHECK(!tags.GetInteger(KnownTag::Bits, value));
+        TWITCH_BOT_CHECK(!tags.GetInteger(KnownTag::BanDuration, value));
+        TWITCH_BOT_CHECK(!tags.GetInteger(KnownTag::Slow, value));
+        TWITCH_BOT_CHECK(!tags.GetInteger(KnownTag::UserId, value));
+        TWITCH_BOT_CHECK(!tags.GetInteger(KnownTag::RoomId, value));
+        TWITCH_BOT_CHECK(!tags.GetInteger(KnownTag::TmiSentTs, value));
+        TWITCH_BOT_CHECK(!tags.GetInteger(KnownTag::FollowersOnly, value));
+        TWITCH_BOT_CHECK(!tags.GetInteger(KnownTag::Vip, value));
+        TWITCH_BOT_CHECK(tags.GetUserId() == 0);
+        TWITCH_BOT_CHECK(tags.GetRoomId() == 0);
+
+        tags.Assign("user-id=123456789;room-id=42;tmi-sent-ts=1700000000123");
+        TWITCH_BOT_CHECK(tags.GetUserId() == 123456789);
+        TWITCH_BOT_CHECK(tags.GetRoomId() == 42);
+        TWITCH_BOT_CHECK(tags.GetSentTime() == 1700000000123);
+    }
+
+    void TestEveryKnownTag()
+    {
+        // Every known tag is found by its key, and only by its key, from a
+        // tags block long enough to span several blocks of separators.
+        std::string raw = "unknown-first=x";
+        for (size_t i = 0; i < (size_t)KnownTag::Count; ++i)
+        {
+            raw += ";";
+            raw += KNOWN_KEYS[i];
+            raw += "=value" + std::to_string(i);
+        }
+        raw += ";unknown-last=y";
+        MessageTags tags;
+        tags.Assign(raw);
+        for (size_t i = 0; i < (size_t)KnownTag::Count; ++i)
+        {
+            const auto tag = (KnownTag)i;
+            const auto expected = "value" + std::to_string(i);
+            TWITCH_BOT_CHECK(tags.Has(tag));
+            TWITCH_BOT_CHECK(tags.Has(KNOWN_KEYS[i]));
+            TWITCH_BOT_CHECK(tags.GetRawValue(tag) == expected);
+            TWITCH_BOT_CHECK(tags.GetValue(tag) == expected);
+            TWITCH_BOT_CHECK(tags.GetRawValue(KNOWN_KEYS[i]) == expected);
+        }
+        TWITCH_BOT_CHECK(tags.GetRawValue("unknown-first") == "x");
+        TWITCH_BOT_CHECK(tags.GetRawValue("unknown-last") == "y");
+
+        // Each known tag alone is found, and no other known tag is.
+        for (size_t i = 0; i < (size_t)KnownTag::Count; ++i)
+        {
+            tags.Assign(std::string(KNOWN_KEYS[i]) + "=1");
+            for (size_t j = 0; j < (size_t)KnownTag::Count; ++j)
+            {
+                if (!TWITCH_BOT_CHECK(tags.Has((KnownTag)j) == (i == j)))
+                {
+                    break;
+                }
+            }
+        }
+
+        // Keys which look like known ones but differ aren't mistaken for
+        // them.
+        tags.Assign("Color=1;colors=2;user-i=3;d=4");
+        TWITCH_BOT_CHECK(!tags.Has(KnownTag::Color));
+        TWITCH_BOT_CHECK(!tags.Has(KnownTag::UserId));
+        TWITCH_BOT_CHECK(!tags.Has(KnownTag::Id));
+        TWITCH_BOT_CHECK(tags.GetRawValue("Color") == "1");
+    }
+}
+
+int main()
+{
+    TestEscapes();
+    TestEmptyAndMissingValues();
+    TestRepeatedKeys();
+    TestIntegers();
+    TestEveryKnownTag();
+    return TwitchBot::Test::Finish();
+}
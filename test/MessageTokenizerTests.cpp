@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageTokenizer.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::ScanImplementation;
+
+    /**
+     * These are all the ways the tokenizer can search.
+     */
+    const ScanImplementation IMPLEMENTATIONS[] = {
+        ScanImplementation::Scalar,
+        ScanImplementation::Sse2,
+        ScanImplementation::Avx2,
+    };
+
+    /**
+     * This is a line split into its parts, copied out of the line so that
+     * the parts found by different searches can be compared.
+     */
+    struct Parts
+    {
+        bool valid = false;
+        std::string tags;
+        std::string prefix;
+        std::string command;
+        std::vector< std::string > parameters;
+
+        bool operator==(const Parts& other) const
+        {
+            return (
+                (valid == other.valid)
+                && (tags == other.tags)
+                && (prefix == other.prefix)
+                && (command == other.command)
+                && (parameters == other.parameters)
+            );
+        }
+    };
+
+    Parts Tokenize(const std::string& line)
+    {
+        TwitchBot::MessageTokens tokens;
+        Parts parts;
+        parts.valid = TwitchBot::TokenizeMessage(line, tokens);
+        parts.tags = std::string(tokens.tags);
+        parts.prefix = std::string(tokens.prefix);
+        parts.command = std::string(tokens.command);
+        for (size_t i = 0; i < tokens.parameterCount; ++i)
+        {
+            parts.parameters.emplace_back(tokens.parameters[i]);
+        }
+        return parts;
+    }
+
+    /**
+     * These are lines of the shapes the Twitch server sends, and a few it
+     * shouldn't, long enough to cross the 16 and 32 character blocks the
+     * vector searches look at.
+     */
+    std::vector< std::string > MakeSampleLines()
+    {
+        std::vector< std::string > lines = {
+            "PING :tmi.twitch.tv",
+            "PING",
+            "RECONNECT",
+            ":tmi.twitch.tv 001 bot :Welcome, GLHF!",
+            ":bot!bot@bot.tmi.twitch.tv JOIN #channel",
+            ":someuser!someuser@someuser.tmi.twitch.tv PRIVMSG #channel :this is a reasonably normal length chat message with a few words in it",
+            "@badge-info=subscriber/12;badges=subscriber/12,bits/1000;color=#FF0000;display-name=SomeUser;emotes=;id=b34ccfc7-4977-403a-8a94-33c6bac34fb8;mod=0;room-id=12345678;subscriber=1;tmi-sent-ts=1642696567751;user-id=87654321;user-type= :someuser!someuser@someuser.tmi.twitch.tv PRIVMSG #channel :hello: there :)",
+            "@msg-id=slow_off :tmi.twitch.tv NOTICE #channel :This room is no longer in slow mode.",
+            "@emote-sets=0 USERSTATE #channel",
+            ":tmi.twitch.tv CAP * ACK :twitch.tv/membership twitch.tv/tags twitch.tv/commands",
+            ":prefix.only",
+            ":prefix.only ",
+            "@tags.only",
+            "@tags :prefix",
+            "",
+            " ",
+            ":p CMD a b c d e f g h i j k l m n o p q r s :trailing words",
+            "CMD a  b   c    :",
+            "CMD :",
+            "CMD :::",
+            "CMD a:b :c:d",
+        };
+        std::string longParameter(100, 'x');
+        lines.push_back(":p PRIVMSG #c :" + longParameter);
+        lines.push_back("@" + longParameter + " :" + longParameter + " " + longParameter + " " + longParameter);
+        return lines;
+    }
+
+    /**
+     * This makes random lines out of the characters which mean something
+     * to the tokenizer, with and without tags and prefixes.
+     */
+    std::vector< std::string > MakeRandomLines(size_t count)
+    {
+        std::mt19937 generator(3);
+        const char alphabet[] = "ab :  ::x@=;";
+        std::vector< std::string > lines;
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::string line;
+            switch (generator() % 3)
+            {
+                case 0: line = "@"; break;
+                case 1: line = ":"; break;
+                default: break;
+            }
+            const auto length = generator() % 120;
+            for (size_t j = 0; j < length; ++j)
+            {
+                line += alphabet[generator() % (sizeof(alphabet) - 1)];
+            }
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    void TestImplementationsAgree()
+    {
+        const auto original = TwitchBot::GetScanImplementation();
+        auto lines = MakeSampleLines();
+        const auto randomLines = MakeRandomLines(20000);
+        lines.insert(lines.end(), randomLines.begin(), randomLines.end());
+        TWITCH_BOT_CHECK(TwitchBot::SelectScanImplementation(ScanImplementation::Scalar));
+        std::vector< Parts > expected;
+        for (const auto& line: lines)
+        {
+            expected.push_back(Tokenize(line));
+        }
+        for (const auto implementation: IMPLEMENTATIONS)
+        {
+            if (!TwitchBot::SelectScanImplementation(implementation))
+            {
+                printf("scan implementation %d isn't supported here\n", (int)implementation);
+                continue;
+            }
+            for (size_t i = 0; i < lines.size(); ++i)
+            {
+                if (!TWITCH_BOT_CHECK(Tokenize(lines[i]) == expected[i]))
+                {
+                    fprintf(stderr, "implementation %d, line: \"%s\"\n", (int)implementation, lines[i].c_str());
+                }
+            }
+        }
+        (void)TwitchBot::SelectScanImplementation(original);
+    }
+
+    void TestFindCharacterAgrees()
+    {
+        const auto original = TwitchBot::GetScanImplementation();
+        std::mt19937 generator(5);
+        std::string buffer(300, 'a');
+        for (const auto implementation: IMPLEMENTATIONS)
+        {
+            if (!TwitchBot::SelectScanImplementation(implementation))
+            {
+                continue;
+            }
+
+            // Try every start and end near the edges of the vector blocks,
+            // with the character at every place in between, or nowhere.
+            for (size_t begin = 0; begin < 40; ++begin)
+            {
+                for (size_t end = begin; end < begin + 70; ++end)
+                {
+                    const auto target = begin + generator() % (end - begin + 1);
+                    std::fill(buffer.begin(), buffer.end(), 'a');
+                    if (target < end)
+                    {
+                        buffer[target] = ' ';
+                    }
+                    buffer[end] = ' ';
+                    const auto found = TwitchBot::FindCharacter(buffer.data() + begin, buffer.data() + end, ' ');
+                    TWITCH_BOT_CHECK(found == buffer.data() + ((target < end) ? target : end));
+                }
+            }
+        }
+        (void)TwitchBot::SelectScanImplementation(original);
+    }
+
+    void TestParts()
+    {
+        auto parts = Tokenize("@a=1;b=2 :nick!user@host PRIVMSG #channel :hello there");
+        TWITCH_BOT_CHECK(parts.valid);
+        TWITCH_BOT_CHECK(parts.tags == "a=1;b=2");
+        TWITCH_BOT_CHECK(parts.prefix == "nick!user@host");
+        TWITCH_BOT_CHECK(parts.command == "PRIVMSG");
+        TWITCH_BOT_CHECK(parts.parameters == std::vector< std::string >({"#channel", "hello there"}));
+
+        parts = Tokenize("PING :tmi.twitch.tv");
+        TWITCH_BOT_CHECK(parts.valid);
+        TWITCH_BOT_CHECK(parts.tags.empty());
+        TWITCH_BOT_CHECK(parts.prefix.empty());
+        TWITCH_BOT_CHECK(parts.command == "PING");
+        TWITCH_BOT_CHECK(parts.parameters == std::vector< std::string >({"tmi.twitch.tv"}));
+
+        TWITCH_BOT_CHECK(!Tokenize(":prefix.only").valid);
+        TWITCH_BOT_CHECK(!Tokenize("").valid);
+
+        // Past the most parameters, the rest of the line is the last one.
+        parts = Tokenize("CMD 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17");
+        TWITCH_BOT_CHECK(parts.parameters.size() == TwitchBot::MAX_MESSAGE_PARAMETERS);
+        TWITCH_BOT_CHECK(parts.parameters.back() == "15 16 17");
+    }
+}
+
+int main()
+{
+    TestParts();
+    TestImplementationsAgree();
+    TestFindCharacterAgrees();
+    return TwitchBot::Test::Finish();
+}
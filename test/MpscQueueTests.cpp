@@ -0,0 +1,191 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MpscQueue.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::MpscQueue;
+
+    void TestCapacity()
+    {
+        // The capacity is rounded up to a power of two, and is never less
+        // than two.
+        TWITCH_BOT_CHECK(MpscQueue< int >(0).GetCapacity() == 2);
+        TWITCH_BOT_CHECK(MpscQueue< int >(1).GetCapacity() == 2);
+        TWITCH_BOT_CHECK(MpscQueue< int >(2).GetCapacity() == 2);
+        TWITCH_BOT_CHECK(MpscQueue< int >(3).GetCapacity() == 4);
+        TWITCH_BOT_CHECK(MpscQueue< int >(64).GetCapacity() == 64);
+        TWITCH_BOT_CHECK(MpscQueue< int >(100).GetCapacity() == 128);
+    }
+
+    void TestFullAndEmpty()
+    {
+        MpscQueue< std::string > queue(4);
+        std::string item;
+        TWITCH_BOT_CHECK(queue.Empty());
+        TWITCH_BOT_CHECK(!queue.TryPop(item));
+        for (int i = 0; i < 4; ++i)
+        {
+            item = "item" + std::to_string(i);
+            TWITCH_BOT_CHECK(queue.TryPush(item));
+            TWITCH_BOT_CHECK(!queue.Empty());
+        }
+
+        // An item which doesn't fit is left as it was, so the caller can try
+        // again with it.
+        item = "extra";
+        TWITCH_BOT_CHECK(!queue.TryPush(item));
+        TWITCH_BOT_CHECK(item == "extra");
+
+        for (int i = 0; i < 4; ++i)
+        {
+            TWITCH_BOT_CHECK(queue.TryPop(item));
+            TWITCH_BOT_CHECK(item == "item" + std::to_string(i));
+        }
+        TWITCH_BOT_CHECK(queue.Empty());
+        TWITCH_BOT_CHECK(!queue.TryPop(item));
+    }
+
+    void TestMoveOnlyItems()
+    {
+        // Items are moved in and out, never copied.
+        MpscQueue< std::unique_ptr< int > > queue(2);
+        auto item = std::make_unique< int >(42);
+        TWITCH_BOT_CHECK(queue.TryPush(item));
+        TWITCH_BOT_CHECK(item == nullptr);
+        std::unique_ptr< int > popped;
+        TWITCH_BOT_CHECK(queue.TryPop(popped));
+        TWITCH_BOT_CHECK((popped != nullptr) && (*popped == 42));
+    }
+
+    void TestWrapAround()
+    {
+        // Push and pop in uneven runs, so positions go around the ring many
+        // times and the queue is often full or empty at every slot.
+        MpscQueue< uint64_t > queue(8);
+        uint64_t pushed = 0;
+        uint64_t popped = 0;
+        bool inOrder = true;
+        for (size_t round = 0; round < 1000; ++round)
+        {
+            for (size_t i = 0; i < 1 + round % 11; ++i)
+            {
+                auto item = pushed;
+                if (!queue.TryPush(item))
+                {
+                    break;
+                }
+                ++pushed;
+            }
+            for (size_t i = 0; i < 1 + round % 7; ++i)
+            {
+                uint64_t item;
+                if (!queue.TryPop(item))
+                {
+                    break;
+                }
+                inOrder = inOrder && (item == popped);
+                ++popped;
+            }
+        }
+        TWITCH_BOT_CHECK(inOrder);
+        TWITCH_BOT_CHECK(pushed > 100 * queue.GetCapacity());
+        TWITCH_BOT_CHECK(pushed - popped <= queue.GetCapacity());
+    }
+
+    void TestPopBatch()
+    {
+        MpscQueue< int > queue(16);
+        for (int i = 0; i < 10; ++i)
+        {
+            auto item = i;
+            (void)queue.TryPush(item);
+        }
+        std::vector< int > handled;
+        const auto handler = [&](int& item){ handled.push_back(item); };
+        TWITCH_BOT_CHECK(queue.PopBatch(handler, 4) == 4);
+        TWITCH_BOT_CHECK(handled == std::vector< int >({0, 1, 2, 3}));
+        TWITCH_BOT_CHECK(queue.PopBatch(handler, 64) == 6);
+        TWITCH_BOT_CHECK(handled.size() == 10);
+        TWITCH_BOT_CHECK(handled.back() == 9);
+        TWITCH_BOT_CHECK(queue.PopBatch(handler, 64) == 0);
+    }
+
+    void TestConcurrentProducers()
+    {
+        // Several threads push through a small ring at once, waiting when
+        // it's full, while one thread pops. Every item must come out once,
+        // and each producer's items in the order it pushed them.
+        constexpr uint64_t producerCount = 4;
+        constexpr uint64_t itemsPerProducer = 100000;
+        MpscQueue< uint64_t > queue(16);
+        std::vector< std::thread > producers;
+        for (uint64_t producer = 0; producer < producerCount; ++producer)
+        {
+            producers.emplace_back(
+                [&queue, producer]
+                {
+                    for (uint64_t i = 0; i < itemsPerProducer; ++i)
+                    {
+                        auto item = (producer << 32) | i;
+                        while (!queue.TryPush(item))
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                }
+            );
+        }
+        std::vector< uint64_t > next(producerCount, 0);
+        uint64_t received = 0;
+        bool inOrder = true;
+        while (received < producerCount * itemsPerProducer)
+        {
+            const auto count = queue.PopBatch(
+                [&](uint64_t& item)
+                {
+                    const auto producer = item >> 32;
+                    inOrder = (
+                        inOrder
+                        && (producer < producerCount)
+                        && ((item & 0xFFFFFFFF) == next[producer]++)
+                    );
+                },
+                64
+            );
+            received += count;
+            if (count == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+        for (auto& producer: producers)
+        {
+            producer.join();
+        }
+        TWITCH_BOT_CHECK(inOrder);
+        TWITCH_BOT_CHECK(queue.Empty());
+        for (const auto count: next)
+        {
+            TWITCH_BOT_CHECK(count == itemsPerProducer);
+        }
+    }
+}
+
+int main()
+{
+    TestCapacity();
+    TestFullAndEmpty();
+    TestMoveOnlyItems();
+    TestWrapAround();
+    TestPopBatch();
+    TestConcurrentProducers();
+    return TwitchBot::Test::Finish();
+}
@@ -0,0 +1,288 @@
+#include <memory>
+#include <string>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/MessageManager.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/OutboundScheduler.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SimulatedTimeKeeper.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::OutboundLane;
+    using TwitchBot::OutboundScheduler;
+    using TwitchBot::RateLimitClass;
+
+    /**
+     * These are limits small enough to reach in a test.
+     */
+    OutboundScheduler::Limits SmallLimits()
+    {
+        OutboundScheduler::Limits limits;
+        limits.message = {3, 10.0};
+        limits.moderatorMessage = {5, 10.0};
+        limits.join = {2, 10.0};
+        return limits;
+    }
+
+    /**
+     * This takes whatever may be sent at the given time.
+     */
+    std::string Take(OutboundScheduler& scheduler, double now)
+    {
+        std::string batch;
+        (void)scheduler.Dequeue(now, batch);
+        return batch;
+    }
+
+    void TestTokenBuckets()
+    {
+        OutboundScheduler scheduler;
+        scheduler.SetLimits(SmallLimits());
+        for (int i = 0; i < 5; ++i)
+        {
+            scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::Message, "m" + std::to_string(i) + "\r\n", 0.0);
+        }
+        TWITCH_BOT_CHECK(Take(scheduler, 0.0) == "m0\r\nm1\r\nm2\r\n");
+        double when = 0.0;
+        TWITCH_BOT_CHECK(scheduler.GetNextSendTime(when));
+        TWITCH_BOT_CHECK(when == 10.0);
+        TWITCH_BOT_CHECK(Take(scheduler, 9.999).empty());
+        TWITCH_BOT_CHECK(Take(scheduler, 10.0) == "m3\r\nm4\r\n");
+        TWITCH_BOT_CHECK(scheduler.Empty());
+        TWITCH_BOT_CHECK(!scheduler.GetNextSendTime(when));
+
+        // Regular messages also count against the moderator limit, so only
+        // two moderator messages fit in the same window as three regular
+        // ones.
+        OutboundScheduler shared;
+        shared.SetLimits(SmallLimits());
+        for (int i = 0; i < 3; ++i)
+        {
+            shared.Enqueue(OutboundLane::Chat, RateLimitClass::Message, "m\r\n", 0.0);
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            shared.Enqueue(OutboundLane::Chat, RateLimitClass::ModeratorMessage, "o\r\n", 0.0);
+        }
+        TWITCH_BOT_CHECK(Take(shared, 0.0) == "m\r\nm\r\nm\r\no\r\no\r\n");
+        TWITCH_BOT_CHECK(Take(shared, 10.0) == "o\r\n");
+    }
+
+    void TestLaneOrder()
+    {
+        OutboundScheduler scheduler;
+        scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::Message, "chat\r\n", 0.0);
+        scheduler.Enqueue(OutboundLane::Moderation, RateLimitClass::Message, "moderation\r\n", 0.0);
+        scheduler.Enqueue(OutboundLane::Critical, RateLimitClass::None, "critical\r\n", 0.0);
+        TWITCH_BOT_CHECK(Take(scheduler, 0.0) == "critical\r\nmoderation\r\nchat\r\n");
+
+        // When the limit a moderation line shares with chat frees up, the
+        // moderation line goes first, even though it was queued later.
+        OutboundScheduler limited;
+        limited.SetLimits(SmallLimits());
+        for (int i = 0; i < 3; ++i)
+        {
+            limited.Enqueue(OutboundLane::Chat, RateLimitClass::Message, "c\r\n", 1.0);
+        }
+        TWITCH_BOT_CHECK(Take(limited, 1.0) == "c\r\nc\r\nc\r\n");
+        limited.Enqueue(OutboundLane::Chat, RateLimitClass::Message, "later\r\n", 2.0);
+        limited.Enqueue(OutboundLane::Moderation, RateLimitClass::Message, "m\r\n", 2.0);
+        TWITCH_BOT_CHECK(Take(limited, 2.0).empty());
+        TWITCH_BOT_CHECK(Take(limited, 11.0) == "m\r\nlater\r\n");
+    }
+
+    void TestLimitsHoldBackOnlyTheirOwnLines()
+    {
+        OutboundScheduler scheduler;
+        scheduler.SetLimits(SmallLimits());
+        for (int i = 0; i < 3; ++i)
+        {
+            scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::Join, "JOIN #" + std::to_string(i) + "\r\n", 0.0);
+        }
+        scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::Message, "PRIVMSG #0 :hi\r\n", 0.0);
+        TWITCH_BOT_CHECK(Take(scheduler, 0.0) == "JOIN #0\r\nJOIN #1\r\nPRIVMSG #0 :hi\r\n");
+        TWITCH_BOT_CHECK(Take(scheduler, 10.0) == "JOIN #2\r\n");
+        TWITCH_BOT_CHECK(scheduler.GetStats().throttled > 0);
+    }
+
+    void TestUnlimitedLinesKeepTheirPlace()
+    {
+        // A PART counts against no limit, but mustn't overtake the JOIN
+        // held back ahead of it.
+        OutboundScheduler scheduler;
+        scheduler.SetLimits(SmallLimits());
+        scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::Join, "JOIN #a\r\n", 0.0);
+        scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::Join, "JOIN #b\r\n", 0.0);
+        scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::None, "PART #x\r\n", 0.0);
+        scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::Join, "JOIN #c\r\n", 0.0);
+        scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::None, "PART #c\r\n", 0.0);
+        TWITCH_BOT_CHECK(Take(scheduler, 0.0) == "JOIN #a\r\nJOIN #b\r\nPART #x\r\n");
+        TWITCH_BOT_CHECK(Take(scheduler, 5.0).empty());
+        TWITCH_BOT_CHECK(Take(scheduler, 10.0) == "JOIN #c\r\nPART #c\r\n");
+    }
+
+    void TestBatching()
+    {
+        OutboundScheduler scheduler;
+        const std::string line(1000, 'x');
+        for (int i = 0; i < 20; ++i)
+        {
+            scheduler.Enqueue(OutboundLane::Critical, RateLimitClass::None, line + "\r\n", 0.0);
+        }
+        const auto first = Take(scheduler, 0.0);
+        const auto second = Take(scheduler, 0.0);
+        const auto third = Take(scheduler, 0.0);
+        TWITCH_BOT_CHECK(first.length() == 8 * 1002);
+        TWITCH_BOT_CHECK(second.length() == 8 * 1002);
+        TWITCH_BOT_CHECK(third.length() == 4 * 1002);
+        TWITCH_BOT_CHECK(scheduler.Empty());
+        const auto stats = scheduler.GetStats();
+        TWITCH_BOT_CHECK(stats.batches == 3);
+        TWITCH_BOT_CHECK(stats.linesSent[(size_t)OutboundLane::Critical] == 20);
+        TWITCH_BOT_CHECK(stats.maxQueueDepth[(size_t)OutboundLane::Critical] == 20);
+
+        // A line too long to fit in a batch on its own still goes out, in a
+        // batch by itself.
+        scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::None, std::string(9000, 'y') + "\r\n", 0.0);
+        scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::None, "z\r\n", 0.0);
+        TWITCH_BOT_CHECK(Take(scheduler, 0.0).length() == 9002);
+        TWITCH_BOT_CHECK(Take(scheduler, 0.0) == "z\r\n");
+    }
+
+    void TestFullBatchKeepsLaneOrder()
+    {
+        // Once a higher lane fills the batch, a short chat line which would
+        // still fit must wait for the next batch, behind the rest of the
+        // higher lane.
+        OutboundScheduler scheduler;
+        const std::string line(3000, 'x');
+        for (int i = 0; i < 3; ++i)
+        {
+            scheduler.Enqueue(OutboundLane::Critical, RateLimitClass::None, line + "\r\n", 0.0);
+        }
+        scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::Message, "chat\r\n", 0.0);
+        const auto first = Take(scheduler, 0.0);
+        TWITCH_BOT_CHECK(first.length() == 2 * 3002);
+        TWITCH_BOT_CHECK(first.find("chat") == std::string::npos);
+        TWITCH_BOT_CHECK(Take(scheduler, 0.0) == line + "\r\nchat\r\n");
+    }
+
+    void TestWaitStats()
+    {
+        OutboundScheduler scheduler;
+        scheduler.SetLimits(SmallLimits());
+        for (int i = 0; i < 4; ++i)
+        {
+            scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::Message, "m\r\n", 0.0);
+        }
+        (void)Take(scheduler, 0.0);
+        (void)Take(scheduler, 12.5);
+        const auto stats = scheduler.GetStats();
+        TWITCH_BOT_CHECK(stats.linesSent[(size_t)OutboundLane::Chat] == 4);
+        TWITCH_BOT_CHECK(stats.maxWait[(size_t)OutboundLane::Chat] == 12.5);
+        TWITCH_BOT_CHECK(stats.totalWait[(size_t)OutboundLane::Chat] == 12.5);
+        scheduler.Enqueue(OutboundLane::Chat, RateLimitClass::Message, "m\r\n", 13.0);
+        scheduler.Clear();
+        TWITCH_BOT_CHECK(scheduler.Empty());
+    }
+
+    void TestManagerPacesChat()
+    {
+        // The manager, through a stand-in connection, with time which only
+        // moves when the test says so.
+        const auto timeKeeper = std::make_shared< TwitchBot::SimulatedTimeKeeper >();
+        timeKeeper->SetCurrentTime(1000.0);
+        const auto connection = std::make_shared< TwitchBot::Test::FakeConnection >();
+        TwitchBot::MessageManager manager;
+        manager.SetTimeKeeper(timeKeeper);
+        manager.SetConnectionFactory([connection]{ return connection; });
+        bool loggedIn = false;
+        std::mutex mutex;
+        manager.SetLoggedInDelegate(
+            [&]
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                loggedIn = true;
+            }
+        );
+        manager.LogIn("bot", "token");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return loggedIn;
+                }
+            )
+        );
+
+        // Twitch allows 20 messages per 30 seconds in a channel where the
+        // bot isn't a moderator.
+        for (int i = 0; i < 22; ++i)
+        {
+            manager.SendMessage("chan", "hello " + std::to_string(i));
+        }
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]{ return connection->CountLines("PRIVMSG #chan :hello") == 20; }
+            )
+        );
+        manager.SendModeration("chan", "/timeout spammer 60");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        TWITCH_BOT_CHECK(connection->CountLines("PRIVMSG #chan") == 20);
+
+        // Once the window passes, the moderation goes ahead of the chat
+        // still waiting.
+        timeKeeper->Advance(30.0);
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]{ return connection->CountLines("PRIVMSG #chan") == 23; }
+            )
+        );
+        const auto lines = connection->GetLines();
+        size_t moderation = lines.size();
+        size_t lastChat = 0;
+        for (size_t i = 0; i < lines.size(); ++i)
+        {
+            if (lines[i] == "PRIVMSG #chan :/timeout spammer 60")
+            {
+                moderation = i;
+            }
+            else if (lines[i] == "PRIVMSG #chan :hello 21")
+            {
+                lastChat = i;
+            }
+        }
+        TWITCH_BOT_CHECK(moderation < lastChat);
+
+        // Where the bot is a moderator, the higher limit applies.
+        connection->Receive("@badges=moderator/1 :tmi.twitch.tv USERSTATE #modded\r\n");
+        for (int i = 0; i < 50; ++i)
+        {
+            manager.SendMessage("modded", "hi");
+        }
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]{ return connection->CountLines("PRIVMSG #modded") == 50; }
+            )
+        );
+        const auto stats = manager.GetOutboundStats();
+        TWITCH_BOT_CHECK(stats.throttled > 0);
+        TWITCH_BOT_CHECK(stats.maxWait[(size_t)OutboundLane::Chat] >= 30.0);
+    }
+}
+
+int main()
+{
+    TestTokenBuckets();
+    TestLaneOrder();
+    TestLimitsHoldBackOnlyTheirOwnLines();
+    TestUnlimitedLinesKeepTheirPlace();
+    TestBatching();
+    TestFullBatchKeepsLaneOrder();
+    TestWaitStats();
+    TestManagerPacesChat();
+    return TwitchBot::Test::Finish();
+}
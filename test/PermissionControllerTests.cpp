@@ -0,0 +1,293 @@
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Message.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/PermissionController.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::PermissionController;
+    using RoleMask = TwitchBot::PermissionController::RoleMask;
+
+    /**
+     * This makes a message as the MessageManager would parse it.
+     */
+    TwitchBot::Message MakeMessage(
+        const std::string& tags,
+        const std::string& prefix,
+        const std::string& command,
+        const std::vector< std::string >& parameters
+    )
+    {
+        TwitchBot::Message message;
+        message.tags.Assign(tags);
+        message.prefix = prefix;
+        message.command = command;
+        message.knownCommand = TwitchBot::FindKnownCommand(command);
+        message.parameters = parameters;
+        return message;
+    }
+
+    /**
+     * This makes a chat line from the given user, with the given badges.
+     */
+    TwitchBot::Message MakeChat(
+        const std::string& channel,
+        uint64_t userId,
+        const std::string& badges = ""
+    )
+    {
+        const auto nickname = "user" + std::to_string(userId);
+        return MakeMessage(
+            "badges=" + badges + ";user-id=" + std::to_string(userId),
+            nickname + "!" + nickname + "@" + nickname + ".tmi.twitch.tv",
+            "PRIVMSG",
+            {"#" + channel, "hi"}
+        );
+    }
+
+    RoleMask Decode(const std::string& tags)
+    {
+        TwitchBot::MessageTags messageTags;
+        messageTags.Assign(tags);
+        return PermissionController::DecodeRoles(messageTags);
+    }
+
+    void TestBadgeDecoding()
+    {
+        // Everyone is a viewer, and badges add roles.
+        TWITCH_BOT_CHECK(Decode("") == PermissionController::Viewer);
+        TWITCH_BOT_CHECK(Decode("badges=") == PermissionController::Viewer);
+        TWITCH_BOT_CHECK(
+            Decode("badges=broadcaster/1,subscriber/3012")
+            == (PermissionController::Viewer | PermissionController::Broadcaster | PermissionController::Subscriber)
+        );
+        TWITCH_BOT_CHECK(
+            Decode("badges=vip/1,bits/1000,premium/1")
+            == (PermissionController::Viewer | PermissionController::Vip | PermissionController::Cheerer | PermissionController::Prime)
+        );
+
+        // A founder is also a subscriber.
+        TWITCH_BOT_CHECK(
+            Decode("badges=founder/0")
+            == (PermissionController::Viewer | PermissionController::Founder | PermissionController::Subscriber)
+        );
+
+        // The mod tag makes a moderator, even without the badge, but only
+        // when it's 1.
+        TWITCH_BOT_CHECK(Decode("badges=;mod=1") == (PermissionController::Viewer | PermissionController::Moderator));
+        TWITCH_BOT_CHECK(Decode("badges=;mod=0") == PermissionController::Viewer);
+
+        // Unknown badges, and ones only partly matching known names, add
+        // nothing.
+        TWITCH_BOT_CHECK(Decode("badges=glhf-pledge/1,sub-gifter/50,moderators/1,mod/1") == PermissionController::Viewer);
+        TWITCH_BOT_CHECK(
+            Decode("badges=sub-gifter/50,moderator/1,,turbo/1")
+            == (PermissionController::Viewer | PermissionController::Moderator | PermissionController::Turbo)
+        );
+
+        TWITCH_BOT_CHECK(PermissionController::Allows(Decode("badges=moderator/1"), PermissionController::MODERATION_ROLES));
+        TWITCH_BOT_CHECK(!PermissionController::Allows(Decode("badges=vip/1"), PermissionController::MODERATION_ROLES));
+    }
+
+    void TestResolveAndCache()
+    {
+        PermissionController controller(16);
+        RoleMask roles = 0;
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 1, roles));
+
+        // The sender's roles come from the message, and are cached under
+        // the channel and user ID.
+        TWITCH_BOT_CHECK(
+            controller.Resolve(MakeChat("chan", 1, "moderator/1"))
+            == (PermissionController::Viewer | PermissionController::Moderator)
+        );
+        TWITCH_BOT_CHECK(controller.Check(MakeChat("chan", 1, "moderator/1"), PermissionController::MODERATION_ROLES));
+        TWITCH_BOT_CHECK(controller.GetRoles("chan", 1, roles));
+        TWITCH_BOT_CHECK(roles == (PermissionController::Viewer | PermissionController::Moderator));
+        TWITCH_BOT_CHECK(controller.GetRoles("#CHAN", 1, roles));
+        TWITCH_BOT_CHECK(!controller.GetRoles("other", 1, roles));
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 2, roles));
+
+        // A change of badges replaces the cached roles.
+        TWITCH_BOT_CHECK(controller.Resolve(MakeChat("chan", 1)) == PermissionController::Viewer);
+        TWITCH_BOT_CHECK(controller.GetRoles("chan", 1, roles));
+        TWITCH_BOT_CHECK(roles == PermissionController::Viewer);
+
+        // The bot's own roles come from USERSTATE, and don't touch the
+        // cache.
+        TWITCH_BOT_CHECK(controller.GetOwnRoles("chan") == 0);
+        (void)controller.Resolve(MakeMessage("badges=moderator/1", "tmi.twitch.tv", "USERSTATE", {"#chan"}));
+        TWITCH_BOT_CHECK(controller.GetOwnRoles("chan") == (PermissionController::Viewer | PermissionController::Moderator));
+        TWITCH_BOT_CHECK(controller.GetOwnRoles("other") == 0);
+
+        // Messages not in a channel give no roles.
+        TWITCH_BOT_CHECK(controller.Resolve(MakeMessage("", "tmi.twitch.tv", "PING", {"tmi.twitch.tv"})) == 0);
+        TWITCH_BOT_CHECK(controller.Resolve(MakeMessage("user-id=3", "bot", "PRIVMSG", {"bot", "hi"})) == 0);
+
+        const auto stats = controller.GetStats();
+        TWITCH_BOT_CHECK(stats.capacity == 16);
+        TWITCH_BOT_CHECK(stats.entries == 1);
+        TWITCH_BOT_CHECK(stats.misses == 1);
+        TWITCH_BOT_CHECK(stats.hits == 1);
+        TWITCH_BOT_CHECK(stats.refreshes == 1);
+        TWITCH_BOT_CHECK(stats.evictions == 0);
+        TWITCH_BOT_CHECK(stats.bytes == stats.capacity * stats.bytesPerEntry);
+    }
+
+    void TestEvictionAtCapacity()
+    {
+        // With room for four users, the cache is one set, so every user
+        // competes for the same entries.
+        PermissionController controller(4);
+        TWITCH_BOT_CHECK(controller.GetStats().capacity == 4);
+        for (uint64_t user = 1; user <= 4; ++user)
+        {
+            (void)controller.Resolve(MakeChat("chan", user, "vip/1"));
+        }
+        RoleMask roles = 0;
+        for (uint64_t user = 1; user <= 4; ++user)
+        {
+            TWITCH_BOT_CHECK(controller.GetRoles("chan", user, roles));
+        }
+        auto stats = controller.GetStats();
+        TWITCH_BOT_CHECK(stats.entries == 4);
+        TWITCH_BOT_CHECK(stats.evictions == 0);
+
+        // Every user was used since the set was last passed over, so the
+        // first is forgotten for the fifth.
+        (void)controller.Resolve(MakeChat("chan", 5));
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 1, roles));
+        TWITCH_BOT_CHECK(controller.GetRoles("chan", 5, roles));
+
+        // The entries passed over lose their second chance, so the next
+        // user not used since is forgotten, and users used again are kept.
+        (void)controller.Resolve(MakeChat("chan", 3, "vip/1"));
+        (void)controller.Resolve(MakeChat("chan", 6));
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 2, roles));
+        (void)controller.Resolve(MakeChat("chan", 5));
+        (void)controller.Resolve(MakeChat("chan", 7));
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 4, roles));
+        TWITCH_BOT_CHECK(controller.GetRoles("chan", 3, roles));
+        TWITCH_BOT_CHECK(controller.GetRoles("chan", 5, roles));
+        TWITCH_BOT_CHECK(controller.GetRoles("chan", 6, roles));
+        TWITCH_BOT_CHECK(controller.GetRoles("chan", 7, roles));
+
+        stats = controller.GetStats();
+        TWITCH_BOT_CHECK(stats.entries == 4);
+        TWITCH_BOT_CHECK(stats.evictions == 3);
+        TWITCH_BOT_CHECK(stats.misses == 7);
+        TWITCH_BOT_CHECK(stats.hits == 2);
+    }
+
+    void TestClearChat()
+    {
+        PermissionController controller(1024);
+        RoleMask roles = 0;
+        for (uint64_t user = 1; user <= 3; ++user)
+        {
+            (void)controller.Resolve(MakeChat("chan", user, "subscriber/1"));
+            (void)controller.Resolve(MakeChat("other", user, "subscriber/1"));
+        }
+
+        // A ban or timeout drops only that user, in only that channel.
+        (void)controller.Resolve(
+            MakeMessage("ban-duration=600;target-user-id=2", "tmi.twitch.tv", "CLEARCHAT", {"#chan", "user2"})
+        );
+        TWITCH_BOT_CHECK(controller.GetRoles("chan", 1, roles));
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 2, roles));
+        TWITCH_BOT_CHECK(controller.GetRoles("chan", 3, roles));
+        TWITCH_BOT_CHECK(controller.GetRoles("other", 2, roles));
+        auto stats = controller.GetStats();
+        TWITCH_BOT_CHECK(stats.entries == 5);
+        TWITCH_BOT_CHECK(stats.invalidations == 1);
+
+        // Banning a user who isn't cached changes nothing.
+        (void)controller.Resolve(
+            MakeMessage("target-user-id=99", "tmi.twitch.tv", "CLEARCHAT", {"#chan", "user99"})
+        );
+        TWITCH_BOT_CHECK(controller.GetStats().invalidations == 1);
+
+        // Clearing the whole chat drops everyone in that channel only.
+        (void)controller.Resolve(MakeMessage("", "tmi.twitch.tv", "CLEARCHAT", {"#chan"}));
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 1, roles));
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 3, roles));
+        for (uint64_t user = 1; user <= 3; ++user)
+        {
+            TWITCH_BOT_CHECK(controller.GetRoles("other", user, roles));
+        }
+        TWITCH_BOT_CHECK(controller.GetStats().invalidations == 2);
+    }
+
+    void TestRoomStateAndForgetChannel()
+    {
+        PermissionController controller(1024);
+        RoleMask roles = 0;
+        (void)controller.Resolve(MakeChat("chan", 1, "vip/1"));
+        (void)controller.Resolve(MakeChat("other", 1, "vip/1"));
+        (void)controller.Resolve(MakeMessage("badges=moderator/1", "tmi.twitch.tv", "USERSTATE", {"#chan"}));
+
+        // ROOMSTATE, as when the channel is joined again, moves the channel
+        // to a new generation, so its old roles are no longer found, but
+        // new ones are.
+        (void)controller.Resolve(MakeMessage("room-id=1;slow=0", "tmi.twitch.tv", "ROOMSTATE", {"#chan"}));
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 1, roles));
+        TWITCH_BOT_CHECK(controller.GetRoles("other", 1, roles));
+        TWITCH_BOT_CHECK(controller.GetOwnRoles("chan") != 0);
+        TWITCH_BOT_CHECK(controller.GetStats().invalidations == 1);
+        (void)controller.Resolve(MakeChat("chan", 1));
+        TWITCH_BOT_CHECK(controller.GetRoles("chan", 1, roles));
+        TWITCH_BOT_CHECK(roles == PermissionController::Viewer);
+        (void)controller.Resolve(MakeMessage("", "tmi.twitch.tv", "ROOMSTATE", {"#chan"}));
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 1, roles));
+        TWITCH_BOT_CHECK(controller.GetStats().invalidations == 2);
+
+        // Forgetting a channel drops its roles, and the bot's own, and
+        // seeing the channel again doesn't bring them back.
+        (void)controller.Resolve(MakeChat("chan", 2, "vip/1"));
+        controller.ForgetChannel("chan");
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 2, roles));
+        TWITCH_BOT_CHECK(controller.GetOwnRoles("chan") == 0);
+        TWITCH_BOT_CHECK(controller.GetRoles("other", 1, roles));
+        TWITCH_BOT_CHECK(controller.GetStats().invalidations == 3);
+        (void)controller.Resolve(MakeChat("chan", 3));
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 2, roles));
+        TWITCH_BOT_CHECK(controller.GetRoles("chan", 3, roles));
+
+        // Clearing drops everything.
+        controller.Clear();
+        TWITCH_BOT_CHECK(!controller.GetRoles("other", 1, roles));
+        TWITCH_BOT_CHECK(!controller.GetRoles("chan", 3, roles));
+        TWITCH_BOT_CHECK(controller.GetStats().entries == 0);
+    }
+
+    void TestUsersWithoutIds()
+    {
+        // Users without a user-id tag are told apart by nickname, without
+        // regard to case, and never mistaken for a user ID.
+        PermissionController controller(1024);
+        const auto alice = MakeMessage("badges=vip/1", "alice!alice@alice.tmi.twitch.tv", "PRIVMSG", {"#chan", "hi"});
+        const auto upperAlice = MakeMessage("badges=vip/1", "Alice!alice@alice.tmi.twitch.tv", "PRIVMSG", {"#chan", "hi"});
+        const auto bob = MakeMessage("", "bob!bob@bob.tmi.twitch.tv", "PRIVMSG", {"#chan", "hi"});
+        TWITCH_BOT_CHECK(controller.Resolve(alice) == (PermissionController::Viewer | PermissionController::Vip));
+        TWITCH_BOT_CHECK(controller.Resolve(upperAlice) == (PermissionController::Viewer | PermissionController::Vip));
+        TWITCH_BOT_CHECK(controller.Resolve(bob) == PermissionController::Viewer);
+        const auto stats = controller.GetStats();
+        TWITCH_BOT_CHECK(stats.entries == 2);
+        TWITCH_BOT_CHECK(stats.hits == 1);
+    }
+}
+
+int main()
+{
+    TestBadgeDecoding();
+    TestResolveAndCache();
+    TestEvictionAtCapacity();
+    TestClearChat();
+    TestRoomStateAndForgetChannel();
+    TestUsersWithoutIds();
+    return TwitchBot::Test::Finish();
+}
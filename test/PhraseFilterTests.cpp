@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/PhraseFilter.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::PhraseFilter;
+
+    /**
+     * This is one match, as the end, phrase and start, so that sorting
+     * matches puts them in the order in which they end.
+     */
+    using Found = std::tuple< size_t, size_t, size_t >;
+
+    /**
+     * This normalizes one byte the way the filter's documentation says it
+     * does.
+     */
+    unsigned char Normalize(unsigned char c, const PhraseFilter::Settings& settings)
+    {
+        if (settings.foldCase && (c >= 'A') && (c <= 'Z'))
+        {
+            c = (unsigned char)(c - 'A' + 'a');
+        }
+        if (!settings.foldLeetspeak)
+        {
+            return c;
+        }
+        switch (c)
+        {
+            case '0': return 'o';
+            case '1': case '!': case '|': case 'l': return 'i';
+            case '3': return 'e';
+            case '4': case '@': return 'a';
+            case '5': case '$': return 's';
+            case '7': case '+': return 't';
+            case '8': return 'b';
+            case '9': return 'g';
+            default: return c;
+        }
+    }
+
+    bool IsWordCharacter(char c)
+    {
+        const auto byte = (unsigned char)c;
+        return (
+            ((byte >= '0') && (byte <= '9'))
+            || ((byte >= 'a') && (byte <= 'z'))
+            || ((byte >= 'A') && (byte <= 'Z'))
+            || (byte >= 0x80)
+        );
+    }
+
+    /**
+     * This finds every phrase in the text the slow way: by trying each
+     * phrase at each position.
+     */
+    std::vector< Found > ScanByBruteForce(
+        const std::vector< PhraseFilter::Phrase >& phrases,
+        const std::string& text,
+        const PhraseFilter::Settings& settings
+    )
+    {
+        std::vector< Found > found;
+        for (size_t phrase = 0; phrase < phrases.size(); ++phrase)
+        {
+            const auto& phraseText = phrases[phrase].text;
+            if (phraseText.empty())
+            {
+                continue;
+            }
+            for (size_t begin = 0; begin + phraseText.length() <= text.length(); ++begin)
+            {
+                bool matches = true;
+                for (size_t i = 0; matches && (i < phraseText.length()); ++i)
+                {
+                    matches = (
+                        Normalize((unsigned char)text[begin + i], settings)
+                        == Normalize((unsigned char)phraseText[i], settings)
+                    );
+                }
+                const auto end = begin + phraseText.length();
+                if (
+                    !matches
+                    || (
+                        phrases[phrase].wholeWord
+                        && (
+                            ((begin > 0) && IsWordCharacter(text[begin - 1]))
+                            || ((end < text.length()) && IsWordCharacter(text[end]))
+                        )
+                    )
+                )
+                {
+                    continue;
+                }
+                found.emplace_back(end, phrase, begin);
+            }
+        }
+        std::sort(found.begin(), found.end());
+        return found;
+    }
+
+    void TestMatchesBruteForce()
+    {
+        // Phrases and lines are made from a small alphabet of letters in
+        // both cases, leetspeak stand-ins, word breaks and a character
+        // outside of ASCII, so that there are plenty of overlapping
+        // matches, in each of the four ways of folding.
+        const std::vector< std::string > alphabet = {
+            "a", "b", "A", "B", "1", "l", "L", "!", "4", "@", " ", ".", "\xc3\xa9",
+        };
+        std::mt19937 generator(7);
+        for (size_t mode = 0; mode < 4; ++mode)
+        {
+            PhraseFilter::Settings settings;
+            settings.foldCase = ((mode & 1) != 0);
+            settings.foldLeetspeak = ((mode & 2) != 0);
+            PhraseFilter filter(settings);
+            size_t matches = 0;
+            for (size_t round = 0; round < 200; ++round)
+            {
+                std::vector< PhraseFilter::Phrase > phrases;
+                const auto phraseCount = generator() % 30;
+                for (size_t i = 0; i < phraseCount; ++i)
+                {
+                    PhraseFilter::Phrase phrase;
+                    const auto length = generator() % 6;
+                    for (size_t j = 0; j < length; ++j)
+                    {
+                        phrase.text += alphabet[generator() % alphabet.size()];
+                    }
+                    phrase.wholeWord = ((generator() % 2) == 0);
+                    phrases.push_back(phrase);
+                }
+                filter.SetPhrases(phrases);
+                filter.Flush();
+                for (size_t line = 0; line < 30; ++line)
+                {
+                    std::string text;
+                    const auto length = generator() % 60;
+                    for (size_t j = 0; j < length; ++j)
+                    {
+                        text += alphabet[generator() % alphabet.size()];
+                    }
+                    std::vector< Found > found;
+                    const auto count = filter.Scan(
+                        text,
+                        [&](const PhraseFilter::Match& match)
+                        {
+                            found.emplace_back(match.end, match.phrase, match.begin);
+                            return true;
+                        }
+                    );
+                    TWITCH_BOT_CHECK(count == found.size());
+                    TWITCH_BOT_CHECK(std::is_sorted(
+                        found.begin(),
+                        found.end(),
+                        [](const Found& a, const Found& b){ return std::get< 0 >(a) < std::get< 0 >(b); }
+                    ));
+                    std::sort(found.begin(), found.end());
+                    const auto expected = ScanByBruteForce(phrases, text, settings);
+                    if (!TWITCH_BOT_CHECK(found == expected))
+                    {
+                        fprintf(
+                            stderr,
+                            "fold case %d, fold leetspeak %d, text \"%s\": found %zu, expected %zu\n",
+                            (int)settings.foldCase,
+                            (int)settings.foldLeetspeak,
+                            text.c_str(),
+                            found.size(),
+                            expected.size()
+                        );
+                        return;
+                    }
+                    PhraseFilter::Match match;
+                    TWITCH_BOT_CHECK(filter.Check(text, match) == !expected.empty());
+                    matches += expected.size();
+                }
+            }
+            TWITCH_BOT_CHECK(matches > 1000);
+        }
+    }
+
+    void TestWholeWordsAndFolding()
+    {
+        PhraseFilter filter;
+        filter.SetPhrases({
+            {"ass", true},
+            {"buy followers", false},
+            {"", false},
+        });
+        filter.Flush();
+        PhraseFilter::Match match;
+        TWITCH_BOT_CHECK(!filter.Check("what a class act", match));
+        TWITCH_BOT_CHECK(!filter.Check("\xc3\xa9" "ass", match));
+        TWITCH_BOT_CHECK(filter.Check("kick his ASS!", match));
+        TWITCH_BOT_CHECK((match.phrase == 0) && (match.begin == 9) && (match.end == 12));
+        TWITCH_BOT_CHECK(filter.Check("BuY F0LL0WERS at spam.biz", match));
+        TWITCH_BOT_CHECK((match.phrase == 1) && (match.begin == 0) && (match.end == 13));
+        TWITCH_BOT_CHECK(filter.Check("@$$", match));
+        const auto stats = filter.GetStats();
+        TWITCH_BOT_CHECK(stats.phrases == 2);
+        TWITCH_BOT_CHECK(stats.listsCompiled >= 1);
+
+        // A visitor can stop the scan.
+        size_t visited = 0;
+        TWITCH_BOT_CHECK(
+            filter.Scan(
+                "ass ass ass",
+                [&](const PhraseFilter::Match&)
+                {
+                    return (++visited < 2);
+                }
+            ) == 2
+        );
+        TWITCH_BOT_CHECK(visited == 2);
+    }
+}
+
+int main()
+{
+    TestMatchesBruteForce();
+    TestWholeWordsAndFolding();
+    return TwitchBot::Test::Finish();
+}
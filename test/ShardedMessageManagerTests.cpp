@@ -0,0 +1,587 @@
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/ShardedMessageManager.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SimulatedTimeKeeper.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    constexpr size_t SHARDS = 4;
+    constexpr size_t CHANNELS = 400;
+
+    /**
+     * This makes the stand-in connections for the shards, and keeps them,
+     * in the order they were made.
+     */
+    struct FakeConnectionFactory
+    {
+        std::mutex mutex;
+        std::vector< std::shared_ptr< TwitchBot::Test::FakeConnection > > connections;
+
+        std::shared_ptr< TwitchBot::Connection > Make()
+        {
+            const auto connection = std::make_shared< TwitchBot::Test::FakeConnection >();
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            connections.push_back(connection);
+            return connection;
+        }
+
+        std::vector< std::shared_ptr< TwitchBot::Test::FakeConnection > > Get()
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            return connections;
+        }
+    };
+
+    std::string ChannelName(size_t i)
+    {
+        return "channel" + std::to_string(i);
+    }
+
+    /**
+     * This returns the channels a connection is in, going by the JOINs and
+     * PARTs sent on it.
+     */
+    std::set< std::string > GetJoined(TwitchBot::Test::FakeConnection& connection)
+    {
+        std::set< std::string > joined;
+        for (const auto& line: connection.GetLines())
+        {
+            if (line.compare(0, 6, "JOIN #") == 0)
+            {
+                joined.insert(line.substr(6));
+            }
+            else if (line.compare(0, 6, "PART #") == 0)
+            {
+                joined.erase(line.substr(6));
+            }
+        }
+        return joined;
+    }
+
+    /**
+     * This returns the shard of every channel.
+     */
+    std::map< std::string, size_t > GetAssignments(TwitchBot::ShardedMessageManager& manager)
+    {
+        std::map< std::string, size_t > assignments;
+        for (size_t i = 0; i < CHANNELS; ++i)
+        {
+            size_t shard;
+            if (manager.GetShard(ChannelName(i), shard))
+            {
+                assignments[ChannelName(i)] = shard;
+            }
+        }
+        return assignments;
+    }
+
+    /**
+     * This returns the open connection of each shard, going by the channels
+     * each has joined.
+     */
+    std::vector< std::shared_ptr< TwitchBot::Test::FakeConnection > > GetShardConnections(
+        TwitchBot::ShardedMessageManager& manager,
+        FakeConnectionFactory& factory
+    )
+    {
+        const auto assignments = GetAssignments(manager);
+        std::vector< std::shared_ptr< TwitchBot::Test::FakeConnection > > shardConnections(SHARDS);
+        for (const auto& connection: factory.Get())
+        {
+            if (!connection->IsConnected())
+            {
+                continue;
+            }
+            const auto joined = GetJoined(*connection);
+            if (!joined.empty())
+            {
+                shardConnections[assignments.at(*joined.begin())] = connection;
+            }
+        }
+        return shardConnections;
+    }
+
+    /**
+     * This returns an indication of whether or not each open connection
+     * has joined exactly the channels of one shard, and every channel is
+     * joined.
+     */
+    bool AreJoinsDone(
+        TwitchBot::ShardedMessageManager& manager,
+        FakeConnectionFactory& factory
+    )
+    {
+        const auto assignments = GetAssignments(manager);
+        const auto stats = manager.GetStats();
+        size_t joined = 0;
+        for (const auto& connection: factory.Get())
+        {
+            if (!connection->IsConnected())
+            {
+                continue;
+            }
+            const auto channels = GetJoined(*connection);
+            if (channels.empty())
+            {
+                continue;
+            }
+            const auto first = assignments.find(*channels.begin());
+            if (first == assignments.end())
+            {
+                return false;
+            }
+            for (const auto& channel: channels)
+            {
+                const auto assignment = assignments.find(channel);
+                if (
+                    (assignment == assignments.end())
+                    || (assignment->second != first->second)
+                )
+                {
+                    return false;
+                }
+            }
+            if (channels.size() != stats[first->second].channels)
+            {
+                return false;
+            }
+            joined += channels.size();
+        }
+        return (joined == assignments.size());
+    }
+
+    /**
+     * This moves the time forward until the JOINs and PARTs are done,
+     * which Twitch's JOIN limit spreads out over a while.
+     */
+    bool WaitForJoins(
+        TwitchBot::ShardedMessageManager& manager,
+        TwitchBot::SimulatedTimeKeeper& timeKeeper,
+        FakeConnectionFactory& factory
+    )
+    {
+        return TwitchBot::Test::WaitUntil(
+            [&]
+            {
+                if (AreJoinsDone(manager, factory))
+                {
+                    return true;
+                }
+                timeKeeper.Advance(1.0);
+                return false;
+            }
+        );
+    }
+
+    void TestShardsSplitAndRebalanceChannels()
+    {
+        const auto timeKeeper = std::make_shared< TwitchBot::SimulatedTimeKeeper >();
+        timeKeeper->SetCurrentTime(1000.0);
+        FakeConnectionFactory factory;
+        TwitchBot::ShardedMessageManager manager(SHARDS);
+        manager.SetTimeKeeper(timeKeeper);
+        manager.SetAutoReconnect(false);
+        manager.SetConnectionFactory([&]{ return factory.Make(); });
+        std::mutex mutex;
+        size_t logIns = 0;
+        size_t logOuts = 0;
+        std::map< std::string, std::vector< std::string > > received;
+        std::map< std::string, std::set< size_t > > receivedOn;
+        manager.SetShardLoggedInDelegate(
+            [&](size_t)
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                ++logIns;
+            }
+        );
+        manager.SetShardLoggedOutDelegate(
+            [&](size_t)
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                ++logOuts;
+            }
+        );
+        manager.SetMessageReceivedDelegate(
+            [&](size_t shard, const TwitchBot::Message& message)
+            {
+                if (message.command != "PRIVMSG")
+                {
+                    return;
+                }
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                const auto channel = message.parameters[0].substr(1);
+                received[channel].push_back(message.parameters.back());
+                receivedOn[channel].insert(shard);
+            }
+        );
+        for (size_t i = 0; i < CHANNELS; ++i)
+        {
+            manager.Join(ChannelName(i));
+        }
+        manager.LogIn("bot", "token");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return (logIns == SHARDS);
+                }
+            )
+        );
+
+        // Every channel is on exactly one shard, the shards share them out
+        // roughly evenly, and each connection has joined exactly the
+        // channels of its shard.
+        TWITCH_BOT_CHECK(WaitForJoins(manager, *timeKeeper, factory));
+        const auto before = GetAssignments(manager);
+        TWITCH_BOT_CHECK(before.size() == CHANNELS);
+        const auto stats = manager.GetStats();
+        TWITCH_BOT_CHECK(stats.size() == SHARDS);
+        size_t total = 0;
+        for (const auto& shard: stats)
+        {
+            TWITCH_BOT_CHECK(shard.loggedIn);
+            TWITCH_BOT_CHECK(shard.channels >= CHANNELS / SHARDS / 2);
+            TWITCH_BOT_CHECK(shard.channels <= CHANNELS / SHARDS * 2);
+            total += shard.channels;
+        }
+        TWITCH_BOT_CHECK(total == CHANNELS);
+        const auto connections = factory.Get();
+        TWITCH_BOT_CHECK(connections.size() == SHARDS);
+        std::vector< std::shared_ptr< TwitchBot::Test::FakeConnection > > shardConnections(SHARDS);
+        size_t joinsSent = 0;
+        for (const auto& connection: connections)
+        {
+            const auto joined = GetJoined(*connection);
+            joinsSent += connection->CountLines("JOIN #");
+            if (joined.empty())
+            {
+                continue;
+            }
+            const auto shard = before.at(*joined.begin());
+            shardConnections[shard] = connection;
+            for (const auto& channel: joined)
+            {
+                TWITCH_BOT_CHECK(before.at(channel) == shard);
+            }
+        }
+        TWITCH_BOT_CHECK(joinsSent == CHANNELS);
+
+        // Each channel's messages arrive in order, all on its own shard.
+        for (size_t i = 0; i < 10; ++i)
+        {
+            const auto channel = ChannelName(i);
+            const auto connection = shardConnections[before.at(channel)];
+            for (int n = 0; n < 50; ++n)
+            {
+                connection->Receive(":u!u@u.tmi.twitch.tv PRIVMSG #" + channel + " :" + std::to_string(n) + "\r\n");
+            }
+        }
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    size_t count = 0;
+                    for (const auto& channel: received)
+                    {
+                        count += channel.second.size();
+                    }
+                    return (count == 500);
+                }
+            )
+        );
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            for (size_t i = 0; i < 10; ++i)
+            {
+                const auto channel = ChannelName(i);
+                const auto& texts = received[channel];
+                TWITCH_BOT_CHECK(texts.size() == 50);
+                for (size_t n = 0; n < texts.size(); ++n)
+                {
+                    TWITCH_BOT_CHECK(texts[n] == std::to_string(n));
+                }
+                TWITCH_BOT_CHECK(receivedOn[channel] == std::set< size_t >({before.at(channel)}));
+            }
+        }
+
+        // When a shard drops, only its channels move, and they all land on
+        // shards still up.
+        const size_t dropped = 1;
+        shardConnections[dropped]->CloseFromServer();
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return (logOuts == 1);
+                }
+            )
+        );
+        TWITCH_BOT_CHECK(WaitForJoins(manager, *timeKeeper, factory));
+        const auto during = GetAssignments(manager);
+        TWITCH_BOT_CHECK(during.size() == CHANNELS);
+        size_t moved = 0;
+        for (const auto& assignment: before)
+        {
+            if (assignment.second == dropped)
+            {
+                ++moved;
+                TWITCH_BOT_CHECK(during.at(assignment.first) != dropped);
+            }
+            else
+            {
+                TWITCH_BOT_CHECK(during.at(assignment.first) == assignment.second);
+            }
+        }
+        TWITCH_BOT_CHECK(moved > 0);
+        const auto droppedStats = manager.GetStats();
+        TWITCH_BOT_CHECK(!droppedStats[dropped].loggedIn);
+        TWITCH_BOT_CHECK(droppedStats[dropped].drops == 1);
+        size_t movedIn = 0;
+        for (const auto& shard: droppedStats)
+        {
+            movedIn += shard.channelsMovedIn;
+        }
+        TWITCH_BOT_CHECK(movedIn == moved);
+
+        // Logging in again brings the shard back, with the same channels
+        // as before.
+        manager.LogIn("bot", "token");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return (logIns == SHARDS + 1);
+                }
+            )
+        );
+        TWITCH_BOT_CHECK(WaitForJoins(manager, *timeKeeper, factory));
+        TWITCH_BOT_CHECK(GetAssignments(manager) == before);
+        manager.LogOut("");
+    }
+
+    void TestMovedChannelStaysInOrder()
+    {
+        const auto timeKeeper = std::make_shared< TwitchBot::SimulatedTimeKeeper >();
+        timeKeeper->SetCurrentTime(1000.0);
+        FakeConnectionFactory factory;
+        TwitchBot::ShardedMessageManager manager(SHARDS);
+        manager.SetTimeKeeper(timeKeeper);
+        manager.SetAutoReconnect(false);
+        manager.SetConnectionFactory([&]{ return factory.Make(); });
+        manager.SetExecutor(std::make_shared< TwitchBot::Executor >(2));
+        const auto moving = ChannelName(0);
+        std::mutex mutex;
+        size_t logIns = 0;
+        size_t logOuts = 0;
+        std::vector< std::string > received;
+        manager.SetShardLoggedInDelegate(
+            [&](size_t)
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                ++logIns;
+            }
+        );
+        manager.SetShardLoggedOutDelegate(
+            [&](size_t)
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                ++logOuts;
+            }
+        );
+        manager.SetMessageReceivedDelegate(
+            [&](size_t, const TwitchBot::Message& message)
+            {
+                if (
+                    (message.command != "PRIVMSG")
+                    || (message.parameters[0] != "#" + moving)
+                )
+                {
+                    return;
+                }
+
+                // The handler is slow, so that the messages from one shard
+                // are still waiting to be handled when those from the next
+                // shard come in.
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                received.push_back(message.parameters.back());
+            }
+        );
+        for (size_t i = 0; i < CHANNELS; ++i)
+        {
+            manager.Join(ChannelName(i));
+        }
+        manager.LogIn("bot", "token");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return (logIns == SHARDS);
+                }
+            )
+        );
+        TWITCH_BOT_CHECK(WaitForJoins(manager, *timeKeeper, factory));
+        const auto home = GetAssignments(manager).at(moving);
+
+        // The channel's shard drops, so the channel moves to another one,
+        // which receives the first half of the messages.
+        GetShardConnections(manager, factory)[home]->CloseFromServer();
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return (logOuts == 1);
+                }
+            )
+        );
+        TWITCH_BOT_CHECK(WaitForJoins(manager, *timeKeeper, factory));
+        const auto away = GetAssignments(manager).at(moving);
+        TWITCH_BOT_CHECK(away != home);
+        const auto awayConnection = GetShardConnections(manager, factory)[away];
+        const auto awayReceived = manager.GetStats()[away].messagesReceived;
+        for (int n = 0; n < 50; ++n)
+        {
+            awayConnection->Receive(":u!u@u.tmi.twitch.tv PRIVMSG #" + moving + " :" + std::to_string(n) + "\r\n");
+        }
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]{ return (manager.GetStats()[away].messagesReceived >= awayReceived + 50); }
+            )
+        );
+
+        // The shard comes back and the channel moves home, with the first
+        // half still being handled. The shard it left still receives a
+        // message for it, which is dropped, and the second half comes in on
+        // the channel's own shard.
+        manager.LogIn("bot", "token");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return (logIns == SHARDS + 1);
+                }
+            )
+        );
+        TWITCH_BOT_CHECK(WaitForJoins(manager, *timeKeeper, factory));
+        TWITCH_BOT_CHECK(GetAssignments(manager).at(moving) == home);
+        awayConnection->Receive(":u!u@u.tmi.twitch.tv PRIVMSG #" + moving + " :late\r\n");
+        const auto homeConnection = GetShardConnections(manager, factory)[home];
+        for (int n = 50; n < 100; ++n)
+        {
+            homeConnection->Receive(":u!u@u.tmi.twitch.tv PRIVMSG #" + moving + " :" + std::to_string(n) + "\r\n");
+        }
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]{ return (manager.GetStats()[away].messagesReceived >= awayReceived + 51); }
+            )
+        );
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return (received.size() >= 100);
+                }
+            )
+        );
+        manager.LogOut("");
+        std::lock_guard< decltype(mutex) > lock(mutex);
+        TWITCH_BOT_CHECK(received.size() == 100);
+        for (size_t n = 0; n < received.size(); ++n)
+        {
+            TWITCH_BOT_CHECK(received[n] == std::to_string(n));
+        }
+    }
+    void TestChannelNamesFoldCase()
+    {
+        // Twitch channel names are in lower case, so names differing only
+        // in case are the same channel, on the same shard.
+        const auto timeKeeper = std::make_shared< TwitchBot::SimulatedTimeKeeper >();
+        timeKeeper->SetCurrentTime(1000.0);
+        FakeConnectionFactory factory;
+        TwitchBot::ShardedMessageManager manager(SHARDS);
+        manager.SetTimeKeeper(timeKeeper);
+        manager.SetAutoReconnect(false);
+        manager.SetConnectionFactory([&]{ return factory.Make(); });
+        std::mutex mutex;
+        size_t logIns = 0;
+        manager.SetShardLoggedInDelegate(
+            [&](size_t)
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                ++logIns;
+            }
+        );
+        manager.Join("Channel0");
+        manager.Join("channel0");
+        manager.Join("CHANNEL1");
+        manager.LogIn("bot", "token");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return (logIns == SHARDS);
+                }
+            )
+        );
+        TWITCH_BOT_CHECK(WaitForJoins(manager, *timeKeeper, factory));
+        const auto assignments = GetAssignments(manager);
+        TWITCH_BOT_CHECK(assignments.size() == 2);
+        size_t shard;
+        TWITCH_BOT_CHECK(manager.GetShard("CHANNEL0", shard));
+        TWITCH_BOT_CHECK(shard == assignments.at("channel0"));
+        size_t joinsSent = 0;
+        for (const auto& connection: factory.Get())
+        {
+            joinsSent += connection->CountLines("JOIN #");
+            TWITCH_BOT_CHECK(connection->CountLines("JOIN #C") == 0);
+        }
+        TWITCH_BOT_CHECK(joinsSent == 2);
+
+        // Messages go out on the channel's shard, under its folded name.
+        const auto connection = GetShardConnections(manager, factory)[shard];
+        manager.SendMessage("ChAnNeL0", "hello");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    if (connection->CountLines("PRIVMSG #channel0 :hello") == 1)
+                    {
+                        return true;
+                    }
+                    timeKeeper->Advance(1.0);
+                    return false;
+                }
+            )
+        );
+
+        manager.Leave("Channel1");
+        TWITCH_BOT_CHECK(!manager.GetShard("channel1", shard));
+        manager.LogOut("");
+    }
+}
+
+int main()
+{
+    TestShardsSplitAndRebalanceChannels();
+    TestMovedChannelStaysInOrder();
+    TestChannelNamesFoldCase();
+    return TwitchBot::Test::Finish();
+}
@@ -0,0 +1,216 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/LoopbackServer.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SocketConnection.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    /**
+     * This keeps the lines a LoopbackServer receives, for the tests to look
+     * at.
+     */
+    struct ServerLines
+    {
+        std::mutex mutex;
+        std::vector< std::string > lines;
+
+        void Add(const std::string& line)
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            lines.push_back(line);
+        }
+
+        size_t GetCount()
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            return lines.size();
+        }
+
+        /**
+         * This returns a copy of the lines received so far, so the tests
+         * don't hold the lock while they stop the server, whose thread may
+         * still be adding lines.
+         */
+        std::vector< std::string > GetLines()
+        {
+            std::lock_guard< decltype(mutex) > lock(mutex);
+            return lines;
+        }
+    };
+
+    std::string MakeLine(size_t i)
+    {
+        return "PRIVMSG #chan :line " + std::to_string(i);
+    }
+
+    void TestSendsCoalesce()
+    {
+        TwitchBot::LoopbackServer server;
+        ServerLines received;
+        server.SetLineReceivedDelegate([&](const std::string& line){ received.Add(line); });
+        TWITCH_BOT_CHECK(server.Start());
+        TwitchBot::SocketConnection connection("127.0.0.1", server.GetPort());
+        TWITCH_BOT_CHECK(connection.Connect());
+
+        // Lines sent faster than the thread can write them one at a time
+        // go out together, and arrive whole and in order.
+        constexpr size_t lines = 20000;
+        for (size_t i = 0; i < lines; ++i)
+        {
+            connection.Send(MakeLine(i) + "\r\n");
+        }
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return received.GetCount() == lines; })
+        );
+        const auto stats = connection.GetStats();
+        TWITCH_BOT_CHECK(stats.sends == lines);
+        TWITCH_BOT_CHECK(stats.writes < stats.sends);
+        const auto receivedLines = received.GetLines();
+        for (size_t i = 0; i < receivedLines.size(); ++i)
+        {
+            if (!TWITCH_BOT_CHECK(receivedLines[i] == MakeLine(i)))
+            {
+                break;
+            }
+        }
+        (void)connection.Disconnect();
+        server.Stop();
+    }
+
+    void TestPartialWrites()
+    {
+        TwitchBot::LoopbackServer server;
+        ServerLines received;
+        server.SetLineReceivedDelegate([&](const std::string& line){ received.Add(line); });
+        TWITCH_BOT_CHECK(server.Start());
+        TwitchBot::SocketConnection connection("127.0.0.1", server.GetPort());
+        TWITCH_BOT_CHECK(connection.Connect());
+
+        // A single send far bigger than the socket takes at once has to be
+        // written in pieces, picking up in the middle of the text each time.
+        // About eleven megabytes is well past what the socket buffers of
+        // both ends take at once, and the wait is long enough for a loaded
+        // machine to get through it.
+        constexpr size_t lines = 400000;
+        std::string text;
+        for (size_t i = 0; i < lines; ++i)
+        {
+            text += MakeLine(i) + "\r\n";
+        }
+        connection.Send(text);
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]{ return received.GetCount() == lines; },
+                std::chrono::seconds(60)
+            )
+        );
+        const auto stats = connection.GetStats();
+        TWITCH_BOT_CHECK(stats.sends == 1);
+        TWITCH_BOT_CHECK(stats.writes > 1);
+        TWITCH_BOT_CHECK(stats.bytesSent == text.length());
+        const auto receivedLines = received.GetLines();
+        for (size_t i = 0; i < receivedLines.size(); ++i)
+        {
+            if (!TWITCH_BOT_CHECK(receivedLines[i] == MakeLine(i)))
+            {
+                break;
+            }
+        }
+        (void)connection.Disconnect();
+        server.Stop();
+    }
+
+    void TestServerDrop()
+    {
+        TwitchBot::LoopbackServer server;
+        TWITCH_BOT_CHECK(server.Start());
+        TwitchBot::SocketConnection connection("127.0.0.1", server.GetPort());
+        std::atomic< size_t > disconnects{0};
+        std::mutex mutex;
+        std::string receivedText;
+        connection.SetMessageReceivedDelegate(
+            [&](const std::string& text)
+            {
+                std::lock_guard< decltype(mutex) > lock(mutex);
+                receivedText += text;
+            }
+        );
+        connection.SetDisconnectedDelegate([&]{ ++disconnects; });
+        TWITCH_BOT_CHECK(connection.Connect());
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return server.GetClientCount() == 1; })
+        );
+        server.Broadcast("PING :tmi.twitch.tv\r\n");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil(
+                [&]
+                {
+                    std::lock_guard< decltype(mutex) > lock(mutex);
+                    return receivedText == "PING :tmi.twitch.tv\r\n";
+                }
+            )
+        );
+
+        // The server dropping the client is reported, once, and the
+        // connection stops taking text to send.
+        server.DisconnectClients();
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return disconnects == 1; })
+        );
+        connection.Send("PRIVMSG #chan :too late\r\n");
+        TWITCH_BOT_CHECK(connection.GetStats().sends == 0);
+        TWITCH_BOT_CHECK(!connection.Disconnect());
+        TWITCH_BOT_CHECK(disconnects == 1);
+
+        // Hanging up from this end isn't reported as a drop.
+        TWITCH_BOT_CHECK(connection.Connect());
+        TWITCH_BOT_CHECK(connection.Disconnect());
+        TWITCH_BOT_CHECK(disconnects == 1);
+        server.Stop();
+    }
+
+    void TestDestroyedFromDelegate()
+    {
+        // A delegate may destroy the connection it's called from, with the
+        // connection's thread carrying on until it's done.
+        TwitchBot::LoopbackServer server;
+        TWITCH_BOT_CHECK(server.Start());
+        auto connection = std::make_unique< TwitchBot::SocketConnection >("127.0.0.1", server.GetPort());
+        std::atomic< bool > destroyed{false};
+        connection->SetMessageReceivedDelegate(
+            [&](const std::string&)
+            {
+                connection = nullptr;
+                destroyed = true;
+            }
+        );
+        TWITCH_BOT_CHECK(connection->Connect());
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return server.GetClientCount() == 1; })
+        );
+        server.Broadcast("PING :tmi.twitch.tv\r\n");
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return (bool)destroyed; })
+        );
+        TWITCH_BOT_CHECK(
+            TwitchBot::Test::WaitUntil([&]{ return server.GetClientCount() == 0; })
+        );
+        server.Stop();
+    }
+}
+
+int main()
+{
+    TestSendsCoalesce();
+    TestPartialWrites();
+    TestServerDrop();
+    TestDestroyedFromDelegate();
+    return TwitchBot::Test::Finish();
+}
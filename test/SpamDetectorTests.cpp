@@ -0,0 +1,266 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SpamDetector.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::SpamDetector;
+    using TwitchBot::SpamReason;
+
+    /**
+     * These are the invisible characters left out of fingerprints: the
+     * zero-width space, non-joiner and joiner, the word joiner, the byte
+     * order mark, and the first and last tag characters.
+     */
+    const std::vector< std::string > INVISIBLE_CHARACTERS = {
+        "\xe2\x80\x8b", "\xe2\x80\x8c", "\xe2\x80\x8d", "\xe2\x81\xa0",
+        "\xef\xbb\xbf", "\xf3\xa0\x80\x80", "\xf3\xa0\x81\xbf",
+    };
+
+    /**
+     * This normalizes text the way the detector's documentation says it
+     * does, one character at a time.
+     */
+    std::string Normalize(const std::string& text)
+    {
+        std::string normalized;
+        for (size_t i = 0; i < text.length();)
+        {
+            bool invisible = false;
+            for (const auto& character: INVISIBLE_CHARACTERS)
+            {
+                if (text.compare(i, character.length(), character) == 0)
+                {
+                    i += character.length();
+                    invisible = true;
+                    break;
+                }
+            }
+            if (invisible)
+            {
+                continue;
+            }
+            auto c = text[i++];
+            const auto byte = (unsigned char)c;
+            if ((byte >= 'A') && (byte <= 'Z'))
+            {
+                c = (char)(byte - 'A' + 'a');
+            }
+            else if (
+                (byte < 0x80)
+                && !((byte >= 'a') && (byte <= 'z'))
+                && !((byte >= '0') && (byte <= '9'))
+            )
+            {
+                continue;
+            }
+            if (normalized.empty() || (normalized.back() != c))
+            {
+                normalized += c;
+            }
+        }
+        return normalized;
+    }
+
+    void TestFingerprints()
+    {
+        // Lines which normalize the same way have the same fingerprint,
+        // and lines which don't, don't. Some lines are long enough to be
+        // hashed in more than one piece, with invisible characters falling
+        // anywhere.
+        const std::vector< std::string > pieces = {
+            "a", "b", "B", "o", "O", "0", "7", " ", "  ", ",", "!", "\t",
+            "\xc3\xa9", "\xe6\x97\xa5", "\xf0\x9f\x98\x82",
+        };
+        std::mt19937 generator(4);
+        std::map< std::string, uint64_t > fingerprints;
+        std::map< uint64_t, std::string > normalizations;
+        size_t sameAsAnother = 0;
+        for (size_t trial = 0; trial < 30000; ++trial)
+        {
+            std::string text;
+            const auto length = (
+                ((trial % 10) == 0)
+                ? generator() % 2000
+                : generator() % 8
+            );
+            for (size_t i = 0; i < length; ++i)
+            {
+                if ((generator() % 8) == 0)
+                {
+                    text += INVISIBLE_CHARACTERS[generator() % INVISIBLE_CHARACTERS.size()];
+                }
+                text += pieces[generator() % pieces.size()];
+            }
+            const auto normalized = Normalize(text);
+            size_t normalizedLength;
+            const auto fingerprint = SpamDetector::Fingerprint(text, normalizedLength);
+            if (!TWITCH_BOT_CHECK(normalizedLength == normalized.length()))
+            {
+                fprintf(stderr, "\"%s\" normalized to %zu bytes\n", text.c_str(), normalizedLength);
+                return;
+            }
+            const auto known = fingerprints.find(normalized);
+            if (known == fingerprints.end())
+            {
+                fingerprints[normalized] = fingerprint;
+                const auto other = normalizations.find(fingerprint);
+                if (!TWITCH_BOT_CHECK(other == normalizations.end()))
+                {
+                    fprintf(stderr, "\"%s\" and \"%s\" share a fingerprint\n", normalized.c_str(), other->second.c_str());
+                    return;
+                }
+                normalizations[fingerprint] = normalized;
+            }
+            else
+            {
+                TWITCH_BOT_CHECK(known->second == fingerprint);
+                ++sameAsAnother;
+            }
+        }
+        TWITCH_BOT_CHECK(sameAsAnother > 1000);
+        TWITCH_BOT_CHECK(fingerprints.size() > 1000);
+
+        // The ways spammers dress up the same line.
+        size_t length;
+        const auto plain = SpamDetector::Fingerprint("buy followers now", length);
+        TWITCH_BOT_CHECK(length == 14);
+        TWITCH_BOT_CHECK(SpamDetector::Fingerprint("BUY   followers, NOW!!!", length) == plain);
+        TWITCH_BOT_CHECK(SpamDetector::Fingerprint("buuuy folllowers nowww", length) == plain);
+        TWITCH_BOT_CHECK(SpamDetector::Fingerprint("buy fol\xe2\x80\x8blowers now \xf3\xa0\x80\x80", length) == plain);
+        TWITCH_BOT_CHECK(SpamDetector::Fingerprint("buy followers now 2", length) != plain);
+        TWITCH_BOT_CHECK(SpamDetector::Fingerprint("buy f\xc3\xb6llowers now", length) != plain);
+    }
+
+    void TestRepeat()
+    {
+        SpamDetector detector;
+
+        // The third time a user sends the same line within the window,
+        // however it's dressed up, it's a repeat. Another user sending it
+        // isn't.
+        TWITCH_BOT_CHECK(detector.Check("chan", "alice", "follow my channel", 100.0).reason == SpamReason::None);
+        TWITCH_BOT_CHECK(detector.Check("chan", "bob", "follow my channel", 101.0).reason == SpamReason::None);
+        TWITCH_BOT_CHECK(detector.Check("chan", "alice", "FOLLOW my channel!", 105.0).reason == SpamReason::None);
+        auto verdict = detector.Check("chan", "alice", "follow my chann\xe2\x80\x8b" "el", 110.0);
+        TWITCH_BOT_CHECK(verdict.reason == SpamReason::Repeat);
+        TWITCH_BOT_CHECK(verdict.count == 3);
+        size_t length;
+        TWITCH_BOT_CHECK(verdict.fingerprint == SpamDetector::Fingerprint("follow my channel", length));
+
+        // The same line in another channel is counted apart.
+        TWITCH_BOT_CHECK(detector.Check("other", "alice", "follow my channel", 111.0).reason == SpamReason::None);
+
+        // Long after, it's new again.
+        TWITCH_BOT_CHECK(detector.Check("chan", "alice", "follow my channel", 200.0).reason == SpamReason::None);
+        TWITCH_BOT_CHECK(detector.GetStats().repeats == 1);
+    }
+
+    void TestFlood()
+    {
+        SpamDetector detector;
+
+        // Lines a second apart are fine, however many.
+        for (size_t i = 0; i < 20; ++i)
+        {
+            TWITCH_BOT_CHECK(
+                detector.Check("chan", "chatty", "line " + std::to_string(i), 100.0 + (double)i).reason
+                == SpamReason::None
+            );
+        }
+
+        // Six different lines in under three seconds are a flood.
+        for (size_t i = 0; i < 5; ++i)
+        {
+            TWITCH_BOT_CHECK(
+                detector.Check("chan", "flooder", "flood " + std::to_string(i * 7919), 200.0 + (double)i * 0.5).reason
+                == SpamReason::None
+            );
+        }
+        const auto verdict = detector.Check("chan", "flooder", "flood last", 202.5);
+        TWITCH_BOT_CHECK(verdict.reason == SpamReason::Flood);
+        TWITCH_BOT_CHECK(verdict.count == 6);
+        TWITCH_BOT_CHECK(detector.GetStats().floods == 1);
+    }
+
+    void TestCopyPaste()
+    {
+        SpamDetector detector;
+        const std::string pasta = "This streamer is the worst, unfollow now and go watch someone else!";
+
+        // Short lines sent by everyone at once aren't a raid.
+        for (size_t user = 0; user < 50; ++user)
+        {
+            TWITCH_BOT_CHECK(
+                detector.Check("chan", "fan" + std::to_string(user), "GG", 100.0 + (double)user * 0.01).reason
+                == SpamReason::None
+            );
+        }
+
+        // A few users sending a long line twice each isn't a raid either,
+        // since each user counts once.
+        for (size_t round = 0; round < 2; ++round)
+        {
+            for (size_t user = 0; user < 4; ++user)
+            {
+                TWITCH_BOT_CHECK(
+                    detector.Check("chan", "friend" + std::to_string(user), pasta, 101.0 + (double)round).reason
+                    == SpamReason::None
+                );
+            }
+        }
+
+        // Many users pasting it, dressed up in different ways, are. (The
+        // first few users counted above bring the raid on a bit sooner.)
+        std::vector< SpamReason > reasons;
+        const std::vector< std::string > variants = {
+            pasta,
+            "  " + pasta + "...",
+            pasta + " \xf3\xa0\x80\x80",
+            "THIS STREAMER IS THE WORST, UNFOLLOW NOW AND GO WATCH SOMEONE ELSE!",
+        };
+        for (size_t user = 0; user < 20; ++user)
+        {
+            const auto verdict = detector.Check(
+                "chan",
+                "raider" + std::to_string(user),
+                variants[user % variants.size()],
+                103.0 + (double)user * 0.1
+            );
+            reasons.push_back(verdict.reason);
+            if (verdict.reason == SpamReason::CopyPaste)
+            {
+                TWITCH_BOT_CHECK(verdict.count >= 8);
+            }
+        }
+        TWITCH_BOT_CHECK(reasons[0] == SpamReason::None);
+        for (size_t user = 6; user < reasons.size(); ++user)
+        {
+            TWITCH_BOT_CHECK(reasons[user] == SpamReason::CopyPaste);
+        }
+
+        // The raid is on one channel only.
+        TWITCH_BOT_CHECK(detector.Check("other", "raider0", pasta, 105.0).reason == SpamReason::None);
+        const auto stats = detector.GetStats();
+        TWITCH_BOT_CHECK(stats.lines == 50 + 8 + 20 + 1);
+        TWITCH_BOT_CHECK(stats.copyPastes >= 14);
+        TWITCH_BOT_CHECK(stats.repeats == 0);
+        TWITCH_BOT_CHECK(stats.floods == 0);
+    }
+}
+
+int main()
+{
+    TestFingerprints();
+    TestRepeat();
+    TestFlood();
+    TestCopyPaste();
+    return TwitchBot::Test::Finish();
+}
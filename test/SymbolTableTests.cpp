@@ -0,0 +1,189 @@
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SymbolTable.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::SymbolTable;
+
+    std::string MakeName(size_t i)
+    {
+        return "user" + std::to_string(i);
+    }
+
+    void TestInternAndFind()
+    {
+        SymbolTable table;
+        TWITCH_BOT_CHECK(table.Intern("") == SymbolTable::NO_SYMBOL);
+        TWITCH_BOT_CHECK(table.Find("alpha") == SymbolTable::NO_SYMBOL);
+        TWITCH_BOT_CHECK(table.GetCount() == 0);
+
+        // Symbols are handed out from 1, and the same name always gets the
+        // same one. Names differing only in case are different names.
+        const auto alpha = table.Intern("alpha");
+        TWITCH_BOT_CHECK(alpha == 1);
+        TWITCH_BOT_CHECK(table.Intern("alpha") == alpha);
+        const auto upperAlpha = table.Intern("Alpha");
+        TWITCH_BOT_CHECK(upperAlpha == 2);
+        TWITCH_BOT_CHECK(table.Find("alpha") == alpha);
+        TWITCH_BOT_CHECK(table.Find("Alpha") == upperAlpha);
+        TWITCH_BOT_CHECK(table.GetName(alpha) == "alpha");
+        TWITCH_BOT_CHECK(table.GetName(upperAlpha) == "Alpha");
+        TWITCH_BOT_CHECK(table.GetName(SymbolTable::NO_SYMBOL).empty());
+        TWITCH_BOT_CHECK(table.GetName(3).empty());
+
+        // Names too long to be copied into the index, or into a block of
+        // names shared with others, are still found.
+        const std::string longName(40, 'x');
+        const std::string hugeName(100000, 'y');
+        const auto longSymbol = table.Intern(longName);
+        const auto hugeSymbol = table.Intern(hugeName);
+        TWITCH_BOT_CHECK(table.Find(longName) == longSymbol);
+        TWITCH_BOT_CHECK(table.Find(hugeName) == hugeSymbol);
+        TWITCH_BOT_CHECK(table.Find(std::string(40, 'z')) == SymbolTable::NO_SYMBOL);
+        TWITCH_BOT_CHECK(table.GetName(hugeSymbol) == hugeName);
+        TWITCH_BOT_CHECK(table.GetCount() == 4);
+        TWITCH_BOT_CHECK(table.GetMemoryUsage() > hugeName.length());
+    }
+
+    void TestGrowth()
+    {
+        // Enough names to grow every part of the index several times, and
+        // to need more than one page of symbols.
+        constexpr size_t names = 20000;
+        SymbolTable table;
+        for (size_t i = 0; i < names; ++i)
+        {
+            if (!TWITCH_BOT_CHECK(table.Intern(MakeName(i)) == i + 1))
+            {
+                return;
+            }
+        }
+        TWITCH_BOT_CHECK(table.GetCount() == names);
+        for (size_t i = 0; i < names; ++i)
+        {
+            if (
+                !TWITCH_BOT_CHECK(table.Find(MakeName(i)) == i + 1)
+                || !TWITCH_BOT_CHECK(table.GetName((SymbolTable::Symbol)(i + 1)) == MakeName(i))
+            )
+            {
+                return;
+            }
+        }
+    }
+
+    void TestConcurrentInterning()
+    {
+        // Several threads intern overlapping names at once, each in its own
+        // order. Every name must end up with exactly one symbol, which all
+        // the threads agree on, and whose name is the name.
+        constexpr size_t threadCount = 4;
+        constexpr size_t names = 20000;
+        const auto table = std::make_shared< SymbolTable >();
+        std::vector< std::vector< SymbolTable::Symbol > > symbols(
+            threadCount,
+            std::vector< SymbolTable::Symbol >(names)
+        );
+        std::vector< std::thread > threads;
+        for (size_t t = 0; t < threadCount; ++t)
+        {
+            threads.emplace_back(
+                [&, t]
+                {
+                    SymbolTable::Cache cache(table);
+                    for (size_t n = 0; n < names; ++n)
+                    {
+                        const auto i = ((t % 2) == 0) ? n : (names - 1 - n);
+                        const auto name = MakeName(i);
+                        symbols[t][i] = ((n % 3) == 0) ? table->Intern(name) : cache.Intern(name);
+                        (void)table->GetName(symbols[t][i]);
+                    }
+                }
+            );
+        }
+        for (auto& thread: threads)
+        {
+            thread.join();
+        }
+        TWITCH_BOT_CHECK(table->GetCount() == names);
+        for (size_t i = 0; i < names; ++i)
+        {
+            bool agree = true;
+            for (size_t t = 1; t < threadCount; ++t)
+            {
+                agree &= (symbols[t][i] == symbols[0][i]);
+            }
+            if (
+                !TWITCH_BOT_CHECK(agree)
+                || !TWITCH_BOT_CHECK(table->GetName(symbols[0][i]) == MakeName(i))
+            )
+            {
+                return;
+            }
+        }
+    }
+
+    void TestCache()
+    {
+        const auto table = std::make_shared< SymbolTable >();
+        SymbolTable::Cache cache(table);
+        TWITCH_BOT_CHECK(cache.GetTable() == table);
+        TWITCH_BOT_CHECK(cache.Intern("") == SymbolTable::NO_SYMBOL);
+        TWITCH_BOT_CHECK(cache.Find("") == SymbolTable::NO_SYMBOL);
+
+        // A miss goes to the table, and a hit gives the same symbol.
+        const auto alpha = cache.Intern("alpha");
+        TWITCH_BOT_CHECK(alpha == table->Find("alpha"));
+        TWITCH_BOT_CHECK(cache.Intern("alpha") == alpha);
+        TWITCH_BOT_CHECK(cache.Find("alpha") == alpha);
+
+        // Looking up a name doesn't add it, and the miss isn't remembered,
+        // so the name is found once something else interns it.
+        TWITCH_BOT_CHECK(cache.Find("beta") == SymbolTable::NO_SYMBOL);
+        TWITCH_BOT_CHECK(table->GetCount() == 1);
+        const auto beta = table->Intern("beta");
+        TWITCH_BOT_CHECK(cache.Find("beta") == beta);
+
+        // Names which share a slot of the cache push each other out, but
+        // are still found in the table.
+        std::vector< SymbolTable::Symbol > symbols;
+        for (size_t i = 0; i < 10000; ++i)
+        {
+            symbols.push_back(cache.Intern(MakeName(i)));
+        }
+        for (size_t i = 0; i < symbols.size(); ++i)
+        {
+            if (
+                !TWITCH_BOT_CHECK(cache.Find(MakeName(i)) == symbols[i])
+                || !TWITCH_BOT_CHECK(cache.Intern(MakeName(i)) == symbols[i])
+            )
+            {
+                break;
+            }
+        }
+        TWITCH_BOT_CHECK(cache.Intern("alpha") == alpha);
+
+        // Names too long for the cache always go to the table.
+        const std::string longName(30, 'x');
+        TWITCH_BOT_CHECK(cache.Find(longName) == SymbolTable::NO_SYMBOL);
+        const auto longSymbol = cache.Intern(longName);
+        TWITCH_BOT_CHECK(longSymbol != SymbolTable::NO_SYMBOL);
+        TWITCH_BOT_CHECK(cache.Find(longName) == longSymbol);
+        TWITCH_BOT_CHECK(table->Find(longName) == longSymbol);
+    }
+}
+
+int main()
+{
+    TestInternAndFind();
+    TestGrowth();
+    TestConcurrentInterning();
+    TestCache();
+    return TwitchBot::Test::Finish();
+}
@@ -0,0 +1,260 @@
+#ifndef TWITCH_BOT_TEST_SUPPORT_HPP
+#define TWITCH_BOT_TEST_SUPPORT_HPP
+
+#include <stdio.h>
+#include <stddef.h>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/Connection.hpp>
+
+namespace TwitchBot
+{
+    namespace Test
+    {
+        /**
+         * This is the number of checks which have failed so far.
+         */
+        inline size_t failures = 0;
+
+        /**
+         * This notes the outcome of a check, printing where it was made if
+         * it failed.
+         *
+         * @param[in] passed This indicates whether or not the check passed.
+         *
+         * @param[in] expression This is the text of the check.
+         *
+         * @param[in] file This is the file in which the check was made.
+         *
+         * @param[in] line This is the line on which the check was made.
+         *
+         * @return an indication of whether or not the check passed is
+         * returned.
+         */
+        inline bool Check(
+            bool passed,
+            const char* expression,
+            const char* file,
+            int line
+        )
+        {
+            if (!passed)
+            {
+                ++failures;
+                fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+            }
+            return passed;
+        }
+
+        /**
+         * This waits until the given condition holds, checking it every
+         * millisecond, for up to the given amount of real time.
+         *
+         * @param[in] condition This is the condition to wait for.
+         *
+         * @param[in] timeout This is the longest to wait.
+         *
+         * @return an indication of whether or not the condition held in time
+         * is returned.
+         */
+        inline bool WaitUntil(
+            std::function< bool() > condition,
+            std::chrono::milliseconds timeout = std::chrono::seconds(5)
+        )
+        {
+            const auto deadline = std::chrono::steady_clock::now() + timeout;
+            while (!condition())
+            {
+                if (std::chrono::steady_clock::now() >= deadline)
+                {
+                    return false;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            return true;
+        }
+
+        /**
+         * This is a stand-in for a connection to the Twitch server. It keeps
+         * everything sent, answers logging in with the end of the MOTD and
+         * PINGs with PONGs, and hands the tests' own traffic to the
+         * MessageManager.
+         */
+        class FakeConnection
+            : public Connection
+        {
+            public:
+                /**
+                 * This hands the given text to the MessageManager, as if the
+                 * server had sent it.
+                 */
+                void Receive(const std::string& text)
+                {
+                    MessageReceivedDelegate messageReceivedDelegate;
+                    {
+                        std::lock_guard< decltype(mutex_) > lock(mutex_);
+                        messageReceivedDelegate = messageReceivedDelegate_;
+                    }
+                    messageReceivedDelegate(text);
+                }
+
+                /**
+                 * This tells the MessageManager the server closed the
+                 * connection.
+                 */
+                void CloseFromServer()
+                {
+                    DisconnectedDelegate disconnectedDelegate;
+                    {
+                        std::lock_guard< decltype(mutex_) > lock(mutex_);
+                        disconnectedDelegate = disconnectedDelegate_;
+                    }
+                    disconnectedDelegate();
+                }
+
+                /**
+                 * This returns every line sent so far, without CRLFs.
+                 */
+                std::vector< std::string > GetLines()
+                {
+                    std::lock_guard< decltype(mutex_) > lock(mutex_);
+                    return lines_;
+                }
+
+                /**
+                 * This returns the number of lines sent so far which start
+                 * with the given text.
+                 */
+                size_t CountLines(const std::string& start)
+                {
+                    std::lock_guard< decltype(mutex_) > lock(mutex_);
+                    size_t count = 0;
+                    for (const auto& line: lines_)
+                    {
+                        if (line.compare(0, start.length(), start) == 0)
+                        {
+                            ++count;
+                        }
+                    }
+                    return count;
+                }
+
+                /**
+                 * This returns the number of calls to Send so far.
+                 */
+                size_t GetWrites()
+                {
+                    std::lock_guard< decltype(mutex_) > lock(mutex_);
+                    return writes_;
+                }
+
+                /**
+                 * This returns an indication of whether or not the
+                 * connection is open.
+                 */
+                bool IsConnected()
+                {
+                    std::lock_guard< decltype(mutex_) > lock(mutex_);
+                    return connected_;
+                }
+
+            // TwitchBot::Connection
+            public:
+                virtual void SetMessageReceivedDelegate(MessageReceivedDelegate messageReceivedDelegate) override
+                {
+                    std::lock_guard< decltype(mutex_) > lock(mutex_);
+                    messageReceivedDelegate_ = messageReceivedDelegate;
+                }
+
+                virtual void SetDisconnectedDelegate(DisconnectedDelegate disconnectedDelegate) override
+                {
+                    std::lock_guard< decltype(mutex_) > lock(mutex_);
+                    disconnectedDelegate_ = disconnectedDelegate;
+                }
+
+                virtual bool Connect() override
+                {
+                    std::lock_guard< decltype(mutex_) > lock(mutex_);
+                    connected_ = true;
+                    return true;
+                }
+
+                virtual bool Disconnect() override
+                {
+                    std::lock_guard< decltype(mutex_) > lock(mutex_);
+                    connected_ = false;
+                    return true;
+                }
+
+                virtual void Send(const std::string& message) override
+                {
+                    std::string answer;
+                    {
+                        std::lock_guard< decltype(mutex_) > lock(mutex_);
+                        ++writes_;
+                        size_t offset = 0;
+                        while (offset < message.length())
+                        {
+                            auto lineEnd = message.find("\r\n", offset);
+                            if (lineEnd == std::string::npos)
+                            {
+                                lineEnd = message.length();
+                            }
+                            lines_.push_back(message.substr(offset, lineEnd - offset));
+                            const auto& line = lines_.back();
+                            if (line.compare(0, 5, "NICK ") == 0)
+                            {
+                                answer += ":tmi.twitch.tv 376 bot :>\r\n";
+                            }
+                            else if (line.compare(0, 6, "PING :") == 0)
+                            {
+                                answer += ":tmi.twitch.tv PONG tmi.twitch.tv :" + line.substr(6) + "\r\n";
+                            }
+                            offset = lineEnd + 2;
+                        }
+                    }
+                    if (!answer.empty())
+                    {
+                        Receive(answer);
+                    }
+                }
+
+            private:
+                std::mutex mutex_;
+                MessageReceivedDelegate messageReceivedDelegate_;
+                DisconnectedDelegate disconnectedDelegate_;
+                std::vector< std::string > lines_;
+                size_t writes_ = 0;
+                bool connected_ = false;
+        };
+
+        /**
+         * This prints how many checks failed, and returns what the test
+         * program should return.
+         *
+         * @return Zero is returned if every check passed, and one otherwise.
+         */
+        inline int Finish()
+        {
+            if (failures != 0)
+            {
+                fprintf(stderr, "%zu check(s) failed\n", failures);
+                return 1;
+            }
+            return 0;
+        }
+    }
+}
+
+/**
+ * This checks that the given expression is true, and keeps going either way.
+ */
+#define TWITCH_BOT_CHECK(expression) \
+    TwitchBot::Test::Check((expression), #expression, __FILE__, __LINE__)
+
+#endif /* TWITCH_BOT_TEST_SUPPORT_HPP */
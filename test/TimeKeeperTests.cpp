@@ -0,0 +1,232 @@
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SimulatedTimeKeeper.hpp>
+#include </home/criogenesis/Downloads/TwitchCppBot/include/SteadyTimeKeeper.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::SimulatedTimeKeeper;
+    using TwitchBot::SteadyTimeKeeper;
+
+    void TestTimersFireInOrder()
+    {
+        // Timers are set in a random order, many sharing deadlines, and
+        // each notes the time when it fires.
+        SimulatedTimeKeeper timeKeeper;
+        std::mt19937 generator(2);
+        std::vector< std::pair< int64_t, size_t > > expected;
+        std::vector< std::pair< int64_t, size_t > > fired;
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            const auto deadline = (int64_t)(1 + generator() % 100) * 1000000;
+            expected.emplace_back(deadline, i);
+            (void)timeKeeper.Schedule(
+                deadline,
+                [&timeKeeper, &fired, i]{
+                    fired.emplace_back(timeKeeper.GetCurrentTimeNanoseconds(), i);
+                }
+            );
+        }
+        TWITCH_BOT_CHECK(timeKeeper.GetTimerCount() == 1000);
+
+        // Moving the time part of the way fires only the timers due by
+        // then, by deadline, and by the order they were set for the same
+        // deadline, each seeing its own deadline as the time.
+        std::stable_sort(
+            expected.begin(),
+            expected.end(),
+            [](const std::pair< int64_t, size_t >& a, const std::pair< int64_t, size_t >& b)
+            {
+                return a.first < b.first;
+            }
+        );
+        timeKeeper.Advance(0.05);
+        TWITCH_BOT_CHECK(timeKeeper.GetCurrentTimeNanoseconds() == 50000000);
+        const auto due = (size_t)(
+            std::upper_bound(
+                expected.begin(),
+                expected.end(),
+                std::make_pair((int64_t)50000000, SIZE_MAX)
+            ) - expected.begin()
+        );
+        const std::vector< std::pair< int64_t, size_t > > firstFired(
+            expected.begin(),
+            expected.begin() + due
+        );
+        TWITCH_BOT_CHECK(fired == firstFired);
+        TWITCH_BOT_CHECK(timeKeeper.GetTimerCount() == 1000 - due);
+        timeKeeper.SetCurrentTime(1.0);
+        TWITCH_BOT_CHECK(fired == expected);
+        TWITCH_BOT_CHECK(timeKeeper.GetTimerCount() == 0);
+        TWITCH_BOT_CHECK(timeKeeper.GetCurrentTime() == 1.0);
+    }
+
+    void TestTimersSetWhileFiring()
+    {
+        SimulatedTimeKeeper timeKeeper;
+        std::vector< int64_t > fired;
+        (void)timeKeeper.Schedule(
+            10,
+            [&]{
+                fired.push_back(timeKeeper.GetCurrentTimeNanoseconds());
+
+                // A timer set by another, due before the time stops moving,
+                // fires on the same move; one due after waits.
+                (void)timeKeeper.Schedule(20, [&]{ fired.push_back(timeKeeper.GetCurrentTimeNanoseconds()); });
+                (void)timeKeeper.Schedule(40, [&]{ fired.push_back(timeKeeper.GetCurrentTimeNanoseconds()); });
+            }
+        );
+        timeKeeper.AdvanceNanoseconds(30);
+        TWITCH_BOT_CHECK(fired == std::vector< int64_t >({10, 20}));
+        TWITCH_BOT_CHECK(timeKeeper.GetCurrentTimeNanoseconds() == 30);
+
+        // A timer whose deadline has already passed fires the next time
+        // the time moves, without moving it back.
+        (void)timeKeeper.Schedule(5, [&]{ fired.push_back(timeKeeper.GetCurrentTimeNanoseconds()); });
+        TWITCH_BOT_CHECK(fired.size() == 2);
+        TWITCH_BOT_CHECK(timeKeeper.AdvanceToNextTimer());
+        TWITCH_BOT_CHECK(fired == std::vector< int64_t >({10, 20, 30}));
+        TWITCH_BOT_CHECK(timeKeeper.GetCurrentTimeNanoseconds() == 30);
+
+        // Going to the next timer goes straight to its deadline.
+        TWITCH_BOT_CHECK(timeKeeper.AdvanceToNextTimer());
+        TWITCH_BOT_CHECK(fired == std::vector< int64_t >({10, 20, 30, 40}));
+        TWITCH_BOT_CHECK(timeKeeper.GetCurrentTimeNanoseconds() == 40);
+        TWITCH_BOT_CHECK(!timeKeeper.AdvanceToNextTimer());
+        TWITCH_BOT_CHECK(timeKeeper.GetCurrentTimeNanoseconds() == 40);
+    }
+
+    void TestCancelAndTimeChanged()
+    {
+        SimulatedTimeKeeper timeKeeper;
+        std::vector< int64_t > changes;
+        const auto token = timeKeeper.AddTimeChangedDelegate(
+            [&]{ changes.push_back(timeKeeper.GetCurrentTimeNanoseconds()); }
+        );
+        size_t fired = 0;
+        const auto first = timeKeeper.Schedule(100, [&]{ ++fired; });
+        const auto second = timeKeeper.Schedule(200, [&]{ ++fired; });
+        TWITCH_BOT_CHECK(first != 0);
+        TWITCH_BOT_CHECK(second != first);
+        TWITCH_BOT_CHECK(timeKeeper.Cancel(first));
+        TWITCH_BOT_CHECK(!timeKeeper.Cancel(first));
+        TWITCH_BOT_CHECK(timeKeeper.GetTimerCount() == 1);
+
+        // The delegates see the time stop at each deadline on the way.
+        timeKeeper.AdvanceNanoseconds(300);
+        TWITCH_BOT_CHECK(fired == 1);
+        TWITCH_BOT_CHECK(!timeKeeper.Cancel(second));
+        TWITCH_BOT_CHECK(changes == std::vector< int64_t >({200, 300}));
+
+        // Once removed, a delegate is no longer called.
+        timeKeeper.RemoveTimeChangedDelegate(token);
+        timeKeeper.Advance(1.0);
+        TWITCH_BOT_CHECK(changes.size() == 2);
+    }
+
+    void TestMovedFromManyThreads()
+    {
+        // Threads moving the time at once fire each timer exactly once.
+        SimulatedTimeKeeper timeKeeper;
+        std::atomic< size_t > fired{0};
+        for (int64_t deadline = 1; deadline <= 10000; ++deadline)
+        {
+            (void)timeKeeper.Schedule(deadline, [&]{ ++fired; });
+        }
+        std::vector< std::thread > threads;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            threads.emplace_back(
+                [&]{
+                    for (size_t step = 0; step < 2500; ++step)
+                    {
+                        timeKeeper.AdvanceNanoseconds(1);
+                    }
+                }
+            );
+        }
+        for (auto& thread: threads)
+        {
+            thread.join();
+        }
+        TWITCH_BOT_CHECK(fired == 10000);
+        TWITCH_BOT_CHECK(timeKeeper.GetCurrentTimeNanoseconds() == 10000);
+    }
+
+    void TestSteadyTimeNeverGoesBack(SteadyTimeKeeper::Source source)
+    {
+        // The threads read for long enough that the rate of the cycle
+        // counter is adjusted at least once while they do.
+        SteadyTimeKeeper timeKeeper(source);
+        std::atomic< bool > wentBack{false};
+        std::vector< std::thread > threads;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            threads.emplace_back(
+                [&]{
+                    auto last = timeKeeper.GetCurrentTimeNanoseconds();
+                    const auto stop = std::chrono::steady_clock::now() + std::chrono::milliseconds(1200);
+                    while (std::chrono::steady_clock::now() < stop)
+                    {
+                        const auto now = timeKeeper.GetCurrentTimeNanoseconds();
+                        if (now < last)
+                        {
+                            wentBack = true;
+                        }
+                        last = now;
+                    }
+                }
+            );
+        }
+        for (auto& thread: threads)
+        {
+            thread.join();
+        }
+        TWITCH_BOT_CHECK(!wentBack);
+
+        // It keeps step with the steady clock. Each reading is taken
+        // between two of the steady clock, so that however long the
+        // thread is held up between readings, the time which passed is
+        // known to be between the inner and outer pairs.
+        using Clock = std::chrono::steady_clock;
+        const auto nanosecondsBetween = [](Clock::time_point from, Clock::time_point to)
+        {
+            return (int64_t)std::chrono::duration_cast< std::chrono::nanoseconds >(to - from).count();
+        };
+        const auto outerStart = Clock::now();
+        const auto start = timeKeeper.GetCurrentTimeNanoseconds();
+        const auto innerStart = Clock::now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        const auto innerEnd = Clock::now();
+        const auto end = timeKeeper.GetCurrentTimeNanoseconds();
+        const auto outerEnd = Clock::now();
+        const auto shortest = nanosecondsBetween(innerStart, innerEnd);
+        const auto longest = nanosecondsBetween(outerStart, outerEnd);
+        TWITCH_BOT_CHECK(end - start >= shortest - shortest / 20);
+        TWITCH_BOT_CHECK(end - start <= longest + longest / 20);
+        const auto seconds = timeKeeper.GetCurrentTime();
+        const auto nanoseconds = timeKeeper.GetCurrentTimeNanoseconds();
+        TWITCH_BOT_CHECK((double)nanoseconds / 1e9 >= seconds);
+    }
+}
+
+int main()
+{
+    TestTimersFireInOrder();
+    TestTimersSetWhileFiring();
+    TestCancelAndTimeChanged();
+    TestMovedFromManyThreads();
+    TestSteadyTimeNeverGoesBack(SteadyTimeKeeper::Source::SteadyClock);
+    TestSteadyTimeNeverGoesBack(SteadyTimeKeeper::Source::CycleCounter);
+    TWITCH_BOT_CHECK(SteadyTimeKeeper().GetSource() == SteadyTimeKeeper::Source::SteadyClock);
+    return TwitchBot::Test::Finish();
+}
@@ -0,0 +1,207 @@
+#include <stdint.h>
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include </home/criogenesis/Downloads/TwitchCppBot/include/TimerWheel.hpp>
+
+#include "TestSupport.hpp"
+
+namespace
+{
+    using TwitchBot::TimerWheel;
+
+    /**
+     * This is the span of time the wheels cover together, past which
+     * timers are placed in the outermost wheel to be looked at again later.
+     */
+    constexpr uint64_t FULL_TURN = (uint64_t)1 << 36;
+
+    /**
+     * This is what the reference model knows about a timer: when it's due,
+     * counting a deadline already passed when it was scheduled as due at
+     * that time, and a tag telling it apart from the others.
+     */
+    typedef std::pair< uint64_t, uint64_t > Expected;
+
+    /**
+     * This schedules, cancels and advances at random, checking after each
+     * advance that exactly the timers due in the reference model fired, in
+     * order of deadline, and none early.
+     */
+    void RunRandomized(uint64_t start, size_t steps, uint64_t seed)
+    {
+        std::mt19937_64 generator(seed);
+        TimerWheel wheel(start);
+        uint64_t now = start;
+        std::map< TimerWheel::TimerId, Expected > live;
+        std::vector< Expected > fired;
+        uint64_t nextTag = 0;
+        size_t early = 0;
+        for (size_t step = 0; step < steps; ++step)
+        {
+            const auto operation = generator() % 10;
+            if (operation < 5)
+            {
+                // Deadlines are mostly near, sometimes past, and sometimes
+                // beyond what the wheels cover.
+                uint64_t deadline = now;
+                switch (generator() % 5)
+                {
+                    case 0: deadline = now + generator() % 70; break;
+                    case 1: deadline = now + generator() % 5000; break;
+                    case 2: deadline = now + generator() % ((uint64_t)1 << 32); break;
+                    case 3: deadline = now + generator() % (FULL_TURN * 16); break;
+                    default: deadline = now - std::min(now, (uint64_t)(generator() % 5)); break;
+                }
+                const Expected expected(std::max(deadline, now), nextTag++);
+                const auto id = wheel.Schedule(
+                    deadline,
+                    [&, expected]
+                    {
+                        fired.push_back(expected);
+                        if (expected.first > wheel.GetNow())
+                        {
+                            ++early;
+                        }
+                    }
+                );
+                live[id] = expected;
+            }
+            else if ((operation < 7) && !live.empty())
+            {
+                auto timer = live.begin();
+                std::advance(timer, generator() % std::min< size_t >(live.size(), 50));
+                TWITCH_BOT_CHECK(wheel.Cancel(timer->first));
+                live.erase(timer);
+            }
+            else
+            {
+                // Time mostly moves a little, so that timers pile up, and
+                // now and then jumps far enough to cascade the outer wheels.
+                const auto jump = generator() % 20;
+                if (jump < 15)
+                {
+                    now += generator() % 100;
+                }
+                else if (jump < 19)
+                {
+                    now += generator() % 100000;
+                }
+                else
+                {
+                    now += generator() % ((uint64_t)1 << 34);
+                }
+                fired.clear();
+                const auto expired = wheel.Advance(now);
+                std::multiset< Expected > due;
+                for (auto timer = live.begin(); timer != live.end();)
+                {
+                    if (timer->second.first <= now)
+                    {
+                        due.insert(timer->second);
+                        timer = live.erase(timer);
+                    }
+                    else
+                    {
+                        ++timer;
+                    }
+                }
+                TWITCH_BOT_CHECK(expired == fired.size());
+                TWITCH_BOT_CHECK(std::multiset< Expected >(fired.begin(), fired.end()) == due);
+                for (size_t i = 1; i < fired.size(); ++i)
+                {
+                    TWITCH_BOT_CHECK(fired[i - 1].first <= fired[i].first);
+                }
+                TWITCH_BOT_CHECK(wheel.GetCount() == live.size());
+                uint64_t nextDeadline = 0;
+                TWITCH_BOT_CHECK(wheel.GetNextDeadline(nextDeadline) == !live.empty());
+                for (const auto& timer: live)
+                {
+                    TWITCH_BOT_CHECK(nextDeadline <= timer.second.first);
+                }
+            }
+        }
+        TWITCH_BOT_CHECK(early == 0);
+    }
+
+    void TestRandomizedAgainstReference()
+    {
+        // Starting just short of a full turn of the wheels, and beyond a
+        // few of them, makes the time wrap around the outer wheel.
+        RunRandomized(0, 100000, 1);
+        RunRandomized(FULL_TURN - 5000, 100000, 2);
+        RunRandomized(FULL_TURN * 3 + 12345, 100000, 3);
+    }
+
+    void TestCancelAfterFire()
+    {
+        TimerWheel wheel(100);
+        size_t calls = 0;
+        const auto id = wheel.Schedule(110, [&]{ ++calls; });
+        TWITCH_BOT_CHECK(wheel.Advance(110) == 1);
+        TWITCH_BOT_CHECK(calls == 1);
+        TWITCH_BOT_CHECK(!wheel.Cancel(id));
+        TWITCH_BOT_CHECK(wheel.Empty());
+
+        // A timer can't cancel itself once it's firing.
+        TimerWheel::TimerId self = 0;
+        bool selfCancelled = true;
+        self = wheel.Schedule(120, [&]{ selfCancelled = wheel.Cancel(self); });
+        TWITCH_BOT_CHECK(wheel.Advance(120) == 1);
+        TWITCH_BOT_CHECK(!selfCancelled);
+
+        // A timer firing can cancel another due at the same time, which
+        // then isn't called.
+        TimerWheel::TimerId second = 0;
+        bool secondCancelled = false;
+        bool secondCalled = false;
+        (void)wheel.Schedule(130, [&]{ secondCancelled = wheel.Cancel(second); });
+        second = wheel.Schedule(130, [&]{ secondCalled = true; });
+        TWITCH_BOT_CHECK(wheel.Advance(130) == 1);
+        TWITCH_BOT_CHECK(secondCancelled);
+        TWITCH_BOT_CHECK(!secondCalled);
+        TWITCH_BOT_CHECK(wheel.Empty());
+    }
+
+    void TestStaleTimerIds()
+    {
+        TimerWheel wheel(0);
+        TWITCH_BOT_CHECK(!wheel.Cancel(0));
+        TWITCH_BOT_CHECK(!wheel.Cancel(~(TimerWheel::TimerId)0));
+
+        // Once a timer is cancelled, its node is reused, and the old
+        // identifier doesn't match the new timer.
+        const auto cancelled = wheel.Schedule(10, []{});
+        TWITCH_BOT_CHECK(wheel.Cancel(cancelled));
+        TWITCH_BOT_CHECK(!wheel.Cancel(cancelled));
+        bool reusedCalled = false;
+        const auto reused = wheel.Schedule(10, [&]{ reusedCalled = true; });
+        TWITCH_BOT_CHECK(reused != cancelled);
+        TWITCH_BOT_CHECK(!wheel.Cancel(cancelled));
+        TWITCH_BOT_CHECK(wheel.GetCount() == 1);
+        TWITCH_BOT_CHECK(wheel.Advance(10) == 1);
+        TWITCH_BOT_CHECK(reusedCalled);
+
+        // The same goes for a timer which has fired.
+        bool laterCalled = false;
+        const auto later = wheel.Schedule(20, [&]{ laterCalled = true; });
+        TWITCH_BOT_CHECK(!wheel.Cancel(reused));
+        TWITCH_BOT_CHECK(wheel.GetCount() == 1);
+        TWITCH_BOT_CHECK(wheel.Advance(20) == 1);
+        TWITCH_BOT_CHECK(laterCalled);
+        TWITCH_BOT_CHECK(!wheel.Cancel(later));
+    }
+}
+
+int main()
+{
+    TestRandomizedAgainstReference();
+    TestCancelAfterFire();
+    TestStaleTimerIds();
+    return TwitchBot::Test::Finish();
+}